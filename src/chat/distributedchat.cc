@@ -67,6 +67,8 @@ DistributedChatService::DistributedChatService(uint32_t serv_type,p3ServiceContr
     _time_shift_average = 0.0f ;
     _should_reset_lobby_counts = false ;
     last_visible_lobby_info_request_time = 0 ;
+    _signatures_verified = 0 ;
+    _signatures_skipped_duplicates = 0 ;
 }
 
 void DistributedChatService::flush()
@@ -142,6 +144,9 @@ bool DistributedChatService::handleRecvChatLobbyMsgItem(RsChatMsgItem *ci)
         std::cerr << "(WW) Received lobby msg/item from banned identity " << cli->signature.keyId << ". Dropping it." << std::endl;
         return false ;
     }
+    if(isDuplicateLobbyObject(cli,cli->PeerId()))	// already received from another friend. No need to check the signature again.
+        return false ;
+
     if(!checkSignature(cli,cli->PeerId()))	// check the object's signature and possibly request missing keys
     {
         std::cerr << "Signature mismatched for this lobby event item. Item will be dropped: " << std::endl;
@@ -238,6 +243,11 @@ bool DistributedChatService::checkSignature(RsChatLobbyBouncingObject *obj,const
 	    return false ;
     }
 
+    {
+        RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
+        ++_signatures_verified ;
+    }
+
     uint32_t error_status ;
     RsIdentityUsage use_info(RsServiceType::CHAT,
                              RsIdentityUsage::CHAT_LOBBY_MSG_VALIDATION,
@@ -272,9 +282,75 @@ bool DistributedChatService::checkSignature(RsChatLobbyBouncingObject *obj,const
     std::cerr << "  signature: CHECKS" << std::endl;
 #endif
 
+    {
+        RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
+
+        VerifiedSignerRecord& rec(_verified_signers[obj->msg_id]) ;
+        rec.signer = obj->signature.keyId ;
+        rec.TS = time(NULL) ;
+    }
+
     return true ;
 }
 
+bool DistributedChatService::isDuplicateLobbyObject(RsChatLobbyBouncingObject *obj,const RsPeerId& peer_id)
+{
+	bool add_routing_clue = false ;
+
+	{
+		RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
+
+		if(!locked_isDuplicateLobbyObject(obj,peer_id))
+			return false ;
+
+		// The copy we checked was signed by the same id, so the clue is as reliable as the one given for that copy.
+
+		std::map<ChatLobbyMsgId,VerifiedSignerRecord>::const_iterator it = _verified_signers.find(obj->msg_id) ;
+		add_routing_clue = (it != _verified_signers.end() && it->second.signer == obj->signature.keyId) ;
+	}
+
+	// Outside of the mutex, as for the objects whose signature gets checked.
+
+	if(add_routing_clue)
+		rsGRouter->addRoutingClue(GRouterKeyId(obj->signature.keyId),peer_id) ;
+
+	return true ;
+}
+
+bool DistributedChatService::locked_isDuplicateLobbyObject(RsChatLobbyBouncingObject *obj,const RsPeerId& peer_id)
+{
+	std::map<ChatLobbyId,ChatLobbyEntry>::iterator it(_chat_lobbys.find(obj->lobby_id)) ;
+
+	if(it == _chat_lobbys.end())
+		return false ;
+
+	std::map<ChatLobbyMsgId,rstime_t>::iterator it2(it->second.msg_cache.find(obj->msg_id)) ;
+
+	if(it2 == it->second.msg_cache.end())
+		return false ;
+
+	// Same bookkeeping as in bounceLobbyObject(), except for the GXS id which is not authenticated here.
+
+	if(peer_id != mServControl->getOwnId())
+		it->second.participating_friends.insert(peer_id) ;
+
+	it2->second = time(NULL) ;	// update last msg seen time, to prevent echos.
+	++_signatures_skipped_duplicates ;
+
+#ifdef DEBUG_CHAT_LOBBIES
+	std::cerr << "  Msg " << std::hex << obj->msg_id << std::dec << " already received. Dropping before signature check." << std::endl ;
+#endif
+	return true ;
+}
+
+void DistributedChatService::getSignatureCheckStatistics(uint32_t& verified,uint32_t& skipped_duplicates)
+{
+	RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
+
+	verified = _signatures_verified ;
+	skipped_duplicates = _signatures_skipped_duplicates ;
+}
+
 bool DistributedChatService::getVirtualPeerId(const ChatLobbyId& id,ChatLobbyVirtualPeerId& vpid) 
 {
 	RsStackMutex stack(mDistributedChatMtx); /********** STACK LOCKED MTX ******/
@@ -341,6 +417,8 @@ void DistributedChatService::locked_printDebugInfo() const
 			std::cerr << "    With friend: " << *it2 << std::endl;
 	}
 
+    std::cerr << "Signatures: " << _signatures_verified << " checked, " << _signatures_skipped_duplicates << " skipped (duplicates)" << std::endl;
+
     std::cerr << "Chat lobby flags: " << std::endl;
 
     for( std::map<ChatLobbyId,ChatLobbyFlags>::const_iterator it(_known_lobbies_flags.begin()) ;it!=_known_lobbies_flags.end();++it)
@@ -711,6 +789,9 @@ void DistributedChatService::handleRecvChatLobbyEventItem(RsChatLobbyEventItem *
         	std::cerr << "(WW) Received lobby msg/item from banned identity " << item->signature.keyId << ". Dropping it." << std::endl;
 	        return ;
 	}
+	if(isDuplicateLobbyObject(item,item->PeerId()))	// already received from another friend. No need to check the signature again.
+		return ;
+
 	if(!checkSignature(item,item->PeerId()))	// check the object's signature and possibly request missing keys
 	{
         	std::cerr << "Signature mismatched for this lobby event item: " << std::endl;
@@ -1968,6 +2049,14 @@ void DistributedChatService::cleanLobbyCaches()
 
 		rstime_t now = time(NULL) ;
 
+		// 0 - remove old signers. Copies of older objects are not recognised as duplicates anyway.
+		//
+		for(std::map<ChatLobbyMsgId,VerifiedSignerRecord>::iterator it(_verified_signers.begin());it!=_verified_signers.end();)
+			if(it->second.TS + MAX_KEEP_MSG_RECORD < now)
+				it = _verified_signers.erase(it) ;
+			else
+				++it ;
+
 		for(std::map<ChatLobbyId,ChatLobbyEntry>::iterator it = _chat_lobbys.begin();it!=_chat_lobbys.end();++it)
 		{
 			// 1 - remove old messages
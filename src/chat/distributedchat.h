@@ -79,6 +79,9 @@ class DistributedChatService
 		void getListOfNearbyChatLobbies(std::vector<VisibleChatLobbyRecord>& public_lobbies) ;
 		bool joinVisibleChatLobby(const ChatLobbyId& id, const RsGxsId &gxs_id) ;
 
+		/// Number of lobby object signatures actually checked, and skipped because the object was a duplicate.
+		void getSignatureCheckStatistics(uint32_t& verified,uint32_t& skipped_duplicates) ;
+
 	protected:
 		bool handleRecvItem(RsChatItem *) ;
 
@@ -96,6 +99,12 @@ class DistributedChatService
 
 		bool checkSignature(RsChatLobbyBouncingObject *obj,const RsPeerId& peer_id) ;
 
+		/// Returns true when the object was already received in its lobby, so that it can be dropped
+		/// before its signature gets checked. The sending peer is still recorded as participating, and
+		/// as a routing clue for the signer when the checked copy had the same signer.
+		bool isDuplicateLobbyObject(RsChatLobbyBouncingObject *obj,const RsPeerId& peer_id) ;
+		bool locked_isDuplicateLobbyObject(RsChatLobbyBouncingObject *obj,const RsPeerId& peer_id) ;
+
 	private:
 		/// make some statistics about time shifts, to prevent various issues. 
 		void addTimeShiftStatistics(int shift) ;
@@ -159,6 +168,18 @@ class DistributedChatService
 		RsGxsId _default_identity;
 		std::map<ChatLobbyId,RsGxsId> _lobby_default_identity;
 
+		// Signers of the objects whose signature checked, for all lobbies. Copies of these objects are
+		// dropped unchecked, and give a routing clue only when they claim the same signer.
+		struct VerifiedSignerRecord
+		{
+			RsGxsId signer ;
+			rstime_t TS ;
+		};
+		std::map<ChatLobbyMsgId,VerifiedSignerRecord> _verified_signers ;
+
+		uint32_t _signatures_verified ;
+		uint32_t _signatures_skipped_duplicates ;
+
 		uint32_t mServType ;
 		RsMutex mDistributedChatMtx ;
 
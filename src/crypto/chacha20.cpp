@@ -33,6 +33,11 @@
 #include <iostream>
 #include <stdlib.h>
 
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
 #include "crypto/chacha20.h"
 #include "util/rsprint.h"
 #include "util/rsrandom.h"
@@ -659,6 +664,47 @@ out:
 #undef errorOut
 #endif
 
+bool AEAD_aes_256_gcm(uint8_t key[32], uint8_t nonce[12], uint8_t *data, uint32_t data_size, uint8_t *aad, uint32_t aad_size, uint8_t tag[16], bool encrypt_or_decrypt)
+{
+    // GCM is a stream mode, so the data is processed in place, in a single pass.
+
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+
+    if(!ctx)
+        return false ;
+
+    int len = 0;
+    bool ret = (1 == EVP_CipherInit_ex(ctx, EVP_aes_256_gcm(), NULL, NULL, NULL, encrypt_or_decrypt))
+            && (1 == EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, 12, NULL))
+            && (1 == EVP_CipherInit_ex(ctx, NULL, NULL, key, nonce, encrypt_or_decrypt))
+            && (aad_size == 0 || 1 == EVP_CipherUpdate(ctx, NULL, &len, aad, aad_size))
+            && (1 == EVP_CipherUpdate(ctx, data, &len, data, data_size)) ;
+
+    if(ret)
+    {
+        if(encrypt_or_decrypt)
+            ret = (1 == EVP_CipherFinal_ex(ctx, data + len, &len))
+                    && (1 == EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, 16, tag)) ;
+        else
+            ret = (1 == EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, 16, tag))
+                    && (EVP_CipherFinal_ex(ctx, data + len, &len) > 0) ;
+    }
+
+    EVP_CIPHER_CTX_free(ctx);
+    return ret ;
+}
+
+bool has_hardware_aes()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_cpu_supports("aes") ;
+#elif defined(__aarch64__) && defined(__linux__)
+    return getauxval(AT_HWCAP) & HWCAP_AES ;
+#else
+    return false ;
+#endif
+}
+
 bool AEAD_chacha20_sha256(uint8_t key[32], uint8_t nonce[12],uint8_t *data,uint32_t data_size,uint8_t *aad,uint32_t aad_size,uint8_t tag[16],bool encrypt)
 {
     // encrypt + tag. See RFC7539-2.8
@@ -1365,6 +1411,35 @@ bool perform_tests()
     }
     std::cerr << "  RFC7539 AEAD test vector #1           OK" << std::endl;
 
+    // AES-256-GCM test vector (zero key and IV, one zero block)
+    {
+        uint8_t key[32] = { 0 };
+        uint8_t nonce[12] = { 0 };
+        uint8_t data[16] = { 0 };
+        uint8_t tag[16] ;
+
+        uint8_t ciphertext[16] = { 0xce,0xa7,0x40,0x3d,0x4d,0x60,0x6b,0x6e,0x07,0x4e,0xc5,0xd3,0xba,0xf3,0x9d,0x18 };
+        uint8_t expected_tag[16] = { 0xd0,0xd1,0xc8,0xa7,0x99,0x99,0x6b,0xf0,0x26,0x5b,0x98,0xb5,0xd4,0x8a,0xb9,0x19 };
+
+        if(!AEAD_aes_256_gcm(key,nonce,data,16,NULL,0,tag,true))
+            return false ;
+
+        if(!constant_time_memory_compare(data,ciphertext,16) || !constant_time_memory_compare(tag,expected_tag,16))
+            return false ;
+
+        if(!AEAD_aes_256_gcm(key,nonce,data,16,NULL,0,tag,false))
+            return false ;
+
+        if(!AEAD_aes_256_gcm(key,nonce,data,16,NULL,0,tag,true))
+            return false ;
+
+        tag[0] ^= 1 ;
+
+        if(AEAD_aes_256_gcm(key,nonce,data,16,NULL,0,tag,false))	// must fail: wrong tag
+            return false ;
+    }
+    std::cerr << "  AES-256-GCM test vector               OK" << std::endl;
+
     // bandwidth test
     //
 
@@ -1402,6 +1477,12 @@ bool perform_tests()
             std::cerr << "  AEAD/poly1305 openssl encryption speed: " << SIZE / (1024.0*1024.0) / s.duration() << " MB/s" << std::endl;
         }
 #endif
+        {
+            rstime::RsScopeTimer s("AEAD5") ;
+            AEAD_aes_256_gcm(key,nonce,ten_megabyte_data,SIZE,aad,12,received_tag,true) ;
+
+            std::cerr << "  AEAD/AES-256-GCM openssl encryption speed: " << SIZE / (1024.0*1024.0) / s.duration() << " MB/s" << std::endl;
+        }
         {
             rstime::RsScopeTimer s("AEAD4") ;
             AEAD_chacha20_sha256(key,nonce,ten_megabyte_data,SIZE,aad,12,received_tag,true) ;
@@ -88,6 +88,30 @@ namespace librs
          */
         bool AEAD_chacha20_sha256(uint8_t key[32], uint8_t nonce[12],uint8_t *data,uint32_t data_size,uint8_t *aad,uint32_t aad_size,uint8_t tag[16],bool encrypt_or_decrypt) ;
 
+        /*!
+         * \brief AEAD_aes_256_gcm
+         * 			 Provides in-place authenticated encryption using AES-256 in GCM mode, with the same interface as
+         * 			AEAD_chacha20_poly1305. OpenSSL uses the AES/carry-less multiply instructions of the CPU when available.
+         *
+         * \param key			32 bytes encryption key
+         * \param nonce			nonce. *Must be unique* for a given key.
+         * \param data			data that is encrypted/decrypted in place
+         * \param data_size		size of the data
+         * \param aad           additional authenticated data. Can be used to authenticate the nonce.
+         * \param aad_size
+         * \param tag			16 bytes GCM tag, generated when encrypting, checked when decrypting.
+         * \param encrypt		true to encrypt, false to decrypt and check the tag.
+         * \return
+         * 			false if OpenSSL failed, or if the tag does not check when decrypting.
+         */
+        bool AEAD_aes_256_gcm(uint8_t key[32], uint8_t nonce[12],uint8_t *data,uint32_t data_size,uint8_t *aad,uint32_t aad_size,uint8_t tag[16],bool encrypt_or_decrypt) ;
+
+        /*!
+         * \brief has_hardware_aes
+         * 			Tells whether the CPU has AES instructions, in which case AES-GCM is faster than chacha20/poly1305.
+         */
+        bool has_hardware_aes() ;
+
         /*!
          * \brief constant_time_memcmp
          * 			Provides a constant time comparison of two memory chunks. Calls CRYPTO_memcmp.
@@ -71,6 +71,9 @@ InternalFileHierarchyStorage::InternalFileHierarchyStorage() : mRoot(0)
 
     mTotalSize = 0 ;
     mTotalFiles = 0 ;
+
+    mTrackChangedFiles = false ;
+    mAllFilesChanged = false ;
 }
 
 bool InternalFileHierarchyStorage::getDirHashFromIndex(
@@ -335,6 +338,7 @@ bool InternalFileHierarchyStorage::updateSubFilesList(
 		if(it->second.modtime != f.file_modtime || it->second.size != f.file_size)
         {
 			// hash needs recomputing
+			recordFileChange(d.subfiles[i]) ;
 			f.file_hash.clear();
             f.file_modtime = it->second.modtime;
             f.file_size = it->second.size;
@@ -379,6 +383,7 @@ bool InternalFileHierarchyStorage::updateHash(
 
     RsFileHash& old_hash (static_cast<FileEntry*>(mNodes[file_index])->file_hash) ;
     mFileHashes[hash] = file_index ;
+    recordFileChange(file_index) ;
 
     old_hash = hash ;
 
@@ -410,6 +415,7 @@ bool InternalFileHierarchyStorage::updateFile(const DirectoryStorage::EntryIndex
     if(!hash.isNull())
         mFileHashes[hash] = file_index ;
 
+    recordFileChange(file_index) ;
     return true;
 }
 
@@ -433,6 +439,8 @@ void InternalFileHierarchyStorage::deleteFileNode(uint32_t index)
 		delete mNodes[index] ;
 		mFreeNodes.push_back(index) ;
 		mNodes[index] = NULL ;
+
+		recordFileChange(index) ;
 	}
 }
 void InternalFileHierarchyStorage::deleteNode(uint32_t index)
@@ -442,9 +450,49 @@ void InternalFileHierarchyStorage::deleteNode(uint32_t index)
         delete mNodes[index] ;
         mFreeNodes.push_back(index) ;
         mNodes[index] = NULL ;
+
+        recordFileChange(index) ;
     }
 }
 
+void InternalFileHierarchyStorage::recordFileChange(DirectoryStorage::EntryIndex indx)
+{
+    if(!mTrackChangedFiles || mAllFilesChanged)
+        return ;
+
+    mChangedFiles.insert(indx) ;
+
+    if(mChangedFiles.size() > MAX_RECORDED_FILE_CHANGES)
+        recordAllFilesChanged() ;
+}
+
+void InternalFileHierarchyStorage::recordAllFilesChanged()
+{
+    if(!mTrackChangedFiles)
+        return ;
+
+    mAllFilesChanged = true ;
+    mChangedFiles.clear() ;
+}
+
+void InternalFileHierarchyStorage::trackChangedFiles(bool b)
+{
+    mTrackChangedFiles = b ;
+    mAllFilesChanged = false ;
+    mChangedFiles.clear() ;
+}
+
+bool InternalFileHierarchyStorage::takeChangedFiles(std::set<DirectoryStorage::EntryIndex>& changed)
+{
+    bool all_changed = mAllFilesChanged ;
+
+    changed.clear() ;
+    changed.swap(mChangedFiles) ;
+    mAllFilesChanged = false ;
+
+    return !all_changed ;
+}
+
 DirectoryStorage::EntryIndex InternalFileHierarchyStorage::allocateNewIndex()
 {
     while(!mFreeNodes.empty())
@@ -786,8 +834,9 @@ class DirectoryStorageExprFileEntry: public RsRegularExpression::ExpFileEntry
 public:
 	DirectoryStorageExprFileEntry(
 	        const InternalFileHierarchyStorage::FileEntry& fe,
-	        const InternalFileHierarchyStorage::DirEntry& parent ) :
-	    mFe(fe), mDe(parent) {}
+	        const InternalFileHierarchyStorage::DirEntry& parent,
+	        std::map<DirectoryStorage::EntryIndex,std::string>& parent_paths ) :
+	    mFe(fe), mDe(parent), mParentPaths(parent_paths) {}
 
     inline virtual const std::string& file_name()       const { return mFe.file_name ; }
     inline virtual uint64_t           file_size()       const { return mFe.file_size ; }
@@ -796,22 +845,36 @@ public:
 	inline virtual std::string        file_parent_path()const { return RsDirUtil::makePath(mDe.dir_parent_path, mDe.dir_name) ; }
     inline virtual uint32_t           file_popularity() const { NOT_IMPLEMENTED() ; return 0; }
 
+	// Paths are built once per directory and search
+	virtual const std::string *file_parent_path_ptr() const
+	{
+		std::map<DirectoryStorage::EntryIndex,std::string>::iterator it = mParentPaths.find(mFe.parent_index) ;
+
+		if(it == mParentPaths.end())
+			it = mParentPaths.insert(std::make_pair(mFe.parent_index,file_parent_path())).first ;
+
+		return &it->second ;
+	}
+
 private:
     const InternalFileHierarchyStorage::FileEntry& mFe ;
     const InternalFileHierarchyStorage::DirEntry& mDe ;
+    std::map<DirectoryStorage::EntryIndex,std::string>& mParentPaths ;
 };
 
 int InternalFileHierarchyStorage::searchBoolExp(
-        RsRegularExpression::Expression* exp,
+        const RsRegularExpression::CompiledExpression& exp,
         std::list<DirectoryStorage::EntryIndex>& results ) const
 {
+	std::map<DirectoryStorage::EntryIndex,std::string> parent_paths ;
+
 	for(auto& it: std::as_const(mFileHashes))
 		if(mNodes[it.second])
-			if(exp->eval(
+			if(exp.eval(
 			            DirectoryStorageExprFileEntry(
 			                *static_cast<const FileEntry*>(mNodes[it.second]),
-			                *static_cast<const DirEntry*>(mNodes[mNodes[it.second]->parent_index])
-			                                      ) ))
+			                *static_cast<const DirEntry*>(mNodes[mNodes[it.second]->parent_index]),
+			                parent_paths ) ))
 			results.push_back(it.second);
 
     return 0;
@@ -825,41 +888,57 @@ int InternalFileHierarchyStorage::searchTerms(
 	 * the entries tab. Instead we go through the table of hashes.*/
 
 	for(auto& it : std::as_const(mFileHashes))
-	{
 		// node may be null for some hash waiting to be deleted
-		if(mNodes[it.second])
-		{
-			rs_view_ptr<FileEntry> tFileEntry =
-			        static_cast<FileEntry*>(mNodes[it.second]);
-
-			/* Most file will just have file name stored, but single file shared
-			 * without a shared dir will contain full path instead of just the
-			 * name, so purify it to perform the search */
-			std::string tFilename = tFileEntry->file_name;
-			if(tFileEntry->file_name.find("/") != std::string::npos)
-			{
-				std::string _tParentDir;
-				RsDirUtil::splitDirFromFile(
-				            tFileEntry->file_name, _tParentDir, tFilename );
-			}
-
-			for(auto& termIt : std::as_const(terms))
-			{
-				/* always ignore case */
-				if(tFilename.end() != std::search(
-				            tFilename.begin(), tFilename.end(),
-				            termIt.begin(), termIt.end(),
-				            RsRegularExpression::CompareCharIC() ))
-				{
-					results.push_back(it.second);
-					break;
-				}
-			}
-		}
-	}
+		if(mNodes[it.second] && fileNameMatchesTerms(*static_cast<const FileEntry*>(mNodes[it.second]),terms))
+			results.push_back(it.second);
+
 	return 0;
 }
 
+bool InternalFileHierarchyStorage::fileNameMatchesTerms(const FileEntry& fe,const std::list<std::string>& terms)
+{
+	/* Most file will just have file name stored, but single file shared
+	 * without a shared dir will contain full path instead of just the
+	 * name, so purify it to perform the search */
+	std::string tFilename = fe.file_name;
+	if(fe.file_name.find("/") != std::string::npos)
+	{
+		std::string _tParentDir;
+		RsDirUtil::splitDirFromFile(fe.file_name, _tParentDir, tFilename );
+	}
+
+	for(auto& termIt : std::as_const(terms))
+		/* always ignore case */
+		if(tFilename.end() != std::search(
+		            tFilename.begin(), tFilename.end(),
+		            termIt.begin(), termIt.end(),
+		            RsRegularExpression::CompareCharIC() ))
+			return true;
+
+	return false;
+}
+
+bool InternalFileHierarchyStorage::fileMatchesTerms(DirectoryStorage::EntryIndex indx,const std::list<std::string>& terms) const
+{
+	// no checkIndex() here: removed files are tested too, and are no error
+
+	if(!isIndexValid(indx) || mNodes[indx]->type() != FileStorageNode::TYPE_FILE)
+		return false ;
+
+	return fileNameMatchesTerms(*static_cast<const FileEntry*>(mNodes[indx]),terms) ;
+}
+
+bool InternalFileHierarchyStorage::fileMatchesExp(DirectoryStorage::EntryIndex indx,const RsRegularExpression::CompiledExpression& exp) const
+{
+	if(!isIndexValid(indx) || mNodes[indx]->type() != FileStorageNode::TYPE_FILE)
+		return false ;
+
+	const FileEntry& fe(*static_cast<const FileEntry*>(mNodes[indx])) ;
+	std::map<DirectoryStorage::EntryIndex,std::string> parent_paths ;
+
+	return exp.eval(DirectoryStorageExprFileEntry(fe,*static_cast<const DirEntry*>(mNodes[fe.parent_index]),parent_paths)) ;
+}
+
 bool InternalFileHierarchyStorage::check(std::string& error_string) // checks consistency of storage.
 {
     // recurs go through all entries, check that all
@@ -934,6 +1013,9 @@ bool InternalFileHierarchyStorage::check(std::string& error_string) // checks co
             deleteNode(i) ;	// we don't care if it's a file or a dir.
         }
 
+    if(!error_string.empty())
+        recordAllFilesChanged() ;
+
     return error_string.empty();;
 }
 
@@ -1135,6 +1217,7 @@ bool InternalFileHierarchyStorage::load(const std::string& fname)
     mFreeNodes.clear();
     mTotalFiles = 0;
     mTotalSize = 0;
+    recordAllFilesChanged();
 
     try
     {
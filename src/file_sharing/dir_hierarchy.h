@@ -145,9 +145,21 @@ public:
     // search. SearchHash is logarithmic. The other two are linear.
 
     bool searchHash(const RsFileHash& hash, DirectoryStorage::EntryIndex &result);
-    int searchBoolExp(RsRegularExpression::Expression * exp, std::list<DirectoryStorage::EntryIndex> &results) const ;
+    int searchBoolExp(const RsRegularExpression::CompiledExpression& exp, std::list<DirectoryStorage::EntryIndex> &results) const ;
     int searchTerms(const std::list<std::string>& terms, std::list<DirectoryStorage::EntryIndex> &results) const ;		// does a logical OR between items of the list of terms
 
+    // Same tests as the search functions above, for a single file. Return false if the index is not a file.
+
+    bool fileMatchesTerms(DirectoryStorage::EntryIndex indx,const std::list<std::string>& terms) const ;
+    bool fileMatchesExp(DirectoryStorage::EntryIndex indx,const RsRegularExpression::CompiledExpression& exp) const ;
+
+    // Records the files that are removed, modified or hashed, so that search results computed before can be checked against
+    // them. Recording is off by default. takeChangedFiles() returns the files changed since the last call, and false if there
+    // were too many changes (or a reload) to record, in which case all files should be considered as changed.
+
+    void trackChangedFiles(bool b) ;
+    bool takeChangedFiles(std::set<DirectoryStorage::EntryIndex>& changed) ;
+
     bool check(std::string& error_string)	;// checks consistency of storage.
 
     void print() const;
@@ -175,6 +187,11 @@ private:
 
     bool recursRemoveDirectory(DirectoryStorage::EntryIndex dir);
 
+    static bool fileNameMatchesTerms(const FileEntry& fe,const std::list<std::string>& terms) ;
+
+    void recordFileChange(DirectoryStorage::EntryIndex indx) ;
+    void recordAllFilesChanged() ;
+
     // Map of the hash of all files. The file hashes are the sha1sum of the file data.
     // is used for fast search access for FT.
     // Note: We should try something faster than std::map. hash_map??
@@ -195,5 +212,11 @@ private:
 
     uint32_t mTotalFiles ;
     uint64_t mTotalSize ;
+
+    // changed files, see trackChangedFiles()
+
+    bool mTrackChangedFiles ;
+    bool mAllFilesChanged ;
+    std::set<DirectoryStorage::EntryIndex> mChangedFiles ;
 };
 
@@ -200,7 +200,7 @@ int DirectoryStorage::searchTerms(
     RS_STACK_MUTEX(mDirStorageMtx) ;
     return mFileHierarchy->searchTerms(terms,results);
 }
-int DirectoryStorage::searchBoolExp(RsRegularExpression::Expression * exp, std::list<EntryIndex> &results) const
+int DirectoryStorage::searchBoolExp(const RsRegularExpression::CompiledExpression& exp, std::list<EntryIndex> &results) const
 {
     RS_STACK_MUTEX(mDirStorageMtx) ;
     return mFileHierarchy->searchBoolExp(exp,results);
@@ -356,6 +356,27 @@ int LocalDirectoryStorage::searchHash(const RsFileHash& hash, RsFileHash& real_h
     return false ;
 }
 
+void LocalDirectoryStorage::trackChangedFiles(bool b)
+{
+    RS_STACK_MUTEX(mDirStorageMtx) ;
+    mFileHierarchy->trackChangedFiles(b) ;
+}
+bool LocalDirectoryStorage::getChangedFiles(std::set<EntryIndex>& changed)
+{
+    RS_STACK_MUTEX(mDirStorageMtx) ;
+    return mFileHierarchy->takeChangedFiles(changed) ;
+}
+bool LocalDirectoryStorage::fileMatches(const EntryIndex& indx,const std::list<std::string>& terms) const
+{
+    RS_STACK_MUTEX(mDirStorageMtx) ;
+    return mFileHierarchy->fileMatchesTerms(indx,terms) ;
+}
+bool LocalDirectoryStorage::fileMatches(const EntryIndex& indx,const RsRegularExpression::CompiledExpression& exp) const
+{
+    RS_STACK_MUTEX(mDirStorageMtx) ;
+    return mFileHierarchy->fileMatchesExp(indx,exp) ;
+}
+
 void LocalDirectoryStorage::setSharedDirectoryList(
         const std::list<SharedDirInfo>& lst )
 {
@@ -412,6 +433,9 @@ void LocalDirectoryStorage::setSharedDirectoryList(
 
 		mLocalDirs = new_dirs ;
 		mTSChanged = true ;
+
+		// paths and permissions of search results may have changed
+		mFileHierarchy->recordAllFilesChanged() ;
 	}
 
     // now update the TS off-mutex.
@@ -457,6 +481,7 @@ void LocalDirectoryStorage::updateShareFlags(const SharedDirInfo& info)
         if(!SharedDirInfo::sameLists(it->second.parent_groups,info.parent_groups) || it->second.filename != info.filename || it->second.shareflags != info.shareflags || it->second.virtualname != info.virtualname)
         {
             it->second = info;
+            mFileHierarchy->recordAllFilesChanged() ;
 
 #ifdef DEBUG_LOCAL_DIRECTORY_STORAGE
             std::cerr << "Updating dir mod time because flags at level 0 have changed." << std::endl;
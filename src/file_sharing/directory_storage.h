@@ -27,6 +27,7 @@
 
 #include "retroshare/rsids.h"
 #include "retroshare/rsfiles.h"
+#include "retroshare/rsexpr.h"
 #include "util/rstime.h"
 
 #define NOT_IMPLEMENTED() { std::cerr << __PRETTY_FUNCTION__ << ": not yet implemented." << std::endl; }
@@ -49,7 +50,7 @@ class DirectoryStorage
         // These functions are to be used by file transfer and file search.
 
         virtual int searchTerms(const std::list<std::string>& terms, std::list<EntryIndex> &results) const ;
-        virtual int searchBoolExp(RsRegularExpression::Expression * exp, std::list<EntryIndex> &results) const ;
+        virtual int searchBoolExp(const RsRegularExpression::CompiledExpression& exp, std::list<EntryIndex> &results) const ;
 
         // gets/sets the various time stamps:
         //
@@ -247,6 +248,22 @@ public:
      */
     virtual int searchHash(const RsFileHash& hash, RsFileHash &real_hash, EntryIndex &results) const ;
 
+    /*!
+     * \brief trackChangedFiles / getChangedFiles
+     * 			Keeps track of the files that are removed, modified or hashed, and of share flag changes, so that
+     * 			cached search results can be checked against them. Off by default.
+     * \param changed		files changed since the last call
+     * \return
+     * 						false if there were too many changes to keep track of. All files should be considered as changed then.
+     */
+    void trackChangedFiles(bool b) ;
+    bool getChangedFiles(std::set<EntryIndex>& changed) ;
+
+    // Tell whether searchTerms()/searchBoolExp() would return that file, whether it is hashed or not.
+
+    bool fileMatches(const EntryIndex& indx,const std::list<std::string>& terms) const ;
+    bool fileMatches(const EntryIndex& indx,const RsRegularExpression::CompiledExpression& exp) const ;
+
     /*!
      * \brief updateTimeStamps
      * 			Checks recursive TS and update the if needed.
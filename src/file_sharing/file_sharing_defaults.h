@@ -63,6 +63,9 @@ static const uint64_t ENTRY_INDEX_BIT_MASK_64BITS                    = 0x0000000
 
 static const uint32_t DELAY_BEFORE_DROP_REQUEST               = 600; 			// every 10 min
 
+static const uint32_t MAX_RECORDED_FILE_CHANGES               = 10000;			// above this, all cached search results are dropped instead of being checked one by one
+static const uint32_t SEARCH_CACHE_MAX_MEMORY                 = 4*1024*1024;	// memory used by cached local search results
+
 static const bool FOLLOW_SYMLINKS_DEFAULT                     = true;
 static const bool TRUST_FRIEND_NODES_FOR_BANNED_FILES_DEFAULT = true;
 
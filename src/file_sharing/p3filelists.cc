@@ -21,6 +21,8 @@
  * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
  *                                                                             *
  ******************************************************************************/
+#include <chrono>
+
 #include "rsitems/rsserviceids.h"
 
 #include "file_sharing/p3filelists.h"
@@ -48,7 +50,7 @@ static const uint32_t P3FILELISTS_UPDATE_FLAG_LOCAL_DIRS_CHANGED  = 0x0002 ;
 static const uint32_t P3FILELISTS_UPDATE_FLAG_REMOTE_DIRS_CHANGED = 0x0004 ;
 
 p3FileDatabase::p3FileDatabase(p3ServiceControl *mpeers)
-    : mServCtrl(mpeers), mFLSMtx("p3FileLists")
+    : mServCtrl(mpeers), mFLSMtx("p3FileLists"), mSearchCache(SEARCH_CACHE_MAX_MEMORY)
 {
     // make sure the base directory exists
 
@@ -69,6 +71,7 @@ p3FileDatabase::p3FileDatabase(p3ServiceControl *mpeers)
 
     mBannedFileListNeedsUpdate = false;
     mLocalSharedDirs = new LocalDirectoryStorage(mFileSharingDir + "/" + LOCAL_SHARED_DIRS_FILE_NAME,mOwnId);
+    mLocalSharedDirs->trackChangedFiles(true);
     mHashCache = new HashStorage(mFileSharingDir + "/" + HASH_CACHE_FILE_NAME) ;
 
     mLocalDirWatcher = new LocalDirectoryUpdater(mHashCache,mLocalSharedDirs) ;
@@ -1051,6 +1054,22 @@ int p3FileDatabase::getSharedDirStatistics(const RsPeerId& pid,SharedDirStats& s
     }
 }
 
+void p3FileDatabase::getSearchCacheStatistics(SearchCacheStats& stats) const
+{
+    RS_STACK_MUTEX(mFLSMtx) ;
+    mSearchCache.getStatistics(stats) ;
+}
+
+void p3FileDatabase::forceSyncWithPeers()
+{
+    NOT_IMPLEMENTED() ;
+
+    // What friends are allowed to find has changed as well
+
+    RS_STACK_MUTEX(mFLSMtx) ;
+    mSearchCache.clear() ;
+}
+
 uint64_t p3FileDatabase::getCumulativeUpload(const RsFileHash& hash) const
 {
 	RS_STACK_MUTEX(mFLSMtx);
@@ -1454,11 +1473,20 @@ int p3FileDatabase::SearchKeywords(
     {
         std::list<EntryIndex> firesults;
         std::list<void *> pointers;
+        std::string cache_key = LocalSearchCache::makeKey(keywords, flags, client_peer_id);
+        uint32_t cache_generation;
+        bool cached;
+        auto start = std::chrono::steady_clock::now();
 
         {
             RS_STACK_MUTEX(mFLSMtx) ;
 
-            mLocalSharedDirs->searchTerms(keywords,firesults) ;
+            locked_updateSearchCache();
+            cache_generation = mSearchCache.generation();
+            cached = mSearchCache.get(cache_key, results);
+
+            if(!cached)
+                mLocalSharedDirs->searchTerms(keywords,firesults) ;
 
 			for(auto& it: std::as_const(firesults))
 			{
@@ -1468,7 +1496,18 @@ int p3FileDatabase::SearchKeywords(
 			}
         }
 
-		filterResults(pointers, results, flags, client_peer_id);
+		if(!cached)
+		{
+			filterResults(pointers, results, flags, client_peer_id);
+
+			LocalSearchCache::Search search;
+			search.keywords = true;
+			search.terms = keywords;
+
+			RS_STACK_MUTEX(mFLSMtx) ;
+			mSearchCache.put( cache_key, cache_generation, search, firesults, results,
+			                  std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() );
+		}
     }
 
     if(flags & RS_FILE_HINTS_REMOTE)
@@ -1510,14 +1549,29 @@ int p3FileDatabase::SearchKeywords(
 
 int p3FileDatabase::SearchBoolExp(RsRegularExpression::Expression *exp, std::list<DirDetails>& results,FileSearchFlags flags,const RsPeerId& client_peer_id) const
 {
+    // Compiled once for all directories
+    RsRegularExpression::CompiledExpression compiled_exp ;
+
+    if(exp == NULL || !compiled_exp.compile(*exp))
+        return 0 ;
+
     if(flags & RS_FILE_HINTS_LOCAL)
     {
         std::list<EntryIndex> firesults;
         std::list<void*> pointers;
+        std::string cache_key = LocalSearchCache::makeKey(*exp,flags,client_peer_id) ;
+        uint32_t cache_generation ;
+        bool cached ;
+        auto start = std::chrono::steady_clock::now();
         {
             RS_STACK_MUTEX(mFLSMtx) ;
 
-            mLocalSharedDirs->searchBoolExp(exp,firesults) ;
+            locked_updateSearchCache() ;
+            cache_generation = mSearchCache.generation() ;
+            cached = mSearchCache.get(cache_key,results) ;
+
+            if(!cached)
+                mLocalSharedDirs->searchBoolExp(compiled_exp,firesults) ;
 
             for(std::list<EntryIndex>::iterator it(firesults.begin());it!=firesults.end();++it)
             {
@@ -1527,7 +1581,17 @@ int p3FileDatabase::SearchBoolExp(RsRegularExpression::Expression *exp, std::lis
             }
         }
 
-        filterResults(pointers,results,flags,client_peer_id) ;
+        if(!cached)
+        {
+            filterResults(pointers,results,flags,client_peer_id) ;
+
+            LocalSearchCache::Search search ;
+            search.exp = compiled_exp ;
+
+            RS_STACK_MUTEX(mFLSMtx) ;
+            mSearchCache.put( cache_key, cache_generation, search, firesults, results,
+                              std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() ) ;
+        }
     }
 
     if(flags & RS_FILE_HINTS_REMOTE)
@@ -1540,7 +1604,7 @@ int p3FileDatabase::SearchBoolExp(RsRegularExpression::Expression *exp, std::lis
                 if(mRemoteDirectories[i] != NULL)
                 {
                     std::list<EntryIndex> local_results;
-                    mRemoteDirectories[i]->searchBoolExp(exp,local_results) ;
+                    mRemoteDirectories[i]->searchBoolExp(compiled_exp,local_results) ;
 
                     for(std::list<EntryIndex>::iterator it(local_results.begin());it!=local_results.end();++it)
                     {
@@ -1617,6 +1681,24 @@ bool p3FileDatabase::search(
     return false;
 }
 
+void p3FileDatabase::locked_updateSearchCache() const
+{
+    std::set<EntryIndex> changed ;
+
+    if(!mLocalSharedDirs->getChangedFiles(changed))
+    {
+        mSearchCache.clear() ;
+        return ;
+    }
+
+    const LocalDirectoryStorage *dirs = mLocalSharedDirs ;
+
+    mSearchCache.invalidate(changed,[dirs](EntryIndex e,const LocalSearchCache::Search& s)
+    {
+        return s.keywords ? dirs->fileMatches(e,s.terms) : dirs->fileMatches(e,s.exp) ;
+    }) ;
+}
+
 int p3FileDatabase::filterResults(
         const std::list<void*>& firesults, std::list<DirDetails>& results,
         FileSearchFlags flags, const RsPeerId& peer_id ) const
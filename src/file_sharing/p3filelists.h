@@ -66,6 +66,7 @@
 #include "util/rstime.h"
 #include "file_sharing/hash_cache.h"
 #include "file_sharing/directory_storage.h"
+#include "file_sharing/search_cache.h"
 
 #include "pqi/p3cfgmgr.h"
 #include "pqi/p3linkmgr.h"
@@ -114,7 +115,7 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
         * Forces the synchronisation of the database with connected peers. This is triggered when e.g. a new group of friend is created, or when
         * a friend was added/removed from a group.
         */
-        void forceSyncWithPeers() { NOT_IMPLEMENTED() ; }
+        void forceSyncWithPeers() ;
 
 		// derived from p3Service
 		//
@@ -171,6 +172,7 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
         // computes/gathers statistics about shared directories
 
 		int getSharedDirStatistics(const RsPeerId& pid,SharedDirStats& stats);
+		void getSearchCacheStatistics(SearchCacheStats& stats) const;
 
         virtual uint64_t getCumulativeUpload(const RsFileHash& hash) const;
         virtual uint64_t getCumulativeUploadAll() const;
@@ -199,6 +201,7 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
         void getExtraFilesDirDetails_locked(void *ref,DirectoryStorage::EntryIndex e,DirDetails& d) const;
 
         int filterResults(const std::list<void*>& firesults,std::list<DirDetails>& results,FileSearchFlags flags,const RsPeerId& peer_id) const;
+        void locked_updateSearchCache() const;	// drops cached search results that changed local files may affect
         std::string makeRemoteFileName(const RsPeerId& pid) const;
 
         // Derived from p3Config
@@ -285,6 +288,7 @@ class p3FileDatabase: public p3Service, public p3Config, public ftSearch //, pub
         // Local flags and mutexes
 
         mutable RsMutex mFLSMtx ;
+        mutable LocalSearchCache mSearchCache ;	// results of recent local searches, mostly turtle searches received many times
         uint32_t mUpdateFlags ;
         std::string mFileSharingDir ;
         rstime_t mLastCleanupTime;
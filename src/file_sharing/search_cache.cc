@@ -0,0 +1,207 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: search_cache.cc                             *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <ctype.h>
+#include <iostream>
+
+#include "file_sharing/search_cache.h"
+#include "util/rsstring.h"
+
+//#define DEBUG_SEARCH_CACHE 1
+
+// An entry bigger than this part of the cache would evict too many others.
+static const uint32_t MAX_ENTRY_MEMORY_FRACTION = 8 ;
+
+LocalSearchCache::LocalSearchCache(size_t max_memory)
+    : mMaxMemory(max_memory), mMemory(0), mGeneration(0), mHits(0), mMisses(0), mCpuSavedUs(0)
+{
+}
+
+static void appendKeyPrefix(std::string& key,char kind,FileSearchFlags flags,const RsPeerId& peer_id)
+{
+	flags &= RS_FILE_HINTS_PERMISSION_MASK ;
+
+	key += kind ;
+	rs_sprintf_append(key, "%08x", flags.toUInt32()) ;
+	key += peer_id.toStdString() ;
+}
+
+std::string LocalSearchCache::makeKey(const std::list<std::string>& keywords,FileSearchFlags flags,const RsPeerId& peer_id)
+{
+	std::set<std::string> terms ;
+
+	for(std::list<std::string>::const_iterator it(keywords.begin());it!=keywords.end();++it)
+	{
+		std::string s(*it) ;
+
+		for(uint32_t i=0;i<s.size();++i)
+			s[i] = tolower(static_cast<unsigned char>(s[i])) ;
+
+		terms.insert(s) ;
+	}
+
+	std::string key ;
+	appendKeyPrefix(key,'K',flags,peer_id) ;
+
+	for(std::set<std::string>::const_iterator it(terms.begin());it!=terms.end();++it)
+	{
+		key += '\0' ;
+		key += *it ;
+	}
+	return key ;
+}
+
+std::string LocalSearchCache::makeKey(const RsRegularExpression::Expression& exp,FileSearchFlags flags,const RsPeerId& peer_id)
+{
+	RsRegularExpression::LinearizedExpression e ;
+	exp.linearize(e) ;
+
+	std::string key ;
+	appendKeyPrefix(key,'E',flags,peer_id) ;
+
+	key.append(e._tokens.begin(),e._tokens.end()) ;
+
+	for(uint32_t i=0;i<e._ints.size();++i)
+		rs_sprintf_append(key, ":%x", e._ints[i]) ;
+
+	for(uint32_t i=0;i<e._strings.size();++i)
+	{
+		rs_sprintf_append(key, ":%x:", (uint32_t)e._strings[i].size()) ;
+		key += e._strings[i] ;
+	}
+
+	return key ;
+}
+
+bool LocalSearchCache::get(const std::string& key,std::list<DirDetails>& results)
+{
+	std::map<std::string,std::list<Entry>::iterator>::const_iterator it = mKeys.find(key) ;
+
+	if(it == mKeys.end())
+	{
+		++mMisses ;
+		return false ;
+	}
+
+	++mHits ;
+	mCpuSavedUs += it->second->search_time_us ;
+
+	mEntries.splice(mEntries.begin(),mEntries,it->second) ;
+	results = it->second->results ;
+
+#ifdef DEBUG_SEARCH_CACHE
+	std::cerr << "LocalSearchCache: hit, " << results.size() << " results" << std::endl;
+#endif
+	return true ;
+}
+
+void LocalSearchCache::put(const std::string& key,uint32_t generation,const Search& search,const std::list<EntryIndex>& files,const std::list<DirDetails>& results,uint64_t search_time_us)
+{
+	if(generation != mGeneration)
+		return ;
+
+	size_t memory = sizeof(Entry) + 2*key.size() + files.size()*sizeof(EntryIndex) + search.exp.memoryUsage() ;
+
+	for(std::list<std::string>::const_iterator it(search.terms.begin());it!=search.terms.end();++it)
+		memory += sizeof(std::string) + it->size() ;
+
+	for(std::list<DirDetails>::const_iterator it(results.begin());it!=results.end();++it)
+		memory += sizeof(DirDetails) + it->name.size() + it->path.size() + it->parent_groups.size()*sizeof(RsNodeGroupId) ;
+
+	if(memory > mMaxMemory / MAX_ENTRY_MEMORY_FRACTION)
+		return ;
+
+	std::map<std::string,std::list<Entry>::iterator>::iterator it = mKeys.find(key) ;
+
+	if(it != mKeys.end())
+		removeEntry(it->second) ;
+
+	while(!mEntries.empty() && mMemory + memory > mMaxMemory)
+		removeEntry(--mEntries.end()) ;
+
+	mEntries.push_front(Entry()) ;
+	Entry& e(mEntries.front()) ;
+
+	e.key = key ;
+	e.search = search ;
+	e.files.assign(files.begin(),files.end()) ;
+	std::sort(e.files.begin(),e.files.end()) ;
+	e.results = results ;
+	e.search_time_us = search_time_us ;
+	e.memory = memory ;
+
+	mKeys[key] = mEntries.begin() ;
+	mMemory += memory ;
+}
+
+void LocalSearchCache::invalidate(const std::set<EntryIndex>& changed,const std::function<bool(EntryIndex,const Search&)>& matches)
+{
+	if(changed.empty())
+		return ;
+
+	++mGeneration ;
+
+	for(std::list<Entry>::iterator it(mEntries.begin());it!=mEntries.end();)
+	{
+		bool drop = false ;
+
+		for(std::set<EntryIndex>::const_iterator cit(changed.begin());cit!=changed.end() && !drop;++cit)
+			drop = std::binary_search(it->files.begin(),it->files.end(),*cit) || matches(*cit,it->search) ;
+
+		if(drop)
+		{
+#ifdef DEBUG_SEARCH_CACHE
+			std::cerr << "LocalSearchCache: dropping entry with " << it->results.size() << " results" << std::endl;
+#endif
+			std::list<Entry>::iterator tmp(it) ;
+			++it ;
+			removeEntry(tmp) ;
+		}
+		else
+			++it ;
+	}
+}
+
+void LocalSearchCache::clear()
+{
+	mEntries.clear() ;
+	mKeys.clear() ;
+	mMemory = 0 ;
+	++mGeneration ;
+}
+
+void LocalSearchCache::removeEntry(std::list<Entry>::iterator it)
+{
+	mMemory -= it->memory ;
+	mKeys.erase(it->key) ;
+	mEntries.erase(it) ;
+}
+
+void LocalSearchCache::getStatistics(SearchCacheStats& stats) const
+{
+	stats.hits = mHits ;
+	stats.misses = mMisses ;
+	stats.cpu_saved_us = mCpuSavedUs ;
+	stats.entries = mEntries.size() ;
+	stats.memory_usage = mMemory ;
+}
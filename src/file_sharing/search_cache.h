@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * libretroshare/src/file_sharing: search_cache.h                              *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+#include <functional>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "retroshare/rsexpr.h"
+#include "retroshare/rsfiles.h"
+#include "file_sharing/directory_storage.h"
+
+/*!
+ * \brief The LocalSearchCache class
+ * 		Keeps the results of recent searches in the local shared files. Turtle searches are flooded over the network,
+ * 		so the same search reaches us many times through different friends, and each time costs a sweep over
+ * 		all shared files.
+ *
+ * 		Entries are keyed by the normalised search and the permission class of the requester (permission flags and
+ * 		client peer, which is null for all turtle searches). They are dropped when one of the files they return
+ * 		changes, or when a changed file would now be found, see invalidate(). The memory used by entries is bounded,
+ * 		least recently used entries go first.
+ *
+ * 		Not thread safe. p3FileDatabase uses it under its own mutex.
+ */
+class LocalSearchCache
+{
+public:
+	typedef DirectoryStorage::EntryIndex EntryIndex ;
+
+	// What the files of an entry were matched against, to test changed files.
+
+	struct Search
+	{
+		Search() : keywords(false) {}
+
+		bool keywords ;
+		std::list<std::string> terms ;				// keyword searches: file names containing any of the terms
+		RsRegularExpression::CompiledExpression exp ;	// other searches
+	};
+
+	explicit LocalSearchCache(size_t max_memory) ;
+
+	// Keys. Keyword searches ignore case and the order of the keywords.
+
+	static std::string makeKey(const std::list<std::string>& keywords,FileSearchFlags flags,const RsPeerId& peer_id) ;
+	static std::string makeKey(const RsRegularExpression::Expression& exp,FileSearchFlags flags,const RsPeerId& peer_id) ;
+
+	/*!
+	 * \brief get
+	 * 			Looks for the results of a previous search. Counts a hit or a miss.
+	 * \return false if the search is not cached
+	 */
+	bool get(const std::string& key,std::list<DirDetails>& results) ;
+
+	// Changes each time entries may have been invalidated. Searches started before that may have missed the change.
+
+	uint32_t generation() const { return mGeneration ; }
+
+	/*!
+	 * \brief put
+	 * 			Caches the results of a search. Results bigger than a fraction of the cache are not kept, and neither
+	 * 			are results of a search started before an invalidation.
+	 * \param generation	value of generation() when the search started
+	 * \param search		what the files were matched against
+	 * \param files			indexes of the files before filtering, in any order
+	 * \param results		results given to the caller
+	 * \param search_time_us	time the search took, counted as saved on each hit
+	 */
+	void put(const std::string& key,uint32_t generation,const Search& search,const std::list<EntryIndex>& files,const std::list<DirDetails>& results,uint64_t search_time_us) ;
+
+	/*!
+	 * \brief invalidate
+	 * 			Drops the entries that return one of the changed files, and the ones for which matches() tells that
+	 * 			a changed file is found now.
+	 */
+	void invalidate(const std::set<EntryIndex>& changed,const std::function<bool(EntryIndex,const Search&)>& matches) ;
+
+	void clear() ;
+
+	void getStatistics(SearchCacheStats& stats) const ;
+
+private:
+	struct Entry
+	{
+		std::string key ;
+		Search search ;
+		std::vector<EntryIndex> files ;			// sorted
+		std::list<DirDetails> results ;
+		uint64_t search_time_us ;
+		size_t memory ;
+	};
+
+	void removeEntry(std::list<Entry>::iterator it) ;
+
+	std::list<Entry> mEntries ;		// most recently used first
+	std::map<std::string,std::list<Entry>::iterator> mKeys ;
+
+	size_t mMaxMemory ;
+	size_t mMemory ;
+	uint32_t mGeneration ;
+
+	uint64_t mHits ;
+	uint64_t mMisses ;
+	uint64_t mCpuSavedUs ;
+};
@@ -46,6 +46,7 @@
 #include "ft/ftsearch.h"
 #include "ft/ftdatamultiplex.h"
 #include "ft/ftextralist.h"
+#include "ft/ftfilemover.h"
 #include "ft/ftserver.h"
 
 #include "turtle/p3turtle.h"
@@ -102,6 +103,7 @@ ftController::ftController(ftDataMultiplex *dm, p3ServiceControl *sc, uint32_t f
     mExtraList(NULL),
     mTurtle(NULL),
     mFtServer(NULL),
+    mFileMover(NULL),
     mServiceCtrl(sc),
     mFtServiceType(ftServiceId),
     mFilePermDirectDLPolicy(RS_FILE_PERM_DIRECT_DL_PER_USER),
@@ -118,6 +120,7 @@ ftController::ftController(ftDataMultiplex *dm, p3ServiceControl *sc, uint32_t f
 
 void ftController::setTurtleRouter(p3turtle *pt) { mTurtle = pt ; }
 void ftController::setFtServer(ftServer *ft) { mFtServer = ft ; }
+void ftController::setFileMover(ftFileMover *fm) { mFileMover = fm ; }
 
 void ftController::setFtSearchNExtra(ftSearch *search, ftExtraList *list)
 {
@@ -268,6 +271,8 @@ void ftController::threadTick()
 				completeFile(*it);
 		}
 
+		checkFinishedMoves() ;
+
 		if(cnt++ % 10 == 0)
 			checkDownloadQueue() ;
 }
@@ -651,11 +656,9 @@ bool ftController::completeFile(const RsFileHash& hash)
 {
 	/* variables... so we can drop mutex later */
 	std::string path;
-	std::string name;
 	uint64_t    size = 0;
-    uint32_t    period = 0;
 	TransferRequestFlags flags ;
-	TransferRequestFlags extraflags ;
+	bool moving = false ;
 
 	{
 		RS_STACK_MUTEX(ctrlMutex);
@@ -755,7 +758,17 @@ bool ftController::completeFile(const RsFileHash& hash)
 
                 std::cerr << "CompleteFile(): 2 - renaming/copying " << intermediate_file_name << " into " << destination_file_name << std::endl;
 
-                if(RsDirUtil::moveFile(intermediate_file_name,destination_file_name) )
+				// Copying to another file system takes long, the file mover does it while transfers go on.
+				// The file is published once it is at its destination, see checkFinishedMoves().
+
+				if(mFileMover)
+				{
+					fc->mState = ftFileControl::MOVING;
+					fc->mDestination = destination_file_name;	// saved by saveList() until the move is done
+					mFileMover->queueMove(fc->mHash, intermediate_file_name, destination_file_name, fc->mSize);
+					moving = true;
+				}
+                else if(RsDirUtil::moveFile(intermediate_file_name,destination_file_name) )
                     fc->mCurrentPath = destination_file_name;
 				else
 					fc->mState = ftFileControl::ERROR_COMPLETION;
@@ -766,11 +779,7 @@ bool ftController::completeFile(const RsFileHash& hash)
 
 		/* for extralist additions */
         path    = destination_file_name;
-		name    = fc->mName;
-		//hash    = fc->mHash;
 		size    = fc->mSize;
-		period  = 30 * 24 * 3600; /* 30 days */
-		extraflags.clear() ;
 
 #ifdef CONTROL_DEBUG
 		std::cerr << "CompleteFile(): size = " << size << std::endl ;
@@ -795,6 +804,64 @@ bool ftController::completeFile(const RsFileHash& hash)
 	 * cos Callback can end up back in this class.
 	 ***********************************************************/
 
+	if(!moving)
+		publishCompletedFile(hash, path, size, flags) ;
+
+	return true;
+}
+
+void ftController::checkFinishedMoves()
+{
+	if(!mFileMover)
+		return ;
+
+	std::list<ftFileMover::Move> moves ;
+	mFileMover->getFinishedMoves(moves) ;
+
+	for(std::list<ftFileMover::Move>::const_iterator it(moves.begin()); it != moves.end(); ++it)
+	{
+		TransferRequestFlags flags ;
+		std::string path ;
+		{
+			RS_STACK_MUTEX(ctrlMutex);
+
+			std::map<RsFileHash, ftFileControl*>::iterator fit = mCompleted.find(it->hash);
+
+			if(fit == mCompleted.end())
+				continue ;
+
+			ftFileControl *fc = fit->second ;
+
+			if(it->ok)
+			{
+				fc->mCurrentPath = it->destination ;
+				fc->mState = ftFileControl::COMPLETED ;
+			}
+			else
+			{
+				RsWarn() << "ftController: could not move " << it->source << " to " << it->destination << ". The file is kept where it is." << std::endl;
+
+				fc->mCurrentPath = it->source ;
+				fc->mState = ftFileControl::ERROR_COMPLETION ;
+			}
+			flags = fc->mFlags ;
+			path = fc->mCurrentPath ;
+		}
+
+		publishCompletedFile(it->hash, path, it->size, flags) ;
+	}
+}
+
+bool ftController::getFileMoveProgress(const RsFileHash& hash, uint64_t& moved, uint64_t& total)
+{
+	return mFileMover && mFileMover->getProgress(hash, moved, total) ;
+}
+
+void ftController::publishCompletedFile(const RsFileHash& hash, const std::string& path, uint64_t size, TransferRequestFlags flags)
+{
+	uint32_t period = 30 * 24 * 3600; /* 30 days */
+	TransferRequestFlags extraflags ;
+
 	/* If it has a callback - do it now */
 
     if(flags & RS_FILE_REQ_EXTRA)// | RS_FILE_HINTS_MEDIA))
@@ -824,10 +891,34 @@ bool ftController::completeFile(const RsFileHash& hash)
         rsEvents->postEvent(ev);
     }
 
-    rsFiles->ForceDirectoryCheck(true) ;
+    if(rsFiles)
+        rsFiles->ForceDirectoryCheck(true) ;
 
     IndicateConfigChanged(RsConfigMgr::CheckPriority::SAVE_NOW); /* completed transfer -> save */
-	return true;
+}
+
+void ftController::requeueMove(const RsFileHash& hash, const std::string& source, const std::string& destination, uint64_t size, TransferRequestFlags flags)
+{
+	RS_STACK_MUTEX(ctrlMutex);
+
+	if(mDownloads.find(hash) != mDownloads.end() || mCompleted.find(hash) != mCompleted.end())
+		return ;
+
+	ftFileControl *fc = new ftFileControl(RsDirUtil::getFileName(destination), source, destination, size, hash, flags, NULL, NULL);
+	mCompleted[hash] = fc ;
+
+	if(mFileMover)
+	{
+		fc->mState = ftFileControl::MOVING;
+		mFileMover->queueMove(hash, source, destination, size);
+	}
+	else if(RsDirUtil::moveFile(source, destination))
+	{
+		fc->mState = ftFileControl::COMPLETED;
+		fc->mCurrentPath = destination;
+	}
+	else
+		fc->mState = ftFileControl::ERROR_COMPLETION;
 }
 
 	/***************************************************************/
@@ -1291,6 +1382,11 @@ bool 	ftController::FileCancel(const RsFileHash& hash)
         std::map<RsFileHash,ftFileControl*>::iterator mit=mDownloads.find(hash);
 		if (mit==mDownloads.end())
 		{
+			// Complete files being moved: leave them where they are
+			mit = mCompleted.find(hash);
+			if (mit != mCompleted.end() && mit->second->mState == ftFileControl::MOVING && mFileMover)
+				return mFileMover->cancelMove(hash);
+
 #ifdef CONTROL_DEBUG
 			std::cerr<<"ftController::FileCancel file is not found in mDownloads"<<std::endl;
 #endif
@@ -1411,10 +1507,15 @@ bool ftController::FileClearCompleted()
 	{
 		RS_STACK_MUTEX(ctrlMutex);
 
-		for(auto it(mCompleted.begin()); it != mCompleted.end(); ++it)
-			delete it->second;
-
-		mCompleted.clear();
+		// Files still being moved are not published yet, keep them
+		for(auto it(mCompleted.begin()); it != mCompleted.end();)
+			if(it->second->mState == ftFileControl::MOVING)
+				++it;
+			else
+			{
+				delete it->second;
+				it = mCompleted.erase(it);
+			}
 
         IndicateConfigChanged();	// if we restart, completed transfers are lost, so no need to urgently save anything.
 	}
@@ -1706,6 +1807,9 @@ bool 	ftController::FileDetails(const RsFileHash &hash, FileInfo &info)
 	if((!completed) && it->second->mTransfer->isCheckingHash())
 		info.downloadStatus = FT_STATE_CHECKING_HASH ;
 
+	if(completed && it->second->mState == ftFileControl::MOVING)
+		info.downloadStatus = FT_STATE_MOVING ;
+
 	info.tfRate = totalRate;
 	info.size = (it->second)->mSize;
 
@@ -1977,6 +2081,30 @@ bool ftController::saveList(bool &cleanup, std::list<RsItem *>& saveData)
 		saveData.push_back(rft);
 	}
 
+	{
+		/* Save complete files still being moved to their destination. The
+		 * move is done again at next start, see requeueMove().
+		 */
+		RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
+
+		for(std::map<RsFileHash, ftFileControl*>::const_iterator cit(mCompleted.begin()); cit != mCompleted.end(); ++cit)
+			if(cit->second->mState == ftFileControl::MOVING)
+			{
+				RsFileTransfer *rft = new RsFileTransfer();
+
+				/* file.path is where the file is now, file.name the full path it goes to */
+				rft->file.name = cit->second->mDestination;
+				rft->file.path = cit->second->mCurrentPath;
+				rft->file.hash = cit->second->mHash;
+				rft->file.filesize = cit->second->mSize;
+				rft->flags = cit->second->mFlags.toUInt32();
+				rft->state = ftFileControl::MOVING;
+				rft->transferred = cit->second->mSize;
+
+				saveData.push_back(rft);
+			}
+	}
+
 	{
 		/* Save pending list of downloads */
 		RsStackMutex stack(ctrlMutex); /******* LOCKED ********/
@@ -2060,6 +2188,11 @@ bool ftController::loadList(std::list<RsItem *>& load)
 			loadConfigMap(configMap);
 
 		}
+		else if (NULL != (rsft = dynamic_cast<RsFileTransfer *>(*it)) && rsft->state == ftFileControl::MOVING)
+		{
+			/* complete file that was being moved, see saveList() */
+			requeueMove(rsft->file.hash, rsft->file.path, rsft->file.name, rsft->file.filesize, TransferRequestFlags(rsft->flags));
+		}
 		else if (NULL != (rsft = dynamic_cast<RsFileTransfer *>(*it)))
 		{
 			/* This will get stored on a waiting list - until the
@@ -42,6 +42,7 @@ class ftSearch;
 class ftServer;
 class ftExtraList;
 class ftDataMultiplex;
+class ftFileMover;
 class p3turtle ;
 class p3ServiceControl;
 
@@ -66,7 +67,8 @@ class ftFileControl
 					ERROR_COMPLETION = 2, 
 					QUEUED           = 3,
 					PAUSED           = 4,
-					CHECKING_HASH    = 5
+					CHECKING_HASH    = 5,
+					MOVING           = 6	/* complete, being moved to its destination */
 		};
 
 		ftFileControl();
@@ -120,6 +122,7 @@ public:
 		void	setFtSearchNExtra(ftSearch *, ftExtraList *);
 		void	setTurtleRouter(p3turtle *) ;
 		void	setFtServer(ftServer *) ;
+		void	setFileMover(ftFileMover *) ;
 		bool    activate();
 		bool 	isActiveAndNoPending();
 
@@ -155,6 +158,7 @@ public:
         bool 	FileControl(const RsFileHash& hash, uint32_t flags);
 		bool 	FileClearCompleted();
         bool 	FlagFileComplete(const RsFileHash& hash);
+        bool  getFileMoveProgress(const RsFileHash& hash, uint64_t& moved, uint64_t& total);
         bool  getFileDownloadChunksDetails(const RsFileHash& hash,FileChunksInfo& info);
         bool  setDestinationName(const RsFileHash& hash,const std::string& dest_name) ;
         bool  setDestinationDirectory(const RsFileHash& hash,const std::string& dest_name) ;
@@ -199,6 +203,7 @@ public:
 
 		void searchForDirectSources() ;
 		void tickTransfers() ;
+		void checkFinishedMoves() ;
 
 		/***************************************************************/
 		/********************** Controller Access **********************/
@@ -224,6 +229,8 @@ public:
 		void  locked_swapQueue(uint32_t pos1,uint32_t pos2) ; 	// swap position of the two elements
 
         bool 	completeFile(const RsFileHash& hash);
+		void    publishCompletedFile(const RsFileHash& hash, const std::string& path, uint64_t size, TransferRequestFlags flags);
+		void    requeueMove(const RsFileHash& hash, const std::string& source, const std::string& destination, uint64_t size, TransferRequestFlags flags);
 		bool    handleAPendingRequest();
 
 		bool    setPeerState(ftTransferModule *tm, const RsPeerId& id,
@@ -238,6 +245,7 @@ public:
 		ftExtraList *mExtraList;
 		p3turtle *mTurtle ;
 		ftServer *mFtServer ;
+		ftFileMover *mFileMover ;
 		p3ServiceControl *mServiceCtrl;
 		uint32_t mFtServiceType;
 		uint32_t mFilePermDirectDLPolicy;
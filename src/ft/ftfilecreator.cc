@@ -20,10 +20,18 @@
  *                                                                             *
  *******************************************************************************/
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstdio>
+#include <cstring>
 #include <sys/stat.h>
 
+#ifndef WINDOWS_SYS
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
+
 #include "ftfilecreator.h"
 #include "util/rstime.h"
 #include "util/rsdiscspace.h"
@@ -42,6 +50,16 @@
 #define CHUNK_MAX_AGE           120
 #define MAX_FTCHUNKS_PER_PEER    40
 
+// Received data of a file is written once that much is buffered. Completed chunks are checked
+// against their CRC shortly after, so this also saves reading them back from the file.
+//
+static const uint32_t WRITE_BUFFER_MAX_SIZE = 4*ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE ;
+
+static std::atomic<uint64_t> write_stats_slices(0) ;
+static std::atomic<uint64_t> write_stats_bytes(0) ;
+static std::atomic<uint64_t> write_stats_calls(0) ;
+static std::atomic<uint64_t> write_stats_buffered_checks(0) ;
+
 /***********************************************************
 *
 *	ftFileCreator methods
@@ -49,7 +67,7 @@
 ***********************************************************/
 
 ftFileCreator::ftFileCreator(const std::string& path, uint64_t size, const RsFileHash& hash,bool assume_availability)
-	: ftFileProvider(path,size,hash), chunkMap(size,assume_availability)
+	: ftFileProvider(path,size,hash), chunkMap(size,assume_availability), mWriteBufferedBytes(0)
 {
 	/* 
          * FIXME any inits to do?
@@ -102,6 +120,12 @@ bool ftFileCreator::getFileData(const RsPeerId& peer_id,uint64_t offset, uint32_
 
 		have_it = chunkMap.isChunkAvailable(offset, chunk_size) ;
 
+		// The data may still be in the write buffers. The file is also opened here rather
+		// than in ftFileProvider, so that it is not buffered by stdio.
+		//
+		if(have_it && (!locked_initializeFileAttrs() || !locked_flushWriteBuffers(offset,chunk_size)))
+			return false ;
+
 #define ENABLE_SLICES
 #ifdef ENABLE_SLICES
         // try if we have data from an incomplete or not veryfied chunk
@@ -130,6 +154,9 @@ bool ftFileCreator::getFileData(const RsPeerId& peer_id,uint64_t offset, uint32_
             // if not, we don't have it
             if(chunkMap.isChunkOutstanding(offset, chunk_size))
                 have_it = false;
+
+            if(have_it && (!locked_initializeFileAttrs() || !locked_flushWriteBuffers(offset,chunk_size)))
+                return false ;
         }
 #endif
 	}
@@ -163,6 +190,7 @@ void ftFileCreator::closeFile()
 
 	if(fd != NULL)
 	{
+		locked_flushWriteBuffers() ;
 #ifdef FILE_DEBUG
 		std::cerr << "CLOSED FILE " << (void*)fd << " (" << file_name << ")." << std::endl ;
 #endif
@@ -213,21 +241,10 @@ bool ftFileCreator::addFileData(uint64_t offset, uint32_t chunk_size, void *data
 		}
 
 		/* 
-		 * go to the offset of the file 
+		 * buffer the data. Adjacent slices are merged and written at once later.
 		 */
-		if (0 != fseeko64(this->fd, offset, SEEK_SET))
-		{
-			std::cerr << "ftFileCreator::addFileData() Bad fseek at offset " << offset << ", fd=" << (void*)(this->fd) << ", size=" << mSize << ", errno=" << errno << std::endl;
+		if (!locked_bufferData(offset, chunk_size, (const unsigned char*)data))
 			return 0;
-		}
-
-		if (1 != fwrite(data, chunk_size, 1, this->fd))
-		{
-			std::cerr << "ftFileCreator::addFileData() Bad fwrite." << std::endl;
-			std::cerr << "ERRNO: " << errno << std::endl;
-
-			return 0;
-		}
 
 #ifdef FILE_DEBUG
 		std::cerr << "ftFileCreator::addFileData() added Data...";
@@ -261,6 +278,9 @@ void ftFileCreator::removeInactiveChunks()
 {
 	RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
 
+	// Also called regularly on transfers that are stalled: don't keep their data in memory.
+	locked_flushWriteBuffers() ;
+
 #ifdef FILE_DEBUG
 	std::cerr << "ftFileCreator::removeInactiveChunks(): looking for old chunks." << std::endl ;
 #endif
@@ -360,8 +380,212 @@ int ftFileCreator::locked_initializeFileAttrs()
 	std::cerr << "OPENNED FILE " << (void*)fd << " (" << file_name << "), for r/w." << std::endl ;
 #endif
 
+	// Writes bypass stdio (see locked_writeData), so reads must not be buffered either.
+	setvbuf(fd, NULL, _IONBF, 0) ;
+
+#ifdef __linux__
+	// Allocate the whole file at once, so that chunks received in random order don't
+	// fragment it. This is a no-op for files that are already allocated.
+	//
+	if(mSize > 0 && fallocate(fileno(fd), 0, 0, mSize) != 0 && errno != EOPNOTSUPP)
+		std::cerr << "ftFileCreator::initializeFileAttrs() cannot preallocate " << mSize << " bytes for " << file_name << ", errno = " << errno << std::endl;
+#endif
+
 	return 1;
 }
+
+bool ftFileCreator::locked_bufferData(uint64_t offset, uint32_t size, const unsigned char *data)
+{
+	++write_stats_slices ;
+	write_stats_bytes += size ;
+
+	typedef std::map<uint64_t, std::vector<unsigned char> >::iterator BufferIterator ;
+
+	BufferIterator next = mWriteBuffers.upper_bound(offset) ;
+	BufferIterator it = mWriteBuffers.end() ;
+	bool overlaps = (next != mWriteBuffers.end() && next->first < offset + size) ;
+
+	if(next != mWriteBuffers.begin())
+	{
+		BufferIterator prev = next ;
+		--prev ;
+		uint64_t prev_end = prev->first + prev->second.size() ;
+
+		if(prev_end == offset)
+			it = prev ;
+		else if(prev_end > offset)
+			overlaps = true ;
+	}
+
+	// Data received twice, e.g. a slice that was asked again. Write the buffers first so that
+	// the last received data wins, as it did without buffers.
+	//
+	if(overlaps)
+	{
+		bool ok = locked_flushWriteBuffers(offset,size) ;
+		return locked_writeData(offset,size,data) && ok ;
+	}
+
+	if(it == mWriteBuffers.end())
+		it = mWriteBuffers.insert(std::make_pair(offset,std::vector<unsigned char>())).first ;
+
+	it->second.insert(it->second.end(),data,data+size) ;
+	mWriteBufferedBytes += size ;
+
+	// merge with the buffer that starts right after, if any
+	next = it ;
+	++next ;
+
+	if(next != mWriteBuffers.end() && next->first == it->first + it->second.size())
+	{
+		it->second.insert(it->second.end(),next->second.begin(),next->second.end()) ;
+		mWriteBuffers.erase(next) ;
+	}
+
+	if(mWriteBufferedBytes > WRITE_BUFFER_MAX_SIZE)
+		return locked_flushWriteBuffers() ;
+
+	return true ;
+}
+
+bool ftFileCreator::locked_flushWriteBuffers(uint64_t offset, uint64_t size)
+{
+	if(mWriteBuffers.empty())
+		return true ;
+
+	if(!locked_initializeFileAttrs())
+		return false ;
+
+	// buffers overlapping [offset,offset+size[
+	std::map<uint64_t, std::vector<unsigned char> >::iterator it = mWriteBuffers.upper_bound(offset) ;
+
+	if(it != mWriteBuffers.begin())
+	{
+		--it ;
+		if(it->first + it->second.size() <= offset)
+			++it ;
+	}
+	bool ok = true ;
+
+	while(it != mWriteBuffers.end() && (it->first <= offset || it->first - offset < size))
+	{
+		// On failure the data is dropped anyway. The chunks will not match the file hash, and be downloaded again.
+		ok = locked_writeData(it->first,it->second.size(),it->second.data()) && ok ;
+
+		mWriteBufferedBytes -= it->second.size() ;
+		mWriteBuffers.erase(it++) ;
+	}
+	return ok ;
+}
+
+bool ftFileCreator::locked_writeData(uint64_t offset, uint32_t size, const unsigned char *data)
+{
+#ifdef FILE_DEBUG
+	std::cerr << "ftFileCreator::locked_writeData() writing " << size << " bytes at offset " << offset << std::endl;
+#endif
+#ifdef WINDOWS_SYS
+	++write_stats_calls ;
+
+	if (0 != fseeko64(this->fd, offset, SEEK_SET))
+	{
+		std::cerr << "ftFileCreator::locked_writeData() Bad fseek at offset " << offset << ", fd=" << (void*)(this->fd) << ", size=" << mSize << ", errno=" << errno << std::endl;
+		return false;
+	}
+
+	if (1 != fwrite(data, size, 1, this->fd))
+	{
+		std::cerr << "ftFileCreator::locked_writeData() Bad fwrite." << std::endl;
+		std::cerr << "ERRNO: " << errno << std::endl;
+		return false;
+	}
+#else
+	while(size > 0)
+	{
+		++write_stats_calls ;
+		ssize_t n = pwrite(fileno(this->fd), data, size, offset) ;
+
+		if(n < 0 && errno == EINTR)
+			continue ;
+
+		if(n <= 0)
+		{
+			std::cerr << "ftFileCreator::locked_writeData() Bad pwrite at offset " << offset << ", fd=" << (void*)(this->fd) << ", size=" << mSize << ", errno=" << errno << std::endl;
+			return false;
+		}
+		data += n ;
+		offset += n ;
+		size -= n ;
+	}
+#endif
+	return true ;
+}
+
+bool ftFileCreator::locked_readData(uint64_t offset, uint32_t size, unsigned char *data)
+{
+	typedef std::map<uint64_t, std::vector<unsigned char> >::const_iterator BufferIterator ;
+
+	// buffers overlapping [offset,offset+size[, and how much of it they hold
+	BufferIterator first = mWriteBuffers.upper_bound(offset) ;
+
+	if(first != mWriteBuffers.begin())
+	{
+		--first ;
+		if(first->first + first->second.size() <= offset)
+			++first ;
+	}
+	uint64_t buffered = 0 ;
+
+	for(BufferIterator it(first);it!=mWriteBuffers.end() && it->first < offset + size;++it)
+		buffered += std::min(it->first + it->second.size(), offset + size) - std::max(it->first, offset) ;
+
+	// Only read the file when the buffers don't hold everything.
+	//
+	if(buffered < size)
+	{
+		uint32_t len = 0 ;
+#ifdef WINDOWS_SYS
+		if(0 != fseeko64(fd, offset, SEEK_SET))
+			return false ;
+
+		len = fread(data, 1, size, fd) ;
+#else
+		while(len < size)
+		{
+			ssize_t n = pread(fileno(fd), data + len, size - len, offset + len) ;
+
+			if(n < 0 && errno == EINTR)
+				continue ;
+			if(n < 0)
+				return false ;
+			if(n == 0)
+				break ;
+
+			len += n ;
+		}
+#endif
+		// parts never written yet
+		std::fill(data + len, data + size, 0) ;
+	}
+	else
+		++write_stats_buffered_checks ;
+
+	for(BufferIterator it(first);it!=mWriteBuffers.end() && it->first < offset + size;++it)
+	{
+		uint64_t start = std::max(it->first, offset) ;
+		uint64_t end = std::min(it->first + it->second.size(), offset + size) ;
+
+		memcpy(data + (start - offset), it->second.data() + (start - it->first), end - start) ;
+	}
+	return true ;
+}
+
+void ftFileCreator::getWriteStats(WriteStats& stats)
+{
+	stats.receivedSlices = write_stats_slices ;
+	stats.receivedBytes = write_stats_bytes ;
+	stats.writeCalls = write_stats_calls ;
+	stats.bufferedChunkChecks = write_stats_buffered_checks ;
+}
 ftFileCreator::~ftFileCreator()
 {
 #ifdef FILE_DEBUG
@@ -370,9 +594,9 @@ ftFileCreator::~ftFileCreator()
 
 	// Note: The file is actually closed in the parent, that is always a ftFileProvider.
 	//
-	/*
-	 * FIXME Any cleanups specific to filecreator?
-	 */
+	RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
+
+	locked_flushWriteBuffers() ;
 }
 
 
@@ -648,6 +872,9 @@ void ftFileCreator::getAvailabilityMap(CompressedChunkMap& map)
 {
 	RsStackMutex stack(ftcMutex); /********** STACK LOCKED MTX ******/
 
+	// The map is saved with the transfers, so it must never claim data that is not in the file yet.
+	locked_flushWriteBuffers() ;
+
 	chunkMap.getAvailabilityMap(map) ;
 }
 
@@ -733,10 +960,12 @@ bool ftFileCreator::verifyChunk(uint32_t chunk_number,const Sha1CheckSum& sum)
 		return false ;
 
 	static const uint32_t chunk_size = ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE ;
+	uint64_t offset = (uint64_t)chunk_number * (uint64_t)chunk_size ;
+	uint32_t len = (offset < mSize)? std::min((uint64_t)chunk_size, mSize - offset) : 0 ;
 	unsigned char *buff = new unsigned char[chunk_size] ;
-	uint32_t len ;
 
-	if(fseeko64(fd,(uint64_t)chunk_number * (uint64_t)chunk_size,SEEK_SET)==0 && (len = fread(buff,1,chunk_size,fd)) > 0)
+	// The chunk is read from the write buffers when its data is still there.
+	if(len > 0 && locked_readData(offset,len,buff))
 	{
 		Sha1CheckSum comp = RsDirUtil::sha1sum(buff,len) ;
 
@@ -750,10 +979,14 @@ bool ftFileCreator::verifyChunk(uint32_t chunk_number,const Sha1CheckSum& sum)
 
 			chunkMap.setChunkCheckingResult(chunk_number,false) ;
 		}
+
+		// the whole file is hashed next
+		if(chunkMap.isComplete())
+			locked_flushWriteBuffers() ;
 	}
 	else
 	{
-		printf("Chunk verification: cannot fseek!\n") ;
+		printf("Chunk verification: cannot read chunk!\n") ;
 		chunkMap.setChunkCheckingResult(chunk_number,false) ;
 	}
 
@@ -32,6 +32,7 @@
 #include "ftfileprovider.h"
 #include "ftchunkmap.h"
 #include <map>
+#include <vector>
 
 class ZeroInitCounter
 {
@@ -127,6 +128,18 @@ class ftFileCreator: public ftFileProvider
 		//
 		bool sourceIsComplete(const RsPeerId& peer_id) ;
 
+		// Counters of all file creators since start. Received data is buffered and adjacent
+		// slices are written at once, so that writeCalls per MB received stays low.
+		//
+		struct WriteStats
+		{
+			uint64_t receivedSlices ;
+			uint64_t receivedBytes ;
+			uint64_t writeCalls ;				/// write system calls to partial files
+			uint64_t bufferedChunkChecks ;		/// chunks verified without reading the file
+		};
+		static void getWriteStats(WriteStats& stats) ;
+
 	protected:
 
 		virtual int locked_initializeFileAttrs(); 
@@ -135,6 +148,11 @@ class ftFileCreator: public ftFileProvider
 
 		bool 	locked_printChunkMap();
 		int 	locked_notifyReceived(uint64_t offset, uint32_t chunk_size);
+
+		bool	locked_bufferData(uint64_t offset, uint32_t size, const unsigned char *data);
+		bool	locked_flushWriteBuffers(uint64_t offset = 0, uint64_t size = ~(uint64_t)0);
+		bool	locked_writeData(uint64_t offset, uint32_t size, const unsigned char *data);
+		bool	locked_readData(uint64_t offset, uint32_t size, unsigned char *data);
 		/* 
 		 * structure to track missing chunks 
 		 */
@@ -144,6 +162,14 @@ class ftFileCreator: public ftFileProvider
 
 		ChunkMap chunkMap ;
 
+		/*
+		 * write-behind buffers: received data not yet written to the file, by file offset.
+		 * Adjacent slices are merged, and written when too much is buffered, or before
+		 * anything reads the file or saves the chunk map.
+		 */
+		std::map<uint64_t, std::vector<unsigned char> > mWriteBuffers ;
+		uint32_t mWriteBufferedBytes ;
+
 		rstime_t _last_recv_time_t ;	/// last time stamp when data was received. Used for queue control.
 		rstime_t _creation_time ;		/// time at which the file creator was created. Used to spot long-inactive transfers.
 };
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * libretroshare/src/ft: ftfilemover.cc                                        *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include "ft/ftfilemover.h"
+#include "util/rsdebug.h"
+#include "util/rsdir.h"
+
+/****
+ * #define DEBUG_FILE_MOVER 1
+ ****/
+
+ftFileMover::ftFileMover()
+    : mCurrentSize(0), mCurrentMoved(0), mCancelCurrent(false)
+{
+}
+
+void ftFileMover::queueMove(const RsFileHash& hash, const std::string& source, const std::string& destination, uint64_t size)
+{
+	Move move;
+	move.hash = hash;
+	move.source = source;
+	move.destination = destination;
+	move.size = size;
+
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+		mPending.push_back(move);
+	}
+	mCond.notify_one();
+}
+
+bool ftFileMover::cancelMove(const RsFileHash& hash)
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+
+	if(!mCurrentHash.isNull() && mCurrentHash == hash)
+	{
+		mCancelCurrent = true;
+		return true;
+	}
+
+	for(std::list<Move>::iterator it(mPending.begin()); it != mPending.end(); ++it)
+		if(it->hash == hash)
+		{
+			mFinished.push_back(*it);
+			mPending.erase(it);
+			return true;
+		}
+
+	return false;
+}
+
+bool ftFileMover::getProgress(const RsFileHash& hash, uint64_t& moved, uint64_t& total)
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+
+	if(!mCurrentHash.isNull() && mCurrentHash == hash)
+	{
+		moved = mCurrentMoved;
+		total = mCurrentSize;
+		return true;
+	}
+
+	for(std::list<Move>::const_iterator it(mPending.begin()); it != mPending.end(); ++it)
+		if(it->hash == hash)
+		{
+			moved = 0;
+			total = it->size;
+			return true;
+		}
+
+	return false;
+}
+
+void ftFileMover::getFinishedMoves(std::list<Move>& moves)
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+	moves.splice(moves.end(), mFinished);
+}
+
+void ftFileMover::onStopRequested()
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+	mCond.notify_all();
+}
+
+void ftFileMover::run()
+{
+	while(!shouldStop())
+	{
+		Move move;
+		{
+			std::unique_lock<std::mutex> lock(mMtx);
+
+			while(mPending.empty() && !shouldStop())
+				mCond.wait(lock);
+
+			if(shouldStop())
+				break;
+
+			move = mPending.front();
+			mPending.pop_front();
+
+			mCurrentHash = move.hash;
+			mCurrentSize = move.size;
+			mCurrentMoved = 0;
+			mCancelCurrent = false;
+		}
+
+		move.ok = moveFile(move);
+
+		std::unique_lock<std::mutex> lock(mMtx);
+		mCurrentHash.clear();
+		mFinished.push_back(move);
+	}
+
+	// The files of abandoned moves are still complete, at their source path.
+
+	std::unique_lock<std::mutex> lock(mMtx);
+
+	for(std::list<Move>::const_iterator it(mPending.begin()); it != mPending.end(); ++it)
+		RsWarn() << "ftFileMover: stopped before moving " << it->source << " to " << it->destination << std::endl;
+}
+
+bool ftFileMover::moveFile(const Move& move)
+{
+#ifdef DEBUG_FILE_MOVER
+	RsDbg() << "ftFileMover: moving " << move.source << " to " << move.destination << std::endl;
+#endif
+	// A rename when on the same file system, a copy otherwise
+
+	bool ok = RsDirUtil::moveFile( move.source, move.destination,
+	                               [this](uint64_t copied, uint64_t)
+	{
+		mCurrentMoved = copied;
+		return !mCancelCurrent && !shouldStop();
+	} );
+
+	if(!ok)
+	{
+		if(mCancelCurrent || shouldStop())
+			RsInfo() << "ftFileMover: abandoned moving " << move.source << " to " << move.destination << std::endl;
+		else
+			RsErr() << "ftFileMover: cannot move " << move.source << " to " << move.destination << ". Disk full?" << std::endl;
+
+		return false;
+	}
+
+	mCurrentMoved = move.size;
+
+#ifdef DEBUG_FILE_MOVER
+	RsDbg() << "ftFileMover: moved " << move.size << " bytes to " << move.destination << std::endl;
+#endif
+	return true;
+}
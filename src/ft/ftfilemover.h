@@ -0,0 +1,96 @@
+/*******************************************************************************
+ * libretroshare/src/ft: ftfilemover.h                                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+/*
+ * ftFileMover
+ *
+ * Moves completed downloads to their destination on a thread of its own.
+ *
+ * When the destination is on the same file system the move is a rename, but
+ * otherwise the whole file has to be copied, which takes minutes for big
+ * files. The controller queues the moves here and keeps ticking transfers in
+ * the meantime, then collects the finished moves with getFinishedMoves().
+ *
+ * Moves are done one at a time, in order.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+
+#include "retroshare/rstypes.h"
+#include "util/rsthreads.h"
+
+class ftFileMover: public RsThread
+{
+public:
+	struct Move
+	{
+		Move() : size(0), ok(false) {}
+
+		RsFileHash hash;
+		std::string source;
+		std::string destination;
+		uint64_t size;
+		bool ok;	/// set when finished. On failure the file is still at source.
+	};
+
+	ftFileMover();
+
+	/// Queue moving source to destination. The destination directory is created if needed.
+	void queueMove(const RsFileHash& hash, const std::string& source, const std::string& destination, uint64_t size);
+
+	/**
+	 * @brief Abandon a queued or running move. It is still reported by
+	 * getFinishedMoves(), as failed, and the file stays at source.
+	 * @return false if the file is not being moved
+	 */
+	bool cancelMove(const RsFileHash& hash);
+
+	/// @return false if the file is not being moved
+	bool getProgress(const RsFileHash& hash, uint64_t& moved, uint64_t& total);
+
+	/// Moves finished since the last call, successfully or not
+	void getFinishedMoves(std::list<Move>& moves);
+
+protected:
+	void run() override; /// @see RsThread
+	void onStopRequested() override; /// @see RsThread
+
+private:
+	bool moveFile(const Move& move);
+
+	std::mutex mMtx;
+	std::condition_variable mCond;
+
+	std::list<Move> mPending;
+	std::list<Move> mFinished;
+
+	/* current move */
+	RsFileHash mCurrentHash;
+	uint64_t mCurrentSize;
+	std::atomic<uint64_t> mCurrentMoved;
+	std::atomic<bool> mCancelCurrent;
+};
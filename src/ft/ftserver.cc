@@ -35,6 +35,7 @@
 #include "ft/ftdatamultiplex.h"
 //#include "ft/ftdwlqueue.h"
 #include "ft/ftextralist.h"
+#include "ft/ftfilemover.h"
 #include "ft/ftfileprovider.h"
 #include "ft/ftfilesearch.h"
 #include "ft/ftserver.h"
@@ -105,7 +106,7 @@ ftServer::ftServer(p3PeerMgr *pm, p3ServiceControl *sc):
     RsServiceSerializer(RS_SERVICE_TYPE_TURTLE),
       mPeerMgr(pm), mServiceCtrl(sc),
       mFileDatabase(NULL),
-      mFtController(NULL), mFtExtra(NULL),
+      mFtController(NULL), mFtExtra(NULL), mFtMover(NULL),
       mFtDataplex(NULL), mFtSearch(NULL), srvMutex("ftServer"),
       mSearchCallbacksMapMutex("ftServer callbacks map")
 {
@@ -172,6 +173,10 @@ void ftServer::SetupFtServer()
 	mFtController = new ftController(mFtDataplex, mServiceCtrl, getServiceInfo().mServiceType);
 	mFtController -> setFtSearchNExtra(mFtSearch, mFtExtra);
 
+	/* moves completed files out of the controller thread */
+	mFtMover = new ftFileMover();
+	mFtController -> setFileMover(mFtMover);
+
 	std::string emergencySaveDir = RsAccounts::AccountDirectory();
 	std::string emergencyPartialsDir = RsAccounts::AccountDirectory();
 
@@ -228,6 +233,7 @@ void    ftServer::StartupThreads()
 
 	/* Controller thread */
 	mFtController->start("ft ctrl");
+	mFtMover->start("ft mover");
 
 	/* Dataplex */
 	mFtDataplex->start("ft dataplex");
@@ -241,6 +247,9 @@ void ftServer::StopThreads()
 	/* stop Controller thread */
 	mFtController->fullstop();
 
+	/* stop moving completed files, they stay in the partials directory */
+	mFtMover->fullstop();
+
 	/* self contained threads */
 	/* stop ExtraList Thread */
 	mFtExtra->fullstop();
@@ -251,6 +260,9 @@ void ftServer::StopThreads()
 	delete (mFtController);
 	mFtController = nullptr;
 
+	delete (mFtMover);
+	mFtMover = nullptr;
+
 	delete (mFtExtra);
 	mFtExtra = nullptr;
 
@@ -476,6 +488,11 @@ bool ftServer::FileCancel(const RsFileHash& hash)
 	return true ;
 }
 
+bool ftServer::FileMoveProgress(const RsFileHash& hash, uint64_t& movedBytes, uint64_t& totalBytes)
+{
+	return mFtController->getFileMoveProgress(hash, movedBytes, totalBytes);
+}
+
 bool ftServer::FileControl(const RsFileHash& hash, uint32_t flags)
 {
 	return mFtController->FileControl(hash, flags);
@@ -868,6 +885,10 @@ int ftServer::getSharedDirStatistics(const RsPeerId& pid, SharedDirStats& stats)
 {
     return mFileDatabase->getSharedDirStatistics(pid,stats) ;
 }
+void ftServer::getSearchCacheStatistics(SearchCacheStats& stats)
+{
+	mFileDatabase->getSearchCacheStatistics(stats);
+}
 
 /***************************************************************/
 /*************** Local Shared Dir Interface ********************/
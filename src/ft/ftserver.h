@@ -59,6 +59,7 @@ class ftFiMonitor;
 
 class ftController;
 class ftExtraList;
+class ftFileMover;
 class ftFileSearch;
 
 class ftDataMultiplex;
@@ -190,6 +191,7 @@ public:
     virtual bool alreadyHaveFile(const RsFileHash& hash, FileInfo &info) override;
     virtual bool FileRequest(const std::string& fname, const RsFileHash& hash, uint64_t size, const std::string& dest, TransferRequestFlags flags, const std::list<RsPeerId>& srcIds) override;
     virtual bool FileCancel(const RsFileHash& hash) override;
+    virtual bool FileMoveProgress(const RsFileHash& hash, uint64_t& movedBytes, uint64_t& totalBytes) override;
     virtual bool FileControl(const RsFileHash& hash, uint32_t flags) override;
     virtual bool FileClearCompleted() override;
     virtual bool setDestinationDirectory(const RsFileHash& hash,const std::string& new_path)  override;
@@ -291,6 +293,7 @@ public:
     virtual int SearchBoolExp(RsRegularExpression::Expression * exp, std::list<DirDetails> &results,FileSearchFlags flags) override;
     virtual int SearchBoolExp(RsRegularExpression::Expression * exp, std::list<DirDetails> &results,FileSearchFlags flags,const RsPeerId& peer_id) override;
     virtual int getSharedDirStatistics(const RsPeerId& pid, SharedDirStats& stats)  override;
+    virtual void getSearchCacheStatistics(SearchCacheStats& stats) override;
 
     virtual int banFile(const RsFileHash& real_file_hash, const std::string& filename, uint64_t file_size)  override;
     virtual int unbanFile(const RsFileHash& real_file_hash) override;
@@ -414,6 +417,7 @@ private:
     p3FileDatabase   *mFileDatabase ;
     ftController     *mFtController;
     ftExtraList      *mFtExtra;
+    ftFileMover      *mFtMover;
     ftDataMultiplex  *mFtDataplex;
     p3turtle         *mTurtleRouter ;
     ftFileSearch     *mFtSearch;
@@ -24,8 +24,13 @@
 #include "pqi/authgpg.h"
 #include "util/rsdir.h"
 #include "util/rsmemory.h"
+#include "util/rsrandom.h"
+#include "util/rsthreads.h"
 //#include "retroshare/rspeers.h"
 
+#include <atomic>
+#include <map>
+
 /****
  * #define GXS_SECURITY_DEBUG 	1
  ***/
@@ -34,6 +39,16 @@ static const uint32_t MULTI_ENCRYPTION_FORMAT_v001_HEADER              = 0xFACE;
 static const uint32_t MULTI_ENCRYPTION_FORMAT_v001_HEADER_SIZE         = 2 ;
 static const uint32_t MULTI_ENCRYPTION_FORMAT_v001_NUMBER_OF_KEYS_SIZE = 2 ;
 static const uint32_t MULTI_ENCRYPTION_FORMAT_v001_ENCRYPTED_KEY_SIZE  = 256 ;
+
+// Same as v001, with a hint of the recipient key id before the encrypted keys. Hints are salted per message, so that
+// they cannot be matched against known key ids nor linked between messages.
+static const uint32_t MULTI_ENCRYPTION_FORMAT_v002_HEADER              = 0xFACF;
+static const uint32_t MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SALT_SIZE  = 8 ;
+static const uint32_t MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SIZE       = 8 ;
+
+static std::atomic<uint64_t> multi_encryption_key_wraps(0) ;
+static std::atomic<uint64_t> multi_encryption_unwrap_attempts(0) ;
+static std::atomic<uint64_t> multi_encryption_unwraps_skipped(0) ;
         
 static RsGxsId getRsaKeyFingerprint_old_insecure_method(RSA *pubkey)
 {
@@ -141,6 +156,139 @@ static void setRSAPrivateKeyData(RsTlvPrivateRSAKey& key, RSA *rsa_priv)
 
 	free(data) ;
 }
+
+/* Cache of parsed public keys.
+ * Most signatures come from a small set of identities and groups, and parsing
+ * the DER key data then computing the Montgomery context of the modulus (done
+ * by OpenSSL at the first use of the key, and kept in the key afterwards) costs
+ * about as much as checking the signature itself. Keys are identified by their
+ * id and the hash of their data, so that a different key published with the
+ * same id never gets the cached one. The least recently used key is dropped
+ * when the cache is full.
+ */
+
+static const uint32_t PUBLIC_KEY_CACHE_MAX_SIZE = 1024 ;
+
+struct CachedPublicKey
+{
+	EVP_PKEY *key ;
+	uint64_t last_used ;
+};
+
+static RsMutex public_key_cache_mtx("GxsSecurity public key cache") ;
+static std::map<std::pair<RsGxsId,Sha1CheckSum>,CachedPublicKey> public_key_cache ;
+static uint64_t public_key_cache_counter = 0 ;
+
+static std::atomic<uint64_t> public_key_cache_hits(0) ;
+static std::atomic<uint64_t> public_key_cache_misses(0) ;
+
+static void upRefPublicKey(EVP_PKEY *key)
+{
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+	CRYPTO_add(&key->references, 1, CRYPTO_LOCK_EVP_PKEY) ;
+#else
+	EVP_PKEY_up_ref(key) ;
+#endif
+}
+
+// Returns a new reference to the parsed key, to release with EVP_PKEY_free(), or NULL if the key data is invalid.
+
+static EVP_PKEY *getCachedPublicKey(const RsTlvPublicRSAKey& key)
+{
+	std::pair<RsGxsId,Sha1CheckSum> id(key.keyId,RsDirUtil::sha1sum((const uint8_t*)key.keyData.bin_data,key.keyData.bin_len)) ;
+
+	{
+		RS_STACK_MUTEX(public_key_cache_mtx) ;
+
+		std::map<std::pair<RsGxsId,Sha1CheckSum>,CachedPublicKey>::iterator it = public_key_cache.find(id) ;
+
+		if(it != public_key_cache.end())
+		{
+			it->second.last_used = ++public_key_cache_counter ;
+			upRefPublicKey(it->second.key) ;
+			++public_key_cache_hits ;
+			return it->second.key ;
+		}
+	}
+	++public_key_cache_misses ;
+
+	// Parse outside of the lock. Two threads may parse the same key, only one gets in the cache.
+
+	RSA *rsakey = ::extractPublicKey(key) ;
+
+	if(!rsakey)
+		return NULL ;
+
+	EVP_PKEY *pkey = EVP_PKEY_new() ;
+	EVP_PKEY_assign_RSA(pkey, rsakey) ;
+
+	RS_STACK_MUTEX(public_key_cache_mtx) ;
+
+	CachedPublicKey entry ;
+	entry.key = pkey ;
+	entry.last_used = ++public_key_cache_counter ;
+
+	std::pair<std::map<std::pair<RsGxsId,Sha1CheckSum>,CachedPublicKey>::iterator,bool> res = public_key_cache.insert(std::make_pair(id,entry)) ;
+
+	if(!res.second)
+	{
+		EVP_PKEY_free(pkey) ;
+		pkey = res.first->second.key ;
+		res.first->second.last_used = entry.last_used ;
+	}
+	else if(public_key_cache.size() > PUBLIC_KEY_CACHE_MAX_SIZE)
+	{
+		std::map<std::pair<RsGxsId,Sha1CheckSum>,CachedPublicKey>::iterator oldest = public_key_cache.begin() ;
+
+		for(std::map<std::pair<RsGxsId,Sha1CheckSum>,CachedPublicKey>::iterator it(public_key_cache.begin());it!=public_key_cache.end();++it)
+			if(it->second.last_used < oldest->second.last_used)
+				oldest = it ;
+
+		// Users of the key hold their own reference, so it is only freed when they are done.
+		EVP_PKEY_free(oldest->second.key) ;
+		public_key_cache.erase(oldest) ;
+	}
+
+	upRefPublicKey(pkey) ;
+	return pkey ;
+}
+
+// Digest context of the calling thread, to check signatures without allocating one each time.
+
+static EVP_MD_CTX *threadVerifyContext()
+{
+	struct VerifyContext
+	{
+		VerifyContext() : mdctx(EVP_MD_CTX_create()) {}
+		~VerifyContext() { EVP_MD_CTX_destroy(mdctx); }
+
+		EVP_MD_CTX *mdctx ;
+	};
+	static thread_local VerifyContext ctx ;
+
+	return ctx.mdctx ;
+}
+
+// EVP_VerifyInit() would free and reallocate the digest data at each call, EVP_VerifyInit_ex() reuses it.
+
+static int verifySha1Signature(EVP_PKEY *signKey, const unsigned char *sigbuf, unsigned int siglen,
+                               const void *data1, size_t len1, const void *data2 = NULL, size_t len2 = 0)
+{
+	if(!signKey)
+		return 0 ;
+
+	EVP_MD_CTX *mdctx = threadVerifyContext() ;
+
+	if(!EVP_VerifyInit_ex(mdctx, EVP_sha1(), NULL))
+		return 0 ;
+
+	EVP_VerifyUpdate(mdctx, data1, len1) ;
+
+	if(len2 > 0)
+		EVP_VerifyUpdate(mdctx, data2, len2) ;
+
+	return EVP_VerifyFinal(mdctx, sigbuf, siglen, signKey) ;
+}
 bool GxsSecurity::checkFingerprint(const RsTlvPublicRSAKey& key)
 {
     RSA *rsa_pub = ::extractPublicKey(key) ;
@@ -375,28 +523,20 @@ bool GxsSecurity::validateSignature(const char *data, uint32_t data_len, const R
 {
     assert(!(key.keyFlags & RSTLV_KEY_TYPE_FULL)) ;
         
-	RSA *rsakey = ::extractPublicKey(key) ;
+	EVP_PKEY *signKey = getCachedPublicKey(key) ;
 
-	if(!rsakey)
+	if(!signKey)
 	{
 		std::cerr << "GxsSecurity::validateSignature(): Cannot validate signature. Keydata is incomplete." << std::endl;
 		key.print(std::cerr,0) ;
 		return false ;
 	}
-	EVP_PKEY *signKey = EVP_PKEY_new();
-	EVP_PKEY_assign_RSA(signKey, rsakey);
 
 	/* calc and check signature */
-	EVP_MD_CTX *mdctx = EVP_MD_CTX_create();
-
-	EVP_VerifyInit(mdctx, EVP_sha1());
-	EVP_VerifyUpdate(mdctx, data, data_len);
-
-	int signOk = EVP_VerifyFinal(mdctx, (unsigned char*)signature.signData.bin_data, signature.signData.bin_len, signKey);
+	int signOk = verifySha1Signature(signKey, (unsigned char*)signature.signData.bin_data, signature.signData.bin_len, data, data_len);
 
 	/* clean up */
 	EVP_PKEY_free(signKey);
-	EVP_MD_CTX_destroy(mdctx);
 
     if(signOk==1)
         return true;
@@ -450,11 +590,24 @@ bool GxsSecurity::validateNxsMsg(const RsNxsMsg& msg, const RsTlvKeySignature& s
             std::cerr << std::endl;
     #endif
 
-            /* extract admin key */
+            /* extract admin key. Private keys are rare here and not worth caching. */
+
+            EVP_PKEY *signKey = NULL ;
+
+            if(key.keyFlags & RSTLV_KEY_TYPE_FULL)
+            {
+                RSA *rsakey = d2i_RSAPrivateKey(NULL, &(keyptr), keylen) ;
 
-            RSA *rsakey = (key.keyFlags & RSTLV_KEY_TYPE_FULL)?  (d2i_RSAPrivateKey(NULL, &(keyptr), keylen)) : (d2i_RSAPublicKey(NULL, &(keyptr), keylen));
+                if(rsakey)
+                {
+                    signKey = EVP_PKEY_new();
+                    EVP_PKEY_assign_RSA(signKey, rsakey);
+                }
+            }
+            else
+                signKey = getCachedPublicKey(key) ;
 
-            if (!rsakey)
+            if (!signKey)
             {
     #ifdef GXS_SECURITY_DEBUG
                     std::cerr << "GxsSecurity::validateNxsMsg()";
@@ -479,35 +632,22 @@ bool GxsSecurity::validateNxsMsg(const RsNxsMsg& msg, const RsTlvKeySignature& s
 	    int signOk = 0 ;
 
 	{
-		EVP_PKEY *signKey = EVP_PKEY_new();
-		EVP_PKEY_assign_RSA(signKey, rsakey);
-		EVP_MD_CTX *mdctx = EVP_MD_CTX_create();
-
 		uint32_t metaDataLen = msgMeta.serial_size();
-		uint32_t allMsgDataLen = metaDataLen + msg.msg.bin_len;
 
 		RsTemporaryMemory metaData(metaDataLen) ;
-		RsTemporaryMemory allMsgData(allMsgDataLen) ;
-
-		if(!metaData || !allMsgData)
-			return false ;
-		
-		msgMeta.serialise(metaData, &metaDataLen);
 
-		// copy msg data and meta in allmsgData buffer
-		memcpy(allMsgData, msg.msg.bin_data, msg.msg.bin_len);
-		memcpy(allMsgData+(msg.msg.bin_len), metaData, metaDataLen);
-
-		/* calc and check signature */
+		if(metaData)
+		{
+			msgMeta.serialise(metaData, &metaDataLen);
 
-		EVP_VerifyInit(mdctx, EVP_sha1());
-		EVP_VerifyUpdate(mdctx, allMsgData, allMsgDataLen);
+			/* calc and check signature of msg data followed by meta data */
 
-		signOk = EVP_VerifyFinal(mdctx, sigbuf, siglen, signKey);
+			signOk = verifySha1Signature(signKey, sigbuf, siglen, msg.msg.bin_data, msg.msg.bin_len, metaData, metaDataLen);
+		}
 
 		/* clean up */
-		EVP_PKEY_free(signKey);
-		EVP_MD_CTX_destroy(mdctx);
+		if(signKey)
+			EVP_PKEY_free(signKey);
 	}
 
             msgMeta.mOrigMsgId = origMsgId;
@@ -544,22 +684,9 @@ bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, u
 
     	out = NULL ;
     
-	RSA *tmpkey = ::extractPublicKey(key) ;
-	RSA *rsa_publish_pub = RSAPublicKey_dup(tmpkey) ;
-	RSA_free(tmpkey) ;
+	EVP_PKEY *public_key = getCachedPublicKey(key) ;
 
-	EVP_PKEY *public_key = NULL;
-
-	//RSA* rsa_publish = EVP_PKEY_get1_RSA(privateKey);
-	//rsa_publish_pub = RSAPublicKey_dup(rsa_publish);
-
-
-	if(rsa_publish_pub  != NULL)
-	{
-		public_key = EVP_PKEY_new();
-		EVP_PKEY_assign_RSA(public_key, rsa_publish_pub);
-	}
-	else
+	if(public_key == NULL)
 	{
 #ifdef DISTRIB_DEBUG
 		std::cerr << "GxsSecurity(): Could not generate publish key " << grpId
@@ -647,7 +774,20 @@ bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, u
 	return true;
 }
 
-bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, uint32_t inlen, const std::vector<RsTlvPublicRSAKey> &keys)
+// The hint is the beginning of SHA1(salt | key id).
+
+static void getKeyHint(const unsigned char *salt, const RsGxsId& key_id, unsigned char *hint)
+{
+	unsigned char buf[MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SALT_SIZE + RsGxsId::SIZE_IN_BYTES] ;
+
+	memcpy(buf, salt, MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SALT_SIZE) ;
+	memcpy(buf + MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SALT_SIZE, key_id.toByteArray(), RsGxsId::SIZE_IN_BYTES) ;
+
+	Sha1CheckSum h = RsDirUtil::sha1sum(buf, sizeof(buf)) ;
+	memcpy(hint, h.toByteArray(), MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SIZE) ;
+}
+
+bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, uint32_t inlen, const std::vector<RsTlvPublicRSAKey> &keys, bool key_hints)
 {
 #ifdef DISTRIB_DEBUG
 	std::cerr << "GxsSecurity::encrypt() " << std::endl;
@@ -658,6 +798,12 @@ bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, u
 	//   [--- ID ---|--- number of encrypted keys---|  n * (--- Encrypted session keys ---)    |---      IV     ---|---- Encrypted data ---]
 	//      2 bytes              2 byte = n                            256 bytes                  EVP_MAX_IV_LENGTH       Rest of packet
 	//
+	// With key hints (v002), a random salt and a hint of each recipient key id come before the encrypted session keys, in the same
+	// order. The hint is the first 8 bytes of SHA1(salt | key id), so it does not tell who the recipients are:
+	//
+	//   [--- ID ---|--- number of encrypted keys---|--- salt ---|  n * (--- key hint ---)  |  n * (--- Encrypted session keys ---)    |---      IV     ---|---- Encrypted data ---]
+	//      2 bytes              2 byte = n            8 bytes               8 bytes                          256 bytes                  EVP_MAX_IV_LENGTH       Rest of packet
+	//
 
 	out = NULL ;
 	EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
@@ -670,16 +816,9 @@ bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, u
 
 		for(uint32_t i=0;i<keys.size();++i)
 		{
-			RSA *tmpkey = ::extractPublicKey(keys[i]) ;
-			RSA *rsa_publish_pub = RSAPublicKey_dup(tmpkey) ;
-			RSA_free(tmpkey) ;
+			public_keys[i] = getCachedPublicKey(keys[i]) ;
 
-			if(rsa_publish_pub  != NULL)
-			{
-				public_keys[i] = EVP_PKEY_new();
-				EVP_PKEY_assign_RSA(public_keys[i], rsa_publish_pub);
-			}
-			else
+			if(public_keys[i] == NULL)
 			{
 				std::cerr << "GxsSecurity(): Could not generate public key for key id " << keys[i].keyId << std::endl;
 				throw std::runtime_error("Cannot extract public key") ;
@@ -715,9 +854,12 @@ bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, u
 			EVP_PKEY_free(public_keys[i]) ;
 		public_keys.clear() ;
 
+		multi_encryption_key_wraps += keys.size() ;
+
 		int total_ek_size = MULTI_ENCRYPTION_FORMAT_v001_ENCRYPTED_KEY_SIZE * keys.size() ;
+		int total_hint_size = key_hints ? MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SALT_SIZE + MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SIZE * keys.size() : 0 ;
 
-		int max_outlen = MULTI_ENCRYPTION_FORMAT_v001_HEADER_SIZE + MULTI_ENCRYPTION_FORMAT_v001_NUMBER_OF_KEYS_SIZE + total_ek_size + EVP_MAX_IV_LENGTH + (inlen + cipher_block_size) ;
+		int max_outlen = MULTI_ENCRYPTION_FORMAT_v001_HEADER_SIZE + MULTI_ENCRYPTION_FORMAT_v001_NUMBER_OF_KEYS_SIZE + total_hint_size + total_ek_size + EVP_MAX_IV_LENGTH + (inlen + cipher_block_size) ;
 
 		// now assign memory to out accounting for data, and cipher block size, key length, and key length val
 		out = (uint8_t*)rs_malloc(max_outlen);
@@ -729,14 +871,31 @@ bool GxsSecurity::encrypt(uint8_t *& out, uint32_t &outlen, const uint8_t *in, u
 
 		// header
 
-		out[out_offset++] =  MULTI_ENCRYPTION_FORMAT_v001_HEADER       & 0xff ;
-		out[out_offset++] = (MULTI_ENCRYPTION_FORMAT_v001_HEADER >> 8) & 0xff ;
+		uint32_t format_id = key_hints ? MULTI_ENCRYPTION_FORMAT_v002_HEADER : MULTI_ENCRYPTION_FORMAT_v001_HEADER ;
+
+		out[out_offset++] =  format_id       & 0xff ;
+		out[out_offset++] = (format_id >> 8) & 0xff ;
 
 		// number of keys
 
 		out[out_offset++] =   keys.size()       & 0xff ;
 		out[out_offset++] =  (keys.size() >> 8) & 0xff ;
 
+		// salt and key hints
+
+		if(key_hints)
+		{
+			unsigned char *salt = out + out_offset ;
+			RsRandom::random_bytes(salt, MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SALT_SIZE) ;
+			out_offset += MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SALT_SIZE ;
+
+			for(uint32_t i=0;i<keys.size();++i)
+			{
+				getKeyHint(salt, keys[i].keyId, out + out_offset) ;
+				out_offset += MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SIZE ;
+			}
+		}
+
 		// encrypted keys, each preceeded with its length
 
 		for(uint32_t i=0;i<keys.size();++i)
@@ -915,6 +1074,8 @@ bool GxsSecurity::decrypt(uint8_t *& out, uint32_t & outlen, const uint8_t *in,
         //   [--- ID ---|--- number of encrypted keys---|  n * (--- Encrypted session keys ---)    |---      IV     ---|---- Encrypted data ---]
     	//      2 bytes              2 byte = n                            256 bytes                  EVP_MAX_IV_LENGTH       Rest of packet
         //
+        // When the block has key hints (v002, see encrypt()), only the encrypted session keys whose hint matches a key are tried.
+        //
         // This method can be used to decrypt multi-encrypted data, if passing he correct encrypted key block (corresponding to the given key)
 
 #ifdef DISTRIB_DEBUG
@@ -929,9 +1090,14 @@ bool GxsSecurity::decrypt(uint8_t *& out, uint32_t & outlen, const uint8_t *in,
 	    // check that the input block has a valid format.
 
 	    uint32_t offset = 0 ;
+
+	    if(inlen < MULTI_ENCRYPTION_FORMAT_v001_HEADER_SIZE + MULTI_ENCRYPTION_FORMAT_v001_NUMBER_OF_KEYS_SIZE)
+		    throw std::runtime_error("Encrypted block is too short.") ;
+
 	    uint16_t format_id = in[offset] + (in[offset+1] << 8) ;
+	    bool key_hints = (format_id == MULTI_ENCRYPTION_FORMAT_v002_HEADER) ;
 
-	    if(format_id != MULTI_ENCRYPTION_FORMAT_v001_HEADER)
+	    if(format_id != MULTI_ENCRYPTION_FORMAT_v001_HEADER && !key_hints)
 	    {
 		    std::cerr << "Unrecognised format in encrypted block. Header id = " << std::hex << format_id << std::dec << std::endl;
 		    throw std::runtime_error("Unrecognised format in encrypted block.") ; 
@@ -943,6 +1109,16 @@ bool GxsSecurity::decrypt(uint8_t *& out, uint32_t & outlen, const uint8_t *in,
 	    uint32_t number_of_keys = in[offset] + (in[offset+1] << 8) ;
 	    offset += MULTI_ENCRYPTION_FORMAT_v001_NUMBER_OF_KEYS_SIZE;
 
+	    uint32_t salt_offset = offset ;
+
+	    if(key_hints)
+		    offset += MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SALT_SIZE ;
+
+	    uint32_t key_hints_offset = offset ;
+
+	    if(key_hints)
+		    offset += number_of_keys * MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SIZE ;
+
 	    // reach the actual data offset
 
 	    uint32_t encrypted_keys_offset  = offset ;
@@ -970,6 +1146,28 @@ bool GxsSecurity::decrypt(uint8_t *& out, uint32_t & outlen, const uint8_t *in,
 
 	    for(uint32_t j=0;j<keys.size() && !succeed;++j)
 	    {
+		    // Don't even extract the private key when it is not a recipient
+
+		    unsigned char hint[MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SIZE] ;
+		    std::vector<uint32_t> candidates ;
+
+		    if(key_hints)
+		    {
+			    getKeyHint(in + salt_offset, keys[j].keyId, hint) ;
+
+			    for(uint32_t i=0;i<number_of_keys;++i)
+				    if(!memcmp(hint, in + key_hints_offset + i*MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SIZE, MULTI_ENCRYPTION_FORMAT_v002_KEY_HINT_SIZE))
+					    candidates.push_back(i) ;
+
+			    multi_encryption_unwraps_skipped += number_of_keys - candidates.size() ;
+
+			    if(candidates.empty())
+				    continue ;
+		    }
+		    else
+			    for(uint32_t i=0;i<number_of_keys;++i)
+				    candidates.push_back(i) ;
+
 		    RSA *rsa_private = extractPrivateKey(keys[j]) ;
 		    EVP_PKEY *privateKey = NULL;
 
@@ -989,8 +1187,11 @@ bool GxsSecurity::decrypt(uint8_t *& out, uint32_t & outlen, const uint8_t *in,
 			    continue ;
 		    }
 
-		    for(uint32_t i=0;i<number_of_keys && !succeed;++i)
+		    for(uint32_t c=0;c<candidates.size() && !succeed;++c)
 		    {
+			    uint32_t i = candidates[c] ;
+
+			    ++multi_encryption_unwrap_attempts ;
 			    succeed = EVP_OpenInit(ctx, EVP_aes_128_cbc(),in + encrypted_keys_offset + i*MULTI_ENCRYPTION_FORMAT_v001_ENCRYPTED_KEY_SIZE , MULTI_ENCRYPTION_FORMAT_v001_ENCRYPTED_KEY_SIZE, in+IV_offset, privateKey);
 
 			if(!succeed)
@@ -1051,6 +1252,22 @@ bool GxsSecurity::decrypt(uint8_t *& out, uint32_t & outlen, const uint8_t *in,
         return false;
     }
 }
+void GxsSecurity::getPublicKeyCacheStats(PublicKeyCacheStats& stats)
+{
+	stats.hits = public_key_cache_hits ;
+	stats.misses = public_key_cache_misses ;
+
+	RS_STACK_MUTEX(public_key_cache_mtx) ;
+	stats.entries = public_key_cache.size() ;
+}
+
+void GxsSecurity::getMultiEncryptionStats(MultiEncryptionStats& stats)
+{
+	stats.key_wraps = multi_encryption_key_wraps ;
+	stats.unwrap_attempts = multi_encryption_unwrap_attempts ;
+	stats.unwraps_skipped_by_hints = multi_encryption_unwraps_skipped ;
+}
+
 bool GxsSecurity::validateNxsGrp(const RsNxsGrp& grp, const RsTlvKeySignature& sign, const RsTlvPublicRSAKey &key)
 {
 #ifdef GXS_SECURITY_DEBUG
@@ -1085,21 +1302,19 @@ bool GxsSecurity::validateNxsGrp(const RsNxsGrp& grp, const RsTlvKeySignature& s
     }
 
 	/* decode key */
-	const unsigned char *keyptr = (const unsigned char *) key.keyData.bin_data;
-	long keylen = key.keyData.bin_len;
 	unsigned int siglen = sign.signData.bin_len;
 	unsigned char *sigbuf = (unsigned char *) sign.signData.bin_data;
 
 #ifdef DISTRIB_DEBUG
 	std::cerr << "GxsSecurity::validateNxsMsg() Decode Key";
-	std::cerr << " keylen: " << keylen << " siglen: " << siglen;
+	std::cerr << " keylen: " << key.keyData.bin_len << " siglen: " << siglen;
 	std::cerr << std::endl;
 #endif
 
 	/* extract admin key */
-	RSA *rsakey = d2i_RSAPublicKey(NULL, &(keyptr), keylen);
+	EVP_PKEY *signKey = getCachedPublicKey(key) ;
 
-	if (!rsakey)
+	if (!signKey)
 	{
 #ifdef GXS_SECURITY_DEBUG
 		std::cerr << "GxsSecurity::validateNxsGrp()";
@@ -1118,31 +1333,20 @@ bool GxsSecurity::validateNxsGrp(const RsNxsGrp& grp, const RsTlvKeySignature& s
 	grpMeta.signSet.TlvClear();
     
 	int signOk =0;
-	EVP_PKEY *signKey = EVP_PKEY_new();
-	EVP_PKEY_assign_RSA(signKey, rsakey);
 
-
-	for(uint32_t i=0;i<api_versions_to_check.size() && 0==signOk;++i)
+	for(uint32_t i=0;i<api_versions_to_check.size() && 0==signOk && signKey;++i)
 	{
 		uint32_t metaDataLen = grpMeta.serial_size(api_versions_to_check[i]);
-		uint32_t allGrpDataLen = metaDataLen + grp.grp.bin_len;
 
 		RsTemporaryMemory metaData(metaDataLen) ;
-		RsTemporaryMemory allGrpData(allGrpDataLen) ;// msgData + metaData
-
-		grpMeta.serialise(metaData, metaDataLen,api_versions_to_check[i]);
 
-		// copy msg data and meta in allmsgData buffer
-		memcpy(allGrpData, grp.grp.bin_data, grp.grp.bin_len);
-		memcpy(allGrpData+(grp.grp.bin_len), metaData, metaDataLen);
+		if(!metaData)
+			break ;
 
-		/* calc and check signature */
-		EVP_MD_CTX *mdctx = EVP_MD_CTX_create();
+		grpMeta.serialise(metaData, metaDataLen,api_versions_to_check[i]);
 
-		EVP_VerifyInit(mdctx, EVP_sha1());
-		EVP_VerifyUpdate(mdctx, allGrpData, allGrpDataLen);
-		signOk = EVP_VerifyFinal(mdctx, sigbuf, siglen, signKey);
-		EVP_MD_CTX_destroy(mdctx);
+		/* calc and check signature of grp data followed by meta data */
+		signOk = verifySha1Signature(signKey, sigbuf, siglen, grp.grp.bin_data, grp.grp.bin_len, metaData, metaDataLen);
 
 #ifdef GXS_SECURITY_DEBUG
                 if(i>0)
@@ -1151,7 +1355,8 @@ bool GxsSecurity::validateNxsGrp(const RsNxsGrp& grp, const RsTlvKeySignature& s
 	}
 
 	/* clean up */
-	EVP_PKEY_free(signKey);
+	if(signKey)
+		EVP_PKEY_free(signKey);
 
 	// restore data
 
@@ -60,9 +60,11 @@ class GxsSecurity
 		 *@param outlen
 		 *@param in
 		 *@param inlen
+		 *@param key_hints also write a salted hint of each recipient key id, so that the receiver only tries the right key.
+		 *                 Blocks with hints cannot be decrypted by versions that came before them.
 		 */
 		static bool encrypt(uint8_t *&out, uint32_t &outlen, const uint8_t *in, uint32_t inlen, const RsTlvPublicRSAKey& key) ;
-		static bool encrypt(uint8_t *&out, uint32_t &outlen, const uint8_t *in, uint32_t inlen, const std::vector<RsTlvPublicRSAKey>& keys) ;
+		static bool encrypt(uint8_t *&out, uint32_t &outlen, const uint8_t *in, uint32_t inlen, const std::vector<RsTlvPublicRSAKey>& keys, bool key_hints = false) ;
 
 		/**
 		 * Decrypts data using evelope decryption (taken from open ssl's evp_sealinit )
@@ -76,6 +78,28 @@ class GxsSecurity
 		static bool decrypt(uint8_t *&out, uint32_t &outlen, const uint8_t *in, uint32_t inlen, const RsTlvPrivateRSAKey& key) ;
 		static bool decrypt(uint8_t *& out, uint32_t & outlen, const uint8_t *in, uint32_t inlen, const std::vector<RsTlvPrivateRSAKey>& keys);
 
+		/*!
+		 * RSA operations done by encrypt() and decrypt() with several keys since start, all callers together.
+		 */
+		struct MultiEncryptionStats
+		{
+			uint64_t key_wraps ;                 // one per recipient key at each encryption
+			uint64_t unwrap_attempts ;           // private key tried on an encrypted session key
+			uint64_t unwraps_skipped_by_hints ;  // attempts avoided thanks to key hints
+		};
+		static void getMultiEncryptionStats(MultiEncryptionStats& stats) ;
+
+		/*!
+		 * Use of the cache of parsed public keys shared by signature checks and encryption, since start.
+		 */
+		struct PublicKeyCacheStats
+		{
+			uint64_t hits ;
+			uint64_t misses ;    // key data parsed
+			uint64_t entries ;
+		};
+		static void getPublicKeyCacheStats(PublicKeyCacheStats& stats) ;
+
 		/*!
 		 * uses grp signature to check if group has been
 		 * tampered with
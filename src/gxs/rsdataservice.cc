@@ -40,13 +40,30 @@
 
 #define MSG_TABLE_NAME std::string("MESSAGES")
 #define GRP_TABLE_NAME std::string("GROUPS")
+#define MSG_DATA_TABLE_NAME std::string("MESSAGES_DATA")
+#define GRP_DATA_TABLE_NAME std::string("GROUPS_DATA")
 #define DATABASE_RELEASE_TABLE_NAME std::string("DATABASE_RELEASE")
 
+// payloads are only joined when the full items are requested
+#define MSG_WITH_DATA (MSG_TABLE_NAME + " JOIN " + MSG_DATA_TABLE_NAME + " USING(" + KEY_ENTRY_ID + ")")
+#define GRP_WITH_DATA (GRP_TABLE_NAME + " JOIN " + GRP_DATA_TABLE_NAME + " USING(" + KEY_ENTRY_ID + ")")
+
+// tables of release 2, renamed during the update to release 3
+#define MSG_TABLE_NAME_OLD std::string("MESSAGES_OLD")
+#define GRP_TABLE_NAME_OLD std::string("GROUPS_OLD")
+
 #define GRP_LAST_POST_UPDATE_TRIGGER std::string("LAST_POST_UPDATE")
+#define MSG_DATA_DELETE_TRIGGER std::string("MESSAGES_DATA_DELETE")
+#define GRP_DATA_DELETE_TRIGGER std::string("GROUPS_DATA_DELETE")
 
 #define MSG_INDEX_GRPID std::string("INDEX_MESSAGES_GRPID")
+#define MSG_INDEX_GRPID_TS std::string("INDEX_MESSAGES_GRPID_TS")
+#define MSG_INDEX_GRPID_PARENTID std::string("INDEX_MESSAGES_GRPID_PARENTID")
+#define MSG_INDEX_GRPID_THREADID std::string("INDEX_MESSAGES_GRPID_THREADID")
+#define MSG_INDEX_GRPID_ORIGMSGID std::string("INDEX_MESSAGES_GRPID_ORIGMSGID")
 
 // generic
+#define KEY_ENTRY_ID        std::string("entryId")
 #define KEY_NXS_DATA        std::string("nxsData")
 #define KEY_NXS_DATA_LEN    std::string("nxsDataLen")
 #define KEY_NXS_IDENTITY    std::string("identity")
@@ -117,6 +134,272 @@ static int addColumn(std::list<std::string> &list, const std::string &attribute)
     return list.size() - 1;
 }
 
+// Indexes used by filtered message requests, see retrieveGxsMsgMetaData()
+static bool createMsgFilterIndexes(RetroDb *db)
+{
+    bool ok = db->execSQL("CREATE INDEX " + MSG_INDEX_GRPID_TS + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_TIME_STAMP + ");");
+    ok = ok && db->execSQL("CREATE INDEX " + MSG_INDEX_GRPID_PARENTID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_MSG_PARENT_ID + ");");
+    ok = ok && db->execSQL("CREATE INDEX " + MSG_INDEX_GRPID_THREADID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_MSG_THREAD_ID + ");");
+    ok = ok && db->execSQL("CREATE INDEX " + MSG_INDEX_GRPID_ORIGMSGID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID + "," + KEY_ORIG_MSG_ID + ");");
+    return ok;
+}
+
+/*
+ * Since release 3, group and message ids are stored as blobs, which halves
+ * the size of the id columns and of the indexes built on them. They are
+ * written as blob literals in queries.
+ */
+template<class ID> static std::string sqlId(const ID& id)
+{
+    return "X'" + id.toStdString() + "'";
+}
+
+template<class ID> static void putId(ContentValue& cv, const std::string& key, const ID& id)
+{
+    cv.put(key, ID::SIZE_IN_BYTES, (const char*)id.toByteArray());
+}
+
+template<class ID> static ID getId(RetroCursor& c, int columnIndex)
+{
+    uint32_t len = 0;
+    const void* data = c.getData(columnIndex, len);
+
+    if(!data || len != ID::SIZE_IN_BYTES)
+        return ID();
+
+    return ID::fromBufferUnsafe((const uint8_t*)data);
+}
+
+// Null ids are stored as zeros
+static std::string sqlNullMsgId(const std::string& column)
+{
+    return column + "=" + sqlId(RsGxsMessageId());
+}
+
+/*
+ * Creates the tables of the current release.
+ * The metas of groups and messages are kept apart from their payloads, so that
+ * meta scans, which are by far the most frequent requests, only read small
+ * rows. Payloads live in *_DATA tables sharing the integer key of the meta
+ * row, and are removed along with it by a trigger.
+ */
+static bool createTables(RetroDb *db)
+{
+    // create table for msg meta
+    bool ok = db->execSQL("CREATE TABLE " + MSG_TABLE_NAME + "(" +
+                          KEY_ENTRY_ID + " INTEGER PRIMARY KEY," +
+                          KEY_MSG_ID + " BLOB NOT NULL UNIQUE," +
+                          KEY_GRP_ID +  " BLOB NOT NULL," +
+                          KEY_NXS_FLAGS + " INT,"  +
+                          KEY_ORIG_MSG_ID +  " BLOB," +
+                          KEY_TIME_STAMP + " INT," +
+                          KEY_NXS_IDENTITY + " TEXT," +
+                          KEY_SIGN_SET + " BLOB," +
+                          KEY_NXS_DATA_LEN + " INT," +
+                          KEY_MSG_STATUS + " INT," +
+                          KEY_CHILD_TS + " INT," +
+                          KEY_MSG_THREAD_ID + " BLOB," +
+                          KEY_MSG_PARENT_ID + " BLOB,"+
+                          KEY_MSG_NAME + " TEXT," +
+                          KEY_NXS_SERV_STRING + " TEXT," +
+                          KEY_NXS_HASH + " TEXT," +
+                          KEY_RECV_TS + " INT);");
+
+    // create table for msg data
+    ok = ok && db->execSQL("CREATE TABLE " + MSG_DATA_TABLE_NAME + "(" +
+                           KEY_ENTRY_ID + " INTEGER PRIMARY KEY," +
+                           KEY_NXS_DATA + " BLOB," +
+                           KEY_NXS_META + " BLOB);");
+
+    // create table for grp meta
+    ok = ok && db->execSQL("CREATE TABLE " + GRP_TABLE_NAME + "(" +
+                           KEY_ENTRY_ID + " INTEGER PRIMARY KEY," +
+                           KEY_GRP_ID + " BLOB NOT NULL UNIQUE," +
+                           KEY_TIME_STAMP + " INT," +
+                           KEY_NXS_DATA_LEN + " INT," +
+                           KEY_KEY_SET + " BLOB," +
+                           KEY_GRP_NAME + " TEXT," +
+                           KEY_GRP_LAST_POST + " INT," +
+                           KEY_GRP_POP + " INT," +
+                           KEY_MSG_COUNT + " INT," +
+                           KEY_GRP_SUBCR_FLAG + " INT," +
+                           KEY_GRP_STATUS + " INT," +
+                           KEY_NXS_IDENTITY + " TEXT," +
+                           KEY_ORIG_GRP_ID + " TEXT," +
+                           KEY_NXS_SERV_STRING + " TEXT," +
+                           KEY_NXS_FLAGS + " INT," +
+                           KEY_GRP_AUTHEN_FLAGS + " INT," +
+                           KEY_GRP_SIGN_FLAGS + " INT," +
+                           KEY_GRP_CIRCLE_ID + " TEXT," +
+                           KEY_GRP_CIRCLE_TYPE + " INT," +
+                           KEY_GRP_INTERNAL_CIRCLE + " TEXT," +
+                           KEY_GRP_ORIGINATOR + " TEXT," +
+                           KEY_NXS_HASH + " TEXT," +
+                           KEY_RECV_TS + " INT," +
+                           KEY_PARENT_GRP_ID + " TEXT," +
+                           KEY_GRP_REP_CUTOFF + " INT);");
+
+    // create table for grp data
+    ok = ok && db->execSQL("CREATE TABLE " + GRP_DATA_TABLE_NAME + "(" +
+                           KEY_ENTRY_ID + " INTEGER PRIMARY KEY," +
+                           KEY_NXS_DATA + " BLOB," +
+                           KEY_NXS_META + " BLOB);");
+
+    ok = ok && db->execSQL("CREATE TRIGGER " + MSG_DATA_DELETE_TRIGGER +
+                           " AFTER DELETE ON " + MSG_TABLE_NAME +
+                           " BEGIN DELETE FROM " + MSG_DATA_TABLE_NAME + " WHERE " + KEY_ENTRY_ID + "=old." + KEY_ENTRY_ID + "; END;");
+
+    ok = ok && db->execSQL("CREATE TRIGGER " + GRP_DATA_DELETE_TRIGGER +
+                           " AFTER DELETE ON " + GRP_TABLE_NAME +
+                           " BEGIN DELETE FROM " + GRP_DATA_TABLE_NAME + " WHERE " + KEY_ENTRY_ID + "=old." + KEY_ENTRY_ID + "; END;");
+
+    // (grpId, timeStamp) also serves the requests on the group alone
+    ok = ok && createMsgFilterIndexes(db);
+
+    return ok;
+}
+
+static bool createLastPostTrigger(RetroDb *db)
+{
+    return db->execSQL("CREATE TRIGGER " + GRP_LAST_POST_UPDATE_TRIGGER +
+                       " INSERT ON " + MSG_TABLE_NAME +
+                       std::string(" BEGIN ") +
+                       " UPDATE " + GRP_TABLE_NAME + " SET " + KEY_GRP_LAST_POST + "= new."
+                       + KEY_RECV_TS + " WHERE " + KEY_GRP_ID + "=new." + KEY_GRP_ID + ";"
+                       + std::string("END;"));
+}
+
+// Inserts a meta row, then the payload row in dataCv with the same key.
+static bool insertWithData(RetroDb *db, const std::string& table, const std::string& dataTable, const ContentValue& cv, ContentValue& dataCv)
+{
+    if(!db->sqlInsert(table, "", cv))
+        return false;
+
+    dataCv.put(KEY_ENTRY_ID, (int64_t)db->lastInsertRowId());
+
+    return db->sqlInsert(dataTable, "", dataCv);
+}
+
+/*
+ * Release 3 update: copies the rows of a release 2 table to the new tables,
+ * converting the hex ids to blobs and moving the payloads out of the row.
+ */
+struct MigratedColumn
+{
+    enum Type { INT, TEXT, BLOB, DATA, GRP_ID, MSG_ID };
+
+    std::string name;
+    Type type;
+};
+
+// Commits when ok, rolls back otherwise. Returns true if committed.
+static bool endTransaction(RetroDb *db, bool ok)
+{
+    if(ok)
+        return db->commitTransaction();
+
+    db->rollbackTransaction();
+    return false;
+}
+
+/*
+ * Moves at most RELEASE3_UPDATE_BATCH rows. The copied rows are deleted from
+ * the old table, so that their pages are reused by the next batches instead
+ * of growing the file, and so that the rows left are the ones to copy.
+ */
+static const uint32_t RELEASE3_UPDATE_BATCH = 500;
+
+static bool copyTableToRelease3(RetroDb *db, const std::string& oldTable, const std::string& table, const std::string& dataTable,
+                                const std::vector<MigratedColumn>& migratedColumns, uint32_t& count, bool& done)
+{
+    std::list<std::string> columns;
+
+    for(auto& col:migratedColumns)
+        columns.push_back(col.name);
+
+    columns.push_back("rowid");
+
+    RetroCursor* c = db->sqlQuery(oldTable, columns, "", "rowid", RELEASE3_UPDATE_BATCH);
+
+    if(!c)
+        return false;
+
+    bool ok = true;
+    int64_t lastRowId = 0;
+    uint32_t rows = 0;
+
+    for(bool valid = c->moveToFirst(); ok && valid; valid = c->moveToNext())
+    {
+        ContentValue cv, dataCv;
+
+        for(uint32_t i=0; i<migratedColumns.size(); ++i)
+        {
+            const MigratedColumn& col(migratedColumns[i]);
+
+            switch(col.type)
+            {
+            case MigratedColumn::INT:
+                cv.put(col.name, (int64_t)c->getInt64(i));
+                break;
+
+            case MigratedColumn::TEXT:
+            {
+                std::string s;
+                c->getString(i, s);
+                cv.put(col.name, s);
+            }
+                break;
+
+            case MigratedColumn::BLOB:
+            case MigratedColumn::DATA:
+            {
+                uint32_t len = 0;
+                const char* data = (const char*)c->getData(i, len);
+
+                if(data)
+                    (col.type == MigratedColumn::DATA ? dataCv : cv).put(col.name, len, data);
+            }
+                break;
+
+            // empty ids of old databases become null ids
+            case MigratedColumn::GRP_ID:
+            {
+                RsGxsGroupId id;
+                c->getStringT<RsGxsGroupId>(i, id);
+                putId(cv, col.name, id);
+            }
+                break;
+
+            case MigratedColumn::MSG_ID:
+            {
+                RsGxsMessageId id;
+                c->getStringT<RsGxsMessageId>(i, id);
+                putId(cv, col.name, id);
+            }
+                break;
+            }
+        }
+
+        ok = insertWithData(db, table, dataTable, cv, dataCv);
+        lastRowId = c->getInt64(migratedColumns.size());
+        ++count;
+        ++rows;
+    }
+
+    delete c;
+
+    if(ok && rows)
+    {
+        std::string where;
+        rs_sprintf(where, "rowid<=%lld", (long long)lastRowId);
+        ok = db->sqlDelete(oldTable, where, "");
+    }
+
+    done = ok && rows < RELEASE3_UPDATE_BATCH;
+
+    return ok;
+}
+
 RsDataService::RsDataService(const std::string &serviceDir, const std::string &dbName, uint16_t serviceType,
                              RsGxsSearchModule * /* mod */, const std::string& key)
     : RsGeneralDataService(), mDbMutex("RsDataService"), mServiceDir(serviceDir), mDbName(dbName), mDbPath(mServiceDir + "/" + dbName), mServType(serviceType), mDb(NULL)
@@ -291,7 +574,7 @@ static bool moveDataFromFileToDatabase(RetroDb *db, const std::string serviceDir
 
 void RsDataService::initialise(bool isNewDatabase)
 {
-    const int databaseRelease = 1;
+    const int databaseRelease = 3;
     int currentDatabaseRelease = 0;
     bool ok = true;
 
@@ -307,65 +590,8 @@ void RsDataService::initialise(bool isNewDatabase)
     }
 
     if (isNewDatabase) {
-        // create table for msg data
-        mDb->execSQL("CREATE TABLE " + MSG_TABLE_NAME + "(" +
-                     KEY_MSG_ID + " TEXT PRIMARY KEY," +
-                     KEY_GRP_ID +  " TEXT," +
-                     KEY_NXS_FLAGS + " INT,"  +
-                     KEY_ORIG_MSG_ID +  " TEXT," +
-                     KEY_TIME_STAMP + " INT," +
-                     KEY_NXS_IDENTITY + " TEXT," +
-                     KEY_SIGN_SET + " BLOB," +
-                     KEY_NXS_DATA + " BLOB,"+
-                     KEY_NXS_DATA_LEN + " INT," +
-                     KEY_MSG_STATUS + " INT," +
-                     KEY_CHILD_TS + " INT," +
-                     KEY_NXS_META + " BLOB," +
-                     KEY_MSG_THREAD_ID + " TEXT," +
-                     KEY_MSG_PARENT_ID + " TEXT,"+
-                     KEY_MSG_NAME + " TEXT," +
-                     KEY_NXS_SERV_STRING + " TEXT," +
-                     KEY_NXS_HASH + " TEXT," +
-                     KEY_RECV_TS + " INT);");
-
-        // create table for grp data
-        mDb->execSQL("CREATE TABLE " + GRP_TABLE_NAME + "(" +
-                     KEY_GRP_ID + " TEXT PRIMARY KEY," +
-                     KEY_TIME_STAMP + " INT," +
-                     KEY_NXS_DATA + " BLOB," +
-                     KEY_NXS_DATA_LEN + " INT," +
-                     KEY_KEY_SET + " BLOB," +
-                     KEY_NXS_META + " BLOB," +
-                     KEY_GRP_NAME + " TEXT," +
-                     KEY_GRP_LAST_POST + " INT," +
-                     KEY_GRP_POP + " INT," +
-                     KEY_MSG_COUNT + " INT," +
-                     KEY_GRP_SUBCR_FLAG + " INT," +
-                     KEY_GRP_STATUS + " INT," +
-                     KEY_NXS_IDENTITY + " TEXT," +
-                     KEY_ORIG_GRP_ID + " TEXT," +
-                     KEY_NXS_SERV_STRING + " TEXT," +
-                     KEY_NXS_FLAGS + " INT," +
-                     KEY_GRP_AUTHEN_FLAGS + " INT," +
-                     KEY_GRP_SIGN_FLAGS + " INT," +
-                     KEY_GRP_CIRCLE_ID + " TEXT," +
-                     KEY_GRP_CIRCLE_TYPE + " INT," +
-                     KEY_GRP_INTERNAL_CIRCLE + " TEXT," +
-                     KEY_GRP_ORIGINATOR + " TEXT," +
-                     KEY_NXS_HASH + " TEXT," +
-                     KEY_RECV_TS + " INT," +
-                     KEY_PARENT_GRP_ID + " TEXT," +
-                     KEY_GRP_REP_CUTOFF + " INT," +
-                     KEY_SIGN_SET + " BLOB);");
-
-        mDb->execSQL("CREATE TRIGGER " + GRP_LAST_POST_UPDATE_TRIGGER +
-                " INSERT ON " + MSG_TABLE_NAME +
-                std::string(" BEGIN ") +
-                " UPDATE " + GRP_TABLE_NAME + " SET " + KEY_GRP_LAST_POST + "= new."
-                + KEY_RECV_TS + " WHERE " + KEY_GRP_ID + "=new." + KEY_GRP_ID + ";"
-                + std::string("END;"));
-
-        mDb->execSQL("CREATE INDEX " + MSG_INDEX_GRPID + " ON " + MSG_TABLE_NAME + "(" + KEY_GRP_ID +  ");");
+        createTables(mDb);
+        createLastPostTrigger(mDb);
 
         // Insert release, no need to upgrade
         ContentValue cv;
@@ -441,6 +667,34 @@ void RsDataService::initialise(bool isNewDatabase)
                 currentDatabaseRelease = newRelease;
             }
         }
+
+        // Release 2
+        newRelease = 2;
+        if (ok && currentDatabaseRelease < newRelease) {
+            ok = startReleaseUpdate(newRelease);
+            ok = ok && createMsgFilterIndexes(mDb);
+            ok = finishReleaseUpdate(newRelease, ok);
+
+            if (ok) {
+                currentDatabaseRelease = newRelease;
+            }
+        }
+
+        // Release 3: blob ids, payloads out of the meta rows
+        newRelease = 3;
+        if (ok && currentDatabaseRelease < newRelease) {
+            // Services open their databases concurrently. Converting them one
+            // at a time keeps the disk busy with a single one.
+            static RsMutex release3UpdateMtx("RsDataService release 3 update");
+            RsStackMutex updateStack(release3UpdateMtx);
+
+            // Commits the release itself
+            ok = locked_updateToRelease3();
+
+            if (ok) {
+                currentDatabaseRelease = newRelease;
+            }
+        }
     }
 
     if (ok) {
@@ -484,6 +738,127 @@ bool RsDataService::finishReleaseUpdate(int release, bool result)
     return result;
 }
 
+bool RsDataService::locked_updateToRelease3()
+{
+#ifdef RS_DATA_SERVICE_DEBUG_TIME
+    rstime::RsScopeTimer timer("");
+#endif
+
+    bool ok = true;
+
+    // When the old tables are there, a previous update was interrupted and
+    // the rows left in them are still to be copied.
+    if(!mDb->tableExists(MSG_TABLE_NAME_OLD))
+    {
+        std::cerr << "Database " << mDbName << " converting tables to release 3." << std::endl;
+
+        ok = mDb->beginTransaction();
+
+        // The old indexes and trigger would follow the renamed tables
+        ok = ok && mDb->execSQL("DROP TRIGGER IF EXISTS " + GRP_LAST_POST_UPDATE_TRIGGER + ";");
+        ok = ok && mDb->execSQL("DROP INDEX IF EXISTS " + MSG_INDEX_GRPID + ";");
+        ok = ok && mDb->execSQL("DROP INDEX IF EXISTS " + MSG_INDEX_GRPID_TS + ";");
+        ok = ok && mDb->execSQL("DROP INDEX IF EXISTS " + MSG_INDEX_GRPID_PARENTID + ";");
+        ok = ok && mDb->execSQL("DROP INDEX IF EXISTS " + MSG_INDEX_GRPID_THREADID + ";");
+        ok = ok && mDb->execSQL("DROP INDEX IF EXISTS " + MSG_INDEX_GRPID_ORIGMSGID + ";");
+
+        ok = ok && mDb->execSQL("ALTER TABLE " + MSG_TABLE_NAME + " RENAME TO " + MSG_TABLE_NAME_OLD + ";");
+        ok = ok && mDb->execSQL("ALTER TABLE " + GRP_TABLE_NAME + " RENAME TO " + GRP_TABLE_NAME_OLD + ";");
+
+        ok = ok && createTables(mDb);
+
+        ok = endTransaction(mDb, ok);
+    }
+    else
+        std::cerr << "Database " << mDbName << " resuming update to release 3." << std::endl;
+
+    const std::vector<MigratedColumn> msgColumns = {
+        { KEY_MSG_ID,          MigratedColumn::MSG_ID },
+        { KEY_GRP_ID,          MigratedColumn::GRP_ID },
+        { KEY_NXS_FLAGS,       MigratedColumn::INT    },
+        { KEY_ORIG_MSG_ID,     MigratedColumn::MSG_ID },
+        { KEY_TIME_STAMP,      MigratedColumn::INT    },
+        { KEY_NXS_IDENTITY,    MigratedColumn::TEXT   },
+        { KEY_SIGN_SET,        MigratedColumn::BLOB   },
+        { KEY_NXS_DATA,        MigratedColumn::DATA   },
+        { KEY_NXS_DATA_LEN,    MigratedColumn::INT    },
+        { KEY_MSG_STATUS,      MigratedColumn::INT    },
+        { KEY_CHILD_TS,        MigratedColumn::INT    },
+        { KEY_NXS_META,        MigratedColumn::DATA   },
+        { KEY_MSG_THREAD_ID,   MigratedColumn::MSG_ID },
+        { KEY_MSG_PARENT_ID,   MigratedColumn::MSG_ID },
+        { KEY_MSG_NAME,        MigratedColumn::TEXT   },
+        { KEY_NXS_SERV_STRING, MigratedColumn::TEXT   },
+        { KEY_NXS_HASH,        MigratedColumn::TEXT   },
+        { KEY_RECV_TS,         MigratedColumn::INT    }
+    };
+
+    const std::vector<MigratedColumn> grpColumns = {
+        { KEY_GRP_ID,              MigratedColumn::GRP_ID },
+        { KEY_TIME_STAMP,          MigratedColumn::INT    },
+        { KEY_NXS_DATA,            MigratedColumn::DATA   },
+        { KEY_NXS_DATA_LEN,        MigratedColumn::INT    },
+        { KEY_KEY_SET,             MigratedColumn::BLOB   },
+        { KEY_NXS_META,            MigratedColumn::DATA   },
+        { KEY_GRP_NAME,            MigratedColumn::TEXT   },
+        { KEY_GRP_LAST_POST,       MigratedColumn::INT    },
+        { KEY_GRP_POP,             MigratedColumn::INT    },
+        { KEY_MSG_COUNT,           MigratedColumn::INT    },
+        { KEY_GRP_SUBCR_FLAG,      MigratedColumn::INT    },
+        { KEY_GRP_STATUS,          MigratedColumn::INT    },
+        { KEY_NXS_IDENTITY,        MigratedColumn::TEXT   },
+        { KEY_ORIG_GRP_ID,         MigratedColumn::TEXT   },
+        { KEY_NXS_SERV_STRING,     MigratedColumn::TEXT   },
+        { KEY_NXS_FLAGS,           MigratedColumn::INT    },
+        { KEY_GRP_AUTHEN_FLAGS,    MigratedColumn::INT    },
+        { KEY_GRP_SIGN_FLAGS,      MigratedColumn::INT    },
+        { KEY_GRP_CIRCLE_ID,       MigratedColumn::TEXT   },
+        { KEY_GRP_CIRCLE_TYPE,     MigratedColumn::INT    },
+        { KEY_GRP_INTERNAL_CIRCLE, MigratedColumn::TEXT   },
+        { KEY_GRP_ORIGINATOR,      MigratedColumn::TEXT   },
+        { KEY_NXS_HASH,            MigratedColumn::TEXT   },
+        { KEY_RECV_TS,             MigratedColumn::INT    },
+        { KEY_PARENT_GRP_ID,       MigratedColumn::TEXT   },
+        { KEY_GRP_REP_CUTOFF,      MigratedColumn::INT    }
+    };
+
+    uint32_t msgCount = 0, grpCount = 0;
+
+    // One transaction per batch keeps the journal small. No VACUUM at the
+    // end: the pages of the moved rows are already reused.
+    for(bool done = false; ok && !done;)
+    {
+        ok = mDb->beginTransaction();
+        ok = ok && copyTableToRelease3(mDb, MSG_TABLE_NAME_OLD, MSG_TABLE_NAME, MSG_DATA_TABLE_NAME, msgColumns, msgCount, done);
+        ok = endTransaction(mDb, ok);
+    }
+
+    for(bool done = false; ok && !done;)
+    {
+        ok = mDb->beginTransaction();
+        ok = ok && copyTableToRelease3(mDb, GRP_TABLE_NAME_OLD, GRP_TABLE_NAME, GRP_DATA_TABLE_NAME, grpColumns, grpCount, done);
+        ok = endTransaction(mDb, ok);
+    }
+
+    // lastPost is copied as is, so the trigger is only created afterwards
+    if(ok)
+    {
+        ok = startReleaseUpdate(3);
+        ok = ok && createLastPostTrigger(mDb);
+        ok = ok && mDb->execSQL("DROP TABLE " + MSG_TABLE_NAME_OLD + ";");
+        ok = ok && mDb->execSQL("DROP TABLE " + GRP_TABLE_NAME_OLD + ";");
+        ok = finishReleaseUpdate(3, ok);
+    }
+
+    std::cerr << "Database " << mDbName << ": " << grpCount << " groups and " << msgCount << " messages converted." << std::endl;
+
+#ifdef RS_DATA_SERVICE_DEBUG_TIME
+    std::cerr << "RsDataService::locked_updateToRelease3() " << mDbName << ", Time: " << timer.duration() << std::endl;
+#endif
+
+    return ok;
+}
+
 std::shared_ptr<RsGxsGrpMetaData> RsDataService::locked_getGrpMeta(RetroCursor& c, int colOffset)
 {
 #ifdef RS_DATA_SERVICE_DEBUG
@@ -499,10 +874,9 @@ std::shared_ptr<RsGxsGrpMetaData> RsDataService::locked_getGrpMeta(RetroCursor&
 
     // grpId
     std::string tempId;
-    c.getString(mColGrpMeta_GrpId + colOffset, tempId);
 
     std::shared_ptr<RsGxsGrpMetaData> grpMeta ;
-	RsGxsGroupId grpId(tempId) ;
+	RsGxsGroupId grpId = getId<RsGxsGroupId>(c, mColGrpMeta_GrpId + colOffset) ;
 
     if(grpId.isNull())			// not in the DB!
         return nullptr;
@@ -515,7 +889,7 @@ std::shared_ptr<RsGxsGrpMetaData> RsDataService::locked_getGrpMeta(RetroCursor&
     if(!grpMeta->mGroupId.isNull())	// the grpMeta is already initialized because it comes from the cache
         return grpMeta;
 
-    grpMeta->mGroupId = RsGxsGroupId(tempId);
+    grpMeta->mGroupId = grpId;
     c.getString(mColGrpMeta_NxsIdentity + colOffset, tempId);
     grpMeta->mAuthorId = RsGxsId(tempId);
 
@@ -616,7 +990,7 @@ RsNxsGrp* RsDataService::locked_getGroup(RetroCursor &c)
     uint32_t data_len = 0;
 
     // grpId
-    c.getStringT<RsGxsGroupId>(mColGrp_GrpId, grp->grpId);
+    grp->grpId = getId<RsGxsGroupId>(c, mColGrp_GrpId);
     ok &= !grp->grpId.isNull();
 
     offset = 0; data_len = 0;
@@ -653,12 +1027,8 @@ std::shared_ptr<RsGxsMsgMetaData> RsDataService::locked_getMsgMeta(RetroCursor &
     RsGxsGroupId group_id;
     RsGxsMessageId msg_id;
 
-    std::string gId;
-    c.getString(mColMsgMeta_GrpId + colOffset, gId);
-    group_id = RsGxsGroupId(gId);
-    std::string temp;
-    c.getString(mColMsgMeta_MsgId + colOffset, temp);
-    msg_id = RsGxsMessageId(temp);
+    group_id = getId<RsGxsGroupId>(c, mColMsgMeta_GrpId + colOffset);
+    msg_id = getId<RsGxsMessageId>(c, mColMsgMeta_MsgId + colOffset);
 
     // without these, a msg is meaningless
     if(group_id.isNull() || msg_id.isNull())
@@ -677,8 +1047,8 @@ std::shared_ptr<RsGxsMsgMetaData> RsDataService::locked_getMsgMeta(RetroCursor &
 	msgMeta->mGroupId = group_id;
 	msgMeta->mMsgId = msg_id;
 
-    c.getString(mColMsgMeta_OrigMsgId + colOffset, temp);
-    msgMeta->mOrigMsgId = RsGxsMessageId(temp);
+    std::string temp;
+    msgMeta->mOrigMsgId = getId<RsGxsMessageId>(c, mColMsgMeta_OrigMsgId + colOffset);
     c.getString(mColMsgMeta_NxsIdentity + colOffset, temp);
     msgMeta->mAuthorId = RsGxsId(temp);
     c.getString(mColMsgMeta_Name + colOffset, msgMeta->mMsgName);
@@ -698,10 +1068,8 @@ std::shared_ptr<RsGxsMsgMetaData> RsDataService::locked_getMsgMeta(RetroCursor &
     offset = 0; data_len = 0;
 
     // thread and parent id
-    c.getString(mColMsgMeta_MsgThreadId + colOffset, temp);
-    msgMeta->mThreadId = RsGxsMessageId(temp);
-    c.getString(mColMsgMeta_MsgParentId + colOffset, temp);
-    msgMeta->mParentId = RsGxsMessageId(temp);
+    msgMeta->mThreadId = getId<RsGxsMessageId>(c, mColMsgMeta_MsgThreadId + colOffset);
+    msgMeta->mParentId = getId<RsGxsMessageId>(c, mColMsgMeta_MsgParentId + colOffset);
 
     // local meta
     msgMeta->mMsgStatus = c.getInt32(mColMsgMeta_MsgStatus + colOffset);
@@ -724,10 +1092,8 @@ RsNxsMsg* RsDataService::locked_getMessage(RetroCursor &c)
     uint32_t data_len = 0,
     offset = 0;
     char* data = NULL;
-    c.getStringT<RsGxsGroupId>(mColMsg_GrpId, msg->grpId);
-    std::string temp;
-    c.getString(mColMsg_MsgId, temp);
-    msg->msgId = RsGxsMessageId(temp);
+    msg->grpId = getId<RsGxsGroupId>(c, mColMsg_GrpId);
+    msg->msgId = getId<RsGxsMessageId>(c, mColMsg_MsgId);
 
     ok &= (!msg->grpId.isNull()) && (!msg->msgId.isNull());
 
@@ -784,17 +1150,17 @@ int RsDataService::storeMessage(const std::list<RsNxsMsg*>& msg)
             continue;
         }
 
-        ContentValue cv;
+        ContentValue cv, dataCv;
 
         uint32_t dataLen = msgPtr->msg.TlvSize();
         char msgData[dataLen];
         uint32_t offset = 0;
         msgPtr->msg.SetTlv(msgData, dataLen, &offset);
-        cv.put(KEY_NXS_DATA, dataLen, msgData);
+        dataCv.put(KEY_NXS_DATA, dataLen, msgData);
 
         cv.put(KEY_NXS_DATA_LEN, (int32_t)dataLen);
-        cv.put(KEY_MSG_ID, msgMetaPtr->mMsgId.toStdString());
-        cv.put(KEY_GRP_ID, msgMetaPtr->mGroupId.toStdString());
+        putId(cv, KEY_MSG_ID, msgMetaPtr->mMsgId);
+        putId(cv, KEY_GRP_ID, msgMetaPtr->mGroupId);
         cv.put(KEY_NXS_SERV_STRING, msgMetaPtr->mServiceString);
         cv.put(KEY_NXS_HASH, msgMetaPtr->mHash.toStdString());
         cv.put(KEY_RECV_TS, (int32_t)msgMetaPtr->recvTS);
@@ -813,18 +1179,18 @@ int RsDataService::storeMessage(const std::list<RsNxsMsg*>& msg)
         offset = 0;
         char metaData[msgPtr->meta.TlvSize()];
         msgPtr->meta.SetTlv(metaData, msgPtr->meta.TlvSize(), &offset);
-        cv.put(KEY_NXS_META, msgPtr->meta.TlvSize(), metaData);
+        dataCv.put(KEY_NXS_META, msgPtr->meta.TlvSize(), metaData);
 
-        cv.put(KEY_MSG_PARENT_ID, msgMetaPtr->mParentId.toStdString());
-        cv.put(KEY_MSG_THREAD_ID, msgMetaPtr->mThreadId.toStdString());
-        cv.put(KEY_ORIG_MSG_ID, msgMetaPtr->mOrigMsgId.toStdString());
+        putId(cv, KEY_MSG_PARENT_ID, msgMetaPtr->mParentId);
+        putId(cv, KEY_MSG_THREAD_ID, msgMetaPtr->mThreadId);
+        putId(cv, KEY_ORIG_MSG_ID, msgMetaPtr->mOrigMsgId);
         cv.put(KEY_MSG_NAME, msgMetaPtr->mMsgName);
 
         // now local meta
         cv.put(KEY_MSG_STATUS, (int32_t)msgMetaPtr->mMsgStatus);
         cv.put(KEY_CHILD_TS, (int32_t)msgMetaPtr->mChildTs);
 
-        if (!mDb->sqlInsert(MSG_TABLE_NAME, "", cv))
+        if (!insertWithData(mDb, MSG_TABLE_NAME, MSG_DATA_TABLE_NAME, cv, dataCv))
         {
             std::cerr << "RsDataService::storeMessage() sqlInsert Failed";
             std::cerr << std::endl;
@@ -887,16 +1253,16 @@ int RsDataService::storeGroup(const std::list<RsNxsGrp*>& grp)
 		 * id signature, admin signatue, key set, last posting ts
 		 * and meta data
 		 **/
-		ContentValue cv;
+		ContentValue cv, dataCv;
 
 		uint32_t dataLen = grpPtr->grp.TlvSize();
 		char grpData[dataLen];
 		uint32_t offset = 0;
 		grpPtr->grp.SetTlv(grpData, dataLen, &offset);
-		cv.put(KEY_NXS_DATA, dataLen, grpData);
+		dataCv.put(KEY_NXS_DATA, dataLen, grpData);
 
 		cv.put(KEY_NXS_DATA_LEN, (int32_t) dataLen);
-		cv.put(KEY_GRP_ID, grpPtr->grpId.toStdString());
+		putId(cv, KEY_GRP_ID, grpPtr->grpId);
 		cv.put(KEY_GRP_NAME, grpMetaPtr->mGroupName);
 		cv.put(KEY_ORIG_GRP_ID, grpMetaPtr->mOrigGrpId.toStdString());
 		cv.put(KEY_NXS_SERV_STRING, grpMetaPtr->mServiceString);
@@ -922,7 +1288,7 @@ int RsDataService::storeGroup(const std::list<RsNxsGrp*>& grp)
 		offset = 0;
 		char metaData[grpPtr->meta.TlvSize()];
 		grpPtr->meta.SetTlv(metaData, grpPtr->meta.TlvSize(), &offset);
-		cv.put(KEY_NXS_META, grpPtr->meta.TlvSize(), metaData);
+		dataCv.put(KEY_NXS_META, grpPtr->meta.TlvSize(), metaData);
 
 		// local meta data
 		cv.put(KEY_GRP_SUBCR_FLAG, (int32_t)grpMetaPtr->mSubscribeFlags);
@@ -933,7 +1299,7 @@ int RsDataService::storeGroup(const std::list<RsNxsGrp*>& grp)
 
 		mGrpMetaDataCache.updateMeta(grpMetaPtr->mGroupId,*grpMetaPtr);
 
-		if (!mDb->sqlInsert(GRP_TABLE_NAME, "", cv))
+		if (!insertWithData(mDb, GRP_TABLE_NAME, GRP_DATA_TABLE_NAME, cv, dataCv))
 		{
 			std::cerr << "RsDataService::storeGroup() sqlInsert Failed";
 			std::cerr << std::endl;
@@ -974,15 +1340,14 @@ int RsDataService::updateGroup(const std::list<RsNxsGrp *> &grp)
          * id signature, admin signatue, key set, last posting ts
          * and meta data
          **/
-        ContentValue cv;
+        ContentValue cv, dataCv;
         uint32_t dataLen = grpPtr->grp.TlvSize();
         char grpData[dataLen];
         uint32_t offset = 0;
         grpPtr->grp.SetTlv(grpData, dataLen, &offset);
-        cv.put(KEY_NXS_DATA, dataLen, grpData);
+        dataCv.put(KEY_NXS_DATA, dataLen, grpData);
 
         cv.put(KEY_NXS_DATA_LEN, (int32_t) dataLen);
-        cv.put(KEY_GRP_ID, grpPtr->grpId.toStdString());
         cv.put(KEY_GRP_NAME, grpMetaPtr->mGroupName);
         cv.put(KEY_ORIG_GRP_ID, grpMetaPtr->mOrigGrpId.toStdString());
         cv.put(KEY_NXS_SERV_STRING, grpMetaPtr->mServiceString);
@@ -1006,7 +1371,7 @@ int RsDataService::updateGroup(const std::list<RsNxsGrp *> &grp)
         offset = 0;
         char metaData[grpPtr->meta.TlvSize()];
         grpPtr->meta.SetTlv(metaData, grpPtr->meta.TlvSize(), &offset);
-        cv.put(KEY_NXS_META, grpPtr->meta.TlvSize(), metaData);
+        dataCv.put(KEY_NXS_META, grpPtr->meta.TlvSize(), metaData);
 
         // local meta data
         cv.put(KEY_GRP_SUBCR_FLAG, (int32_t)grpMetaPtr->mSubscribeFlags);
@@ -1015,7 +1380,8 @@ int RsDataService::updateGroup(const std::list<RsNxsGrp *> &grp)
         cv.put(KEY_GRP_STATUS, (int32_t)grpMetaPtr->mGroupStatus);
         cv.put(KEY_GRP_LAST_POST, (int32_t)grpMetaPtr->mLastPost);
 
-        mDb->sqlUpdate(GRP_TABLE_NAME, "grpId='" + grpPtr->grpId.toStdString() + "'", cv);
+        mDb->sqlUpdate(GRP_TABLE_NAME, KEY_GRP_ID + "=" + sqlId(grpPtr->grpId), cv);
+        mDb->sqlUpdate(GRP_DATA_TABLE_NAME, KEY_ENTRY_ID + "=(SELECT " + KEY_ENTRY_ID + " FROM " + GRP_TABLE_NAME + " WHERE " + KEY_GRP_ID + "=" + sqlId(grpPtr->grpId) + ")", dataCv);
 
         mGrpMetaDataCache.updateMeta(grpMetaPtr->mGroupId,*grpMetaPtr);
 
@@ -1047,7 +1413,7 @@ int RsDataService::updateGroupKeys(const RsGxsGroupId& grpId,const RsTlvSecurity
     cv.put(KEY_KEY_SET, keys.TlvSize(), keySetData);
     cv.put(KEY_GRP_SUBCR_FLAG, (int32_t)subscribe_flags);
 
-    mDb->sqlUpdate(GRP_TABLE_NAME, "grpId='" + grpId.toStdString() + "'", cv);
+    mDb->sqlUpdate(GRP_TABLE_NAME, KEY_GRP_ID + "=" + sqlId(grpId), cv);
 
     // finish transaction
     bool res = mDb->commitTransaction();
@@ -1064,6 +1430,18 @@ bool RsDataService::validSize(RsNxsGrp* grp) const
     return false;
 }
 
+bool RsDataService::storeStateValue(const std::string& key, const std::string& value)
+{
+    return RsDirUtil::saveStringToFile(mDbPath + "." + key, value);
+}
+
+bool RsDataService::retrieveStateValue(const std::string& key, std::string& value)
+{
+    std::string path = mDbPath + "." + key;
+
+    return RsDirUtil::fileExists(path) && RsDirUtil::loadStringFromFile(path, value);
+}
+
 int RsDataService::retrieveNxsGrps(std::map<RsGxsGroupId, RsNxsGrp *> &grp, bool withMeta)
 {
 #ifdef RS_DATA_SERVICE_DEBUG_TIME
@@ -1075,7 +1453,7 @@ int RsDataService::retrieveNxsGrps(std::map<RsGxsGroupId, RsNxsGrp *> &grp, bool
     if(grp.empty())
     {
         RsStackMutex stack(mDbMutex);
-        RetroCursor* c = mDb->sqlQuery(GRP_TABLE_NAME, withMeta ? mGrpColumnsWithMeta : mGrpColumns, "", "");
+        RetroCursor* c = mDb->sqlQuery(GRP_WITH_DATA, withMeta ? mGrpColumnsWithMeta : mGrpColumns, "", "");
 
         if(c)
         {
@@ -1107,7 +1485,7 @@ int RsDataService::retrieveNxsGrps(std::map<RsGxsGroupId, RsNxsGrp *> &grp, bool
         for(; mit != grp.end(); ++mit)
         {
             const RsGxsGroupId& grpId = mit->first;
-            RetroCursor* c = mDb->sqlQuery(GRP_TABLE_NAME, withMeta ? mGrpColumnsWithMeta : mGrpColumns, "grpId='" + grpId.toStdString() + "'", "");
+            RetroCursor* c = mDb->sqlQuery(GRP_WITH_DATA, withMeta ? mGrpColumnsWithMeta : mGrpColumns, KEY_GRP_ID + "=" + sqlId(grpId), "");
 
             if(c)
             {
@@ -1187,7 +1565,7 @@ int RsDataService::retrieveNxsMsgs(const GxsMsgReq &reqIds, GxsMsgResult &msg,
 		{
 			RS_STACK_MUTEX(mDbMutex);
 
-            RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, withMeta ? mMsgColumnsWithMeta : mMsgColumns, KEY_GRP_ID+ "='" + grpId.toStdString() + "'", "");
+            RetroCursor* c = mDb->sqlQuery(MSG_WITH_DATA, withMeta ? mMsgColumnsWithMeta : mMsgColumns, KEY_GRP_ID + "=" + sqlId(grpId), "");
 
             if(c)
                 locked_retrieveMessages(c, msgSet, withMeta ? mColMsg_WithMetaOffset : 0);
@@ -1204,8 +1582,8 @@ int RsDataService::retrieveNxsMsgs(const GxsMsgReq &reqIds, GxsMsgResult &msg,
 			{
                 const RsGxsMessageId& msgId = *sit;
 
-                RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, withMeta ? mMsgColumnsWithMeta : mMsgColumns, KEY_GRP_ID+ "='" + grpId.toStdString()
-                                               + "' AND " + KEY_MSG_ID + "='" + msgId.toStdString() + "'", "");
+                RetroCursor* c = mDb->sqlQuery(MSG_WITH_DATA, withMeta ? mMsgColumnsWithMeta : mMsgColumns, KEY_GRP_ID + "=" + sqlId(grpId)
+                                               + " AND " + KEY_MSG_ID + "=" + sqlId(msgId), "");
 
                 if(c)
                 {
@@ -1278,7 +1656,7 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
                 cache->getFullMetaList(msgMeta[grpId]);
             else
 			{
-				RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID+ "='" + grpId.toStdString() + "'", "");
+				RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID + "=" + sqlId(grpId), "");
 
 				if (c)
 				{
@@ -1308,7 +1686,7 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
                     metaSet.push_back(meta);
                 else
 				{
-					RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID+ "='" + grpId.toStdString() + "' AND " + KEY_MSG_ID + "='" + msgId.toStdString() + "'", "");
+					RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID + "=" + sqlId(grpId) + " AND " + KEY_MSG_ID + "=" + sqlId(msgId), "");
 
                     c->moveToFirst();
                     auto meta = locked_getMsgMeta(*c, 0);
@@ -1338,6 +1716,90 @@ int RsDataService::retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaRes
     return 1;
 }
 
+int RsDataService::retrieveGxsMsgMetaData(const RsGxsGroupId& grpId, const RsGxsMsgMetaFilter& filter, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& msgMeta)
+{
+    std::string where = KEY_GRP_ID + "=" + sqlId(grpId);
+
+    if(filter.mOnlyThreadHeads)
+        where += " AND " + sqlNullMsgId(KEY_MSG_PARENT_ID);
+
+    if(filter.mOnlyOrigMsgs)
+        where += " AND (" + sqlNullMsgId(KEY_ORIG_MSG_ID) + " OR " + KEY_ORIG_MSG_ID + "=" + KEY_MSG_ID + ")";
+    else if(filter.mOnlyLatestMsgs)	// no other message is a new version of this one
+        where += " AND NOT EXISTS (SELECT 1 FROM " + MSG_TABLE_NAME + " AS newer WHERE newer." + KEY_GRP_ID + "=" + MSG_TABLE_NAME + "." + KEY_GRP_ID
+                + " AND newer." + KEY_ORIG_MSG_ID + "=" + MSG_TABLE_NAME + "." + KEY_MSG_ID
+                + " AND newer." + KEY_MSG_ID + "!=" + MSG_TABLE_NAME + "." + KEY_MSG_ID + ")";
+
+    if(!filter.mParentId.isNull())
+        where += " AND " + KEY_MSG_PARENT_ID + "=" + sqlId(filter.mParentId);
+
+    if(!filter.mThreadId.isNull())
+        where += " AND " + KEY_MSG_THREAD_ID + "=" + sqlId(filter.mThreadId);
+
+    if(!filter.mOrigMsgId.isNull())
+        where += " AND (" + KEY_ORIG_MSG_ID + "=" + sqlId(filter.mOrigMsgId) + " OR " + KEY_MSG_ID + "=" + sqlId(filter.mOrigMsgId) + ")";
+
+    if(filter.mStatusMask)
+        where += " AND (" + KEY_MSG_STATUS + " & " + std::to_string(filter.mStatusMask) + ")=" + std::to_string(filter.mStatusValue & filter.mStatusMask);
+
+    if(filter.mFlagsMask)
+        where += " AND (" + KEY_NXS_FLAGS + " & " + std::to_string(filter.mFlagsMask) + ")=" + std::to_string(filter.mFlagsValue & filter.mFlagsMask);
+
+    if(filter.mMinPublishTs)
+        where += " AND " + KEY_TIME_STAMP + ">=" + std::to_string(filter.mMinPublishTs);
+
+    if(filter.mMaxPublishTs)
+        where += " AND " + KEY_TIME_STAMP + "<=" + std::to_string(filter.mMaxPublishTs);
+
+    if(!filter.mPageAfterMsgId.isNull())
+        where += " AND (" + KEY_TIME_STAMP + "<" + std::to_string(filter.mPageAfterTs) + " OR (" + KEY_TIME_STAMP + "=" + std::to_string(filter.mPageAfterTs)
+                + " AND " + KEY_MSG_ID + "<" + sqlId(filter.mPageAfterMsgId) + "))";
+
+    RsStackMutex stack(mDbMutex);
+
+#ifdef RS_DATA_SERVICE_DEBUG_TIME
+    rstime::RsScopeTimer timer("");
+#endif
+
+    RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, where, KEY_TIME_STAMP + " DESC," + KEY_MSG_ID + " DESC", filter.mMaxCount);
+
+    if(!c)
+        return 0;
+
+    // Metas already in the cache are shared, so that local changes are seen
+    // by everybody.
+
+    t_MetaDataCache<RsGxsMessageId,RsGxsMsgMetaData> *cache(mUseCache? (&mMsgMetaDataCache[grpId]) : nullptr);
+
+    for(bool valid = c->moveToFirst(); valid; valid = c->moveToNext())
+    {
+        auto meta = locked_getMsgMeta(*c, 0);
+
+        if(!meta)
+            continue;
+
+        if(cache)
+        {
+            auto cached = cache->getMeta(meta->mMsgId);
+
+            if(cached)
+                meta = cached;
+            else
+                cache->updateMeta(meta->mMsgId, meta);
+        }
+
+        msgMeta.push_back(meta);
+    }
+
+    delete c;
+
+#ifdef RS_DATA_SERVICE_DEBUG_TIME
+    std::cerr << "RsDataService::retrieveGxsMsgMetaData() " << mDbName << ", filtered request, Results: " << msgMeta.size() << ", Time: " << timer.duration() << std::endl;
+#endif
+
+    return 1;
+}
+
 void RsDataService::locked_retrieveGrpMetaList(RetroCursor *c, std::map<RsGxsGroupId,std::shared_ptr<RsGxsGrpMetaData> >& grpMeta)
 {
 	if(!c)
@@ -1442,7 +1904,7 @@ int RsDataService::retrieveGxsGrpMetaData(std::map<RsGxsGroupId,std::shared_ptr<
 #endif
 
 				const RsGxsGroupId& grpId = mit->first;
-				RetroCursor* c = mDb->sqlQuery(GRP_TABLE_NAME, mGrpMetaColumns, "grpId='" + grpId.toStdString() + "'", "");
+				RetroCursor* c = mDb->sqlQuery(GRP_TABLE_NAME, mGrpMetaColumns, KEY_GRP_ID + "=" + sqlId(grpId), "");
 
 				c->moveToFirst();
 
@@ -1493,11 +1955,18 @@ int RsDataService::resetDataStore()
     {
         RsStackMutex stack(mDbMutex);
 
-        mDb->execSQL("DROP INDEX " + MSG_INDEX_GRPID);
+        mDb->execSQL("DROP INDEX " + MSG_INDEX_GRPID_TS);
+        mDb->execSQL("DROP INDEX " + MSG_INDEX_GRPID_PARENTID);
+        mDb->execSQL("DROP INDEX " + MSG_INDEX_GRPID_THREADID);
+        mDb->execSQL("DROP INDEX " + MSG_INDEX_GRPID_ORIGMSGID);
         mDb->execSQL("DROP TABLE " + DATABASE_RELEASE_TABLE_NAME);
+        mDb->execSQL("DROP TRIGGER " + GRP_LAST_POST_UPDATE_TRIGGER);
+        mDb->execSQL("DROP TRIGGER " + MSG_DATA_DELETE_TRIGGER);
+        mDb->execSQL("DROP TRIGGER " + GRP_DATA_DELETE_TRIGGER);
         mDb->execSQL("DROP TABLE " + MSG_TABLE_NAME);
+        mDb->execSQL("DROP TABLE " + MSG_DATA_TABLE_NAME);
         mDb->execSQL("DROP TABLE " + GRP_TABLE_NAME);
-        mDb->execSQL("DROP TRIGGER " + GRP_LAST_POST_UPDATE_TRIGGER);
+        mDb->execSQL("DROP TABLE " + GRP_DATA_TABLE_NAME);
     }
 
     // recreate database
@@ -1519,13 +1988,13 @@ int RsDataService::updateGroupMetaData(const GrpLocMetaData& meta)
     std::cerr << (void*)this << ": erasing old entry from cache." << std::endl;
 #endif
 
-    if( mDb->sqlUpdate(GRP_TABLE_NAME,  KEY_GRP_ID+ "='" + grpId.toStdString() + "'", meta.val))
+    if( mDb->sqlUpdate(GRP_TABLE_NAME,  KEY_GRP_ID + "=" + sqlId(grpId), meta.val))
     {
         // If we use the cache, update the meta data immediately.
 
         if(mUseCache)
         {
-            RetroCursor* c = mDb->sqlQuery(GRP_TABLE_NAME, mGrpMetaColumns, "grpId='" + grpId.toStdString() + "'", "");
+            RetroCursor* c = mDb->sqlQuery(GRP_TABLE_NAME, mGrpMetaColumns, KEY_GRP_ID + "=" + sqlId(grpId), "");
 
             c->moveToFirst();
 
@@ -1555,13 +2024,13 @@ int RsDataService::updateMessageMetaData(const MsgLocMetaData& metaData)
     const RsGxsGroupId& grpId = metaData.msgId.first;
     const RsGxsMessageId& msgId = metaData.msgId.second;
 
-    if(mDb->sqlUpdate(MSG_TABLE_NAME,  KEY_GRP_ID+ "='" + grpId.toStdString() + "' AND " + KEY_MSG_ID + "='" + msgId.toStdString() + "'", metaData.val) )
+    if(mDb->sqlUpdate(MSG_TABLE_NAME,  KEY_GRP_ID + "=" + sqlId(grpId) + " AND " + KEY_MSG_ID + "=" + sqlId(msgId), metaData.val) )
     {
         // If we use the cache, update the meta data immediately.
 
         if(mUseCache)
         {
-            RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID+ "='" + grpId.toStdString() + "' AND " + KEY_MSG_ID + "='" + msgId.toStdString() + "'", "");
+            RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgMetaColumns, KEY_GRP_ID + "=" + sqlId(grpId) + " AND " + KEY_MSG_ID + "=" + sqlId(msgId), "");
 
             c->moveToFirst();
 
@@ -1628,9 +2097,7 @@ int RsDataService::retrieveGroupIds(std::vector<RsGxsGroupId> &grpIds)
 
         while(valid)
         {
-            std::string grpId;
-            c->getString(mColGrpId_GrpId, grpId);
-            grpIds.push_back(RsGxsGroupId(grpId));
+            grpIds.push_back(getId<RsGxsGroupId>(*c, mColGrpId_GrpId));
             valid = c->moveToNext();
 
 #ifdef RS_DATA_SERVICE_DEBUG_TIME
@@ -1657,7 +2124,7 @@ int RsDataService::retrieveMsgIds(const RsGxsGroupId& grpId, RsGxsMessageId::std
     int resultCount = 0;
 #endif
 
-    RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgIdColumn, KEY_GRP_ID+ "='" + grpId.toStdString() + "'", "");
+    RetroCursor* c = mDb->sqlQuery(MSG_TABLE_NAME, mMsgIdColumn, KEY_GRP_ID + "=" + sqlId(grpId), "");
 
     if(c)
     {
@@ -1665,13 +2132,10 @@ int RsDataService::retrieveMsgIds(const RsGxsGroupId& grpId, RsGxsMessageId::std
 
         while(valid)
         {
-            std::string msgId;
-            c->getString(mColMsgId_MsgId, msgId);
-
             if(c->columnCount() != 1)
             std::cerr << "(EE) ********* not retrieving all columns!!" << std::endl;
 
-            msgIds.insert(RsGxsMessageId(msgId));
+            msgIds.insert(getId<RsGxsMessageId>(*c, mColMsgId_MsgId));
             valid = c->moveToNext();
 
 #ifdef RS_DATA_SERVICE_DEBUG_TIME
@@ -1707,7 +2171,7 @@ bool RsDataService::locked_removeMessageEntries(const GxsMsgReq& msgIds)
 
         for(auto& msgId:msgsV)
         {
-            mDb->sqlDelete(MSG_TABLE_NAME, KEY_GRP_ID+ "='" + grpId.toStdString() + "' AND " + KEY_MSG_ID + "='" + msgId.toStdString() + "'", "");
+            mDb->sqlDelete(MSG_TABLE_NAME, KEY_GRP_ID + "=" + sqlId(grpId) + " AND " + KEY_MSG_ID + "=" + sqlId(msgId), "");
 
             cache.clear(msgId);
         }
@@ -1725,7 +2189,7 @@ bool RsDataService::locked_removeGroupEntries(const std::vector<RsGxsGroupId>& g
 
     for(auto grpId:grpIds)
     {
-        mDb->sqlDelete(GRP_TABLE_NAME, KEY_GRP_ID+ "='" + grpId.toStdString() + "'", "");
+        mDb->sqlDelete(GRP_TABLE_NAME, KEY_GRP_ID + "=" + sqlId(grpId), "");
 
 		// also remove the group meta from cache.
 		mGrpMetaDataCache.clear(grpId) ;
@@ -168,6 +168,15 @@ public:
      */
     int retrieveGxsMsgMetaData(const GxsMsgReq& reqIds, GxsMsgMetaResult& msgMeta) override;
 
+    /*!
+     * Retrieves meta data of the messages of a group matching a filter
+     * @param grpId group of the messages
+     * @param filter conditions on the messages, and paging
+     * @param msgMeta meta data of the matching messages, newest first
+     * @return error code
+     */
+    int retrieveGxsMsgMetaData(const RsGxsGroupId& grpId, const RsGxsMsgMetaFilter& filter, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& msgMeta) override;
+
     /*!
      * remove msgs in data store
      * @param grpId group Id of message to be removed
@@ -259,6 +268,12 @@ public:
     bool validSize(RsNxsMsg* msg) const override;
     bool validSize(RsNxsGrp* grp) const override;
 
+    /*!
+     * Values are kept in small files next to the database
+     */
+    bool storeStateValue(const std::string& key, const std::string& value) override;
+    bool retrieveStateValue(const std::string& key, std::string& value) override;
+
     /*!
      * Convenience function used to only update group keys. This is used when sending
      * publish keys between peers.
@@ -354,6 +369,14 @@ private:
      */
     bool finishReleaseUpdate(int release, bool result);
 
+    /*!
+     * Converts the tables of release 2 to the layout of release 3.
+     * Rows are moved in batches, each one in its own transaction, so that an
+     * interrupted update resumes at next start where it stopped.
+     * @return true/false
+     */
+    bool locked_updateToRelease3();
+
 private:
 
     RsMutex mDbMutex;
@@ -90,6 +90,46 @@ typedef std::map<RsGxsGroupId,      std::vector<RsNxsMsg*> > NxsMsgDataResult;
 typedef std::map<RsGxsGrpMsgIdPair, std::vector<RsNxsMsg*> > NxsMsgRelatedDataResult;
 typedef std::map<RsGxsGroupId,      std::vector<RsNxsMsg*> > GxsMsgResult; // <grpId, msgs>
 
+/*!
+ * Conditions on the messages of a group, evaluated by the data store so that
+ * messages which are filtered out are not even loaded. Matching messages are
+ * sorted newest first (publish time, then message id), which allows to get
+ * them by pages: mMaxCount messages at a time, each page starting after the
+ * last message of the previous one.
+ */
+struct RsGxsMsgMetaFilter
+{
+	RsGxsMsgMetaFilter() :
+	    mOnlyThreadHeads(false), mOnlyOrigMsgs(false), mOnlyLatestMsgs(false),
+	    mStatusMask(0), mStatusValue(0), mFlagsMask(0), mFlagsValue(0),
+	    mMinPublishTs(0), mMaxPublishTs(0), mMaxCount(0), mPageAfterTs(0) {}
+
+	bool mOnlyThreadHeads;	/// messages without parent
+	bool mOnlyOrigMsgs;		/// first version of edited messages
+	bool mOnlyLatestMsgs;	/// messages which have no newer version
+
+	RsGxsMessageId mParentId;	/// if not null, only replies to this message
+	RsGxsMessageId mThreadId;	/// if not null, only messages of this thread
+	RsGxsMessageId mOrigMsgId;	/// if not null, only versions of this message
+
+	/// keep messages with (status & mStatusMask) == (mStatusValue & mStatusMask)
+	uint32_t mStatusMask;
+	uint32_t mStatusValue;
+
+	/// keep messages with (flags & mFlagsMask) == (mFlagsValue & mFlagsMask)
+	uint32_t mFlagsMask;
+	uint32_t mFlagsValue;
+
+	rstime_t mMinPublishTs;	/// 0 for no limit
+	rstime_t mMaxPublishTs;	/// 0 for no limit
+
+	uint32_t mMaxCount;		/// 0 for no limit
+
+	/// if mPageAfterMsgId is not null, the page starts after this message
+	rstime_t mPageAfterTs;
+	RsGxsMessageId mPageAfterMsgId;
+};
+
 /*!
  * The main role of GDS is the preparation and handing out of messages requested from
  * RsGeneralExchangeService and RsGeneralExchangeService
@@ -175,6 +215,15 @@ public:
      */
     virtual int retrieveGxsMsgMetaData(const GxsMsgReq& msgIds, GxsMsgMetaResult& msgMeta) = 0;
 
+    /*!
+     * Retrieves meta data of the messages of a group matching a filter
+     * @param grpId group of the messages
+     * @param filter conditions on the messages, and paging
+     * @param msgMeta meta data of the matching messages, newest first
+     * @return error code
+     */
+    virtual int retrieveGxsMsgMetaData(const RsGxsGroupId& grpId, const RsGxsMsgMetaFilter& filter, std::vector<std::shared_ptr<RsGxsMsgMetaData> >& msgMeta) = 0;
+
     /*!
      * remove msgs in data store listed in msgIds param
      * @param msgIds ids of messages to be removed
@@ -278,4 +327,16 @@ public:
      */
     virtual bool validSize(RsNxsGrp* grp) const = 0 ;
 
+    /*!
+     * Keeps a small value along with the data, so that it survives restarts.
+     * @param key name of the value, made of letters, digits and underscores
+     * @return false if not supported by the data store, or on error
+     */
+    virtual bool storeStateValue(const std::string& /*key*/, const std::string& /*value*/) { return false; }
+
+    /*!
+     * @return false if the value was never stored, or if not supported
+     */
+    virtual bool retrieveStateValue(const std::string& /*key*/, std::string& /*value*/) { return false; }
+
 };
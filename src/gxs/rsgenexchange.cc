@@ -23,6 +23,7 @@
  *******************************************************************************/
 #include <unistd.h>
 #include <algorithm>
+#include <thread>
 
 #include "pqi/pqihash.h"
 #include "rsgenexchange.h"
@@ -67,6 +68,8 @@ static const uint32_t INDEX_AUTHEN_ADMIN        = 0x00000040; // admin key
 static const uint32_t MSG_CLEANUP_PERIOD     = 60*59; // 59 minutes
 static const uint32_t INTEGRITY_CHECK_PERIOD = 60*31; // 31 minutes
 
+#define INTEGRITY_CURSOR_KEY "integrity_cursor"
+
 #define GXS_MASK "GXS_MASK_HACK"
 
 /*
@@ -198,6 +201,11 @@ RsGenExchange::RsGenExchange(
   VALIDATE_MAX_WAITING_TIME(60)
 {
     mDataAccess = new RsGxsDataAccess(gds);
+
+    // the hash check resumes where it stopped before the restart
+    std::string cursor;
+    if(mDataStore->retrieveStateValue(INTEGRITY_CURSOR_KEY, cursor))
+        mIntegrityCursor.fromString(cursor);
 }
 
 void RsGenExchange::setNetworkExchangeService(RsNetworkExchangeService *ns)
@@ -211,6 +219,14 @@ void RsGenExchange::setNetworkExchangeService(RsNetworkExchangeService *ns)
 RsGenExchange::~RsGenExchange()
 {
     // need to destruct in a certain order (bad thing, TODO: put down instance ownership rules!)
+    if(mIntegrityCheck)
+    {
+        // the hash check may run for minutes, don't let it use the data store below
+        mIntegrityCheck->fullstop();
+        delete mIntegrityCheck;
+        mIntegrityCheck = NULL;
+    }
+
     delete mNetService;
 
     delete mDataAccess;
@@ -236,10 +252,10 @@ bool RsGenExchange::getGroupServerUpdateTS(const RsGxsGroupId& gid, rstime_t& gr
 
 void RsGenExchange::threadTick()
 {
-	static const double timeDelta = 0.1; // slow tick in sec
-
 	tick();
-	rstime::rs_usleep((int) (timeDelta * 1000 *1000)); // timeDelta sec
+
+	if(!isScheduled())
+		std::this_thread::sleep_for(tickPeriod());
 }
 
 void RsGenExchange::tick()
@@ -325,7 +341,8 @@ void RsGenExchange::tick()
 			if(!mIntegrityCheck)
 			{
 				mIntegrityCheck = new RsGxsIntegrityCheck( mDataStore, this,
-				                                           *mSerialiser, mGixs);
+				                                           *mSerialiser, mGixs,
+				                                           mIntegrityCursor );
 				std::stringstream ss;
 				ss << std::hex << mServType;
 				mChecking = mIntegrityCheck->start("gxs int chk "+ss.str());
@@ -336,12 +353,20 @@ void RsGenExchange::tick()
 		{
             std::vector<RsGxsGroupId> grpIds;
             GxsMsgReq msgIds;
+            std::string oldCursor, newCursor;
 
             {
                 RS_STACK_MUTEX(mGenMtx) ;
                 mIntegrityCheck->getDeletedIds(grpIds, msgIds);
+
+                oldCursor = mIntegrityCursor.toString();
+                mIntegrityCursor = mIntegrityCheck->getCursor();
+                newCursor = mIntegrityCursor.toString();
             }
 
+            if(newCursor != oldCursor)
+                mDataStore->storeStateValue(INTEGRITY_CURSOR_KEY, newCursor);
+
             if(!msgIds.empty())
             {
                 uint32_t token1=0;
@@ -1703,6 +1728,7 @@ void RsGenExchange::receiveNewGroups(const std::vector<RsNxsGrp *> &groups)
     	}
     }
 
+    wakeup();
 }
 
 
@@ -1740,6 +1766,8 @@ void RsGenExchange::receiveNewMessages(const std::vector<RsNxsMsg *>& messages)
 			delete msg;
 		}
 	}
+
+	wakeup();
 }
 
 void RsGenExchange::receiveDistantSearchResults(TurtleRequestId id,const RsGxsGroupId &/*grpId*/)
@@ -1854,6 +1882,7 @@ void RsGenExchange::publishGroup(uint32_t& token, RsGxsGrpItem *grpItem)
     token = mDataAccess->generatePublicToken();
     GxsGrpPendingSign ggps(grpItem, token);
     mGrpsToPublish.push_back(ggps);
+    wakeup();
 
 #ifdef GEN_EXCH_DEBUG
     std::cerr << "RsGenExchange::publishGroup() token: " << token;
@@ -1875,6 +1904,7 @@ void RsGenExchange::updateGroup(uint32_t& token, RsGxsGrpItem* grpItem)
 	RS_STACK_MUTEX(mGenMtx) ;
 	token = mDataAccess->generatePublicToken();
 	mGroupUpdatePublish.push_back(GroupUpdatePublish(grpItem, token));
+	wakeup();
 
 #ifdef GEN_EXCH_DEBUG
 	std::cerr << "RsGenExchange::updateGroup() token: " << token;
@@ -1887,6 +1917,7 @@ void RsGenExchange::deleteGroup(uint32_t& token, const RsGxsGroupId& grpId)
 	RS_STACK_MUTEX(mGenMtx) ;
 	token = mDataAccess->generatePublicToken();
 	mGroupDeletePublish.push_back(GroupDeletePublish(grpId, token));
+	wakeup();
 
 #ifdef GEN_EXCH_DEBUG
 	std::cerr << "RsGenExchange::deleteGroup() token: " << token;
@@ -1899,6 +1930,7 @@ void RsGenExchange::deleteMsgs(uint32_t& token, const GxsMsgReq& msgs)
 
 	token = mDataAccess->generatePublicToken();
 	mMsgDeletePublish.push_back(MsgDeletePublish(msgs, token));
+	wakeup();
 
 	// This code below will suspend any requests of the deleted messages for 24 hrs. This of course only works
 	// if all friend nodes consistently delete the messages in the mean time.
@@ -1914,6 +1946,7 @@ void RsGenExchange::publishMsg(uint32_t& token, RsGxsMsgItem *msgItem)
 					RS_STACK_MUTEX(mGenMtx) ;
     token = mDataAccess->generatePublicToken();
     mMsgsToPublish.insert(std::make_pair(token, msgItem));
+    wakeup();
 
 #ifdef GEN_EXCH_DEBUG	
     std::cerr << "RsGenExchange::publishMsg() token: " << token;
@@ -1995,6 +2028,7 @@ void RsGenExchange::setGroupSubscribeFlags(uint32_t& token, const RsGxsGroupId&
     g.val.put(RsGeneralDataService::GRP_META_SUBSCRIBE_FLAG, (int32_t)flag);
     g.val.put(RsGeneralDataService::GRP_META_SUBSCRIBE_FLAG+GXS_MASK, (int32_t)mask); // HACK, need to perform mask operation in a non-blocking location
     mGrpLocMetaMap.insert(std::make_pair(token, g));
+    wakeup();
 }
 
 void RsGenExchange::setGroupStatusFlags(uint32_t& token, const RsGxsGroupId& grpId, const uint32_t& status, const uint32_t& mask)
@@ -2008,6 +2042,7 @@ void RsGenExchange::setGroupStatusFlags(uint32_t& token, const RsGxsGroupId& grp
     g.val.put(RsGeneralDataService::GRP_META_STATUS, (int32_t)status);
     g.val.put(RsGeneralDataService::GRP_META_STATUS+GXS_MASK, (int32_t)mask); // HACK, need to perform mask operation in a non-blocking location
     mGrpLocMetaMap.insert(std::make_pair(token, g));
+    wakeup();
 }
 
 
@@ -2020,6 +2055,7 @@ void RsGenExchange::setGroupServiceString(uint32_t& token, const RsGxsGroupId& g
     g.grpId = grpId;
     g.val.put(RsGeneralDataService::GRP_META_SERV_STRING, servString);
     mGrpLocMetaMap.insert(std::make_pair(token, g));
+    wakeup();
 }
 
 void RsGenExchange::setMsgStatusFlags(uint32_t& token, const RsGxsGrpMsgIdPair& msgId, const uint32_t& status, const uint32_t& mask)
@@ -2033,6 +2069,7 @@ void RsGenExchange::setMsgStatusFlags(uint32_t& token, const RsGxsGrpMsgIdPair&
     m.val.put(RsGeneralDataService::MSG_META_STATUS+GXS_MASK, (int32_t)mask); // HACK, need to perform mask operation in a non-blocking location
     m.msgId = msgId;
     mMsgLocMetaMap.insert(std::make_pair(token, m));
+    wakeup();
 }
 
 void RsGenExchange::setMsgServiceString(uint32_t& token, const RsGxsGrpMsgIdPair& msgId, const std::string& servString )
@@ -2044,6 +2081,7 @@ void RsGenExchange::setMsgServiceString(uint32_t& token, const RsGxsGrpMsgIdPair
     m.val.put(RsGeneralDataService::MSG_META_SERV_STRING, servString);
     m.msgId = msgId;
     mMsgLocMetaMap.insert(std::make_pair(token, m));
+    wakeup();
 }
 
 void RsGenExchange::processMsgMetaChanges()
@@ -3575,6 +3613,7 @@ void RsGenExchange::setGroupReputationCutOff(uint32_t& token, const RsGxsGroupId
     g.grpId = grpId;
     g.val.put(RsGeneralDataService::GRP_META_CUTOFF_LEVEL, (int32_t)CutOff);
     mGrpLocMetaMap.insert(std::make_pair(token, g));
+    wakeup();
 }
 
 void RsGenExchange::removeDeleteExistingMessages( std::list<RsNxsMsg*>& msgs, GxsMsgReq& msgIdsNotify)
@@ -23,6 +23,7 @@
 #define RSGENEXCHANGE_H
 
 #include <queue>
+#include <chrono>
 #include "util/rstime.h"
 
 #include "rsgxs.h"
@@ -179,6 +180,9 @@ public:
 
 	void threadTick() override; /// @see RsTickingThread
 
+	/// Maximum time between two ticks, local changes and new data wake it up
+	static std::chrono::milliseconds tickPeriod() { return std::chrono::milliseconds(100); }
+
     /*!
      * Policy bit pattern portion
      */
@@ -989,6 +993,7 @@ private:
     bool mChecking, mCheckStarted;
     rstime_t mLastCheck;
     RsGxsIntegrityCheck* mIntegrityCheck;
+    RsGxsIntegrityCursor mIntegrityCursor;	// where the last hash check stopped
     RsGxsGroupId mNextGroupToCheck ;
 
 protected:
@@ -1036,12 +1036,69 @@ bool RsGxsDataAccess::getMsgSummary(MsgMetaReq* req)
 	return true;
 }
 
+// Converts request options into a filter for the data store. Returns false if
+// there is nothing to filter.
+static bool getMsgMetaFilter(const RsTokReqOptions& opts, RsGxsMsgMetaFilter& filter)
+{
+    // Can only choose one of these two.
+    filter.mOnlyOrigMsgs = opts.mOptions & RS_TOKREQOPT_MSG_ORIGMSG;
+    filter.mOnlyLatestMsgs = !filter.mOnlyOrigMsgs && (opts.mOptions & RS_TOKREQOPT_MSG_LATEST);
+    filter.mOnlyThreadHeads = opts.mOptions & RS_TOKREQOPT_MSG_THREAD;
+
+    filter.mStatusMask = opts.mStatusMask;
+    filter.mStatusValue = opts.mStatusFilter;
+    filter.mFlagsMask = opts.mMsgFlagMask;
+    filter.mFlagsValue = opts.mMsgFlagFilter;
+
+    filter.mMinPublishTs = opts.mAfter;
+    filter.mMaxPublishTs = opts.mBefore;
+
+    filter.mMaxCount = opts.mMaxCount;
+    filter.mPageAfterTs = opts.mPageAfterTs;
+    filter.mPageAfterMsgId = opts.mPageAfterMsgId;
+
+    return filter.mOnlyOrigMsgs || filter.mOnlyLatestMsgs || filter.mOnlyThreadHeads
+            || filter.mStatusMask || filter.mFlagsMask
+            || filter.mMinPublishTs || filter.mMaxPublishTs
+            || filter.mMaxCount || !filter.mPageAfterMsgId.isNull();
+}
+
 bool RsGxsDataAccess::getMsgMetaDataList( const GxsMsgReq& msgIds, const RsTokReqOptions& opts, GxsMsgMetaResult& result )
 {
-    // First get all message metas, then filter out the ones we want to keep.
     result.clear();
-    mDataStore->retrieveGxsMsgMetaData(msgIds, result);
 
+    // Whole groups are filtered by the data store, which then only loads the
+    // matching messages. Without filter, the data store gives all metas from
+    // its cache instead.
+
+    RsGxsMsgMetaFilter filter;
+    bool useFilter = getMsgMetaFilter(opts, filter);
+
+    GxsMsgReq explicitMsgIds;
+
+    for(auto& it: msgIds)
+        if(useFilter && it.second.empty())
+            mDataStore->retrieveGxsMsgMetaData(it.first, filter, result[it.first]);
+        else
+            explicitMsgIds.insert(it);
+
+    if(explicitMsgIds.empty())
+        return true;
+
+    // For the others, first get all message metas, then filter out the ones we want to keep.
+    GxsMsgMetaResult explicitResult;
+    mDataStore->retrieveGxsMsgMetaData(explicitMsgIds, explicitResult);
+
+    filterMsgMetaList(opts, explicitResult);
+
+    for(auto& it: explicitResult)
+        result[it.first].swap(it.second);
+
+    return true;
+}
+
+void RsGxsDataAccess::filterMsgMetaList( const RsTokReqOptions& opts, GxsMsgMetaResult& result ) const
+{
     /* CASEs this handles.
      * Input is groupList + Flags.
      * 1) No Flags => All Messages in those Groups.
@@ -1195,6 +1252,14 @@ bool RsGxsDataAccess::getMsgMetaDataList( const GxsMsgReq& msgIds, const RsTokRe
 						metaV[i] = nullptr;
 						continue;
 					}
+
+					if (!checkMsgFilter(opts, msgMeta)
+					        || (opts.mAfter && msgMeta->mPublishTs < opts.mAfter)
+					        || (opts.mBefore && msgMeta->mPublishTs > opts.mBefore))
+					{
+						metaV[i] = nullptr;
+						continue;
+					}
 				}
     }
 
@@ -1213,8 +1278,6 @@ bool RsGxsDataAccess::getMsgMetaDataList( const GxsMsgReq& msgIds, const RsTokRe
 
         it->second.resize(j);	// normally all pointers have been moved forward so there is nothing to delete here.
     }
-
-    return true;
 }
 
 bool RsGxsDataAccess::getMsgIdList( const GxsMsgReq& msgIds, const RsTokReqOptions& opts, GxsMsgReq& msgIdsOut )
@@ -1229,6 +1292,10 @@ bool RsGxsDataAccess::getMsgIdList( const GxsMsgReq& msgIds, const RsTokReqOptio
 
     for(auto it(result.begin());it!=result.end();++it)
     {
+        // an empty set would mean all messages of the group
+        if(it->second.empty())
+            continue;
+
         auto& id_set(msgIdsOut[it->first]);
 
         for(uint32_t i=0;i<it->second.size();++i)
@@ -1598,25 +1665,19 @@ bool RsGxsDataAccess::getServiceStatistic(ServiceStatisticRequest *req)
 
 bool RsGxsDataAccess::getMsgIdList(MsgIdReq* req)
 {
-
     GxsMsgMetaResult result;
-    mDataStore->retrieveGxsMsgMetaData(req->mMsgIds, result);
+
+    // filter based on options
+    getMsgMetaDataList(req->mMsgIds, req->Options, result);
 
     for(auto mit = result.begin(); mit != result.end(); ++mit)
     {
-        const RsGxsGroupId grpId = mit->first;
-        auto& metaV = mit->second;
+        auto& idSet = req->mMsgIdResult[mit->first];
 
-        for(auto vit=metaV.begin(); vit != metaV.end(); ++vit)
-            req->mMsgIdResult[grpId].insert((*vit)->mMsgId);
+        for(auto vit = mit->second.begin(); vit != mit->second.end(); ++vit)
+            idSet.insert((*vit)->mMsgId);
     }
 
-    GxsMsgReq msgIdOut;
-
-    // filter based on options
-    getMsgIdList(req->mMsgIdResult, req->Options, msgIdOut);
-    req->mMsgIdResult = msgIdOut;
-
     return true;
 }
 
@@ -1956,3 +2017,4 @@ bool RsGxsDataAccess::checkMsgFilter(const RsTokReqOptions& opts, const std::sha
 
 GxsGroupStatistic::~GxsGroupStatistic() = default;
 GxsServiceStatistic::~GxsServiceStatistic() = default;
+RsGxsMsgPageCursor::~RsGxsMsgPageCursor() = default;
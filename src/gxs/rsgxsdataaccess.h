@@ -398,6 +398,14 @@ private:
      */
 	bool getMsgMetaDataList( const GxsMsgReq& msgIds, const RsTokReqOptions& opts, GxsMsgMetaResult& result );
 
+    /*!
+     * Applies the options to already retrieved message metas, removing the
+     * ones which don't match
+     * @param opts GxsRequest options
+     * @param result Map of Meta information for messages, filtered in place
+     */
+    void filterMsgMetaList( const RsTokReqOptions& opts, GxsMsgMetaResult& result ) const;
+
     /*!
      * Attempts to retrieve group meta data from data store
      * @param req
@@ -245,6 +245,7 @@
 #include <math.h>
 #include <sstream>
 #include <typeinfo>
+#include <thread>
 
 #include "rsgxsnetservice.h"
 #include "gxssecurity.h"
@@ -308,7 +309,12 @@ static const uint32_t GROUP_STATS_UPDATE_DELAY                =          240; //
 static const uint32_t GROUP_STATS_UPDATE_NB_PEERS             =            2; // number of peers to which the group stats are asked
 static const uint32_t MAX_ALLOWED_GXS_MESSAGE_SIZE            =       199000; // 200,000 bytes including signature and headers
 static const uint32_t MIN_DELAY_BETWEEN_GROUP_SEARCH          =           40; // dont search same group more than every 40 secs.
+static const uint32_t NXS_INCOMING_BATCH_SIZE                 =          256; // items taken at once from the incoming queue
 static const uint32_t SAFETY_DELAY_FOR_UNSUCCESSFUL_UPDATE    =            0; // avoid re-sending the same msg list to a peer who asks twice for the same update in less than this time
+static const uint32_t ENVELOPE_CACHE_MAX_AGE                  =         3600; // encrypted circle data is reused for 1 hour, then encrypted again with a new session key
+static const uint64_t ENVELOPE_CACHE_MAX_SIZE                 = 16*1024*1024; // bytes of encrypted circle data kept for reuse, per service
+static const uint32_t UPDATE_NOTICE_PERIOD                    =            5; // new messages of a group are announced to friends at most every 5 secs
+static const uint32_t MAX_QUIET_GROUP_SYNC_PERIOD             =      32*60; // quiet groups are polled every 32 mins at most, from friends who send update notices
 
 static const uint32_t RS_NXS_ITEM_ENCRYPTION_STATUS_UNKNOWN             = 0x00 ;
 static const uint32_t RS_NXS_ITEM_ENCRYPTION_STATUS_NO_ERROR            = 0x01 ;
@@ -374,7 +380,7 @@ RsGxsNetService::RsGxsNetService(uint16_t servType, RsGeneralDataService *gds,
                                    mObserver(nxsObs), mDataStore(gds),
                                    mServType(servType), mTransactionTimeOut(TRANSAC_TIMEOUT),
                                    mNetMgr(netMgr), mNxsMutex("RsGxsNetService"),
-                                   mSyncTs(0), mLastKeyPublishTs(0),
+                                   mSyncTs(0), mLastKeyPublishTs(0), mLastUpdateNoticeTs(0),
                                    mLastCleanRejectedMessages(0), mSYNC_PERIOD(SYNC_PERIOD),
                                    mCircles(circles), mGixs(gixs),
                                    mReputations(reputations), mPgpUtils(pgpUtils), mGxsNetTunnel(mGxsNT),
@@ -384,9 +390,11 @@ RsGxsNetService::RsGxsNetService(uint16_t servType, RsGeneralDataService *gds,
 {
 	addSerialType(new RsNxsSerialiser(mServType));
 	mOwnId = mNetMgr->getOwnId();
-    mUpdateCounter = 0;
+    mLastServerSyncTSUpdate = time(NULL);
+    mLastDebugDump = time(NULL);
 
 	mLastCacheReloadTS = 0;
+	mEnvelopeCacheBytes = 0;
 
 	// check the consistency
 
@@ -434,9 +442,7 @@ RsGxsNetService::~RsGxsNetService()
 
 int RsGxsNetService::tick()
 {
-	// always check for new items arriving
-	// from peers
-	recvNxsItemQueue();
+	// new items arriving from peers are handled by threadTick(), which they wake up
 
     bool should_notify = false;
 
@@ -465,6 +471,13 @@ int RsGxsNetService::tick()
     	mSyncTs = now;
     }
 
+    if(now >= UPDATE_NOTICE_PERIOD + mLastUpdateNoticeTs)
+    {
+        sendUpdateNotices() ;
+
+        mLastUpdateNoticeTs = now ;
+    }
+
     if(now > 10 + mLastKeyPublishTs)
     {
         sharePublishKeysPending() ;
@@ -571,6 +584,14 @@ RsGxsGroupId RsGxsNetService::hashGrpId(const RsGxsGroupId& gid,const RsPeerId&
     return RsGxsGroupId( RsDirUtil::sha1sum(tmpmem,SIZE).toByteArray() );
 }
 
+// Update notices are in clear and give the group id, so they are only used for
+// public groups. Circle restricted groups are always polled.
+
+static bool groupHasUpdateNotices(const RsGxsGrpMetaData& meta)
+{
+	return meta.mCircleType == GXS_CIRCLE_TYPE_PUBLIC || meta.mCircleType == GXS_CIRCLE_TYPE_UNKNOWN ;
+}
+
 std::error_condition RsGxsNetService::checkUpdatesFromPeers(
         std::set<RsPeerId> peers )
 {
@@ -578,10 +599,16 @@ std::error_condition RsGxsNetService::checkUpdatesFromPeers(
 	RS_DBG("this=", (void*)this, ". serviceInfo=", mServiceInfo);
 #endif
 
+	/* Periodic sync: friends who send update notices get the messages of quiet
+	 * groups polled less often, see locked_msgSyncDue() */
+	bool periodic_sync = peers.empty();
+	std::set<RsPeerId> friends;
+
 	/* If specific peers are passed as paramether ask only to them */
 	if(peers.empty())
 	{
 		mNetMgr->getOnlineList(mServiceInfo.mServiceType, peers);
+		friends = peers;
 
         if((!!(mSyncFlags & RsGxsNetServiceSyncFlags::DISTANT_SYNC)) && mGxsNetTunnel != nullptr)
 		{
@@ -619,6 +646,7 @@ std::error_condition RsGxsNetService::checkUpdatesFromPeers(
 		grp->clear();
 		grp->PeerId(*sit);
 		grp->updateTS = updateTS;
+		grp->flag |= RsNxsSyncGrpReqItem::FLAG_SUPPORTS_KEY_HINTS;
 
 #ifdef NXS_NET_DEBUG_5
 		GXSNETDEBUG_P_(*sit) << "Service "<< std::hex << ((mServiceInfo.mServiceType >> 8)& 0xffff) << std::dec << "  sending global group TS of peer id: " << *sit << " ts=" << nice_time_stamp(time(NULL),updateTS) << " (secs ago) to himself" << std::endl;
@@ -650,6 +678,31 @@ std::error_condition RsGxsNetService::checkUpdatesFromPeers(
 	    }
     }
 
+    // Friends that push update notices, and were already online at the previous
+    // periodic sync, only need polling for groups that are due. Friends that just
+    // connected may have missed notices, so they are asked for everything.
+
+    std::set<RsPeerId> notifying_peers;
+    std::set<RsGxsGroupId> quiet_groups;
+
+    if(periodic_sync)
+    {
+        for(auto sit = friends.begin(); sit != friends.end(); ++sit)
+            if(mPeersSupportingUpdateNotices.find(*sit) != mPeersSupportingUpdateNotices.end() && mLastPeriodicSyncPeers.find(*sit) != mLastPeriodicSyncPeers.end())
+                notifying_peers.insert(*sit);
+
+        mLastPeriodicSyncPeers = friends;
+
+        if(!notifying_peers.empty())
+        {
+            rstime_t now = time(NULL);
+
+            for(auto mmit = toRequest.begin(); mmit != toRequest.end(); ++mmit)
+                if(groupHasUpdateNotices(*mmit->second) && !locked_msgSyncDue(mmit->first, now))
+                    quiet_groups.insert(mmit->first);
+        }
+    }
+
     // Synchronise group msg for groups which we're subscribed to
     // For each peer and each group, we send to the peer the time stamp of the most
     // recent modification the peer has sent. If the peer has more recent messages he will send them, because its latest
@@ -659,15 +712,7 @@ std::error_condition RsGxsNetService::checkUpdatesFromPeers(
     for(auto sit = peers.begin(); sit != peers.end(); ++sit)
     {
         const RsPeerId& peerId = *sit;
-
-        // now see if you have an updateTS so optimise whether you need
-        // to get a new list of peer data
-        const RsGxsMsgUpdate *mui = NULL;
-
-        ClientMsgMap::const_iterator cit = mClientMsgUpdateMap.find(peerId);
-
-        if(cit != mClientMsgUpdateMap.end())
-            mui = &cit->second;
+        bool peer_notifies = notifying_peers.find(peerId) != notifying_peers.end();
 
 #ifdef NXS_NET_DEBUG_0
 	GXSNETDEBUG_P_(peerId) << "  syncing messages with peer " << peerId << std::endl;
@@ -676,78 +721,221 @@ std::error_condition RsGxsNetService::checkUpdatesFromPeers(
         RsGxsGrpMetaTemporaryMap::const_iterator mmit = toRequest.begin();
         for(; mmit != toRequest.end(); ++mmit)
         {
-            const auto& meta = mmit->second;
-            const RsGxsGroupId& grpId = mmit->first;
-            RsGxsCircleId encrypt_to_this_circle_id ;
-
-            if(!checkCanRecvMsgFromPeer(peerId, *meta,encrypt_to_this_circle_id))
+            if(peer_notifies && quiet_groups.find(mmit->first) != quiet_groups.end())
+            {
+#ifdef NXS_NET_DEBUG_0
+                GXSNETDEBUG_PG(peerId,mmit->first) << "    group is quiet and peer sends update notices. Not polling it this time." << std::endl;
+#endif
                 continue;
+            }
+
+            locked_sendMsgSyncRequest(peerId, *mmit->second);
+        }
+    }
+
+#endif // ndef GXS_DISABLE_SYNC_MSGS
+
+	return std::error_condition();
+}
+
+bool RsGxsNetService::locked_sendMsgSyncRequest(const RsPeerId& peerId, const RsGxsGrpMetaData& meta)
+{
+    const RsGxsGroupId& grpId = meta.mGroupId;
+    RsGxsCircleId encrypt_to_this_circle_id ;
+
+    if(!checkCanRecvMsgFromPeer(peerId, meta, encrypt_to_this_circle_id))
+        return false;
 
 #ifdef NXS_NET_DEBUG_0
-	    GXSNETDEBUG_PG(peerId,grpId) << "    peer can send messages for group " << grpId ;
-	    if(!encrypt_to_this_circle_id.isNull())
-		    GXSNETDEBUG_PG(peerId,grpId) << " request should be encrypted for circle ID " << encrypt_to_this_circle_id << std::endl;
-	    else
-		    GXSNETDEBUG_PG(peerId,grpId) << " request should be sent in clear." << std::endl;
+    GXSNETDEBUG_PG(peerId,grpId) << "    peer can send messages for group " << grpId ;
+    if(!encrypt_to_this_circle_id.isNull())
+	    GXSNETDEBUG_PG(peerId,grpId) << " request should be encrypted for circle ID " << encrypt_to_this_circle_id << std::endl;
+    else
+	    GXSNETDEBUG_PG(peerId,grpId) << " request should be sent in clear." << std::endl;
 
 #endif
-            // On default, the info has never been received so the TS is 0, meaning the peer has sent that it had no information.
+    // On default, the info has never been received so the TS is 0, meaning the peer has sent that it had no information.
 
-            uint32_t updateTS = 0;
+    uint32_t updateTS = 0;
 
-            if(mui)
-            {
-                std::map<RsGxsGroupId, RsGxsMsgUpdateItem::MsgUpdateInfo>::const_iterator cit2 = mui->msgUpdateInfos.find(grpId);
+    ClientMsgMap::const_iterator cit = mClientMsgUpdateMap.find(peerId);
 
-                if(cit2 != mui->msgUpdateInfos.end())
-                    updateTS = cit2->second.time_stamp;
-            }
+    if(cit != mClientMsgUpdateMap.end())
+    {
+        std::map<RsGxsGroupId, RsGxsMsgUpdateItem::MsgUpdateInfo>::const_iterator cit2 = cit->second.msgUpdateInfos.find(grpId);
 
-            // get sync params for this group
+        if(cit2 != cit->second.msgUpdateInfos.end())
+            updateTS = cit2->second.time_stamp;
+    }
 
-            RsNxsSyncMsgReqItem* msg = new RsNxsSyncMsgReqItem(mServType);
+    // get sync params for this group
 
-            msg->clear();
-            msg->PeerId(peerId);
-            msg->updateTS = updateTS;
+    RsNxsSyncMsgReqItem* msg = new RsNxsSyncMsgReqItem(mServType);
 
-            int req_delay  = (int)locked_getGrpConfig(grpId).msg_req_delay ;
-            int keep_delay = (int)locked_getGrpConfig(grpId).msg_keep_delay ;
+    msg->clear();
+    msg->PeerId(peerId);
+    msg->updateTS = updateTS;
+    msg->flag |= RsNxsSyncMsgReqItem::FLAG_SUPPORTS_KEY_HINTS;
+    msg->flag |= RsNxsSyncMsgReqItem::FLAG_SUPPORTS_UPDATE_NOTICES;
 
-            // If we store for less than we request, we request less, otherwise the posts will be deleted after being obtained.
+    int req_delay  = (int)locked_getGrpConfig(grpId).msg_req_delay ;
+    int keep_delay = (int)locked_getGrpConfig(grpId).msg_keep_delay ;
 
-            if(keep_delay > 0 && req_delay > 0 && keep_delay < req_delay)
-                req_delay = keep_delay ;
+    // If we store for less than we request, we request less, otherwise the posts will be deleted after being obtained.
 
-            // The last post will be set to TS 0 if the req delay is 0, which means "Indefinitely"
+    if(keep_delay > 0 && req_delay > 0 && keep_delay < req_delay)
+        req_delay = keep_delay ;
 
-            if(req_delay > 0)
-				msg->createdSinceTS = std::max(0,(int)time(NULL) - req_delay);
-			else
-				msg->createdSinceTS = 0 ;
+    // The last post will be set to TS 0 if the req delay is 0, which means "Indefinitely"
 
-            if(encrypt_to_this_circle_id.isNull())
-                msg->grpId = grpId;
-            else
-            {
-                msg->grpId = hashGrpId(grpId,mNetMgr->getOwnId()) ;
-                msg->flag |= RsNxsSyncMsgReqItem::FLAG_USE_HASHED_GROUP_ID ;
-            }
+    if(req_delay > 0)
+		msg->createdSinceTS = std::max(0,(int)time(NULL) - req_delay);
+	else
+		msg->createdSinceTS = 0 ;
+
+    if(encrypt_to_this_circle_id.isNull())
+        msg->grpId = grpId;
+    else
+    {
+        msg->grpId = hashGrpId(grpId,mNetMgr->getOwnId()) ;
+        msg->flag |= RsNxsSyncMsgReqItem::FLAG_USE_HASHED_GROUP_ID ;
+    }
 
 #ifdef NXS_NET_DEBUG_7
-	    GXSNETDEBUG_PG(*sit,grpId) << "    Service " << std::hex << ((mServiceInfo.mServiceType >> 8)& 0xffff) << std::dec << "  sending message TS of peer id: " << *sit << " ts=" << nice_time_stamp(time(NULL),updateTS) << " (secs ago) for group " << grpId << " to himself - in clear " << std::endl;
+    GXSNETDEBUG_PG(peerId,grpId) << "    Service " << std::hex << ((mServiceInfo.mServiceType >> 8)& 0xffff) << std::dec << "  sending message TS of peer id: " << peerId << " ts=" << nice_time_stamp(time(NULL),updateTS) << " (secs ago) for group " << grpId << " to himself - in clear " << std::endl;
 #endif
-		generic_sendItem(msg);
+	generic_sendItem(msg);
 
 #ifdef NXS_NET_DEBUG_5
-		GXSNETDEBUG_PG(*sit,grpId) << "Service "<< std::hex << ((mServiceInfo.mServiceType >> 8)& 0xffff) << std::dec << "  sending global message TS of peer id: " << *sit << " ts=" << nice_time_stamp(time(NULL),updateTS) << " (secs ago) for group " << grpId << " to himself" << std::endl;
+	GXSNETDEBUG_PG(peerId,grpId) << "Service "<< std::hex << ((mServiceInfo.mServiceType >> 8)& 0xffff) << std::dec << "  sending global message TS of peer id: " << peerId << " ts=" << nice_time_stamp(time(NULL),updateTS) << " (secs ago) for group " << grpId << " to himself" << std::endl;
+#endif
+    return true;
+}
+
+bool RsGxsNetService::locked_msgSyncDue(const RsGxsGroupId& grpId, rstime_t now)
+{
+    MsgSyncSchedule& sched(mMsgSyncSchedules[grpId]);
+
+    ServerMsgMap::const_iterator it = mServerMsgUpdateMap.find(grpId);
+    uint32_t server_update_TS = (it == mServerMsgUpdateMap.end()) ? 0 : it->second.msgUpdateTS;
+
+    // Something new in the group: poll it at the normal rate again
+
+    if(sched.period == 0 || sched.server_update_TS != server_update_TS)
+    {
+        sched.server_update_TS = server_update_TS;
+        sched.period = mSYNC_PERIOD;
+        sched.last_sync_TS = 0;
+    }
+
+    if(now < sched.last_sync_TS + (rstime_t)sched.period)
+        return false;
+
+    if(sched.last_sync_TS != 0)
+        sched.period = std::min(2*sched.period, MAX_QUIET_GROUP_SYNC_PERIOD);
+
+    sched.last_sync_TS = now;
+    return true;
+}
+
+void RsGxsNetService::sendUpdateNotices()
+{
+    std::map<RsGxsGroupId,RsPeerId> pending;
+    {
+        RS_STACK_MUTEX(mNxsMutex) ;
+        pending.swap(mPendingUpdateNotices);
+    }
+
+    if(pending.empty())
+        return;
+
+    std::set<RsPeerId> friends;
+    mNetMgr->getOnlineList(mServiceInfo.mServiceType, friends);
+
+    RsGxsGrpMetaTemporaryMap grpMetas;
+
+    for(auto it(pending.begin());it!=pending.end();++it)
+        grpMetas[it->first] = NULL;
+
+    mDataStore->retrieveGxsGrpMetaData(grpMetas);
+
+    RS_STACK_MUTEX(mNxsMutex) ;
+
+    for(auto it(pending.begin());it!=pending.end();++it)
+    {
+        const auto& meta = grpMetas[it->first];
+
+        if(meta == NULL || !groupHasUpdateNotices(*meta))
+            continue;
+
+        ServerMsgMap::const_iterator sit = mServerMsgUpdateMap.find(it->first);
+
+        if(sit == mServerMsgUpdateMap.end())
+            continue;
+
+        // Only friends who asked us for the messages of this group are told.
+
+        const std::set<RsPeerId>& suppliers(locked_getGrpConfig(it->first).suppliers.ids);
+
+        for(auto pit(friends.begin());pit!=friends.end();++pit)
+        {
+            if(*pit == it->second)	// the messages come from him
+                continue;
+
+            if(mPeersSupportingUpdateNotices.find(*pit) == mPeersSupportingUpdateNotices.end() || suppliers.find(*pit) == suppliers.end())
+                continue;
+
+#ifdef NXS_NET_DEBUG_0
+            GXSNETDEBUG_PG(*pit,it->first) << "  sending update notice for group " << it->first << " ts=" << sit->second.msgUpdateTS << std::endl;
 #endif
+            RsNxsGroupUpdateNoticeItem *item = new RsNxsGroupUpdateNoticeItem(mServType);
+            item->PeerId(*pit);
+            item->grpId = it->first;
+            item->updateTS = sit->second.msgUpdateTS;
+
+            generic_sendItem(item);
         }
     }
+}
 
-#endif // ndef GXS_DISABLE_SYNC_MSGS
+void RsGxsNetService::handleRecvGroupUpdateNotice(RsNxsGroupUpdateNoticeItem *item)
+{
+    if (!item)
+	    return;
 
-	return std::error_condition();
+    if(!(mSyncFlags & RsGxsNetServiceSyncFlags::AUTO_SYNC_MESSAGES))
+        return;
+
+    RsGxsGrpMetaTemporaryMap grpMetas;
+    grpMetas[item->grpId] = NULL;
+
+    mDataStore->retrieveGxsGrpMetaData(grpMetas);
+    const auto& meta = grpMetas[item->grpId];
+
+    if(meta == NULL || !(meta->mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED) || !groupHasUpdateNotices(*meta))
+        return;
+
+    RS_STACK_MUTEX(mNxsMutex) ;
+
+    const RsPeerId& peerId = item->PeerId();
+
+    // Same comparison as the peer does when receiving our sync request: only
+    // ask if he has something newer than what he last sent us.
+
+    ClientMsgMap::const_iterator cit = mClientMsgUpdateMap.find(peerId);
+
+    if(cit != mClientMsgUpdateMap.end())
+    {
+        std::map<RsGxsGroupId, RsGxsMsgUpdateItem::MsgUpdateInfo>::const_iterator cit2 = cit->second.msgUpdateInfos.find(item->grpId);
+
+        if(cit2 != cit->second.msgUpdateInfos.end() && item->updateTS <= cit2->second.time_stamp)
+            return;
+    }
+
+#ifdef NXS_NET_DEBUG_0
+    GXSNETDEBUG_PG(peerId,item->grpId) << "  received update notice for group " << item->grpId << " ts=" << item->updateTS << ". Requesting messages." << std::endl;
+#endif
+    locked_sendMsgSyncRequest(peerId, *meta);
 }
 
 void RsGxsNetService::generic_sendItem(rs_owner_ptr<RsItem> si)
@@ -1707,11 +1895,16 @@ RsSerialiser *RsGxsNetService::setupSerialiser()
 
 RsItem *RsGxsNetService::generic_recvItem()
 {
-	{
-		RsItem *item ;
+	// take the queued items at once rather than locking the queue for each of them
 
-		if(NULL != (item=recvItem()))
-			return item ;
+	if(mIncomingItems.empty())
+		recvItems(mIncomingItems, NXS_INCOMING_BATCH_SIZE) ;
+
+	if(!mIncomingItems.empty())
+	{
+		RsItem *item = mIncomingItems.front() ;
+		mIncomingItems.pop_front() ;
+		return item ;
 	}
 
 	unsigned char *data = NULL ;
@@ -1797,6 +1990,7 @@ void RsGxsNetService::recvNxsItemQueue()
             case RS_PKT_SUBTYPE_NXS_SYNC_MSG_REQ_ITEM:      handleRecvSyncMessage         (dynamic_cast<RsNxsSyncMsgReqItem*>(ni),item_was_encrypted) ; break ;
             case RS_PKT_SUBTYPE_NXS_GRP_PUBLISH_KEY_ITEM:   handleRecvPublishKeys         (dynamic_cast<RsNxsGroupPublishKeyItem*>(ni)) ; break ;
             case RS_PKT_SUBTYPE_NXS_SYNC_PULL_REQUEST_ITEM: handlePullRequest             (dynamic_cast<RsNxsPullRequestItem*>(ni)) ; break ;
+            case RS_PKT_SUBTYPE_NXS_GRP_UPDATE_NOTICE_ITEM: handleRecvGroupUpdateNotice   (dynamic_cast<RsNxsGroupUpdateNoticeItem*>(ni)) ; break ;
 
             default:
                 if(ni->PacketSubType() != RS_PKT_SUBTYPE_NXS_ENCRYPTED_DATA_ITEM)
@@ -2012,24 +2206,33 @@ bool RsGxsNetService::locked_processTransac(RsNxsTransacItem *item)
 
 void RsGxsNetService::threadTick()
 {
-    static const double timeDelta = 0.5;
-
         //Start waiting as nothing to do in runup
-        rstime::rs_usleep((int) (timeDelta * 1000 * 1000)); // timeDelta sec
+        if(!isScheduled())
+            waitForItems(tickPeriod());
+
+        // always check for new items arriving
+        // from peers. The transactions they complete are processed below.
+        recvNxsItemQueue();
 
-        if(mUpdateCounter >= 120) // 60 seconds
+        // ticks may happen more often than tickPeriod() when woken up, so
+        // periodic tasks go by time
+        rstime_t now = time(NULL);
+
+        if(now >= mLastServerSyncTSUpdate + 60)
         {
             updateServerSyncTS();
 #ifdef TO_REMOVE
             updateClientSyncTS();
 #endif
-            mUpdateCounter = 1;
+            mLastServerSyncTSUpdate = now;
         }
-        else
-            mUpdateCounter++;
 
-        if(mUpdateCounter % 20 == 0)	// dump the full shit every 20 secs
+        // dump the full shit every 10 secs, as did the former 20 ticks of 0.5 sec
+        if(now >= mLastDebugDump + 10)
+        {
             debugDump() ;
+            mLastDebugDump = now;
+        }
 
         // process active transactions
         processTransactions();
@@ -2087,6 +2290,9 @@ void RsGxsNetService::debugDump()
     }
 
     GXSNETDEBUG___<< "  List of rejected message ids: " << std::dec << mRejectedMessages.size() << std::endl;
+
+    GXSNETDEBUG___<< "  Envelope cache: " << mEnvelopeCache.size() << " envelopes, " << mEnvelopeCacheBytes << " bytes. Hits: " << mEnvelopeCacheStats.hits
+                  << ", misses: " << mEnvelopeCacheStats.misses << ", RSA key wraps saved: " << mEnvelopeCacheStats.key_wraps_saved << std::endl;
 #endif
 }
 
@@ -2746,7 +2952,7 @@ void RsGxsNetService::locked_processCompletedIncomingTrans(NxsTransaction* tr)
             locked_doMsgUpdateWork(tr->mTransaction, grpId);
 
             // also update server sync TS, since we need to send the new message list to friends for comparison
-            locked_stampMsgServerUpdateTS(grpId);
+            locked_stampMsgServerUpdateTS(grpId, tr->mTransaction->PeerId());
         }
     }
     else if(tr->mFlag == NxsTransaction::FLAG_STATE_FAILED)
@@ -3786,29 +3992,91 @@ bool RsGxsNetService::encryptSingleNxsItem(RsNxsItem *item, const RsGxsCircleId&
 		recipient_keys.push_back(pkey) ;
 	}
 
-	// 2 - call GXSSecurity to make a header item that encrypts for the given list of peers.
+	// 2 - serialise the item. The transaction number is left out: it is the only field that changes from one peer
+	//     or sync round to the next, and the receiver takes it from the encrypted item anyway. The same envelope
+	//     can then be sent to all peers, until the circle members change.
+
+	uint32_t transaction_number = item->transactionNumber ;
+	item->transactionNumber = 0 ;
 
-#ifdef NXS_NET_DEBUG_7
-	GXSNETDEBUG_P_ (item->PeerId()) << "  Encrypting..." << std::endl;
-#endif
 	uint32_t size = RsNxsSerialiser(mServType).size(item) ;
 	RsTemporaryMemory tempmem( size ) ;
 
-	if(!RsNxsSerialiser(mServType).serialise(item,tempmem,&size))
+	bool serialised = RsNxsSerialiser(mServType).serialise(item,tempmem,&size) ;
+	item->transactionNumber = transaction_number ;
+
+	if(!serialised)
 	{
 		std::cerr << "  (EE) Cannot serialise item. Something went wrong." << std::endl;
 		status = RS_NXS_ITEM_ENCRYPTION_STATUS_SERIALISATION_ERROR ;
 		return false ;
 	}
 
+	std::vector<uint8_t> recipient_ids ;
+
+	for(uint32_t i=0;i<recipient_keys.size();++i)
+		recipient_ids.insert(recipient_ids.end(),recipient_keys[i].keyId.toByteArray(),recipient_keys[i].keyId.toByteArray() + RsGxsId::SIZE_IN_BYTES) ;
+
+	EnvelopeKey envelope_key ;
+	envelope_key.item_hash = RsDirUtil::sha1sum(tempmem,size) ;
+	envelope_key.recipients_hash = RsDirUtil::sha1sum(recipient_ids.data(),recipient_ids.size()) ;
+	envelope_key.key_hints = mPeersSupportingKeyHints.find(item->PeerId()) != mPeersSupportingKeyHints.end() ;
+
+	// 3 - call GXSSecurity to make a header item that encrypts for the given list of peers, unless it's already done.
+
 	unsigned char *encrypted_data = NULL ;
 	uint32_t encrypted_len  = 0 ;
 
-	if(!GxsSecurity::encrypt(encrypted_data, encrypted_len,tempmem,size,recipient_keys))
+	rstime_t now = time(NULL) ;
+	std::map<EnvelopeKey,CachedEnvelope>::iterator eit = mEnvelopeCache.find(envelope_key) ;
+
+	if(eit != mEnvelopeCache.end() && eit->second.created + ENVELOPE_CACHE_MAX_AGE > now)
 	{
-		std::cerr << "  (EE) Cannot multi-encrypt item. Something went wrong." << std::endl;
-		status = RS_NXS_ITEM_ENCRYPTION_STATUS_ENCRYPTION_ERROR ;
-		return false ;
+		encrypted_len = eit->second.data.size() ;
+		encrypted_data = (unsigned char*)rs_malloc(encrypted_len) ;
+
+		if(encrypted_data == NULL)
+			return false ;
+
+		memcpy(encrypted_data,eit->second.data.data(),encrypted_len) ;
+		eit->second.last_used = now ;
+
+		++mEnvelopeCacheStats.hits ;
+		mEnvelopeCacheStats.key_wraps_saved += eit->second.key_count ;
+#ifdef NXS_NET_DEBUG_7
+		GXSNETDEBUG_P_ (item->PeerId()) << "  Reusing envelope encrypted for " << eit->second.key_count << " keys." << std::endl;
+#endif
+	}
+	else
+	{
+#ifdef NXS_NET_DEBUG_7
+		GXSNETDEBUG_P_ (item->PeerId()) << "  Encrypting..." << std::endl;
+#endif
+		if(!GxsSecurity::encrypt(encrypted_data, encrypted_len,tempmem,size,recipient_keys,envelope_key.key_hints))
+		{
+			std::cerr << "  (EE) Cannot multi-encrypt item. Something went wrong." << std::endl;
+			status = RS_NXS_ITEM_ENCRYPTION_STATUS_ENCRYPTION_ERROR ;
+			return false ;
+		}
+		++mEnvelopeCacheStats.misses ;
+
+		if(eit != mEnvelopeCache.end())
+		{
+			mEnvelopeCacheBytes -= eit->second.data.size() ;
+			mEnvelopeCache.erase(eit) ;
+		}
+
+		CachedEnvelope& envelope(mEnvelopeCache[envelope_key]) ;
+
+		envelope.data.assign(encrypted_data,encrypted_data + encrypted_len) ;
+		envelope.key_count = recipient_keys.size() ;
+		envelope.created = now ;
+		envelope.last_used = now ;
+
+		mEnvelopeCacheBytes += encrypted_len ;
+
+		if(mEnvelopeCacheBytes > ENVELOPE_CACHE_MAX_SIZE)
+			locked_cleanEnvelopeCache(now) ;
 	}
 
 	RsNxsEncryptedDataItem *enc_item = new RsNxsEncryptedDataItem(mServType) ;
@@ -3830,6 +4098,44 @@ bool RsGxsNetService::encryptSingleNxsItem(RsNxsItem *item, const RsGxsCircleId&
 	return true ;
 }
 
+void RsGxsNetService::locked_cleanEnvelopeCache(rstime_t now)
+{
+    // Remove old envelopes first, then the least recently used ones, down to 3/4 of the max size
+
+    std::multimap<rstime_t,std::map<EnvelopeKey,CachedEnvelope>::iterator> by_last_use ;
+
+    for(std::map<EnvelopeKey,CachedEnvelope>::iterator it(mEnvelopeCache.begin());it!=mEnvelopeCache.end();)
+        if(it->second.created + ENVELOPE_CACHE_MAX_AGE <= now)
+        {
+            mEnvelopeCacheBytes -= it->second.data.size() ;
+            it = mEnvelopeCache.erase(it) ;
+        }
+        else
+        {
+            by_last_use.insert(std::make_pair(it->second.last_used,it)) ;
+            ++it ;
+        }
+
+    for(std::multimap<rstime_t,std::map<EnvelopeKey,CachedEnvelope>::iterator>::iterator it(by_last_use.begin());it!=by_last_use.end() && mEnvelopeCacheBytes > 3*ENVELOPE_CACHE_MAX_SIZE/4;++it)
+    {
+        mEnvelopeCacheBytes -= it->second->second.data.size() ;
+        mEnvelopeCache.erase(it->second) ;
+    }
+
+#ifdef NXS_NET_DEBUG_7
+    GXSNETDEBUG___ << "  Cleaned envelope cache: " << mEnvelopeCache.size() << " envelopes, " << mEnvelopeCacheBytes << " bytes." << std::endl;
+#endif
+}
+
+void RsGxsNetService::getEnvelopeCacheStats(EnvelopeCacheStats& stats)
+{
+    RS_STACK_MUTEX(mNxsMutex) ;
+
+    stats = mEnvelopeCacheStats ;
+    stats.entries = mEnvelopeCache.size() ;
+    stats.bytes = mEnvelopeCacheBytes ;
+}
+
 // Tries to decrypt the transaction. First load the keys and process all items.
 // If keys are loaded, encrypted items that cannot be decrypted are discarded.
 // Otherwise the transaction is untouched for retry later.
@@ -3959,6 +4265,10 @@ bool RsGxsNetService::decryptSingleNxsItem(const RsNxsEncryptedDataItem *encrypt
 	    {
 		    ditem->PeerId(encrypted_item->PeerId()) ;	// This is needed because the deserialised item has no peer id
 		    nxsitem = dynamic_cast<RsNxsItem*>(ditem) ;
+
+		    // The envelope may be shared by several transactions. See encryptSingleNxsItem()
+		    if(nxsitem != NULL)
+			    nxsitem->transactionNumber = encrypted_item->transactionNumber ;
 	    }
 	    else
 		    std::cerr << "    Cannot deserialise. Item encoding error!" << std::endl;
@@ -4047,6 +4357,11 @@ void RsGxsNetService::handleRecvSyncGroup(RsNxsSyncGrpReqItem *item)
     {
         RS_STACK_MUTEX(mNxsMutex) ;
 
+        if(item->flag & RsNxsSyncGrpReqItem::FLAG_SUPPORTS_KEY_HINTS)
+            mPeersSupportingKeyHints.insert(peer) ;
+        else
+            mPeersSupportingKeyHints.erase(peer) ;
+
         if(!locked_CanReceiveUpdate(item))
         {
 #ifdef NXS_NET_DEBUG_0
@@ -4371,6 +4686,16 @@ void RsGxsNetService::handleRecvSyncMessage(RsNxsSyncMsgReqItem *item,bool item_
     bool grp_is_known = false;
     bool was_circle_protected = item_was_encrypted || bool(item->flag & RsNxsSyncMsgReqItem::FLAG_USE_HASHED_GROUP_ID);
 
+    if(item->flag & RsNxsSyncMsgReqItem::FLAG_SUPPORTS_KEY_HINTS)
+        mPeersSupportingKeyHints.insert(peer) ;
+    else
+        mPeersSupportingKeyHints.erase(peer) ;
+
+    if(item->flag & RsNxsSyncMsgReqItem::FLAG_SUPPORTS_UPDATE_NOTICES)
+        mPeersSupportingUpdateNotices.insert(peer) ;
+    else
+        mPeersSupportingUpdateNotices.erase(peer) ;
+
     // This call determines if the peer can receive updates from us, meaning that our last TS is larger than what the peer sent.
     // It also changes the items' group id into the un-hashed group ID if the group is a distant group.
 
@@ -5250,12 +5575,22 @@ bool RsGxsNetService::stampMsgServerUpdateTS(const RsGxsGroupId& gid)
     return locked_stampMsgServerUpdateTS(gid) ;
 }
 
-bool RsGxsNetService::locked_stampMsgServerUpdateTS(const RsGxsGroupId& gid)
+bool RsGxsNetService::locked_stampMsgServerUpdateTS(const RsGxsGroupId& gid, const RsPeerId& from)
 {
     RsGxsServerMsgUpdate& m(mServerMsgUpdateMap[gid]);
 
 	m.msgUpdateTS = time(NULL) ;
 
+    // Announce the new messages at the next sendUpdateNotices(), except to the
+    // friend they come from. A null id means several sources or our own post.
+
+    auto it = mPendingUpdateNotices.find(gid);
+
+    if(it == mPendingUpdateNotices.end())
+        mPendingUpdateNotices[gid] = from;
+    else if(it->second != from)
+        it->second.clear();
+
     return true;
 }
 
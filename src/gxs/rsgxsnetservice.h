@@ -248,6 +248,21 @@ public:
     virtual bool removeGroups(const std::list<RsGxsGroupId>& groups)override ;
     virtual bool isDistantPeer(const RsPeerId& pid)override ;
 
+    /*!
+     * Statistics of the cache of encrypted circle data. Each hit saves one RSA key wrap per recipient.
+     */
+    struct EnvelopeCacheStats
+    {
+        EnvelopeCacheStats() : hits(0), misses(0), key_wraps_saved(0), entries(0), bytes(0) {}
+
+        uint64_t hits ;
+        uint64_t misses ;
+        uint64_t key_wraps_saved ;
+        uint32_t entries ;
+        uint64_t bytes ;
+    };
+    void getEnvelopeCacheStats(EnvelopeCacheStats& stats) ;
+
     /* p3Config methods */
 public:
 
@@ -264,6 +279,9 @@ public:
 
 	void threadTick() override; /// @see RsTickingThread
 
+	/// Maximum time between two ticks, incoming items wake it up
+	static std::chrono::milliseconds tickPeriod() { return std::chrono::milliseconds(500); }
+
 
 	/// @see RsNetworkExchangeService
 	std::error_condition checkUpdatesFromPeers(
@@ -276,7 +294,7 @@ public:
 private:
 
     /*!
-     * called when
+     * called by threadTick() when
      * items are deemed to be waiting in p3Service item queue
      */
     void recvNxsItemQueue();
@@ -330,10 +348,12 @@ private:
     /*!
      * \brief locked_stampMsgServerUpdateTS
      * 		updates the server msg time stamp. This function is the locked method for the one above with similar name
+     * 		and queues an update notice for friends, see sendUpdateNotices()
      * \param gid group id to stamp.
+     * \param from friend the new messages come from, who doesn't need the notice. Null for our own posts.
      * \return
      */
-    bool locked_stampMsgServerUpdateTS(const RsGxsGroupId& gid);
+    bool locked_stampMsgServerUpdateTS(const RsGxsGroupId& gid, const RsPeerId& from = RsPeerId());
     /*!
      * This retrieves a unique transaction id that
      * can be used in an outgoing transaction
@@ -452,6 +472,13 @@ private:
      */
     void handlePullRequest(RsNxsPullRequestItem *item);
 
+    /*!
+     * Handles a notice that a friend has new messages in a group. Messages
+     * are requested right away if the group is subscribed and the friend
+     * has something we don't have yet.
+     */
+    void handleRecvGroupUpdateNotice(RsNxsGroupUpdateNoticeItem *item);
+
     /** E: item handlers **/
 
 
@@ -580,6 +607,8 @@ private:
 
     /*!
     * encrypts/decrypts the transaction for the destination circle id.
+    * encryptSingleNxsItem() is called with mNxsMutex locked. It reuses the envelope of an identical item
+    * encrypted for the same recipients, whatever the peer it was sent to.
     */
     bool encryptSingleNxsItem(RsNxsItem *item, const RsGxsCircleId& destination_circle, const RsGxsGroupId &destination_group, RsNxsItem *& encrypted_item, uint32_t &status) ;
     bool decryptSingleNxsItem(const RsNxsEncryptedDataItem *encrypted_item, RsNxsItem *&nxsitem, std::vector<RsTlvPrivateRSAKey> *private_keys=NULL);
@@ -591,6 +620,8 @@ private:
 	void generic_sendItem(rs_owner_ptr<RsItem> si);
 	RsItem *generic_recvItem();
 
+	std::list<RsItem*> mIncomingItems;	/// batch taken from the p3Service queue, threadTick() only
+
 private:
 
 	static void locked_checkDelay(uint32_t& time_in_secs);
@@ -631,9 +662,11 @@ private:
     uint32_t mSyncTs;
     uint32_t mLastKeyPublishTs;
     uint32_t mLastCleanRejectedMessages;
+    uint32_t mLastUpdateNoticeTs;
 
     const uint32_t mSYNC_PERIOD;
-    int mUpdateCounter ;
+    rstime_t mLastServerSyncTSUpdate ;
+    rstime_t mLastDebugDump ;
 
     RsGcxs* mCircles;
     RsGixs *mGixs;
@@ -686,6 +719,67 @@ private:
 	uint32_t mDefaultMsgSyncPeriod ;
 
     std::map<Sha1CheckSum, RsNxsGrp*> mGroupHashCache;
+
+    // Encrypted circle data, by hash of the serialised item and of the list of recipient keys
+
+    struct EnvelopeKey
+    {
+        Sha1CheckSum item_hash ;
+        Sha1CheckSum recipients_hash ;
+        bool key_hints ;
+
+        bool operator<(const EnvelopeKey& k) const
+        {
+            if(item_hash != k.item_hash) return item_hash < k.item_hash ;
+            if(recipients_hash != k.recipients_hash) return recipients_hash < k.recipients_hash ;
+            return key_hints < k.key_hints ;
+        }
+    };
+    struct CachedEnvelope
+    {
+        std::vector<uint8_t> data ;
+        uint32_t key_count ;
+        rstime_t created ;
+        rstime_t last_used ;
+    };
+
+    void locked_cleanEnvelopeCache(rstime_t now) ;
+
+    std::map<EnvelopeKey,CachedEnvelope> mEnvelopeCache ;
+    uint64_t mEnvelopeCacheBytes ;
+    EnvelopeCacheStats mEnvelopeCacheStats ;
+
+    // Peers whose last sync request said they can decrypt envelopes with key hints
+    std::set<RsPeerId> mPeersSupportingKeyHints ;
+
+    /*!
+     * Update notices: when new messages of a public group are received or
+     * posted, friends who asked us for that group are told, at most every
+     * few seconds, and ask for the messages right away. In exchange, they
+     * poll quiet groups less and less often, see locked_msgSyncDue().
+     * Peers that don't set FLAG_SUPPORTS_UPDATE_NOTICES are polled as before.
+     */
+    void sendUpdateNotices() ;
+
+    /// Builds and sends the message sync request of a group to a peer. @return false if the peer cannot send us messages of the group
+    bool locked_sendMsgSyncRequest(const RsPeerId& peerId, const RsGxsGrpMetaData& meta) ;
+
+    /// true if the messages of the group should be polled now from friends who send update notices. The period doubles while the group doesn't change.
+    bool locked_msgSyncDue(const RsGxsGroupId& grpId, rstime_t now) ;
+
+    struct MsgSyncSchedule
+    {
+        MsgSyncSchedule() : server_update_TS(0), period(0), last_sync_TS(0) {}
+
+        uint32_t server_update_TS ;	// msgUpdateTS of the group when the period was last reset
+        uint32_t period ;
+        rstime_t last_sync_TS ;
+    };
+
+    std::set<RsPeerId> mPeersSupportingUpdateNotices ;
+    std::map<RsGxsGroupId,RsPeerId> mPendingUpdateNotices ;	// group => friend the new messages come from, if only one
+    std::map<RsGxsGroupId,MsgSyncSchedule> mMsgSyncSchedules ;
+    std::set<RsPeerId> mLastPeriodicSyncPeers ;
     std::map<TurtleRequestId,RsGxsGroupId> mSearchRequests;
     std::map<RsGxsGroupId,GroupRequestRecord> mSearchedGroups ;
     rstime_t mLastCacheReloadTS ;
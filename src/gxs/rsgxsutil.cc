@@ -21,6 +21,11 @@
  *                                                                             *
  *******************************************************************************/
 
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <thread>
+
 #include "util/rstime.h"
 
 #include "rsgxsutil.h"
@@ -28,6 +33,7 @@
 #include "retroshare/rspeers.h"
 #include "pqi/pqihash.h"
 #include "gxs/rsgixs.h"
+#include "util/rsscheduler.h"
 
 // The goals of this set of methods is to check GXS messages and groups for consistency, mostly
 // re-ferifying signatures and hashes, to make sure that the data hasn't been tempered. This shouldn't
@@ -35,6 +41,13 @@
 
 static const uint32_t MAX_GXS_IDS_REQUESTS_NET   =  10 ; // max number of requests from cache/net (avoids killing the system!)
 
+static const uint32_t INTEGRITY_CHECK_BATCH_SIZE    = 64 ;             // messages read from the db at once
+static const uint32_t INTEGRITY_CHECK_MAX_HASH_THREADS = 4 ;
+#ifdef RS_GXS_INTEGRITY_HASH_CHECK
+static const uint64_t INTEGRITY_CHECK_MAX_RATE      = 8 * 1024 * 1024 ; // bytes read per second by the periodic check
+static const rstime_t INTEGRITY_CHECK_MAX_DURATION  = 10 * 60 ;        // the periodic check resumes at next pass after that
+#endif
+
 // #define DEBUG_GXSUTIL 1
 
 #ifdef DEBUG_GXSUTIL
@@ -203,18 +216,53 @@ bool RsGxsCleanUp::clean(RsGxsGroupId& next_group_to_check,std::vector<RsGxsGrou
 
 RsGxsIntegrityCheck::RsGxsIntegrityCheck(
         RsGeneralDataService* const dataService, RsGenExchange* genex,
-        RsSerialType&, RsGixs* gixs )
+        RsSerialType&, RsGixs* gixs, const RsGxsIntegrityCursor& cursor )
   : mDs(dataService), mGenExchangeClient(genex),
-    mDone(false), mIntegrityMutex("integrity"), mGixs(gixs) {}
+    mDone(false), mIntegrityMutex("integrity"), mCursor(cursor), mGixs(gixs) {}
 
 void RsGxsIntegrityCheck::run()
 {
-	std::vector<RsGxsGroupId> grps_to_delete;
-	GxsMsgReq msgs_to_delete;
-
     check(mGenExchangeClient->serviceType(), mGixs, mDs);
 
+#ifdef RS_GXS_INTEGRITY_HASH_CHECK
+	// Hash check, in the background and limited in time. What is left is
+	// checked at next pass.
+
+	RsGxsIntegrityCursor cursor;
+	{
+		RS_STACK_MUTEX(mIntegrityMutex);
+		cursor = mCursor;
+	}
+
+	RsGxsSinglePassIntegrityCheck hashCheck(mDs, cursor);
+	hashCheck.setMaxRate(INTEGRITY_CHECK_MAX_RATE);
+
+	rstime_t deadline = time(NULL) + INTEGRITY_CHECK_MAX_DURATION;
+	hashCheck.run([&]() { return shouldStop() || time(NULL) > deadline; });
+
+#ifdef DEBUG_GXSUTIL
+	GXSUTIL_DEBUG() << "Hash check of service " << std::hex << mGenExchangeClient->serviceType() << std::dec << " checked " << hashCheck.checkedBytes() << " bytes, next group: " << hashCheck.cursor().mGroupId << std::endl;
+#endif
+
+	// Wrong hashes are only reported, see the class comment.
+
+	std::vector<RsGxsGroupId> grpIds;
+	GxsMsgReq msgIds;
+	hashCheck.getDeletedIds(grpIds, msgIds);
+
+	uint32_t nbMsgs = 0;
+	for(auto& it: msgIds) nbMsgs += it.second.size();
+
+	if(!grpIds.empty() || nbMsgs)
+		RS_WARN( "hash check of service ", mGenExchangeClient->serviceType(),
+		         " found ", grpIds.size(), " groups and ", nbMsgs,
+		         " messages with a wrong hash. They are kept." );
+
+	RS_STACK_MUTEX(mIntegrityMutex);
+	mCursor = hashCheck.cursor();
+#else
 	RS_STACK_MUTEX(mIntegrityMutex);
+#endif
 	mDone = true;
 }
 
@@ -350,6 +398,45 @@ bool RsGxsIntegrityCheck::check(uint16_t service_type, RsGixs *mgixs, RsGeneralD
     return true;
 }
 
+std::string RsGxsIntegrityCursor::toString() const
+{
+	return mGroupId.toStdString() + " " + mMsgId.toStdString();
+}
+
+bool RsGxsIntegrityCursor::fromString(const std::string& str)
+{
+	std::istringstream is(str);
+	std::string grpId, msgId;
+
+	clear();
+
+	if(!(is >> grpId >> msgId) ||
+	        grpId.length() != 2*RsGxsGroupId::SIZE_IN_BYTES ||
+	        msgId.length() != 2*RsGxsMessageId::SIZE_IN_BYTES )
+		return false;
+
+	mGroupId = RsGxsGroupId(grpId);
+	mMsgId = RsGxsMessageId(msgId);
+	return true;
+}
+
+RsGxsSinglePassIntegrityCheck::RsGxsSinglePassIntegrityCheck(
+        RsGeneralDataService* mds, const RsGxsIntegrityCursor& cursor )
+  : mDs(mds), mCursor(cursor), mBatchSize(INTEGRITY_CHECK_BATCH_SIZE),
+    mMaxRate(0), mHashThreads(0),
+    mStartTime(std::chrono::steady_clock::now()), mCheckedBytes(0)
+{
+	setHashThreads(0);
+}
+
+void RsGxsSinglePassIntegrityCheck::setHashThreads(uint32_t threads)
+{
+	if(!threads)
+		threads = std::min( std::max(std::thread::hardware_concurrency(), 1u),
+		                    INTEGRITY_CHECK_MAX_HASH_THREADS );
+	mHashThreads = threads;
+}
+
 bool RsGxsSinglePassIntegrityCheck::check(
         uint16_t /*service_type*/, RsGixs* /*mgixs*/, RsGeneralDataService* mds,
         std::vector<RsGxsGroupId>& grpsToDel, GxsMsgReq& msgsToDel )
@@ -358,107 +445,224 @@ bool RsGxsSinglePassIntegrityCheck::check(
     GXSUTIL_DEBUG() << "Parsing all groups and messages data in service " << std::hex << mds->serviceType() << " for integrity check. Could take a while..." << std::endl;
 #endif
 
-    // first take out all the groups
-    std::map<RsGxsGroupId, RsNxsGrp*> grp;
-    mds->retrieveNxsGrps(grp, true);
-    GxsMsgReq msgIds;
-    GxsMsgReq grps;
+	RsGxsSinglePassIntegrityCheck checker(mds);
+	checker.run([]() { return false; });
 
-    std::map<RsGxsId,RsIdentityUsage> used_gxs_ids ;
-    std::set<RsGxsGroupId> subscribed_groups ;
+	grpsToDel.insert(grpsToDel.end(), checker.mGrpsToDel.begin(), checker.mGrpsToDel.end());
 
-    // compute hash and compare to stored value, if it fails then simply add it
-    // to list
-    for( std::map<RsGxsGroupId, RsNxsGrp*>::iterator git = grp.begin(); git != grp.end(); ++git )
-    {
-        RsNxsGrp* grp = git->second;
-        RsFileHash currHash;
-        pqihash pHash;
-        pHash.addData(grp->grp.bin_data, grp->grp.bin_len);
-        pHash.Complete(currHash);
+	for(auto& it: checker.mMsgsToDel)
+		msgsToDel[it.first].insert(it.second.begin(), it.second.end());
 
-        if(currHash == grp->metaData->mHash)
-        {
-            // Get all message ids of group, store them in msgIds, creating the grp entry at the same time.
+	return true;
+}
 
-            if (mds->retrieveMsgIds(grp->grpId, msgIds[grp->grpId]) == 1)
-            {
-                // store the group for retrieveNxsMsgs
-                grps[grp->grpId];
+bool RsGxsSinglePassIntegrityCheck::run(const std::function<bool()>& shouldStop)
+{
+	// Only ids are loaded for the whole service. Groups and messages are
+	// then retrieved a few at a time.
 
-                if(grp->metaData->mSubscribeFlags & GXS_SERV::GROUP_SUBSCRIBE_SUBSCRIBED)
-                    subscribed_groups.insert(git->first);
-            }
-            else
-                msgIds.erase(msgIds.find(grp->grpId));	// could not get them, so group is removed from list.
-        }
-		else
+	std::vector<RsGxsGroupId> grpIds;
+	mDs->retrieveGroupIds(grpIds);
+	std::sort(grpIds.begin(), grpIds.end());
+
+	auto git = std::lower_bound(grpIds.begin(), grpIds.end(), mCursor.mGroupId);
+
+	for(; git != grpIds.end(); ++git)
+	{
+		if(shouldStop())
+			return false;
+
+		if(mCursor.mGroupId != *git)	// new group, or the group of the cursor was deleted
 		{
-			RS_WARN( "deleting group ", grp->grpId,
-			         " with wrong hash or null/corrupted meta data. meta=",
-			         grp->metaData );
-			grpsToDel.push_back(grp->grpId);
+			mCursor.mGroupId = *git;
+			mCursor.mMsgId.clear();
 		}
 
-        delete grp;
-    }
+		// The group data is checked before its first message only. Messages
+		// of a corrupted group go away with it.
 
-    // now messages
-    GxsMsgResult msgs;
+		if(mCursor.mMsgId.isNull() && !checkGroup(*git, shouldStop))
+			continue;
 
-    mds->retrieveNxsMsgs(grps, msgs, true);
+		if(!checkMessages(*git, shouldStop))
+			return false;
+	}
 
-    // Check msg ids and messages. Go through all message IDs referred to by the db call
-    // and verify that the message belongs to the nxs msg data that was just retrieved.
+	mCursor.clear();
+	return true;
+}
 
-    for(auto& msgIdsIt:msgIds)
-    {
-        const RsGxsGroupId&       grpId  = msgIdsIt.first;
-        std::set<RsGxsMessageId>& msgIdV = msgIdsIt.second;
+bool RsGxsSinglePassIntegrityCheck::checkGroup(
+        const RsGxsGroupId& grpId, const std::function<bool()>& shouldStop )
+{
+	std::map<RsGxsGroupId, RsNxsGrp*> grps;
+	grps[grpId] = nullptr;
+
+	mDs->retrieveNxsGrps(grps, true);
+
+	auto it = grps.find(grpId);
+
+	if(it == grps.end() || !it->second)		// deleted in the meantime
+		return false;
+
+	RsNxsGrp* grp = it->second;
+	RsFileHash currHash;
+	pqihash pHash;
+	pHash.addData(grp->grp.bin_data, grp->grp.bin_len);
+	pHash.Complete(currHash);
+
+	bool ok = grp->metaData && currHash == grp->metaData->mHash;
 
-        std::set<RsGxsMessageId> nxsMsgS;
-        std::vector<RsNxsMsg*>& nxsMsgV = msgs[grpId];
+	if(!ok)
+	{
+		RS_WARN( "group ", grp->grpId,
+		         " has a wrong hash or null/corrupted meta data. meta=",
+		         grp->metaData );
+		mGrpsToDel.push_back(grp->grpId);
+	}
+
+	uint32_t size = grp->grp.bin_len;
+	delete grp;
+
+	mCheckedBytes += size;
+	throttle(size, shouldStop);
+
+	return ok;
+}
+
+bool RsGxsSinglePassIntegrityCheck::checkMessages(
+        const RsGxsGroupId& grpId, const std::function<bool()>& shouldStop )
+{
+	std::set<RsGxsMessageId> msgIds;
+
+	if(mDs->retrieveMsgIds(grpId, msgIds) != 1)
+		return true;	// could not get them, so group is skipped.
+
+	auto mit = mCursor.mMsgId.isNull() ? msgIds.begin() : msgIds.upper_bound(mCursor.mMsgId);
+
+	while(mit != msgIds.end())
+	{
+		if(shouldStop())
+			return false;
+
+		GxsMsgReq req;
+		std::set<RsGxsMessageId>& batch = req[grpId];
+
+		for(uint32_t i=0; i<mBatchSize && mit != msgIds.end(); ++i, ++mit)
+			batch.insert(*mit);
+
+		GxsMsgResult msgs;
+		mDs->retrieveNxsMsgs(req, msgs, true);
+
+		std::vector<RsNxsMsg*>& msgV = msgs[grpId];
 
-        // To make the search efficient, we first build a set of msgIds to search in.
-        // Set build and search are both O(n log(n)).
+		// Messages which ids are in the db but that could not be retrieved
+		// are deleted too.
 
-        for(auto& nxsMsg:nxsMsgV)
-            if(nxsMsg)
-                nxsMsgS.insert(nxsMsg->msgId);
+		std::set<RsGxsMessageId> nxsMsgS;
+		std::vector<const RsTlvBinaryData*> data;
+		uint64_t size = 0;
 
-		for (auto& msgId:msgIdV)
+		for(auto& msg: msgV)
+			if(msg)
+			{
+				nxsMsgS.insert(msg->msgId);
+				data.push_back(&msg->msg);
+				size += msg->msg.bin_len;
+			}
+
+		for(auto& msgId: batch)
 			if(nxsMsgS.find(msgId) == nxsMsgS.end())
-				msgsToDel[grpId].insert(msgId);
-    }
+				mMsgsToDel[grpId].insert(msgId);
 
-    for(auto mit = msgs.begin(); mit != msgs.end(); ++mit)
-    {
-        std::vector<RsNxsMsg*>& msgV = mit->second;
-        std::vector<RsNxsMsg*>::iterator vit = msgV.begin();
+		std::vector<RsFileHash> hashes;
+		computeHashes(data, hashes);
 
-        for(; vit != msgV.end(); ++vit)
-        {
-            RsNxsMsg* msg = *vit;
-            RsFileHash currHash;
-            pqihash pHash;
-            pHash.addData(msg->msg.bin_data, msg->msg.bin_len);
-            pHash.Complete(currHash);
+		size_t n = 0;
+		for(auto& msg: msgV)
+		{
+			if(!msg)
+				continue;
 
-            if(msg->metaData == NULL || currHash != msg->metaData->mHash)
-            {
-				RS_WARN( "deleting message ", msg->msgId, " in group ",
+			if(msg->metaData == NULL || hashes[n] != msg->metaData->mHash)
+			{
+				RS_WARN( "message ", msg->msgId, " in group ",
 				         msg->grpId,
-				         " with wrong hash or null/corrupted meta data. meta=",
+				         " has a wrong hash or null/corrupted meta data. meta=",
 				         static_cast<void*>(msg->metaData) );
-                msgsToDel[msg->grpId].insert(msg->msgId);
-            }
+				mMsgsToDel[msg->grpId].insert(msg->msgId);
+			}
 
-            delete msg;
-        }
-    }
+			++n;
+			delete msg;
+		}
 
-    return true;
+		mCursor.mMsgId = *batch.rbegin();
+		mCheckedBytes += size;
+
+		throttle(size, shouldStop);
+	}
+
+	return true;
+}
+
+void RsGxsSinglePassIntegrityCheck::computeHashes(
+        const std::vector<const RsTlvBinaryData*>& data,
+        std::vector<RsFileHash>& hashes ) const
+{
+	hashes.resize(data.size());
+
+	std::atomic<size_t> next(0);
+
+	auto hashWorker = [&]()
+	{
+		for(size_t i = next++; i < data.size(); i = next++)
+		{
+			pqihash pHash;
+			pHash.addData(data[i]->bin_data, data[i]->bin_len);
+			pHash.Complete(hashes[i]);
+		}
+	};
+
+	// Helpers run on the scheduler pool while this thread hashes too, so
+	// that the batch is done even if the pool is busy. Removing them waits
+	// for the ones still hashing, and cancels the ones which did not start.
+
+	size_t nThreads = std::min<size_t>(mHashThreads, data.size());
+	std::vector<RsScheduler::JobId> helpers;
+
+	for(size_t i=1; i<nThreads; ++i)
+		helpers.push_back(RsScheduler::instance().addJob(
+		                      "gxs integrity hash", hashWorker,
+		                      std::chrono::hours(1) ));
+
+	hashWorker();
+
+	for(auto id: helpers)
+		RsScheduler::instance().removeJob(id);
+}
+
+void RsGxsSinglePassIntegrityCheck::throttle(
+        uint64_t bytes, const std::function<bool()>& shouldStop )
+{
+	if(!mMaxRate || !bytes)
+		return;
+
+	// mCheckedBytes bytes should have taken at least that long to read
+
+	auto target = mStartTime + std::chrono::microseconds(mCheckedBytes * 1000000 / mMaxRate);
+
+	for(auto now = std::chrono::steady_clock::now(); now < target && !shouldStop(); now = std::chrono::steady_clock::now())
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(target - now, std::chrono::milliseconds(100)));
 }
+
+void RsGxsSinglePassIntegrityCheck::getDeletedIds(
+        std::vector<RsGxsGroupId>& grpsToDel, GxsMsgReq& msgsToDel ) const
+{
+	grpsToDel = mGrpsToDel;
+	msgsToDel = mMsgsToDel;
+}
+
 bool RsGxsIntegrityCheck::isDone()
 {
 	RS_STACK_MUTEX(mIntegrityMutex);
@@ -472,3 +676,9 @@ void RsGxsIntegrityCheck::getDeletedIds(std::vector<RsGxsGroupId>& grpIds, GxsMs
 	msgIds = mDeletedMsgs;
 }
 
+RsGxsIntegrityCursor RsGxsIntegrityCheck::getCursor()
+{
+	RS_STACK_MUTEX(mIntegrityMutex);
+	return mCursor;
+}
+
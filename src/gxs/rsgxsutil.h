@@ -24,6 +24,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
 #include <vector>
 #include "rsitems/rsnxsitems.h"
 #include "rsgds.h"
@@ -153,9 +156,31 @@ private:
     uint32_t CHUNK_SIZE;
 };
 
+/*!
+ * Position reached by RsGxsSinglePassIntegrityCheck. Groups and messages are
+ * checked in id order: every group before mGroupId is done, and so are the
+ * messages of mGroupId up to mMsgId included.
+ */
+struct RsGxsIntegrityCursor
+{
+	RsGxsGroupId mGroupId;
+	RsGxsMessageId mMsgId;
+
+	bool isNull() const { return mGroupId.isNull(); }
+	void clear() { mGroupId.clear(); mMsgId.clear(); }
+
+	/// group and message ids in hex, to be stored
+	std::string toString() const;
+	bool fromString(const std::string& str);
+};
+
 /*!
  * Checks the integrity message and groups
  * in rsDataService using computed hash
+ * The hash check of the data is only done when built with
+ * RS_GXS_INTEGRITY_HASH_CHECK. It then reports wrong hashes but deletes
+ * nothing, as a hash computed differently by another version would otherwise
+ * wipe the service.
  */
 class RsGxsIntegrityCheck : public RsThread
 {
@@ -165,7 +190,8 @@ class RsGxsIntegrityCheck : public RsThread
 public:
 	RsGxsIntegrityCheck( RsGeneralDataService* const dataService,
 	                     RsGenExchange* genex, RsSerialType&,
-	                     RsGixs* gixs );
+	                     RsGixs* gixs,
+	                     const RsGxsIntegrityCursor& cursor = RsGxsIntegrityCursor() );
 
     static bool check(uint16_t service_type, RsGixs *mgixs, RsGeneralDataService *mds);
     bool isDone();
@@ -174,6 +200,9 @@ public:
 
     void getDeletedIds(std::vector<RsGxsGroupId> &grpIds, GxsMsgReq &msgIds);
 
+    /// where the hash check stopped, to be given to the next check
+    RsGxsIntegrityCursor getCursor();
+
 private:
 
     RsGeneralDataService* const mDs;
@@ -182,20 +211,83 @@ private:
     RsMutex mIntegrityMutex;
     std::vector<RsGxsGroupId> mDeletedGrps;
     GxsMsgReq mDeletedMsgs;
+    RsGxsIntegrityCursor mCursor;
 
     RsGixs* mGixs;
 };
 
 /*!
  * Checks the integrity message and groups
- * in rsDataService using computed hash
+ * in rsDataService using computed hash.
+ * Data is read a few messages at a time and hashed on several threads, so
+ * that memory use doesn't depend on the size of the database. The read rate
+ * can be limited to leave the database to the service. The check can be
+ * interrupted between two batches, and resumed later from its cursor.
  */
 class RsGxsSinglePassIntegrityCheck
 {
 public:
+	RsGxsSinglePassIntegrityCheck(
+	        RsGeneralDataService* mds,
+	        const RsGxsIntegrityCursor& cursor = RsGxsIntegrityCursor() );
+
+	/// number of messages read from the database at once
+	void setBatchSize(uint32_t msgs) { mBatchSize = std::max(msgs, 1u); }
+
+	/// maximum number of bytes read per second, 0 for no limit
+	void setMaxRate(uint64_t bytesPerSecond) { mMaxRate = bytesPerSecond; }
+
+	/// number of hashing jobs run at once on RsScheduler, 0 to use the number of cores
+	void setHashThreads(uint32_t threads);
+
+	/*!
+	 * Check groups and messages, starting at the cursor.
+	 * @param shouldStop called between two batches, the check is interrupted
+	 *	when it returns true
+	 * @return true if the end of the database was reached, the cursor is then
+	 *	cleared. false if interrupted.
+	 */
+	bool run(const std::function<bool()>& shouldStop);
+
+	const RsGxsIntegrityCursor& cursor() const { return mCursor; }
+	uint64_t checkedBytes() const { return mCheckedBytes; }
+
+	void getDeletedIds(
+	        std::vector<RsGxsGroupId>& grpsToDel, GxsMsgReq& msgsToDel ) const;
+
+	/// Check the whole database at once
 	static bool check(
 	        uint16_t service_type, RsGixs* mgixs, RsGeneralDataService* mds,
 	        std::vector<RsGxsGroupId>& grpsToDel, GxsMsgReq& msgsToDel );
+
+private:
+	/// @return false if the group was deleted
+	bool checkGroup(
+	        const RsGxsGroupId& grpId, const std::function<bool()>& shouldStop );
+
+	/// @return false if interrupted
+	bool checkMessages(
+	        const RsGxsGroupId& grpId, const std::function<bool()>& shouldStop );
+
+	void computeHashes(
+	        const std::vector<const RsTlvBinaryData*>& data,
+	        std::vector<RsFileHash>& hashes ) const;
+
+	/// sleep as long as needed to respect mMaxRate
+	void throttle(uint64_t bytes, const std::function<bool()>& shouldStop);
+
+	RsGeneralDataService* mDs;
+	RsGxsIntegrityCursor mCursor;
+
+	uint32_t mBatchSize;
+	uint64_t mMaxRate;
+	uint32_t mHashThreads;
+
+	std::chrono::steady_clock::time_point mStartTime;
+	uint64_t mCheckedBytes;
+
+	std::vector<RsGxsGroupId> mGrpsToDel;
+	GxsMsgReq mMsgsToDel;
 };
 
 class GroupUpdate
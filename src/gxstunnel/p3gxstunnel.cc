@@ -26,6 +26,7 @@
 #include "openssl/err.h"
 
 #include "crypto/rsaes.h"
+#include "crypto/chacha20.h"
 #include "util/rsprint.h"
 #include "util/rsmemory.h"
 
@@ -54,6 +55,17 @@ static const uint32_t RS_GXS_TUNNEL_DATA_PRINT_STORAGE_DELAY = 600 ; // store ol
 static const uint32_t GXS_TUNNEL_ENCRYPTION_HMAC_SIZE    = SHA_DIGEST_LENGTH ;
 static const uint32_t GXS_TUNNEL_ENCRYPTION_IV_SIZE      = 8 ;
 
+// AEAD packets: [0xae 0xad format 0x01] [12 bytes nonce] [encrypted item] [16 bytes tag]
+// Header and nonce are authenticated. Same layout as encrypted FT items.
+
+static const uint32_t GXS_TUNNEL_AEAD_HEADER_SIZE        = 4 ;
+static const uint32_t GXS_TUNNEL_AEAD_NONCE_SIZE         = 12 ;
+static const uint32_t GXS_TUNNEL_AEAD_TAG_SIZE           = 16 ;
+static const uint32_t GXS_TUNNEL_AEAD_ANNOUNCEMENTS      = 3 ;	// capability is sent with the ACK, then with the next keep alive packets
+
+static const uint8_t  GXS_TUNNEL_AEAD_FORMAT_CHACHA20_POLY1305 = 0x01 ;
+static const uint8_t  GXS_TUNNEL_AEAD_FORMAT_AES_256_GCM       = 0x02 ;
+
 #ifdef DEBUG_GXS_TUNNEL
 static const uint32_t INTERVAL_BETWEEN_DEBUG_DUMP        = 10 ;
 #endif
@@ -67,6 +79,15 @@ static const uint8_t GXS_TUNNEL_MIN_MINOR_VERSION = 0x00 ;
         
 RsGxsTunnelService *rsGxsTunnel = NULL ;
 
+// Legacy packets start with a random IV, so the legacy sender makes sure that it never looks like this header.
+
+static bool looksLikeAeadPacket(const uint8_t *data,uint32_t size)
+{
+    return size > GXS_TUNNEL_AEAD_HEADER_SIZE + GXS_TUNNEL_AEAD_NONCE_SIZE + GXS_TUNNEL_AEAD_TAG_SIZE
+            && data[0] == 0xae && data[1] == 0xad && data[3] == 0x01
+            && (data[2] == GXS_TUNNEL_AEAD_FORMAT_CHACHA20_POLY1305 || data[2] == GXS_TUNNEL_AEAD_FORMAT_AES_256_GCM) ;
+}
+
 p3GxsTunnelService::p3GxsTunnelService(RsGixs *pids) 
             : mGixs(pids), mGxsTunnelMtx("GXS tunnel")
 {
@@ -248,6 +269,9 @@ void p3GxsTunnelService::flush()
 
             pendingGxsTunnelItems.push_back(cs) ;
 
+            if(it->second.aead_announcements_left > 0)
+                locked_sendAeadCapabilities(it->first) ;
+
             it->second.last_keep_alive_sent = now ;
 #ifdef DEBUG_GXS_TUNNEL
             std::cerr << "(II) GxsTunnelService:: Sending keep alive packet to gxs id " << it->first << std::endl;
@@ -445,6 +469,20 @@ void p3GxsTunnelService::handleRecvStatusItem(const RsGxsTunnelId& tunnel_id, Rs
 #endif
 	    break ;
 
+    case RS_GXS_TUNNEL_FLAG_AEAD_CAPABILITIES:
+    {
+	    RS_STACK_MUTEX(mGxsTunnelMtx); /********** STACK LOCKED MTX ******/
+
+	    std::map<RsGxsTunnelId,GxsTunnelPeerInfo>::iterator it = _gxs_tunnel_contacts.find(tunnel_id) ;
+
+	    if(it != _gxs_tunnel_contacts.end() && !it->second.peer_accepts_aead)
+	    {
+		    std::cerr << "(II) distant peer of tunnel " << tunnel_id << " accepts AEAD packets. Switching to AEAD mode." << std::endl;
+		    it->second.peer_accepts_aead = true ;
+	    }
+    }
+	    break ;
+
     case RS_GXS_TUNNEL_FLAG_ACK_DISTANT_CONNECTION:
     {
 #ifdef DEBUG_GXS_TUNNEL    
@@ -791,11 +829,17 @@ bool p3GxsTunnelService::handleEncryptedData(const uint8_t *data_bytes,uint32_t
     {
         RS_STACK_MUTEX(mGxsTunnelMtx); /********** STACK LOCKED MTX ******/
 
+        if(data_size < GXS_TUNNEL_ENCRYPTION_IV_SIZE + GXS_TUNNEL_ENCRYPTION_HMAC_SIZE)
+        {
+            std::cerr << "(EE) encrypted packet is too small: size = " << data_size << std::endl;
+            return false ;
+        }
+
         uint32_t encrypted_size = data_size - GXS_TUNNEL_ENCRYPTION_IV_SIZE - GXS_TUNNEL_ENCRYPTION_HMAC_SIZE;
         uint32_t decrypted_size = RsAES::get_buffer_size(encrypted_size);
         uint8_t *encrypted_data = (uint8_t*)data_bytes+GXS_TUNNEL_ENCRYPTION_IV_SIZE+GXS_TUNNEL_ENCRYPTION_HMAC_SIZE;
         
-        RsTemporaryMemory decrypted_data(decrypted_size);
+        RsTemporaryMemory decrypted_data(decrypted_size);	// also large enough for AEAD packets, which are smaller
         uint8_t aes_key[GXS_TUNNEL_AES_KEY_SIZE] ;
         
         if(!decrypted_data)
@@ -827,37 +871,77 @@ bool p3GxsTunnelService::handleEncryptedData(const uint8_t *data_bytes,uint32_t
         }
 #endif
 
-        memcpy(aes_key,it2->second.aes_key,GXS_TUNNEL_AES_KEY_SIZE) ;
+        bool decrypted = false ;
 
-#ifdef DEBUG_GXS_TUNNEL
-        std::cerr << "   Using IV: " << std::hex << *(uint64_t*)data_bytes << std::dec << std::endl;
-        std::cerr << "   Decrypted buffer size: " << decrypted_size << std::endl;
-        std::cerr << "   key  : " << RsUtil::BinToHex((unsigned char*)aes_key,GXS_TUNNEL_AES_KEY_SIZE) << std::endl;
-        std::cerr << "   hmac : " << RsUtil::BinToHex((unsigned char*)data_bytes+GXS_TUNNEL_ENCRYPTION_IV_SIZE,GXS_TUNNEL_ENCRYPTION_HMAC_SIZE) << std::endl;
-        std::cerr << "   data : " << RsUtil::BinToHex((unsigned char*)data_bytes,data_size,100) << std::endl;
-#endif
-        // first, check the HMAC
-        
-        unsigned char *hm = HMAC(EVP_sha1(),aes_key,GXS_TUNNEL_AES_KEY_SIZE,encrypted_data,encrypted_size,NULL,NULL) ;
-        
-        if(memcmp(hm,&data_bytes[GXS_TUNNEL_ENCRYPTION_IV_SIZE],GXS_TUNNEL_ENCRYPTION_HMAC_SIZE))
+        if(looksLikeAeadPacket(data_bytes,data_size))
         {
-            std::cerr << "(EE) packet HMAC does not match. Computed HMAC=" << RsUtil::BinToHex((char*)hm,GXS_TUNNEL_ENCRYPTION_HMAC_SIZE) << std::endl;
-            std::cerr << "(EE) resetting new DH session." << std::endl;
+            // The turtle item is const, so the encrypted item is copied once, and then decrypted in place.
 
-            locked_restartDHSession(virtual_peer_id,it2->second.own_gxs_id) ;
+            uint8_t aad[GXS_TUNNEL_AEAD_HEADER_SIZE + GXS_TUNNEL_AEAD_NONCE_SIZE] ;
+            uint8_t tag[GXS_TUNNEL_AEAD_TAG_SIZE] ;
+            uint32_t clear_size = data_size - sizeof(aad) - GXS_TUNNEL_AEAD_TAG_SIZE ;
 
-            return false ;
+            memcpy(aad,data_bytes,sizeof(aad)) ;
+            memcpy(tag,&data_bytes[sizeof(aad)+clear_size],GXS_TUNNEL_AEAD_TAG_SIZE) ;
+            memcpy(decrypted_data,&data_bytes[sizeof(aad)],clear_size) ;
+
+            uint8_t *nonce = &aad[GXS_TUNNEL_AEAD_HEADER_SIZE] ;
+
+            if(data_bytes[2] == GXS_TUNNEL_AEAD_FORMAT_AES_256_GCM)
+                decrypted = librs::crypto::AEAD_aes_256_gcm(it2->second.aead_key,nonce,decrypted_data,clear_size,aad,sizeof(aad),tag,false) ;
+            else
+                decrypted = librs::crypto::AEAD_chacha20_poly1305(it2->second.aead_key,nonce,decrypted_data,clear_size,aad,sizeof(aad),tag,false) ;
+
+            if(decrypted)
+            {
+                decrypted_size = clear_size ;
+
+                if(!it2->second.peer_accepts_aead)
+                    std::cerr << "(II) received AEAD packet in tunnel " << tunnel_id << ". Switching to AEAD mode." << std::endl;
+
+                it2->second.peer_accepts_aead = true ;
+            }
+#ifdef DEBUG_GXS_TUNNEL
+            else
+                std::cerr << "   AEAD authentication failed. Trying legacy format." << std::endl;
+#endif
+            // If not decrypted, this can still be a legacy packet sent by an old peer, with an IV that looks like an AEAD header.
         }
 
-        if(!RsAES::aes_decrypt_8_16(encrypted_data,encrypted_size, aes_key,(uint8_t*)data_bytes,decrypted_data,decrypted_size))
+        if(!decrypted)
         {
-            std::cerr << "(EE) packet decryption failed." << std::endl;
-            std::cerr << "(EE) resetting new DH session." << std::endl;
+            memcpy(aes_key,it2->second.aes_key,GXS_TUNNEL_AES_KEY_SIZE) ;
 
-            locked_restartDHSession(virtual_peer_id,it2->second.own_gxs_id) ;
+#ifdef DEBUG_GXS_TUNNEL
+            std::cerr << "   Using IV: " << std::hex << *(uint64_t*)data_bytes << std::dec << std::endl;
+            std::cerr << "   Decrypted buffer size: " << decrypted_size << std::endl;
+            std::cerr << "   key  : " << RsUtil::BinToHex((unsigned char*)aes_key,GXS_TUNNEL_AES_KEY_SIZE) << std::endl;
+            std::cerr << "   hmac : " << RsUtil::BinToHex((unsigned char*)data_bytes+GXS_TUNNEL_ENCRYPTION_IV_SIZE,GXS_TUNNEL_ENCRYPTION_HMAC_SIZE) << std::endl;
+            std::cerr << "   data : " << RsUtil::BinToHex((unsigned char*)data_bytes,data_size,100) << std::endl;
+#endif
+            // first, check the HMAC
 
-            return false ;
+            unsigned char *hm = HMAC(EVP_sha1(),aes_key,GXS_TUNNEL_AES_KEY_SIZE,encrypted_data,encrypted_size,NULL,NULL) ;
+
+            if(memcmp(hm,&data_bytes[GXS_TUNNEL_ENCRYPTION_IV_SIZE],GXS_TUNNEL_ENCRYPTION_HMAC_SIZE))
+            {
+                std::cerr << "(EE) packet HMAC does not match. Computed HMAC=" << RsUtil::BinToHex((char*)hm,GXS_TUNNEL_ENCRYPTION_HMAC_SIZE) << std::endl;
+                std::cerr << "(EE) resetting new DH session." << std::endl;
+
+                locked_restartDHSession(virtual_peer_id,it2->second.own_gxs_id) ;
+
+                return false ;
+            }
+
+            if(!RsAES::aes_decrypt_8_16(encrypted_data,encrypted_size, aes_key,(uint8_t*)data_bytes,decrypted_data,decrypted_size))
+            {
+                std::cerr << "(EE) packet decryption failed." << std::endl;
+                std::cerr << "(EE) resetting new DH session." << std::endl;
+
+                locked_restartDHSession(virtual_peer_id,it2->second.own_gxs_id) ;
+
+                return false ;
+            }
         }
         it2->second.status = RS_GXS_TUNNEL_STATUS_CAN_TALK ;
         it2->second.last_contact = time(NULL) ;
@@ -1025,10 +1109,7 @@ void p3GxsTunnelService::handleRecvDHPublicKey(RsGxsTunnelDHPublicKeyItem *item)
     
     GxsTunnelPeerInfo& pinfo(_gxs_tunnel_contacts[tunnel_id]) ;
 
-    // Now hash the key buffer into a 16 bytes key.
-
-    assert(GXS_TUNNEL_AES_KEY_SIZE <= Sha1CheckSum::SIZE_IN_BYTES) ;
-    memcpy(pinfo.aes_key, RsDirUtil::sha1sum(key_buff,size).toByteArray(),GXS_TUNNEL_AES_KEY_SIZE) ;
+    locked_initSessionKeys(pinfo,key_buff,size) ;
     
     pinfo.last_contact = time(NULL) ;
     pinfo.last_keep_alive_sent = time(NULL) ;
@@ -1058,6 +1139,47 @@ void p3GxsTunnelService::handleRecvDHPublicKey(RsGxsTunnelDHPublicKeyItem *item)
     cs->PeerId(RsPeerId(tunnel_id)) ;
 
     pendingGxsTunnelItems.push_back(cs) ;
+
+    // Tell the peer that we can receive AEAD packets. Old peers ignore this status.
+
+    locked_sendAeadCapabilities(tunnel_id) ;
+}
+
+void p3GxsTunnelService::locked_initSessionKeys(GxsTunnelPeerInfo& pinfo,const unsigned char *secret,uint32_t secret_size)
+{
+    // Now hash the key buffer into a 16 bytes key.
+
+    assert(GXS_TUNNEL_AES_KEY_SIZE <= Sha1CheckSum::SIZE_IN_BYTES) ;
+    memcpy(pinfo.aes_key, RsDirUtil::sha1sum(secret,secret_size).toByteArray(),GXS_TUNNEL_AES_KEY_SIZE) ;
+
+    // The AEAD key is derived separately, so that the two keys are independent.
+
+    static const std::string aead_key_label = "GxsTunnelAEAD" ;
+    unsigned int aead_key_size = GXS_TUNNEL_AEAD_KEY_SIZE ;
+
+    HMAC(EVP_sha256(),secret,secret_size,(const unsigned char*)aead_key_label.c_str(),aead_key_label.length(),pinfo.aead_key,&aead_key_size) ;
+
+    // The distant end may not be the same node as before, so the AEAD capability is negociated again.
+
+    pinfo.peer_accepts_aead = false ;
+    pinfo.aead_announcements_left = GXS_TUNNEL_AEAD_ANNOUNCEMENTS ;
+}
+
+void p3GxsTunnelService::locked_sendAeadCapabilities(const RsGxsTunnelId& tunnel_id)
+{
+    std::map<RsGxsTunnelId,GxsTunnelPeerInfo>::iterator it = _gxs_tunnel_contacts.find(tunnel_id) ;
+
+    if(it == _gxs_tunnel_contacts.end() || it->second.aead_announcements_left == 0)
+        return ;
+
+    RsGxsTunnelStatusItem *cs = new RsGxsTunnelStatusItem ;
+
+    cs->status = RS_GXS_TUNNEL_FLAG_AEAD_CAPABILITIES;
+    cs->PeerId(RsPeerId(tunnel_id)) ;
+
+    pendingGxsTunnelItems.push_back(cs) ;	// sent off-mutex to avoid deadlocking.
+
+    --it->second.aead_announcements_left ;
 }
 
 // Note: for some obscure reason, the typedef does not work here. Looks like a compiler error. So I use the primary type.
@@ -1261,24 +1383,130 @@ bool p3GxsTunnelService::locked_sendClearTunnelData(RsGxsTunnelDHPublicKeyItem *
     return true ;
 }
 
-// Sends this item using secured/authenticated method, thx to the establshed cryptographic channel.
+// Serialises the item and encrypts it for the given tunnel: in AEAD format if the peer accepts it, in the legacy AES+HMAC
+// format otherwise. On success, data_bytes is allocated with rs_malloc(). IV is only used for display.
 
-bool p3GxsTunnelService::locked_sendEncryptedTunnelData(RsGxsTunnelItem *item)
+bool p3GxsTunnelService::locked_encryptTunnelData(GxsTunnelPeerInfo& pinfo,RsGxsTunnelItem *item,void *& data_bytes,uint32_t& data_size,uint64_t& IV)
 {
     RsGxsTunnelSerialiser ser;
 
     uint32_t rssize = ser.size(item);
-    RsTemporaryMemory buff(rssize) ;
 
-    if(!ser.serialise(item,buff,&rssize))
+    if(pinfo.peer_accepts_aead)
     {
-	    std::cerr << "(EE) GxsTunnelService::sendEncryptedTunnelData(): Could not serialise item!" << std::endl;
-	    return false;
+        // AEAD mode: the item is serialised directly in the final packet, and encrypted+authenticated in place in a
+        // single pass. AES-GCM is used when the CPU has AES instructions, chacha20/poly1305 otherwise.
+
+        static const uint8_t aead_format = librs::crypto::has_hardware_aes() ? GXS_TUNNEL_AEAD_FORMAT_AES_256_GCM : GXS_TUNNEL_AEAD_FORMAT_CHACHA20_POLY1305 ;
+
+        uint32_t aad_size = GXS_TUNNEL_AEAD_HEADER_SIZE + GXS_TUNNEL_AEAD_NONCE_SIZE ;
+
+        data_size = aad_size + rssize + GXS_TUNNEL_AEAD_TAG_SIZE ;
+        data_bytes = rs_malloc(data_size) ;
+
+        if(data_bytes == NULL)
+            return false ;
+
+        uint8_t *edata = (uint8_t*)data_bytes ;
+        uint8_t *nonce = &edata[GXS_TUNNEL_AEAD_HEADER_SIZE] ;
+        uint8_t *clear_data = &edata[aad_size] ;
+
+        if(!ser.serialise(item,clear_data,&rssize))
+        {
+            std::cerr << "(EE) GxsTunnelService::sendEncryptedTunnelData(): Could not serialise item!" << std::endl;
+            free(data_bytes) ;
+            return false;
+        }
+
+        edata[0] = 0xae ;
+        edata[1] = 0xad ;
+        edata[2] = aead_format ;
+        edata[3] = 0x01 ;
+
+        RSRandom::random_bytes(nonce,GXS_TUNNEL_AEAD_NONCE_SIZE) ;
+        memcpy(&IV,nonce,8) ;	// only used for display
+
+        bool encrypted ;
+
+        if(aead_format == GXS_TUNNEL_AEAD_FORMAT_AES_256_GCM)
+            encrypted = librs::crypto::AEAD_aes_256_gcm(pinfo.aead_key,nonce,clear_data,rssize,edata,aad_size,&clear_data[rssize],true) ;
+        else
+            encrypted = librs::crypto::AEAD_chacha20_poly1305(pinfo.aead_key,nonce,clear_data,rssize,edata,aad_size,&clear_data[rssize],true) ;
+
+        if(!encrypted)
+        {
+            std::cerr << "(EE) packet encryption failed." << std::endl;
+            free(data_bytes) ;
+            return false;
+        }
+#ifdef DEBUG_GXS_TUNNEL
+        std::cerr << "GxsTunnelService::sendEncryptedTunnelData(): AEAD packet, format " << (int)aead_format << ", nonce " << RsUtil::BinToHex(nonce,GXS_TUNNEL_AEAD_NONCE_SIZE) << std::endl;
+#endif
     }
+    else
+    {
+        RsTemporaryMemory buff(rssize) ;
 
-    uint8_t aes_key[GXS_TUNNEL_AES_KEY_SIZE] ;
-    uint64_t IV = 0;
+        if(!ser.serialise(item,buff,&rssize))
+        {
+            std::cerr << "(EE) GxsTunnelService::sendEncryptedTunnelData(): Could not serialise item!" << std::endl;
+            return false;
+        }
+
+        uint8_t aes_key[GXS_TUNNEL_AES_KEY_SIZE] ;
+        memcpy(aes_key,pinfo.aes_key,GXS_TUNNEL_AES_KEY_SIZE) ;
+
+        // make a random 8 bytes IV, that is not 0 and cannot be mistaken for an AEAD header
+
+        while(IV == 0 || looksLikeAeadPacket((uint8_t*)&IV,sizeof(IV))) IV = RSRandom::random_u64() ;
 
+#ifdef DEBUG_GXS_TUNNEL
+        std::cerr << "GxsTunnelService::sendEncryptedTunnelData(): tunnel found. Encrypting data." << std::endl;
+#endif
+
+        // Now encrypt this data using AES.
+        //
+        uint32_t encrypted_size = RsAES::get_buffer_size(rssize);
+        RsTemporaryMemory encrypted_data(encrypted_size) ;
+
+        if(!RsAES::aes_crypt_8_16(buff,rssize,aes_key,(uint8_t*)&IV,encrypted_data,encrypted_size))
+        {
+            std::cerr << "(EE) packet encryption failed." << std::endl;
+            return false;
+        }
+
+        // make a TurtleGenericData item out of it:
+        //
+
+        data_size  = encrypted_size + GXS_TUNNEL_ENCRYPTION_IV_SIZE + GXS_TUNNEL_ENCRYPTION_HMAC_SIZE ;
+        data_bytes = rs_malloc(data_size) ;
+
+        if(data_bytes == NULL)
+            return false ;
+
+        memcpy(& ((uint8_t*)data_bytes)[0]                                       ,&IV,8) ;
+
+        unsigned int md_len = GXS_TUNNEL_ENCRYPTION_HMAC_SIZE ;
+        HMAC(EVP_sha1(),aes_key,GXS_TUNNEL_AES_KEY_SIZE,encrypted_data,encrypted_size,&(((uint8_t*)data_bytes)[GXS_TUNNEL_ENCRYPTION_IV_SIZE]),&md_len) ;
+
+        memcpy(& (((uint8_t*)data_bytes)[GXS_TUNNEL_ENCRYPTION_HMAC_SIZE+GXS_TUNNEL_ENCRYPTION_IV_SIZE]),encrypted_data,encrypted_size) ;
+
+#ifdef DEBUG_GXS_TUNNEL
+        std::cerr << "   Using  IV: " << std::hex << IV << std::dec << std::endl;
+        std::cerr << "   Using Key: " << RsUtil::BinToHex((char*)aes_key,GXS_TUNNEL_AES_KEY_SIZE) ; std::cerr << std::endl;
+        std::cerr << "        hmac: " << RsUtil::BinToHex((char*)data_bytes,GXS_TUNNEL_ENCRYPTION_HMAC_SIZE) << std::endl;
+#endif
+    }
+
+    pinfo.total_sent += rssize ;	// counts the size of clear data that is sent
+
+    return true ;
+}
+
+// Sends this item using secured/authenticated method, thx to the establshed cryptographic channel.
+
+bool p3GxsTunnelService::locked_sendEncryptedTunnelData(RsGxsTunnelItem *item)
+{
 #ifdef DEBUG_GXS_TUNNEL
     std::cerr << "Sending encrypted data to tunnel with vpid " << item->PeerId() << std::endl;
 #endif
@@ -1303,49 +1531,15 @@ bool p3GxsTunnelService::locked_sendEncryptedTunnelData(RsGxsTunnelItem *item)
 		return false;
 	}
 
-    it->second.total_sent += rssize ;	// counts the size of clear data that is sent
-    
-    memcpy(aes_key,it->second.aes_key,GXS_TUNNEL_AES_KEY_SIZE) ;
     RsPeerId virtual_peer_id = it->second.virtual_peer_id ;
 
-    while(IV == 0) IV = RSRandom::random_u64() ; // make a random 8 bytes IV, that is not 0
-
-#ifdef DEBUG_GXS_TUNNEL
-    std::cerr << "GxsTunnelService::sendEncryptedTunnelData(): tunnel found. Encrypting data." << std::endl;
-#endif
-
-    // Now encrypt this data using AES.
-    //
-    uint32_t encrypted_size = RsAES::get_buffer_size(rssize);
-    RsTemporaryMemory encrypted_data(encrypted_size) ;
-
-    if(!RsAES::aes_crypt_8_16(buff,rssize,aes_key,(uint8_t*)&IV,encrypted_data,encrypted_size))
-    {
-        std::cerr << "(EE) packet encryption failed." << std::endl;
-        return false;
-    }
-
-    // make a TurtleGenericData item out of it:
-    //
-
-    uint32_t data_size  = encrypted_size + GXS_TUNNEL_ENCRYPTION_IV_SIZE + GXS_TUNNEL_ENCRYPTION_HMAC_SIZE ;
-    void *data_bytes = rs_malloc(data_size) ;
+    uint32_t data_size = 0 ;
+    void *data_bytes = NULL ;
+    uint64_t IV = 0;
 
-    if(data_bytes == NULL)
+    if(!locked_encryptTunnelData(it->second,item,data_bytes,data_size,IV))
         return false ;
-    
-    memcpy(& ((uint8_t*)data_bytes)[0]                                       ,&IV,8) ;
 
-    unsigned int md_len = GXS_TUNNEL_ENCRYPTION_HMAC_SIZE ;
-    HMAC(EVP_sha1(),aes_key,GXS_TUNNEL_AES_KEY_SIZE,encrypted_data,encrypted_size,&(((uint8_t*)data_bytes)[GXS_TUNNEL_ENCRYPTION_IV_SIZE]),&md_len) ;
-    
-    memcpy(& (((uint8_t*)data_bytes)[GXS_TUNNEL_ENCRYPTION_HMAC_SIZE+GXS_TUNNEL_ENCRYPTION_IV_SIZE]),encrypted_data,encrypted_size) ;
-    
-#ifdef DEBUG_GXS_TUNNEL
-    std::cerr << "   Using  IV: " << std::hex << IV << std::dec << std::endl;
-    std::cerr << "   Using Key: " << RsUtil::BinToHex((char*)aes_key,GXS_TUNNEL_AES_KEY_SIZE) ; std::cerr << std::endl;
-    std::cerr << "        hmac: " << RsUtil::BinToHex((char*)data_bytes,GXS_TUNNEL_ENCRYPTION_HMAC_SIZE) << std::endl;
-#endif
 #ifdef DEBUG_GXS_TUNNEL
     std::cerr << "GxsTunnelService::sendEncryptedTunnelData(): Sending encrypted data to virtual peer: " << virtual_peer_id << std::endl;
     std::cerr << "   data_size = " << data_size << std::endl;
@@ -116,6 +116,7 @@
 class RsGixs ;
 
 static const uint32_t GXS_TUNNEL_AES_KEY_SIZE = 16 ;
+static const uint32_t GXS_TUNNEL_AEAD_KEY_SIZE = 32 ;
 
 class p3GxsTunnelService: public RsGxsTunnelService, public RsTurtleClientService, public p3Service
 {
@@ -150,18 +151,21 @@ private:
         GxsTunnelPeerInfo()
             : last_contact(0), last_keep_alive_sent(0), status(0), direction(0)
             , total_sent(0), total_received(0)
+            , peer_accepts_aead(false), aead_announcements_left(0)
   #ifndef V07_NON_BACKWARD_COMPATIBLE_CHANGE_004
             , accepts_fast_turtle_items(false)
             , already_probed_for_fast_items(false)
   #endif
         {
             memset(aes_key, 0, GXS_TUNNEL_AES_KEY_SIZE);
+            memset(aead_key, 0, GXS_TUNNEL_AEAD_KEY_SIZE);
         }
 
         rstime_t last_contact ; 		// used to keep track of working connexion
         rstime_t last_keep_alive_sent ;	// last time we sent a keep alive packet.
 
         unsigned char aes_key[GXS_TUNNEL_AES_KEY_SIZE] ;
+        unsigned char aead_key[GXS_TUNNEL_AEAD_KEY_SIZE] ;  // derived from the same DH secret, used in AEAD mode
 
         uint32_t status ;                                     // info: do we have a tunnel ?
         RsPeerId virtual_peer_id;                             // given by the turtle router. Identifies the tunnel.
@@ -173,6 +177,8 @@ private:
         std::map<uint64_t,rstime_t> received_data_prints ;    // list of recently received messages, to avoid duplicates. Kept for 20 mins at most.
         uint32_t total_sent ;                                 // total data sent to this peer
         uint32_t total_received ;                             // total data received by this peer
+        bool peer_accepts_aead ;                              // peer announced AEAD support, so we send AEAD packets instead of AES+HMAC
+        uint32_t aead_announcements_left ;                    // number of times we still send our own AEAD capability, in case it gets lost
 #ifndef V07_NON_BACKWARD_COMPATIBLE_CHANGE_004
         bool accepts_fast_turtle_items;                       // does the tunnel accept RsTurtleGenericFastDataItem type?
         bool already_probed_for_fast_items;                   // has the tunnel been probed already? If not, a fast item will be sent
@@ -233,6 +239,7 @@ private:
     void handleRecvDHPublicKey(RsGxsTunnelDHPublicKeyItem *item) ;
     bool locked_sendDHPublicKey(const DH *dh, const RsGxsId& own_gxs_id, const RsPeerId& virtual_peer_id) ;
     bool locked_initDHSessionKey(DH *&dh);
+    void locked_initSessionKeys(GxsTunnelPeerInfo& pinfo,const unsigned char *secret,uint32_t secret_size) ;	// legacy and AEAD keys from the DH secret
 	uint64_t locked_getPacketCounter();
 
     TurtleVirtualPeerId virtualPeerIdFromHash(const TurtleFileHash& hash) ;	// ... and to a hash for p3turtle
@@ -246,7 +253,9 @@ private:
     // Comunication with Turtle service
 
     bool locked_sendEncryptedTunnelData(RsGxsTunnelItem *item) ;
+    bool locked_encryptTunnelData(GxsTunnelPeerInfo& pinfo,RsGxsTunnelItem *item,void *& data_bytes,uint32_t& data_size,uint64_t& IV) ;
     bool locked_sendClearTunnelData(RsGxsTunnelDHPublicKeyItem *item);	// this limits the usage to DH items. Others should be encrypted!
+    void locked_sendAeadCapabilities(const RsGxsTunnelId& tunnel_id) ;
     
 #ifndef V07_NON_BACKWARD_COMPATIBLE_CHANGE_004
     bool handleEncryptedData(const uint8_t *data_bytes, uint32_t data_size, const TurtleFileHash& hash, const RsPeerId& virtual_peer_id, bool accepts_fast_items) ;
@@ -266,6 +275,8 @@ private:
     
     void debug_dump();
 
+    friend class GxsTunnelTest ;	// unit tests open tunnels and look at packets without a turtle router
+
 public:
 	/// creates a unique tunnel ID from two GXS ids.
 	static RsGxsTunnelId makeGxsTunnelId( const RsGxsId &own_id,
@@ -38,6 +38,7 @@
 const uint32_t RS_GXS_TUNNEL_FLAG_CLOSING_DISTANT_CONNECTION = 0x0400;
 const uint32_t RS_GXS_TUNNEL_FLAG_ACK_DISTANT_CONNECTION     = 0x0800;
 const uint32_t RS_GXS_TUNNEL_FLAG_KEEP_ALIVE                 = 0x1000;
+const uint32_t RS_GXS_TUNNEL_FLAG_AEAD_CAPABILITIES          = 0x2000;	// sender can receive AEAD encrypted packets
 
 const uint8_t RS_PKT_SUBTYPE_GXS_TUNNEL_DATA           = 0x01 ;	
 const uint8_t RS_PKT_SUBTYPE_GXS_TUNNEL_DH_PUBLIC_KEY  = 0x02 ;
@@ -234,6 +234,11 @@ def processFile(file):
 				outputParamsSerialization += '\t\t\tRsGenericSerializer::SerializeContext& ctx(cAns);\n'
 				outputParamsSerialization += '\t\t\tRsGenericSerializer::SerializeJob j(RsGenericSerializer::TO_JSON);\n';
 
+			# Out parameters are moved into the streaming function, which may run
+			# in another thread after the wrapper returned
+			outputParamsStreaming = ''
+			outputParamsCapture = []
+
 			paramsDeclaration = ''
 			for pn in orderedParamNames:
 				mp = paramsMap[pn]
@@ -247,13 +252,21 @@ def processFile(file):
 				if mp._out:
 					outputParamsSerialization += '\t\t\tRS_SERIAL_PROCESS('
 					outputParamsSerialization += mp._name + ');\n'
+					outputParamsStreaming += '\t\t\tRS_JSON_STREAM_MEMBER(w, '
+					outputParamsStreaming += mp._name + ');\n'
+					outputParamsCapture.append(
+						mp._name + ' = std::move(' + mp._name + ')' )
 
 			if hasInput: 
 				inputParamsDeserialization += '\t\t}\n'
 			if retvalType != 'void': 
 				outputParamsSerialization += '\t\t\tRS_SERIAL_PROCESS(retval);\n'
+				outputParamsStreaming += '\t\t\tRS_JSON_STREAM_MEMBER(w, retval);\n'
+				outputParamsCapture.append('retval = std::move(retval)')
 			if hasOutput:
 				outputParamsSerialization += '\t\t}\n'
+			else:
+				outputParamsStreaming += '\t\t\t(void) w;\n'
 
 			captureVars = ''
 
@@ -317,6 +330,8 @@ def processFile(file):
 			substitutionsMap['paramsDeclaration'] = paramsDeclaration
 			substitutionsMap['inputParamsDeserialization'] = inputParamsDeserialization
 			substitutionsMap['outputParamsSerialization'] = outputParamsSerialization
+			substitutionsMap['outputParamsStreaming'] = outputParamsStreaming
+			substitutionsMap['outputParamsCapture'] = ', '.join(outputParamsCapture)
 			substitutionsMap['instanceName'] = instanceName
 			substitutionsMap['functionCall'] = functionCall
 			substitutionsMap['apiPath'] = apiPath
@@ -22,7 +22,10 @@
 
 #include <string>
 #include <sstream>
+#include <iomanip>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 #include <typeinfo>
 #include <vector>
 
@@ -43,6 +46,8 @@
 #include "util/rstime.h"
 #include "retroshare/rsevents.h"
 #include "retroshare/rsversion.h"
+#include "retroshare/rsconfig.h"
+#include "serialiser/rsjsonstreamwriter.h"
 
 // Generated at compile time
 #include "jsonapi-includes.inl"
@@ -108,6 +113,209 @@ JsonApiServer::corsOptionsHeaders =
 	headers.insert({ "Content-Length", std::to_string(ans.length()) }); \
 	session->close(RET_CODE, ans, headers)
 
+/** Longest wait for a chunk of a streamed answer to be written to the caller */
+static const std::chrono::seconds JSONAPI_CHUNK_WRITE_TIMEOUT(60);
+
+/**
+ * Answer of an API call written with RsJsonStreamWriter while out parameters
+ * are serialized, so that big answers are never held in a JSON DOM.
+ * Answers that fit in one chunk are sent with Content-Length as usual, from the
+ * service thread. Bigger ones are sent chunk by chunk with chunked transfer
+ * encoding, if the caller speaks HTTP/1.1, otherwise they are sent as a whole
+ * when complete.
+ * Chunks are sent from another thread, which waits for each chunk to be written
+ * before serializing the next one, so that a slow caller never makes them pile
+ * up in the write queue of the session. The service thread can't wait, it is
+ * the one writing.
+ */
+class JsonApiStreamingAnswer :
+        public std::enable_shared_from_this<JsonApiStreamingAnswer>
+{
+public:
+	/// Writes the out parameters, called twice for answers bigger than a chunk
+	typedef std::function<void(RsJsonStreamWriter&)> StreamFunction;
+
+	static void send(
+	        const std::weak_ptr<rb::Service>& service,
+	        const std::shared_ptr<rb::Session>& session, const RsJson& jAns,
+	        const std::multimap<std::string, std::string>& headers,
+	        StreamFunction stream )
+	{
+		auto tHeaders = headers;
+		tHeaders.insert({ "Content-Type", "application/json" });
+
+		const bool canChunk = session->get_request()->get_version() >= 1.1;
+		bool tooBig = false;
+		bool finishing = false;
+		std::string body;
+
+		{
+			RsJsonStreamWriter w( [&](const char* data, size_t size)
+			{
+				/* The writer only hands out text before finish() when the
+				 * answer is bigger than a chunk */
+				if(canChunk && !finishing)
+				{
+					tooBig = true;
+					return false;
+				}
+
+				body.append(data, size);
+				return true;
+			} );
+
+			copyMembers(w, jAns);
+			stream(w);
+			finishing = true;
+			w.finish();
+		}
+
+		if(session->is_closed()) return;
+
+		if(!tooBig)
+		{
+			tHeaders.insert({ "Content-Length", std::to_string(body.length()) });
+			session->close(rb::OK, body, tHeaders);
+			return;
+		}
+
+		tHeaders.insert({ "Transfer-Encoding", "chunked" });
+
+		std::shared_ptr<JsonApiStreamingAnswer> answer(
+		            new JsonApiStreamingAnswer(service, session, tHeaders) );
+		auto members = std::make_shared<RsJson>();
+		members->CopyFrom(jAns, members->GetAllocator());
+		auto tStream = std::make_shared<StreamFunction>(std::move(stream));
+
+		RsThread::async([answer, members, tStream]()
+		{
+			RsJsonStreamWriter w( [answer](const char* data, size_t size)
+			{ return answer->writeChunk(data, size); } );
+
+			copyMembers(w, *members);
+			(*tStream)(w);
+
+			if(w.finish()) answer->close();
+			else answer->abort();
+		});
+	}
+
+private:
+	JsonApiStreamingAnswer(
+	        const std::weak_ptr<rb::Service>& service,
+	        const std::shared_ptr<rb::Session>& session,
+	        const std::multimap<std::string, std::string>& headers ) :
+	    mService(service), mSession(session), mHeaders(headers),
+	    mHeadersSent(false), mWritePending(false) {}
+
+	/// Members already in the answer, like caller_data
+	static void copyMembers(RsJsonStreamWriter& w, const RsJson& jAns)
+	{
+		for(auto it = jAns.MemberBegin(); it != jAns.MemberEnd(); ++it)
+			w.copyMember(it->name, it->value);
+	}
+
+	bool writeChunk(const char* data, size_t size)
+	{
+		std::ostringstream chunk;
+		chunk << std::hex << size << "\r\n";
+		chunk.write(data, static_cast<std::streamsize>(size));
+		chunk << "\r\n";
+
+		return waitWritten() && yield(chunk.str());
+	}
+
+	/// Queue data on the service thread, at most one write at a time
+	bool yield(const std::string& data)
+	{
+		auto lService = mService.lock();
+		if(!lService || lService->is_down()) return false;
+
+		{
+			std::unique_lock<std::mutex> lock(mMtx);
+			mWritePending = true;
+		}
+
+		auto self(shared_from_this());
+		lService->schedule([self, data]()
+		{
+			if(self->mSession->is_closed())
+			{
+				self->written();
+				return;
+			}
+
+			auto done = [self](const std::shared_ptr<rb::Session>)
+			{ self->written(); };
+
+			if(self->mHeadersSent) self->mSession->yield(data, done);
+			else
+			{
+				self->mHeadersSent = true;
+				self->mSession->yield(rb::OK, data, self->mHeaders, done);
+			}
+		});
+
+		return true;
+	}
+
+	void written()
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+		mWritePending = false;
+		mCond.notify_all();
+	}
+
+	bool waitWritten()
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+
+		if(!mCond.wait_for( lock, JSONAPI_CHUNK_WRITE_TIMEOUT,
+		                    [this]() { return !mWritePending; } ))
+		{
+			RsWarn() << __PRETTY_FUNCTION__ << " caller didn't read the answer "
+			         << "for " << JSONAPI_CHUNK_WRITE_TIMEOUT.count()
+			         << "s, giving up" << std::endl;
+			return false;
+		}
+
+		return !mSession->is_closed();
+	}
+
+	void close()
+	{
+		auto lService = mService.lock();
+		if(!waitWritten() || !lService || lService->is_down()) return;
+
+		auto self(shared_from_this());
+		lService->schedule([self]()
+		{
+			if(!self->mSession->is_closed())
+				self->mSession->close(std::string("0\r\n\r\n"));
+		});
+	}
+
+	/// Part of the answer is already sent, closing is all that can be done
+	void abort()
+	{
+		auto lService = mService.lock();
+		if(!lService || lService->is_down()) return;
+
+		auto self(shared_from_this());
+		lService->schedule([self]()
+		{ if(!self->mSession->is_closed()) self->mSession->close(); });
+	}
+
+	const std::weak_ptr<rb::Service> mService;
+	const std::shared_ptr<rb::Session> mSession;
+	const std::multimap<std::string, std::string> mHeaders;
+	bool mHeadersSent;	/// service thread only
+
+	std::mutex mMtx;
+	std::condition_variable mCond;
+	bool mWritePending;
+};
+
 
 /*static*/ bool JsonApiServer::checkRsServicePtrReady(
         const void* serviceInstance, const std::string& serviceName,
@@ -129,6 +337,54 @@ JsonApiServer::corsOptionsHeaders =
 	return false;
 }
 
+#ifdef RS_JSONAPI_TRAFFIC_METRICS
+/**
+ * Write traffic counters in Prometheus text exposition format, as one
+ * histogram of item sizes per direction, service, sub-type and priority.
+ * _count and _sum of each histogram are the number of items and bytes.
+ */
+static void trafficStatisticsToPrometheus(
+        const RsTrafficStatistics& stats, std::ostream& out )
+{
+	const char name[] = "retroshare_traffic_item_size_bytes";
+
+	out << "# HELP " << name << " Size of the items sent and received, "
+	    << "per service, sub-type and priority" << std::endl;
+	out << "# TYPE " << name << " histogram" << std::endl;
+
+	for(int dir = 0; dir < 2; ++dir)
+		for(const RsTrafficCounter& c : dir ? stats.in : stats.out)
+		{
+			std::ostringstream labels;
+			labels << "direction=\"" << (dir ? "in" : "out") << "\","
+			       << "service=\"0x" << std::hex << std::setfill('0')
+			       << std::setw(4) << c.service_id << "\","
+			       << "sub_type=\"0x" << std::setw(2)
+			       << static_cast<uint32_t>(c.service_sub_id) << "\","
+			       << std::dec << "priority=\""
+			       << static_cast<uint32_t>(c.priority) << "\"";
+
+			uint64_t cumulated = 0;
+			for(size_t i = 0; i < stats.size_bounds.size() &&
+			    i < c.size_histogram.size(); ++i)
+			{
+				// Prometheus bounds are included, ours are not
+				cumulated += c.size_histogram[i];
+				out << name << "_bucket{" << labels.str() << ",le=\""
+				    << stats.size_bounds[i] - 1 << "\"} " << cumulated
+				    << std::endl;
+			}
+
+			out << name << "_bucket{" << labels.str() << ",le=\"+Inf\"} "
+			    << c.count << std::endl;
+			out << name << "_sum{" << labels.str() << "} " << c.bytes
+			    << std::endl;
+			out << name << "_count{" << labels.str() << "} " << c.count
+			    << std::endl;
+		}
+}
+#endif // def RS_JSONAPI_TRAFFIC_METRICS
+
 void JsonApiServer::unProtectedRestart()
 {
 	/* Extremely sensitive stuff!
@@ -479,6 +735,36 @@ JsonApiServer::JsonApiServer(): configMutex("JsonApiServer config"),
 		} );
 	}, true);
 
+#ifdef RS_JSONAPI_TRAFFIC_METRICS
+	/* Plain text answer, to be scraped by Prometheus or compatible monitoring
+	 * systems, which can authenticate with HTTP basic authentication too */
+	registerHandler("/rsConfig/trafficMetrics",
+	                [](const std::shared_ptr<rb::Session> session)
+	{
+		auto reqSize = session->get_request()->get_header("Content-Length", 0);
+		session->fetch( static_cast<size_t>(reqSize), [](
+		                const std::shared_ptr<rb::Session> session,
+		                const rb::Bytes& /*body*/ )
+		{
+			RsGenericSerializer::SerializeContext cAns;
+			if(!checkRsServicePtrReady(rsConfig, "rsConfig", cAns, session))
+				return;
+
+			RsTrafficStatistics stats;
+			rsConfig->getTrafficStatistics(stats);
+
+			std::ostringstream ss;
+			trafficStatisticsToPrometheus(stats, ss);
+			const std::string ans(ss.str());
+
+			auto headers = corsHeaders;
+			headers.insert({ "Content-Type", "text/plain; version=0.0.4" });
+			headers.insert({ "Content-Length", std::to_string(ans.length()) });
+			session->close(rb::OK, ans, headers);
+		} );
+	}, true);
+#endif // def RS_JSONAPI_TRAFFIC_METRICS
+
 // Generated at compile time
 #include "jsonapi-wrappers.inl"
 }
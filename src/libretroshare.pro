@@ -50,6 +50,7 @@ file_lists {
 			file_sharing/directory_updater.h \
 			file_sharing/rsfilelistitems.h \
 			file_sharing/dir_hierarchy.h \
+			file_sharing/search_cache.h \
 			file_sharing/file_sharing_defaults.h
 
 	SOURCES *= file_sharing/p3filelists.cc \
@@ -59,6 +60,7 @@ file_lists {
 			file_sharing/directory_updater.cc \
 			file_sharing/dir_hierarchy.cc \
 			file_sharing/file_tree.cc \
+			file_sharing/search_cache.cc \
 			file_sharing/rsfilelistitems.cc
 }
 
@@ -88,6 +90,7 @@ SOURCES +=	dht/p3bitdht.cc  \
 
 HEADERS +=	tcponudp/udppeer.h \
 		tcponudp/bio_tou.h \
+		tcponudp/tcpcongestion.h \
 		tcponudp/tcppacket.h \
 		tcponudp/tcpstream.h \
 		tcponudp/tou.h \
@@ -96,6 +99,7 @@ HEADERS +=	tcponudp/udppeer.h \
 		pqi/pqissludp.h \
 
 SOURCES +=	tcponudp/udppeer.cc \
+		tcponudp/tcpcongestion.cc \
 		tcponudp/tcppacket.cc \
 		tcponudp/tcpstream.cc \
 		tcponudp/tou.cc \
@@ -374,6 +378,7 @@ HEADERS +=	ft/ftchunkmap.h \
 			ft/ftdatamultiplex.h \
 			ft/ftextralist.h \
 			ft/ftfilecreator.h \
+			ft/ftfilemover.h \
 			ft/ftfileprovider.h \
 			ft/ftfilesearch.h \
 			ft/ftsearch.h \
@@ -398,6 +403,7 @@ HEADERS += chat/distantchat.h \
 HEADERS +=	pqi/authssl.h \
 			pqi/authgpg.h \
 			pgp/pgphandler.h \
+			pgp/pgpkeyringstore.h \
 			pgp/pgpkeyutil.h \
 			pqi/pqifdbin.h \
 			pqi/rstcpsocket.h \
@@ -433,6 +439,7 @@ HEADERS +=	pqi/authssl.h \
 			pqi/pqisslproxy.h \
 			pqi/pqistore.h \
 			pqi/pqistreamer.h \
+			pqi/pqitrafficstats.h \
 			pqi/pqithreadstreamer.h \
 			pqi/pqiqosstreamer.h \
 			pqi/sslfns.h \
@@ -519,6 +526,8 @@ HEADERS +=	util/folderiterator.h \
     util/rserrorbubbleorexit.h \
 			util/rskbdinput.h \
 			util/rsmemory.h \
+			util/rsmpscqueue.h \
+			util/rsiptrie.h \
 			util/smallobject.h \
 			util/rsdir.h \
 			util/rsfile.h \
@@ -536,6 +545,8 @@ HEADERS +=	util/folderiterator.h \
 			util/rsstring.h \
 			util/rsstd.h \
 			util/rsthreads.h \
+			util/rsscheduler.h \
+			util/rsstartuptimeline.h \
 			util/rswin.h \
 			util/rsrandom.h \
 			util/rsmemcache.h \
@@ -557,6 +568,7 @@ SOURCES +=	ft/ftchunkmap.cc \
 			ft/ftdatamultiplex.cc \
 			ft/ftextralist.cc \
 			ft/ftfilecreator.cc \
+			ft/ftfilemover.cc \
 			ft/ftfileprovider.cc \
 			ft/ftfilesearch.cc \
 			ft/ftserver.cc \
@@ -577,6 +589,7 @@ SOURCES += chat/distantchat.cc \
 SOURCES +=	pqi/authgpg.cc \
 			pqi/authssl.cc \
 			pgp/pgphandler.cc \
+			pgp/pgpkeyringstore.cc \
 			pgp/pgpkeyutil.cc \
 			pgp/rscertificate.cc \
 			pgp/pgpauxutils.cc \
@@ -604,6 +617,7 @@ SOURCES +=	pqi/authgpg.cc \
 			pqi/pqisslproxy.cc \
 			pqi/pqistore.cc \
 			pqi/pqistreamer.cc \
+			pqi/pqitrafficstats.cc \
 			pqi/pqithreadstreamer.cc \
 			pqi/pqiqosstreamer.cc \
 			pqi/sslfns.cc \
@@ -681,12 +695,15 @@ SOURCES +=	util/folderiterator.cc \
 			util/rsdiscspace.cc \
 			util/rsnet.cc \
 			util/rsnet_ss.cc \
+			util/rsiptrie.cc \
 			util/rsdnsutils.cc \
 			util/extaddrfinder.cc \
 			util/dnsresolver.cc \
 			util/rsprint.cc \
 			util/rsstring.cc \
 			util/rsthreads.cc \
+			util/rsscheduler.cc \
+			util/rsstartuptimeline.cc \
 			util/rsrandom.cc \
 			util/rstickevent.cc \
 			util/rsrecogn.cc \
@@ -807,11 +824,13 @@ SOURCES += gxstunnel/p3gxstunnel.cc \
 HEADERS += serialiser/rsserializable.h \
            serialiser/rsserializer.h \
            serialiser/rstypeserializer.h \
+           serialiser/rsjsonstreamwriter.h \
            util/rsjson.h
 
 SOURCES += serialiser/rsserializable.cc \
            serialiser/rsserializer.cc \
            serialiser/rstypeserializer.cc \
+           serialiser/rsjsonstreamwriter.cc \
            util/rsjson.cc
 
 # Identity Service
@@ -882,6 +901,24 @@ rs_efs {
                    friend_server/fsmanager.cc
 }
 
+# Background hash check of all GXS data, reporting corrupted groups and messages
+
+rs_gxs_integrity_hash_check {
+	DEFINES *= RS_GXS_INTEGRITY_HASH_CHECK
+}
+
+# RsItem memory: mutex protected allocator instead of the thread caching one
+
+rs_locked_small_object_allocator {
+	DEFINES *= RS_LOCKED_SMALL_OBJECT_ALLOCATOR
+}
+
+# Traffic counters in Prometheus text format at /rsConfig/trafficMetrics
+
+rs_jsonapi_traffic_metrics {
+	DEFINES *= RS_JSONAPI_TRAFFIC_METRICS
+}
+
 # The Wire
 
 gxsthewire {
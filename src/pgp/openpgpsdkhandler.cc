@@ -538,6 +538,12 @@ std::string OpenPGPSDKHandler::SaveCertificateToString(const RsPgpId& id,bool in
 }
 
 bool OpenPGPSDKHandler::exportPublicKey( const RsPgpId& id, unsigned char*& mem_block, size_t& mem_size, bool armoured, bool include_signatures ) const
+{
+	RS_STACK_MUTEX(pgphandlerMtx);
+	return locked_exportPublicKey(id,mem_block,mem_size,armoured,include_signatures);
+}
+
+bool OpenPGPSDKHandler::locked_exportPublicKey( const RsPgpId& id, unsigned char*& mem_block, size_t& mem_size, bool armoured, bool include_signatures ) const
 {
 	mem_block = nullptr; mem_size = 0; // clear just in case
 
@@ -550,7 +556,6 @@ bool OpenPGPSDKHandler::exportPublicKey( const RsPgpId& id, unsigned char*& mem_
 		return false;
 	}
 
-	RS_STACK_MUTEX(pgphandlerMtx);
 	const ops_keydata_t* key = locked_getPublicKey(id,false);
 
 	if(!key)
@@ -924,7 +929,7 @@ bool OpenPGPSDKHandler::checkAndImportKeyPair(ops_keyring_t *tmp_keyring, RsPgpI
 			import_error = "Private key already exists! Not importing it again." ;
 
 		if(locked_addOrMergeKey(_pubring,_public_keyring_map,pubkey))
-			_pubring_changed = true ;
+			locked_markKeyChanged(imported_key_id) ;
 	}
 
 	// 6 - clean
@@ -1033,7 +1038,7 @@ bool OpenPGPSDKHandler::LoadCertificate(const unsigned char *data,uint32_t data_
 	while( (keydata = ops_keyring_get_key_by_index(tmp_keyring,i++)) != NULL )
 		if(locked_addOrMergeKey(_pubring,_public_keyring_map,keydata)) 
 		{
-			_pubring_changed = true ;
+			locked_markKeyChanged(RsPgpId(keydata->key_id)) ;
 #ifdef DEBUG_PGPHANDLER
             RsErr() << "  Added the key in the main public keyring." ;
 #endif
@@ -1049,8 +1054,6 @@ bool OpenPGPSDKHandler::LoadCertificate(const unsigned char *data,uint32_t data_
 	ops_keyring_free(tmp_keyring) ;
 	free(tmp_keyring) ;
 
-	_pubring_changed = true ;
-
 	return true ;
 }
 
@@ -1437,7 +1440,7 @@ bool OpenPGPSDKHandler::privateSignCertificate(const RsPgpId& ownId,const RsPgpI
 	ops_secret_key_free(secret_key) ;
 	free(secret_key) ;
 
-	_pubring_changed = true ;
+	locked_markKeyChanged(id_of_key_to_sign) ;
 
 	// 4 - update signatures.
 	//
@@ -1671,6 +1674,8 @@ bool OpenPGPSDKHandler::removeKeysFromPGPKeyring(const std::set<RsPgpId>& keys_t
 			return false ;
 		}
 
+		locked_markKeyRemoved(*it) ;
+
 		// Move the last key to the freed place. This deletes the key in place.
 		//
 		ops_keyring_remove_key(_pubring,res->second._key_index) ;
@@ -92,6 +92,7 @@ public:
 
         bool locked_updateKeyringFromDisk(bool secret, const std::string& keyring_file) override ;
         bool locked_writeKeyringToDisk(bool secret, const std::string& keyring_file) override ;
+        bool locked_exportPublicKey(const RsPgpId& id, unsigned char*& mem_block, size_t& mem_size, bool armoured, bool include_signatures) const override ;
 
         bool locked_addOrMergeKey(ops_keyring_t *keyring,std::map<RsPgpId,PGPCertificateInfo>& kmap,const ops_keydata_t *keydata) ;
 
@@ -46,6 +46,8 @@ static const uint32_t PGP_CERTIFICATE_LIMIT_MAX_NAME_SIZE   = 64 ;
 static const uint32_t PGP_CERTIFICATE_LIMIT_MAX_EMAIL_SIZE  = 64 ;
 static const uint32_t PGP_CERTIFICATE_LIMIT_MAX_PASSWD_SIZE = 1024 ;
 
+static const rstime_t PGP_PUBRING_EXPORT_DELAY = 300 ;	// keys are in the keyring store meanwhile
+
 //#define DEBUG_PGPHANDLER 1
 //#define PGPHANDLER_DSA_SUPPORT
 
@@ -64,9 +66,52 @@ PGPHandler::PGPHandler(const std::string& pubring, const std::string& secring,co
 	_pgp_lock_filename(pgp_lock_filename),
 	_trustdb_changed(false),
 	_pubring_changed(false),
+	_pubring_store(pubring + ".d"),
+	_pubring_store_ok(false),
+	_pubring_store_full_sync(false),
+	_pubring_export_pending(false),
+	_pubring_export_now(false),
+	_pubring_last_export_time(time(NULL)),
     _pubring_last_update_time(time(NULL)),
     _trustdb_last_update_time(0)
 {
+	// This happens before the derived class loads the keyring file.
+
+	_pubring_store_ok = _pubring_store.open() ;
+
+	if(!_pubring_store_ok)
+	{
+		RsErr() << "Cannot open public keyring store. The whole keyring file will be written at each change." ;
+		return ;
+	}
+
+	// Keys appended by another instance are recorded now. What does not parse is a partial key, from an
+	// interrupted append, which would prevent reading the keyring file. The file is written again from the store.
+
+	std::list<RsPgpFingerprint> appended_keys ;
+
+	if(_pubring_store.keyringAppended(pubring) && !_pubring_store.readAppendedKeys(pubring,std::string(),appended_keys))
+	{
+		RsWarn() << "Public keyring file ends with a partial key. Writing it again from the keyring store." ;
+		_pubring_store.exportKeyring(pubring) ;
+	}
+
+	if(_pubring_store.size() == 0)
+		_pubring_store_full_sync = true ;	// first start with the store
+	else if(_pubring_store.exportPending() || _pubring_store.keyringChangedSinceExport(pubring))
+	{
+		// The keyring file lacks the last changes (e.g. after a crash), or has been written by someone else.
+		// The keys of the store are merged with the keyring file at first sync, so that none is lost.
+
+		RsInfo() << "Public keyring file and keyring store differ. Merging them." ;
+
+		_pubring_store_recovery_file = pubring + ".store" ;
+
+		if(!_pubring_store.writeKeyring(_pubring_store_recovery_file))
+			_pubring_store_recovery_file.clear() ;
+
+		_pubring_store_full_sync = true ;
+	}
 }
 
 PGPHandler::~PGPHandler()
@@ -446,6 +491,100 @@ bool PGPHandler::syncDatabase()
     return true ;
 }
 
+bool PGPHandler::flushPublicKeyring()
+{
+    RsStackMutex mtx(pgphandlerMtx) ;				// lock access to PGP memory structures.
+    RsStackFileLock flck(_pgp_lock_filename) ;	// lock access to PGP directory.
+
+    _pubring_export_now = true ;
+
+    return locked_syncPublicKeyring() ;
+}
+
+void PGPHandler::locked_markKeyChanged(const RsPgpId& id)
+{
+    _pubring_changed_keys.insert(id) ;
+    _pubring_changed = true ;
+}
+
+void PGPHandler::locked_markKeyRemoved(const RsPgpId& id)
+{
+    std::map<RsPgpId,PGPCertificateInfo>::const_iterator it = _public_keyring_map.find(id) ;
+
+    if(it != _public_keyring_map.end())
+        _pubring_removed_keys.insert(it->second._fpr) ;
+
+    _pubring_changed_keys.erase(id) ;
+    _pubring_changed = true ;
+
+    // Removed keys would come back when merging an outdated keyring file, so the file is written right away.
+    _pubring_export_now = true ;
+}
+
+bool PGPHandler::locked_syncKeyringStore()
+{
+    // A change that does not say which key changed means that all keys need to be checked.
+
+    if(_pubring_changed_keys.empty() && _pubring_removed_keys.empty())
+        _pubring_store_full_sync = true ;
+
+    if(_pubring_store_full_sync)
+    {
+        std::list<RsPgpFingerprint> stored_keys ;
+        std::set<RsPgpFingerprint> memory_keys ;
+
+        _pubring_store.getFingerprints(stored_keys) ;
+
+        for(std::map<RsPgpId,PGPCertificateInfo>::const_iterator it(_public_keyring_map.begin());it!=_public_keyring_map.end();++it)
+        {
+            _pubring_changed_keys.insert(it->first) ;
+            memory_keys.insert(it->second._fpr) ;
+        }
+
+        for(std::list<RsPgpFingerprint>::const_iterator it(stored_keys.begin());it!=stored_keys.end();++it)
+            if(memory_keys.find(*it) == memory_keys.end())
+                _pubring_removed_keys.insert(*it) ;
+
+        _pubring_store_full_sync = false ;
+    }
+
+#ifdef DEBUG_PGPHANDLER
+    RsDbg() << "Syncing keyring store: " << _pubring_changed_keys.size() << " changed keys, " << _pubring_removed_keys.size() << " removed keys." ;
+#endif
+    bool ok = true ;
+
+    for(std::set<RsPgpFingerprint>::const_iterator it(_pubring_removed_keys.begin());it!=_pubring_removed_keys.end();++it)
+        _pubring_store.removeKey(*it) ;
+
+    for(std::set<RsPgpId>::const_iterator it(_pubring_changed_keys.begin());it!=_pubring_changed_keys.end();++it)
+    {
+        std::map<RsPgpId,PGPCertificateInfo>::const_iterator res = _public_keyring_map.find(*it) ;
+
+        if(res == _public_keyring_map.end())
+            continue ;
+
+        unsigned char *mem_block = NULL ;
+        size_t mem_size = 0 ;
+
+        if(!locked_exportPublicKey(*it,mem_block,mem_size,false,true))
+        {
+            // e.g. DSA keys. They stay in the keyring file, which is then written right away.
+            ok = false ;
+            continue ;
+        }
+
+        if(!_pubring_store.putKey(res->second._fpr,mem_block,mem_size))
+            ok = false ;
+
+        free(mem_block) ;
+    }
+
+    _pubring_changed_keys.clear() ;
+    _pubring_removed_keys.clear() ;
+
+    return ok ;
+}
+
 bool PGPHandler::locked_syncPublicKeyring()
 {
     struct stat64 buf ;
@@ -461,42 +600,135 @@ bool PGPHandler::locked_syncPublicKeyring()
         buf.st_mtime = 0;
     }
 
-    if(_pubring_last_update_time < buf.st_mtime)
+    // Keys appended by someone else are read alone. The whole file is only read if it was rewritten.
+
+    bool appended = _pubring_store_ok && _pubring_store.keyringAppended(_pubring_path) ;
+
+    if(appended && locked_mergeAppendedKeys())
+    {
+        if(_pubring_last_update_time < buf.st_mtime)
+            _pubring_last_update_time = buf.st_mtime ;
+    }
+    else if(appended || _pubring_last_update_time < buf.st_mtime)
     {
         RsErr() << "Detected change on disk of public keyring. Merging!" << std::endl ;
 
         locked_updateKeyringFromDisk(false,_pubring_path) ;
         _pubring_last_update_time = buf.st_mtime ;
+
+        // We don't know which keys changed.
+        _pubring_store_full_sync = true ;
+    }
+
+    // Keys of the store that are not in the keyring file.
+
+    if(!_pubring_store_recovery_file.empty())
+    {
+        locked_updateKeyringFromDisk(false,_pubring_store_recovery_file) ;
+        RsDirUtil::removeFile(_pubring_store_recovery_file) ;
+        _pubring_store_recovery_file.clear() ;
+
+        _pubring_export_pending = true ;
     }
 
     // Now check if the pubring was locally modified, which needs saving it again
-    if(_pubring_changed && RsDiscSpace::checkForDiscSpace(RS_PGP_DIRECTORY))
+    if(_pubring_changed || _pubring_store_full_sync)
     {
-        std::string tmp_keyring_file = _pubring_path + ".tmp" ;
+        if(_pubring_changed)
+            _pubring_export_pending = true ;
+
+        if(!_pubring_store_ok || !locked_syncKeyringStore())
+            _pubring_export_now = true ;
 
+        // The store now has the same keys as the keyring file.
+        if(_pubring_store_ok && !_pubring_export_pending)
+            _pubring_store.setExported(_pubring_path) ;
+
+        _pubring_changed = false ;
+    }
+
+    rstime_t now = time(NULL) ;
+
+    // New keys are appended to the keyring file right away. The file is only rewritten, at most every
+    // PGP_PUBRING_EXPORT_DELAY, when keys in it were replaced or removed, or when some keys are not in the store.
+
+    bool export_from_store = _pubring_store_ok && _pubring_store.size() == _public_keyring_map.size() ;
+    bool rewrite = !export_from_store || _pubring_store.rewritePending() || _pubring_store.keyringChangedSinceExport(_pubring_path) ;
+
+    if(_pubring_export_pending && (!rewrite || _pubring_export_now || now >= _pubring_last_export_time + PGP_PUBRING_EXPORT_DELAY)
+            && RsDiscSpace::checkForDiscSpace(RS_PGP_DIRECTORY))
+    {
 #ifdef DEBUG_PGPHANDLER
-        RsErr() << "Local changes in public keyring. Writing to disk..." ;
+        RsErr() << "Local changes in public keyring. Writing to disk (rewrite=" << rewrite << ")..." ;
 #endif
-        if(!locked_writeKeyringToDisk(false,tmp_keyring_file.c_str()))
+        if(export_from_store)
         {
-            RsErr() << "Cannot write public keyring tmp file. Disk full? Disk quota exceeded?" ;
-            return false ;
+            if(!_pubring_store.updateKeyring(_pubring_path))
+            {
+                RsErr() << "Cannot write public keyring file " << _pubring_path << ". Disk full? Disk quota exceeded?" ;
+                return false ;
+            }
         }
-        if(!RsDirUtil::renameFile(tmp_keyring_file,_pubring_path))
+        else
         {
-            RsErr() << "Cannot rename tmp pubring file " << tmp_keyring_file << " into actual pubring file " << _pubring_path << ". Check writing permissions?!?" ;
-            return false ;
+            std::string tmp_keyring_file = _pubring_path + ".tmp" ;
+
+            if(!locked_writeKeyringToDisk(false,tmp_keyring_file.c_str()))
+            {
+                RsErr() << "Cannot write public keyring tmp file. Disk full? Disk quota exceeded?" ;
+                return false ;
+            }
+            if(!RsDirUtil::renameFile(tmp_keyring_file,_pubring_path))
+            {
+                RsErr() << "Cannot rename tmp pubring file " << tmp_keyring_file << " into actual pubring file " << _pubring_path << ". Check writing permissions?!?" ;
+                return false ;
+            }
+
+            if(_pubring_store_ok)
+                _pubring_store.setExported(_pubring_path) ;
         }
 
 #ifdef DEBUG_PGPHANDLER
         RsErr() << "Done." ;
 #endif
         _pubring_last_update_time = time(NULL) ;	// should we get this value from the disk instead??
-        _pubring_changed = false ;
+        _pubring_export_pending = false ;
+        _pubring_export_now = false ;
+
+        if(rewrite)
+            _pubring_last_export_time = now ;
     }
     return true ;
 }
 
+bool PGPHandler::locked_mergeAppendedKeys()
+{
+    std::list<RsPgpFingerprint> fprs ;
+    std::string tail_file = _pubring_path + ".tail" ;
+
+    if(!_pubring_store.readAppendedKeys(_pubring_path,tail_file,fprs))
+    {
+        RsWarn() << "Cannot read the keys appended to the public keyring file. Reading the whole file." ;
+        return false ;
+    }
+
+    bool ok = locked_updateKeyringFromDisk(false,tail_file) ;
+    RsDirUtil::removeFile(tail_file) ;
+
+#ifdef DEBUG_PGPHANDLER
+    RsDbg() << "Merged " << fprs.size() << " keys appended to the public keyring file." ;
+#endif
+
+    // Merged keys may differ from the appended ones, e.g. with more signatures. The store only writes keys
+    // that actually changed.
+
+    for(std::list<RsPgpFingerprint>::const_iterator it(fprs.begin());it!=fprs.end();++it)
+        if(_public_keyring_map.find(pgpIdFromFingerprint(*it)) != _public_keyring_map.end())
+            locked_markKeyChanged(pgpIdFromFingerprint(*it)) ;
+
+    return ok ;
+}
+
 bool PGPHandler::extract_name_and_comment(const char *uid,std::string& name,std::string& comment,std::string& email)
 {
     if(!uid)
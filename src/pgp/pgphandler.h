@@ -28,6 +28,7 @@
 #include <set>
 #include <util/rsthreads.h>
 #include <retroshare/rstypes.h>
+#include <pgp/pgpkeyringstore.h>
 
 typedef std::string (*PassphraseCallback)(void *data, const char *uid_title, const char *uid_hint, const char *passphrase_info, int prev_was_bad,bool *cancelled) ;
 
@@ -151,6 +152,11 @@ public:
         //
         virtual bool syncDatabase();
 
+        // Writes pending keyring changes to disk right away, including the public keyring file, which is otherwise
+        // written at most every few minutes. To be called before quitting.
+        //
+        bool flushPublicKeyring();
+
         virtual bool LoadCertificateFromString(const std::string& pem, RsPgpId& gpg_id, std::string& error_string);
         virtual bool LoadCertificateFromBinaryData(const unsigned char *bin_data,uint32_t bin_data_len, RsPgpId& gpg_id, std::string& error_string);
         bool availableGPGCertificatesWithPrivateKeys(std::list<RsPgpId>& ids);
@@ -203,6 +209,15 @@ public:
     protected:
         virtual bool locked_updateKeyringFromDisk(bool secret,const std::string& path) =0;
         virtual bool locked_writeKeyringToDisk(bool secret,const std::string& path) =0;
+        virtual bool locked_exportPublicKey(const RsPgpId& id, unsigned char*& mem_block, size_t& mem_size, bool armoured, bool include_signatures) const =0;
+
+        // To be called when a public key is added/modified, or before it gets removed, so that only this key is
+        // written in the keyring store.
+        //
+        void locked_markKeyChanged(const RsPgpId& id) ;
+        void locked_markKeyRemoved(const RsPgpId& id) ;
+        bool locked_syncKeyringStore() ;
+        bool locked_mergeAppendedKeys() ;
 
         void locked_updateOwnSignatureFlag(PGPCertificateInfo&, const RsPgpId&, PGPCertificateInfo&, const RsPgpId&) ;
 
@@ -228,6 +243,18 @@ public:
 		bool _pubring_changed ;
 		mutable bool _trustdb_changed ;
 
+		// Public keys are saved one by one in the keyring store. The keyring file is only exported from time to time.
+
+		PGPKeyringStore _pubring_store ;
+		bool _pubring_store_ok ;
+		bool _pubring_store_full_sync ;                     // store must be checked against all the keys in memory
+		std::string _pubring_store_recovery_file ;          // store keys that did not make it to the keyring file
+		std::set<RsPgpId> _pubring_changed_keys ;
+		std::set<RsPgpFingerprint> _pubring_removed_keys ;
+		bool _pubring_export_pending ;
+		bool _pubring_export_now ;
+		rstime_t _pubring_last_export_time ;
+
 		rstime_t _pubring_last_update_time ;
 		rstime_t _secring_last_update_time ;
 		rstime_t _trustdb_last_update_time ;
@@ -0,0 +1,635 @@
+/*******************************************************************************
+ * libretroshare/src/pgp: pgpkeyringstore.cc                                   *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#include <inttypes.h>
+#include <string.h>
+#include <stdexcept>
+#include <sys/stat.h>
+
+#include "pgp/pgpkeyringstore.h"
+#include "pgp/pgpkeyutil.h"
+#include "crypto/hashstream.h"
+#include "util/rsdebug.h"
+#include "util/rsdir.h"
+#include "util/largefile_retrocompat.hpp"
+
+#ifdef WINDOWS_SYS
+#include "util/rsstring.h"
+#include "util/rswin.h"
+#endif
+
+//#define DEBUG_KEYRING_STORE 1
+
+/* Index journal, one operation per line:
+ *   K <fingerprint> <size>           key record added or replaced
+ *   F <fingerprint> <size>           same, for a key read from the keyring file
+ *   R <fingerprint>                  key record removed
+ *   X <mtime> <size> <inode>         all keys exported, stats of the keyring file
+ *   A <mtime> <size> <inode>         appended keys read, stats of the keyring file
+ *   W                                keyring file needs to be rewritten
+ * Replacing or removing a key that is in the keyring file means that the file
+ * needs to be rewritten. It is rewritten when it gets much longer than the
+ * number of keys.
+ */
+
+static const std::string INDEX_FILE_NAME = "index" ;
+static const std::string RECORD_EXTENSION = ".key" ;
+static const uint32_t INDEX_COMPACTION_MIN_LINES = 128 ;
+
+PGPKeyringStore::PGPKeyringStore(const std::string& directory)
+    : mDirectory(directory), mIndexPath(directory + "/" + INDEX_FILE_NAME),
+      mIndexFile(NULL), mIndexLines(0),
+      mExportPending(false), mRewritePending(false),
+      mExportedMtime(0), mExportedSize(0), mExportedInode(0)
+{
+}
+
+PGPKeyringStore::~PGPKeyringStore()
+{
+	if(mIndexFile)
+		fclose(mIndexFile);
+}
+
+bool PGPKeyringStore::open()
+{
+	if(!RsDirUtil::checkCreateDirectory(mDirectory))
+	{
+		RsErr() << "PGPKeyringStore: cannot create directory " << mDirectory << std::endl;
+		return false;
+	}
+
+	mKeys.clear();
+	mIndexLines = 0;
+	mExportPending = false;
+	mRewritePending = false;
+
+	FILE *f = RsDirUtil::rs_fopen(mIndexPath.c_str(), "r");
+
+	if(f)
+	{
+		char line[256];
+
+		while(fgets(line, sizeof(line), f))
+		{
+			char fpr_string[128];
+			uint32_t size;
+			int64_t mtime;
+			uint64_t file_size;
+			uint64_t inode = 0;
+
+			++mIndexLines;
+
+			// Lines that do not parse (e.g. the last one, if truncated by a crash) are ignored.
+
+			if(sscanf(line, "K %127s %u", fpr_string, &size) == 2 || sscanf(line, "F %127s %u", fpr_string, &size) == 2)
+			{
+				RsPgpFingerprint fpr(fpr_string);
+
+				if(!fpr.isNull())
+					setRecord(fpr, size, line[0] == 'F');
+			}
+			else if(sscanf(line, "R %127s", fpr_string) == 1)
+			{
+				std::map<RsPgpFingerprint, Record>::iterator it = mKeys.find(RsPgpFingerprint(fpr_string));
+
+				if(it != mKeys.end())
+				{
+					mRewritePending = mRewritePending || it->second.inKeyring;
+					mKeys.erase(it);
+				}
+				mExportPending = true;
+			}
+			else if(sscanf(line, "X %" SCNd64 " %" SCNu64 " %" SCNu64, &mtime, &file_size, &inode) >= 2)
+			{
+				mExportedMtime = mtime;
+				mExportedSize = file_size;
+				mExportedInode = inode;	// 0 with the lines written before inodes were recorded
+				mExportPending = false;
+				mRewritePending = false;
+
+				for(std::map<RsPgpFingerprint, Record>::iterator it(mKeys.begin()); it != mKeys.end(); ++it)
+					it->second.inKeyring = true;
+			}
+			else if(sscanf(line, "A %" SCNd64 " %" SCNu64 " %" SCNu64, &mtime, &file_size, &inode) == 3)
+			{
+				mExportedMtime = mtime;
+				mExportedSize = file_size;
+				mExportedInode = inode;
+			}
+			else if(line[0] == 'W')
+				mRewritePending = true;
+		}
+		fclose(f);
+	}
+
+#ifdef DEBUG_KEYRING_STORE
+	RsDbg() << "PGPKeyringStore: " << mKeys.size() << " keys in " << mDirectory << ", " << mIndexLines << " index lines, export pending: " << mExportPending << ", rewrite pending: " << mRewritePending << std::endl;
+#endif
+
+	if(mIndexLines > INDEX_COMPACTION_MIN_LINES && mIndexLines > 2 * mKeys.size())
+		return compactIndex();
+
+	mIndexFile = RsDirUtil::rs_fopen(mIndexPath.c_str(), "a");
+
+	if(!mIndexFile)
+	{
+		RsErr() << "PGPKeyringStore: cannot open index file " << mIndexPath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+std::string PGPKeyringStore::recordPath(const RsPgpFingerprint& fpr) const
+{
+	return mDirectory + "/" + fpr.toStdString() + RECORD_EXTENSION;
+}
+
+void PGPKeyringStore::setRecord(const RsPgpFingerprint& fpr, uint32_t size, bool in_keyring)
+{
+	// The previous version of the key stays in the keyring file until it is rewritten.
+
+	std::map<RsPgpFingerprint, Record>::const_iterator it = mKeys.find(fpr);
+
+	if(it != mKeys.end() && it->second.inKeyring)
+		mRewritePending = true;
+
+	Record& rec(mKeys[fpr]);
+	rec.size = size;
+	rec.inKeyring = in_keyring;
+
+	if(!in_keyring)
+		mExportPending = true;
+}
+
+bool PGPKeyringStore::appendToIndex(const std::string& line)
+{
+	if(!mIndexFile)
+		return false;
+
+	if(fputs(line.c_str(), mIndexFile) < 0 || fflush(mIndexFile) != 0)
+	{
+		RsErr() << "PGPKeyringStore: cannot write index file " << mIndexPath << ". Disk full?" << std::endl;
+		return false;
+	}
+
+	if(++mIndexLines > INDEX_COMPACTION_MIN_LINES && mIndexLines > 2 * mKeys.size())
+		return compactIndex();
+
+	return true;
+}
+
+bool PGPKeyringStore::compactIndex()
+{
+	if(mIndexFile)
+	{
+		fclose(mIndexFile);
+		mIndexFile = NULL;
+	}
+
+	std::string tmp_path = mIndexPath + ".tmp";
+	FILE *f = RsDirUtil::rs_fopen(tmp_path.c_str(), "w");
+
+	if(!f)
+	{
+		RsErr() << "PGPKeyringStore: cannot write index file " << tmp_path << std::endl;
+		return false;
+	}
+
+	uint32_t lines = 0;
+	bool ok = true;
+
+	// Keys in the keyring file, then the export line, then the other keys.
+
+	for(std::map<RsPgpFingerprint, Record>::const_iterator it(mKeys.begin()); it != mKeys.end(); ++it)
+		if(it->second.inKeyring)
+		{
+			ok = ok && fprintf(f, "K %s %u\n", it->first.toStdString().c_str(), it->second.size) > 0;
+			++lines;
+		}
+
+	ok = ok && fprintf(f, "X %" PRId64 " %" PRIu64 " %" PRIu64 "\n", mExportedMtime, mExportedSize, mExportedInode) > 0;
+	++lines;
+
+	for(std::map<RsPgpFingerprint, Record>::const_iterator it(mKeys.begin()); it != mKeys.end(); ++it)
+		if(!it->second.inKeyring)
+		{
+			ok = ok && fprintf(f, "K %s %u\n", it->first.toStdString().c_str(), it->second.size) > 0;
+			++lines;
+		}
+
+	if(mRewritePending)
+	{
+		ok = ok && fputs("W\n", f) >= 0;
+		++lines;
+	}
+
+	ok = (fclose(f) == 0) && ok;
+
+	if(!ok || !RsDirUtil::renameFile(tmp_path, mIndexPath))
+	{
+		RsErr() << "PGPKeyringStore: cannot rewrite index file " << mIndexPath << ". Disk full?" << std::endl;
+		return false;
+	}
+
+	mIndexLines = lines;
+	mIndexFile = RsDirUtil::rs_fopen(mIndexPath.c_str(), "a");
+
+	return mIndexFile != NULL;
+}
+
+bool PGPKeyringStore::putKey(const RsPgpFingerprint& fpr, const unsigned char *data, size_t size)
+{
+	// Keys are put again after each merge, most of the time unchanged.
+
+	std::map<RsPgpFingerprint, Record>::const_iterator it = mKeys.find(fpr);
+	std::vector<unsigned char> old_data;
+
+	if(it != mKeys.end() && it->second.size == size && getKey(fpr, old_data) && memcmp(old_data.data(), data, size) == 0)
+		return true;
+
+	if(!writeRecord(fpr, data, size))
+		return false;
+
+	setRecord(fpr, size, false);
+
+	return appendToIndex("K " + fpr.toStdString() + " " + std::to_string(size) + "\n");
+}
+
+bool PGPKeyringStore::writeRecord(const RsPgpFingerprint& fpr, const unsigned char *data, size_t size)
+{
+	// Write the record first, so that the index never points to a partial record.
+
+	std::string path = recordPath(fpr);
+	std::string tmp_path = path + ".tmp";
+
+	FILE *f = RsDirUtil::rs_fopen(tmp_path.c_str(), "wb");
+
+	if(!f)
+	{
+		RsErr() << "PGPKeyringStore: cannot write key record " << tmp_path << std::endl;
+		return false;
+	}
+
+	bool ok = (fwrite(data, 1, size, f) == size);
+	ok = (fclose(f) == 0) && ok;
+
+	if(!ok || !RsDirUtil::renameFile(tmp_path, path))
+	{
+		RsErr() << "PGPKeyringStore: cannot write key record " << path << ". Disk full?" << std::endl;
+		RsDirUtil::removeFile(tmp_path);
+		return false;
+	}
+	return true;
+}
+
+bool PGPKeyringStore::removeKey(const RsPgpFingerprint& fpr)
+{
+	std::map<RsPgpFingerprint, Record>::iterator it = mKeys.find(fpr);
+
+	if(it == mKeys.end())
+		return false;
+
+	mRewritePending = mRewritePending || it->second.inKeyring;
+	mKeys.erase(it);
+	mExportPending = true;
+
+	// Index first: a record that is not in the index is just ignored.
+
+	bool ok = appendToIndex("R " + fpr.toStdString() + "\n");
+	RsDirUtil::removeFile(recordPath(fpr));
+
+	return ok;
+}
+
+bool PGPKeyringStore::hasKey(const RsPgpFingerprint& fpr) const
+{
+	return mKeys.find(fpr) != mKeys.end();
+}
+
+bool PGPKeyringStore::getKey(const RsPgpFingerprint& fpr, std::vector<unsigned char>& data) const
+{
+	std::map<RsPgpFingerprint, Record>::const_iterator it = mKeys.find(fpr);
+
+	if(it == mKeys.end())
+		return false;
+
+	FILE *f = RsDirUtil::rs_fopen(recordPath(fpr).c_str(), "rb");
+
+	if(!f)
+	{
+		RsErr() << "PGPKeyringStore: missing key record for " << fpr << std::endl;
+		return false;
+	}
+
+	data.resize(it->second.size);
+	bool ok = (fread(data.data(), 1, data.size(), f) == data.size());
+	fclose(f);
+
+	if(!ok)
+		RsErr() << "PGPKeyringStore: key record for " << fpr << " is truncated" << std::endl;
+
+	return ok;
+}
+
+void PGPKeyringStore::getFingerprints(std::list<RsPgpFingerprint>& fprs) const
+{
+	for(std::map<RsPgpFingerprint, Record>::const_iterator it(mKeys.begin()); it != mKeys.end(); ++it)
+		fprs.push_back(it->first);
+}
+
+bool PGPKeyringStore::writeKeyring(const std::string& keyring_file) const
+{
+	// A binary keyring is just a sequence of transferable public keys.
+
+	std::string tmp_file = keyring_file + ".tmp";
+	FILE *f = RsDirUtil::rs_fopen(tmp_file.c_str(), "wb");
+
+	if(!f)
+	{
+		RsErr() << "PGPKeyringStore: cannot write keyring file " << tmp_file << std::endl;
+		return false;
+	}
+
+	bool ok = true;
+	std::vector<unsigned char> data;
+
+	for(std::map<RsPgpFingerprint, Record>::const_iterator it(mKeys.begin()); ok && it != mKeys.end(); ++it)
+		ok = getKey(it->first, data) && fwrite(data.data(), 1, data.size(), f) == data.size();
+
+	ok = (fclose(f) == 0) && ok;
+
+	if(!ok || !RsDirUtil::renameFile(tmp_file, keyring_file))
+	{
+		RsErr() << "PGPKeyringStore: cannot export keyring to " << keyring_file << ". Disk full?" << std::endl;
+		RsDirUtil::removeFile(tmp_file);
+		return false;
+	}
+	return true;
+}
+
+bool PGPKeyringStore::exportKeyring(const std::string& keyring_file)
+{
+	return writeKeyring(keyring_file) && setExported(keyring_file);
+}
+
+bool PGPKeyringStore::updateKeyring(const std::string& keyring_file)
+{
+	if(mRewritePending || keyringChangedSinceExport(keyring_file))
+		return exportKeyring(keyring_file);
+
+	std::list<RsPgpFingerprint> new_keys;
+
+	for(std::map<RsPgpFingerprint, Record>::const_iterator it(mKeys.begin()); it != mKeys.end(); ++it)
+		if(!it->second.inKeyring)
+			new_keys.push_back(it->first);
+
+	if(new_keys.empty())
+		return !mExportPending || setExported(keyring_file);
+
+#ifdef DEBUG_KEYRING_STORE
+	RsDbg() << "PGPKeyringStore: appending " << new_keys.size() << " keys to " << keyring_file << std::endl;
+#endif
+
+	// An interrupted append leaves a partial key at the end of the file. It is
+	// found by readAppendedKeys() on next start, and the file is rewritten.
+
+	FILE *f = RsDirUtil::rs_fopen(keyring_file.c_str(), "ab");
+	bool ok = (f != NULL);
+	std::vector<unsigned char> data;
+
+	for(std::list<RsPgpFingerprint>::const_iterator it(new_keys.begin()); ok && it != new_keys.end(); ++it)
+		ok = getKey(*it, data) && fwrite(data.data(), 1, data.size(), f) == data.size();
+
+	if(f)
+		ok = (fclose(f) == 0) && ok;
+
+	if(!ok)
+	{
+		RsWarn() << "PGPKeyringStore: cannot append keys to " << keyring_file << ". Rewriting it." << std::endl;
+		return exportKeyring(keyring_file);
+	}
+	return setExported(keyring_file);
+}
+
+bool PGPKeyringStore::setExported(const std::string& keyring_file)
+{
+	int64_t mtime;
+	uint64_t size;
+	uint64_t inode;
+
+	if(!statFile(keyring_file, mtime, size, inode))
+		return false;
+
+	mExportedMtime = mtime;
+	mExportedSize = size;
+	mExportedInode = inode;
+	mExportPending = false;
+	mRewritePending = false;
+
+	for(std::map<RsPgpFingerprint, Record>::iterator it(mKeys.begin()); it != mKeys.end(); ++it)
+		it->second.inKeyring = true;
+
+	return appendToIndex("X " + std::to_string(mtime) + " " + std::to_string(size) + " " + std::to_string(inode) + "\n");
+}
+
+bool PGPKeyringStore::keyringChangedSinceExport(const std::string& keyring_file) const
+{
+	int64_t mtime;
+	uint64_t size;
+	uint64_t inode;
+
+	if(!statFile(keyring_file, mtime, size, inode))
+		return mExportedSize != 0;
+
+	return mtime != mExportedMtime || size != mExportedSize;
+}
+
+bool PGPKeyringStore::keyringAppended(const std::string& keyring_file) const
+{
+	// Keyring files are written to a temporary file which is then renamed,
+	// so a file that is still the same one and got larger had keys appended.
+
+	int64_t mtime;
+	uint64_t size;
+	uint64_t inode;
+
+	if(!statFile(keyring_file, mtime, size, inode))
+		return false;
+
+	return inode != 0 && inode == mExportedInode && size > mExportedSize;
+}
+
+bool PGPKeyringStore::readAppendedKeys(const std::string& keyring_file, const std::string& tail_file, std::list<RsPgpFingerprint>& fprs)
+{
+	int64_t mtime;
+	uint64_t size;
+	uint64_t inode;
+
+	if(!statFile(keyring_file, mtime, size, inode) || inode == 0 || inode != mExportedInode || size <= mExportedSize)
+		return false;
+
+	uint64_t tail_size = size - mExportedSize;
+
+	if(tail_size > 0x7fffffff)
+		return false;
+
+	// Zero padding, so that a packet header cut by the end of the data can be read.
+
+	std::vector<unsigned char> tail(tail_size + 8, 0);
+
+	FILE *f = RsDirUtil::rs_fopen(keyring_file.c_str(), "rb");
+
+	if(!f)
+		return false;
+
+	bool ok = fseeko64(f, mExportedSize, SEEK_SET) == 0 && fread(tail.data(), 1, tail_size, f) == tail_size;
+	fclose(f);
+
+	if(!ok)
+		return false;
+
+	// The appended data must be a sequence of whole transferable public keys,
+	// each one starting with a v4 public key packet.
+
+	struct AppendedKey
+	{
+		RsPgpFingerprint fpr;
+		uint64_t offset;
+		uint32_t size;
+	};
+	std::list<AppendedKey> keys;
+
+	try
+	{
+		unsigned char *data = tail.data();
+		unsigned char *end = data + tail_size;
+
+		while(data < end)
+		{
+			unsigned char *packet = data;
+			uint8_t packet_tag;
+			uint32_t packet_length;
+
+			PGPKeyParser::read_packetHeader(data, packet_tag, packet_length);
+
+			if(data > end || packet_length > (uint64_t)(end - data))
+				return false;
+
+			if(packet_tag == PGPKeyParser::PGP_PACKET_TAG_PUBLIC_KEY)
+			{
+				if(packet_length < 1 || packet_length > 0xffff || data[0] != 4)
+					return false;
+
+				librs::crypto::HashStream H(librs::crypto::HashStream::SHA1);
+
+				H << (uint8_t)0x99;	// RFC_4880
+				H << (uint8_t)(packet_length >> 8);
+				H << (uint8_t)(packet_length);
+				H << std::make_pair(data, packet_length);
+
+				AppendedKey key;
+				key.fpr = RsPgpFingerprint::fromBufferUnsafe(H.hash().toByteArray());
+				key.offset = packet - tail.data();
+				key.size = 0;
+				keys.push_back(key);
+			}
+			else if(keys.empty())
+				return false;
+
+			data += packet_length;
+			keys.back().size = data - tail.data() - keys.back().offset;
+		}
+	}
+	catch(std::runtime_error&)
+	{
+		return false;
+	}
+
+	if(!tail_file.empty())
+	{
+		FILE *tf = RsDirUtil::rs_fopen(tail_file.c_str(), "wb");
+
+		ok = (tf != NULL) && fwrite(tail.data(), 1, tail_size, tf) == tail_size;
+
+		if(tf)
+			ok = (fclose(tf) == 0) && ok;
+
+		if(!ok)
+		{
+			RsErr() << "PGPKeyringStore: cannot write " << tail_file << ". Disk full?" << std::endl;
+			return false;
+		}
+	}
+
+#ifdef DEBUG_KEYRING_STORE
+	RsDbg() << "PGPKeyringStore: " << keys.size() << " keys appended to " << keyring_file << std::endl;
+#endif
+
+	for(std::list<AppendedKey>::const_iterator it(keys.begin()); it != keys.end(); ++it)
+	{
+		// Keys written by ourselves before a crash, or appended twice, are already known.
+
+		std::map<RsPgpFingerprint, Record>::const_iterator rit = mKeys.find(it->fpr);
+		std::vector<unsigned char> old_data;
+
+		fprs.push_back(it->fpr);
+
+		if(rit != mKeys.end() && rit->second.size == it->size && getKey(it->fpr, old_data) && memcmp(old_data.data(), tail.data() + it->offset, it->size) == 0)
+		{
+			if(rit->second.inKeyring)
+				continue;
+		}
+		else if(!writeRecord(it->fpr, tail.data() + it->offset, it->size))
+			return false;
+
+		setRecord(it->fpr, it->size, true);
+
+		if(!appendToIndex("F " + it->fpr.toStdString() + " " + std::to_string(it->size) + "\n"))
+			return false;
+	}
+
+	mExportedMtime = mtime;
+	mExportedSize = size;
+
+	return appendToIndex("A " + std::to_string(mtime) + " " + std::to_string(size) + " " + std::to_string(inode) + "\n");
+}
+
+bool PGPKeyringStore::statFile(const std::string& path, int64_t& mtime, uint64_t& size, uint64_t& inode)
+{
+	struct stat64 buf;
+#ifdef WINDOWS_SYS
+	std::wstring wfullname;
+	librs::util::ConvertUtf8ToUtf16(path, wfullname);
+	if(-1 == _wstati64(wfullname.c_str(), &buf))
+#else
+	if(-1 == stat64(path.c_str(), &buf))
+#endif
+		return false;
+
+	mtime = buf.st_mtime;
+	size = buf.st_size;
+#ifdef WINDOWS_SYS
+	inode = 0;	// not filled, appends are not detected
+#else
+	inode = buf.st_ino;
+#endif
+	return true;
+}
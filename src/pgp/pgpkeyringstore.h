@@ -0,0 +1,141 @@
+/*******************************************************************************
+ * libretroshare/src/pgp: pgpkeyringstore.h                                    *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <retroshare/rsids.h>
+
+/**
+ * @brief Public keyring stored as one record file per key.
+ * Each record holds the binary transferable public key, named after the key
+ * fingerprint. An append-only index journal in the same directory lists the
+ * records, so that adding, updating or removing a key only writes that key,
+ * and opening the store only reads the index. Records are read on demand.
+ *
+ * The standard keyring file (concatenation of all the keys) is exported on
+ * request. The index also tells which records are in the keyring file, so that
+ * new keys are just appended to it, and keys appended by someone else are read
+ * without reading the whole file. The file is only rewritten from the records
+ * when keys in it were replaced or removed, or when it was rewritten by
+ * someone else.
+ *
+ * Not thread safe, the caller is expected to lock.
+ */
+class PGPKeyringStore
+{
+public:
+	explicit PGPKeyringStore(const std::string& directory);
+	~PGPKeyringStore();
+
+	/// Create the directory if needed and read the index.
+	bool open();
+
+	/// Add or replace a key. Nothing is written if the record did not change.
+	bool putKey(const RsPgpFingerprint& fpr, const unsigned char *data, size_t size);
+
+	bool removeKey(const RsPgpFingerprint& fpr);
+
+	bool hasKey(const RsPgpFingerprint& fpr) const;
+
+	/// Read the key record from disk.
+	bool getKey(const RsPgpFingerprint& fpr, std::vector<unsigned char>& data) const;
+
+	void getFingerprints(std::list<RsPgpFingerprint>& fprs) const;
+
+	size_t size() const { return mKeys.size(); }
+
+	/**
+	 * @brief Write all the keys to a standard binary keyring file.
+	 * The file is written to a temporary file which is then renamed.
+	 */
+	bool writeKeyring(const std::string& keyring_file) const;
+
+	/// writeKeyring() and record the export.
+	bool exportKeyring(const std::string& keyring_file);
+
+	/**
+	 * @brief Bring the keyring file up to date with the records.
+	 * Keys added since the last export are appended to the file. It is
+	 * rewritten with exportKeyring() instead if keys in it were replaced or
+	 * removed, or if it is not the file written by the last export.
+	 */
+	bool updateKeyring(const std::string& keyring_file);
+
+	/// Record that the keyring file, written by someone else, holds all the keys.
+	bool setExported(const std::string& keyring_file);
+
+	/// true if keys changed since the last export
+	bool exportPending() const { return mExportPending; }
+
+	/// true if keys in the keyring file were replaced or removed since the last export
+	bool rewritePending() const { return mRewritePending; }
+
+	/// true if the keyring file is not the one written by the last export
+	bool keyringChangedSinceExport(const std::string& keyring_file) const;
+
+	/// true if data was appended to the keyring file written by the last export
+	bool keyringAppended(const std::string& keyring_file) const;
+
+	/**
+	 * @brief Store the keys appended to the keyring file since the last export.
+	 * They are recorded as being in the keyring file, and copied to tail_file
+	 * unless it is empty, so that they can be merged without reading the whole
+	 * keyring.
+	 * @return false if the appended data is not a sequence of whole keys, e.g.
+	 * after an interrupted write.
+	 */
+	bool readAppendedKeys(const std::string& keyring_file, const std::string& tail_file, std::list<RsPgpFingerprint>& fprs);
+
+private:
+	struct Record
+	{
+		uint32_t size;
+		bool inKeyring;	/// this version of the key is in the keyring file
+	};
+
+	std::string recordPath(const RsPgpFingerprint& fpr) const;
+	bool writeRecord(const RsPgpFingerprint& fpr, const unsigned char *data, size_t size);
+	void setRecord(const RsPgpFingerprint& fpr, uint32_t size, bool in_keyring);
+	bool appendToIndex(const std::string& line);
+	bool compactIndex();
+
+	static bool statFile(const std::string& path, int64_t& mtime, uint64_t& size, uint64_t& inode);
+
+	const std::string mDirectory;
+	const std::string mIndexPath;
+
+	std::map<RsPgpFingerprint, Record> mKeys;
+	FILE *mIndexFile;
+	uint32_t mIndexLines;
+
+	bool mExportPending;
+	bool mRewritePending;
+	int64_t mExportedMtime;
+	uint64_t mExportedSize;
+	uint64_t mExportedInode;	/// 0 if unknown, so that appends cannot be detected
+};
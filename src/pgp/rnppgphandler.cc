@@ -764,7 +764,11 @@ std::string RNPPGPHandler::SaveCertificateToString(const RsPgpId& /* id */,bool
 bool RNPPGPHandler::exportPublicKey( const RsPgpId& id, unsigned char*& mem_block, size_t& mem_size, bool armoured, bool include_signatures ) const
 {
     RS_STACK_MUTEX(pgphandlerMtx);
+    return locked_exportPublicKey(id,mem_block,mem_size,armoured,include_signatures);
+}
 
+bool RNPPGPHandler::locked_exportPublicKey( const RsPgpId& id, unsigned char*& mem_block, size_t& mem_size, bool armoured, bool include_signatures ) const
+{
     mem_block = nullptr; mem_size = 0; // clear just in case
 
     RNP_OUTPUT_STRUCT(output);
@@ -1214,7 +1218,7 @@ bool RNPPGPHandler::LoadCertificate(const unsigned char *data,uint32_t data_len,
 
     initCertificateInfo(key_handle) ;
 
-    _pubring_changed = true;
+    locked_markKeyChanged(id);
     return true;
 }
 
@@ -1565,7 +1569,7 @@ bool RNPPGPHandler::privateSignCertificate(const RsPgpId& ownId,const RsPgpId& i
             throw std::runtime_error("Creating signature failed.");
 
         initCertificateInfo(signed_key);	// update signatures
-        _pubring_changed = true;
+        locked_markKeyChanged(id_of_key_to_sign);
         _public_keyring_map[id_of_key_to_sign]._flags |= PGPCertificateInfo::PGP_CERTIFICATE_FLAG_HAS_OWN_SIGNATURE ;
         return true;
     }
@@ -1873,6 +1877,7 @@ bool RNPPGPHandler::removeKeysFromPGPKeyring(const std::set<RsPgpId>& keys_to_re
 
 		// Erase the info from the keyring map.
 		//
+		locked_markKeyRemoved(*it) ;
 		_public_keyring_map.erase(res) ;
 	}
 
@@ -80,6 +80,7 @@ public:
 
         bool locked_writeKeyringToDisk(bool secret, const std::string& keyring_file) override;
         bool locked_updateKeyringFromDisk(bool secret, const std::string& keyring_file) override;
+        bool locked_exportPublicKey(const RsPgpId& id, unsigned char*& mem_block, size_t& mem_size, bool armoured, bool include_signatures) const override;
 
         bool importKeyPairData(rnp_input_t input);
         bool encryptData(const RsPgpId& key_id, bool armored, rnp_input_t input, rnp_output_t output);
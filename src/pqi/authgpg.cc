@@ -135,6 +135,10 @@ void AuthPGP::exit()
 	if(_instance)
 	{
 		_instance->fullstop();
+
+		// the public keyring file is only written from time to time
+		_instance->mPgpHandler->flushPublicKeyring();
+
 		delete _instance;
 		_instance = nullptr;
 	}
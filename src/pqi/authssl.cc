@@ -70,6 +70,9 @@ const uint32_t RS_SSL_HANDSHAKE_DIAGNOSTIC_WRONG_SIGNATURE_VERSION     = 0x0a ;
  * #define AUTHSSL_DEBUG 1
  ***/
 
+/// Bound of the verified certificates cache, it is emptied when full
+static const size_t MAX_VERIFIED_CERTS = 4096;
+
 # if OPENSSL_VERSION_NUMBER < 0x10100000L
 static pthread_mutex_t* mutex_buf = nullptr;
 
@@ -302,7 +305,9 @@ std::string RsX509Cert::getCertOrg(const X509& x509)
 
 AuthSSLimpl::AuthSSLimpl() :
     p3Config(), sslctx(nullptr), mOwnCert(nullptr), sslMtx("AuthSSL"),
-    mOwnPrivateKey(nullptr), mOwnPublicKey(nullptr), init(0) {}
+    mOwnPrivateKey(nullptr), mOwnPublicKey(nullptr), init(0),
+    mSessionMtx("AuthSSLSessions"), mFullHandshakes(0), mResumedHandshakes(0),
+    mCertCacheHits(0), mCertCacheMisses(0) {}
 
 AuthSSLimpl::~AuthSSLimpl()
 {
@@ -316,6 +321,8 @@ AuthSSLimpl::~AuthSSLimpl()
 
 	for(auto pcert: mCerts)
 		X509_free(pcert.second);
+
+	clearSessions();
 }
 
 bool AuthSSLimpl::active() { return init; }
@@ -600,6 +607,17 @@ bool AuthSSLimpl::InitAuth(
 			SSL_VERIFY_FAIL_IF_NO_PEER_CERT, 
 				verify_x509_callback);
 
+	/* Session resumption, so that reconnecting to a friend doesn't cost a full
+	 * handshake. Incoming sessions are kept in the OpenSSL cache (or in
+	 * tickets), outgoing ones by newSessionCallback() for each location. */
+	static const unsigned char sessionIdContext[] = "RetroShare";
+	SSL_CTX_set_session_id_context(
+	            sslctx, sessionIdContext, sizeof(sessionIdContext) - 1 );
+	SSL_CTX_set_session_cache_mode(
+	            sslctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_SERVER );
+	SSL_CTX_sess_set_new_cb(sslctx, newSessionCallback);
+	SSL_CTX_set_app_data(sslctx, this);
+
 	mOwnCert = x509;
 
 	RsInfo mInfo;
@@ -650,6 +668,7 @@ bool	AuthSSLimpl::CloseAuth()
 	std::cerr << "AuthSSLimpl::CloseAuth()";
 	std::cerr << std::endl;
 #endif
+	clearSessions();
 	SSL_CTX_free(sslctx);
 
 	// clean up private key....
@@ -668,6 +687,144 @@ SSL_CTX *AuthSSLimpl::getCTX()
 	return sslctx;
 }
 
+/*static*/ int AuthSSLimpl::newSessionCallback(SSL* ssl, SSL_SESSION* session)
+{
+	// incoming sessions are handled by OpenSSL
+	if(SSL_is_server(ssl)) return 0;
+
+	AuthSSLimpl* self = static_cast<AuthSSLimpl*>(
+	            SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)) );
+	if(!self) return 0;
+
+	X509* x509 = SSL_get_peer_certificate(ssl);
+	if(!x509) return 0;
+
+	RsPeerId sslId = RsX509Cert::getCertSslId(*x509);
+	X509_free(x509);
+
+	if(sslId.isNull()) return 0;
+
+	RsStackMutex stack(self->mSessionMtx); /******* LOCKED ******/
+
+	SSL_SESSION*& stored = self->mSessions[sslId];
+	if(stored) SSL_SESSION_free(stored);
+	stored = session;
+
+	return 1;	// we keep the reference
+}
+
+void AuthSSLimpl::prepareSession(SSL* ssl, const RsPeerId& sslId)
+{
+	SSL_SESSION* session = nullptr;
+	{
+		RS_STACK_MUTEX(mSessionMtx);
+
+		// TLS 1.3 tickets must not be used twice, the next one will be stored
+		// by newSessionCallback() when the handshake succeeds.
+		auto it = mSessions.find(sslId);
+		if(it == mSessions.end()) return;
+
+		session = it->second;
+		mSessions.erase(it);
+	}
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+	if(SSL_SESSION_is_resumable(session))
+#endif
+		SSL_set_session(ssl, session);
+
+	SSL_SESSION_free(session);
+}
+
+bool AuthSSLimpl::handshakeCompleted(SSL* ssl)
+{
+	if(!SSL_session_reused(ssl))
+	{
+		++mFullHandshakes;
+		return true;
+	}
+
+	++mResumedHandshakes;
+
+	X509* x509 = SSL_get_peer_certificate(ssl);
+	if(!x509)
+	{
+		RsErr() << __PRETTY_FUNCTION__ << " resumed session without peer "
+		        << "certificate" << std::endl;
+		return false;
+	}
+
+	RsPeerId sslId = RsX509Cert::getCertSslId(*x509);
+	bool accepted = isAcceptedCert(x509);
+
+	if(accepted)
+		LocalStoreCert(x509);
+	else
+	{
+		RsInfo() << __PRETTY_FUNCTION__ << " resumed session with " << sslId
+		         << " refused, peer is not accepted anymore." << std::endl;
+		forgetSession(sslId);
+	}
+
+	X509_free(x509);
+	return accepted;
+}
+
+bool AuthSSLimpl::isAcceptedCert(X509* x509)
+{
+	RsPeerId sslId = RsX509Cert::getCertSslId(*x509);
+	std::string sslCn = RsX509Cert::getCertIssuerString(*x509);
+	RsPgpId pgpId(sslCn);
+
+	if(sslCn.length() == RsPgpFingerprint::SIZE_IN_BYTES*2)
+	{
+		RsPgpFingerprint pgpFpr(sslCn);
+		if(!pgpFpr.isNull())
+			pgpId = PGPHandler::pgpIdFromFingerprint(pgpFpr);
+	}
+
+	if(sslId.isNull() || pgpId.isNull()) return false;
+
+	RsPeerDetails det;
+	if(rsPeers->getPeerDetails(sslId, det) && det.skip_pgp_signature_validation)
+		return det.gpg_id == pgpId;
+
+	uint32_t auth_diagnostic;
+	if(!AuthX509WithGPG(x509, false, auth_diagnostic)) return false;
+
+	return pgpId == AuthPGP::getPgpOwnId() || AuthPGP::isPGPAccepted(pgpId);
+}
+
+void AuthSSLimpl::forgetSession(const RsPeerId& sslId)
+{
+	RS_STACK_MUTEX(mSessionMtx);
+
+	auto it = mSessions.find(sslId);
+	if(it == mSessions.end()) return;
+
+	SSL_SESSION_free(it->second);
+	mSessions.erase(it);
+}
+
+void AuthSSLimpl::clearSessions()
+{
+	RS_STACK_MUTEX(mSessionMtx);
+
+	for(auto& it: mSessions) SSL_SESSION_free(it.second);
+	mSessions.clear();
+	mVerifiedCerts.clear();
+}
+
+AuthSSL::HandshakeStatistics AuthSSLimpl::getHandshakeStatistics()
+{
+	HandshakeStatistics stats;
+	stats.fullHandshakes = mFullHandshakes;
+	stats.resumedHandshakes = mResumedHandshakes;
+	stats.certCacheHits = mCertCacheHits;
+	stats.certCacheMisses = mCertCacheMisses;
+	return stats;
+}
+
 const RsPeerId& AuthSSLimpl::OwnId()
 {
 #ifdef AUTHSSL_DEBUG
@@ -1099,6 +1256,31 @@ bool AuthSSLimpl::AuthX509WithGPG(X509 *x509,bool verbose, uint32_t& diagnostic)
 		Dbg3() << __PRETTY_FUNCTION__ << " issuer: " << issuer << " found"
 		       << std::endl;
 
+	/* The PGP signature of a certificate doesn't change, so once checked it
+	 * only needs to be checked again if the issuer key is not the same. */
+	unsigned char certDigest[EVP_MAX_MD_SIZE];
+	unsigned int certDigestLen = 0;
+	bool certHashed = X509_digest(
+	            x509, EVP_sha256(), certDigest, &certDigestLen ) == 1
+	        && certDigestLen == Sha256CheckSum::SIZE_IN_BYTES;
+	Sha256CheckSum certHash;
+	if(certHashed) certHash = Sha256CheckSum::fromBufferUnsafe(certDigest);
+
+	if(certHashed)
+	{
+		RS_STACK_MUTEX(mSessionMtx);
+
+		auto it = mVerifiedCerts.find(certHash);
+		if(it != mVerifiedCerts.end() && it->second == pd.fpr)
+		{
+			++mCertCacheHits;
+			diagnostic = RS_SSL_HANDSHAKE_DIAGNOSTIC_OK;
+			return true;
+		}
+	}
+
+	++mCertCacheMisses;
+
 	/* verify GPG signature */
 	/*** NOW The Manual signing bit (HACKED FROM asn1/a_sign.c) ***/
 
@@ -1252,6 +1434,14 @@ bool AuthSSLimpl::AuthX509WithGPG(X509 *x509,bool verbose, uint32_t& diagnostic)
 
 	OPENSSL_free(buf_in);
 
+	if(certHashed)
+	{
+		RS_STACK_MUTEX(mSessionMtx);
+
+		if(mVerifiedCerts.size() >= MAX_VERIFIED_CERTS) mVerifiedCerts.clear();
+		mVerifiedCerts[certHash] = pd.fpr;
+	}
+
 	diagnostic = RS_SSL_HANDSHAKE_DIAGNOSTIC_OK;
 
 	return true;
@@ -1760,6 +1950,8 @@ bool AuthSSLimpl::RemoveX509(RsPeerId id)
 {
 	std::map<RsPeerId, X509*>::iterator it;
 	
+	forgetSession(id);
+
 	RsStackMutex stack(sslMtx); /******* LOCKED ******/
 
 	if (mCerts.end() != (it = mCerts.find(id)))
@@ -25,7 +25,9 @@
 
 #include <openssl/evp.h>
 #include <openssl/x509.h>
+#include <openssl/ssl.h>
 
+#include <atomic>
 #include <string>
 #include <map>
 
@@ -144,6 +146,36 @@ public:
 	/// SSL specific functions used in pqissl/pqissllistener
 	virtual SSL_CTX* getCTX() = 0;
 
+	struct HandshakeStatistics
+	{
+		uint64_t fullHandshakes;
+		uint64_t resumedHandshakes;
+		uint64_t certCacheHits;    /// PGP signature check skipped
+		uint64_t certCacheMisses;
+	};
+
+	/**
+	 * @brief Offer the last TLS session negotiated with the given location,
+	 * if any, before an outgoing handshake. Each session is offered once.
+	 * @param ssl connection not started yet
+	 * @param sslId location we are connecting to
+	 */
+	virtual void prepareSession(SSL* ssl, const RsPeerId& sslId) = 0;
+
+	/**
+	 * @brief To be called once the handshake succeeded, both ways.
+	 * VerifyX509Callback is not called when a session is resumed, so the peer
+	 * certificate of resumed sessions is checked again against the current
+	 * friend list here.
+	 * @return false if the connection must be dropped
+	 */
+	virtual bool handshakeCompleted(SSL* ssl) = 0;
+
+	/// Forget the TLS session kept for this location
+	virtual void forgetSession(const RsPeerId& sslId) = 0;
+
+	virtual HandshakeStatistics getHandshakeStatistics() = 0;
+
 	/**
 	 * This function parse X509 certificate from the file and return some
 	 * verified informations, like ID and signer
@@ -232,7 +264,24 @@ public:
 	/* SSL specific functions used in pqissl/pqissllistener */
 	SSL_CTX* getCTX() override;
 
+	/// @see AuthSSL
+	void prepareSession(SSL* ssl, const RsPeerId& sslId) override;
+
+	/// @see AuthSSL
+	bool handshakeCompleted(SSL* ssl) override;
+
+	/// @see AuthSSL
+	void forgetSession(const RsPeerId& sslId) override;
+
+	/// @see AuthSSL
+	HandshakeStatistics getHandshakeStatistics() override;
+
 private:
+	static int newSessionCallback(SSL* ssl, SSL_SESSION* session);
+	void clearSessions();
+
+	/// Checks done by VerifyX509Callback, for resumed sessions
+	bool isAcceptedCert(X509* x509);
 
 	bool LocalStoreCert(X509* x509);
 	bool RemoveX509(const RsPeerId id);
@@ -265,4 +314,19 @@ private:
 	RsPgpId _last_gpgid_to_connect;
 	std::string _last_sslcn_to_connect;
 	RsPeerId _last_sslid_to_connect;
+
+	/* Not protected by sslMtx, as AuthX509WithGPG() is also called with sslMtx
+	 * locked. */
+	RsMutex mSessionMtx;  /* protects all below */
+
+	/// last client session negotiated with each location
+	std::map<RsPeerId, SSL_SESSION*> mSessions;
+
+	/// certificates whose PGP signature was already checked -> signer
+	std::map<Sha256CheckSum, RsPgpFingerprint> mVerifiedCerts;
+
+	std::atomic<uint64_t> mFullHandshakes;
+	std::atomic<uint64_t> mResumedHandshakes;
+	std::atomic<uint64_t> mCertCacheHits;
+	std::atomic<uint64_t> mCertCacheMisses;
 };
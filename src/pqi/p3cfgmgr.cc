@@ -29,6 +29,12 @@
 #include <rsserver/p3face.h>
 #include <util/rsdiscspace.h>
 #include "util/rsstring.h"
+#include "util/rsstartuptimeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include "rsitems/rsconfigitems.h"
 
@@ -98,20 +104,59 @@ void p3ConfigMgr::loadConfiguration()
 
 void p3ConfigMgr::loadConfig()
 {
-	std::list<pqiConfig *>::iterator cit;
+	std::vector<pqiConfig *> configs;
+	{
+		RsStackMutex stack(cfgMtx); /***** LOCK STACK MUTEX ****/
+		configs.assign(mConfigs.begin(), mConfigs.end());
+	}
+
+	/* (1) read the files of all p3Configs concurrently. Decrypting and
+	 * checking the signatures is most of the loading time. */
+	std::vector<std::list<RsItem *> > loads(configs.size());
+	std::vector<char> readOk(configs.size(), false);
+	std::atomic<size_t> next(0);
+
+	auto reader = [&]()
+	{
+		for(size_t i = next++; i < configs.size(); i = next++)
+		{
+			p3Config *cfg = dynamic_cast<p3Config *>(configs[i]);
+			if(!cfg) continue;
+
+			RsStartupTimeline::Step step("config_read", RsDirUtil::getFileName(cfg->Filename()));
+			readOk[i] = cfg->readConfig(loads[i]);
+		}
+	};
+
+	size_t nThreads = std::min<size_t>(configs.size(), std::max(2u, std::min(8u, std::thread::hardware_concurrency())));
+	std::vector<std::thread> threads;
+	for(size_t i = 1; i < nThreads; ++i)
+		threads.push_back(std::thread(reader));
+	reader();
+	for(auto& t: threads)
+		t.join();
+
+	/* (2) give them to their owners, in order */
 	RsFileHash dummyHash ;
-	for (cit = mConfigs.begin(); cit != mConfigs.end(); ++cit)
+	for(size_t i = 0; i < configs.size(); ++i)
 	{
 #ifdef CONFIG_DEBUG
 		std::cerr << "p3ConfigMgr::loadConfig() Element: ";
-		std::cerr << *cit <<" Dummy Hash: " << dummyHash;
+		std::cerr << configs[i] <<" Dummy Hash: " << dummyHash;
 		std::cerr << std::endl;
 #endif
+		{
+			RsStartupTimeline::Step step("config_load", RsDirUtil::getFileName(configs[i]->Filename()));
 
-		(*cit)->loadConfiguration(dummyHash);
+			p3Config *cfg = dynamic_cast<p3Config *>(configs[i]);
+			if(!cfg)
+				configs[i]->loadConfiguration(dummyHash);
+			else if(readOk[i])
+				cfg->loadList(loads[i]);
+		}
 
 		/* force config to NOT CHANGED */
-        (*cit)->resetChanges();
+		configs[i]->resetChanges();
 	}
 
 	return;
@@ -181,10 +226,21 @@ bool p3Config::loadConfiguration(RsFileHash& /* loadHash */)
 }
 
 bool p3Config::loadConfig()
+{
+	std::list<RsItem *> load;
+
+	if(!readConfig(load))
+		return false;
+
+	loadList(load);
+	return true;
+}
+
+bool p3Config::readConfig(std::list<RsItem *>& load)
 {
 
 #ifdef CONFIG_DEBUG
-		std::cerr << "p3Config::loadConfig() loading Configuration\n File: " << Filename() << std::endl;
+		std::cerr << "p3Config::readConfig() loading Configuration\n File: " << Filename() << std::endl;
 #endif
 
 	bool pass = true;
@@ -194,7 +250,6 @@ bool p3Config::loadConfig()
 	std::string signFname = Filename() +".sgn";
 	std::string signFnameBackup = signFname + ".tmp";
 
-	std::list<RsItem *> load;
 	std::list<RsItem *>::iterator it;
 
 	// try 1st attempt
@@ -238,11 +293,6 @@ bool p3Config::loadConfig()
 
 
 
-	if(pass)
-		loadList(load);
-	else
-		return false;
-
 	return pass;
 }
 
@@ -195,7 +195,9 @@ class p3ConfigMgr: public RsConfigMgr
         void saveConfig(CheckPriority t);
 
 		/**
-		 *
+		 * Config files are read concurrently, then given to their owner in
+		 * the registration order, as loading a config may depend on the
+		 * ones loaded before it.
 		 */
 		void loadConfig();
 
@@ -257,8 +259,17 @@ private:
 	bool loadConfig();
 	bool saveConfig();
 
+	/**
+	 * Read, decrypt and check the signature of the config file (or of its
+	 * backup), without calling loadList(), so that it can be done for
+	 * several configs concurrently.
+	 */
+	bool readConfig(std::list<RsItem *>& load);
+
 	bool loadAttempt( const std::string&, const std::string&,
 	                  std::list<RsItem *>& load );
+
+	friend class p3ConfigMgr;
 }; // end of p3Config
 
 
@@ -1034,6 +1034,9 @@ int 	pqissl::Initiate_SSL_Connection()
         
 	ssl_connection = ssl;
 
+	// try to resume the last session with this peer
+	AuthSSL::instance().prepareSession(ssl, PeerId());
+
 	net_internal_SSL_set_fd(ssl, sockfd);
 	if (err < 1)
 	{
@@ -1230,6 +1233,12 @@ int pqissl::Authorise_SSL_Connection()
 	}
 #endif // def RS_PQISSL_AUTH_REDUNDANT_CHECK
 
+	if(!AuthSSL::instance().handshakeCompleted(ssl_connection))
+	{
+		reset_locked();
+		return failure;
+	}
+
 	Dbg2() << __PRETTY_FUNCTION__ << " Accepting connection to peer: "
 	       << PeerId() << " with address: " << remote_addr << std::endl;
 
@@ -776,6 +776,9 @@ int pqissllistener::completeConnection(int fd, IncomingSSLInfo& info)
 	constexpr int failure = -1;
 	constexpr int success = 1;
 
+	// resumed sessions skipped VerifyX509Callback
+	if(!AuthSSL::instance().handshakeCompleted(info.ssl)) return failure;
+
 	// Get the Peer Certificate....
 	X509* peercert = SSL_get_peer_certificate(info.ssl);
 	if(!peercert)
@@ -101,7 +101,8 @@ pqistreamer::pqistreamer(RsSerialiser *rss, const RsPeerId& id, BinInterface *bi
 	mTotalRead(0), mTotalSent(0),
 	mCurrRead(0), mCurrSent(0),
 	mAvgReadCount(0), mAvgSentCount(0),
-	mAvgDtOut(0), mAvgDtIn(0)
+	mAvgDtOut(0), mAvgDtIn(0),
+	mInCounters(false), mOutCounters(true)
 {
 
 	// 100 B/s (minimal)
@@ -411,7 +412,7 @@ int	pqistreamer::queue_outpqi_locked(RsItem *pqi,uint32_t& pktsize)
     	// keep info for stats for a while. Only keep the items for the last two seconds. sec n is ongoing and second n-1
     	// is a full statistics chunk that can be used in the GUI
 
-    	locked_addTrafficClue(pqi,pktsize,mCurrentStatsChunk_Out) ;
+    	addTrafficClue(pqi,pktsize,mOutCounters) ;
 
         /*******************************************************************************************/
 
@@ -460,41 +461,60 @@ int 	pqistreamer::handleincomingitem(RsItem *pqi,int len)
 	//	mIncomingSize_bytes += len;
 
 	/*******************************************************************************************/
-	// keep info for stats for a while. Only keep the items for the last two seconds. sec n is ongoing and second n-1
-	// is a full statistics chunk that can be used in the GUI
-	{
-		RsStackMutex stack(mStreamerMtx); /**** LOCKED MUTEX ****/
-		locked_addTrafficClue(pqi,len,mCurrentStatsChunk_In) ;
-	}
+	// count the item for stats. Counters do not need the mutex.
+
+	addTrafficClue(pqi,len,mInCounters) ;
+
 	/*******************************************************************************************/
 
 	return 1;
 }
 
-void pqistreamer::locked_addTrafficClue(const RsItem *pqi,uint32_t pktsize,std::list<RSTrafficClue>& lst)
+void pqistreamer::addTrafficClue(const RsItem *pqi,uint32_t pktsize,pqiTrafficCounters& counters)
 {
-    rstime_t now = time(NULL) ;
+    counters.add(pqi->PacketService(),pqi->PacketSubType(),pqi->priority_level(),pktsize) ;
+}
+
+// Turns what was counted since the previous snapshot into one clue per item type, with per second rates.
 
-    if(now > mStatisticsTimeStamp)	// new chunk => get rid of oldest, replace old list by current list, clear current list.
+void pqistreamer::locked_makeTrafficClues(const std::vector<RsTrafficCounter>& counters,const std::vector<RsTrafficCounter>& previous,rstime_t now,std::list<RSTrafficClue>& lst)
+{
+    lst.clear() ;
+
+    uint64_t dt = now - mStatisticsTimeStamp ;
+    std::vector<RsTrafficCounter>::const_iterator pit(previous.begin()) ;
+
+    for(std::vector<RsTrafficCounter>::const_iterator it(counters.begin());it!=counters.end();++it)
     {
-	    mPreviousStatsChunk_Out = mCurrentStatsChunk_Out ;
-	    mPreviousStatsChunk_In = mCurrentStatsChunk_In ;
-	    mCurrentStatsChunk_Out.clear() ;
-	    mCurrentStatsChunk_In.clear() ;
+	    while(pit != previous.end() && pqiTrafficCounters::lessThan(*pit,*it))
+		    ++pit ;
 
-	    mStatisticsTimeStamp = now ;
-    }
+	    uint64_t count = it->count ;
+	    uint64_t bytes = it->bytes ;
+
+	    if(pit != previous.end() && !pqiTrafficCounters::lessThan(*it,*pit))
+	    {
+		    count -= pit->count ;
+		    bytes -= pit->bytes ;
+	    }
+
+	    count = (count + dt/2) / dt ;
+	    bytes = (bytes + dt/2) / dt ;
 
-    RSTrafficClue tc ;
-    tc.TS = now ;
-    tc.size = pktsize ;
-    tc.priority = pqi->priority_level() ;
-    tc.peer_id = pqi->PeerId() ;
-    tc.count = 1 ;
-    tc.service_id = pqi->PacketService() ;
-    tc.service_sub_id = pqi->PacketSubType() ;
+	    if(count == 0 && bytes == 0)
+		    continue ;
 
-    lst.push_back(tc) ;
+	    RSTrafficClue tc ;
+	    tc.TS = now ;
+	    tc.size = bytes ;
+	    tc.priority = it->priority ;
+	    tc.peer_id = PeerId() ;
+	    tc.count = count ;
+	    tc.service_id = it->service_id ;
+	    tc.service_sub_id = it->service_sub_id ;
+
+	    lst.push_back(tc) ;
+    }
 }
 
 rstime_t	pqistreamer::getLastIncomingTS()
@@ -1496,6 +1516,26 @@ int pqistreamer::locked_compute_out_pkt_size() const
 
 int pqistreamer::locked_gatherStatistics(std::list<RSTrafficClue>& out_lst,std::list<RSTrafficClue>& in_lst)
 {
+    rstime_t now = time(NULL) ;
+
+    if(now > mStatisticsTimeStamp)	// new chunk => rates since the previous one. The first call only takes the snapshot.
+    {
+	    std::vector<RsTrafficCounter> out,in ;
+
+	    mOutCounters.snapshot(out) ;
+	    mInCounters.snapshot(in) ;
+
+	    if(mStatisticsTimeStamp > 0)
+	    {
+		    locked_makeTrafficClues(out,mLastStatsSnapshot_Out,now,mPreviousStatsChunk_Out) ;
+		    locked_makeTrafficClues(in,mLastStatsSnapshot_In,now,mPreviousStatsChunk_In) ;
+	    }
+
+	    mLastStatsSnapshot_Out.swap(out) ;
+	    mLastStatsSnapshot_In.swap(in) ;
+	    mStatisticsTimeStamp = now ;
+    }
+
     out_lst = mPreviousStatsChunk_Out ;
      in_lst = mPreviousStatsChunk_In ;
 
@@ -29,6 +29,7 @@
 #include <map>                    // for map
 
 #include "pqi/pqi_base.h"         // for BinInterface (ptr only), PQInterface
+#include "pqi/pqitrafficstats.h"  // for pqiTrafficCounters
 #include "retroshare/rsconfig.h"  // for RSTrafficClue
 #include "retroshare/rstypes.h"   // for RsPeerId
 #include "util/rsthreads.h"       // for RsMutex
@@ -175,17 +176,21 @@ class pqistreamer: public PQInterface
 
 		rstime_t mLastIncomingTs;
 	
-        	// traffic statistics
+        	// traffic statistics. Counters are updated without locking, and turned into rates when read.
 
+		pqiTrafficCounters mInCounters ;
+		pqiTrafficCounters mOutCounters ;
+
+		std::vector<RsTrafficCounter> mLastStatsSnapshot_In ;
+		std::vector<RsTrafficCounter> mLastStatsSnapshot_Out ;
         	std::list<RSTrafficClue> mPreviousStatsChunk_In ;
         	std::list<RSTrafficClue> mPreviousStatsChunk_Out ;
-        	std::list<RSTrafficClue> mCurrentStatsChunk_In ;
-        	std::list<RSTrafficClue> mCurrentStatsChunk_Out ;
 		rstime_t mStatisticsTimeStamp ;
 
 		bool mAcceptsPacketSlicing ;
 		rstime_t mLastSentPacketSlicingProbe ;
-		void locked_addTrafficClue(const RsItem *pqi, uint32_t pktsize, std::list<RSTrafficClue> &lst);
+		void addTrafficClue(const RsItem *pqi, uint32_t pktsize, pqiTrafficCounters& counters);
+		void locked_makeTrafficClues(const std::vector<RsTrafficCounter>& counters, const std::vector<RsTrafficCounter>& previous, rstime_t now, std::list<RSTrafficClue>& lst);
 		RsItem *addPartialPacket(const void *block, uint32_t len, uint32_t slice_packet_id,bool packet_starting,bool packet_ending,uint32_t& total_len);
         
 		std::map<uint32_t,PartialPacketRecord> mPartialPackets ;
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * libretroshare/src/pqi: pqitrafficstats.cc                                   *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <algorithm>
+#include <set>
+
+#include "pqi/pqitrafficstats.h"
+#include "util/rsthreads.h"
+
+// Keys of used slots have this bit set, so that service 0 can be told from a free slot.
+static const uint64_t SLOT_USED = 1ull << 32 ;
+
+// Smallest size counted in the second histogram bucket. Bucket i>0 holds sizes in [ FIRST_BOUND<<(i-1), FIRST_BOUND<<i [
+static const uint32_t FIRST_BOUND = 64 ;
+
+namespace
+{
+struct TrafficCountersRegistry
+{
+	TrafficCountersRegistry() : mMtx("pqiTrafficCounters") {}
+
+	RsMutex mMtx ;
+	std::set<const pqiTrafficCounters*> mCounters[2] ;	// in, out
+	std::vector<RsTrafficCounter> mRetired[2] ;			// totals of deleted counters
+};
+
+// Never deleted: some streamers may be deleted after static objects at exit.
+
+TrafficCountersRegistry& registry()
+{
+	static TrafficCountersRegistry *r = new TrafficCountersRegistry ;
+	return *r ;
+}
+}
+
+static uint64_t makeKey(uint16_t service_id,uint8_t service_sub_id,uint8_t priority)
+{
+	return SLOT_USED | (uint64_t(service_id) << 16) | (uint64_t(service_sub_id) << 8) | priority ;
+}
+
+// Sorts the counters and sums up the ones of the same type.
+
+static void mergeCounters(std::vector<RsTrafficCounter>& counters)
+{
+	std::sort(counters.begin(),counters.end(),pqiTrafficCounters::lessThan) ;
+
+	std::vector<RsTrafficCounter> res ;
+
+	for(uint32_t i=0;i<counters.size();++i)
+		if(!res.empty() && !pqiTrafficCounters::lessThan(res.back(),counters[i]))
+		{
+			RsTrafficCounter& c(res.back()) ;
+
+			c.count += counters[i].count ;
+			c.bytes += counters[i].bytes ;
+
+			for(uint32_t j=0;j<c.size_histogram.size() && j<counters[i].size_histogram.size();++j)
+				c.size_histogram[j] += counters[i].size_histogram[j] ;
+		}
+		else
+			res.push_back(counters[i]) ;
+
+	counters.swap(res) ;
+}
+
+pqiTrafficCounters::pqiTrafficCounters(bool outgoing)
+    : mOutgoing(outgoing)
+{
+	for(uint32_t i=0;i<=TABLE_SIZE;++i)
+	{
+		Slot& s(i < TABLE_SIZE ? mSlots[i] : mOverflow) ;
+
+		s.key = 0 ;
+		s.count = 0 ;
+		s.bytes = 0 ;
+
+		for(uint32_t j=0;j<HISTOGRAM_BUCKETS;++j)
+			s.histogram[j] = 0 ;
+	}
+
+	TrafficCountersRegistry& r(registry()) ;
+	RsStackMutex stack(r.mMtx) ; /**** LOCKED MUTEX ****/
+
+	r.mCounters[mOutgoing].insert(this) ;
+}
+
+pqiTrafficCounters::~pqiTrafficCounters()
+{
+	std::vector<RsTrafficCounter> counters ;
+	snapshot(counters) ;
+
+	TrafficCountersRegistry& r(registry()) ;
+	RsStackMutex stack(r.mMtx) ; /**** LOCKED MUTEX ****/
+
+	r.mCounters[mOutgoing].erase(this) ;
+
+	if(!counters.empty())
+	{
+		r.mRetired[mOutgoing].insert(r.mRetired[mOutgoing].end(),counters.begin(),counters.end()) ;
+		mergeCounters(r.mRetired[mOutgoing]) ;
+	}
+}
+
+uint32_t pqiTrafficCounters::histogramBucket(uint32_t size)
+{
+	uint32_t bucket = 0 ;
+
+	for(uint32_t bound=FIRST_BOUND; size >= bound && bucket+1 < HISTOGRAM_BUCKETS; bound <<= 1)
+		++bucket ;
+
+	return bucket ;
+}
+
+uint32_t pqiTrafficCounters::histogramBound(uint32_t bucket)
+{
+	return FIRST_BOUND << bucket ;
+}
+
+bool pqiTrafficCounters::lessThan(const RsTrafficCounter& c1,const RsTrafficCounter& c2)
+{
+	return makeKey(c1.service_id,c1.service_sub_id,c1.priority) < makeKey(c2.service_id,c2.service_sub_id,c2.priority) ;
+}
+
+pqiTrafficCounters::Slot& pqiTrafficCounters::findSlot(uint64_t key)
+{
+	uint32_t h = uint32_t((key * 0x9E3779B97F4A7C15ull) >> 32) % TABLE_SIZE ;
+
+	for(uint32_t i=0;i<TABLE_SIZE;++i)
+	{
+		Slot& s(mSlots[(h + i) % TABLE_SIZE]) ;
+		uint64_t k = s.key.load(std::memory_order_relaxed) ;
+
+		if(k == key)
+			return s ;
+
+		// Free slot: take it, unless another thread took it meanwhile, maybe for the same key.
+
+		if(k == 0 && (s.key.compare_exchange_strong(k,key,std::memory_order_relaxed) || k == key))
+			return s ;
+	}
+	return mOverflow ;
+}
+
+void pqiTrafficCounters::add(uint16_t service_id,uint8_t service_sub_id,uint8_t priority,uint32_t size)
+{
+	Slot& s(findSlot(makeKey(service_id,service_sub_id,priority))) ;
+
+	s.count.fetch_add(1,std::memory_order_relaxed) ;
+	s.bytes.fetch_add(size,std::memory_order_relaxed) ;
+	s.histogram[histogramBucket(size)].fetch_add(1,std::memory_order_relaxed) ;
+}
+
+void pqiTrafficCounters::snapshot(std::vector<RsTrafficCounter>& counters) const
+{
+	counters.clear() ;
+
+	for(uint32_t i=0;i<=TABLE_SIZE;++i)
+	{
+		const Slot& s(i < TABLE_SIZE ? mSlots[i] : mOverflow) ;
+		uint64_t key = s.key.load(std::memory_order_relaxed) ;
+		uint64_t count = s.count.load(std::memory_order_relaxed) ;
+
+		// A slot may be seen with its key but no count yet, or the other way round. It will be in the next snapshot.
+
+		if(count == 0 || (i < TABLE_SIZE && key == 0))
+			continue ;
+
+		RsTrafficCounter c ;
+		c.service_id = (key >> 16) & 0xffff ;
+		c.service_sub_id = (key >> 8) & 0xff ;
+		c.priority = key & 0xff ;
+		c.count = count ;
+		c.bytes = s.bytes.load(std::memory_order_relaxed) ;
+		c.size_histogram.resize(HISTOGRAM_BUCKETS) ;
+
+		for(uint32_t j=0;j<HISTOGRAM_BUCKETS;++j)
+			c.size_histogram[j] = s.histogram[j].load(std::memory_order_relaxed) ;
+
+		counters.push_back(c) ;
+	}
+
+	std::sort(counters.begin(),counters.end(),lessThan) ;
+}
+
+void pqiTrafficCounters::getTotals(bool outgoing,std::vector<RsTrafficCounter>& counters)
+{
+	TrafficCountersRegistry& r(registry()) ;
+	RsStackMutex stack(r.mMtx) ; /**** LOCKED MUTEX ****/
+
+	counters = r.mRetired[outgoing] ;
+
+	for(std::set<const pqiTrafficCounters*>::const_iterator it(r.mCounters[outgoing].begin());it!=r.mCounters[outgoing].end();++it)
+	{
+		std::vector<RsTrafficCounter> c ;
+		(*it)->snapshot(c) ;
+
+		counters.insert(counters.end(),c.begin(),c.end()) ;
+	}
+
+	mergeCounters(counters) ;
+}
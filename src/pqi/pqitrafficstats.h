@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * libretroshare/src/pqi: pqitrafficstats.h                                    *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+#include "retroshare/rsconfig.h"  // for RsTrafficCounter
+
+/*!
+ * \brief The pqiTrafficCounters class
+ * 		Counts the items sent or received by a pqistreamer, per service, sub-type and priority: number of items,
+ * 		bytes and a histogram of the item sizes.
+ *
+ * 		add() is called for each item and never locks nor allocates. Each type of item gets a slot of a fixed table
+ * 		the first time it is seen, with a CAS on the slot key, then counters are incremented with relaxed atomics.
+ * 		Types that do not fit in the table are counted together in an overflow slot, reported with all ids at 0.
+ *
+ * 		Readers get the totals since the counters were created with snapshot(). All the existing counters of one
+ * 		direction are summed up by getTotals(), including the ones of streamers that have been deleted in the
+ * 		meantime, so that totals never decrease.
+ */
+class pqiTrafficCounters
+{
+public:
+	static constexpr uint32_t TABLE_SIZE = 64 ;
+	static constexpr uint32_t HISTOGRAM_BUCKETS = 12 ;
+
+	explicit pqiTrafficCounters(bool outgoing) ;
+	~pqiTrafficCounters() ;
+
+	void add(uint16_t service_id,uint8_t service_sub_id,uint8_t priority,uint32_t size) ;
+
+	// Counters of the types seen so far, sorted by service, sub-type and priority.
+
+	void snapshot(std::vector<RsTrafficCounter>& counters) const ;
+
+	// Sums of all counters of one direction since start, sorted as above.
+
+	static void getTotals(bool outgoing,std::vector<RsTrafficCounter>& counters) ;
+
+	// Sizes in bucket i are below histogramBound(i), except in the last bucket.
+
+	static uint32_t histogramBucket(uint32_t size) ;
+	static uint32_t histogramBound(uint32_t bucket) ;
+
+	static bool lessThan(const RsTrafficCounter& c1,const RsTrafficCounter& c2) ;
+
+private:
+	pqiTrafficCounters(const pqiTrafficCounters&) = delete ;
+	pqiTrafficCounters& operator=(const pqiTrafficCounters&) = delete ;
+
+	struct Slot
+	{
+		std::atomic<uint64_t> key ;		// 0 for a free slot
+		std::atomic<uint64_t> count ;
+		std::atomic<uint64_t> bytes ;
+		std::atomic<uint64_t> histogram[HISTOGRAM_BUCKETS] ;
+	};
+
+	Slot& findSlot(uint64_t key) ;
+
+	bool mOutgoing ;
+	Slot mSlots[TABLE_SIZE] ;
+	Slot mOverflow ;
+};
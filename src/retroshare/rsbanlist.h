@@ -138,6 +138,22 @@ public:
 	        const sockaddr_storage& addr, uint32_t checking_flags,
 	        uint32_t& check_result = RS_DEFAULT_STORAGE_PARAM(uint32_t) ) = 0;
 
+	/**
+	 * @brief Check an address against the white list, the black list and the
+	 *	blocklist files, like isAddressAccepted
+	 * @jsonapi{development}
+	 * @param[in] address IPv4 or IPv6 address, e.g. "1.2.3.4" or "2001:db8::1"
+	 * @param[in] checkingFlags any combination of
+	 *	RSBANLIST_CHECKING_FLAGS_BLACKLIST and
+	 *	RSBANLIST_CHECKING_FLAGS_WHITELIST
+	 * @param[out] checkResult result of the check in RSBANLIST_CHECK_RESULT_*
+	 * @return true if address is accepted, false if address is rejected or
+	 *	cannot be parsed
+	 */
+	virtual bool isIpAccepted(
+	        const std::string& address, uint32_t checkingFlags,
+	        uint32_t& checkResult ) = 0;
+
 	virtual void getBannedIps(std::list<BanListPeer>& list) = 0;
 	virtual void getWhiteListedIps(std::list<BanListPeer>& list) = 0;
 
@@ -153,5 +169,35 @@ public:
 	virtual void enableIPsFromDHT(bool b) = 0;
 	virtual bool iPsFromDHTEnabled() = 0;
 
+	/**
+	 * @brief Add a blocklist file. Addresses in the IPv4 and IPv6 ranges it
+	 *	lists are rejected when checking against the black list.
+	 *	Supported formats are one CIDR prefix, address, "first - last" range,
+	 *	P2P (PeerGuardian) or DAT (eMule) entry per line.
+	 *	The file is read again at each start.
+	 * @jsonapi{development}
+	 * @param[in] path path of the file
+	 * @param[out] ranges storage for the number of prefixes read from the file
+	 * @return false if the file cannot be read
+	 */
+	virtual bool addBlocklistFile(
+	        const std::string& path,
+	        uint32_t& ranges = RS_DEFAULT_STORAGE_PARAM(uint32_t) ) = 0;
+
+	/**
+	 * @brief Stop using a blocklist file
+	 * @jsonapi{development}
+	 * @param[in] path path of the file, as given to addBlocklistFile
+	 * @return false if the file was not in use
+	 */
+	virtual bool removeBlocklistFile(const std::string& path) = 0;
+
+	/**
+	 * @brief Get the blocklist files in use
+	 * @jsonapi{development}
+	 * @param[out] paths storage for the paths
+	 */
+	virtual void getBlocklistFiles(std::list<std::string>& paths) = 0;
+
 	virtual ~RsBanList();
 };
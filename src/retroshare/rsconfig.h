@@ -27,6 +27,7 @@
 #include <string>
 #include <list>
 #include <map>
+#include <vector>
 
 /* The New Config Interface Class */
 class RsServerConfig;
@@ -222,6 +223,81 @@ struct RSTrafficClue : RsSerializable
 	}
 };
 
+/*!
+ * Number of items of one type sent or received since start, all peers together.
+ */
+struct RsTrafficCounter : RsSerializable
+{
+	RsTrafficCounter() : service_id(0), service_sub_id(0), priority(0), count(0), bytes(0) {}
+
+	uint16_t service_id ;
+	uint8_t  service_sub_id ;
+	uint8_t  priority ;
+	uint64_t count ;
+	uint64_t bytes ;
+	std::vector<uint64_t> size_histogram ;	// number of items per size class, see RsTrafficStatistics::size_bounds
+
+	// RsSerializable interface
+	void serial_process(RsGenericSerializer::SerializeJob j, RsGenericSerializer::SerializeContext &ctx) {
+		RS_SERIAL_PROCESS(service_id);
+		RS_SERIAL_PROCESS(service_sub_id);
+		RS_SERIAL_PROCESS(priority);
+		RS_SERIAL_PROCESS(count);
+		RS_SERIAL_PROCESS(bytes);
+		RS_SERIAL_PROCESS(size_histogram);
+	}
+};
+
+struct RsTrafficStatistics : RsSerializable
+{
+	// Sizes in class i of size_histogram are below size_bounds[i]. The last class has no bound.
+	std::vector<uint32_t> size_bounds ;
+
+	std::vector<RsTrafficCounter> out ;
+	std::vector<RsTrafficCounter> in ;
+
+	// RsSerializable interface
+	void serial_process(RsGenericSerializer::SerializeJob j, RsGenericSerializer::SerializeContext &ctx) {
+		RS_SERIAL_PROCESS(size_bounds);
+		RS_SERIAL_PROCESS(out);
+		RS_SERIAL_PROCESS(in);
+	}
+};
+
+/*!
+ * State of the thread pool running the periodic jobs of the services.
+ */
+struct RsSchedulerStatistics : RsSerializable
+{
+	RsSchedulerStatistics() : threads(0), jobs(0), runs(0), timerWakeups(0), explicitWakeups(0), steals(0),
+	    busyWorkers(0), queuedJobs(0), longestRunMs(0), stalls(0) {}
+
+	uint32_t threads ;			// workers + timer thread
+	uint32_t jobs ;
+	uint64_t runs ;
+	uint64_t timerWakeups ;		// jobs started because their period elapsed
+	uint64_t explicitWakeups ;
+	uint64_t steals ;			// jobs run by another worker than the one they were queued on
+	uint32_t busyWorkers ;
+	uint32_t queuedJobs ;		// jobs waiting for a free worker
+	uint64_t longestRunMs ;		// time since the oldest running job started
+	uint64_t stalls ;			// times all workers were busy for too long with jobs waiting
+
+	// RsSerializable interface
+	void serial_process(RsGenericSerializer::SerializeJob j, RsGenericSerializer::SerializeContext &ctx) {
+		RS_SERIAL_PROCESS(threads);
+		RS_SERIAL_PROCESS(jobs);
+		RS_SERIAL_PROCESS(runs);
+		RS_SERIAL_PROCESS(timerWakeups);
+		RS_SERIAL_PROCESS(explicitWakeups);
+		RS_SERIAL_PROCESS(steals);
+		RS_SERIAL_PROCESS(busyWorkers);
+		RS_SERIAL_PROCESS(queuedJobs);
+		RS_SERIAL_PROCESS(longestRunMs);
+		RS_SERIAL_PROCESS(stalls);
+	}
+};
+
 struct RsConfigNetStatus : RsSerializable
 {
 	RsConfigNetStatus() : netLocalOk(true)
@@ -348,6 +424,25 @@ public:
 	 */
     virtual int getTrafficInfo(std::list<RSTrafficClue>& out_lst,std::list<RSTrafficClue>& in_lst) = 0 ;
 
+	/**
+	 * @brief getTrafficStatistics returns the number of items and bytes sent
+	 *  and received since start, per service, sub-type and priority, with a
+	 *  histogram of the item sizes
+	 * @jsonapi{development}
+	 * @param[out] stats traffic counters
+	 * @return returns 1 on succes and 0 otherwise
+	 */
+	virtual int getTrafficStatistics(RsTrafficStatistics& stats) = 0 ;
+
+	/**
+	 * @brief getSchedulerStatistics returns the state of the thread pool
+	 *  running the periodic jobs of the services
+	 * @jsonapi{development}
+	 * @param[out] stats scheduler counters
+	 * @return returns 1 on succes and 0 otherwise
+	 */
+	virtual int getSchedulerStatistics(RsSchedulerStatistics& stats) = 0 ;
+
     /* From RsInit */
 
     // NOT IMPLEMENTED YET!
@@ -258,8 +258,11 @@ public:
 	 * @brief Register events handler
 	 * Every time an event is dispatced the registered events handlers will get
 	 * their method handleEvent called with the event passed as paramether.
-	 * @attention Callbacks must not fiddle internally with methods of this
-	 * class otherwise a deadlock will happen.
+	 * Posted events are delivered from a thread pool. A given callback is
+	 * never called concurrently with itself and gets the events in order.
+	 * Callbacks may register and unregister handlers.
+	 * @attention sendEvent() waits for each callback to be done with its
+	 * current event, callbacks calling it from each other may deadlock.
 	 * @jsonapi{development,manualwrapper}
 	 * @param multiCallback     Function that will be called each time an event
 	 *                          is dispatched.
@@ -286,6 +289,22 @@ public:
 	virtual std::error_condition unregisterEventsHandler(
 	        RsEventsHandlerId_t hId ) = 0;
 
+	/**
+	 * @brief Coalesce events of given type that are waiting for delivery.
+	 * Each handler gets posted events through its own bounded queue. When a
+	 * new event of this type is posted while the handler still has an event
+	 * of the same type queued, and isSameSubject(queued, new) returns true,
+	 * the queued event is replaced by the new one. Meant for high rate
+	 * events that carry a whole state, where only the last one matters.
+	 * @param[in] eventType     Type of the events to coalesce
+	 * @param[in] isSameSubject Tells if the second event supersedes the first
+	 *                          one, empty function to stop coalescing.
+	 * @return Success or error details.
+	 */
+	virtual std::error_condition setEventCoalescing(
+	        RsEventType eventType,
+	        std::function<bool(const RsEvent&, const RsEvent&)> isSameSubject ) = 0;
+
 	virtual ~RsEvents();
 };
 
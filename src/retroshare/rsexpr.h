@@ -23,6 +23,7 @@
 
 #include <string>
 #include <list>
+#include <vector>
 #include <stdint.h>
 #include <cctype>
 
@@ -121,6 +122,10 @@ public:
     virtual uint32_t           file_popularity()  const =0;
     virtual std::string        file_parent_path() const =0;
     virtual const RsFileHash&  file_hash()        const =0;
+
+    // Same as file_parent_path(), for entries that keep the path somewhere. Saves a copy per
+    // file when searching. NULL means that file_parent_path() must be used.
+    virtual const std::string *file_parent_path_ptr() const { return NULL; }
 };
 
 class Expression
@@ -403,6 +408,70 @@ public:
         RelExpression<int>::linearize(e) ;
     }
 };
+
+/******************************************************************************************
+Compiled expressions
+
+******************************************************************************************/
+
+/*!
+ * \brief The CompiledExpression class
+ * 		Expression turned into a flat matcher program, to evaluate it on many files. Terms
+ * 		are lowercased once, all terms of a string test are looked for in a single pass over
+ * 		the string (Aho-Corasick automaton), the cheapest side of AND/OR is evaluated first,
+ * 		and nothing is allocated per file. Gives the same results as Expression::eval().
+ * 		eval() is const, so a compiled expression can be used by several threads at once.
+ */
+class CompiledExpression
+{
+public:
+    CompiledExpression() : mRoot(0), mAutomatonStates(0) {}
+
+    // Both return false if the expression is malformed, e.g. a linearized expression received
+    // from a peer. Nothing matches then.
+    bool compile(const LinearizedExpression& e) ;
+    bool compile(const Expression& e) ;
+
+    bool eval(const ExpFileEntry& file) const ;
+
+    // Approximate memory used, in bytes
+    size_t memoryUsage() const ;
+
+private:
+    struct Node
+    {
+        uint8_t  token ;		// LinearizedExpression::token
+        uint8_t  op ;			// LogicalOperator, RelOperator or StringOperator
+        uint32_t cost ;			// rough evaluation cost, to order the operands of AND/OR
+        int      lower ;		// relational tests
+        int      higher ;
+        uint32_t left ;			// compound: operands. String tests: index of the matcher
+        uint32_t right ;
+    };
+
+    struct StringMatcher
+    {
+        uint8_t op ;
+        bool ignoreCase ;
+        uint64_t allTerms ;					// one bit per term
+        std::vector<std::string> terms ;	// lowercased when ignoring case
+        std::vector<uint32_t> delta ;		// automaton transitions, 256 per state. Empty when terms are searched one by one.
+        std::vector<uint64_t> output ;		// terms found when reaching each state
+
+        bool match(const char *str, size_t len) const ;
+    };
+
+    bool compileNode(const LinearizedExpression& e, uint32_t& n_tok, uint32_t& n_ints, uint32_t& n_strings, uint32_t depth, uint32_t& node) ;
+    uint32_t addStringTest(uint8_t token, uint8_t op, bool ignore_case, const std::vector<std::string>& terms) ;
+    void buildAutomaton(StringMatcher& m) ;
+
+    bool evalNode(uint32_t node, const ExpFileEntry& file) const ;
+
+    std::vector<Node> mNodes ;
+    std::vector<StringMatcher> mMatchers ;
+    uint32_t mRoot ;
+    uint32_t mAutomatonStates ;			// in all matchers
+};
 }
 
 
@@ -307,6 +307,30 @@ struct SharedDirStats
     uint64_t total_shared_size ;
 };
 
+/// Counters of the cache of local search results, @see RsFiles::getSearchCacheStatistics
+struct SearchCacheStats : RsSerializable
+{
+	SearchCacheStats() :
+	    hits(0), misses(0), cpu_saved_us(0), entries(0), memory_usage(0) {}
+
+	uint64_t hits;			/// searches answered from the cache
+	uint64_t misses;		/// searches that went through the shared files
+	uint64_t cpu_saved_us;	/// time the hits took when they were cached, in microseconds
+	uint32_t entries;		/// number of cached searches
+	uint64_t memory_usage;	/// approximate memory used by cached searches, in bytes
+
+	/// @see RsSerializable::serial_process
+	void serial_process( RsGenericSerializer::SerializeJob j,
+	                     RsGenericSerializer::SerializeContext& ctx ) override
+	{
+		RS_SERIAL_PROCESS(hits);
+		RS_SERIAL_PROCESS(misses);
+		RS_SERIAL_PROCESS(cpu_saved_us);
+		RS_SERIAL_PROCESS(entries);
+		RS_SERIAL_PROCESS(memory_usage);
+	}
+};
+
 /** This class represents a tree of directories and files, only with their names
  * size and hash. It is used to create collection links in the GUI and to
  * transmit directory information between services. This class is independent
@@ -668,6 +692,21 @@ public:
 	 */
 	virtual bool FileCancel(const RsFileHash& hash) = 0;
 
+	/**
+	 * @brief Get progress of moving a complete file to its destination.
+	 * Files are moved once downloaded, which can take a while when the
+	 * download directory is on another file system. Their status is then
+	 * FT_STATE_MOVING. Cancelling the file with FileCancel() leaves it in the
+	 * partials directory.
+	 * @jsonapi{development}
+	 * @param[in] hash file identifier
+	 * @param[out] movedBytes bytes moved so far
+	 * @param[out] totalBytes file size
+	 * @return false if the file is not being moved
+	 */
+	virtual bool FileMoveProgress(
+	        const RsFileHash& hash, uint64_t& movedBytes, uint64_t& totalBytes ) = 0;
+
 	/**
 	 * @brief Set destination directory for given file
 	 * @jsonapi{development}
@@ -967,6 +1006,15 @@ public:
         virtual int SearchBoolExp(RsRegularExpression::Expression * exp, std::list<DirDetails> &results,FileSearchFlags flags,const RsPeerId& peer_id) = 0;
 		virtual int getSharedDirStatistics(const RsPeerId& pid, SharedDirStats& stats) =0;
 
+	/**
+	 * @brief Get statistics of the cache of local search results. Searches
+	 *	received from the turtle network are answered from it when the same
+	 *	search was done before and the shared files it found did not change.
+	 * @jsonapi{development}
+	 * @param[out] stats storage for the statistics
+	 */
+	virtual void getSearchCacheStatistics(SearchCacheStats& stats) = 0;
+
 	/**
 	 * @brief Ban unwanted file from being, searched and forwarded by this node
 	 * @jsonapi{development}
@@ -413,6 +413,22 @@ public:
 	virtual bool getContentSummaries( const RsGxsGroupId& channelId,
 	                                  std::vector<RsMsgMetaData>& summaries ) = 0;
 
+	/**
+	 * @brief Get summaries of the posts of a channel one page at a time,
+	 * newest first. Only the latest version of each post is returned, without
+	 * comments and votes. Filtering and paging are done by the database.
+	 * @jsonapi{development}
+	 * @param[in] channelId id of the channel of which the content is requested
+	 * @param[in] maxCount maximum number of posts in the page
+	 * @param[inout] cursor null for the first page, then updated by each call
+	 *	to be passed back to get the next page
+	 * @param[out] summaries storage for summaries, empty after the last page
+	 * @return false if something failed, true otherwhise
+	 */
+	virtual bool getContentSummariesPage(
+	        const RsGxsGroupId& channelId, uint32_t maxCount,
+	        RsGxsMsgPageCursor& cursor, std::vector<RsMsgMetaData>& summaries ) = 0;
+
 	/**
 	 * @brief Toggle post read status. Blocking API.
 	 * @jsonapi{development}
@@ -386,6 +386,25 @@ public:
 	virtual bool getForumMsgMetaData( const RsGxsGroupId& forumId,
 	                                  std::vector<RsMsgMetaData>& msgMetas) = 0;
 
+	/**
+	 * @brief Get message metadatas of a forum one page at a time, newest
+	 * first. Filtering and paging are done by the database, so that big
+	 * forums can be browsed without loading all their messages.
+	 * Blocking API.
+	 * @jsonapi{development}
+	 * @param[in] forumId id of the forum of which the content is requested
+	 * @param[in] onlyThreads if true only top level posts are returned
+	 * @param[in] maxCount maximum number of messages in the page
+	 * @param[inout] cursor null for the first page, then updated by each call
+	 *	to be passed back to get the next page
+	 * @param[out] msgMetas storage for the forum messages meta data, empty
+	 *	after the last page
+	 * @return false if something failed, true otherwhise
+	 */
+	virtual bool getForumMsgMetaDataPage(
+	        const RsGxsGroupId& forumId, bool onlyThreads, uint32_t maxCount,
+	        RsGxsMsgPageCursor& cursor, std::vector<RsMsgMetaData>& msgMetas ) = 0;
+
 	/**
 	 * @brief Get specific list of messages from a single forum. Blocking API
 	 * @jsonapi{development}
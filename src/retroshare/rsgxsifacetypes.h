@@ -269,6 +269,30 @@ struct GxsServiceStatistic : RsSerializable
 	~GxsServiceStatistic() override;
 };
 
+/**
+ * Position in the messages of a group sorted newest first, used by paged
+ * content APIs. A null cursor stands for the beginning of the list.
+ */
+struct RsGxsMsgPageCursor : RsSerializable
+{
+	RsGxsMsgPageCursor() : mPublishTs(0) {}
+
+	rstime_t mPublishTs;
+	RsGxsMessageId mMsgId;	/// last message of the previous page
+
+	bool isNull() const { return mMsgId.isNull(); }
+
+	/// @see RsSerializable
+	void serial_process( RsGenericSerializer::SerializeJob j,
+	                     RsGenericSerializer::SerializeContext& ctx ) override
+	{
+		RS_SERIAL_PROCESS(mPublishTs);
+		RS_SERIAL_PROCESS(mMsgId);
+	}
+
+	~RsGxsMsgPageCursor() override;
+};
+
 class RS_DEPRECATED RsGxsGroupUpdateMeta
 {
 public:
@@ -132,6 +132,7 @@ struct RsConfigOptions
 	bool autoLogin;                  /* try auto-login */
 
 	bool udpListenerOnly;			 /* only listen to udp */
+	std::string udpCongestionControl;	 /* congestion control of udp connections: "reno" (default) or "cubic" */
 
     std::string forcedInetAddress; 	 /* inet address to use.*/
     uint16_t    forcedPort; 	     /* port to listen to */
@@ -80,7 +80,8 @@ struct RsTokReqOptions
 {
 	RsTokReqOptions() : mOptions(0), mStatusFilter(0), mStatusMask(0),
 	    mMsgFlagMask(0), mMsgFlagFilter(0), mReqType(0), mSubscribeFilter(0),
-	    mSubscribeMask(0), mBefore(0), mAfter(0),mPriority(GxsRequestPriority::NORMAL) {}
+	    mSubscribeMask(0), mBefore(0), mAfter(0), mMaxCount(0),
+	    mPageAfterTs(0), mPriority(GxsRequestPriority::NORMAL) {}
 
 	/**
 	 * Can be one or multiple RS_TOKREQOPT_*
@@ -108,6 +109,14 @@ struct RsTokReqOptions
 	rstime_t   mBefore;
 	rstime_t   mAfter;
 
+	/* Paging of messages, for requests on whole groups. Messages are sorted
+	 * newest first, at most mMaxCount (0 for all) are returned per group,
+	 * starting after mPageAfterMsgId (last message of the previous page) if
+	 * it is not null. */
+	uint32_t   mMaxCount;
+	rstime_t   mPageAfterTs;
+	RsGxsMessageId mPageAfterMsgId;
+
     GxsRequestPriority mPriority;
 };
 
@@ -94,6 +94,10 @@ class TurtleTrafficStatisticsInfo
 		float total_dn_Bps ;			// turtle network management bitrate (in Bytes per sec.)
 
 		std::vector<float> forward_probabilities ;	// probability to forward a TR as a function of depth.
+
+		uint64_t search_cache_hits ;			// local searches answered from the search result cache
+		uint64_t search_cache_misses ;		// local searches that went through the shared files
+		float    search_cache_cpu_saved_s ;	// time saved by the hits (in sec.)
 };
 
 // Interface class for turtle hopping.
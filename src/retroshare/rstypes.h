@@ -49,6 +49,7 @@ const uint32_t FT_STATE_COMPLETE 		= 0x0004 ;
 const uint32_t FT_STATE_QUEUED   		= 0x0005 ;
 const uint32_t FT_STATE_PAUSED   		= 0x0006 ;
 const uint32_t FT_STATE_CHECKING_HASH	= 0x0007 ;
+const uint32_t FT_STATE_MOVING			= 0x0008 ;	// complete, being moved to the download directory
 
 // These constants are used by RsDiscSpace
 //
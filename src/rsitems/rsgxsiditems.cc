@@ -47,6 +47,9 @@ RsItem *RsGxsIdSerialiser::create_item(uint16_t service_id,uint8_t item_subtype)
 void RsGxsIdLocalInfoItem::clear()
 {
     mTimeStamps.clear() ;
+    mPgpKeySetGeneration = 0 ;
+    mPgpKeyGenerations.clear() ;
+    mPgpHashNegativeCache.clear() ;
 }
 void RsGxsIdGroupItem::clear()
 {
@@ -60,6 +63,15 @@ void RsGxsIdLocalInfoItem::serial_process(RsGenericSerializer::SerializeJob j,Rs
 {
     RsTypeSerializer::serial_process(j,ctx,mTimeStamps,"mTimeStamps") ;
     RsTypeSerializer::serial_process(j,ctx,mContacts,"mContacts") ;
+
+    // negative cache is optional
+
+    if(j == RsGenericSerializer::DESERIALIZE && ctx.mOffset == ctx.mSize)
+        return ;
+
+    RsTypeSerializer::serial_process<uint32_t>(j,ctx,mPgpKeySetGeneration,"mPgpKeySetGeneration") ;
+    RsTypeSerializer::serial_process(j,ctx,mPgpKeyGenerations,"mPgpKeyGenerations") ;
+    RsTypeSerializer::serial_process(j,ctx,mPgpHashNegativeCache,"mPgpHashNegativeCache") ;
 }
 
 void RsGxsIdGroupItem::serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx)
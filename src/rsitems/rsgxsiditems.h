@@ -76,7 +76,7 @@ public:
 
 struct RsGxsIdLocalInfoItem : public RsGxsIdItem
 {
-    RsGxsIdLocalInfoItem():  RsGxsIdItem(RS_PKT_SUBTYPE_GXSID_LOCAL_INFO_ITEM) {}
+    RsGxsIdLocalInfoItem():  RsGxsIdItem(RS_PKT_SUBTYPE_GXSID_LOCAL_INFO_ITEM), mPgpKeySetGeneration(0) {}
     virtual ~RsGxsIdLocalInfoItem() {}
 
     virtual void clear();
@@ -85,6 +85,11 @@ struct RsGxsIdLocalInfoItem : public RsGxsIdItem
 
     std::map<RsGxsId,rstime_t> mTimeStamps ;
     std::set<RsGxsId> mContacts ;
+
+    // PGP link brute-forcing negative cache. Optional, for backward compatibility.
+    uint32_t mPgpKeySetGeneration ;
+    std::map<RsPgpId,uint32_t> mPgpKeyGenerations ;
+    std::map<Sha1CheckSum,uint32_t> mPgpHashNegativeCache ;
 };
 
 class RsGxsIdSerialiser : public RsServiceSerializer
@@ -40,6 +40,11 @@ const uint8_t RsNxsSyncMsgItem::FLAG_USE_SYNC_HASH       = 0x0001;
 
 const uint8_t RsNxsSyncMsgReqItem::FLAG_USE_HASHED_GROUP_ID = 0x02;
 
+// Ignored by older versions, which never check other bits of these flags
+const uint8_t RsNxsSyncGrpReqItem::FLAG_SUPPORTS_KEY_HINTS = 0x04;
+const uint8_t RsNxsSyncMsgReqItem::FLAG_SUPPORTS_KEY_HINTS = 0x04;
+const uint8_t RsNxsSyncMsgReqItem::FLAG_SUPPORTS_UPDATE_NOTICES = 0x08;
+
 /** transaction state **/
 const uint16_t RsNxsTransacItem::FLAG_BEGIN_P1         = 0x0001;
 const uint16_t RsNxsTransacItem::FLAG_BEGIN_P2         = 0x0002;
@@ -77,6 +82,7 @@ RsItem *RsNxsSerialiser::create_item(uint16_t service_id,uint8_t item_subtype) c
         case RS_PKT_SUBTYPE_NXS_ENCRYPTED_DATA_ITEM: return new RsNxsEncryptedDataItem(SERVICE_TYPE) ;
         case RS_PKT_SUBTYPE_NXS_SYNC_GRP_STATS_ITEM: return new RsNxsSyncGrpStatsItem(SERVICE_TYPE) ;
         case RS_PKT_SUBTYPE_NXS_SYNC_PULL_REQUEST_ITEM: return new RsNxsPullRequestItem(SERVICE_TYPE) ;
+        case RS_PKT_SUBTYPE_NXS_GRP_UPDATE_NOTICE_ITEM: return new RsNxsGroupUpdateNoticeItem(SERVICE_TYPE) ;
 
         default:
                 return NULL;
@@ -92,6 +98,12 @@ void RsNxsSyncMsgItem::serial_process(RsGenericSerializer::SerializeJob j,RsGene
     RsTypeSerializer::serial_process          (j,ctx,authorId         ,"authorId") ;
 }
 
+void RsNxsGroupUpdateNoticeItem::serial_process(RsGenericSerializer::SerializeJob j,RsGenericSerializer::SerializeContext& ctx)
+{
+    RsTypeSerializer::serial_process          (j,ctx,grpId   ,"grpId") ;
+    RsTypeSerializer::serial_process<uint32_t>(j,ctx,updateTS,"updateTS") ;
+}
+
 void RsNxsMsg::serial_process( RsGenericSerializer::SerializeJob j,
                                RsGenericSerializer::SerializeContext& ctx )
 {
@@ -49,6 +49,7 @@ const uint8_t RS_PKT_SUBTYPE_NXS_MSG_ITEM             = 0x20;
 const uint8_t RS_PKT_SUBTYPE_NXS_TRANSAC_ITEM         = 0x40;
 const uint8_t RS_PKT_SUBTYPE_NXS_GRP_PUBLISH_KEY_ITEM = 0x80;
 const uint8_t RS_PKT_SUBTYPE_NXS_SYNC_PULL_REQUEST_ITEM = 0x90;
+const uint8_t RS_PKT_SUBTYPE_NXS_GRP_UPDATE_NOTICE_ITEM = 0x91;
 
 
 #ifdef RS_DEAD_CODE
@@ -91,6 +92,7 @@ public:
 
 	static const uint8_t FLAG_USE_SYNC_HASH;
 	static const uint8_t FLAG_ONLY_CURRENT; // only send most current version of grps / ignores sync hash
+	static const uint8_t FLAG_SUPPORTS_KEY_HINTS; // the requester can decrypt circle data with recipient key hints
 
     explicit RsNxsSyncGrpReqItem(uint16_t servtype) : RsNxsItem(servtype, RS_PKT_SUBTYPE_NXS_SYNC_GRP_REQ_ITEM) { RsNxsSyncGrpReqItem::clear();}
 	virtual void clear() override;
@@ -304,6 +306,8 @@ public:
     static const uint8_t FLAG_USE_SYNC_HASH;
 #endif
     static const uint8_t FLAG_USE_HASHED_GROUP_ID;
+    static const uint8_t FLAG_SUPPORTS_KEY_HINTS; // the requester can decrypt circle data with recipient key hints
+    static const uint8_t FLAG_SUPPORTS_UPDATE_NOTICES; // the requester handles RsNxsGroupUpdateNoticeItem
 
     explicit RsNxsSyncMsgReqItem(uint16_t servtype) : RsNxsItem(servtype, RS_PKT_SUBTYPE_NXS_SYNC_MSG_REQ_ITEM) { RsNxsSyncMsgReqItem::clear(); }
 
@@ -355,6 +359,28 @@ public:
 	                     RsGenericSerializer::SerializeContext& ) override {}
 };
 
+/*!
+ * Pushed to friends when new messages of a public group are received or
+ * published, so that they can ask for them without waiting for the next
+ * periodic sync. Only sent to peers that set
+ * RsNxsSyncMsgReqItem::FLAG_SUPPORTS_UPDATE_NOTICES.
+ */
+class RsNxsGroupUpdateNoticeItem: public RsNxsItem
+{
+public:
+	explicit RsNxsGroupUpdateNoticeItem(uint16_t servtype)
+	  : RsNxsItem(servtype, RS_PKT_SUBTYPE_NXS_GRP_UPDATE_NOTICE_ITEM), updateTS(0) {}
+
+	virtual void clear() override { grpId.clear(); updateTS = 0; }
+
+	/// @see RsSerializable
+	void serial_process( RsGenericSerializer::SerializeJob j,
+	                     RsGenericSerializer::SerializeContext& ctx ) override;
+
+	RsGxsGroupId grpId;
+	uint32_t updateTS;	// msgUpdateTS of the group at the sender
+};
+
 
 /*!
  * Used to respond to a RsGrpMsgsReq
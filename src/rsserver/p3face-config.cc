@@ -28,6 +28,7 @@
 #include "retroshare/rsinit.h"
 #include "plugins/pluginmanager.h"
 #include "util/rsdebug.h"
+#include "util/rsscheduler.h"
 
 #ifdef RS_JSONAPI
 #	include "jsonapi/jsonapi.h"
@@ -79,6 +80,12 @@ void RsServer::startServiceThread(RsTickingThread *t, const std::string &threadN
     mRegisteredServiceThreads.push_back(t) ;
 }
 
+void RsServer::startScheduledService(RsTickingThread *t, const std::string &name, std::chrono::milliseconds period)
+{
+    t->startScheduled(name, period) ;
+    mRegisteredServiceThreads.push_back(t) ;
+}
+
 void RsServer::rsGlobalShutDown()
 {
 	bool wasReady = coreReady;
@@ -99,6 +106,8 @@ void RsServer::rsGlobalShutDown()
 		// kill all registered service threads
 		for(RsTickingThread* service: mRegisteredServiceThreads)
 			service->fullstop();
+
+		RsScheduler::instance().stop();
 	}
 
 	fullstop();
@@ -36,6 +36,7 @@
 #include "pqi/p3netmgr.h"
 
 #include "util/rsdebug.h"
+#include "util/rsscheduler.h"
 
 #include "retroshare/rsevents.h"
 #include "services/rseventsservice.h"
@@ -216,6 +217,13 @@ void RsServer::threadTick()
 	{
 #ifdef TICK_DEBUG
 		RsDbg() << "TICK_DEBUG every 60 seconds";
+
+		RsScheduler::Statistics st = RsScheduler::instance().getStatistics();
+		RsDbg() << "TICK_DEBUG scheduler threads " << st.threads << " jobs " << st.jobs
+		        << " runs " << st.runs << " timer wakeups " << st.timerWakeups
+		        << " explicit wakeups " << st.explicitWakeups << " steals " << st.steals
+		        << " busy workers " << st.busyWorkers << " queued " << st.queuedJobs
+		        << " stalls " << st.stalls;
 #endif
 		// force saving FileTransferStatus TODO
 		// ftserver->saveFileTransferStatus();
@@ -121,6 +121,7 @@ public:
 		virtual void    ConfigFinalSave( );
         virtual RsConfigMgr *configManager() const override { return mConfigMgr; }
         virtual void	startServiceThread(RsTickingThread *t, const std::string &threadName) ;
+        virtual void	startScheduledService(RsTickingThread *t, const std::string &name, std::chrono::milliseconds period) ;
 
 		/************* Rs shut down function: in upnp 'port lease time' bug *****************/
 
@@ -25,6 +25,8 @@
 
 #include "pqi/authgpg.h"
 #include "pqi/authssl.h"
+#include "pqi/pqitrafficstats.h"
+#include "util/rsscheduler.h"
 
 RsServerConfig *rsConfig = NULL;
 
@@ -184,6 +186,37 @@ int p3ServerConfig::getTrafficInfo(std::list<RSTrafficClue>& out_lst,std::list<R
         return 0 ;
 }
 
+int p3ServerConfig::getTrafficStatistics(RsTrafficStatistics& stats)
+{
+	stats.size_bounds.clear() ;
+
+	for(uint32_t i=0;i+1<pqiTrafficCounters::HISTOGRAM_BUCKETS;++i)
+		stats.size_bounds.push_back(pqiTrafficCounters::histogramBound(i)) ;
+
+	pqiTrafficCounters::getTotals(true,stats.out) ;
+	pqiTrafficCounters::getTotals(false,stats.in) ;
+
+	return 1 ;
+}
+
+int p3ServerConfig::getSchedulerStatistics(RsSchedulerStatistics& stats)
+{
+	RsScheduler::Statistics s = RsScheduler::instance().getStatistics() ;
+
+	stats.threads = s.threads ;
+	stats.jobs = s.jobs ;
+	stats.runs = s.runs ;
+	stats.timerWakeups = s.timerWakeups ;
+	stats.explicitWakeups = s.explicitWakeups ;
+	stats.steals = s.steals ;
+	stats.busyWorkers = s.busyWorkers ;
+	stats.queuedJobs = s.queuedJobs ;
+	stats.longestRunMs = s.longestRunMs ;
+	stats.stalls = s.stalls ;
+
+	return 1 ;
+}
+
 int 	p3ServerConfig::getTotalBandwidthRates(RsConfigDataRates &rates)
 {
 	if (rsBandwidthControl)
@@ -49,6 +49,8 @@ class p3ServerConfig: public RsServerConfig
 	virtual int getTotalBandwidthRates(RsConfigDataRates &rates) override;
 	virtual int getAllBandwidthRates(std::map<RsPeerId, RsConfigDataRates> &ratemap) override;
 	virtual int getTrafficInfo(std::list<RSTrafficClue>& out_lst, std::list<RSTrafficClue> &in_lst) override;
+	virtual int getTrafficStatistics(RsTrafficStatistics& stats) override;
+	virtual int getSchedulerStatistics(RsSchedulerStatistics& stats) override;
 
 	/* From RsInit */
 
@@ -43,6 +43,7 @@
 #include "util/rsrandom.h"
 #include "util/folderiterator.h"
 #include "util/rsstring.h"
+#include "util/rsstartuptimeline.h"
 #include "retroshare/rsinit.h"
 #include "retroshare/rsmail.h"
 #include "retroshare/rstor.h"
@@ -59,6 +60,7 @@
 #include "friend_server/fsmanager.h"
 #endif
 
+#include <future>
 #include <list>
 #include <string>
 
@@ -192,6 +194,7 @@ struct RsInitConfig
 		std::string logfname;
 
 		bool udpListenerOnly;
+		std::string udpCongestionControl;
 		std::string opModeStr;
 		std::string optBaseDir;
 
@@ -325,6 +328,7 @@ int RsInit::InitRetroShare(const RsConfigOptions& conf)
     rsInitConfig->port               = conf.forcedPort ;
     rsInitConfig->debugLevel         = conf.debugLevel;
     rsInitConfig->udpListenerOnly    = conf.udpListenerOnly;
+    rsInitConfig->udpCongestionControl = conf.udpCongestionControl;
     rsInitConfig->optBaseDir         = conf.optBaseDir;
     rsInitConfig->jsonApiPort        = conf.jsonApiPort;
     rsInitConfig->jsonApiBindAddress = conf.jsonApiBindAddress;
@@ -882,6 +886,7 @@ RsGRouter *rsGRouter = NULL ;
 #include "pqi/p3netmgr.h"
 	
 #include "tcponudp/tou.h"
+#include "tcponudp/tcpcongestion.h"
 #include "tcponudp/rsudpstack.h"
 	
 #ifdef RS_USE_BITDHT
@@ -929,6 +934,9 @@ RsControl *RsControl::instance()
 
 int RsServer::StartupRetroShare()
 {
+	// start of the timeline
+	RsStartupTimeline::instance();
+
 	RsPeerId ownId = AuthSSL::getAuthSSL()->OwnId();
 
     std::cerr << "========================================================================" << std::endl;
@@ -1244,6 +1252,12 @@ int RsServer::StartupRetroShare()
 		udpTypes[RSUDP_TOU_RECVER_PROXY_IDX] = TOU_RECEIVER_TYPE_UDPPEER;
 		mProxyStack->addReceiver(udpReceivers[RSUDP_TOU_RECVER_PROXY_IDX]);
 
+		// Congestion control is sender side only: any choice works with all peers.
+		if (rsInitConfig->udpCongestionControl == "cubic")
+			tou_set_congestion_control(TOU_CONGESTION_CUBIC);
+		else if (!rsInitConfig->udpCongestionControl.empty() && rsInitConfig->udpCongestionControl != "reno")
+			RsWarn() << "Unknown udp congestion control \"" << rsInitConfig->udpCongestionControl << "\". Using reno." << std::endl;
+
 		// REAL INITIALISATION - WITH THREE MODES
 		tou_init((void **) udpReceivers, udpTypes, RSUDP_NUM_TOU_RECVERS);
 
@@ -1356,6 +1370,40 @@ int RsServer::StartupRetroShare()
 		std::string currGxsDir = RsAccounts::AccountDirectory() + "/gxs";
         RsDirUtil::checkCreateDirectory(currGxsDir);
 
+	double gxsStartTime = RsStartupTimeline::instance().now();
+
+	/* The databases don't depend on each other, and opening one costs the key
+	 * derivation plus the schema checks, so they are all opened concurrently
+	 * while the services are created. */
+	const std::string gxsPasswd = rsInitConfig->gxs_passwd;
+	auto openGxsDb = [&](const std::string& dbName, uint16_t serviceType)
+	{
+		return std::async(std::launch::async, [=]() -> RsGeneralDataService*
+		{
+			RsStartupTimeline::Step step("gxs_databases", dbName);
+			return new RsDataService( currGxsDir + "/", dbName, serviceType,
+			                          nullptr, gxsPasswd );
+		});
+	};
+
+	auto gxsid_dbf = openGxsDb("gxsid_db", RS_SERVICE_GXS_TYPE_GXSID);
+	auto gxscircles_dbf = openGxsDb("gxscircles_db", RS_SERVICE_GXS_TYPE_GXSCIRCLE);
+	auto posted_dbf = openGxsDb("posted_db", RS_SERVICE_GXS_TYPE_POSTED);
+#ifdef RS_USE_WIKI
+	auto wiki_dbf = openGxsDb("wiki_db", RS_SERVICE_GXS_TYPE_WIKI);
+#endif
+	auto gxsforums_dbf = openGxsDb("gxsforums_db", RS_SERVICE_GXS_TYPE_FORUMS);
+	auto gxschannels_dbf = openGxsDb("gxschannels_db", RS_SERVICE_GXS_TYPE_CHANNELS);
+#ifdef RS_USE_PHOTO
+	auto photo_dbf = openGxsDb("photoV2_db", RS_SERVICE_GXS_TYPE_PHOTO);
+#endif
+#ifdef RS_USE_WIRE
+	auto wire_dbf = openGxsDb("wire_db", RS_SERVICE_GXS_TYPE_WIRE);
+#endif
+#	ifdef RS_GXS_TRANS
+	auto gxstrans_dbf = openGxsDb("gxstrans_db", RS_SERVICE_TYPE_GXS_TRANS);
+#	endif
+
         RsNxsNetMgr* nxsMgr =  new RsNxsNetMgrImpl(serviceCtrl);
 
         /**** GXS Dist sync service ****/
@@ -1369,16 +1417,14 @@ int RsServer::StartupRetroShare()
 
         /**** Identity service ****/
 
-        RsGeneralDataService* gxsid_ds = new RsDataService(currGxsDir + "/", "gxsid_db",
-                        RS_SERVICE_GXS_TYPE_GXSID, NULL, rsInitConfig->gxs_passwd);
+        RsGeneralDataService* gxsid_ds = gxsid_dbf.get();
 
         // init gxs services
 	PgpAuxUtils *pgpAuxUtils = new PgpAuxUtilsImpl();
         p3IdService *mGxsIdService = new p3IdService(gxsid_ds, NULL, pgpAuxUtils);
 
         // circles created here, as needed by Ids.
-        RsGeneralDataService* gxscircles_ds = new RsDataService(currGxsDir + "/", "gxscircles_db",
-                        RS_SERVICE_GXS_TYPE_GXSCIRCLE, NULL, rsInitConfig->gxs_passwd);
+        RsGeneralDataService* gxscircles_ds = gxscircles_dbf.get();
 
 	// create GxsCircles - early, as IDs need it.
         p3GxsCircles *mGxsCircles = new p3GxsCircles(gxscircles_ds, NULL, mGxsIdService, pgpAuxUtils);
@@ -1416,9 +1462,7 @@ int RsServer::StartupRetroShare()
     
         /**** Posted GXS service ****/
 
-        RsGeneralDataService* posted_ds = new RsDataService(currGxsDir + "/", "posted_db",
-                        RS_SERVICE_GXS_TYPE_POSTED, 
-			NULL, rsInitConfig->gxs_passwd);
+        RsGeneralDataService* posted_ds = posted_dbf.get();
 
         p3Posted *mPosted = new p3Posted(posted_ds, NULL, mGxsIdService);
 
@@ -1434,9 +1478,7 @@ int RsServer::StartupRetroShare()
         /**** Wiki GXS service ****/
 
 #ifdef RS_USE_WIKI
-        RsGeneralDataService* wiki_ds = new RsDataService(currGxsDir + "/", "wiki_db",
-                        RS_SERVICE_GXS_TYPE_WIKI,
-                        NULL, rsInitConfig->gxs_passwd);
+        RsGeneralDataService* wiki_ds = wiki_dbf.get();
 
         p3Wiki *mWiki = new p3Wiki(wiki_ds, NULL, mGxsIdService);
         // create GXS wiki service
@@ -1451,9 +1493,7 @@ int RsServer::StartupRetroShare()
 
 	/************************* Forum GXS service ******************************/
 
-	RsGeneralDataService* gxsforums_ds = new RsDataService(
-	            currGxsDir + "/", "gxsforums_db", RS_SERVICE_GXS_TYPE_FORUMS,
-	            nullptr, rsInitConfig->gxs_passwd );
+	RsGeneralDataService* gxsforums_ds = gxsforums_dbf.get();
 
     p3GxsForums* mGxsForums = new p3GxsForums( gxsforums_ds, nullptr, mGxsIdService );
 
@@ -1471,8 +1511,7 @@ int RsServer::StartupRetroShare()
 
         /**** Channel GXS service ****/
 
-        RsGeneralDataService* gxschannels_ds = new RsDataService(currGxsDir + "/", "gxschannels_db",
-                                                            RS_SERVICE_GXS_TYPE_CHANNELS, NULL, rsInitConfig->gxs_passwd);
+        RsGeneralDataService* gxschannels_ds = gxschannels_dbf.get();
 
         p3GxsChannels *mGxsChannels = new p3GxsChannels(gxschannels_ds, NULL, mGxsIdService);
 
@@ -1493,8 +1532,7 @@ int RsServer::StartupRetroShare()
 
 #ifdef RS_USE_PHOTO
         /**** Photo service ****/
-        RsGeneralDataService* photo_ds = new RsDataService(currGxsDir + "/", "photoV2_db",
-                        RS_SERVICE_GXS_TYPE_PHOTO, NULL, rsInitConfig->gxs_passwd);
+        RsGeneralDataService* photo_ds = photo_dbf.get();
 
         // init gxs services
         p3PhotoService *mPhoto = new p3PhotoService(photo_ds, NULL, mGxsIdService);
@@ -1511,8 +1549,7 @@ int RsServer::StartupRetroShare()
 
 #ifdef RS_USE_WIRE
         /**** Wire GXS service ****/
-        RsGeneralDataService* wire_ds = new RsDataService(currGxsDir + "/", "wire_db",
-                        RS_SERVICE_GXS_TYPE_WIRE, NULL, rsInitConfig->gxs_passwd);
+        RsGeneralDataService* wire_ds = wire_dbf.get();
 
         p3Wire *mWire = new p3Wire(wire_ds, NULL, mGxsIdService);
 
@@ -1542,9 +1579,7 @@ int RsServer::StartupRetroShare()
 #endif
 
 #	ifdef RS_GXS_TRANS
-	RsGeneralDataService* gxstrans_ds = new RsDataService(
-	            currGxsDir + "/", "gxstrans_db", RS_SERVICE_TYPE_GXS_TRANS,
-	            NULL, rsInitConfig->gxs_passwd );
+	RsGeneralDataService* gxstrans_ds = gxstrans_dbf.get();
 	mGxsTrans = new p3GxsTrans(gxstrans_ds, NULL, *mGxsIdService);
 
 	RsGxsNetService* gxstrans_ns = new RsGxsNetService(
@@ -1561,6 +1596,10 @@ int RsServer::StartupRetroShare()
 	// remove pword from memory
 	rsInitConfig->gxs_passwd = "";
 
+	RsStartupTimeline::instance().record(
+	            "startup", "gxs_services", gxsStartTime,
+	            RsStartupTimeline::instance().now() );
+
 #endif // RS_ENABLE_GXS.
 
 	/* create Services */
@@ -1818,7 +1857,10 @@ int RsServer::StartupRetroShare()
 	/**************************************************************************/
 	std::cerr << "(2) Load configuration files" << std::endl;
 
-	mConfigMgr->loadConfiguration();
+	{
+		RsStartupTimeline::Step step("startup", "load_configuration");
+		mConfigMgr->loadConfiguration();
+	}
 
 	/**************************************************************************/
 	/* trigger generalConfig loading for classes that require it */
@@ -1959,42 +2001,45 @@ int RsServer::StartupRetroShare()
     /*** start up GXS core runner ***/
 
 	startServiceThread(mGxsNetTunnel, "gxs net tunnel");
-	startServiceThread(mGxsIdService, "gxs id");
-	startServiceThread(mGxsCircles, "gxs circle");
-	startServiceThread(mPosted, "gxs posted");
+
+	// GXS services and net services are ticked by the shared scheduler
+	// rather than owning a thread each, see RsScheduler.
+	startScheduledService(mGxsIdService, "gxs id", RsGenExchange::tickPeriod());
+	startScheduledService(mGxsCircles, "gxs circle", RsGenExchange::tickPeriod());
+	startScheduledService(mPosted, "gxs posted", RsGenExchange::tickPeriod());
 #if RS_USE_WIKI
-	startServiceThread(mWiki, "gxs wiki");
+	startScheduledService(mWiki, "gxs wiki", RsGenExchange::tickPeriod());
 #endif
-	startServiceThread(mGxsForums, "gxs forums");
-	startServiceThread(mGxsChannels, "gxs channels");
+	startScheduledService(mGxsForums, "gxs forums", RsGenExchange::tickPeriod());
+	startScheduledService(mGxsChannels, "gxs channels", RsGenExchange::tickPeriod());
 
 #if RS_USE_PHOTO
-	startServiceThread(mPhoto, "gxs photo");
+	startScheduledService(mPhoto, "gxs photo", RsGenExchange::tickPeriod());
 #endif
 #if RS_USE_WIRE
-	startServiceThread(mWire, "gxs wire");
+	startScheduledService(mWire, "gxs wire", RsGenExchange::tickPeriod());
 #endif
 
 	// cores ready start up GXS net servers
-	startServiceThread(gxsid_ns, "gxs id ns");
-	startServiceThread(gxscircles_ns, "gxs circle ns");
-	startServiceThread(posted_ns, "gxs posted ns");
+	startScheduledService(gxsid_ns, "gxs id ns", RsGxsNetService::tickPeriod());
+	startScheduledService(gxscircles_ns, "gxs circle ns", RsGxsNetService::tickPeriod());
+	startScheduledService(posted_ns, "gxs posted ns", RsGxsNetService::tickPeriod());
 #if RS_USE_WIKI
-	startServiceThread(wiki_ns, "gxs wiki ns");
+	startScheduledService(wiki_ns, "gxs wiki ns", RsGxsNetService::tickPeriod());
 #endif
-	startServiceThread(gxsforums_ns, "gxs forums ns");
-	startServiceThread(gxschannels_ns, "gxs channels ns");
+	startScheduledService(gxsforums_ns, "gxs forums ns", RsGxsNetService::tickPeriod());
+	startScheduledService(gxschannels_ns, "gxs channels ns", RsGxsNetService::tickPeriod());
 
 #if RS_USE_PHOTO
-	startServiceThread(photo_ns, "gxs photo ns");
+	startScheduledService(photo_ns, "gxs photo ns", RsGxsNetService::tickPeriod());
 #endif
 #if RS_USE_WIRE
-	startServiceThread(wire_ns, "gxs wire ns");
+	startScheduledService(wire_ns, "gxs wire ns", RsGxsNetService::tickPeriod());
 #endif
 
 #	ifdef RS_GXS_TRANS
-	startServiceThread(mGxsTrans, "gxs trans");
-	startServiceThread(gxstrans_ns, "gxs trans ns");
+	startScheduledService(mGxsTrans, "gxs trans", RsGenExchange::tickPeriod());
+	startScheduledService(gxstrans_ns, "gxs trans ns", RsGxsNetService::tickPeriod());
 #	endif // def RS_GXS_TRANS
 
 #endif // RS_ENABLE_GXS
@@ -2065,6 +2110,8 @@ int RsServer::StartupRetroShare()
     std::cerr << "==                 RsInit:: Retroshare core started                   ==" << std::endl;
     std::cerr << "========================================================================" << std::endl;
 
+	RsStartupTimeline::instance().finish();
+
 	coreReady = true;
 	return 1;
 }
@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * libretroshare/src/serialiser: rsjsonstreamwriter.cc                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include "serialiser/rsjsonstreamwriter.h"
+
+/// Size of the first chunk of the element DOM allocator
+static const size_t DOM_BUFFER_SIZE = 16*1024;
+
+RsJsonStreamWriter::RsJsonStreamWriter(
+        const Sink& sink, size_t chunkSize, RsSerializationFlags flags ) :
+    mSink(sink), mChunkSize(chunkSize), mFlags(flags), mStream(*this),
+    mWriter(mStream), mDomBuffer(DOM_BUFFER_SIZE),
+    mAllocator(mDomBuffer.data(), mDomBuffer.size()),
+    mOk(true), mSinkOk(true), mFinished(false), mBytesWritten(0), mPeakDomSize(0)
+{
+	mBuffer.reserve(mChunkSize);
+	mWriter.StartObject();
+}
+
+void RsJsonStreamWriter::copyMember(
+        const rapidjson::Value& name, const rapidjson::Value& value )
+{
+	if(!startMember(std::string(name.GetString(), name.GetStringLength())))
+		return;
+
+	value.Accept(mWriter);
+}
+
+bool RsJsonStreamWriter::startMember(const std::string& memberName)
+{
+	if(!mOk || !mSinkOk || mFinished) return false;
+
+	mWriter.Key( memberName.c_str(),
+	             static_cast<rapidjson::SizeType>(memberName.length()) );
+	return true;
+}
+
+bool RsJsonStreamWriter::flushBuffer()
+{
+	/* Once the sink stopped the text is dropped, see startMember(). It is up
+	 * to the sink to report why it stopped */
+	if(mSinkOk && !mBuffer.empty())
+	{
+		mSinkOk = mSink(mBuffer.data(), mBuffer.size());
+		if(mSinkOk) mBytesWritten += mBuffer.size();
+	}
+
+	mBuffer.clear();
+	return mSinkOk;
+}
+
+bool RsJsonStreamWriter::finish()
+{
+	if(!mFinished)
+	{
+		mWriter.EndObject();
+		mFinished = true;
+	}
+
+	return flushBuffer() && mOk;
+}
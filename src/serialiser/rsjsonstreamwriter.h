@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * libretroshare/src/serialiser: rsjsonstreamwriter.h                          *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <rapidjson/prettywriter.h>
+
+#include "serialiser/rstypeserializer.h"
+#include "util/rsjson.h"
+
+/**
+ * @brief Write a JSON object member by member to a sink, without building the
+ * whole document first.
+ * Members are serialized with RsTypeSerializer in TO_JSON mode like before,
+ * but sequence containers and maps are processed one element at a time, so
+ * only one element at a time lives in the JSON DOM. The text is handed to the
+ * sink in chunks of about chunkSize bytes.
+ * When serialization succeeds the output is the same as printing with
+ * operator<<(std::ostream&, RsJson&) the document RS_SERIAL_PROCESS would have
+ * built.
+ *
+ * Usage:
+ *   RsJsonStreamWriter w(sink);
+ *   RS_JSON_STREAM_MEMBER(w, fileList);
+ *   RS_JSON_STREAM_MEMBER(w, retval);
+ *   w.finish();
+ */
+class RsJsonStreamWriter
+{
+public:
+	/// Called with each chunk of text, return false to stop writing
+	typedef std::function<bool(const char* data, size_t size)> Sink;
+
+	static const size_t DEFAULT_CHUNK_SIZE = 64*1024;
+
+	explicit RsJsonStreamWriter(
+	        const Sink& sink, size_t chunkSize = DEFAULT_CHUNK_SIZE,
+	        RsSerializationFlags flags = RsSerializationFlags::NONE );
+
+	/// Copy a member of an already built JSON document, e.g. caller_data
+	void copyMember(const rapidjson::Value& name, const rapidjson::Value& value);
+
+	/// Serialize a member, same as RS_SERIAL_PROCESS(member) would do
+	template<typename T>
+	typename std::enable_if<
+	    RsTypeSerializer::is_sequence_container<T>::value >::type
+	/*void*/ member(const std::string& memberName, T& member)
+	{
+		if(!startMember(memberName)) return;
+
+		mWriter.StartArray();
+		for(auto& const_el : member)
+		{
+			using el_t = typename T::value_type;
+			auto& el = const_cast<el_t&>(const_el);
+
+			if(!writeValue(el, memberName)) break;
+		}
+		mWriter.EndArray();
+	}
+
+	/// Serialize a std::map member as the array of key-value objects
+	template<typename K, typename V>
+	void member(const std::string& memberName, std::map<K,V>& member)
+	{
+		if(!startMember(memberName)) return;
+
+		mWriter.StartArray();
+		for(auto& kv : member)
+		{
+			if(!mOk || !mSinkOk) break;
+
+			RsGenericSerializer::SerializeContext kCtx(
+			            nullptr, 0, mFlags, &mAllocator );
+			RsTypeSerializer::serial_process(
+			            RsGenericSerializer::TO_JSON, kCtx,
+			            const_cast<K&>(kv.first), "key" );
+
+			RsGenericSerializer::SerializeContext vCtx(
+			            nullptr, 0, mFlags, &mAllocator );
+			RsTypeSerializer::serial_process(
+			            RsGenericSerializer::TO_JSON, vCtx, kv.second, "value" );
+
+			// Skip the element like the DOM serialization does
+			if(kCtx.mOk && vCtx.mOk)
+			{
+				mWriter.StartObject();
+				mWriter.Key("key");
+				kCtx.mJson["key"].Accept(mWriter);
+				mWriter.Key("value");
+				vCtx.mJson["value"].Accept(mWriter);
+				mWriter.EndObject();
+			}
+
+			if(mAllocator.Size() > mPeakDomSize)
+				mPeakDomSize = mAllocator.Size();
+			mAllocator.Clear();
+		}
+		mWriter.EndArray();
+	}
+
+	/// Any other type is serialized in one go
+	template<typename T>
+	typename std::enable_if<
+	    !RsTypeSerializer::is_sequence_container<T>::value >::type
+	/*void*/ member(const std::string& memberName, T& member)
+	{
+		if(!startMember(memberName)) return;
+
+		// The key is already written, keep the output valid JSON
+		if(!writeValue(member, memberName)) mWriter.Null();
+	}
+
+	/**
+	 * @brief Close the JSON object and hand the remaining text to the sink
+	 * After a member fails to serialize the following ones are skipped, like
+	 * RS_SERIAL_PROCESS does, but the object is still completed and written.
+	 * @return false if a member could not be serialized or the sink failed
+	 */
+	bool finish();
+
+	/// false if a member could not be serialized, like SerializeContext::mOk
+	bool ok() const { return mOk; }
+
+	/// Bytes handed to the sink so far
+	size_t bytesWritten() const { return mBytesWritten; }
+
+	/// Biggest amount of memory used by the DOM of a single element
+	size_t peakDomSize() const { return mPeakDomSize; }
+
+private:
+	/// rapidjson output stream, buffers up to a chunk and calls the sink
+	struct ChunkStream
+	{
+		typedef char Ch;
+
+		ChunkStream(RsJsonStreamWriter& writer) : mWriter(writer) {}
+
+		void Put(Ch c)
+		{
+			mWriter.mBuffer.push_back(c);
+			if(mWriter.mBuffer.size() >= mWriter.mChunkSize)
+				mWriter.flushBuffer();
+		}
+
+		void Flush() {}
+
+		RsJsonStreamWriter& mWriter;
+	};
+
+	bool startMember(const std::string& memberName);
+	bool flushBuffer();
+
+	/// Serialize value in the DOM then write it, nothing is written on failure
+	template<typename T>
+	bool writeValue(T& value, const std::string& memberName)
+	{
+		if(!mOk || !mSinkOk) return false;
+
+		RsGenericSerializer::SerializeContext ctx(
+		            nullptr, 0, mFlags, &mAllocator );
+		RsTypeSerializer::serial_process(
+		            RsGenericSerializer::TO_JSON, ctx, value, memberName );
+
+		auto vIt = ctx.mJson.FindMember(memberName.c_str());
+		ctx.mOk = ctx.mOk && vIt != ctx.mJson.MemberEnd();
+		if(ctx.mOk) vIt->value.Accept(mWriter);
+		else mOk = false;
+
+		if(mAllocator.Size() > mPeakDomSize) mPeakDomSize = mAllocator.Size();
+		mAllocator.Clear();
+
+		return ctx.mOk;
+	}
+
+	Sink mSink;
+	const size_t mChunkSize;
+	const RsSerializationFlags mFlags;
+
+	std::string mBuffer;
+	ChunkStream mStream;
+	rapidjson::PrettyWriter<ChunkStream> mWriter;
+
+	/// Reused for the DOM of each element, mDomBuffer is its first chunk
+	std::vector<char> mDomBuffer;
+	RsJson::AllocatorType mAllocator;
+
+	bool mOk;
+	bool mSinkOk;
+	bool mFinished;
+	size_t mBytesWritten;
+	size_t mPeakDomSize;
+};
+
+/// Use like RS_SERIAL_PROCESS(I) to write a member with a RsJsonStreamWriter
+#define RS_JSON_STREAM_MEMBER(W, I) do { (W).member(#I, I); } while(0)
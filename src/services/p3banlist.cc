@@ -60,7 +60,10 @@ RsBanList *rsBanList = NULL ;
 
 p3BanList::p3BanList(p3ServiceControl *sc, p3NetMgr */*nm*/)
   : p3Service(), mBanMtx("p3BanList"), mServiceCtrl(sc)
-  , mSentListTime(0), mLastDhtInfoRequest(0)
+  , mSentListTime(0)
+  , mSnapshot(std::make_shared<BanListSnapshot>(true))
+  , mBlocklistFilesToLoad(false)
+  , mLastDhtInfoRequest(0)
   // default number of IPs in same range to trigger a complete IP /24 filter.
   , mAutoRangeLimit(2), mAutoRangeIps(true)
   , mIPFilteringEnabled(true)
@@ -85,25 +88,46 @@ RsServiceInfo p3BanList::getServiceInfo()
 }
 
 bool p3BanList::ipFilteringEnabled() { return mIPFilteringEnabled ; }
-void p3BanList::enableIPFiltering(bool b) { mIPFilteringEnabled = b ; }
-void p3BanList::enableIPsFromFriends(bool b) { mIPFriendGatheringEnabled = b; mLastDhtInfoRequest=0;}
-void p3BanList::enableIPsFromDHT(bool b)
+void p3BanList::enableIPFiltering(bool b)
 {
-    mIPDHTGatheringEnabled = b;
+    RS_STACK_MUTEX(mBanMtx) ;
+    mIPFilteringEnabled = b ;
+    updateSnapshot_locked() ;
+}
+void p3BanList::enableIPsFromFriends(bool b)
+{
+    RS_STACK_MUTEX(mBanMtx) ;
+    mIPFriendGatheringEnabled = b;
     mLastDhtInfoRequest=0;
+    updateSnapshot_locked() ;
+}
+void p3BanList::enableIPsFromDHT(bool b)
+{
+    {
+        RS_STACK_MUTEX(mBanMtx) ;
+        mIPDHTGatheringEnabled = b;
+        mLastDhtInfoRequest=0;
+        updateSnapshot_locked() ;
+    }
 
     IndicateConfigChanged();
 }
 void p3BanList::enableAutoRange(bool b)
 {
-    mAutoRangeIps = b;
+    {
+        RS_STACK_MUTEX(mBanMtx) ;
+        mAutoRangeIps = b;
+    }
     autoFigureOutBanRanges() ;
 
     IndicateConfigChanged();
 }
 void p3BanList::setAutoRangeLimit(int n)
 {
-    mAutoRangeLimit = n;
+    {
+        RS_STACK_MUTEX(mBanMtx) ;
+        mAutoRangeLimit = n;
+    }
     autoFigureOutBanRanges();
 
     IndicateConfigChanged();
@@ -214,7 +238,11 @@ void p3BanList::autoFigureOutBanRanges()
 
     IndicateConfigChanged();
 
-	if(!mAutoRangeIps) return;
+	if(!mAutoRangeIps)
+	{
+		updateSnapshot_locked() ;	// removed ranges must not be rejected anymore
+		return;
+	}
 
 #ifdef DEBUG_BANLIST
     std::cerr << "Automatically figuring out IP ranges from banned IPs." << std::endl;
@@ -313,33 +341,34 @@ bool p3BanList::isAddressAccepted(
 {
 	check_result = RSBANLIST_CHECK_RESULT_NOCHECK;
 
+	// No locking here, this is called for each incoming connection and DHT
+	// message. The snapshot is replaced as a whole when the lists change.
+	std::shared_ptr<const BanListSnapshot> snapshot = std::atomic_load(&mSnapshot);
+	uint32_t index;
+
 	sockaddr_storage addr; sockaddr_storage_copy(dAddr, addr);
 
-	if(!sockaddr_storage_ipv6_to_ipv4(addr)) return true;
+	if(!sockaddr_storage_ipv6_to_ipv4(addr))
+	{
+		// Only blocklist files hold IPv6 ranges
+		if( snapshot->mFilteringEnabled && snapshot->mBlocklists &&
+		        (checking_flags & RSBANLIST_CHECKING_FLAGS_BLACKLIST) &&
+		        snapshot->mBlocklists->lookup(addr, index) )
+		{
+			check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
+			return false;
+		}
+		return true;
+	}
 	if(sockaddr_storage_isLoopbackNet(addr)) return true;
 
-
-	RS_STACK_MUTEX(mBanMtx);
-
-	if(!mIPFilteringEnabled) return true;
+	if(!snapshot->mFilteringEnabled) return true;
 
 #ifdef DEBUG_BANLIST
     std::cerr << "isAddressAccepted(): tested addr=" << sockaddr_storage_iptostring(addr) << ", checking flags=" << checking_flags ;
 #endif
 
-    // we should normally work this including entire ranges of IPs. For now, just check the exact IPs.
-
-    sockaddr_storage addr_32 = makeBitsRange(addr,0) ;	// this is necessay because it cleans the address
-    sockaddr_storage addr_24 = makeBitsRange(addr,1) ;
-    sockaddr_storage addr_16 = makeBitsRange(addr,2) ;
-
-    bool white_list_found = false ;
-
-    white_list_found = white_list_found || (mWhiteListedRanges.find(addr_16) != mWhiteListedRanges.end()) ;
-    white_list_found = white_list_found || (mWhiteListedRanges.find(addr_24) != mWhiteListedRanges.end()) ;
-    white_list_found = white_list_found || (mWhiteListedRanges.find(addr_32) != mWhiteListedRanges.end()) ;
-
-    if(white_list_found)
+    if(snapshot->mWhiteList.lookup(addr, index))
 	{
 		check_result = RSBANLIST_CHECK_RESULT_ACCEPTED;
 #ifdef DEBUG_BANLIST
@@ -366,47 +395,24 @@ bool p3BanList::isAddressAccepted(
         return true;
     }
 
-    std::map<sockaddr_storage,BanListPeer>::iterator it ;
-
-    if(((it=mBanRanges.find(addr_16)) != mBanRanges.end()) && acceptedBanRanges_locked(it->second))
+    if(snapshot->mBlackList.lookup(addr, index))
     {
-        ++it->second.connect_attempts;
-#ifdef DEBUG_BANLIST
-      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(it->first) << "/16. returning false. attempts=" << it->second.connect_attempts << std::endl;
-#endif
-	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-      return false ;
-  }
-
-  if(((it=mBanRanges.find(addr_24)) != mBanRanges.end()) && acceptedBanRanges_locked(it->second))
-  {
-      ++it->second.connect_attempts;
+        ++snapshot->mHits[index];
 #ifdef DEBUG_BANLIST
-      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(it->first) << "/24.  returning false. attempts=" << it->second.connect_attempts << std::endl;
-#endif
-	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-      return false ;
-  }
-
-  if(((it=mBanRanges.find(addr_32)) != mBanRanges.end()) && acceptedBanRanges_locked(it->second))
-  {
-      ++it->second.connect_attempts;
-#ifdef DEBUG_BANLIST
-      std::cerr << " found in blacklisted range " << sockaddr_storage_iptostring(it->first) << "/32.  returning false. attempts=" << it->second.connect_attempts << std::endl;
+      std::cerr << " found in blacklist as " << sockaddr_storage_iptostring(snapshot->mEntries[index].key) << ". returning false." << std::endl;
 #endif
 	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
         return false ;
     }
 
-    if((it=mBanSet.find(addr_32)) != mBanSet.end() && acceptedBanSet_locked(it->second))
+    if(snapshot->mBlocklists && snapshot->mBlocklists->lookup(addr, index))
     {
-        ++it->second.connect_attempts;
 #ifdef DEBUG_BANLIST
-      std::cerr << "found as blacklisted address " << sockaddr_storage_iptostring(it->first) << ".  returning false. attempts=" << it->second.connect_attempts << std::endl;
+      std::cerr << " found in blocklist files. returning false." << std::endl;
 #endif
 	    check_result = RSBANLIST_CHECK_RESULT_BLACKLISTED;
-      return false ;
-  }
+        return false ;
+    }
 
 #ifdef DEBUG_BANLIST
   std::cerr << " not blacklisted. Accepting." << std::endl;
@@ -415,6 +421,72 @@ bool p3BanList::isAddressAccepted(
     return true ;
 }
 
+bool p3BanList::isIpAccepted(
+        const std::string& address, uint32_t checkingFlags,
+        uint32_t& checkResult )
+{
+	sockaddr_storage addr;
+	if(!sockaddr_storage_inet_pton(addr, address))
+	{
+		checkResult = RSBANLIST_CHECK_RESULT_UNKNOWN;
+		return false;
+	}
+	return isAddressAccepted(addr, checkingFlags, checkResult);
+}
+
+void p3BanList::updateSnapshot_locked()
+{
+    collectConnectAttempts_locked() ;
+
+    std::shared_ptr<BanListSnapshot> snapshot = std::make_shared<BanListSnapshot>(mIPFilteringEnabled) ;
+    RsIpPrefix prefix ;
+
+    for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mWhiteListedRanges.begin());it!=mWhiteListedRanges.end();++it)
+        if(prefix.set(it->first, 32 - 8*it->second.masked_bytes))
+            snapshot->mWhiteList.insert(prefix, 0) ;
+
+    // Ranges go last, so that they win over a banned IP with the same key
+
+    for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mBanSet.begin());it!=mBanSet.end();++it)
+        if(acceptedBanSet_locked(it->second) && prefix.set(it->first, 32))
+        {
+            snapshot->mBlackList.insert(prefix, snapshot->mEntries.size()) ;
+            snapshot->mEntries.push_back(BanListSnapshot::Entry{it->first, false}) ;
+        }
+
+    for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mBanRanges.begin());it!=mBanRanges.end();++it)
+        if(acceptedBanRanges_locked(it->second) && prefix.set(it->first, 32 - 8*it->second.masked_bytes))
+        {
+            snapshot->mBlackList.insert(prefix, snapshot->mEntries.size()) ;
+            snapshot->mEntries.push_back(BanListSnapshot::Entry{it->first, true}) ;
+        }
+
+    snapshot->mHits.reset(new std::atomic<uint32_t>[snapshot->mEntries.size()]()) ;
+    snapshot->mBlocklists = mBlocklists ;
+
+    std::atomic_store(&mSnapshot, std::shared_ptr<const BanListSnapshot>(snapshot)) ;
+}
+
+void p3BanList::collectConnectAttempts_locked()
+{
+    std::shared_ptr<const BanListSnapshot> snapshot = std::atomic_load(&mSnapshot) ;
+
+    for(size_t i=0;i<snapshot->mEntries.size();++i)
+    {
+        uint32_t n = snapshot->mHits[i].exchange(0) ;
+
+        if(n == 0)
+            continue ;
+
+        const BanListSnapshot::Entry& e(snapshot->mEntries[i]) ;
+        std::map<sockaddr_storage,BanListPeer>& banlist(e.range ? mBanRanges : mBanSet) ;
+        std::map<sockaddr_storage,BanListPeer>::iterator it = banlist.find(e.key) ;
+
+        if(it != banlist.end())
+            it->second.connect_attempts += n ;
+    }
+}
+
 void p3BanList::getWhiteListedIps(std::list<BanListPeer> &lst)
 {
     RS_STACK_MUTEX(mBanMtx) ;
@@ -427,6 +499,7 @@ void p3BanList::getBannedIps(std::list<BanListPeer> &lst)
 {
     RS_STACK_MUTEX(mBanMtx) ;
 
+    collectConnectAttempts_locked() ;
 
     lst.clear() ;
     for(std::map<sockaddr_storage,BanListPeer>::const_iterator it(mBanSet.begin());it!=mBanSet.end();++it)
@@ -562,6 +635,9 @@ int p3BanList::tick()
     processIncoming();
     sendPackets();
 
+    if(mBlocklistFilesToLoad)
+        loadBlocklistFiles() ;
+
     rstime_t now = time(NULL) ;
 
     if(mLastDhtInfoRequest + RSBANLIST_DELAY_BETWEEN_TALK_TO_DHT < now)
@@ -813,6 +889,13 @@ bool p3BanList::saveList(bool &cleanup, std::list<RsItem*>& itemlist)
     kv.value = os.str() ;
     vitem->tlvkvs.pairs.push_back(kv) ;
 
+    for(std::map<std::string,std::vector<RsIpPrefix> >::const_iterator it(mBlocklistFiles.begin());it!=mBlocklistFiles.end();++it)
+    {
+        kv.key = "IP_FILTERING_BLOCKLIST_FILE" ;
+        kv.value = it->first ;
+        vitem->tlvkvs.pairs.push_back(kv) ;
+    }
+
     itemlist.push_back(vitem) ;
 
     return true ;
@@ -834,6 +917,13 @@ bool p3BanList::loadList(std::list<RsItem*>& load)
                 if(it2->key == "IP_FILTERING_FRIEND_GATHERING_ENABLED") mIPFriendGatheringEnabled = (it2->value=="TRUE") ;
                 if(it2->key == "IP_FILTERING_DHT_GATHERING_ENABLED") mIPDHTGatheringEnabled = (it2->value=="TRUE") ;
 
+                // Files are read by tick(), not to slow down the start
+                if(it2->key == "IP_FILTERING_BLOCKLIST_FILE")
+                {
+                    mBlocklistFiles[it2->value].clear() ;
+                    mBlocklistFilesToLoad = true ;
+                }
+
                 if(it2->key == "IP_FILTERING_AUTORANGE_IPS_LIMIT")
         {
             int val ;
@@ -906,9 +996,116 @@ bool p3BanList::loadList(std::list<RsItem*>& load)
     }
 
     load.clear() ;
+    updateSnapshot_locked() ;
+    return true ;
+}
+
+bool p3BanList::addBlocklistFile(const std::string& path, uint32_t& ranges)
+{
+    // Big files take a while to read, don't hold the lock meanwhile
+
+    std::vector<RsIpPrefix> prefixes ;
+    uint32_t bad_lines = 0 ;
+
+    if(!rsLoadIpBlocklist(path, prefixes, bad_lines))
+    {
+        std::cerr << "(EE) Cannot read blocklist file " << path << std::endl;
+        return false ;
+    }
+    if(bad_lines > 0)
+        std::cerr << "(WW) Blocklist file " << path << ": ignored " << bad_lines << " lines that could not be parsed." << std::endl;
+
+    ranges = prefixes.size() ;
+
+    RS_STACK_MUTEX(mBanMtx) ;
+
+    mBlocklistFiles[path].swap(prefixes) ;
+    updateBlocklists_locked() ;
+
+    IndicateConfigChanged() ;
+    return true ;
+}
+
+bool p3BanList::removeBlocklistFile(const std::string& path)
+{
+    RS_STACK_MUTEX(mBanMtx) ;
+
+    if(mBlocklistFiles.erase(path) == 0)
+        return false ;
+
+    updateBlocklists_locked() ;
+
+    IndicateConfigChanged() ;
     return true ;
 }
 
+void p3BanList::getBlocklistFiles(std::list<std::string>& paths)
+{
+    RS_STACK_MUTEX(mBanMtx) ;
+
+    paths.clear() ;
+    for(std::map<std::string,std::vector<RsIpPrefix> >::const_iterator it(mBlocklistFiles.begin());it!=mBlocklistFiles.end();++it)
+        paths.push_back(it->first) ;
+}
+
+void p3BanList::loadBlocklistFiles()
+{
+    std::list<std::string> paths ;
+    {
+        RS_STACK_MUTEX(mBanMtx) ;
+
+        for(std::map<std::string,std::vector<RsIpPrefix> >::const_iterator it(mBlocklistFiles.begin());it!=mBlocklistFiles.end();++it)
+            paths.push_back(it->first) ;
+
+        mBlocklistFilesToLoad = false ;
+    }
+
+    std::map<std::string,std::vector<RsIpPrefix> > files ;
+
+    for(std::list<std::string>::const_iterator it(paths.begin());it!=paths.end();++it)
+    {
+        uint32_t bad_lines = 0 ;
+
+        // A missing file is kept in the list, it may be on a drive not mounted yet
+        if(!rsLoadIpBlocklist(*it, files[*it], bad_lines))
+            std::cerr << "(WW) Cannot read blocklist file " << *it << std::endl;
+    }
+
+    RS_STACK_MUTEX(mBanMtx) ;
+
+    // Files removed in the meantime are not added back
+    for(std::map<std::string,std::vector<RsIpPrefix> >::iterator it(files.begin());it!=files.end();++it)
+    {
+        std::map<std::string,std::vector<RsIpPrefix> >::iterator found = mBlocklistFiles.find(it->first) ;
+
+        if(found != mBlocklistFiles.end() && found->second.empty())
+            found->second.swap(it->second) ;
+    }
+
+    updateBlocklists_locked() ;
+}
+
+void p3BanList::updateBlocklists_locked()
+{
+    std::shared_ptr<RsIpPrefixTrie> trie ;
+
+    for(std::map<std::string,std::vector<RsIpPrefix> >::const_iterator it(mBlocklistFiles.begin());it!=mBlocklistFiles.end();++it)
+        for(size_t i=0;i<it->second.size();++i)
+        {
+            if(!trie)
+                trie = std::make_shared<RsIpPrefixTrie>() ;
+
+            trie->insert(it->second[i], 0) ;
+        }
+
+#ifdef DEBUG_BANLIST
+    std::cerr << "p3BanList: " << (trie ? trie->size() : 0) << " ranges in " << mBlocklistFiles.size() << " blocklist files." << std::endl;
+#endif
+
+    mBlocklists = trie ;
+    updateSnapshot_locked() ;
+}
+
 bool p3BanList::addBanEntry( const RsPeerId &peerId,
                              const sockaddr_storage &dAddr,
                              int level, uint32_t reason, rstime_t time_stamp )
@@ -1028,6 +1225,7 @@ bool p3BanList::isWhiteListed_locked(const sockaddr_storage& addr)
 
 int p3BanList::condenseBanSources_locked()
 {
+    collectConnectAttempts_locked() ;
         mBanSet.clear();
 
     rstime_t now = time(NULL);
@@ -1139,6 +1337,7 @@ int p3BanList::condenseBanSources_locked()
 	printBanSet_locked(std::cerr);
 #endif
 
+	updateSnapshot_locked() ;
 	return true ;
 }
 
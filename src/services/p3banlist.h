@@ -22,13 +22,17 @@
 #ifndef SERVICE_RSBANLIST_HEADER
 #define SERVICE_RSBANLIST_HEADER
 
+#include <atomic>
 #include <string>
 #include <list>
 #include <map>
+#include <memory>
+#include <vector>
 
 #include "rsitems/rsbanlistitems.h"
 #include "services/p3service.h"
 #include "retroshare/rsbanlist.h"
+#include "util/rsiptrie.h"
 
 class p3ServiceControl;
 class p3NetMgr;
@@ -42,11 +46,39 @@ class BanList
 	std::map<struct sockaddr_storage, BanListPeer> mBanPeers;
 };
 
+/**
+ * Immutable view of the ban lists, as far as accepting an address is
+ * concerned. p3BanList publishes a new one each time the lists or the
+ * settings change, so that addresses are checked without locking.
+ */
+class BanListSnapshot
+{
+public:
+	explicit BanListSnapshot(bool filteringEnabled) :
+	    mFilteringEnabled(filteringEnabled) {}
+
+	struct Entry
+	{
+		sockaddr_storage key;	/// in mBanRanges, or in mBanSet
+		bool range;
+	};
+
+	bool mFilteringEnabled;
+	RsIpPrefixTrie mWhiteList;
+	RsIpPrefixTrie mBlackList;	/// value is the index in mEntries and mHits
+	std::vector<Entry> mEntries;
+	std::unique_ptr<std::atomic<uint32_t>[]> mHits; /// connect attempts since published
+
+	/// Ranges of the blocklist files, shared by the snapshots
+	std::shared_ptr<const RsIpPrefixTrie> mBlocklists;
+};
+
 /**
  * The RS BanList service.
  * Exchange list of Banned IPv4 addresses with peers.
+ * External blocklist files can add IPv4 and IPv6 ranges of any size.
  *
- * @warning IPv4 only, IPv6 not supported yet!
+ * @warning IPv4 only for ranges set by the user and exchanged with peers!
  */
 class p3BanList: public RsBanList, public p3Service, public pqiNetAssistPeerShare, public p3Config /*, public pqiMonitor */
 {
@@ -62,6 +94,11 @@ public:
 	        uint32_t& check_result = RS_DEFAULT_STORAGE_PARAM(uint32_t)
 	        ) override;
 
+	/// @see RsBanList
+	virtual bool isIpAccepted(
+	        const std::string& address, uint32_t checkingFlags,
+	        uint32_t& checkResult ) override;
+
     virtual void getBannedIps(std::list<BanListPeer>& list) ;
     virtual void getWhiteListedIps(std::list<BanListPeer>& list) ;
 
@@ -85,6 +122,16 @@ public:
     virtual void enableIPsFromDHT(bool b) ;
     virtual bool iPsFromDHTEnabled() { return mIPDHTGatheringEnabled ;}
 
+	/// @see RsBanList
+	virtual bool addBlocklistFile(
+	        const std::string& path, uint32_t& ranges ) override;
+
+	/// @see RsBanList
+	virtual bool removeBlocklistFile(const std::string& path) override;
+
+	/// @see RsBanList
+	virtual void getBlocklistFiles(std::list<std::string>& paths) override;
+
     /***** overloaded from pqiNetAssistPeerShare *****/
 
 	virtual void updatePeer( const RsPeerId& id, const sockaddr_storage &addr,
@@ -144,6 +191,11 @@ private:
     int printBanSet_locked(std::ostream &out);
     bool isWhiteListed_locked(const sockaddr_storage &addr);
 
+    void updateSnapshot_locked();
+    void collectConnectAttempts_locked();
+    void loadBlocklistFiles();
+    void updateBlocklists_locked();
+
     p3ServiceControl *mServiceCtrl;
     //p3NetMgr *mNetMgr;
     rstime_t mSentListTime;
@@ -152,6 +204,14 @@ private:
     std::map<struct sockaddr_storage, BanListPeer> mBanRanges;
     std::map<struct sockaddr_storage, BanListPeer> mWhiteListedRanges;
 
+	/// Accessed with std::atomic_load/atomic_store only
+	std::shared_ptr<const BanListSnapshot> mSnapshot;
+
+	/// Ranges read from each blocklist file, empty until read
+	std::map<std::string, std::vector<RsIpPrefix> > mBlocklistFiles;
+	std::shared_ptr<const RsIpPrefixTrie> mBlocklists;
+	bool mBlocklistFilesToLoad;
+
     rstime_t mLastDhtInfoRequest ;
 
     uint32_t mAutoRangeLimit ;
@@ -1257,6 +1257,38 @@ bool p3GxsChannels::getContentSummaries(
 	return res;
 }
 
+bool p3GxsChannels::getContentSummariesPage(
+        const RsGxsGroupId& channelId, uint32_t maxCount,
+        RsGxsMsgPageCursor& cursor, std::vector<RsMsgMetaData>& summaries )
+{
+	uint32_t token;
+	RsTokReqOptions opts;
+	opts.mReqType = GXS_REQUEST_TYPE_MSG_META;
+	opts.mOptions = RS_TOKREQOPT_MSG_THREAD | RS_TOKREQOPT_MSG_LATEST;
+	opts.mMaxCount = maxCount;
+	opts.mPageAfterTs = cursor.mPublishTs;
+	opts.mPageAfterMsgId = cursor.mMsgId;
+
+	std::list<RsGxsGroupId> channelIds;
+	channelIds.push_back(channelId);
+
+	if( !requestMsgInfo(token, opts, channelIds) ||
+	        waitToken(token, std::chrono::seconds(5)) != RsTokenService::COMPLETE )
+		return false;
+
+	GxsMsgMetaMap metaMap;
+	bool res = RsGenExchange::getMsgMeta(token, metaMap);
+	summaries = metaMap[channelId];
+
+	if(!summaries.empty())
+	{
+		cursor.mPublishTs = summaries.back().mPublishTs;
+		cursor.mMsgId = summaries.back().mMsgId;
+	}
+
+	return res;
+}
+
 template<class T> void sortPostMetas(std::vector<T>& posts,
                                      const std::function< RsMsgMetaData& (T&) > get_meta,
                                      std::map<RsGxsMessageId,std::pair<uint32_t,std::set<RsGxsMessageId> > >& original_versions)
@@ -150,6 +150,11 @@ protected:
                     const RsGxsGroupId& channelId,
                     std::vector<RsMsgMetaData>& summaries ) override;
 
+    /// Implementation of @see RsGxsChannels::getContentSummariesPage
+    bool getContentSummariesPage(
+            const RsGxsGroupId& channelId, uint32_t maxCount,
+            RsGxsMsgPageCursor& cursor, std::vector<RsMsgMetaData>& summaries ) override;
+
     /// Implementation of @see RsGxsChannels::getChannelGroupStatistics
     bool getChannelGroupStatistics(const RsGxsGroupId& channelId,GxsGroupStatistic& stat) override;
 
@@ -884,6 +884,37 @@ bool p3GxsForums::getForumMsgMetaData(const RsGxsGroupId& forumId, std::vector<R
     return res;
 }
 
+bool p3GxsForums::getForumMsgMetaDataPage(
+        const RsGxsGroupId& forumId, bool onlyThreads, uint32_t maxCount,
+        RsGxsMsgPageCursor& cursor, std::vector<RsMsgMetaData>& msgMetas )
+{
+	uint32_t token;
+	RsTokReqOptions opts;
+	opts.mReqType = GXS_REQUEST_TYPE_MSG_META;
+	opts.mOptions = onlyThreads ? RS_TOKREQOPT_MSG_THREAD : 0;
+	opts.mMaxCount = maxCount;
+	opts.mPageAfterTs = cursor.mPublishTs;
+	opts.mPageAfterMsgId = cursor.mMsgId;
+
+	std::list<RsGxsGroupId> forumIds;
+	forumIds.push_back(forumId);
+
+	if( !requestMsgInfo(token, opts, forumIds) || waitToken(token,std::chrono::milliseconds(5000)) != RsTokenService::COMPLETE ) return false;
+
+	GxsMsgMetaMap meta_map;
+	bool res = getMsgMetaData(token, meta_map);
+
+	msgMetas = meta_map[forumId];
+
+	if(!msgMetas.empty())
+	{
+		cursor.mPublishTs = msgMetas.back().mPublishTs;
+		cursor.mMsgId = msgMetas.back().mMsgId;
+	}
+
+	return res;
+}
+
 bool p3GxsForums::markRead(const RsGxsGrpMsgIdPair& msgId, bool read)
 {
 	uint32_t token;
@@ -111,6 +111,11 @@ public:
 	/// @see RsGxsForums::getForumMsgMetaData
     virtual bool getForumMsgMetaData(const RsGxsGroupId& forumId, std::vector<RsMsgMetaData>& msg_metas)  override;
 
+	/// @see RsGxsForums::getForumMsgMetaDataPage
+	bool getForumMsgMetaDataPage(
+	        const RsGxsGroupId& forumId, bool onlyThreads, uint32_t maxCount,
+	        RsGxsMsgPageCursor& cursor, std::vector<RsMsgMetaData>& msgMetas ) override;
+
     /// @see RsGxsForums::getForumPostsHierarchy
     virtual bool getForumPostsHierarchy(const RsGxsForumGroup& group,
                                         std::vector<ForumPostEntry>& vect,
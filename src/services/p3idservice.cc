@@ -27,6 +27,8 @@
 #include <algorithm>
 #include <sstream>
 #include <cstdio>
+#include <cstring>
+#include <chrono>
 
 #include "services/p3idservice.h"
 #include "pgp/pgpauxutils.h"
@@ -141,6 +143,9 @@ RsIdentity* rsIdentity = nullptr;
 #define PGPHASH_PERIOD			60
 #define PGPHASH_RETRY_PERIOD		11
 #define PGPHASH_PROC_PERIOD		1
+#define PGPHASH_PROC_MAX_GROUPS		200	// max groups checked per processing round
+#define PGPHASH_PROC_MAX_TIME_MS	100	// max time spent per processing round
+#define PGPHASH_NEGATIVE_CACHE_MAX_SIZE	100000
 
 #define RECOGN_PERIOD			90
 #define RECOGN_RETRY_PERIOD		17
@@ -167,6 +172,7 @@ p3IdService::p3IdService( RsGeneralDataService *gds
     , mLastConfigUpdate(0), mOwnIdsLoaded(false)
     , mAutoAddFriendsIdentitiesAsContacts(true) /*default*/
     , mMaxKeepKeysBanned(MAX_KEEP_KEYS_BANNED_DEFAULT)
+    , mPgpKeySetGeneration(0)
 {
 	mLastKeyCleaningTime = time(NULL) - int(MAX_DELAY_BEFORE_CLEANING * 0.9) ;
     mLastPGPHashProcessTime = 0;
@@ -373,6 +379,10 @@ bool p3IdService::loadList(std::list<RsItem*>& items)
                 mKeysTS[it2->first].TS = it2->second;
 
             mContacts = lii->mContacts ;
+
+            mPgpKeySetGeneration  = lii->mPgpKeySetGeneration ;
+            mPgpKeyGenerations    = lii->mPgpKeyGenerations ;
+            mPgpHashNegativeCache = lii->mPgpHashNegativeCache ;
         }
 
 	    RsConfigKeyValueSet *vitem = dynamic_cast<RsConfigKeyValueSet *>(*it);
@@ -446,6 +456,10 @@ bool p3IdService::saveList(bool& cleanup,std::list<RsItem*>& items)
 
     item->mContacts = mContacts ;
 
+    item->mPgpKeySetGeneration  = mPgpKeySetGeneration ;
+    item->mPgpKeyGenerations    = mPgpKeyGenerations ;
+    item->mPgpHashNegativeCache = mPgpHashNegativeCache ;
+
     items.push_back(item) ;
 
     RsConfigKeyValueSet *vitem = new RsConfigKeyValueSet ;
@@ -3874,6 +3888,20 @@ bool p3IdService::pgphash_load_group_data(uint32_t token)
 }
 
 bool p3IdService::pgphash_process()
+{
+    /* each time this is called - process a batch of Ids from mGroupsToProcess,
+     * bounded both in number and in time so that the service keeps ticking. */
+
+    auto start = std::chrono::steady_clock::now();
+
+    for(uint32_t n=0;n<PGPHASH_PROC_MAX_GROUPS;++n)
+        if(!pgphash_process_one() || std::chrono::steady_clock::now() - start > std::chrono::milliseconds(PGPHASH_PROC_MAX_TIME_MS))
+            break;
+
+    return true;
+}
+
+bool p3IdService::pgphash_process_one()
 {
     /* each time this is called - process one Id from mGroupsToProcess */
 	RsGxsIdGroup pg;
@@ -3902,7 +3930,7 @@ bool p3IdService::pgphash_process()
 #endif // DEBUG_IDS
 		// FINISHED.
 		CacheArbitrationDone(BG_PGPHASH);
-		return true;
+		return false;
 	}
 
 
@@ -4030,31 +4058,17 @@ bool p3IdService::checkId(const RsGxsIdGroup &grp, RsPgpId &pgpId,bool& error)
     }
     else
     {
-        RsStackMutex stack(mIdMtx); /********** STACK LOCKED MTX ******/
-
 #ifdef DEBUG_IDS
         std::cerr << "Bruteforcing PGP hash from GxsId mPgpHash: " << grp.mPgpIdHash << std::endl;
 #endif
-        for(auto mit = mPgpFingerprintMap.begin(); mit != mPgpFingerprintMap.end(); ++mit)
+        if(!pgphash_bruteforce(grp, pgpId, pgp_fingerprint))
         {
-            calcPGPHash(RsGxsId(grp.mMeta.mGroupId), mit->second, hash);
-
-            std::cerr << "   profile key " << mit->first << " (" << mit->second << ") : ";
-
-            if (grp.mPgpIdHash == hash)
-            {
-#ifdef DEBUG_IDS
-                std::cerr << "MATCH!" << std::endl;
-#endif
-                pgpId = mit->first;
-                pgp_fingerprint = mit->second;
-                break;
-            }
-#ifdef DEBUG_IDS
-            else
-                std::cerr << "fails" << std::endl;
-#endif
+            // No known key matches. This is not a signature error: the key
+            // may simply not be known yet, so the id stays non verified.
+            error = false;
+            return false;
         }
+        hash = grp.mPgpIdHash;
     }
 
     // Look for the PGP id given by the signature
@@ -4081,6 +4095,84 @@ bool p3IdService::checkId(const RsGxsIdGroup &grp, RsPgpId &pgpId,bool& error)
     }
 }
 
+// Looks for the PGP key whose fingerprint hashes to grp.mPgpIdHash. Only keys
+// that appeared after the last failed attempt for that hash are tested, and
+// hashing is done outside of mIdMtx.
+
+bool p3IdService::pgphash_bruteforce(const RsGxsIdGroup &grp, RsPgpId &pgpId, RsPgpFingerprint& fingerprint)
+{
+    std::vector<std::pair<RsPgpId,RsPgpFingerprint> > candidates;
+    uint32_t generation;
+
+    {
+        RsStackMutex stack(mIdMtx); /********** STACK LOCKED MTX ******/
+
+        generation = mPgpKeySetGeneration;
+        uint32_t tested_generation = 0;
+
+        auto cit = mPgpHashNegativeCache.find(grp.mPgpIdHash);
+        if(cit != mPgpHashNegativeCache.end())
+            tested_generation = cit->second;
+
+        candidates.reserve(mPgpFingerprintMap.size());
+
+        for(auto mit = mPgpFingerprintMap.begin(); mit != mPgpFingerprintMap.end(); ++mit)
+        {
+            auto git = mPgpKeyGenerations.find(mit->first);
+
+            if(cit == mPgpHashNegativeCache.end() || git == mPgpKeyGenerations.end() || git->second > tested_generation)
+                candidates.push_back(*mit);
+        }
+    }
+
+#ifdef DEBUG_IDS
+    std::cerr << "  testing " << candidates.size() << " candidate keys." << std::endl;
+#endif
+
+    // The GxsId prefix is fed to SHA1 only once, then the context is copied for each key.
+
+    std::string id_str = RsGxsId(grp.mMeta.mGroupId).toStdString(); // same as calcPGPHash(). TO FIX ONE DAY.
+    SHA_CTX id_ctx;
+    SHA1_Init(&id_ctx);
+    SHA1_Update(&id_ctx, id_str.c_str(), id_str.length());
+
+    bool found = false;
+    unsigned char digest[SHA_DIGEST_LENGTH];
+
+    for(auto it(candidates.begin());it!=candidates.end();++it)
+    {
+        SHA_CTX ctx = id_ctx;
+        SHA1_Update(&ctx, it->second.toByteArray(), it->second.SIZE_IN_BYTES);
+        SHA1_Final(digest, &ctx);
+
+        if(!memcmp(digest, grp.mPgpIdHash.toByteArray(), SHA_DIGEST_LENGTH))
+        {
+#ifdef DEBUG_IDS
+            std::cerr << "   profile key " << it->first << " (" << it->second << ") : MATCH!" << std::endl;
+#endif
+            pgpId = it->first;
+            fingerprint = it->second;
+            found = true;
+            break;
+        }
+    }
+
+    RsStackMutex stack(mIdMtx); /********** STACK LOCKED MTX ******/
+
+    if(found)
+        mPgpHashNegativeCache.erase(grp.mPgpIdHash);
+    else
+    {
+        if(mPgpHashNegativeCache.size() >= PGPHASH_NEGATIVE_CACHE_MAX_SIZE)
+            mPgpHashNegativeCache.clear();	// rare enough. Everything will be re-tested once.
+
+        mPgpHashNegativeCache[grp.mPgpIdHash] = generation;
+    }
+    slowIndicateConfigChanged();
+
+    return found;
+}
+
 /* worker functions */
 void p3IdService::getPgpIdList()
 {
@@ -4096,6 +4188,10 @@ void p3IdService::getPgpIdList()
 
 	mPgpFingerprintMap.clear();
 
+	std::map<RsPgpId, uint32_t> old_generations;
+	old_generations.swap(mPgpKeyGenerations);
+	bool new_keys = false;
+
  	std::list<RsPgpId>::iterator it;
 	for(it = list.begin(); it != list.end(); ++it)
 	{
@@ -4109,6 +4205,24 @@ void p3IdService::getPgpIdList()
 #endif // DEBUG_IDS
 
 		mPgpFingerprintMap[pgpId] = fp;
+
+		// Keys that were already there keep their generation, new ones get the next one.
+
+		auto git = old_generations.find(pgpId);
+
+		if(git != old_generations.end())
+			mPgpKeyGenerations[pgpId] = git->second;
+		else
+		{
+			mPgpKeyGenerations[pgpId] = mPgpKeySetGeneration + 1;
+			new_keys = true;
+		}
+	}
+
+	if(new_keys)
+	{
+		++mPgpKeySetGeneration;
+		slowIndicateConfigChanged();
 	}
 
 #ifdef DEBUG_IDS
@@ -4122,12 +4236,13 @@ void calcPGPHash(const RsGxsId &id, const PGPFingerprintType &pgp, Sha1CheckSum
 {
 	unsigned char signature[SHA_DIGEST_LENGTH];
 	/* hash id + pubkey => pgphash */
-	SHA_CTX *sha_ctx = new SHA_CTX;
-	SHA1_Init(sha_ctx);
+	SHA_CTX sha_ctx;
+	SHA1_Init(&sha_ctx);
 
-	SHA1_Update(sha_ctx, id.toStdString().c_str(), id.toStdString().length()); // TO FIX ONE DAY.
-	SHA1_Update(sha_ctx, pgp.toByteArray(), pgp.SIZE_IN_BYTES);
-	SHA1_Final(signature, sha_ctx);
+	std::string id_str = id.toStdString(); // TO FIX ONE DAY.
+	SHA1_Update(&sha_ctx, id_str.c_str(), id_str.length());
+	SHA1_Update(&sha_ctx, pgp.toByteArray(), pgp.SIZE_IN_BYTES);
+	SHA1_Final(signature, &sha_ctx);
 	hash = Sha1CheckSum(signature);
 
 #ifdef DEBUG_IDS
@@ -4140,8 +4255,6 @@ void calcPGPHash(const RsGxsId &id, const PGPFingerprintType &pgp, Sha1CheckSum
 	std::cerr << "\tFinal Hash: " << hash.toStdString();
 	std::cerr << std::endl;
 #endif // DEBUG_IDS
-
-	delete sha_ctx;
 }
 
 /************************************************************************************/
@@ -491,8 +491,10 @@ private:
     bool pgphash_load_group_data(uint32_t token);
     bool pgphash_handlerequest(uint32_t token);
 	bool pgphash_process();
+	bool pgphash_process_one();
 
 	bool checkId(const RsGxsIdGroup &grp, RsPgpId &pgp_id, bool &error);
+	bool pgphash_bruteforce(const RsGxsIdGroup &grp, RsPgpId &pgpId, RsPgpFingerprint& fingerprint);
 	void getPgpIdList();
 
 	/* MUTEX PROTECTED DATA (mIdMtx - maybe should use a 2nd?) */
@@ -500,6 +502,14 @@ private:
 	std::map<RsPgpId, RsPgpFingerprint> mPgpFingerprintMap;
     std::map<RsGxsGroupId,RsGxsIdGroup> mGroupsToProcess;
 
+	/* Negative brute-force cache. Each known PGP key is tagged with the key set
+	 * generation at which it first appeared. A mPgpIdHash that failed to match
+	 * at generation G only needs to be tested again against keys newer than G.
+	 * All three are saved in RsGxsIdLocalInfoItem. */
+	uint32_t mPgpKeySetGeneration;
+	std::map<RsPgpId, uint32_t> mPgpKeyGenerations;
+	std::map<Sha1CheckSum, uint32_t> mPgpHashNegativeCache;
+
 	/************************************************************************
  * recogn processing.
  *
@@ -36,28 +36,89 @@
 
 
 
+p3Service::~p3Service()
+{
+	QueuedItem qi;
+
+	while(recv_queue.pop(qi))
+		delete qi.item;
+}
+
 RsItem *p3Service::recvItem()
 {
-	RsStackMutex stack(srvMtx);  /*****   LOCK MUTEX *****/
+	std::list<RsItem *> items;
 
-	if (recv_queue.empty())
+	if (!recvItems(items, 1))
 	{
 		return NULL; /* nothing there! */
 	}
 
-	/* get something off front */
-	RsItem *item = recv_queue.front();
-	recv_queue.pop_front();
-
-	return item;
+	return items.front();
 }
 
 
 bool    p3Service::receivedItems()
 {
-	RsStackMutex stack(srvMtx);  /*****   LOCK MUTEX *****/
+	return recv_depth > 0;
+}
+
+
+uint32_t p3Service::recvItems(std::list<RsItem *>& items, uint32_t max_items)
+{
+	if (recv_depth == 0)
+		return 0;
+
+	RsStackMutex stack(recvMtx);  /*****   LOCK MUTEX *****/
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	uint32_t n = 0;
+	QueuedItem qi;
+
+	while ((max_items == 0 || n < max_items) && recv_queue.pop(qi))
+	{
+		--recv_depth;
+		++n;
+		items.push_back(qi.item);
+
+		int64_t wait_us = std::chrono::duration_cast<std::chrono::microseconds>(now - qi.queued).count();
+		int bucket = 0;
+
+		for(int64_t limit = 100; bucket < RS_SERVICE_QUEUE_WAIT_BUCKETS-1 && wait_us >= limit; limit *= 10)
+			++bucket;
+
+		++recv_wait_histogram[bucket];
+	}
 
-	return (!recv_queue.empty());
+	recv_items += n;
+	return n;
+}
+
+
+bool p3Service::waitForItems(std::chrono::milliseconds timeout)
+{
+	if (recv_depth > 0)
+		return true;
+
+	std::unique_lock<std::mutex> lock(recv_wait_mtx);
+
+	++recv_waiters;
+	bool res = recv_wait_cond.wait_for(lock, timeout, [this]() { return recv_depth > 0; });
+	--recv_waiters;
+
+	return res;
+}
+
+
+void p3Service::getRecvQueueStats(RsServiceQueueStats& stats)
+{
+	RsStackMutex stack(recvMtx);  /*****   LOCK MUTEX *****/
+
+	stats.depth = recv_depth;
+	stats.maxDepth = recv_max_depth;
+	stats.items = recv_items;
+
+	for(int i=0;i<RS_SERVICE_QUEUE_WAIT_BUCKETS;++i)
+		stats.waitHistogram[i] = recv_wait_histogram[i];
 }
 
 
@@ -65,9 +126,30 @@ bool p3Service::recvItem(RsItem *item)
 {
 	if (item)
 	{
-		RsStackMutex stack(srvMtx);  /*****   LOCK MUTEX *****/
+		QueuedItem qi;
+		qi.item = item;
+		qi.queued = std::chrono::steady_clock::now();
+
+		/* counted before being pushed, so that a consumer popping it right
+		 * away never takes recv_depth below 0. It may see recv_depth > 0
+		 * while the queue still looks empty, which only ends its pop loop. */
+		uint32_t depth = ++recv_depth;
+		uint32_t max_depth = recv_max_depth;
+
+		recv_queue.push(qi);
+
+		while(depth > max_depth && !recv_max_depth.compare_exchange_weak(max_depth, depth)) {}
+
+		/* waiters register under recv_wait_mtx before checking recv_depth,
+		 * so either they see the item or we see them */
+		if (recv_waiters > 0)
+		{
+			std::lock_guard<std::mutex> lock(recv_wait_mtx);
+			recv_wait_cond.notify_all();
+		}
 
-		recv_queue.push_back(item);
+		if (depth == 1)
+			itemsAvailable();
 	}
 	return true;
 }
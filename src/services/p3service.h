@@ -22,8 +22,15 @@
 #ifndef P3_GENERIC_SERVICE_HEADER
 #define P3_GENERIC_SERVICE_HEADER
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+
 #include "pqi/pqi.h"
 #include "pqi/pqiservice.h"
+#include "util/rsmpscqueue.h"
 #include "util/rsthreads.h"
 
 /* This provides easy to use extensions to the pqiservice class provided in src/pqi.
@@ -91,24 +98,50 @@ void 	addSerialType(RsSerialType *);
 };
 
 
+/* Incoming queue statistics. Wait times are from recvItem(RsItem*) until
+ * the item is taken by the service, bucket i counting waits shorter than
+ * 10^i * 100 microseconds, the last one the longer waits. */
+#define RS_SERVICE_QUEUE_WAIT_BUCKETS 6
+
+struct RsServiceQueueStats
+{
+	uint32_t depth;
+	uint32_t maxDepth;
+	uint64_t items;
+	uint64_t waitHistogram[RS_SERVICE_QUEUE_WAIT_BUCKETS];
+};
+
 class p3Service: public p3FastService
 {
 	protected:
 
 	p3Service() 
-	:p3FastService()
+	:p3FastService(), recvMtx("p3Service recv"),
+	 recv_depth(0), recv_max_depth(0), recv_waiters(0), recv_items(0)
 	{
+		for(int i=0;i<RS_SERVICE_QUEUE_WAIT_BUCKETS;++i)
+			recv_wait_histogram[i] = 0;
 		return; 
 	}
 
 	public:
 
+virtual ~p3Service();
+
 /*************** INTERFACE ******************************/
         /* called from Thread/tick/GUI */
 //int             sendItem(RsItem *);
 RsItem *        recvItem();
 bool		receivedItems();
 
+	// takes up to max_items items (0 for all) at once. @return number of items appended
+uint32_t	recvItems(std::list<RsItem *>& items, uint32_t max_items = 0);
+
+	// blocks until an item is queued or timeout. @return true if items are queued
+bool		waitForItems(std::chrono::milliseconds timeout);
+
+void		getRecvQueueStats(RsServiceQueueStats& stats);
+
 //virtual int	tick() { return 0; }
 /*************** INTERFACE ******************************/
 
@@ -116,10 +149,34 @@ bool		receivedItems();
 	// overloaded p3FastService interface.
 virtual bool	recvItem(RsItem *item);
 
+	protected:
+	// called by recvItem(RsItem*) when the queue gets an item while empty,
+	// from the receiving thread. Overload to wake up the thread processing the items.
+virtual void	itemsAvailable() {}
+
 	private:
 
-	/* below locked by srvMtx Mutex */
-	std::list<RsItem *> recv_queue;
+	struct QueuedItem
+	{
+		RsItem *item;
+		std::chrono::steady_clock::time_point queued;
+	};
+
+	/* Producers push without locking. The consumer side is locked by recvMtx,
+	 * which is only contended when several threads read the same service. */
+	RsMpscQueue<QueuedItem> recv_queue;
+	RsMutex recvMtx;
+
+	std::atomic<uint32_t> recv_depth;
+	std::atomic<uint32_t> recv_max_depth;
+
+	std::mutex recv_wait_mtx;	/* only used when someone waits for items */
+	std::condition_variable recv_wait_cond;
+	std::atomic<uint32_t> recv_waiters;
+
+	/* below locked by recvMtx */
+	uint64_t recv_items;
+	uint64_t recv_wait_histogram[RS_SERVICE_QUEUE_WAIT_BUCKETS];
 };
 
 
@@ -164,6 +221,10 @@ class p3ThreadedService: public p3Service, public RsTickingThread
 
 virtual ~p3ThreadedService() { return; }
 
+	protected:
+	// ticks the scheduled thread right away. Threads with their own loop can use waitForItems().
+virtual void	itemsAvailable() override { wakeup(); }
+
 	private:
 
 };
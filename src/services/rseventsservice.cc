@@ -50,13 +50,64 @@ const noexcept
 	}
 }
 
+/** Events are delivered if their time point is before now + this */
+static const std::chrono::milliseconds EVENTS_LOOKAHEAD(200);
+
+/** Longest sleep of the service thread with no event */
+static const std::chrono::milliseconds EVENTS_MAX_WAIT(1000);
+
+/** Events kept for a handler that doesn't process them fast enough. The oldest
+ * ones are dropped beyond this */
+static const size_t EVENTS_HANDLER_QUEUE_SIZE = 1000;
+
+/** Events delivered to a handler in a row before letting other jobs run */
+static const uint32_t EVENTS_HANDLER_BATCH_SIZE = 100;
+
+/** Handler jobs are woken up when events are queued, they need no period */
+static const std::chrono::milliseconds EVENTS_HANDLER_JOB_PERIOD(60000);
+
+/** Handler jobs run on their own scheduler, so that handlers blocked in a
+ * callback never hold the workers of GXS and network jobs. Most handlers only
+ * forward events to another thread, so a few workers are enough */
+static const uint32_t EVENTS_HANDLER_WORKERS = 2;
+
+RsEventsService::Handler::Handler(
+        RsEventsHandlerId_t id, const EventCallback& callback ) :
+    mId(id), mCallback(callback), mJob(0), mRemoved(false),
+    mDelivered(0), mCoalesced(0), mDropped(0) {}
+
+RsEventsService::RsEventsService():
+    mHandlerMapMtx("RsEventsService::mHandlerMapMtx"),
+    mLastHandlerId(1)
+{
+	std::shared_ptr<HandlerTable> table = std::make_shared<HandlerTable>();
+	table->mHandlers.resize(static_cast<std::size_t>(RsEventType::__MAX));
+	table->mCoalescing.resize(static_cast<std::size_t>(RsEventType::__MAX));
+	mHandlerTable = table;
+
+	mHandlerScheduler.start(EVENTS_HANDLER_WORKERS);
+}
+
+RsEventsService::~RsEventsService()
+{
+	std::shared_ptr<const HandlerTable> table = handlerTable();
+
+	for(auto& handlers: table->mHandlers)
+		for(auto& hit: handlers)
+			mHandlerScheduler.removeJob(hit.second->mJob);
+}
+
+std::shared_ptr<const RsEventsService::HandlerTable>
+RsEventsService::handlerTable() const
+{ return std::atomic_load(&mHandlerTable); }
+
 std::error_condition RsEventsService::isEventTypeInvalid(RsEventType eventType)
 {
 	if(eventType == RsEventType::__NONE)
 		return RsEventsErrorNum::EVENT_TYPE_UNDEFINED;
 
 	if( eventType < RsEventType::__NONE ||
-            static_cast<uint32_t>(eventType) >= mHandlerMaps.size() )
+            static_cast<uint32_t>(eventType) >= handlerTable()->mHandlers.size() )
 		return RsEventsErrorNum::EVENT_TYPE_OUT_OF_RANGE;
 
 	return std::error_condition();
@@ -74,8 +125,11 @@ std::error_condition RsEventsService::postEvent(
 {
 	if(std::error_condition ec = isEventInvalid(event)) return ec;
 
-	RS_STACK_MUTEX(mEventQueueMtx);
-	mEventQueue.push_back(event);
+	{
+		std::unique_lock<std::mutex> lock(mEventQueueMtx);
+		mEventQueue.push_back(event);
+	}
+	mEventQueueCond.notify_one();
 	return std::error_condition();
 }
 
@@ -83,7 +137,17 @@ std::error_condition RsEventsService::sendEvent(
         std::shared_ptr<const RsEvent> event )
 {
 	if(std::error_condition ec = isEventInvalid(event)) return ec;
-	handleEvent(event);
+
+	/* Handlers are called directly on the caller thread, bypassing their
+	 * queue */
+	std::shared_ptr<const HandlerTable> table = handlerTable();
+
+	for(auto& hit: table->mHandlers[static_cast<uint32_t>(event->mType)])
+		callHandler(*hit.second, event);
+
+	for(auto& hit: table->mHandlers[static_cast<uint32_t>(RsEventType::__NONE)])
+		callHandler(*hit.second, event);
+
 	return std::error_condition();
 }
 
@@ -101,8 +165,13 @@ RsEventType RsEventsService::getDynamicEventType(const std::string& unique_servi
 
     if(it == mRegisteredExtraEventTypes.end())
     {
-        mRegisteredExtraEventTypes[unique_service_identifier] = static_cast<RsEventType>(mHandlerMaps.size());
-        mHandlerMaps.push_back(  std::map<RsEventsHandlerId_t,std::function<void(std::shared_ptr<const RsEvent>)> >());
+        std::shared_ptr<HandlerTable> table = std::make_shared<HandlerTable>(*handlerTable());
+
+        mRegisteredExtraEventTypes[unique_service_identifier] = static_cast<RsEventType>(table->mHandlers.size());
+        table->mHandlers.push_back(std::map<RsEventsHandlerId_t, std::shared_ptr<Handler> >());
+        table->mCoalescing.push_back(CoalescingFunction());
+
+        std::atomic_store(&mHandlerTable, std::shared_ptr<const HandlerTable>(table));
 
         it = mRegisteredExtraEventTypes.find(unique_service_identifier);
 
@@ -122,6 +191,9 @@ std::error_condition RsEventsService::registerEventsHandler(
         std::function<void(std::shared_ptr<const RsEvent>)> multiCallback,
         RsEventsHandlerId_t& hId, RsEventType eventType )
 {
+	std::shared_ptr<Handler> replaced;
+
+	{
 	RS_STACK_MUTEX(mHandlerMapMtx);
 
 	if(eventType != RsEventType::__NONE)
@@ -143,82 +215,233 @@ std::error_condition RsEventsService::registerEventsHandler(
         RsWarn() << "Overriding an existing error handler ID with a new callback. This is very unexpected. Make sure you know what you are doing." ;
     }
 
-	mHandlerMaps[static_cast<std::size_t>(eventType)][hId] = multiCallback;
+	std::shared_ptr<Handler> handler = std::make_shared<Handler>(hId, multiCallback);
+	std::weak_ptr<Handler> weakHandler(handler);
+
+	/* The handler is published after its job is created, so its events
+	 * always have a job to deliver them */
+	handler->mJob = mHandlerScheduler.addJob(
+	            "events handler " + std::to_string(hId),
+	            [this, weakHandler]()
+	{
+		std::shared_ptr<Handler> h = weakHandler.lock();
+		if(h) deliverQueuedEvents(*h);
+	}, EVENTS_HANDLER_JOB_PERIOD );
+
+	std::shared_ptr<HandlerTable> table = std::make_shared<HandlerTable>(*handlerTable());
+	std::shared_ptr<Handler>& slot = table->mHandlers[static_cast<std::size_t>(eventType)][hId];
+	replaced = slot;
+	slot = handler;
+
+	std::atomic_store(&mHandlerTable, std::shared_ptr<const HandlerTable>(table));
+	}
+
+	if(replaced)
+	{
+		{
+			std::lock_guard<std::recursive_mutex> lock(replaced->mCallMtx);
+			replaced->mRemoved = true;
+		}
+		mHandlerScheduler.removeJob(replaced->mJob);
+	}
+
 	return std::error_condition();
 }
 
 std::error_condition RsEventsService::unregisterEventsHandler(
         RsEventsHandlerId_t hId )
 {
+	std::shared_ptr<Handler> removed;
+
+	{
 	RS_STACK_MUTEX(mHandlerMapMtx);
 
-	for(uint32_t i=0; i<mHandlerMaps.size(); ++i)
+	std::shared_ptr<HandlerTable> table = std::make_shared<HandlerTable>(*handlerTable());
+
+	for(uint32_t i=0; i<table->mHandlers.size(); ++i)
 	{
-		auto it = mHandlerMaps[i].find(hId);
-		if(it != mHandlerMaps[i].end())
+		auto it = table->mHandlers[i].find(hId);
+		if(it != table->mHandlers[i].end())
 		{
-			mHandlerMaps[i].erase(it);
-			return std::error_condition();
+			removed = it->second;
+			table->mHandlers[i].erase(it);
+			break;
 		}
 	}
+
+	if(!removed) return RsEventsErrorNum::INVALID_HANDLER_ID;
+
+	std::atomic_store(&mHandlerTable, std::shared_ptr<const HandlerTable>(table));
+	}
+
+	/* Wait for a running call to end, so that the callback is not called
+	 * anymore once we return. Events still queued are dropped. */
+	{
+		std::lock_guard<std::recursive_mutex> lock(removed->mCallMtx);
+		removed->mRemoved = true;
+	}
+	mHandlerScheduler.removeJob(removed->mJob);
+
+	return std::error_condition();
+}
+
+std::error_condition RsEventsService::setEventCoalescing(
+        RsEventType eventType, std::function<bool(const RsEvent&, const RsEvent&)> isSameSubject )
+{
+	RS_STACK_MUTEX(mHandlerMapMtx);
+
+	if(std::error_condition ec = isEventTypeInvalid(eventType))
+		return ec;
+
+	std::shared_ptr<HandlerTable> table = std::make_shared<HandlerTable>(*handlerTable());
+	table->mCoalescing[static_cast<std::size_t>(eventType)] = isSameSubject;
+	std::atomic_store(&mHandlerTable, std::shared_ptr<const HandlerTable>(table));
+
+	return std::error_condition();
+}
+
+std::error_condition RsEventsService::getHandlerStatistics(
+        RsEventsHandlerId_t hId, HandlerStatistics& stats )
+{
+	std::shared_ptr<const HandlerTable> table = handlerTable();
+
+	for(auto& handlers: table->mHandlers)
+	{
+		auto it = handlers.find(hId);
+		if(it == handlers.end()) continue;
+
+		Handler& h(*it->second);
+		std::unique_lock<std::mutex> lock(h.mQueueMtx);
+
+		stats.queued = h.mQueue.size();
+		stats.delivered = h.mDelivered;
+		stats.coalesced = h.mCoalesced;
+		stats.dropped = h.mDropped;
+		return std::error_condition();
+	}
 	return RsEventsErrorNum::INVALID_HANDLER_ID;
 }
 
 void RsEventsService::threadTick()
 {
-	auto nextRunAt = std::chrono::system_clock::now() +
-	        std::chrono::milliseconds(200);
-
-	std::shared_ptr<const RsEvent> eventPtr(nullptr);
-	size_t futureEventsCounter = 0;
+	std::deque< std::shared_ptr<const RsEvent> > events;
 
-dispatchEventFromQueueLock:
-	mEventQueueMtx.lock();
-	if(mEventQueue.size() > futureEventsCounter)
 	{
-		eventPtr = mEventQueue.front();
-		mEventQueue.pop_front();
+		std::unique_lock<std::mutex> lock(mEventQueueMtx);
 
-		if(eventPtr->mTimePoint >= nextRunAt)
-		{
-			mEventQueue.push_back(eventPtr);
-			++futureEventsCounter;
-		}
+		auto wakeAt = std::chrono::system_clock::now() + EVENTS_MAX_WAIT;
+		if(!mFutureEvents.empty() && mFutureEvents.begin()->first - EVENTS_LOOKAHEAD < wakeAt)
+			wakeAt = mFutureEvents.begin()->first - EVENTS_LOOKAHEAD;
+
+		mEventQueueCond.wait_until(lock, wakeAt, [this]()
+		{ return !mEventQueue.empty() || shouldStop(); });
+
+		events.swap(mEventQueue);
 	}
-	mEventQueueMtx.unlock();
 
-	if(eventPtr)
+	auto deliverBefore = std::chrono::system_clock::now() + EVENTS_LOOKAHEAD;
+
+	for(auto& event: events)
+		if(event->mTimePoint >= deliverBefore)
+			mFutureEvents.insert(std::make_pair(event->mTimePoint, event));
+		else
+			dispatchEvent(event);
+
+	while(!mFutureEvents.empty() && mFutureEvents.begin()->first < deliverBefore)
 	{
-		/* It is relevant that this stays out of mEventQueueMtx */
-		handleEvent(eventPtr);
-		eventPtr = nullptr; // ensure refcounter is decremented before sleep
-		goto dispatchEventFromQueueLock;
+		dispatchEvent(mFutureEvents.begin()->second);
+		mFutureEvents.erase(mFutureEvents.begin());
 	}
+}
 
-	std::this_thread::sleep_until(nextRunAt);
+void RsEventsService::onStopRequested()
+{
+	{
+		std::unique_lock<std::mutex> lock(mEventQueueMtx);
+	}
+	mEventQueueCond.notify_all();
 }
 
-void RsEventsService::handleEvent(std::shared_ptr<const RsEvent> event)
+void RsEventsService::dispatchEvent(const std::shared_ptr<const RsEvent>& event)
 {
-	if(std::error_condition ec = isEventInvalid(event))
+	std::shared_ptr<const HandlerTable> table = handlerTable();
+	uint32_t type = static_cast<uint32_t>(event->mType);
+
+	if(type >= table->mHandlers.size())
 	{
-		RsErr() << __PRETTY_FUNCTION__ << " " << ec << std::endl;
+		RsErr() << __PRETTY_FUNCTION__ << " invalid event type " << type << std::endl;
 		print_stacktrace();
 		return;
 	}
 
-	RS_STACK_MUTEX(mHandlerMapMtx);
-	/* It is important to also call the callback under mutex protection to
-	 * ensure they are not unregistered in the meanwhile.
-	 * If a callback try to fiddle with registering/unregistering it will
-	 * deadlock */
-
-	// Call all clients that registered a callback for this event type
-	for(auto cbit: mHandlerMaps[static_cast<uint32_t>(event->mType)])
-		cbit.second(event);
-
-	/* Also call all clients that registered with NONE, meaning that they
-	 * expect all events */
-	for(auto cbit: mHandlerMaps[static_cast<uint32_t>(RsEventType::__NONE)])
-		cbit.second(event);
+	const CoalescingFunction& coalesce(table->mCoalescing[type]);
+
+	/* Call all clients that registered a callback for this event type, and
+	 * those that registered with NONE, meaning that they expect all events */
+	for(uint32_t t: { type, static_cast<uint32_t>(RsEventType::__NONE) })
+		for(auto& hit: table->mHandlers[t])
+		{
+			Handler& h(*hit.second);
+			bool wakeup = false;
+			bool coalesced = false;
+
+			{
+				std::unique_lock<std::mutex> lock(h.mQueueMtx);
+
+				if(coalesce)
+					for(auto qit = h.mQueue.rbegin(); qit != h.mQueue.rend(); ++qit)
+						if((*qit)->mType == event->mType && coalesce(**qit, *event))
+						{
+							*qit = event;
+							++h.mCoalesced;
+							coalesced = true;
+							break;
+						}
+
+				if(!coalesced)
+				{
+					if(h.mQueue.size() >= EVENTS_HANDLER_QUEUE_SIZE)
+					{
+						h.mQueue.pop_front();
+						if(h.mDropped++ % EVENTS_HANDLER_QUEUE_SIZE == 0)
+							RsWarn() << "Events handler " << h.mId << " is too slow, "
+							         << h.mDropped << " events dropped so far" << std::endl;
+					}
+
+					h.mQueue.push_back(event);
+					wakeup = (h.mQueue.size() == 1);
+				}
+			}
+
+			if(wakeup) mHandlerScheduler.wakeup(h.mJob);
+		}
+}
+
+void RsEventsService::deliverQueuedEvents(Handler& handler)
+{
+	for(uint32_t n = 0; n < EVENTS_HANDLER_BATCH_SIZE; ++n)
+	{
+		std::shared_ptr<const RsEvent> event;
+
+		{
+			std::unique_lock<std::mutex> lock(handler.mQueueMtx);
+			if(handler.mQueue.empty()) return;
+
+			event = handler.mQueue.front();
+			handler.mQueue.pop_front();
+			++handler.mDelivered;
+		}
+
+		callHandler(handler, event);
+	}
+
+	/* more to deliver, let other jobs run first */
+	mHandlerScheduler.wakeup(handler.mJob);
+}
+
+void RsEventsService::callHandler(
+        Handler& handler, const std::shared_ptr<const RsEvent>& event )
+{
+	std::lock_guard<std::recursive_mutex> lock(handler.mCallMtx);
+	if(!handler.mRemoved) handler.mCallback(event);
 }
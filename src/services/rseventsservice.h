@@ -26,20 +26,34 @@
 #include <cstdint>
 #include <deque>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include "retroshare/rsevents.h"
+#include "util/rsscheduler.h"
 #include "util/rsthreads.h"
 #include "util/rsdebug.h"
 
+/**
+ * Posted events are queued and dispatched by the service thread, which is
+ * woken up by postEvent(). Each handler has its own bounded queue, delivered
+ * by a job of the service's own RsScheduler, so a slow handler delays only its
+ * own events, and never the jobs of the shared scheduler. A given handler is
+ * never called concurrently with itself, and gets the events in the order they
+ * were posted.
+ * Handlers are kept in a table that is copied when a handler is registered or
+ * unregistered, so that dispatching doesn't lock anything but the queues.
+ */
 class RsEventsService :
         public RsEvents, public RsTickingThread
 {
 public:
-	RsEventsService():
-        mHandlerMapMtx("RsEventsService::mHandlerMapMtx"),
-        mLastHandlerId(1),
-        mHandlerMaps(static_cast<std::size_t>(RsEventType::__MAX)),
-        mEventQueueMtx("RsEventsService::mEventQueueMtx")  {}
+	RsEventsService();
+	~RsEventsService() override;
 
     /// @see RsEvents
 	std::error_condition postEvent(
@@ -65,31 +79,88 @@ public:
 	std::error_condition unregisterEventsHandler(
 	        RsEventsHandlerId_t hId ) override;
 
+	/// @see RsEvents
+	std::error_condition setEventCoalescing(
+	        RsEventType eventType,
+	        std::function<bool(const RsEvent&, const RsEvent&)> isSameSubject ) override;
+
+	struct HandlerStatistics
+	{
+		uint32_t queued;
+		uint64_t delivered;
+		uint64_t coalesced;
+		uint64_t dropped;	/// oldest events dropped because the queue was full
+	};
+
+	std::error_condition getHandlerStatistics(
+	        RsEventsHandlerId_t hId, HandlerStatistics& stats );
+
 protected:
+	typedef std::function<void(std::shared_ptr<const RsEvent>)> EventCallback;
+	typedef std::function<bool(const RsEvent&, const RsEvent&)> CoalescingFunction;
+
+	struct Handler
+	{
+		Handler(RsEventsHandlerId_t id, const EventCallback& callback);
+
+		const RsEventsHandlerId_t mId;
+		const EventCallback mCallback;
+		std::atomic<RsScheduler::JobId> mJob;
+
+		/** Held while calling the callback, so that unregistering waits for
+		 * the call to end. Recursive so that a callback can unregister
+		 * itself */
+		std::recursive_mutex mCallMtx;
+		bool mRemoved;
+
+		std::mutex mQueueMtx;	/// protects the queue and counters
+		std::deque< std::shared_ptr<const RsEvent> > mQueue;
+		uint64_t mDelivered;
+		uint64_t mCoalesced;
+		uint64_t mDropped;
+	};
+
+	struct HandlerTable
+	{
+		/** Handlers by event type, keep 10 extra types for plugins that
+		 * might be released indipendently */
+		std::vector< std::map<RsEventsHandlerId_t, std::shared_ptr<Handler> > > mHandlers;
+		std::vector<CoalescingFunction> mCoalescing;
+	};
+
 	std::error_condition isEventTypeInvalid(RsEventType eventType);
 	std::error_condition isEventInvalid(std::shared_ptr<const RsEvent> event);
 
+	/// Current handler table, only accessed through std::atomic_load/store
+	std::shared_ptr<const HandlerTable> handlerTable() const;
+
+	/// Writers copy the table under mHandlerMapMtx and then replace it
 	RsMutex mHandlerMapMtx;
 	RsEventsHandlerId_t mLastHandlerId;
-
-	/** Storage for event handlers, keep 10 extra types for plugins that might
-	 * be released indipendently */
-    std::vector<
-	    std::map<
-	        RsEventsHandlerId_t,
-            std::function<void(std::shared_ptr<const RsEvent>)> >
-	> mHandlerMaps;
+	std::shared_ptr<const HandlerTable> mHandlerTable;
 
     /** Extra event types registered by plugins */
     std::map<std::string,RsEventType> mRegisteredExtraEventTypes;
 
-	RsMutex mEventQueueMtx;
+	std::mutex mEventQueueMtx;
+	std::condition_variable mEventQueueCond;
 	std::deque< std::shared_ptr<const RsEvent> > mEventQueue;
 
+	/// Events posted with a time point in the future, service thread only
+	std::multimap< std::chrono::system_clock::time_point,
+	               std::shared_ptr<const RsEvent> > mFutureEvents;
+
 	void threadTick() override; /// @see RsTickingThread
+	void onStopRequested() override; /// @see RsThread
 
-	void handleEvent(std::shared_ptr<const RsEvent> event);
+	/// Queue the event for every handler interested
+	void dispatchEvent(const std::shared_ptr<const RsEvent>& event);
+	void deliverQueuedEvents(Handler& handler);
+	void callHandler(Handler& handler, const std::shared_ptr<const RsEvent>& event);
 	RsEventsHandlerId_t generateUniqueHandlerId_unlocked();
 
+	/// Runs the handler jobs. Last member, so that it stops first
+	RsScheduler mHandlerScheduler;
+
 	RS_SET_CONTEXT_DEBUG_LEVEL(3)
 };
@@ -0,0 +1,257 @@
+/*******************************************************************************
+ * libretroshare/src/tcponudp: tcpcongestion.cc                                *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#include "tcpcongestion.h"
+
+#include <iostream>
+#include <math.h>
+
+static const double CUBIC_C    = 0.4;	/* scaling constant, RFC 8312 */
+static const double CUBIC_BETA = 0.7;	/* multiplicative decrease factor */
+
+static int tou_congestion_type = TOU_CONGESTION_RENO;
+
+void	tou_set_congestion_control(int type)
+{
+	tou_congestion_type = type;
+}
+
+int	tou_get_congestion_control()
+{
+	return tou_congestion_type;
+}
+
+TcpCongestionControl *createTcpCongestionControl(uint32 segSize, uint32 maxWin)
+{
+	switch(tou_congestion_type)
+	{
+		case TOU_CONGESTION_CUBIC:
+			return new TcpCubicCongestion(segSize, maxWin);
+		case TOU_CONGESTION_RENO:
+		default:
+			return new TcpRenoCongestion(segSize, maxWin);
+	}
+}
+
+/* same as TcpStream::isOldSequence() */
+static bool isOldSeq(uint32 tst, uint32 curr)
+{
+	return ((int)((tst)-(curr)) < 0);
+}
+
+/***************************** Reno *****************************/
+
+TcpRenoCongestion::TcpRenoCongestion(uint32 segSize, uint32 maxWin)
+	:TcpCongestionControl(segSize, maxWin),
+	congestThreshold(maxWin), congestWinSize(segSize), congestUpdate(0)
+{
+	return;
+}
+
+void	TcpRenoCongestion::reset(uint32 ackno)
+{
+	congestThreshold = mMaxWin;
+	congestWinSize   = mSegSize;
+	congestUpdate    = ackno + congestWinSize;
+}
+
+void	TcpRenoCongestion::onAck(uint32 ackno, double /* rtt */, double /* now */)
+{
+	/* adjust the congestWinSize and congestThreshold
+	 * congestUpdate <= ackno
+	 */
+
+	if (isOldSeq(ackno, congestUpdate))
+		return;
+
+	if (congestWinSize < congestThreshold)
+	{
+		/* double it baby! */
+		congestWinSize *= 2;
+	}
+	else
+	{
+		/* linear increase */
+		congestWinSize += mSegSize;
+	}
+
+	if (congestWinSize > mMaxWin)
+	{
+		congestWinSize = mMaxWin;
+	}
+
+	congestUpdate  = ackno + congestWinSize; // point when we can up the winSize.
+}
+
+void	TcpRenoCongestion::onTimeout(uint32 ackno, double /* now */)
+{
+	congestThreshold = congestWinSize / 2;
+	congestWinSize = mSegSize;
+	congestUpdate  = ackno + congestWinSize; // point when we can up the winSize.
+}
+
+int	TcpRenoCongestion::dumpstate(std::ostream &out) const
+{
+	out << "(congestion reno) congestThreshold: " << congestThreshold;
+	out << " congestWinSize: " << congestWinSize;
+	out << " congestUpdate: " << congestUpdate;
+	out << std::endl;
+	return 1;
+}
+
+/***************************** CUBIC *****************************/
+
+TcpCubicCongestion::TcpCubicCongestion(uint32 segSize, uint32 maxWin)
+	:TcpCongestionControl(segSize, maxWin)
+{
+	reset(0);
+}
+
+void	TcpCubicCongestion::reset(uint32 ackno)
+{
+	cwnd = 1.0;
+	ssthresh = (double) mMaxWin / mSegSize;
+	wMax = 0;
+	wEst = 0;
+	epochStart = 0;
+	minRtt = 0;
+	K = 0;
+	lastAckno = ackno;
+	lossPending = false;
+}
+
+void	TcpCubicCongestion::onAck(uint32 ackno, double rtt, double now)
+{
+	if (rtt > 0 && (minRtt == 0 || rtt < minRtt))
+	{
+		minRtt = rtt;
+	}
+
+	if (!isOldSeq(lastAckno, ackno))
+		return;		/* nothing new acknowledged */
+
+	double acked = (double) (ackno - lastAckno) / mSegSize;
+	lastAckno = ackno;
+	lossPending = false;
+
+	double maxCwnd = (double) mMaxWin / mSegSize;
+
+	if (cwnd < ssthresh)
+	{
+		/* slow start */
+		cwnd += acked;
+	}
+	else
+	{
+		/* congestion avoidance */
+		if (epochStart == 0)
+		{
+			epochStart = now;
+			if (cwnd < wMax)
+			{
+				K = cbrt((wMax - cwnd) / CUBIC_C);
+			}
+			else
+			{
+				K = 0;
+				wMax = cwnd;
+			}
+			wEst = cwnd;
+		}
+
+		double t = now - epochStart + minRtt;
+		double target = CUBIC_C * (t - K) * (t - K) * (t - K) + wMax;
+
+		if (target > cwnd)
+		{
+			cwnd += (target - cwnd) / cwnd * acked;
+		}
+		else
+		{
+			cwnd += 0.01 * acked / cwnd;
+		}
+
+		/* never be slower than standard TCP would be */
+		wEst += 3.0 * (1.0 - CUBIC_BETA) / (1.0 + CUBIC_BETA) * acked / cwnd;
+		if (wEst > cwnd)
+		{
+			cwnd = wEst;
+		}
+	}
+
+	if (cwnd > maxCwnd)
+	{
+		cwnd = maxCwnd;
+	}
+}
+
+void	TcpCubicCongestion::onTimeout(uint32 ackno, double /* now */)
+{
+	/* TcpStream has no fast retransmit, so timeouts are the only loss
+	 * signal: treat the first one as a regular loss event, and fall back to
+	 * one segment only if nothing got through since the previous one.
+	 */
+	bool noProgress = lossPending && (ackno == lastAckno);
+
+	epochStart = 0;
+
+	/* fast convergence */
+	if (cwnd < wMax)
+	{
+		wMax = cwnd * (1.0 + CUBIC_BETA) / 2.0;
+	}
+	else
+	{
+		wMax = cwnd;
+	}
+
+	ssthresh = cwnd * CUBIC_BETA;
+	if (ssthresh < 2.0)
+	{
+		ssthresh = 2.0;
+	}
+
+	cwnd = noProgress ? 1.0 : ssthresh;
+	lastAckno = ackno;
+	lossPending = true;
+}
+
+uint32	TcpCubicCongestion::window() const
+{
+	uint32 win = (uint32) (cwnd * mSegSize);
+
+	if (win < mSegSize)
+		return mSegSize;
+	if (win > mMaxWin)
+		return mMaxWin;
+	return win;
+}
+
+int	TcpCubicCongestion::dumpstate(std::ostream &out) const
+{
+	out << "(congestion cubic) cwnd: " << cwnd;
+	out << " ssthresh: " << ssthresh;
+	out << " wMax: " << wMax;
+	out << " K: " << K;
+	out << " minRtt: " << minRtt;
+	out << std::endl;
+	return 1;
+}
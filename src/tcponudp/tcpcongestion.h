@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * libretroshare/src/tcponudp: tcpcongestion.h                                 *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#ifndef TOU_TCP_CONGESTION_H
+#define TOU_TCP_CONGESTION_H
+
+#include <iosfwd>
+
+#include "tcppacket.h"
+
+/* Congestion control for TcpStream.
+ *
+ * The stream only tells the controller about acknowledged data and
+ * retransmission timeouts, and asks it for the congestion window. This is
+ * purely sender side, so the algorithm can be changed without any
+ * compatibility issue with other peers.
+ */
+
+#define TOU_CONGESTION_RENO	0	/* slow start + linear increase, original behaviour */
+#define TOU_CONGESTION_CUBIC	1	/* RFC 8312, recovers much faster on high RTT links */
+
+class TcpCongestionControl
+{
+	public:
+	TcpCongestionControl(uint32 segSize, uint32 maxWin)
+	:mSegSize(segSize), mMaxWin(maxWin) { return; }
+virtual ~TcpCongestionControl() { return; }
+
+	/* new connection: restart from one segment. ackno is the first ack expected */
+virtual void	reset(uint32 ackno) = 0;
+
+	/* data up to ackno has been acknowledged. rtt is negative when the
+	 * acknowledged packet was retransmitted (Karn's algorithm) */
+virtual void	onAck(uint32 ackno, double rtt, double now) = 0;
+
+	/* a retransmission timeout happened */
+virtual void	onTimeout(uint32 ackno, double now) = 0;
+
+	/* current congestion window, in bytes */
+virtual uint32	window() const = 0;
+
+virtual int	dumpstate(std::ostream &out) const = 0;
+
+	protected:
+	uint32 mSegSize;
+	uint32 mMaxWin;
+};
+
+class TcpRenoCongestion: public TcpCongestionControl
+{
+	public:
+	TcpRenoCongestion(uint32 segSize, uint32 maxWin);
+
+virtual void	reset(uint32 ackno);
+virtual void	onAck(uint32 ackno, double rtt, double now);
+virtual void	onTimeout(uint32 ackno, double now);
+virtual uint32	window() const { return congestWinSize; }
+virtual int	dumpstate(std::ostream &out) const;
+
+	private:
+	uint32 congestThreshold;
+	uint32 congestWinSize;
+	uint32 congestUpdate;
+};
+
+class TcpCubicCongestion: public TcpCongestionControl
+{
+	public:
+	TcpCubicCongestion(uint32 segSize, uint32 maxWin);
+
+virtual void	reset(uint32 ackno);
+virtual void	onAck(uint32 ackno, double rtt, double now);
+virtual void	onTimeout(uint32 ackno, double now);
+virtual uint32	window() const;
+virtual int	dumpstate(std::ostream &out) const;
+
+	private:
+	/* all windows in segments, as in RFC 8312 */
+	double cwnd;
+	double ssthresh;
+	double wMax;
+	double wEst;		/* TCP friendly estimate */
+	double epochStart;	/* start of current congestion avoidance epoch, 0 if none */
+	double minRtt;
+	double K;
+	uint32 lastAckno;
+	bool   lossPending;	/* timed out, and nothing acknowledged since */
+};
+
+	/* selects the algorithm used by new streams */
+void	tou_set_congestion_control(int type);
+int	tou_get_congestion_control();
+
+TcpCongestionControl *createTcpCongestionControl(uint32 segSize, uint32 maxWin);
+
+#endif
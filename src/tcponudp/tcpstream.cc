@@ -100,9 +100,7 @@ TcpStream::TcpStream(UdpSubReceiver *lyr)
 	/* retranmission variables - init to large */
 	rtt_est(TCP_RETRANS_TIMEOUT), 
 	rtt_dev(0),
-	congestThreshold(TCP_MAX_WIN),
-	congestWinSize(MAX_SEG),
-	congestUpdate(0),
+	congestCtrl(createTcpCongestionControl(MAX_SEG, TCP_MAX_WIN)),
 	ttl(0),
         mTTL_period(0), 
         mTTL_start(0),
@@ -115,6 +113,11 @@ TcpStream::TcpStream(UdpSubReceiver *lyr)
 	return;
 }
 
+TcpStream::~TcpStream()
+{
+	delete congestCtrl;
+}
+
 /* Stream Control! */
 int	TcpStream::connect(const struct sockaddr_in &raddr, uint32_t conn_period)
 {
@@ -150,9 +153,7 @@ int	TcpStream::connect(const struct sockaddr_in &raddr, uint32_t conn_period)
 	outAcked = outSeqno; /* min - 1 expected */
 	inWinSize = maxWinSize;
 
-	congestThreshold = TCP_MAX_WIN;
-	congestWinSize   = MAX_SEG;
-	congestUpdate    = outAcked + congestWinSize;
+	congestCtrl->reset(outAcked);
 
 	/* Init Connection */
 	/* send syn packet */
@@ -1252,9 +1253,7 @@ int TcpStream::incoming_Closed(TcpPacket *pkt)
 			outAcked = outSeqno; /* min - 1 expected */
 
 			/* setup Congestion Charging */
-			congestThreshold = TCP_MAX_WIN;
-			congestWinSize   = MAX_SEG;
-			congestUpdate    = outAcked + congestWinSize;
+			congestCtrl->reset(outAcked);
 
 			rsp -> setSyn();
 		}
@@ -2075,20 +2074,15 @@ int TcpStream::retrans()
 		return 0;
 	}
 	
-	/* retransmission -> adjust the congestWinSize and congestThreshold 
+	/* retransmission -> adjust the congestion window
 	*/
 
-	congestThreshold = congestWinSize / 2;
-	congestWinSize = MAX_SEG;
-	congestUpdate  = outAcked + congestWinSize; // point when we can up the winSize.
+	congestCtrl->onTimeout(outAcked, cts);
 	
 #ifdef DEBUG_TCP_STREAM
 	std::cerr << "TcpStream::retrans() Adjusting Congestion Parameters: ";
 	std::cerr << std::endl;
-	std::cerr << "\tcongestWinSize: " << congestWinSize;
-	std::cerr << "  congestThreshold: " << congestThreshold;
-	std::cerr << "  congestUpdate: " << congestUpdate;
-	std::cerr << std::endl;
+	congestCtrl->dumpstate(std::cerr);
 #endif
 	
 	/* update ackno and winsize */
@@ -2227,41 +2221,7 @@ void TcpStream::acknowledge()
 	{
 		TcpPacket *pkt = (*it);
 		clearedPkts = true;
-
-		/* adjust the congestWinSize and congestThreshold 
-		 * congestUpdate <= outAcked
-		 *
-		 ***/
-
-		if (!isOldSequence(outAcked, congestUpdate))
-		{
-			if (congestWinSize < congestThreshold)
-			{
-				/* double it baby! */
-				congestWinSize *= 2;
-			}
-			else
-			{
-				/* linear increase */
-				congestWinSize += MAX_SEG;
-			}
-
-			if (congestWinSize > maxWinSize)
-			{
-				congestWinSize = maxWinSize;
-			}
-
-			congestUpdate  = outAcked + congestWinSize; // point when we can up the winSize.
-
-#ifdef DEBUG_TCP_STREAM
-			std::cerr << "TcpStream::acknowledge() Adjusting Congestion Parameters: ";
-			std::cerr << std::endl;
-			std::cerr << "\tcongestWinSize: " << congestWinSize;
-			std::cerr << "  congestThreshold: " << congestThreshold;
-			std::cerr << "  congestUpdate: " << congestUpdate;
-			std::cerr << std::endl;
-#endif
-		}
+		double ack_time = -1.0;
 
 
 		/* update the RoundTripTime, 
@@ -2294,7 +2254,7 @@ void TcpStream::acknowledge()
 
 		if (updateRTT) /* can use for RTT calc */
 		{
-			double ack_time = cts - pkt->ts;
+			ack_time = cts - pkt->ts;
 			rtt_est = RTT_ALPHA * rtt_est + (1.0 - RTT_ALPHA) * ack_time;
 			rtt_dev = RTT_ALPHA * rtt_dev + (1.0 - RTT_ALPHA) * fabs(rtt_est - ack_time);
 			retransTimeout = rtt_est + 4.0 * rtt_dev;
@@ -2320,6 +2280,15 @@ void TcpStream::acknowledge()
 		}
 #endif
 
+		/* adjust the congestion window */
+		congestCtrl->onAck(outAcked, ack_time, cts);
+
+#ifdef DEBUG_TCP_STREAM
+		std::cerr << "TcpStream::acknowledge() Congestion Parameters: ";
+		std::cerr << std::endl;
+		congestCtrl->dumpstate(std::cerr);
+#endif
+
 #ifdef DEBUG_TCP_STREAM
 		std::cerr << "TcpStream::acknowledge() Removing Seqno: ";
 		std::cerr << pkt->seqno << " size: " << pkt->datasize;
@@ -2384,6 +2353,7 @@ int TcpStream::send()
 
 
 	/* determine exactly how much we can send */
+	uint32 congestWinSize = congestCtrl->window();
 	uint32 maxsend = congestWinSize;
 	uint32 inTransit;
 
@@ -2420,7 +2390,6 @@ int TcpStream::send()
 		std::cerr << " aSnd: " << availSend;
 		std::cerr << " | oSeq: " << outSeqno;
 		std::cerr << "  oAck: " << outAcked;
-		std::cerr << "  cUpd: " << congestUpdate;
 		std::cerr << std::endl;
 #endif
 
@@ -2728,9 +2697,7 @@ int TcpStream::dumpstate_locked(std::ostream &out)
 	out << " rtt_dev: " << rtt_dev;
 	out << std::endl;
 
-	out << "(congestion) congestThreshold: " << congestThreshold;
-	out << " congestWinSize: " << congestWinSize;
-	out << " congestUpdate: " << congestUpdate;
+	congestCtrl->dumpstate(out);
 	out << std::endl;
 
 	out << "(TTL) mTTL_period: " << mTTL_period;
@@ -31,6 +31,7 @@
 
 #include "tcppacket.h"
 #include "udppeer.h"
+#include "tcpcongestion.h"
 
 // WINDOWS doesn't like UDP packets bigger than 1492 (truncates them). 
 // We have up to 64 bytes of headers: 28(udp) + 16(relay) + 20(tou) = 64 bytes.
@@ -75,7 +76,7 @@ class TcpStream: public UdpPeer
 	/* Top-Level exposed */
 
 	TcpStream(UdpSubReceiver *udp);
-virtual ~TcpStream() { return; }
+virtual ~TcpStream();
 
 	/* user interface */
 int     status(std::ostream &out);
@@ -234,9 +235,7 @@ uint32 	int_rbytes();
 	double rtt_dev;
 
 	/* congestion limits */
-	uint32 congestThreshold;
-	uint32 congestWinSize;
-	uint32 congestUpdate;
+	TcpCongestionControl *congestCtrl;
 
 	/* existing TTL for this stream (tweaked at startup) */
 	int ttl;
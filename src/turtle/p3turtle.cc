@@ -817,12 +817,14 @@ uint32_t p3turtle::generatePersonalFilePrint(const TurtleFileHash& hash,uint32_t
 int p3turtle::handleIncoming()
 {
 	int nhandled = 0;
-	// While messages read
+	// Take all the queued messages at once
 	//
-	RsItem *item = NULL;
+	std::list<RsItem*> items;
+	recvItems(items);
 
-	while(NULL != (item = recvItem()))
+	for(std::list<RsItem*>::const_iterator it(items.begin());it!=items.end();++it)
 	{
+		RsItem *item = *it;
 		nhandled++;
 
 		if(!(_turtle_routing_enabled && _turtle_routing_session_enabled))
@@ -2272,9 +2274,20 @@ static std::string printNumber(uint64_t num,bool hex=false)
 
 void p3turtle::getTrafficStatistics(TurtleTrafficStatisticsInfo& info) const
 {
+	// Incoming file searches are answered by the local search cache. Asked off-mutex, as it has a lock of its own.
+
+	SearchCacheStats search_cache_stats ;
+
+	if(rsFiles)
+		rsFiles->getSearchCacheStatistics(search_cache_stats) ;
+
 	RsStackMutex stack(mTurtleMtx); /********** STACK LOCKED MTX ******/
 	info = _traffic_info ;
 
+	info.search_cache_hits = search_cache_stats.hits ;
+	info.search_cache_misses = search_cache_stats.misses ;
+	info.search_cache_cpu_saved_s = search_cache_stats.cpu_saved_us / 1e6f ;
+
 	float distance_to_maximum	= std::min(100.0f,info.tr_up_Bps/(float)(TUNNEL_REQUEST_PACKET_SIZE*_max_tr_up_rate)) ;
 	info.forward_probabilities.clear() ;
 
@@ -17,6 +17,10 @@ class TurtleTrafficStatisticsInfoOp: public TurtleTrafficStatisticsInfo
 			tr_dn_Bps = 0.0f ;
 			total_up_Bps = 0.0f ;
 			total_dn_Bps = 0.0f ;
+
+			search_cache_hits = 0 ;
+			search_cache_misses = 0 ;
+			search_cache_cpu_saved_s = 0.0f ;
 		}
 
 		TurtleTrafficStatisticsInfoOp operator*(float f) const
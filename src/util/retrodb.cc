@@ -239,7 +239,7 @@ bool RetroDb::execSQL(const std::string &query){
 }
 
 RetroCursor* RetroDb::sqlQuery(const std::string& tableName, const std::list<std::string>& columns,
-                               const std::string& selection, const std::string& orderBy){
+                               const std::string& selection, const std::string& orderBy, uint32_t limit){
 
     if(tableName.empty() || columns.empty()){
         std::cerr << "RetroDb::sqlQuery(): No table or columns given" << std::endl;
@@ -270,9 +270,12 @@ RetroCursor* RetroDb::sqlQuery(const std::string& tableName, const std::list<std
 
     // add 'order by' clause if present
     if(!orderBy.empty())
-        sqlQuery += " ORDER BY " + orderBy + ";";
-    else
-        sqlQuery += ";";
+        sqlQuery += " ORDER BY " + orderBy;
+
+    if(limit)
+        sqlQuery += " LIMIT " + std::to_string(limit);
+
+    sqlQuery += ";";
 
 #ifdef RETRODB_DEBUG
     std::cerr << "RetroDb::sqlQuery(): " << sqlQuery << std::endl;
@@ -633,6 +636,26 @@ bool RetroDb::sqlUpdate(const std::string &tableName, std::string whereClause, c
     return execSQL_bind(sqlQuery, paramBindings);
 }
 
+int64_t RetroDb::lastInsertRowId()
+{
+    if (!isOpen()) {
+        return 0;
+    }
+
+    return sqlite3_last_insert_rowid(mDb);
+}
+
+void RetroDb::vacuum()
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    if (execSQL("VACUUM;")) {
+        mDbNeedsCleaning = false;
+    }
+}
+
 bool RetroDb::tableExists(const std::string &tableName)
 {
     if (!isOpen()) {
@@ -145,11 +145,12 @@ public:
      *        an SQL WHERE clause (excluding the WHERE itself). Passing null will \n
      *        return all rows for the given table.
      * @param order the rows, formatted as an SQL ORDER BY clause (excluding the ORDER BY itself)
+     * @param limit maximum number of rows returned, 0 for no limit
      * @return cursor over result set, this allocated resource should be free'd after use \n
      *         column order is in list order.
      */
     RetroCursor* sqlQuery(const std::string& tableName, const std::list<std::string>& columns,
-                          const std::string& selection, const std::string& orderBy);
+                          const std::string& selection, const std::string& orderBy, uint32_t limit = 0);
 
     /*!
      * delete row in an sql table
@@ -160,8 +161,13 @@ public:
     bool sqlDelete(const std::string& tableName, const std::string& whereClause, const std::string& whereArgs);
 
     /*!
-     * TODO
+     * @return the rowid of the last row inserted by this connection
+     */
+    int64_t lastInsertRowId();
+
+    /*!
      * defragment database, should be done on databases if many modifications have occured
+     * must not be called inside a transaction
      */
     void vacuum();
 
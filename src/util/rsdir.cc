@@ -36,6 +36,7 @@
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
+#include <vector>
 
 #include "util/rsdebug.h"
 #include "util/rsdir.h"
@@ -58,6 +59,15 @@
 #include <errno.h>
 #endif
 
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+#define RS_HAS_COPY_FILE_RANGE 1
+#endif
+
 #ifndef __GLIBC__
 #define canonicalize_file_name(p) realpath(p, NULL)
 #endif
@@ -314,6 +324,12 @@ bool RsDirUtil::fileExists(const std::string& filename)
 }
 
 bool RsDirUtil::moveFile(const std::string& source,const std::string& dest)
+{
+	return moveFile(source, dest, std::function<bool(uint64_t,uint64_t)>());
+}
+
+bool RsDirUtil::moveFile( const std::string& source, const std::string& dest,
+                          const std::function<bool(uint64_t,uint64_t)>& progress )
 {
 	Dbg3() << __PRETTY_FUNCTION__<< " source: " << source
 	       << " dest: " << dest << std::endl;
@@ -342,7 +358,7 @@ bool RsDirUtil::moveFile(const std::string& source,const std::string& dest)
 
 	/* If not, try to copy. The src and dest probably belong to different file
 	 * systems */
-	if(!copyFile(source,dest))
+	if(!copyFile(source,dest,progress))
 	{
 		RsErr() << __PRETTY_FUNCTION__ << " failure copying file" << std::endl;
 		return false;
@@ -381,67 +397,144 @@ bool RsDirUtil::removeFile(const std::string& filename)
 	}
 }
 
-/**** Copied and Tweaked from ftcontroller ***/
 bool RsDirUtil::copyFile(const std::string& source,const std::string& dest)
+{
+	return copyFile(source, dest, std::function<bool(uint64_t,uint64_t)>());
+}
+
+#ifdef WINDOWS_SYS
+static DWORD CALLBACK copyFileProgress( LARGE_INTEGER total, LARGE_INTEGER copied,
+                                        LARGE_INTEGER, LARGE_INTEGER, DWORD, DWORD,
+                                        HANDLE, HANDLE, LPVOID data )
+{
+	const std::function<bool(uint64_t,uint64_t)>& progress =
+	        *static_cast<const std::function<bool(uint64_t,uint64_t)>*>(data);
+
+	return progress(copied.QuadPart, total.QuadPart) ? PROGRESS_CONTINUE : PROGRESS_CANCEL;
+}
+#endif
+
+bool RsDirUtil::copyFile( const std::string& source, const std::string& dest,
+                          const std::function<bool(uint64_t,uint64_t)>& progress )
 {
 #ifdef WINDOWS_SYS
-        std::wstring sourceW;
-        std::wstring destW;
-        librs::util::ConvertUtf8ToUtf16(source,sourceW);
-        librs::util::ConvertUtf8ToUtf16(dest,destW);
+	std::wstring sourceW;
+	std::wstring destW;
+	librs::util::ConvertUtf8ToUtf16(source,sourceW);
+	librs::util::ConvertUtf8ToUtf16(dest,destW);
 
-        return (CopyFileW(sourceW.c_str(), destW.c_str(), FALSE) != 0);
+	if(!progress)
+		return (CopyFileW(sourceW.c_str(), destW.c_str(), FALSE) != 0);
 
+	// The destination is deleted when the progress routine cancels the copy
+	return CopyFileExW( sourceW.c_str(), destW.c_str(), copyFileProgress,
+	                    (LPVOID)&progress, NULL, 0 ) != 0;
 #else
-	FILE *in = fopen64(source.c_str(),"rb") ;
+	static const size_t COPY_BLOCK_SIZE = 8*1024*1024;
 
-	if(in == NULL)
-	{
-		return false ;
-	}
+	struct stat64 buf;
+	if(stat64(source.c_str(), &buf) != 0)
+		return false;
+
+	const uint64_t total = buf.st_size;
+
+	int in_flags = O_RDONLY;
+	int out_flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_LARGEFILE
+	in_flags |= O_LARGEFILE;
+	out_flags |= O_LARGEFILE;
+#endif
+
+	int in = open(source.c_str(), in_flags);
+
+	if(in < 0)
+		return false;
 
-	FILE *out = fopen64(dest.c_str(),"wb") ;
+	int out = open(dest.c_str(), out_flags, 0666);
 
-	if(out == NULL)
+	if(out < 0)
 	{
-		fclose (in);
-		return false ;
+		close(in);
+		return false;
 	}
 
-	size_t s=0;
-	size_t T=0;
+	uint64_t copied = 0;
+	bool done = false;
+	bool ok = true;
 
-	static const int BUFF_SIZE = 10485760 ; // 10 MB buffer to speed things up.
-	RsTemporaryMemory buffer(BUFF_SIZE) ;
-    
-    	if(!buffer)
+#ifdef FICLONE
+	// Copy-on-write clone (btrfs, XFS...), no data is copied at all
+	if(ioctl(out, FICLONE, in) == 0)
 	{
-		fclose(in) ;
-		fclose(out) ;
-		return false ;
+		copied = total;
+		done = true;
+
+		if(progress && !progress(copied, total))
+			ok = false;
 	}
+#endif
+
+#ifdef RS_HAS_COPY_FILE_RANGE
+	// Copy inside the kernel, some file systems even do it on the server side
+	while(!done && ok)
+	{
+		ssize_t n = copy_file_range(in, NULL, out, NULL, COPY_BLOCK_SIZE, 0);
+
+		if(n == 0)
+			done = true;
+		else if(n > 0)
+		{
+			copied += n;
 
-	bool bRet = true;
+			if(progress && !progress(copied, total))
+				ok = false;
+		}
+		else if(errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)
+			break;	// not supported here, the file offsets are right to go on by hand
+		else if(errno != EINTR)
+			ok = false;
+	}
+#endif
 
-	while( (s = fread(buffer,1,BUFF_SIZE,in)) > 0)
+	if(!done && ok)
 	{
-		size_t t = fwrite(buffer,1,s,out) ;
-		T += t ;
+		std::vector<unsigned char> buffer(1024*1024);
 
-		if(t != s)
+		while(!done && ok)
 		{
-			bRet = false ;
-			break;
+			ssize_t n = read(in, buffer.data(), buffer.size());
+
+			if(n == 0)
+				done = true;
+			else if(n < 0)
+				ok = (errno == EINTR);
+			else
+			{
+				for(ssize_t w = 0; ok && w < n;)
+				{
+					ssize_t t = write(out, buffer.data() + w, n - w);
+
+					if(t >= 0)
+						w += t;
+					else
+						ok = (errno == EINTR);
+				}
+				copied += n;
+
+				if(ok && progress && !progress(copied, total))
+					ok = false;
+			}
 		}
 	}
 
-	fclose(in) ;
-	fclose(out) ;
+	close(in);
+	ok = (close(out) == 0) && ok;
 
-	return bRet ;
+	if(!ok)
+		remove(dest.c_str());
 
+	return ok;
 #endif
-
 }
 
 
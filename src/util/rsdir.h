@@ -28,6 +28,7 @@
 #include <list>
 #include <set>
 #include <cstdint>
+#include <functional>
 #include <system_error>
 
 class RsThread;
@@ -97,9 +98,29 @@ bool splitDirFromFile( const std::string& full_path,
 
 bool 		copyFile(const std::string& source,const std::string& dest);
 
+/**
+ * @brief Copy a file, as a copy-on-write clone or inside the kernel when the
+ * system supports it, by hand otherwise. The destination is removed if the
+ * copy fails or is abandoned.
+ * @param progress called regularly with the number of bytes copied so far and
+ *	the size of the file. Return false to abandon the copy.
+ * @return false on error or if abandoned
+ */
+bool copyFile( const std::string& source, const std::string& dest,
+               const std::function<bool(uint64_t copied, uint64_t total)>& progress );
+
 /** Move file. If destination directory doesn't exists create it. */
 bool moveFile(const std::string& source, const std::string& dest);
 
+/**
+ * @brief Move file, reporting the progress of the copy when source and
+ * destination are on different file systems.
+ * @param progress as for copyFile(). Return false to abandon the move, the
+ *	file then stays at source.
+ */
+bool moveFile( const std::string& source, const std::string& dest,
+               const std::function<bool(uint64_t copied, uint64_t total)>& progress );
+
 bool 		removeFile(const std::string& file);
 bool 		fileExists(const std::string& file);
 bool    	checkFile(const std::string& filename,uint64_t& file_size,bool disallow_empty_file = false);
@@ -24,6 +24,7 @@
 #include "retroshare/rstypes.h"
 #include <algorithm>
 #include <functional>
+#include <cstring>
 
 /******************************************************************************************
 eval functions of relational expressions. 
@@ -105,8 +106,8 @@ static bool StrEquals(const std::string & str1, const std::string & str2,
     if ( str1.size() != str2.size() ){
         return false;
     } else if (IgnoreCase) {
-        std::equal( str1.begin(), str1.end(),
-                    str2.begin(), CompareCharIC() );
+        return std::equal( str1.begin(), str1.end(),
+                           str2.begin(), CompareCharIC() );
     }
     return std::equal( str1.begin(), str1.end(),
                        str2.begin());
@@ -289,7 +290,7 @@ Expression *LinearizedExpression::toExpr(const LinearizedExpression& e,int& n_to
 
         readStringExpr(e,n_ints,n_strings,strings,b,op) ;
 
-        return new ExtExpression(op,strings,b) ;
+        return new PathExpression(op,strings,b) ;
     }
     case EXPR_EXT: {
         std::list<std::string> strings ;
@@ -322,4 +323,454 @@ Expression *LinearizedExpression::toExpr(const LinearizedExpression& e,int& n_to
 }
 
 
+/*************************************************************************
+ * compiled expressions
+ *************************************************************************/
+
+// Bigger contains tests are searched term by term, so that a malicious
+// request cannot make us build a huge automaton (256 transitions per state).
+// The total is capped as well, for requests made of many string tests.
+static const uint32_t MAX_AUTOMATON_TERMS_LENGTH = 256 ;
+static const uint32_t MAX_AUTOMATON_STATES       = 4096 ;	// 4 MB of transitions
+static const uint32_t MAX_TERMS_PER_MATCHER      = 64 ;	// bits in the term masks
+static const uint32_t MAX_EXPRESSION_DEPTH       = 256 ;
+
+static const uint32_t COST_REL  = 1 ;
+static const uint32_t COST_EXT  = 2 ;
+static const uint32_t COST_NAME = 4 ;
+static const uint32_t COST_HASH = 8 ;	// hash to hex
+static const uint32_t COST_PATH = 16 ;	// may build the path
+
+struct LowerCaseTable
+{
+    LowerCaseTable() { for(int c=0;c<256;++c) table[c] = tolower(c) ; }
+    uint8_t table[256] ;
+};
+
+// Same lowercasing as CompareCharIC
+static const uint8_t *lowerCaseTable()
+{
+    static const LowerCaseTable t ;
+    return t.table ;
+}
+
+static bool evalRelOp(uint8_t op, int lower, int higher, int val)
+{
+    // same as RelExpression::evalRel()
+    switch(op)
+    {
+    case Equals:        return lower == val ;
+    case GreaterEquals: return lower >= val ;
+    case Greater:       return lower > val ;
+    case SmallerEquals: return lower <= val ;
+    case Smaller:       return lower < val ;
+    case InRange:       return (lower <= val) && (val <= higher) ;
+    default:            return false ;
+    }
+}
+
+bool CompiledExpression::compile(const Expression& e)
+{
+    LinearizedExpression le ;
+    e.linearize(le) ;
+
+    return compile(le) ;
+}
+
+bool CompiledExpression::compile(const LinearizedExpression& e)
+{
+    mNodes.clear() ;
+    mMatchers.clear() ;
+    mAutomatonStates = 0 ;
+
+    uint32_t n_tok=0, n_ints=0, n_strings=0 ;
+
+    if(!compileNode(e,n_tok,n_ints,n_strings,0,mRoot))
+    {
+        mNodes.clear() ;
+        mMatchers.clear() ;
+        return false ;
+    }
+    return true ;
+}
+
+bool CompiledExpression::compileNode(const LinearizedExpression& e, uint32_t& n_tok, uint32_t& n_ints, uint32_t& n_strings, uint32_t depth, uint32_t& node)
+{
+    if(n_tok >= e._tokens.size() || depth > MAX_EXPRESSION_DEPTH)
+        return false ;
+
+    uint8_t tok = e._tokens[n_tok++] ;
+
+    switch(tok)
+    {
+    case LinearizedExpression::EXPR_DATE:
+    case LinearizedExpression::EXPR_POP:
+    case LinearizedExpression::EXPR_SIZE:
+    case LinearizedExpression::EXPR_SIZE_MB: {
+        if(n_ints + 3 > e._ints.size())
+            return false ;
+
+        Node n ;
+        n.token = tok ;
+        n.op = e._ints[n_ints++] ;
+        n.lower = e._ints[n_ints++] ;
+        n.higher = e._ints[n_ints++] ;
+        n.cost = COST_REL ;
+        n.left = n.right = 0 ;
+
+        node = mNodes.size() ;
+        mNodes.push_back(n) ;
+        return true ;
+    }
+    case LinearizedExpression::EXPR_HASH:
+    case LinearizedExpression::EXPR_NAME:
+    case LinearizedExpression::EXPR_PATH:
+    case LinearizedExpression::EXPR_EXT: {
+        if(n_ints + 3 > e._ints.size())
+            return false ;
+
+        uint8_t op = e._ints[n_ints++] ;
+        bool ignore_case = e._ints[n_ints++] || tok == LinearizedExpression::EXPR_HASH ;	// see HashExpression
+        uint32_t n = e._ints[n_ints++] ;
+
+        if(n > e._strings.size() - n_strings)
+            return false ;
+
+        std::vector<std::string> terms(e._strings.begin() + n_strings, e._strings.begin() + n_strings + n) ;
+        n_strings += n ;
+
+        node = addStringTest(tok,op,ignore_case,terms) ;
+        return true ;
+    }
+    case LinearizedExpression::EXPR_COMP: {
+        if(n_ints >= e._ints.size())
+            return false ;
+
+        Node n ;
+        n.token = tok ;
+        n.op = e._ints[n_ints++] ;
+        n.lower = n.higher = 0 ;
+
+        if(!compileNode(e,n_tok,n_ints,n_strings,depth+1,n.left) || !compileNode(e,n_tok,n_ints,n_strings,depth+1,n.right))
+            return false ;
+
+        n.cost = mNodes[n.left].cost + mNodes[n.right].cost ;
+
+        // Operands have no side effects, so AND/OR can test the cheapest one first
+        if(n.op != XorOp && mNodes[n.right].cost < mNodes[n.left].cost)
+            std::swap(n.left,n.right) ;
+
+        node = mNodes.size() ;
+        mNodes.push_back(n) ;
+        return true ;
+    }
+    default:
+        std::cerr << "CompiledExpression: no expression match the current value " << (int)tok << std::endl ;
+        return false ;
+    }
+}
+
+uint32_t CompiledExpression::addStringTest(uint8_t token, uint8_t op, bool ignore_case, const std::vector<std::string>& terms)
+{
+    // Term masks have 64 bits: split bigger tests into several ones. ContainsAll needs all of them,
+    // the other operators any.
+    //
+    if(terms.size() > MAX_TERMS_PER_MATCHER)
+    {
+        Node n ;
+        n.token = LinearizedExpression::EXPR_COMP ;
+        n.op = (op == ContainsAllStrings)? AndOp : OrOp ;
+        n.lower = n.higher = 0 ;
+
+        std::vector<std::string> first(terms.begin(), terms.begin() + MAX_TERMS_PER_MATCHER) ;
+        std::vector<std::string> others(terms.begin() + MAX_TERMS_PER_MATCHER, terms.end()) ;
+
+        n.left = addStringTest(token,op,ignore_case,first) ;
+        n.right = addStringTest(token,op,ignore_case,others) ;
+        n.cost = mNodes[n.left].cost + mNodes[n.right].cost ;
+
+        mNodes.push_back(n) ;
+        return mNodes.size() - 1 ;
+    }
+
+    StringMatcher m ;
+    m.op = op ;
+    m.ignoreCase = ignore_case ;
+    m.terms = terms ;
+    m.allTerms = terms.empty()? 0 : (~(uint64_t)0 >> (64 - terms.size())) ;
+
+    uint32_t terms_length = 0 ;
+
+    for(uint32_t i=0;i<m.terms.size();++i)
+    {
+        if(ignore_case)
+            for(uint32_t j=0;j<m.terms[i].size();++j)
+                m.terms[i][j] = lowerCaseTable()[(uint8_t)m.terms[i][j]] ;
+
+        terms_length += m.terms[i].size() ;
+    }
+
+    // An automaton has at most terms_length+1 states. Past the total cap, terms are searched one by one.
+    //
+    if(op != EqualsString && terms_length <= MAX_AUTOMATON_TERMS_LENGTH && mAutomatonStates + terms_length + 1 <= MAX_AUTOMATON_STATES)
+    {
+        buildAutomaton(m) ;
+        mAutomatonStates += m.output.size() ;
+    }
+
+    Node n ;
+    n.token = token ;
+    n.op = op ;
+    n.lower = n.higher = 0 ;
+    n.left = mMatchers.size() ;
+    n.right = 0 ;
+
+    switch(token)
+    {
+    case LinearizedExpression::EXPR_EXT:  n.cost = COST_EXT ; break ;
+    case LinearizedExpression::EXPR_HASH: n.cost = COST_HASH ; break ;
+    case LinearizedExpression::EXPR_PATH: n.cost = COST_PATH ; break ;
+    default:                              n.cost = COST_NAME ; break ;
+    }
+    n.cost += terms.size() / 4 ;
+
+    mMatchers.push_back(m) ;
+    mNodes.push_back(n) ;
+
+    return mNodes.size() - 1 ;
+}
+
+void CompiledExpression::buildAutomaton(StringMatcher& m)
+{
+    // Trie of the terms first. 0 is the root, and also means "no transition" since the root
+    // is never the target of a trie edge.
+    //
+    std::vector<uint32_t>& delta(m.delta) ;
+    std::vector<uint64_t>& output(m.output) ;
+
+    delta.assign(256,0) ;
+    output.assign(1,0) ;
+
+    for(uint32_t i=0;i<m.terms.size();++i)
+    {
+        uint32_t s = 0 ;
+
+        for(uint32_t j=0;j<m.terms[i].size();++j)
+        {
+            uint8_t c = m.terms[i][j] ;
+
+            if(delta[256*s + c] == 0)
+            {
+                delta[256*s + c] = output.size() ;
+                delta.resize(delta.size() + 256, 0) ;
+                output.push_back(0) ;
+            }
+            s = delta[256*s + c] ;
+        }
+        output[s] |= (uint64_t)1 << i ;	// empty terms are found at the root, like std::search does
+    }
+
+    // Then failure links, breadth first, turning the trie into a complete automaton. A
+    // state is only visited once all states of smaller depth are complete.
+    //
+    std::vector<uint32_t> fail(output.size(),0) ;
+    std::vector<uint32_t> queue ;
+
+    for(int c=0;c<256;++c)
+        if(delta[c] != 0)
+            queue.push_back(delta[c]) ;
+
+    for(uint32_t q=0;q<queue.size();++q)
+    {
+        uint32_t s = queue[q] ;
+        output[s] |= output[fail[s]] ;
+
+        for(int c=0;c<256;++c)
+        {
+            uint32_t t = delta[256*s + c] ;
+
+            if(t != 0)
+            {
+                fail[t] = delta[256*fail[s] + c] ;
+                queue.push_back(t) ;
+            }
+            else
+                delta[256*s + c] = delta[256*fail[s] + c] ;
+        }
+    }
+
+    // Ignoring case: upper case characters move like lower case ones, so that strings need
+    // not be lowercased when searched.
+    //
+    if(m.ignoreCase)
+        for(uint32_t s=0;s<output.size();++s)
+            for(int c=0;c<256;++c)
+                delta[256*s + c] = delta[256*s + lowerCaseTable()[c]] ;
+}
+
+bool CompiledExpression::StringMatcher::match(const char *str, size_t len) const
+{
+    const uint8_t *lc = lowerCaseTable() ;
+    const uint8_t *s = reinterpret_cast<const uint8_t*>(str) ;
+
+    if(op == EqualsString)
+    {
+        for(uint32_t i=0;i<terms.size();++i)
+        {
+            if(terms[i].size() != len)
+                continue ;
+
+            const uint8_t *t = reinterpret_cast<const uint8_t*>(terms[i].data()) ;
+            size_t j=0 ;
+
+            if(ignoreCase)
+                while(j < len && lc[s[j]] == t[j]) ++j ;
+            else
+                while(j < len && s[j] == t[j]) ++j ;
+
+            if(j == len)
+                return true ;
+        }
+        return false ;
+    }
+
+    uint64_t found = 0 ;
+
+    if(!delta.empty())
+    {
+        uint32_t state = 0 ;
+        found = (len > 0)? output[0] : 0 ;	// std::search finds empty terms in non empty strings only
+
+        for(size_t i=0;i<len;++i)
+        {
+            if(op == ContainsAnyStrings? (found != 0) : (found == allTerms))
+                break ;
+
+            state = delta[256*state + s[i]] ;
+            found |= output[state] ;
+        }
+    }
+    else
+        for(uint32_t i=0;i<terms.size();++i)
+        {
+            const std::string& t(terms[i]) ;
+            const char *end = str + len ;
+            bool has_it ;
+
+            if(ignoreCase)
+                has_it = std::search(str, end, t.begin(), t.end(), [lc](char a, char b) { return lc[(uint8_t)a] == (uint8_t)b ; }) != end ;
+            else
+                has_it = std::search(str, end, t.begin(), t.end()) != end ;
+
+            if(has_it)
+                found |= (uint64_t)1 << i ;
+            else if(op == ContainsAllStrings)
+                return false ;
+
+            if(has_it && op == ContainsAnyStrings)
+                return true ;
+        }
+
+    return (op == ContainsAnyStrings)? (found != 0) : (found == allTerms) ;
+}
+
+bool CompiledExpression::eval(const ExpFileEntry& file) const
+{
+    if(mNodes.empty())
+        return false ;
+
+    return evalNode(mRoot,file) ;
+}
+
+size_t CompiledExpression::memoryUsage() const
+{
+    size_t size = sizeof(*this) + mNodes.capacity()*sizeof(Node) + mMatchers.capacity()*sizeof(StringMatcher) ;
+
+    for(uint32_t i=0;i<mMatchers.size();++i)
+    {
+        const StringMatcher& m(mMatchers[i]) ;
+
+        for(uint32_t j=0;j<m.terms.size();++j)
+            size += sizeof(std::string) + m.terms[j].capacity() ;
+
+        size += m.delta.capacity()*sizeof(uint32_t) + m.output.capacity()*sizeof(uint64_t) ;
+    }
+    return size ;
+}
+
+bool CompiledExpression::evalNode(uint32_t node, const ExpFileEntry& file) const
+{
+    const Node& n(mNodes[node]) ;
+
+    switch(n.token)
+    {
+    case LinearizedExpression::EXPR_COMP:
+        switch(n.op)
+        {
+        case AndOp: return evalNode(n.left,file) && evalNode(n.right,file) ;
+        case OrOp:  return evalNode(n.left,file) || evalNode(n.right,file) ;
+        case XorOp: return evalNode(n.left,file) ^ evalNode(n.right,file) ;
+        default:    return false ;
+        }
+
+    case LinearizedExpression::EXPR_DATE:
+    case LinearizedExpression::EXPR_POP:
+    case LinearizedExpression::EXPR_SIZE:
+    case LinearizedExpression::EXPR_SIZE_MB: {
+        int val ;
+
+        // same conversions as the eval() of each expression
+        if(n.token == LinearizedExpression::EXPR_DATE)
+            val = file.file_modtime() ;
+        else if(n.token == LinearizedExpression::EXPR_POP)
+            val = file.file_popularity() ;
+        else if(n.token == LinearizedExpression::EXPR_SIZE)
+            val = (int)std::min( (uint64_t)(~(uint32_t)0 >> 1), file.file_size() ) ;
+        else
+            val = (int)(file.file_size() >> 20) ;
+
+        return evalRelOp(n.op,n.lower,n.higher,val) ;
+    }
+
+    case LinearizedExpression::EXPR_NAME:
+        return mMatchers[n.left].match(file.file_name().data(),file.file_name().size()) ;
+
+    case LinearizedExpression::EXPR_EXT: {
+        const std::string& name(file.file_name()) ;
+        size_t index = name.find_last_of('.') ;
+
+        if(index == std::string::npos || index+1 == name.size())
+            return false ;
+
+        return mMatchers[n.left].match(name.data() + index + 1,name.size() - index - 1) ;
+    }
+
+    case LinearizedExpression::EXPR_HASH: {
+        static const char hex[] = "0123456789abcdef" ;
+        const RsFileHash& hash(file.file_hash()) ;
+        char str[2*RsFileHash::SIZE_IN_BYTES] ;
+
+        for(uint32_t i=0;i<RsFileHash::SIZE_IN_BYTES;++i)
+        {
+            str[2*i  ] = hex[hash.toByteArray()[i] >> 4] ;
+            str[2*i+1] = hex[hash.toByteArray()[i] & 0xf] ;
+        }
+        return mMatchers[n.left].match(str,sizeof(str)) ;
+    }
+
+    case LinearizedExpression::EXPR_PATH: {
+        const std::string *path = file.file_parent_path_ptr() ;
+
+        if(path != NULL)
+            return mMatchers[n.left].match(path->data(),path->size()) ;
+
+        std::string tmp(file.file_parent_path()) ;
+        return mMatchers[n.left].match(tmp.data(),tmp.size()) ;
+    }
+
+    default:
+        return false ;
+    }
+}
+
 }
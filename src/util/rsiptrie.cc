@@ -0,0 +1,409 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsiptrie.cc                                         *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "util/rsiptrie.h"
+#include "util/rsdir.h"
+
+static const uint64_t IPV4_MAPPED = 0x0000ffff00000000ULL;
+
+static int clz64(uint64_t x)
+{
+	int n = 0;
+	if(!(x & 0xffffffff00000000ULL)) { n += 32; x <<= 32; }
+	if(!(x & 0xffff000000000000ULL)) { n += 16; x <<= 16; }
+	if(!(x & 0xff00000000000000ULL)) { n += 8; x <<= 8; }
+	if(!(x & 0xf000000000000000ULL)) { n += 4; x <<= 4; }
+	if(!(x & 0xc000000000000000ULL)) { n += 2; x <<= 2; }
+	if(!(x & 0x8000000000000000ULL)) { n += 1; }
+	return n;
+}
+
+static int bitAt(const RsIpPrefix& p, int i)
+{
+	if(i < 64) return (p.hi >> (63 - i)) & 1;
+	return (p.lo >> (127 - i)) & 1;
+}
+
+/// Number of leading bits a and b have in common, at most limit
+static int commonLength(const RsIpPrefix& a, const RsIpPrefix& b, int limit)
+{
+	int n;
+	if(a.hi != b.hi) n = clz64(a.hi ^ b.hi);
+	else if(a.lo != b.lo) n = 64 + clz64(a.lo ^ b.lo);
+	else n = 128;
+	return n < limit ? n : limit;
+}
+
+static void maskPrefix(RsIpPrefix& p)
+{
+	int len = p.length;
+	if(len < 64) p.hi &= len ? ~0ULL << (64 - len) : 0;
+	if(len < 128) p.lo &= len > 64 ? ~0ULL << (128 - len) : 0;
+}
+
+/// Dotted quad with optional leading zeros, which inet_pton refuses
+static bool parseIpv4(const std::string& str, uint32_t& ip)
+{
+	unsigned int b[4];
+	char end;
+	if( sscanf(str.c_str(), "%u.%u.%u.%u%c", &b[0], &b[1], &b[2], &b[3], &end)
+	        != 4 ) return false;
+
+	ip = 0;
+	for(int i = 0; i < 4; ++i)
+	{
+		if(b[i] > 255) return false;
+		ip = (ip << 8) | b[i];
+	}
+	return true;
+}
+
+static std::string trim(const std::string& str)
+{
+	size_t first = str.find_first_not_of(" \t\r\n");
+	if(first == std::string::npos) return std::string();
+	size_t last = str.find_last_not_of(" \t\r\n");
+	return str.substr(first, last - first + 1);
+}
+
+bool RsIpPrefix::set(const sockaddr_storage& addr, int len)
+{
+	if(addr.ss_family == AF_INET)
+	{
+		if(len < 0 || len > 32) return false;
+
+		const sockaddr_in& in = reinterpret_cast<const sockaddr_in&>(addr);
+		hi = 0;
+		lo = IPV4_MAPPED | ntohl(in.sin_addr.s_addr);
+		length = 96 + len;
+	}
+	else if(addr.ss_family == AF_INET6)
+	{
+		if(len < 0 || len > 128) return false;
+
+		const sockaddr_in6& in6 = reinterpret_cast<const sockaddr_in6&>(addr);
+		const uint8_t* b = in6.sin6_addr.s6_addr;
+		hi = lo = 0;
+		for(int i = 0; i < 8; ++i) hi = (hi << 8) | b[i];
+		for(int i = 8; i < 16; ++i) lo = (lo << 8) | b[i];
+		length = len;
+	}
+	else return false;
+
+	maskPrefix(*this);
+	return true;
+}
+
+bool RsIpPrefix::fromString(const std::string& str)
+{
+	std::string addrStr = trim(str);
+	int len = -1;
+
+	size_t slash = addrStr.find('/');
+	if(slash != std::string::npos)
+	{
+		char end;
+		if( sscanf(addrStr.c_str() + slash + 1, "%d%c", &len, &end) != 1
+		        || len < 0 ) return false;
+		addrStr = trim(addrStr.substr(0, slash));
+	}
+
+	uint32_t ip4;
+	if(parseIpv4(addrStr, ip4))
+	{
+		if(len > 32) return false;
+		hi = 0;
+		lo = IPV4_MAPPED | ip4;
+		length = 96 + (len < 0 ? 32 : len);
+		maskPrefix(*this);
+		return true;
+	}
+
+	if(addrStr.find(':') == std::string::npos) return false;
+
+	sockaddr_storage addr;
+	if(!sockaddr_storage_inet_pton(addr, addrStr)) return false;
+	return set(addr, len < 0 ? 128 : len);
+}
+
+std::string RsIpPrefix::toString() const
+{
+	if(isIpv4())
+	{
+		char buf[32];
+		snprintf( buf, sizeof(buf), "%u.%u.%u.%u/%u",
+		          (unsigned int)(lo >> 24) & 0xff, (unsigned int)(lo >> 16) & 0xff,
+		          (unsigned int)(lo >> 8) & 0xff, (unsigned int)lo & 0xff,
+		          (unsigned int)length - 96 );
+		return buf;
+	}
+
+	sockaddr_storage addr;
+	sockaddr_storage_clear(addr);
+	addr.ss_family = AF_INET6;
+	uint8_t* b = reinterpret_cast<sockaddr_in6&>(addr).sin6_addr.s6_addr;
+	for(int i = 0; i < 8; ++i) b[i] = hi >> (56 - 8*i);
+	for(int i = 0; i < 8; ++i) b[8 + i] = lo >> (56 - 8*i);
+
+	std::string str;
+	sockaddr_storage_inet_ntop(addr, str);
+	return str + "/" + std::to_string(length);
+}
+
+bool RsIpPrefix::isIpv4() const
+{
+	return length >= 96 && hi == 0 && (lo >> 32) == (IPV4_MAPPED >> 32);
+}
+
+bool RsIpPrefix::contains(const RsIpPrefix& addr) const
+{
+	return addr.length >= length && commonLength(*this, addr, length) == length;
+}
+
+RsIpPrefixTrie::RsIpPrefixTrie() : mCount(0)
+{
+	clear();
+}
+
+void RsIpPrefixTrie::clear()
+{
+	mNodes.clear();
+	mCount = 0;
+	newNode(RsIpPrefix(), false, 0);	// root, the empty prefix
+}
+
+uint32_t RsIpPrefixTrie::newNode(
+        const RsIpPrefix& prefix, bool hasValue, uint32_t value )
+{
+	Node n;
+	n.prefix = prefix;
+	n.hasValue = hasValue;
+	n.value = value;
+	n.child[0] = n.child[1] = 0;
+	mNodes.push_back(n);
+
+	if(hasValue) ++mCount;
+	return static_cast<uint32_t>(mNodes.size() - 1);
+}
+
+void RsIpPrefixTrie::insert(const RsIpPrefix& p, uint32_t value)
+{
+	RsIpPrefix prefix(p);
+	maskPrefix(prefix);
+
+	// Indexes only, newNode() may move the nodes
+	uint32_t cur = 0;
+
+	for(;;)
+	{
+		// prefix starts with the prefix of cur
+		if(prefix.length == mNodes[cur].prefix.length)
+		{
+			if(!mNodes[cur].hasValue) ++mCount;
+			mNodes[cur].hasValue = true;
+			mNodes[cur].value = value;
+			return;
+		}
+
+		int b = bitAt(prefix, mNodes[cur].prefix.length);
+		uint32_t c = mNodes[cur].child[b];
+
+		if(!c)
+		{
+			uint32_t leaf = newNode(prefix, true, value);
+			mNodes[cur].child[b] = leaf;
+			return;
+		}
+
+		const RsIpPrefix cPrefix = mNodes[c].prefix;
+		int common = commonLength( prefix, cPrefix,
+		                           std::min(prefix.length, cPrefix.length) );
+
+		if(common == cPrefix.length)
+		{
+			cur = c;
+			continue;
+		}
+
+		if(common == prefix.length)
+		{
+			// The new prefix goes between cur and c
+			uint32_t n = newNode(prefix, true, value);
+			mNodes[n].child[bitAt(cPrefix, common)] = c;
+			mNodes[cur].child[b] = n;
+			return;
+		}
+
+		// Branch where the new prefix and the one of c differ
+		RsIpPrefix branch(prefix);
+		branch.length = common;
+		maskPrefix(branch);
+
+		uint32_t s = newNode(branch, false, 0);
+		uint32_t leaf = newNode(prefix, true, value);
+		mNodes[s].child[bitAt(cPrefix, common)] = c;
+		mNodes[s].child[bitAt(prefix, common)] = leaf;
+		mNodes[cur].child[b] = s;
+		return;
+	}
+}
+
+bool RsIpPrefixTrie::lookup(const RsIpPrefix& addr, uint32_t& value) const
+{
+	const Node* n = &mNodes[0];
+	bool found = n->hasValue;
+	if(found) value = n->value;
+
+	while(n->prefix.length < 128)
+	{
+		uint32_t c = n->child[bitAt(addr, n->prefix.length)];
+		if(!c) break;
+
+		n = &mNodes[c];
+		if(commonLength(n->prefix, addr, n->prefix.length) < n->prefix.length)
+			break;
+
+		if(n->hasValue)
+		{
+			found = true;
+			value = n->value;
+		}
+	}
+
+	return found;
+}
+
+bool RsIpPrefixTrie::lookup(const sockaddr_storage& addr, uint32_t& value) const
+{
+	RsIpPrefix p;
+	if(!p.set(addr, addr.ss_family == AF_INET ? 32 : 128)) return false;
+	return lookup(p, value);
+}
+
+void rsIpRangeToPrefixes( const RsIpPrefix& first, const RsIpPrefix& last,
+                          std::vector<RsIpPrefix>& prefixes )
+{
+	RsIpPrefix cur(first);
+	cur.length = 128;
+
+	while(cur.hi < last.hi || (cur.hi == last.hi && cur.lo <= last.lo))
+	{
+		// Biggest aligned block starting at cur that ends before last
+		int zeros;
+		if(cur.lo) zeros = 63 - clz64(cur.lo & (~cur.lo + 1));
+		else if(cur.hi) zeros = 64 + 63 - clz64(cur.hi & (~cur.hi + 1));
+		else zeros = 128;
+
+		RsIpPrefix end;
+		for(int k = zeros; k >= 0; --k)
+		{
+			end.hi = k > 64 ? cur.hi | (k == 128 ? ~0ULL : (1ULL << (k - 64)) - 1) : cur.hi;
+			end.lo = k >= 64 ? ~0ULL : cur.lo | ((1ULL << k) - 1);
+
+			if(end.hi < last.hi || (end.hi == last.hi && end.lo <= last.lo))
+			{
+				RsIpPrefix p(cur);
+				p.length = 128 - k;
+				prefixes.push_back(p);
+				break;
+			}
+		}
+
+		// end + 1, stop at the end of the address space
+		if(end.lo == ~0ULL && end.hi == ~0ULL) break;
+		cur.lo = end.lo + 1;
+		cur.hi = end.hi + (cur.lo == 0 ? 1 : 0);
+	}
+}
+
+bool rsParseIpBlocklistLine( const std::string& rawLine,
+                             std::vector<RsIpPrefix>& prefixes )
+{
+	std::string line = trim(rawLine);
+	if(line.empty() || line[0] == '#' || line[0] == ';') return false;
+
+	// DAT format, the range is before the first comma
+	size_t comma = line.find(',');
+	if(comma != std::string::npos) line = trim(line.substr(0, comma));
+
+	// P2P format, a description then a IPv4 range after the last colon
+	size_t colon = line.rfind(':');
+	if(colon != std::string::npos)
+	{
+		std::string tail = line.substr(colon + 1);
+		if( tail.find('.') != std::string::npos &&
+		        tail.find('-') != std::string::npos ) line = trim(tail);
+	}
+
+	size_t dash = line.find('-');
+	if(dash == std::string::npos)
+	{
+		RsIpPrefix p;
+		if(!p.fromString(line)) return false;
+		prefixes.push_back(p);
+		return true;
+	}
+
+	RsIpPrefix first, last;
+	if( !first.fromString(line.substr(0, dash)) ||
+	        !last.fromString(line.substr(dash + 1)) ) return false;
+
+	if( first.isIpv4() != last.isIpv4() ||
+	        first.length != 128 || last.length != 128 ) return false;
+
+	if(last.hi < first.hi || (last.hi == first.hi && last.lo < first.lo))
+		return false;
+
+	rsIpRangeToPrefixes(first, last, prefixes);
+	return true;
+}
+
+bool rsLoadIpBlocklist( const std::string& path,
+                        std::vector<RsIpPrefix>& prefixes, uint32_t& badLines )
+{
+	badLines = 0;
+
+	FILE* f = RsDirUtil::rs_fopen(path.c_str(), "r");
+	if(!f) return false;
+
+	char buf[1024];
+	std::string line;
+
+	while(fgets(buf, sizeof(buf), f))
+	{
+		line += buf;
+		if(!line.empty() && line[line.length() - 1] != '\n' && !feof(f))
+			continue;	// longer than the buffer
+
+		std::string entry = trim(line);
+		line.clear();
+
+		if(entry.empty() || entry[0] == '#' || entry[0] == ';') continue;
+		if(!rsParseIpBlocklistLine(entry, prefixes)) ++badLines;
+	}
+
+	fclose(f);
+	return true;
+}
@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsiptrie.h                                          *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "util/rsnet.h"
+
+/**
+ * @brief IPv4 or IPv6 network prefix.
+ * Addresses are stored as IPv6, IPv4 ones as IPv4-mapped IPv6 (::ffff:a.b.c.d)
+ * so a IPv4 /24 is a /120. Bits after the prefix length are always zero.
+ */
+struct RsIpPrefix
+{
+	RsIpPrefix() : hi(0), lo(0), length(0) {}
+
+	/// Prefix of given length of the address, length counted in IPv4 bits for
+	/// IPv4 addresses. @return false if the address is neither IPv4 nor IPv6
+	bool set(const sockaddr_storage& addr, int length);
+
+	/**
+	 * @brief Parse "a.b.c.d", "a.b.c.d/n", "2001:db8::1" or "2001:db8::/n"
+	 * @return false if the text is not a valid address or prefix
+	 */
+	bool fromString(const std::string& str);
+
+	std::string toString() const;
+
+	bool isIpv4() const;
+
+	/// true if addr is in the prefix
+	bool contains(const RsIpPrefix& addr) const;
+
+	uint64_t hi;
+	uint64_t lo;
+	uint8_t length;	/// in bits, 0 to 128
+};
+
+/**
+ * @brief Path-compressed binary trie of IP prefixes, for longest prefix match.
+ * Nodes are kept in one array and only exist where prefixes end or branch, so
+ * a lookup visits at most one node per distinct prefix length on the path,
+ * whatever the number of prefixes.
+ * Not thread safe. The intended use is to build a trie, then publish it and
+ * never modify it again, concurrent lookups need no locking then.
+ */
+class RsIpPrefixTrie
+{
+public:
+	RsIpPrefixTrie();
+
+	/// Add a prefix, an existing value for the same prefix is replaced
+	void insert(const RsIpPrefix& prefix, uint32_t value);
+
+	/**
+	 * @brief Longest prefix match
+	 * @param[in] addr address, with length 128
+	 * @param[out] value value of the longest prefix containing addr
+	 * @return false if no prefix contains addr
+	 */
+	bool lookup(const RsIpPrefix& addr, uint32_t& value) const;
+	bool lookup(const sockaddr_storage& addr, uint32_t& value) const;
+
+	/// Number of prefixes
+	size_t size() const { return mCount; }
+	bool empty() const { return mCount == 0; }
+
+	void clear();
+
+private:
+	struct Node
+	{
+		RsIpPrefix prefix;
+		bool hasValue;
+		uint32_t value;
+		uint32_t child[2];	/// 0 for none, the root is never a child
+	};
+
+	uint32_t newNode(const RsIpPrefix& prefix, bool hasValue, uint32_t value);
+
+	std::vector<Node> mNodes;
+	size_t mCount;
+};
+
+/**
+ * @brief Read a blocklist file.
+ * Supported line formats, one entry per line:
+ *   CIDR or single address:  1.2.3.0/24  2001:db8::/32  1.2.3.4
+ *   address range:           1.2.3.0 - 1.2.3.255
+ *   P2P (PeerGuardian):      some description:1.2.3.0-1.2.3.255
+ *   DAT (eMule ipfilter):    001.002.003.000 - 001.002.003.255 , 000 , desc
+ * Empty lines and lines starting with '#' or ';' are skipped, as well as lines
+ * that don't parse. Ranges are turned into the smallest set of prefixes.
+ * @param[in] path file to read
+ * @param[out] prefixes prefixes are appended here
+ * @param[out] badLines number of lines that could not be parsed
+ * @return false if the file could not be read
+ */
+bool rsLoadIpBlocklist( const std::string& path,
+                        std::vector<RsIpPrefix>& prefixes, uint32_t& badLines );
+
+/**
+ * @brief Parse one blocklist line, see rsLoadIpBlocklist
+ * @return false if the line holds no entry or does not parse
+ */
+bool rsParseIpBlocklistLine( const std::string& line,
+                             std::vector<RsIpPrefix>& prefixes );
+
+/// Smallest set of prefixes covering first to last included, appended
+void rsIpRangeToPrefixes( const RsIpPrefix& first, const RsIpPrefix& last,
+                          std::vector<RsIpPrefix>& prefixes );
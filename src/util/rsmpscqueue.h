@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsmpscqueue.h                                       *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+/**
+ * @brief Unbounded lock-free multiple producers, single consumer FIFO queue.
+ * push() is one atomic exchange and may be called from any thread. pop() must
+ * only be called by one thread at a time.
+ * A value pushed while pop() runs may not be seen until the next pop(), even
+ * if pushed before, so pop() returning false doesn't mean that nothing is
+ * coming: callers should keep their own count when this matters.
+ */
+template<class T> class RsMpscQueue
+{
+public:
+	RsMpscQueue() : mHead(new Node()), mTail(mHead.load()) {}
+
+	~RsMpscQueue()
+	{
+		T value;
+		while(pop(value)) {}
+		delete mTail;
+	}
+
+	void push(T value)
+	{
+		Node *node = new Node();
+		node->value = std::move(value);
+
+		Node *prev = mHead.exchange(node, std::memory_order_acq_rel);
+		prev->next.store(node, std::memory_order_release);
+	}
+
+	/// @return false if the queue is empty
+	bool pop(T& value)
+	{
+		Node *tail = mTail;
+		Node *next = tail->next.load(std::memory_order_acquire);
+
+		if(!next) return false;
+
+		value = std::move(next->value);
+		mTail = next;	// next becomes the new stub node
+		delete tail;
+		return true;
+	}
+
+private:
+	struct Node
+	{
+		Node() : next(nullptr), value() {}
+
+		std::atomic<Node*> next;
+		T value;
+	};
+
+	RsMpscQueue(const RsMpscQueue&) = delete;
+	RsMpscQueue& operator=(const RsMpscQueue&) = delete;
+
+	std::atomic<Node*> mHead;	/// last pushed node, shared by producers
+	Node *mTail;	/// stub node, consumer only
+};
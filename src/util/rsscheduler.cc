@@ -0,0 +1,520 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsscheduler.cc                                      *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <algorithm>
+#include <limits>
+
+#include "util/rsscheduler.h"
+#include "util/rsdebug.h"
+
+//#define DEBUG_RSSCHEDULER 1
+
+/// Resolution of the timers
+static const std::chrono::milliseconds SCHEDULER_TICK(10);
+
+/// All workers busy for that long with jobs waiting is reported as a stall
+static const std::chrono::seconds SCHEDULER_STALL_DELAY(10);
+static const std::chrono::seconds SCHEDULER_STALL_CHECK(1);
+
+/// Scheduler, worker and job being run by the current thread, if any. Job
+/// ids and worker numbers only make sense for that scheduler.
+static thread_local const RsScheduler* sCurrentScheduler = nullptr;
+static thread_local int sCurrentWorker = -1;
+static thread_local RsScheduler::JobId sCurrentJob = 0;
+
+/******************************************************************************/
+/*                                RsTimerWheel                                */
+/******************************************************************************/
+
+RsTimerWheel::RsTimerWheel(uint64_t now) : mCurrent(now), mCount(0) {}
+
+void RsTimerWheel::add(uint64_t id, uint64_t expiry)
+{
+	Timer t;
+	t.id = id;
+	t.expiry = std::max(expiry, mCurrent);
+
+	insert(t);
+	++mCount;
+}
+
+void RsTimerWheel::insert(const Timer& t)
+{
+	/* The timer goes in the lowest level whose window contains both now and
+	 * the expiry, i.e. they only differ by the bits of this level and the
+	 * ones below. */
+	for(int l = 0; l < LEVELS; ++l)
+	{
+		int shift = BITS*(l+1);
+		if((t.expiry >> shift) == (mCurrent >> shift))
+		{
+			mSlots[l][(t.expiry >> (BITS*l)) & (SLOTS-1)].push_back(t);
+			return;
+		}
+	}
+	mOverflow.push_back(t);
+}
+
+void RsTimerWheel::cascade(int level)
+{
+	std::vector<Timer> timers;
+	timers.swap(mSlots[level][(mCurrent >> (BITS*level)) & (SLOTS-1)]);
+
+	for(const Timer& t: timers) insert(t);
+}
+
+void RsTimerWheel::advance(uint64_t now, std::vector<uint64_t>& expired)
+{
+	while(mCurrent <= now)
+	{
+		if(!mCount)
+		{
+			mCurrent = now + 1;
+			return;
+		}
+
+		if(!(mCurrent & (SLOTS-1)))
+		{
+			/* Entering a new level 1 slot. Timers of the upper levels are
+			 * moved down starting from the highest level which changed. */
+			int top = 1;
+			while(top < LEVELS && !((mCurrent >> (BITS*top)) & (SLOTS-1)))
+				++top;
+
+			if(top == LEVELS)
+			{
+				std::vector<Timer> timers;
+				timers.swap(mOverflow);
+				for(const Timer& t: timers) insert(t);
+				top = LEVELS-1;
+			}
+
+			for(int l = top; l >= 1; --l) cascade(l);
+		}
+
+		std::vector<Timer>& slot(mSlots[0][mCurrent & (SLOTS-1)]);
+		for(const Timer& t: slot) expired.push_back(t.id);
+		mCount -= slot.size();
+		slot.clear();
+
+		++mCurrent;
+	}
+}
+
+uint64_t RsTimerWheel::nextExpiry() const
+{
+	if(!mCount) return std::numeric_limits<uint64_t>::max();
+
+	uint64_t end = (mCurrent | (SLOTS-1)) + 1;
+	for(uint64_t t = mCurrent; t < end; ++t)
+		if(!mSlots[0][t & (SLOTS-1)].empty())
+			return t;
+
+	/* nothing on level 0, timers need to be cascaded at the beginning of the
+	 * next slot of level 1 */
+	return end;
+}
+
+/******************************************************************************/
+/*                                RsScheduler                                 */
+/******************************************************************************/
+
+/*static*/ RsScheduler& RsScheduler::instance()
+{
+	static RsScheduler scheduler;
+	return scheduler;
+}
+
+RsScheduler::RsScheduler() :
+    mLastJobId(0), mWheel(0), mStartTime(std::chrono::steady_clock::now()),
+    mRunning(false), mNextWorker(0), mQueuedJobs(0), mBusyWorkers(0),
+    mAllBusy(false), mStallReported(false), mRuns(0), mTimerWakeups(0),
+    mExplicitWakeups(0), mSteals(0), mStalls(0) {}
+
+RsScheduler::~RsScheduler() { stop(); }
+
+uint64_t RsScheduler::currentTick() const
+{
+	return static_cast<uint64_t>(
+	            (std::chrono::steady_clock::now() - mStartTime) / SCHEDULER_TICK );
+}
+
+void RsScheduler::start(uint32_t workers)
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+	if(mRunning) return;
+
+	if(!workers)
+		workers = std::max(4u, std::thread::hardware_concurrency());
+
+	mRunning = true;
+
+	for(uint32_t i = 0; i < workers; ++i)
+		mWorkers.push_back(std::unique_ptr<Worker>(new Worker));
+
+	/* Jobs left from a previous start run again right away */
+	for(auto& it: mJobs)
+	{
+		it.second.state = JobState::QUEUED;
+		++it.second.generation;
+		enqueue(it.first);
+	}
+
+	for(size_t i = 0; i < mWorkers.size(); ++i)
+		mWorkers[i]->thread = std::thread(&RsScheduler::workerLoop, this, i);
+	mTimerThread = std::thread(&RsScheduler::timerLoop, this);
+
+	RsInfo() << __PRETTY_FUNCTION__ << " started with " << workers
+	         << " workers" << std::endl;
+}
+
+void RsScheduler::stop()
+{
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+		if(!mRunning) return;
+
+		mRunning = false;
+		mWorkCond.notify_all();
+		mTimerCond.notify_all();
+	}
+
+	for(auto& w: mWorkers) w->thread.join();
+	mTimerThread.join();
+
+	std::unique_lock<std::mutex> lock(mMtx);
+	mWorkers.clear();
+	mQueuedJobs = 0;
+	mAllBusy = false;
+	mWheel = RsTimerWheel(currentTick());
+}
+
+RsScheduler::JobId RsScheduler::addJob(
+        const std::string& name, const std::function<void()>& job,
+        std::chrono::milliseconds period )
+{
+	start();
+
+	std::unique_lock<std::mutex> lock(mMtx);
+
+	JobId id = ++mLastJobId;
+	if(!id) id = ++mLastJobId;
+
+	Job& j(mJobs[id]);
+	j.name = name;
+	j.fn = job;
+	j.period = std::max<uint64_t>(1, period / SCHEDULER_TICK);
+	j.generation = 0;
+	j.state = JobState::QUEUED;
+	j.rerun = false;
+	j.removed = false;
+	j.runs = 0;
+
+	enqueue(id);
+
+#ifdef DEBUG_RSSCHEDULER
+	RsDbg() << __PRETTY_FUNCTION__ << " " << name << " id: " << id
+	        << " period: " << period.count() << "ms" << std::endl;
+#endif
+	return id;
+}
+
+void RsScheduler::removeJob(JobId id)
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+
+	auto it = mJobs.find(id);
+	if(it == mJobs.end()) return;
+
+	it->second.removed = true;
+
+	if(it->second.state != JobState::RUNNING)
+	{
+		/* timers and queue entries of this job are ignored from now on */
+		mJobs.erase(it);
+		return;
+	}
+
+	/* runJob() removes it when done */
+	if(sCurrentScheduler == this && sCurrentJob == id) return;
+
+	mJobDoneCond.wait(lock, [&]() { return mJobs.find(id) == mJobs.end(); });
+}
+
+void RsScheduler::wakeup(JobId id)
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+
+	auto it = mJobs.find(id);
+	if(it == mJobs.end() || it->second.removed) return;
+
+	++mExplicitWakeups;
+
+	switch(it->second.state)
+	{
+	case JobState::IDLE:
+		it->second.state = JobState::QUEUED;
+		++it->second.generation;	// cancels the pending timer
+		enqueue(id);
+		break;
+	case JobState::QUEUED:
+		break;
+	case JobState::RUNNING:
+		it->second.rerun = true;
+		break;
+	}
+}
+
+RsScheduler::Statistics RsScheduler::getStatistics()
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+
+	Statistics s;
+	s.threads = mRunning ? mWorkers.size() + 1 : 0;
+	s.jobs = mJobs.size();
+	s.runs = mRuns;
+	s.timerWakeups = mTimerWakeups;
+	s.explicitWakeups = mExplicitWakeups;
+	s.steals = mSteals;
+	s.busyWorkers = mBusyWorkers;
+	s.queuedJobs = mQueuedJobs;
+	s.stalls = mStalls;
+
+	auto now = std::chrono::steady_clock::now();
+	s.longestRunMs = 0;
+	for(auto& it: mJobs)
+		if(it.second.state == JobState::RUNNING)
+			s.longestRunMs = std::max<uint64_t>( s.longestRunMs,
+			            std::chrono::duration_cast<std::chrono::milliseconds>(
+			                now - it.second.runStart ).count() );
+	return s;
+}
+
+void RsScheduler::armTimer(JobId id, Job& job)
+{
+	uint64_t expiry = currentTick() + job.period;
+	uint64_t nextWake = mWheel.nextExpiry();
+
+	++job.generation;
+	mWheel.add((static_cast<uint64_t>(id) << 32) | job.generation, expiry);
+
+	if(expiry < nextWake) mTimerCond.notify_one();
+}
+
+void RsScheduler::enqueue(JobId id)
+{
+	if(mWorkers.empty()) return;	// will be queued by start()
+
+	/* jobs woken up by a job stay on the same worker, which is likely to be
+	 * free soon, and has the data in cache */
+	size_t w;
+	if( sCurrentScheduler == this && sCurrentWorker >= 0 &&
+	        static_cast<size_t>(sCurrentWorker) < mWorkers.size() )
+		w = sCurrentWorker;
+	else
+		w = (mNextWorker++) % mWorkers.size();
+
+	{
+		std::unique_lock<std::mutex> wlock(mWorkers[w]->mtx);
+		mWorkers[w]->queue.push_back(id);
+	}
+
+	++mQueuedJobs;
+	mWorkCond.notify_one();
+}
+
+bool RsScheduler::popJob(size_t worker, JobId& id)
+{
+	size_t n = mWorkers.size();
+
+	for(size_t i = 0; i < n; ++i)
+	{
+		Worker& w(*mWorkers[(worker + i) % n]);
+		std::unique_lock<std::mutex> wlock(w.mtx);
+
+		if(w.queue.empty()) continue;
+
+		/* own jobs in order, steal the most recent ones from the others */
+		if(!i)
+		{
+			id = w.queue.front();
+			w.queue.pop_front();
+		}
+		else
+		{
+			id = w.queue.back();
+			w.queue.pop_back();
+			++mSteals;
+		}
+		--mQueuedJobs;
+		return true;
+	}
+	return false;
+}
+
+void RsScheduler::runJob(JobId id)
+{
+	std::function<void()> fn;
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+
+		auto it = mJobs.find(id);
+		if( it == mJobs.end() || it->second.removed ||
+		        it->second.state != JobState::QUEUED ) return;
+
+		it->second.state = JobState::RUNNING;
+		it->second.rerun = false;
+		it->second.runStart = std::chrono::steady_clock::now();
+		fn = it->second.fn;
+
+		/* let the timer thread watch for stalls */
+		if(++mBusyWorkers == mWorkers.size()) mTimerCond.notify_one();
+	}
+
+	sCurrentJob = id;
+	fn();
+	sCurrentJob = 0;
+
+	std::unique_lock<std::mutex> lock(mMtx);
+	--mBusyWorkers;
+	++mRuns;
+
+	auto it = mJobs.find(id);
+	if(it == mJobs.end()) return;
+
+	Job& job(it->second);
+	++job.runs;
+
+	if(job.removed)
+	{
+		mJobs.erase(it);
+		mJobDoneCond.notify_all();
+	}
+	else if(job.rerun)
+	{
+		job.state = JobState::QUEUED;
+		enqueue(id);
+	}
+	else
+	{
+		job.state = JobState::IDLE;
+		armTimer(id, job);
+	}
+}
+
+void RsScheduler::workerLoop(size_t worker)
+{
+	sCurrentScheduler = this;
+	sCurrentWorker = static_cast<int>(worker);
+
+	while(true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMtx);
+			mWorkCond.wait(lock, [&]() { return !mRunning || mQueuedJobs > 0; });
+			if(!mRunning) break;
+		}
+
+		JobId id;
+		while(popJob(worker, id)) runJob(id);
+	}
+
+	sCurrentWorker = -1;
+	sCurrentScheduler = nullptr;
+}
+
+void RsScheduler::timerLoop()
+{
+	std::vector<uint64_t> expired;
+	std::unique_lock<std::mutex> lock(mMtx);
+
+	while(mRunning)
+	{
+		expired.clear();
+		mWheel.advance(currentTick(), expired);
+
+		for(uint64_t t: expired)
+		{
+			JobId id = static_cast<JobId>(t >> 32);
+			uint32_t generation = static_cast<uint32_t>(t);
+
+			auto it = mJobs.find(id);
+			if( it == mJobs.end() || it->second.removed ||
+			        it->second.state != JobState::IDLE ||
+			        it->second.generation != generation ) continue;
+
+			it->second.state = JobState::QUEUED;
+			++mTimerWakeups;
+			enqueue(id);
+		}
+
+		checkStall();
+
+		auto wakeAt = std::chrono::steady_clock::time_point::max();
+		uint64_t next = mWheel.nextExpiry();
+		if(next != std::numeric_limits<uint64_t>::max())
+			wakeAt = mStartTime + next * SCHEDULER_TICK;
+		if(mAllBusy)
+			wakeAt = std::min( wakeAt,
+			                   std::chrono::steady_clock::now() + SCHEDULER_STALL_CHECK );
+
+		if(wakeAt == std::chrono::steady_clock::time_point::max())
+			mTimerCond.wait(lock);
+		else
+			mTimerCond.wait_until(lock, wakeAt);
+	}
+}
+
+void RsScheduler::checkStall()
+{
+	if(mWorkers.empty() || mBusyWorkers < mWorkers.size() || !mQueuedJobs)
+	{
+		mAllBusy = false;
+		mStallReported = false;
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if(!mAllBusy)
+	{
+		mAllBusy = true;
+		mAllBusySince = now;
+		return;
+	}
+
+	if(mStallReported || now - mAllBusySince < SCHEDULER_STALL_DELAY) return;
+
+	mStallReported = true;
+	++mStalls;
+
+	RsWarn() << __PRETTY_FUNCTION__ << " all " << mWorkers.size()
+	         << " workers busy for more than "
+	         << SCHEDULER_STALL_DELAY.count() << "s, " << mQueuedJobs
+	         << " jobs waiting. Running jobs:" << std::endl;
+
+	for(auto& it: mJobs)
+		if(it.second.state == JobState::RUNNING)
+			RsWarn() << "  " << it.second.name << " for "
+			         << std::chrono::duration_cast<std::chrono::seconds>(
+			                now - it.second.runStart ).count()
+			         << "s" << std::endl;
+}
@@ -0,0 +1,219 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsscheduler.h                                       *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Hierarchical timer wheel.
+ * Time is counted in ticks of arbitrary length. Timers are stored in 4 levels
+ * of 64 slots, level n slots being 64^n ticks wide, so adding a timer and
+ * expiring one are O(1) whatever the number of timers. Timers further than
+ * 64^4 ticks away wait in an overflow list.
+ * Not thread safe, the caller is expected to lock.
+ */
+class RsTimerWheel
+{
+public:
+	explicit RsTimerWheel(uint64_t now = 0);
+
+	/// Add timer id expiring at given tick. Ids don't need to be unique.
+	void add(uint64_t id, uint64_t expiry);
+
+	/**
+	 * Move time forward.
+	 * @param[in] now current tick
+	 * @param[out] expired ids of all timers with expiry <= now are appended
+	 */
+	void advance(uint64_t now, std::vector<uint64_t>& expired);
+
+	/**
+	 * @return a tick at which advance() must be called at the latest. This is
+	 * the exact expiry of the next timer when it is close, an intermediate
+	 * tick otherwise. UINT64_MAX if there is no timer.
+	 */
+	uint64_t nextExpiry() const;
+
+	size_t size() const { return mCount; }
+
+private:
+	static const int LEVELS = 4;
+	static const int BITS = 6;
+	static const uint64_t SLOTS = 1 << BITS;
+
+	struct Timer
+	{
+		uint64_t id;
+		uint64_t expiry;
+	};
+
+	void insert(const Timer& t);
+	void cascade(int level);
+
+	std::vector<Timer> mSlots[LEVELS][SLOTS];
+	std::vector<Timer> mOverflow;
+	uint64_t mCurrent;	/// next tick to be processed
+	size_t mCount;
+};
+
+/**
+ * @brief Runs periodic jobs on a small pool of threads.
+ * Services register a job with a period instead of owning a thread that
+ * sleeps between ticks. A job can also be woken up explicitly (e.g. when an
+ * item is queued), then it runs as soon as a worker is available. A given job
+ * never runs concurrently with itself, and wakeups happening while it runs
+ * make it run once more.
+ * Workers keep their own queue and steal from the others when idle, so that
+ * a job woken up by a job runs on the same worker when possible.
+ * Jobs are expected to return quickly. A job which blocks (network, disk,
+ * waiting for another job...) keeps its worker busy all that time, and when
+ * all workers are busy the other jobs don't run at all, so long blocking
+ * operations belong in a dedicated thread. The timer thread warns when all
+ * workers have been busy for a while with jobs waiting, naming the running
+ * jobs, and counts it in Statistics::stalls.
+ */
+class RsScheduler
+{
+public:
+	typedef uint32_t JobId;
+
+	struct Statistics
+	{
+		uint32_t threads;          /// workers + timer thread
+		uint32_t jobs;
+		uint64_t runs;
+		uint64_t timerWakeups;     /// jobs started because their period elapsed
+		uint64_t explicitWakeups;  /// calls to wakeup()
+		uint64_t steals;           /// jobs run by another worker
+		uint32_t busyWorkers;      /// workers running a job
+		uint32_t queuedJobs;       /// jobs waiting for a worker
+		uint64_t longestRunMs;     /// time since the oldest running job started
+		uint64_t stalls;           /// all workers busy for too long with jobs waiting
+	};
+
+	/// Scheduler shared by all libretroshare services
+	static RsScheduler& instance();
+
+	RsScheduler();
+	~RsScheduler();
+
+	/**
+	 * @brief Start the threads, done by addJob() if needed.
+	 * @param workers number of worker threads, 0 to use the number of cores
+	 *	(at least 4 as jobs may block on I/O)
+	 */
+	void start(uint32_t workers = 0);
+
+	/// Stop all threads. Registered jobs are kept but won't run anymore.
+	void stop();
+
+	/**
+	 * @brief Register a periodic job. It first runs right away.
+	 * @param name for debugging purposes
+	 * @param job function to run
+	 * @param period maximum time between two runs
+	 * @return job id, never 0
+	 */
+	JobId addJob( const std::string& name, const std::function<void()>& job,
+	              std::chrono::milliseconds period );
+
+	/**
+	 * @brief Unregister a job. If it is running, wait for it to finish,
+	 * unless called from the job itself.
+	 */
+	void removeJob(JobId id);
+
+	/// Run the job as soon as possible
+	void wakeup(JobId id);
+
+	Statistics getStatistics();
+
+private:
+	enum class JobState : uint8_t { IDLE, QUEUED, RUNNING };
+
+	struct Job
+	{
+		std::string name;
+		std::function<void()> fn;
+		uint64_t period;       /// in wheel ticks
+		uint32_t generation;   /// invalidates older timers of this job
+		JobState state;
+		bool rerun;
+		bool removed;
+		uint64_t runs;
+		std::chrono::steady_clock::time_point runStart;
+	};
+
+	struct Worker
+	{
+		std::mutex mtx;
+		std::deque<JobId> queue;
+		std::thread thread;
+	};
+
+	uint64_t currentTick() const;
+	void armTimer(JobId id, Job& job);
+	void enqueue(JobId id);	/// mMtx must be locked
+	bool popJob(size_t worker, JobId& id);
+	void runJob(JobId id);
+	void checkStall();	/// mMtx must be locked
+
+	void workerLoop(size_t worker);
+	void timerLoop();
+
+	std::mutex mMtx;	/// protects everything below but the worker queues
+	std::condition_variable mWorkCond;
+	std::condition_variable mTimerCond;
+	std::condition_variable mJobDoneCond;
+
+	std::map<JobId, Job> mJobs;
+	JobId mLastJobId;
+	RsTimerWheel mWheel;
+	std::chrono::steady_clock::time_point mStartTime;
+
+	std::vector<std::unique_ptr<Worker>> mWorkers;
+	std::thread mTimerThread;
+	bool mRunning;
+	size_t mNextWorker;
+	std::atomic<size_t> mQueuedJobs;	/// incremented with mMtx locked
+	size_t mBusyWorkers;
+	bool mAllBusy;
+	bool mStallReported;
+	std::chrono::steady_clock::time_point mAllBusySince;
+
+	uint64_t mRuns;
+	uint64_t mTimerWakeups;
+	uint64_t mExplicitWakeups;
+	std::atomic<uint64_t> mSteals;
+	uint64_t mStalls;
+};
@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsstartuptimeline.cc                                *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+#include "util/rsstartuptimeline.h"
+#include "util/rsdebug.h"
+
+/*static*/ RsStartupTimeline& RsStartupTimeline::instance()
+{
+	static RsStartupTimeline timeline;
+	return timeline;
+}
+
+RsStartupTimeline::RsStartupTimeline() :
+    mStartTime(std::chrono::steady_clock::now()) {}
+
+double RsStartupTimeline::now() const
+{
+	return std::chrono::duration<double>(
+	            std::chrono::steady_clock::now() - mStartTime ).count();
+}
+
+void RsStartupTimeline::record( const std::string& phase,
+                                const std::string& name,
+                                double start, double end )
+{
+	Entry e;
+	e.phase = phase;
+	e.name = name;
+	e.start = start;
+	e.end = end;
+
+	std::lock_guard<std::mutex> lock(mMtx);
+	mEntries.push_back(e);
+}
+
+void RsStartupTimeline::writeReport(std::ostream& out) const
+{
+	std::lock_guard<std::mutex> lock(mMtx);
+
+	out << "{ \"startup_timeline\": [" << std::endl;
+	for(size_t i = 0; i < mEntries.size(); ++i)
+	{
+		const Entry& e = mEntries[i];
+		out << "  { \"phase\": \"" << e.phase << "\", \"name\": \"" << e.name
+		    << "\", \"start_s\": " << e.start << ", \"duration_s\": "
+		    << e.end - e.start << " }"
+		    << (i + 1 < mEntries.size() ? "," : "") << std::endl;
+	}
+	out << "] }" << std::endl;
+}
+
+void RsStartupTimeline::finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+
+		/* Wall time of a phase goes from its first step start to its last
+		 * step end, which is less than the sum of the steps when they run
+		 * concurrently. */
+		std::map<std::string, std::pair<double, double> > phases;
+		std::map<std::string, double> sums;
+		for(const Entry& e: mEntries)
+		{
+			auto it = phases.find(e.phase);
+			if(it == phases.end())
+				phases[e.phase] = std::make_pair(e.start, e.end);
+			else
+			{
+				it->second.first = std::min(it->second.first, e.start);
+				it->second.second = std::max(it->second.second, e.end);
+			}
+			sums[e.phase] += e.end - e.start;
+		}
+
+		RsInfo() << "Startup timeline, total: " << now() << "s" << std::endl;
+		for(auto& it: phases)
+			RsInfo() << "  " << it.first << ": "
+			         << it.second.second - it.second.first << "s (steps: "
+			         << sums[it.first] << "s)" << std::endl;
+	}
+
+	const char* filename = getenv("RS_STARTUP_TIMELINE");
+	if(!filename || !*filename) return;
+
+	std::ofstream out(filename, std::ios::app);
+	if(out) writeReport(out);
+	else RsErr() << __PRETTY_FUNCTION__ << " cannot open " << filename
+	             << std::endl;
+}
+
+RsStartupTimeline::Step::Step(const std::string& phase, const std::string& name) :
+    mPhase(phase), mName(name), mStart(RsStartupTimeline::instance().now()) {}
+
+RsStartupTimeline::Step::~Step()
+{
+	RsStartupTimeline& timeline = RsStartupTimeline::instance();
+	timeline.record(mPhase, mName, mStart, timeline.now());
+}
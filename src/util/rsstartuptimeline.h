@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * libretroshare/src/util: rsstartuptimeline.h                                 *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright 2026 by Retroshare Team <contact@retroshare.cc>                   *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Lesser General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ *******************************************************************************/
+#pragma once
+
+#include <chrono>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Records how long each step of the core startup takes.
+ * Steps are grouped by phase (e.g. "gxs_databases", "config_read") and can be
+ * recorded from several threads, so that steps running concurrently show up
+ * as overlapping intervals.
+ * When the core is started, a per phase summary is logged and, if the
+ * RS_STARTUP_TIMELINE environment variable names a file, the whole timeline
+ * is appended to it as JSON, for regression tracking.
+ */
+class RsStartupTimeline
+{
+public:
+	static RsStartupTimeline& instance();
+
+	/// Records the time between its construction and its destruction
+	class Step
+	{
+	public:
+		Step(const std::string& phase, const std::string& name);
+		~Step();
+
+	private:
+		std::string mPhase;
+		std::string mName;
+		double mStart;
+	};
+
+	/// Seconds since the start of the timeline
+	double now() const;
+
+	void record( const std::string& phase, const std::string& name,
+	             double start, double end );
+
+	void writeReport(std::ostream& out) const;
+
+	/// Log the summary and write the report if requested
+	void finish();
+
+private:
+	RsStartupTimeline();
+
+	struct Entry
+	{
+		std::string phase;
+		std::string name;
+		double start;
+		double end;
+	};
+
+	const std::chrono::steady_clock::time_point mStartTime;
+
+	mutable std::mutex mMtx;	/// protects mEntries
+	std::vector<Entry> mEntries;
+};
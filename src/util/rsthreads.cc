@@ -25,6 +25,7 @@
 #include "rsthreads.h"
 
 #include "util/rsdebug.h"
+#include "util/rsscheduler.h"
 
 #include <chrono>
 #include <ctime>
@@ -238,6 +239,52 @@ bool RsThread::start(const std::string& threadName)
 	return false;
 }
 
+bool RsThread::markRunning(const std::string& threadName)
+{
+	if(!mHasStopped.exchange(false)) return false;
+
+	mShouldStop = false;
+	mFullName = threadName;
+	return true;
+}
+
+bool RsThread::markStopped() { return !mHasStopped.exchange(true); }
+
+bool RsTickingThread::startScheduled(
+        const std::string& threadName, std::chrono::milliseconds period )
+{
+	if(!markRunning(threadName)) return false;
+
+	mScheduled = true;
+	mSchedulerJob = RsScheduler::instance().addJob(
+	            threadName, [this]() { scheduledTick(); }, period );
+	return true;
+}
+
+void RsTickingThread::wakeup()
+{
+	uint32_t job = mSchedulerJob;
+	if(job) RsScheduler::instance().wakeup(job);
+}
+
+void RsTickingThread::scheduledTick()
+{
+	if(shouldStop())
+	{
+		/* first run may happen before addJob() returned, stop on next one */
+		uint32_t job = mSchedulerJob.exchange(0);
+		if(!job) return;
+
+		/* called from the job itself so it doesn't wait */
+		RsScheduler::instance().removeJob(job);
+		mScheduled = false;
+		markStopped();
+		return;
+	}
+
+	threadTick();
+}
+
 RsQueueThread::RsQueueThread(uint32_t min, uint32_t max, double relaxFactor )
     :mMinSleep(min), mMaxSleep(max), mRelaxFactor(relaxFactor)
 {
@@ -31,6 +31,7 @@
 #include <atomic>
 #include <thread>
 #include <functional>
+#include <chrono>
 
 #include "util/rsmemory.h"
 #include "util/rsdeprecate.h"
@@ -250,6 +251,14 @@ protected:
 	 * of this method, @see JsonApiServer for an usage example. */
 	virtual void onStopRequested() {}
 
+	/**
+	 * Update the running state of a thread without a pthread of its own,
+	 * @see RsTickingThread::startScheduled()
+	 * @return false if it was already running (resp. stopped)
+	 */
+	bool markRunning(const std::string& threadName);
+	bool markStopped();
+
 #ifdef RS_THREAD_FORCE_STOP
 	/** Set last resort timeout to forcefully kill thread if it didn't stop
 	 * nicely, one should never use this, still we needed to introduce this
@@ -306,18 +315,43 @@ private:
 class RsTickingThread: public RsThread
 {
 public:
+	RsTickingThread() : mScheduled(false), mSchedulerJob(0) {}
+
 	/**
 	 * Subclasses must implement this method, it will be called in a loop once
 	 * the thread is started, so repetitive work (like checking if data is
 	 * available on a socket) should be done here, at the end of this method
 	 * sleep_for(...) or similar function should be called or the CPU will
 	 * be used as much as possible also if there is nothing to do.
+	 * When started with startScheduled() it must not sleep, @see isScheduled()
 	 */
 	virtual void threadTick() = 0;
 
+	/**
+	 * @brief Start without a dedicated thread. threadTick() is then called by
+	 * RsScheduler at least every period, and as soon as possible after
+	 * wakeup(). It is never called concurrently. isRunning(), shouldStop()
+	 * and fullstop() keep working as with start().
+	 * @return false if already running
+	 */
+	bool startScheduled(
+	        const std::string& threadName, std::chrono::milliseconds period );
+
+	/// Ask for threadTick() to be called soon. No-op if not scheduled.
+	void wakeup();
+
+	/// @return true if ticked by RsScheduler instead of an own thread
+	bool isScheduled() const { return mScheduled; }
+
 private:
 	/// Implement the run loop and continuously call threadTick() in it
 	void run() override { while(!shouldStop()) threadTick(); }
+
+	/// Job run by RsScheduler
+	void scheduledTick();
+
+	std::atomic<bool> mScheduled;
+	std::atomic<uint32_t> mSchedulerJob;
 };
 
 // TODO: Used just one time, is this really an useful abstraction?
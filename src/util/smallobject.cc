@@ -21,6 +21,8 @@
  *******************************************************************************/
 
 #include <iostream>
+#include <atomic>
+#include <set>
 #include "smallobject.h"
 #include "util/rsthreads.h"
 #include "util/rsmemory.h"
@@ -284,8 +286,420 @@ void SmallObjectAllocator::printStatistics() const
 	}
 }
 
+/*** Thread caching allocator ***/
+
+namespace
+{
+typedef ThreadCachingAllocator TCA ;
+
+struct Magazine
+{
+	Magazine() : count(0) {}
+
+	uint32_t count ;
+	void *blocks[TCA::MAGAZINE_SIZE] ;
+};
+
+// Only written by the thread that owns them, so that they cost no more than
+// plain integers, but can be read by getStatistics() from any thread.
+
+struct SizeClassCounters
+{
+	SizeClassCounters()
+	  : allocations(0), deallocations(0), depotGets(0), depotPuts(0)
+	  , systemAllocations(0), systemFrees(0) {}
+
+	std::atomic<uint64_t> allocations ;
+	std::atomic<uint64_t> deallocations ;
+	std::atomic<uint64_t> depotGets ;
+	std::atomic<uint64_t> depotPuts ;
+	std::atomic<uint64_t> systemAllocations ;
+	std::atomic<uint64_t> systemFrees ;
+};
+
+inline void increment(std::atomic<uint64_t>& counter,uint64_t n = 1)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + n,std::memory_order_relaxed) ;
+}
+
+void addCounters(SizeClassStatistics& stats,const SizeClassCounters& counters)
+{
+	stats.allocations       += counters.allocations.load(std::memory_order_relaxed) ;
+	stats.deallocations     += counters.deallocations.load(std::memory_order_relaxed) ;
+	stats.depotGets         += counters.depotGets.load(std::memory_order_relaxed) ;
+	stats.depotPuts         += counters.depotPuts.load(std::memory_order_relaxed) ;
+	stats.systemAllocations += counters.systemAllocations.load(std::memory_order_relaxed) ;
+	stats.systemFrees       += counters.systemFrees.load(std::memory_order_relaxed) ;
+}
+
+struct ThreadCache
+{
+	struct SizeClass
+	{
+		SizeClass() : loaded(NULL), previous(NULL) {}
+
+		Magazine *loaded ;		// blocks are taken from and given to this one
+		Magazine *previous ;	// full or empty, swapped with loaded before going to the depot
+		SizeClassCounters counters ;
+	};
+
+	SizeClass classes[TCA::NUM_SIZE_CLASSES] ;
+};
+
+struct Depot
+{
+	Depot() : mtx("SmallObjectDepot") {}
+
+	RsMutex mtx ;
+	std::vector<Magazine*> full ;	// never empty magazines
+	std::vector<Magazine*> empty ;
+};
+
+struct Depots
+{
+	Depots() ;
+	~Depots() ;
+
+	Depot depot[TCA::NUM_SIZE_CLASSES] ;
+
+	RsMutex threadsMtx ;
+	std::set<ThreadCache*> threads ;
+	SizeClassStatistics retired[TCA::NUM_SIZE_CLASSES] ;	// counters of exited threads
+};
+
+// Items may be created and deleted during static initialisation and
+// destruction, so the depots are created on first use and their state is
+// checked before each use. Once they are destroyed, blocks go straight to
+// malloc() and free().
+
+enum { DEPOTS_NOT_CREATED = 0, DEPOTS_ALIVE = 1, DEPOTS_DESTROYED = 2 } ;
+
+std::atomic<int> depotsState(DEPOTS_NOT_CREATED) ;
+
+Depots& depots()
+{
+	static Depots d ;
+	return d ;
+}
+
+inline bool depotsAvailable()
+{
+	return depotsState.load(std::memory_order_acquire) != DEPOTS_DESTROYED ;
+}
+
+inline size_t sizeClass(size_t bytes)
+{
+	return bytes ? (bytes - 1) / TCA::SIZE_CLASS_GRANULARITY : 0 ;
+}
+
+inline size_t classBlockSize(size_t c)
+{
+	return (c + 1) * TCA::SIZE_CLASS_GRANULARITY ;
+}
+
+void freeBlocks(Magazine *m,SizeClassCounters *counters)
+{
+	for(uint32_t i=0;i<m->count;++i)
+		free(m->blocks[i]) ;
+
+	if(counters)
+		increment(counters->systemFrees,m->count) ;
+
+	m->count = 0 ;
+}
+
+Depots::Depots() : threadsMtx("SmallObjectThreads")
+{
+	depotsState.store(DEPOTS_ALIVE,std::memory_order_release) ;
+}
+
+Depots::~Depots()
+{
+	depotsState.store(DEPOTS_DESTROYED,std::memory_order_release) ;
+
+	for(size_t c=0;c<TCA::NUM_SIZE_CLASSES;++c)
+	{
+		RsStackMutex m(depot[c].mtx) ;
+
+		for(uint32_t i=0;i<depot[c].full.size();++i)
+		{
+			freeBlocks(depot[c].full[i],NULL) ;
+			delete depot[c].full[i] ;
+		}
+		for(uint32_t i=0;i<depot[c].empty.size();++i)
+			delete depot[c].empty[i] ;
+
+		depot[c].full.clear() ;
+		depot[c].empty.clear() ;
+	}
+}
+
+// Gives an empty magazine (may be NULL) to the depot and takes a full one
+// from it. Returns NULL when the depot has no full magazine.
+
+Magazine *exchangeForFull(size_t c,Magazine *empty,SizeClassCounters& counters)
+{
+	Magazine *full = NULL ;
+
+	if(depotsAvailable())
+	{
+		Depot& d(depots().depot[c]) ;
+		RsStackMutex m(d.mtx) ;
+
+		if(!d.full.empty())
+		{
+			full = d.full.back() ;
+			d.full.pop_back() ;
+			increment(counters.depotGets) ;
+		}
+		if(empty != NULL && d.empty.size() < TCA::MAX_DEPOT_MAGAZINES)
+		{
+			d.empty.push_back(empty) ;
+			empty = NULL ;
+		}
+	}
+	delete empty ;
+	return full ;
+}
+
+// Gives a full magazine (may be NULL) to the depot and takes an empty one from
+// it. When the depot already holds enough blocks, the blocks of the full
+// magazine are freed instead.
+
+Magazine *exchangeForEmpty(size_t c,Magazine *full,SizeClassCounters& counters)
+{
+	Magazine *empty = NULL ;
+
+	if(depotsAvailable())
+	{
+		Depot& d(depots().depot[c]) ;
+		RsStackMutex m(d.mtx) ;
+
+		if(full != NULL && d.full.size() < TCA::MAX_DEPOT_MAGAZINES)
+		{
+			d.full.push_back(full) ;
+			full = NULL ;
+			increment(counters.depotPuts) ;
+		}
+		if(!d.empty.empty())
+		{
+			empty = d.empty.back() ;
+			d.empty.pop_back() ;
+		}
+	}
+
+	if(full != NULL)
+	{
+		freeBlocks(full,&counters) ;
+
+		if(empty == NULL)
+			return full ;
+
+		delete full ;
+	}
+	return empty ? empty : new Magazine ;
+}
+
+void releaseThreadCache() ;
+
+struct ThreadCacheReleaser
+{
+	~ThreadCacheReleaser() { releaseThreadCache() ; }
+};
+
+thread_local ThreadCache *tlsCache = NULL ;
+thread_local bool tlsCacheReleased = false ;
+thread_local ThreadCacheReleaser tlsReleaser ;
+
+// NULL when the thread is exiting or the depots are destroyed.
+
+inline ThreadCache *getThreadCache()
+{
+	if(tlsCache != NULL)
+		return tlsCache ;
+
+	if(tlsCacheReleased || !depotsAvailable())
+		return NULL ;
+
+	(void)&tlsReleaser ;	// makes sure the cache is released when the thread exits
+
+	ThreadCache *cache = new ThreadCache ;
+	Depots& d(depots()) ;
+	{
+		RsStackMutex m(d.threadsMtx) ;
+		d.threads.insert(cache) ;
+	}
+	tlsCache = cache ;
+	return cache ;
+}
+
+void releaseThreadCache()
+{
+	ThreadCache *cache = tlsCache ;
+
+	tlsCache = NULL ;
+	tlsCacheReleased = true ;
+
+	if(cache == NULL)
+		return ;
+
+	// Blocks of the thread go to the depot, so that other threads use them
+
+	for(size_t c=0;c<TCA::NUM_SIZE_CLASSES;++c)
+	{
+		ThreadCache::SizeClass& sc(cache->classes[c]) ;
+		Magazine *mags[2] = { sc.loaded, sc.previous } ;
+
+		for(int i=0;i<2;++i)
+			if(mags[i] != NULL && mags[i]->count > 0)
+				delete exchangeForEmpty(c,mags[i],sc.counters) ;
+			else
+				delete mags[i] ;
+	}
+
+	if(depotsAvailable())
+	{
+		Depots& d(depots()) ;
+		RsStackMutex m(d.threadsMtx) ;
+
+		d.threads.erase(cache) ;
+
+		for(size_t c=0;c<TCA::NUM_SIZE_CLASSES;++c)
+			addCounters(d.retired[c],cache->classes[c].counters) ;
+	}
+	delete cache ;
+}
+}
+
+void *ThreadCachingAllocator::allocate(size_t bytes)
+{
+	if(bytes > (size_t)MAX_SMALL_OBJECT_SIZE)
+		return rs_malloc(bytes) ;
+
+	size_t c = sizeClass(bytes) ;
+	ThreadCache *cache = getThreadCache() ;
+
+	if(cache == NULL)
+		return rs_malloc(classBlockSize(c)) ;
+
+	ThreadCache::SizeClass& sc(cache->classes[c]) ;
+	increment(sc.counters.allocations) ;
+
+	if(sc.loaded == NULL || sc.loaded->count == 0)
+	{
+		if(sc.previous != NULL && sc.previous->count > 0)
+			std::swap(sc.loaded,sc.previous) ;
+		else
+		{
+			// Both empty. Keep one for deallocations, the other one goes back to the depot.
+
+			Magazine *full = exchangeForFull(c,sc.previous,sc.counters) ;
+
+			sc.previous = sc.loaded ;
+			sc.loaded = full ;
+
+			if(full == NULL)
+			{
+				increment(sc.counters.systemAllocations) ;
+				return rs_malloc(classBlockSize(c)) ;
+			}
+		}
+	}
+	return sc.loaded->blocks[--sc.loaded->count] ;
+}
+
+void ThreadCachingAllocator::deallocate(void *p,size_t bytes)
+{
+	if(p == NULL)
+		return ;
+
+	ThreadCache *cache = (bytes > (size_t)MAX_SMALL_OBJECT_SIZE) ? NULL : getThreadCache() ;
+
+	if(cache == NULL)
+	{
+		free(p) ;
+		return ;
+	}
+
+	size_t c = sizeClass(bytes) ;
+	ThreadCache::SizeClass& sc(cache->classes[c]) ;
+	increment(sc.counters.deallocations) ;
+
+	if(sc.loaded == NULL || sc.loaded->count == MAGAZINE_SIZE)
+	{
+		if(sc.previous != NULL && sc.previous->count < MAGAZINE_SIZE)
+			std::swap(sc.loaded,sc.previous) ;
+		else
+		{
+			// Both full. Keep one for allocations, the other one goes to the depot.
+
+			Magazine *empty = exchangeForEmpty(c,sc.previous,sc.counters) ;
+
+			sc.previous = sc.loaded ;
+			sc.loaded = empty ;
+		}
+	}
+	sc.loaded->blocks[sc.loaded->count++] = p ;
+}
+
+void ThreadCachingAllocator::getStatistics(std::vector<SizeClassStatistics>& stats)
+{
+	stats.clear() ;
+	stats.resize(NUM_SIZE_CLASSES) ;
+
+	for(size_t c=0;c<NUM_SIZE_CLASSES;++c)
+		stats[c].blockSize = classBlockSize(c) ;
+
+	if(depotsState.load(std::memory_order_acquire) != DEPOTS_ALIVE)
+		return ;
+
+	Depots& d(depots()) ;
+
+	for(size_t c=0;c<NUM_SIZE_CLASSES;++c)
+	{
+		RsStackMutex m(d.depot[c].mtx) ;
+
+		for(uint32_t i=0;i<d.depot[c].full.size();++i)
+			stats[c].depotBlocks += d.depot[c].full[i]->count ;
+	}
+
+	RsStackMutex m(d.threadsMtx) ;
+
+	for(size_t c=0;c<NUM_SIZE_CLASSES;++c)
+	{
+		size_t depotBlocks = stats[c].depotBlocks ;
+		stats[c] = d.retired[c] ;
+		stats[c].blockSize = classBlockSize(c) ;
+		stats[c].depotBlocks = depotBlocks ;
+
+		for(std::set<ThreadCache*>::const_iterator it(d.threads.begin());it!=d.threads.end();++it)
+			addCounters(stats[c],(*it)->classes[c].counters) ;
+	}
+}
+
+void ThreadCachingAllocator::printStatistics()
+{
+	std::vector<SizeClassStatistics> stats ;
+	getStatistics(stats) ;
+
+	std::cerr << "RsMemoryManagement thread caching allocator statistics:" << std::endl;
+
+	for(uint32_t c=0;c<stats.size();++c)
+		std::cerr << "  size " << stats[c].blockSize
+		          << ": allocations=" << stats[c].allocations
+		          << " deallocations=" << stats[c].deallocations
+		          << " depot gets=" << stats[c].depotGets
+		          << " puts=" << stats[c].depotPuts
+		          << " blocks=" << stats[c].depotBlocks
+		          << " system allocations=" << stats[c].systemAllocations
+		          << " frees=" << stats[c].systemFrees << std::endl;
+}
+
 void *SmallObject::operator new(size_t size)
 {
+#ifndef RS_LOCKED_SMALL_OBJECT_ALLOCATOR
+	return ThreadCachingAllocator::allocate(size) ;
+#else
 #ifdef DEBUG_MEMORY
 	bool print=false ;
 	{
@@ -319,10 +733,14 @@ void *SmallObject::operator new(size_t size)
 #ifdef DEBUG_MEMORY
 	std::cerr << "new RsItem: " << p << ", size=" << size << std::endl;
 #endif
+#endif // RS_LOCKED_SMALL_OBJECT_ALLOCATOR
 }
 
 void SmallObject::operator delete(void *p,size_t size)
 {
+#ifndef RS_LOCKED_SMALL_OBJECT_ALLOCATOR
+	ThreadCachingAllocator::deallocate(p,size) ;
+#else
 	RsStackMutex m(_mtx) ;
 
 	if(!_allocator._active)
@@ -332,16 +750,21 @@ void SmallObject::operator delete(void *p,size_t size)
 #ifdef DEBUG_MEMORY
 	std::cerr << "del RsItem: " << p << ", size=" << size << std::endl;
 #endif
+#endif // RS_LOCKED_SMALL_OBJECT_ALLOCATOR
 }
 
 void SmallObject::printStatistics() 
 {
+#ifndef RS_LOCKED_SMALL_OBJECT_ALLOCATOR
+	ThreadCachingAllocator::printStatistics() ;
+#else
 	RsStackMutex m(_mtx) ;
 
 	if(!_allocator._active)
 		return ;
 
 	_allocator.printStatistics() ;
+#endif
 }
 
 void RsMemoryManagement::printStatistics()
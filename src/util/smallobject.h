@@ -24,6 +24,7 @@
 
 #include <stdlib.h>
 #include <assert.h>
+#include <stdint.h>
 
 #include <vector>
 #include <map>
@@ -94,6 +95,56 @@ namespace RsMemoryManagement
 			size_t _maxObjectSize ;
 	};
 
+	// Thread caching allocator, used by SmallObject unless libretroshare is built
+	// with RS_LOCKED_SMALL_OBJECT_ALLOCATOR, in which case the SmallObjectAllocator
+	// above is used behind a global mutex.
+	//
+	// Sizes are rounded up to size classes of SIZE_CLASS_GRANULARITY bytes. Each
+	// thread keeps, per size class, two magazines of up to MAGAZINE_SIZE free
+	// blocks, so that most allocations and deallocations take no lock at all.
+	// When both are empty (resp. full) a full (resp. empty) magazine is exchanged
+	// with the depot of the size class, which takes a short lock once every
+	// MAGAZINE_SIZE operations.
+	//
+	// Blocks are obtained from malloc() and belong to no thread: a block freed
+	// by another thread than the one that allocated it simply goes into the
+	// magazines of that thread, and comes back to allocating threads through the
+	// depot. Full magazines beyond MAX_DEPOT_MAGAZINES are given back to malloc().
+
+	struct SizeClassStatistics
+	{
+		SizeClassStatistics()
+		  : blockSize(0), allocations(0), deallocations(0), depotGets(0), depotPuts(0)
+		  , systemAllocations(0), systemFrees(0), depotBlocks(0) {}
+
+		size_t blockSize ;
+		uint64_t allocations ;
+		uint64_t deallocations ;
+		uint64_t depotGets ;			// full magazines taken from the depot
+		uint64_t depotPuts ;			// full magazines given to the depot
+		uint64_t systemAllocations ;	// blocks obtained from malloc()
+		uint64_t systemFrees ;			// blocks given back to free()
+		uint64_t depotBlocks ;			// free blocks currently in the depot
+	};
+
+	class ThreadCachingAllocator
+	{
+		public:
+			static const size_t SIZE_CLASS_GRANULARITY = 16 ;
+			static const size_t NUM_SIZE_CLASSES = MAX_SMALL_OBJECT_SIZE / SIZE_CLASS_GRANULARITY ;
+			static const uint32_t MAGAZINE_SIZE = 64 ;
+			static const uint32_t MAX_DEPOT_MAGAZINES = 32 ;
+
+			static void *allocate(size_t bytes) ;
+			static void deallocate(void *p,size_t bytes) ;
+
+			// Counters of all threads, including the ones that exited. Counters
+			// of running threads are read while they change, so totals are
+			// only exact when the allocator is idle.
+			static void getStatistics(std::vector<SizeClassStatistics>& stats) ;
+			static void printStatistics() ;
+	};
+
 	class SmallObject
 	{
 		public: 
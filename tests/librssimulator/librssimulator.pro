@@ -61,11 +61,13 @@ SOURCES += peer/PeerNode.cc \
 
 HEADERS += testing/IsolatedServiceTester.h \
 	testing/SetServiceTester.h \
+	testing/SetBenchmark.h \
 	testing/SetPacket.h \
 	testing/SetFilter.h \
 
 SOURCES += testing/IsolatedServiceTester.cc \
 	testing/SetServiceTester.cc \
+	testing/SetBenchmark.cc \
 	testing/SetFilter.cc \
 
 ##################### Network Sims ##############################
@@ -0,0 +1,309 @@
+/*******************************************************************************
+ * librssimulator/testing/: SetBenchmark.cc                                    *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+#ifndef WINDOWS_SYS
+#include <unistd.h>
+#endif
+
+#include "serialiser/rsserial.h"
+
+#include "SetBenchmark.h"
+
+/**
+ * #define DEBUG_BENCHMARK	1
+ **/
+
+static double wallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+SetBenchmark::SetBenchmark()
+:SetServiceTester(), mTickInterval(0.005), mSeqNo(0)
+{
+	// keeping every packet would make memory figures meaningless.
+	getCaptureFilter().setFilterMode(SetFilter::FILTER_NONE);
+
+	mStartMemory = residentMemory();
+	startMeasure();
+}
+
+SetBenchmark::~SetBenchmark()
+{
+	while(!mPending.empty())
+	{
+		delete mPending.top().mItem;
+		mPending.pop();
+	}
+}
+
+void SetBenchmark::setDefaultLink(double latency, double bandwidth)
+{
+	mDefaultLink.mLatency = latency;
+	mDefaultLink.mBandwidth = bandwidth;
+}
+
+void SetBenchmark::setLink(const RsPeerId &id1, const RsPeerId &id2, double latency, double bandwidth)
+{
+	LinkParams &l1 = mLinks[std::make_pair(id1, id2)];
+	l1.mLatency = latency;
+	l1.mBandwidth = bandwidth;
+
+	LinkParams &l2 = mLinks[std::make_pair(id2, id1)];
+	l2.mLatency = latency;
+	l2.mBandwidth = bandwidth;
+}
+
+SetBenchmark::LinkParams &SetBenchmark::getLink(const RsPeerId &srcId, const RsPeerId &destId)
+{
+	std::pair<RsPeerId, RsPeerId> key = std::make_pair(srcId, destId);
+	std::map<std::pair<RsPeerId, RsPeerId>, LinkParams>::iterator it = mLinks.find(key);
+	if (it == mLinks.end())
+	{
+		it = mLinks.insert(std::make_pair(key, mDefaultLink)).first;
+	}
+	return it->second;
+}
+
+void SetBenchmark::startMeasure()
+{
+	mStartTime = wallTime();
+	mStartCpu = cpuTime();
+
+	mTotal = TrafficStats();
+	mServiceStats.clear();
+	mSamples.clear();
+}
+
+double SetBenchmark::now() const
+{
+	return wallTime() - mStartTime;
+}
+
+void SetBenchmark::addSample(const std::string &metric, double value)
+{
+	mSamples[metric].push_back(value);
+}
+
+bool SetBenchmark::run(double max_seconds, std::function<bool()> done)
+{
+	double endTime = wallTime() + max_seconds;
+	while(wallTime() < endTime)
+	{
+		tick();
+		if (done())
+		{
+			return true;
+		}
+
+		// don't let the idle ticks dominate the CPU figures.
+		std::this_thread::sleep_for(std::chrono::duration<double>(mTickInterval));
+	}
+	return false;
+}
+
+/***************************************************************************************************/
+/***************************************************************************************************/
+
+bool SetBenchmark::decodePackets()
+{
+	return (getDropFilter().getFilterMode() != SetFilter::FILTER_NONE)
+		|| (getCaptureFilter().getFilterMode() != SetFilter::FILTER_NONE)
+		|| (getFinishFilter().getFilterMode() != SetFilter::FILTER_NONE);
+}
+
+void SetBenchmark::preTick()
+{
+	deliverPending(wallTime());
+}
+
+void SetBenchmark::routePacket(const RsPeerId &srcId, const RsPeerId &destId, RsRawItem *rawItem)
+{
+	double ts = wallTime();
+	LinkParams &link = getLink(srcId, destId);
+
+	/* the link sends one packet at a time: it starts once the previous one
+	 * is out, and takes size / bandwidth.
+	 */
+	double departure = std::max(ts, link.mBusyUntil);
+	if (link.mBandwidth > 0)
+	{
+		departure += rawItem->getRawLength() / link.mBandwidth;
+	}
+	link.mBusyUntil = departure;
+
+	PendingPacket pkt;
+	pkt.mArrival = departure + link.mLatency;
+	pkt.mSeqNo = mSeqNo++;
+	pkt.mSent = ts;
+	pkt.mSrcId = srcId;
+	pkt.mDestId = destId;
+	pkt.mItem = rawItem;
+
+	mPending.push(pkt);
+}
+
+void SetBenchmark::deliverPending(double ts)
+{
+	while(!mPending.empty() && mPending.top().mArrival <= ts)
+	{
+		PendingPacket pkt = mPending.top();
+		mPending.pop();
+
+		uint32_t size = pkt.mItem->getRawLength();
+		double latency = ts - pkt.mSent;
+
+		TrafficStats &stats = mServiceStats[pkt.mItem->PacketService()];
+		stats.mPackets++;
+		stats.mBytes += size;
+		stats.mLatencies.push_back(latency);
+
+		mTotal.mPackets++;
+		mTotal.mBytes += size;
+		mTotal.mLatencies.push_back(latency);
+
+#ifdef DEBUG_BENCHMARK
+		std::cerr << "SetBenchmark::deliverPending() " << size << " bytes ";
+		std::cerr << pkt.mSrcId << " -> " << pkt.mDestId;
+		std::cerr << " latency: " << latency;
+		std::cerr << std::endl;
+#endif
+
+		deliverPacket(pkt.mSrcId, pkt.mDestId, pkt.mItem);
+	}
+}
+
+/***************************************************************************************************/
+/***************************************************************************************************/
+
+double SetBenchmark::getLatencyPercentile(double percent) const
+{
+	return percentile(mTotal.mLatencies, percent);
+}
+
+double SetBenchmark::percentile(std::vector<double> values, double percent)
+{
+	if (values.empty())
+	{
+		return 0;
+	}
+
+	size_t idx = (size_t) (percent / 100.0 * (values.size() - 1) + 0.5);
+	std::nth_element(values.begin(), values.begin() + idx, values.end());
+	return values[idx];
+}
+
+double SetBenchmark::cpuTime()
+{
+#ifdef CLOCK_PROCESS_CPUTIME_ID
+	struct timespec ts;
+	if (0 == clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts))
+	{
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+	}
+#endif
+	return (double) clock() / CLOCKS_PER_SEC;
+}
+
+uint64_t SetBenchmark::residentMemory()
+{
+#ifdef __linux__
+	std::ifstream statm("/proc/self/statm");
+	uint64_t size = 0;
+	uint64_t resident = 0;
+	if (statm >> size >> resident)
+	{
+		return resident * sysconf(_SC_PAGESIZE);
+	}
+#endif
+	return 0;
+}
+
+bool SetBenchmark::writeReport(std::ostream &out, const std::string &name) const
+{
+	double duration = now();
+	double cpu = cpuTime() - mStartCpu;
+	uint64_t memory = residentMemory();
+	uint32_t nodes = getNodes().size();
+
+	uint64_t memoryPerPeer = 0;
+	if (nodes && memory > mStartMemory)
+	{
+		memoryPerPeer = (memory - mStartMemory) / nodes;
+	}
+
+	std::ios_base::fmtflags flags = out.flags();
+	out << std::fixed << std::setprecision(6);
+
+	out << "{" << std::endl;
+	out << "  \"benchmark\": \"" << name << "\"," << std::endl;
+	out << "  \"nodes\": " << nodes << "," << std::endl;
+	out << "  \"duration_s\": " << duration << "," << std::endl;
+	out << "  \"packets\": " << mTotal.mPackets << "," << std::endl;
+	out << "  \"bytes\": " << mTotal.mBytes << "," << std::endl;
+	out << "  \"throughput_bytes_per_s\": " << (duration > 0 ? mTotal.mBytes / duration : 0) << "," << std::endl;
+	out << "  \"latency_p50_s\": " << percentile(mTotal.mLatencies, 50) << "," << std::endl;
+	out << "  \"latency_p99_s\": " << percentile(mTotal.mLatencies, 99) << "," << std::endl;
+	out << "  \"cpu_s\": " << cpu << "," << std::endl;
+	out << "  \"cpu_ns_per_byte\": " << (mTotal.mBytes ? cpu * 1e9 / mTotal.mBytes : 0) << "," << std::endl;
+	out << "  \"rss_bytes_per_peer\": " << memoryPerPeer << "," << std::endl;
+
+	out << "  \"services\": [";
+	std::map<uint16_t, TrafficStats>::const_iterator sit;
+	for(sit = mServiceStats.begin(); sit != mServiceStats.end(); ++sit)
+	{
+		out << (sit == mServiceStats.begin() ? "" : ",") << std::endl;
+		out << "    { \"service\": " << sit->first;
+		out << ", \"packets\": " << sit->second.mPackets;
+		out << ", \"bytes\": " << sit->second.mBytes;
+		out << ", \"latency_p50_s\": " << percentile(sit->second.mLatencies, 50);
+		out << ", \"latency_p99_s\": " << percentile(sit->second.mLatencies, 99);
+		out << " }";
+	}
+	out << std::endl << "  ]," << std::endl;
+
+	out << "  \"metrics\": [";
+	std::map<std::string, std::vector<double> >::const_iterator mit;
+	for(mit = mSamples.begin(); mit != mSamples.end(); ++mit)
+	{
+		out << (mit == mSamples.begin() ? "" : ",") << std::endl;
+		out << "    { \"name\": \"" << mit->first << "\"";
+		out << ", \"samples\": " << mit->second.size();
+		out << ", \"p50\": " << percentile(mit->second, 50);
+		out << ", \"p99\": " << percentile(mit->second, 99);
+		out << " }";
+	}
+	out << std::endl << "  ]" << std::endl;
+	out << "}" << std::endl;
+
+	out.flags(flags);
+	return true;
+}
+
@@ -0,0 +1,143 @@
+/*******************************************************************************
+ * librssimulator/testing/: SetBenchmark.h                                     *
+ *                                                                             *
+ * libretroshare: retroshare core library                                      *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+#pragma once
+
+#include <functional>
+#include <iosfwd>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "SetServiceTester.h"
+
+/* Performance harness on top of SetServiceTester.
+ *
+ * All the nodes live in this process, and packets between them go through
+ * an emulated link with a one way latency and a bandwidth. Everything uses
+ * wall clock time, so the services see realistic delays.
+ *
+ * The benchmark collects, for each service: packets, bytes and link latency
+ * (time from the sending node to the delivery to the receiving node,
+ * including queueing). Workloads can add their own end to end latencies with
+ * addSample(). The report also has the CPU time per transferred byte and the
+ * resident memory per node, and is written as JSON so that it can be compared
+ * between releases by scripts.
+ */
+
+class SetBenchmark: public SetServiceTester
+{
+public:
+	SetBenchmark();
+	virtual ~SetBenchmark();
+
+	// latency in seconds (one way), bandwidth in bytes/sec (0 = unlimited).
+	void setDefaultLink(double latency, double bandwidth);
+	void setLink(const RsPeerId &id1, const RsPeerId &id2, double latency, double bandwidth);
+
+	// pause between two rounds of ticks in run(), in seconds.
+	void setTickInterval(double interval) { mTickInterval = interval; }
+
+	// forget everything measured so far (e.g. after the setup phase).
+	void startMeasure();
+
+	// tick until done() returns true, or max_seconds elapsed. return true if done.
+	bool run(double max_seconds, std::function<bool()> done);
+
+	// seconds since startMeasure().
+	double now() const;
+
+	// workload specific latency, in seconds.
+	void addSample(const std::string &metric, double value);
+
+	uint64_t getPacketCount() const { return mTotal.mPackets; }
+	uint64_t getByteCount() const { return mTotal.mBytes; }
+	double   getLatencyPercentile(double percent) const;
+
+	bool writeReport(std::ostream &out, const std::string &name) const;
+
+protected:
+	virtual bool decodePackets();
+	virtual void preTick();
+	virtual void routePacket(const RsPeerId &srcId, const RsPeerId &destId, RsRawItem *rawItem);
+
+private:
+	class LinkParams
+	{
+	public:
+		LinkParams() :mLatency(0), mBandwidth(0), mBusyUntil(0) { return; }
+
+		double mLatency;
+		double mBandwidth;
+		double mBusyUntil;	// end of the transmission of the last packet.
+	};
+
+	class PendingPacket
+	{
+	public:
+		double mArrival;
+		uint64_t mSeqNo;	// keeps ordering on each link.
+		double mSent;
+		RsPeerId mSrcId;
+		RsPeerId mDestId;
+		RsRawItem *mItem;
+
+		bool operator>(const PendingPacket &p) const
+		{
+			return (mArrival > p.mArrival) || (mArrival == p.mArrival && mSeqNo > p.mSeqNo);
+		}
+	};
+
+	class TrafficStats
+	{
+	public:
+		TrafficStats() :mPackets(0), mBytes(0) { return; }
+
+		uint64_t mPackets;
+		uint64_t mBytes;
+		std::vector<double> mLatencies;
+	};
+
+	LinkParams &getLink(const RsPeerId &srcId, const RsPeerId &destId);
+	void deliverPending(double ts);
+
+	static double percentile(std::vector<double> values, double percent);
+	static double cpuTime();
+	static uint64_t residentMemory();
+
+	double mTickInterval;
+
+	LinkParams mDefaultLink;
+	std::map<std::pair<RsPeerId, RsPeerId>, LinkParams> mLinks;
+
+	std::priority_queue<PendingPacket, std::vector<PendingPacket>, std::greater<PendingPacket> > mPending;
+	uint64_t mSeqNo;
+
+	double mStartTime;
+	double mStartCpu;
+	uint64_t mStartMemory;	// before any node was created.
+
+	TrafficStats mTotal;
+	std::map<uint16_t, TrafficStats> mServiceStats;
+	std::map<std::string, std::vector<double> > mSamples;
+};
+
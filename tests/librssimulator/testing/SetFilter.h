@@ -48,6 +48,7 @@ class SetFilter
 	 mUseFullTypes(false), mUseServiceTypes(false) { return; }
 
 	void setFilterMode(FilterMode mode) { mFilterMode = mode; }
+	FilterMode getFilterMode() const { return mFilterMode; }
 	void setUseSource(bool toUse) { mUseSource = toUse; }
 	void setUseDest(bool toUse)   { mUseDest   = toUse; }
 	void setUseFullTypes(bool toUse)  { mUseFullTypes  = toUse; }
@@ -178,6 +178,8 @@ bool SetServiceTester::tickUntilEvent(int max_ticks, EventType eventType)
 
 	for(int i = 0; i < max_ticks; i++)
 	{
+		preTick();
+
 		std::map<RsPeerId, PeerNode *>::iterator pit;
 		for(pit = mNodes.begin(); pit != mNodes.end(); ++pit)
 		{
@@ -193,7 +195,11 @@ bool SetServiceTester::tickUntilEvent(int max_ticks, EventType eventType)
 				bool finished = false;
 				double ts = time(NULL) - mRefTime;
 				RsRawItem *rawItem = pit->second->outgoing();
-				RsItem *item = convertToRsItem(rawItem, false);
+				RsItem *item = NULL;
+				if (decodePackets())
+				{
+					item = convertToRsItem(rawItem, false);
+				}
 				RsPeerId destId = rawItem->PeerId();
 				RsPeerId srcId = pit->second->id();
 
@@ -250,19 +256,7 @@ bool SetServiceTester::tickUntilEvent(int max_ticks, EventType eventType)
 				// Pass on Item.
 				if (rawItem)
 				{
-					rawItem->PeerId(srcId);
-					std::map<RsPeerId, PeerNode *>::iterator pit2;
-					pit2 = mNodes.find(destId);
-					if (pit2 != mNodes.end())
-					{
-						pit2->second->incoming(rawItem);
-					}
-					else
-					{
-						// Error.
-						delete rawItem;
-						throw std::logic_error("SetServiceTester::tickUntilEvent() invalid destId");
-					}
+					routePacket(srcId, destId, rawItem);
 				}
 
 				if (finished)
@@ -276,6 +270,28 @@ bool SetServiceTester::tickUntilEvent(int max_ticks, EventType eventType)
 }
 
 
+void SetServiceTester::routePacket(const RsPeerId &srcId, const RsPeerId &destId, RsRawItem *rawItem)
+{
+	deliverPacket(srcId, destId, rawItem);
+}
+
+void SetServiceTester::deliverPacket(const RsPeerId &srcId, const RsPeerId &destId, RsRawItem *rawItem)
+{
+	rawItem->PeerId(srcId);
+	std::map<RsPeerId, PeerNode *>::iterator pit;
+	pit = mNodes.find(destId);
+	if (pit != mNodes.end())
+	{
+		pit->second->incoming(rawItem);
+	}
+	else
+	{
+		// Error.
+		delete rawItem;
+		throw std::logic_error("SetServiceTester::deliverPacket() invalid destId");
+	}
+}
+
 /***************************************************************************************************/
 /***************************************************************************************************/
 
@@ -38,7 +38,7 @@ class SetServiceTester
 {
 public:
 	SetServiceTester();
-	~SetServiceTester();
+	virtual ~SetServiceTester();
 
 	enum EventType {
 		UNTIL_CAPTURE = 0,
@@ -78,6 +78,20 @@ public:
 	SetFilter &getCaptureFilter() { return mCaptureFilter; }
 	SetFilter &getFinishFilter() { return mFinishFilter; }
 
+protected:
+
+	// false if the filters don't need the deserialised items.
+	virtual bool decodePackets() { return true; }
+
+	// called before each round of node ticks.
+	virtual void preTick() { return; }
+
+	// hand over an outgoing packet, default is immediate delivery.
+	virtual void routePacket(const RsPeerId &srcId, const RsPeerId &destId, RsRawItem *rawItem);
+	void deliverPacket(const RsPeerId &srcId, const RsPeerId &destId, RsRawItem *rawItem);
+
+	const std::map<RsPeerId, PeerNode *> &getNodes() const { return mNodes; }
+
 private:
 
 	bool tickUntilEvent(int max_ticks, EventType eventType);
@@ -20,9 +20,18 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
 // from libretroshare
 
 #include "crypto/chacha20.h"
+#include "crypto/rsaes.h"
 
 TEST(libretroshare_crypto, ChaCha20)
 {
@@ -30,3 +39,87 @@ TEST(libretroshare_crypto, ChaCha20)
 
     EXPECT_TRUE(librs::crypto::perform_tests()) ;
 }
+
+/* GXS tunnel cipher benchmark: time needed to build an encrypted tunnel packet
+ * out of a serialised item, for the legacy format (AES-128-CBC + HMAC-SHA1,
+ * with its intermediate buffers) and for both AEAD formats (in place).
+ *
+ * Disabled by default. Run it with:
+ *   unittests --gtest_also_run_disabled_tests --gtest_filter='*TunnelCipherBenchmark*'
+ */
+
+static double wallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double benchLegacy(const std::vector<uint8_t> &item, int packets)
+{
+	uint8_t key[16] = { 0x42 };
+	uint8_t iv[8] = { 0x01 };
+
+	double start = wallTime();
+	for(int i = 0; i < packets; i++)
+	{
+		std::vector<uint8_t> buff(item);	// serialisation buffer
+
+		uint32_t encrypted_size = RsAES::get_buffer_size(buff.size());
+		std::vector<uint8_t> encrypted(encrypted_size);
+		EXPECT_TRUE(RsAES::aes_crypt_8_16(buff.data(), buff.size(), key, iv, encrypted.data(), encrypted_size));
+
+		std::vector<uint8_t> packet(8 + 20 + encrypted_size);
+		unsigned int md_len = 20;
+		memcpy(packet.data(), iv, 8);
+		HMAC(EVP_sha1(), key, 16, encrypted.data(), encrypted_size, &packet[8], &md_len);
+		memcpy(&packet[28], encrypted.data(), encrypted_size);
+	}
+	return wallTime() - start;
+}
+
+static double benchAead(const std::vector<uint8_t> &item, int packets, bool gcm)
+{
+	uint8_t key[32] = { 0x42 };
+
+	double start = wallTime();
+	for(int i = 0; i < packets; i++)
+	{
+		std::vector<uint8_t> packet(16 + item.size() + 16);
+		memcpy(&packet[16], item.data(), item.size());	// serialisation
+		packet[4] = i;	// nonce
+
+		uint8_t *nonce = &packet[4];
+		uint8_t *data = &packet[16];
+		uint8_t *tag = &packet[16 + item.size()];
+
+		if(gcm)
+			EXPECT_TRUE(librs::crypto::AEAD_aes_256_gcm(key, nonce, data, item.size(), packet.data(), 16, tag, true));
+		else
+			EXPECT_TRUE(librs::crypto::AEAD_chacha20_poly1305(key, nonce, data, item.size(), packet.data(), 16, tag, true));
+	}
+	return wallTime() - start;
+}
+
+TEST(libretroshare_crypto, DISABLED_TunnelCipherBenchmark)
+{
+	const uint32_t sizes[] = { 100, 1000, 10000, 100000 };
+	const uint64_t TOTAL_BYTES = 50 * 1024 * 1024;
+
+	std::cout << "{" << std::endl;
+	std::cout << "  \"benchmark\": \"gxs_tunnel_ciphers\", \"hardware_aes\": " << (librs::crypto::has_hardware_aes() ? "true" : "false") << "," << std::endl;
+	std::cout << "  \"results\": [" << std::endl;
+
+	for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		std::vector<uint8_t> item(sizes[i], 0x37);
+		int packets = TOTAL_BYTES / sizes[i];
+		double mb = packets * (double) sizes[i] / (1024.0 * 1024.0);
+
+		std::cout << "    { \"packet_size\": " << sizes[i];
+		std::cout << ", \"legacy_MBps\": " << mb / benchLegacy(item, packets);
+		std::cout << ", \"aes_256_gcm_MBps\": " << mb / benchAead(item, packets, true);
+		std::cout << ", \"chacha20_poly1305_MBps\": " << mb / benchAead(item, packets, false) << " }";
+		std::cout << (i + 1 < sizeof(sizes) / sizeof(sizes[0]) ? "," : "") << std::endl;
+	}
+
+	std::cout << "  ]" << std::endl << "}" << std::endl;
+}
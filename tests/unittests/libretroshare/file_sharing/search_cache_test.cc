@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * unittests/libretroshare/file_sharing/search_cache_test.cc                   *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+// from libretroshare
+
+#include "file_sharing/search_cache.h"
+
+using namespace RsRegularExpression;
+
+typedef LocalSearchCache::EntryIndex EntryIndex;
+
+static std::list<std::string> words(const char *w1, const char *w2 = nullptr)
+{
+	std::list<std::string> l;
+	l.push_back(w1);
+	if(w2) l.push_back(w2);
+	return l;
+}
+
+static std::list<DirDetails> details(const std::list<EntryIndex>& files)
+{
+	std::list<DirDetails> l;
+	for(EntryIndex e: files)
+	{
+		DirDetails d;
+		d.type = DIR_TYPE_FILE;
+		d.name = "file" + std::to_string(e);
+		l.push_back(d);
+	}
+	return l;
+}
+
+static void put(LocalSearchCache& cache, const std::string& key, const std::list<std::string>& terms, const std::list<EntryIndex>& files)
+{
+	LocalSearchCache::Search search;
+	search.keywords = true;
+	search.terms = terms;
+	cache.put(key, cache.generation(), search, files, details(files), 100);
+}
+
+// Changed files matching the "new" term only
+static bool matchesNew(EntryIndex e, const LocalSearchCache::Search& s)
+{
+	return e >= 100 && std::find(s.terms.begin(), s.terms.end(), "new") != s.terms.end();
+}
+
+TEST(libretroshare_file_sharing, LocalSearchCacheKeys)
+{
+	FileSearchFlags anon = RS_FILE_HINTS_LOCAL | RS_FILE_HINTS_SEARCHABLE;
+	RsPeerId peer = RsPeerId::random();
+
+	EXPECT_EQ(LocalSearchCache::makeKey(words("Linux", "ISO"), anon, RsPeerId()),
+	          LocalSearchCache::makeKey(words("iso", "linux"), anon, RsPeerId()));
+	EXPECT_NE(LocalSearchCache::makeKey(words("linux"), anon, RsPeerId()),
+	          LocalSearchCache::makeKey(words("linux"), anon, peer));
+	EXPECT_NE(LocalSearchCache::makeKey(words("linux"), anon, RsPeerId()),
+	          LocalSearchCache::makeKey(words("linux"), RS_FILE_HINTS_LOCAL | RS_FILE_HINTS_BROWSABLE, RsPeerId()));
+	EXPECT_NE(LocalSearchCache::makeKey(words("ab", "c"), anon, RsPeerId()),
+	          LocalSearchCache::makeKey(words("a", "bc"), anon, RsPeerId()));
+
+	std::list<std::string> t1, t2;
+	t1.push_back("ab"); t1.push_back("c");
+	t2.push_back("a"); t2.push_back("bc");
+	NameExpression e1(ContainsAllStrings, t1, true), e2(ContainsAllStrings, t2, true);
+	EXPECT_NE(LocalSearchCache::makeKey(e1, anon, RsPeerId()), LocalSearchCache::makeKey(e2, anon, RsPeerId()));
+	EXPECT_NE(LocalSearchCache::makeKey(e1, anon, RsPeerId()), LocalSearchCache::makeKey(words("ab", "c"), anon, RsPeerId()));
+}
+
+TEST(libretroshare_file_sharing, LocalSearchCacheHitsAndInvalidation)
+{
+	LocalSearchCache cache(1024*1024);
+	std::list<DirDetails> results;
+
+	EXPECT_FALSE(cache.get("linux", results));
+	put(cache, "linux", words("linux"), {1, 2, 3});
+	put(cache, "new", words("new"), {4});
+
+	ASSERT_TRUE(cache.get("linux", results));
+	EXPECT_EQ(results.size(), 3u);
+	EXPECT_EQ(results.front().name, "file1");
+
+	// file 2 changed: the entry returning it goes
+	cache.invalidate({2}, matchesNew);
+	EXPECT_FALSE(cache.get("linux", results));
+	EXPECT_TRUE(cache.get("new", results));
+
+	// file 100 is new and matches
+	cache.invalidate({100}, matchesNew);
+	EXPECT_FALSE(cache.get("new", results));
+
+	SearchCacheStats stats;
+	cache.getStatistics(stats);
+	EXPECT_EQ(stats.hits, 2u);
+	EXPECT_EQ(stats.misses, 3u);
+	EXPECT_EQ(stats.cpu_saved_us, 200u);
+	EXPECT_EQ(stats.entries, 0u);
+	EXPECT_EQ(stats.memory_usage, 0u);
+
+	// results of a search that started before an invalidation are not kept
+	uint32_t generation = cache.generation();
+	cache.invalidate({7}, matchesNew);
+	LocalSearchCache::Search search;
+	cache.put("late", generation, search, {7}, details({7}), 100);
+	EXPECT_FALSE(cache.get("late", results));
+}
+
+TEST(libretroshare_file_sharing, LocalSearchCacheMemoryBound)
+{
+	LocalSearchCache cache(64*1024);
+	std::list<EntryIndex> files;
+	for(EntryIndex i = 0; i < 20; ++i) files.push_back(i);
+
+	for(int i = 0; i < 100; ++i)
+	{
+		put(cache, "search" + std::to_string(i), words("x"), files);
+
+		std::list<DirDetails> results;
+		EXPECT_TRUE(cache.get("search0", results));	// keeps the first one in use
+	}
+
+	SearchCacheStats stats;
+	cache.getStatistics(stats);
+	EXPECT_LE(stats.memory_usage, 64*1024u);
+	EXPECT_GT(stats.entries, 1u);
+	EXPECT_LT(stats.entries, 100u);
+
+	std::list<DirDetails> results;
+	EXPECT_TRUE(cache.get("search99", results));
+	EXPECT_FALSE(cache.get("search1", results));
+
+	// too big to be worth caching
+	for(EntryIndex i = 20; i < 2000; ++i) files.push_back(i);
+	put(cache, "big", words("x"), files);
+	EXPECT_FALSE(cache.get("big", results));
+}
@@ -0,0 +1,220 @@
+/*******************************************************************************
+ * unittests/libretroshare/ft/ftfilecreator_test.cc                            *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+// from libretroshare
+
+#include "ft/ftfilecreator.h"
+#include "util/rsdir.h"
+
+static const uint32_t CHUNK_SIZE = ChunkMap::CHUNKMAP_FIXED_CHUNK_SIZE;
+
+static std::vector<unsigned char> makeData(uint64_t size)
+{
+	std::vector<unsigned char> data(size);
+	for(uint64_t i = 0; i < size; ++i)
+		data[i] = static_cast<unsigned char>(i * 2654435761ULL >> 13);
+	return data;
+}
+
+static std::vector<unsigned char> readFile(const std::string& path)
+{
+	std::vector<unsigned char> data;
+	FILE* f = fopen(path.c_str(), "rb");
+	if(!f) return data;
+	unsigned char buf[65536];
+	size_t n;
+	while((n = fread(buf, 1, sizeof(buf), f)) > 0)
+		data.insert(data.end(), buf, buf + n);
+	fclose(f);
+	return data;
+}
+
+/// Check the chunks waiting for their CRC, as if the sources had sent them
+static void checkChunks(ftFileCreator& creator, const std::vector<unsigned char>& data)
+{
+	std::vector<uint32_t> chunks;
+	creator.getChunksToCheck(chunks);
+
+	for(uint32_t i = 0; i < chunks.size(); ++i)
+	{
+		uint64_t offset = (uint64_t)chunks[i] * CHUNK_SIZE;
+		uint64_t len = std::min((uint64_t)CHUNK_SIZE, data.size() - offset);
+		EXPECT_TRUE(creator.verifyChunk(chunks[i], RsDirUtil::sha1sum(&data[offset], len)));
+	}
+}
+
+/// Ask slices of slice_size to a single full source, and receive them in pieces of piece_size
+static void download( ftFileCreator& creator, const std::vector<unsigned char>& data,
+                      uint32_t slice_size, uint32_t piece_size )
+{
+	RsPeerId peer = RsPeerId::random();
+	int rounds = 0;
+
+	while(!creator.finished() && ++rounds < 100000)
+	{
+		uint64_t offset;
+		uint32_t size;
+		bool map_needed;
+
+		checkChunks(creator, data);
+
+		if(!creator.getMissingChunk(peer, slice_size, offset, size, map_needed) || size == 0)
+			continue;
+
+		for(uint32_t done = 0; done < size; done += piece_size)
+		{
+			uint32_t n = std::min(piece_size, size - done);
+			ASSERT_TRUE(creator.addFileData(offset + done, n, const_cast<unsigned char*>(&data[offset + done])));
+		}
+	}
+}
+
+TEST(libretroshare_ft, ftFileCreatorWriteBuffers)
+{
+	const uint64_t SIZE = 3 * CHUNK_SIZE + 1000;
+	std::string path = "ftfilecreator_test.tmp";
+	remove(path.c_str());
+
+	std::vector<unsigned char> data = makeData(SIZE);
+	RsFileHash hash;
+
+	ftFileCreator::WriteStats before, after;
+	ftFileCreator::getWriteStats(before);
+	{
+		ftFileCreator creator(path, SIZE, hash, true);
+
+		download(creator, data, 64 * 1024, 8 * 1024);
+		EXPECT_TRUE(creator.finished());
+		EXPECT_EQ(readFile(path), data);
+
+		unsigned char buf[1000];
+		uint32_t size = sizeof(buf);
+		EXPECT_TRUE(creator.getFileData(RsPeerId::random(), SIZE - 1000, size, buf));
+		ASSERT_EQ(size, 1000u);
+		EXPECT_EQ(memcmp(buf, &data[SIZE - 1000], size), 0);
+	}
+	ftFileCreator::getWriteStats(after);
+
+	EXPECT_EQ(after.receivedBytes - before.receivedBytes, SIZE);
+	EXPECT_GT(after.receivedSlices - before.receivedSlices, 3 * 128u);
+
+	// the whole file fits in the buffers: all chunks are checked without reading
+	// the file, and everything is written at once when the file is complete.
+	EXPECT_EQ(after.bufferedChunkChecks - before.bufferedChunkChecks, 4u);
+	EXPECT_EQ(after.writeCalls - before.writeCalls, 1u);
+
+	remove(path.c_str());
+}
+
+TEST(libretroshare_ft, ftFileCreatorBuffersAreWrittenBeforeReading)
+{
+	const uint64_t SIZE = 2 * CHUNK_SIZE;
+	const uint32_t HALF = CHUNK_SIZE / 2;
+	std::string path = "ftfilecreator_test2.tmp";
+	remove(path.c_str());
+
+	std::vector<unsigned char> data = makeData(SIZE);
+	RsFileHash hash;
+	ftFileCreator creator(path, SIZE, hash, true);
+
+	RsPeerId peer = RsPeerId::random();
+	uint64_t offset;
+	uint32_t size;
+	bool map_needed;
+
+	ASSERT_TRUE(creator.getMissingChunk(peer, CHUNK_SIZE, offset, size, map_needed));
+	ASSERT_EQ(size, CHUNK_SIZE);
+
+	ftFileCreator::WriteStats before, after;
+	ftFileCreator::getWriteStats(before);
+
+	// second half first: both halves are merged in a single buffer
+	ASSERT_TRUE(creator.addFileData(offset + HALF, HALF, &data[offset + HALF]));
+	ASSERT_TRUE(creator.addFileData(offset, HALF, &data[offset]));
+	checkChunks(creator, data);
+
+	ftFileCreator::getWriteStats(after);
+	EXPECT_EQ(after.writeCalls, before.writeCalls);
+	EXPECT_EQ(after.bufferedChunkChecks, before.bufferedChunkChecks + 1);
+
+	// serving the chunk to another peer writes it
+	unsigned char buf[4096];
+	size = sizeof(buf);
+	EXPECT_TRUE(creator.getFileData(RsPeerId::random(), offset + HALF - 2048, size, buf));
+	EXPECT_EQ(memcmp(buf, &data[offset + HALF - 2048], size), 0);
+
+	ftFileCreator::getWriteStats(after);
+	EXPECT_EQ(after.writeCalls, before.writeCalls + 1);
+
+	remove(path.c_str());
+}
+
+/* Write benchmark: a 64 MB download received in 8 kB slices, in random chunk
+ * order, with the write calls per MB received. The partial file is in the
+ * current directory.
+ *
+ * Disabled by default. Run it with:
+ *   unittests --gtest_also_run_disabled_tests --gtest_filter='*ftFileCreatorWriteBenchmark*'
+ */
+
+static double wallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TEST(libretroshare_ft, DISABLED_ftFileCreatorWriteBenchmark)
+{
+	const uint64_t SIZE = 64 * CHUNK_SIZE;
+	std::string path = "ftfilecreator_bench.tmp";
+	remove(path.c_str());
+
+	std::vector<unsigned char> data = makeData(SIZE);
+	RsFileHash hash;
+
+	ftFileCreator::WriteStats before, after;
+	ftFileCreator::getWriteStats(before);
+	double start = wallTime();
+	{
+		ftFileCreator creator(path, SIZE, hash, true);
+		creator.setChunkStrategy(FileChunksInfo::CHUNK_STRATEGY_RANDOM);
+		download(creator, data, 128 * 1024, 8 * 1024);
+		EXPECT_TRUE(creator.finished());
+	}
+	double elapsed = wallTime() - start;
+	ftFileCreator::getWriteStats(after);
+
+	double mb = (after.receivedBytes - before.receivedBytes) / (1024.0 * 1024.0);
+
+	std::cout << "{ \"benchmark\": \"ft_file_creator_write\", \"bytes\": " << after.receivedBytes - before.receivedBytes
+	          << ", \"slices\": " << after.receivedSlices - before.receivedSlices
+	          << ", \"write_calls\": " << after.writeCalls - before.writeCalls
+	          << ", \"write_calls_per_mb\": " << (after.writeCalls - before.writeCalls) / mb
+	          << ", \"buffered_chunk_checks\": " << after.bufferedChunkChecks - before.bufferedChunkChecks
+	          << ", \"total_s\": " << elapsed << " }" << std::endl;
+
+	remove(path.c_str());
+}
@@ -0,0 +1,226 @@
+/*******************************************************************************
+ * unittests/libretroshare/ft/ftfilemover_test.cc                              *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+// from libretroshare
+
+#include "ft/ftcontroller.h"
+#include "ft/ftfilemover.h"
+#include "rsitems/rsconfigitems.h"
+#include "util/rsdir.h"
+
+static std::string testDir()
+{
+	std::string dir = RsDirUtil::makePath(
+	            ::testing::TempDir(), "ftfilemover_test_" + std::to_string(getpid()) );
+	RsDirUtil::checkCreateDirectory(dir);
+	return dir;
+}
+
+static void writeFile(const std::string& path, size_t size)
+{
+	std::ofstream f(path, std::ios::binary);
+	for(size_t i = 0; i < size; ++i) f.put(static_cast<char>(i * 31));
+}
+
+static std::string readFile(const std::string& path)
+{
+	std::ifstream f(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static std::list<ftFileMover::Move> waitForMoves(ftFileMover& mover, size_t count)
+{
+	std::list<ftFileMover::Move> moves;
+	for(int i = 0; i < 500 && moves.size() < count; ++i)
+	{
+		mover.getFinishedMoves(moves);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return moves;
+}
+
+TEST(libretroshare_ft, RsDirUtilCopyFileProgress)
+{
+	std::string dir = testDir();
+	std::string src = RsDirUtil::makePath(dir, "src.bin");
+	std::string dst = RsDirUtil::makePath(dir, "dst.bin");
+	writeFile(src, 3*1024*1024 + 17);
+
+	uint64_t last = 0;
+	EXPECT_TRUE(RsDirUtil::copyFile(src, dst, [&](uint64_t copied, uint64_t total)
+	{
+		EXPECT_GE(copied, last);
+		EXPECT_EQ(total, 3u*1024*1024 + 17);
+		last = copied;
+		return true;
+	}));
+	EXPECT_EQ(last, 3u*1024*1024 + 17);
+	EXPECT_TRUE(readFile(src) == readFile(dst));
+
+	// abandoned copies leave nothing behind
+	RsDirUtil::removeFile(dst);
+	EXPECT_FALSE(RsDirUtil::copyFile(src, dst, [](uint64_t, uint64_t) { return false; }));
+	EXPECT_FALSE(RsDirUtil::fileExists(dst));
+
+	RsDirUtil::removeFile(src);
+}
+
+TEST(libretroshare_ft, ftFileMover)
+{
+	std::string dir = testDir();
+	std::string src = RsDirUtil::makePath(dir, "complete.bin");
+	std::string dst = RsDirUtil::makePath(RsDirUtil::makePath(dir, "downloads"), "complete.bin");
+	writeFile(src, 100000);
+	std::string data = readFile(src);
+
+	ftFileMover mover;
+	mover.start("ft mover test");
+
+	RsFileHash hash = RsFileHash::random();
+	RsFileHash missing = RsFileHash::random();
+
+	mover.queueMove(hash, src, dst, data.size());
+	mover.queueMove(missing, RsDirUtil::makePath(dir, "missing.bin"), dst + ".2", 10);
+
+	std::list<ftFileMover::Move> moves = waitForMoves(mover, 2);
+	ASSERT_EQ(moves.size(), 2u);
+
+	EXPECT_EQ(moves.front().hash, hash);
+	EXPECT_TRUE(moves.front().ok);
+	EXPECT_FALSE(RsDirUtil::fileExists(src));
+	EXPECT_TRUE(readFile(dst) == data);
+
+	EXPECT_EQ(moves.back().hash, missing);
+	EXPECT_FALSE(moves.back().ok);
+
+	uint64_t moved, total;
+	EXPECT_FALSE(mover.getProgress(hash, moved, total));
+	EXPECT_FALSE(mover.cancelMove(hash));
+
+	mover.fullstop();
+
+	// moves queued after stop are never done, but can still be cancelled
+	mover.queueMove(hash, dst, src, data.size());
+	EXPECT_TRUE(mover.getProgress(hash, moved, total));
+	EXPECT_EQ(moved, 0u);
+	EXPECT_EQ(total, data.size());
+	EXPECT_TRUE(mover.cancelMove(hash));
+
+	moves.clear();
+	mover.getFinishedMoves(moves);
+	ASSERT_EQ(moves.size(), 1u);
+	EXPECT_FALSE(moves.front().ok);
+	EXPECT_TRUE(RsDirUtil::fileExists(dst));
+
+	RsDirUtil::removeFile(dst);
+}
+
+class ftControllerMoveTest: public ftController
+{
+public:
+	ftControllerMoveTest() : ftController(NULL, NULL, RS_SERVICE_TYPE_FILE_TRANSFER) {}
+
+	using ftController::saveList;
+	using ftController::loadList;
+	using ftController::checkFinishedMoves;
+};
+
+TEST(libretroshare_ft, ftControllerMoveAfterReload)
+{
+	std::string dir = testDir();
+	std::string src = RsDirUtil::makePath(dir, "moving.bin");
+	std::string dst = RsDirUtil::makePath(RsDirUtil::makePath(dir, "reloaded"), "moving.bin");
+	writeFile(src, 100000);
+	std::string data = readFile(src);
+
+	RsFileHash hash = RsFileHash::random();
+
+	// The move is interrupted: the mover stops before doing it.
+
+	ftFileMover mover1;
+	mover1.start("ft mover test 1");
+	mover1.fullstop();
+
+	ftControllerMoveTest ctrl1;
+	ctrl1.setFileMover(&mover1);
+
+	RsFileTransfer *rft = new RsFileTransfer();
+	rft->file.name = dst;
+	rft->file.path = src;
+	rft->file.hash = hash;
+	rft->file.filesize = data.size();
+	rft->state = ftFileControl::MOVING;
+
+	std::list<RsItem*> items(1, rft);
+	ctrl1.loadList(items);
+
+	FileInfo info;
+	ASSERT_TRUE(ctrl1.FileDetails(hash, info));
+	EXPECT_EQ(info.downloadStatus, FT_STATE_MOVING);
+
+	bool cleanup;
+	ctrl1.saveList(cleanup, items);
+
+	int moving = 0;
+	for(RsItem *item : items)
+	{
+		RsFileTransfer *saved = dynamic_cast<RsFileTransfer*>(item);
+
+		if(saved && saved->state == ftFileControl::MOVING)
+		{
+			EXPECT_EQ(saved->file.hash, hash);
+			EXPECT_EQ(saved->file.path, src);
+			EXPECT_EQ(saved->file.name, dst);
+			++moving;
+		}
+	}
+	EXPECT_EQ(moving, 1);
+	EXPECT_TRUE(RsDirUtil::fileExists(src));
+
+	// After a reload the move is queued again and completes.
+
+	ftFileMover mover2;
+	mover2.start("ft mover test 2");
+
+	ftControllerMoveTest ctrl2;
+	ctrl2.setFileMover(&mover2);
+	ctrl2.loadList(items);
+
+	for(int i = 0; i < 500; ++i)
+	{
+		ctrl2.checkFinishedMoves();
+		if(ctrl2.FileDetails(hash, info) && info.downloadStatus != FT_STATE_MOVING)
+			break;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	EXPECT_EQ(info.downloadStatus, FT_STATE_COMPLETE);
+	EXPECT_EQ(info.path, dst);
+	EXPECT_FALSE(RsDirUtil::fileExists(src));
+	EXPECT_TRUE(readFile(dst) == data);
+
+	mover2.fullstop();
+	RsDirUtil::removeFile(dst);
+}
@@ -262,6 +262,16 @@ void init_item(RsNxsTransacItem &rstx,RsSerialType **ser)
 		*ser = new RsNxsSerialiser(RS_SERVICE_TYPE_PLUGIN_SIMPLE_FORUM);
 }
 
+void init_item(RsNxsGroupUpdateNoticeItem& rsun,RsSerialType **ser)
+{
+    rsun.clear();
+
+    init_random(rsun.grpId) ;
+    rsun.updateTS = rand()%14141;
+
+	if(ser)
+		*ser = new RsNxsSerialiser(RS_SERVICE_TYPE_PLUGIN_SIMPLE_FORUM);
+}
 
 bool operator==(const RsNxsSyncGrpReqItem& l, const RsNxsSyncGrpReqItem& r)
 {
@@ -318,3 +328,11 @@ bool operator==(const RsNxsTransacItem& l, const RsNxsTransacItem& r){
     return true;
 }
 
+bool operator==(const RsNxsGroupUpdateNoticeItem& l, const RsNxsGroupUpdateNoticeItem& r)
+{
+    if(l.grpId != r.grpId) return false;
+    if(l.updateTS != r.updateTS) return false;
+
+    return true;
+}
+
@@ -0,0 +1,252 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxs/data_service/rsdataservice_bench.cc             *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "gxs/rsdataservice.h"
+#include "rsitems/rsserviceids.h"
+#include "util/retrodb.h"
+#include "util/rsdir.h"
+
+/* GXS database layout benchmark: fills a database in the release 2 layout
+ * (hex ids, payloads in the meta rows), measures its size and the time of the
+ * usual meta queries, lets RsDataService convert it to the current layout and
+ * measures again. The disk used during the update, journal included, is
+ * sampled to report its peak.
+ *
+ * Disabled by default. Run it with:
+ *   unittests --gtest_also_run_disabled_tests --gtest_filter='*DataServiceLayoutBenchmark*'
+ */
+
+#define BENCH_DIR     std::string("rsdataservice_bench")
+#define BENCH_DB_NAME std::string("bench_db")
+
+static const int GROUPS = 10;
+static const int MSGS_PER_GROUP = 2000;
+static const int PAYLOAD_SIZE = 2000;
+static const int LOOKUPS = 1000;
+
+static const char *META_COLUMNS[] = { "grpId", "timeStamp", "flags", "signSet", "identity", "hash", "msgId", "origMsgId",
+                                      "msgStatus", "childTs", "parentId", "threadId", "msgName", "serv_str", "recv_time_stamp", "nxsDataLen" };
+
+struct BenchMsg
+{
+	RsGxsGroupId grpId;
+	RsGxsMessageId msgId;
+	RsGxsMessageId parentId;
+	int32_t ts;
+};
+
+static double wallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t fileSize(const std::string &path)
+{
+	std::ifstream f(path.c_str(), std::ios::binary | std::ios::ate);
+	return f ? (uint64_t) f.tellg() : 0;
+}
+
+static void createRelease2Database(const std::string &path, std::vector<BenchMsg> &msgs)
+{
+	RetroDb db(path, RetroDb::OPEN_READWRITE_CREATE, "");
+
+	db.execSQL("CREATE TABLE DATABASE_RELEASE(id INT PRIMARY KEY,release INT);");
+	db.execSQL("INSERT INTO DATABASE_RELEASE VALUES(1,2);");
+	db.execSQL("CREATE TABLE MESSAGES(msgId TEXT PRIMARY KEY,grpId TEXT,flags INT,origMsgId TEXT,timeStamp INT,identity TEXT,signSet BLOB,"
+	           "nxsData BLOB,nxsDataLen INT,msgStatus INT,childTs INT,meta BLOB,threadId TEXT,parentId TEXT,msgName TEXT,serv_str TEXT,"
+	           "hash TEXT,recv_time_stamp INT);");
+	db.execSQL("CREATE TABLE GROUPS(grpId TEXT PRIMARY KEY,timeStamp INT,nxsData BLOB,nxsDataLen INT,keySet BLOB,meta BLOB,grpName TEXT,"
+	           "lastPost INT,popularity INT,msgCount INT,subscribeFlag INT,grpStatus INT,identity TEXT,origGrpId TEXT,serv_str TEXT,flags INT,"
+	           "authenFlags INT,signFlags INT,circleId TEXT,circleType INT,internalCircle TEXT,originator TEXT,hash TEXT,recv_time_stamp INT,"
+	           "parentGrpId TEXT,rep_cutoff INT,signSet BLOB);");
+	db.execSQL("CREATE INDEX INDEX_MESSAGES_GRPID ON MESSAGES(grpId);");
+	db.execSQL("CREATE INDEX INDEX_MESSAGES_GRPID_TS ON MESSAGES(grpId,timeStamp);");
+	db.execSQL("CREATE INDEX INDEX_MESSAGES_GRPID_PARENTID ON MESSAGES(grpId,parentId);");
+
+	std::vector<char> payload(PAYLOAD_SIZE, 'x');
+	std::vector<char> signature(300, 's');
+
+	db.beginTransaction();
+
+	for(int g = 0; g < GROUPS; g++)
+	{
+		RsGxsGroupId grpId = RsGxsGroupId::random();
+
+		ContentValue gcv;
+		gcv.put("grpId", grpId.toStdString());
+		gcv.put("nxsData", PAYLOAD_SIZE, payload.data());
+		gcv.put("nxsDataLen", (int32_t) PAYLOAD_SIZE);
+		gcv.put("grpName", "group " + std::to_string(g));
+		db.sqlInsert("GROUPS", "", gcv);
+
+		std::vector<RsGxsMessageId> threads;
+
+		for(int m = 0; m < MSGS_PER_GROUP; m++)
+		{
+			BenchMsg msg;
+			msg.grpId = grpId;
+			msg.msgId = RsGxsMessageId::random();
+			msg.ts = 1600000000 + m;
+
+			// one thread head every 10 messages, the others reply to one of them
+			if (m % 10 == 0)
+			{
+				threads.push_back(msg.msgId);
+			}
+			else
+			{
+				msg.parentId = threads[m % threads.size()];
+			}
+
+			ContentValue cv;
+			cv.put("msgId", msg.msgId.toStdString());
+			cv.put("grpId", grpId.toStdString());
+			cv.put("timeStamp", msg.ts);
+			cv.put("parentId", msg.parentId.toStdString());
+			cv.put("threadId", msg.parentId.toStdString());
+			cv.put("origMsgId", RsGxsMessageId().toStdString());
+			cv.put("signSet", (uint32_t) signature.size(), signature.data());
+			cv.put("nxsData", PAYLOAD_SIZE, payload.data());
+			cv.put("nxsDataLen", (int32_t) PAYLOAD_SIZE);
+			cv.put("msgName", "message " + std::to_string(m));
+			cv.put("msgStatus", (int32_t) 0);
+			cv.put("recv_time_stamp", msg.ts);
+			db.sqlInsert("MESSAGES", "", cv);
+
+			msgs.push_back(msg);
+		}
+	}
+
+	db.commitTransaction();
+	db.vacuum();
+}
+
+static std::string sqlId(const std::string &hex, bool blobIds)
+{
+	return blobIds ? "X'" + hex + "'" : "'" + hex + "'";
+}
+
+static int countRows(RetroDb &db, const std::string &where, const std::string &orderBy, uint32_t limit)
+{
+	std::list<std::string> columns(std::begin(META_COLUMNS), std::end(META_COLUMNS));
+	RetroCursor *c = db.sqlQuery("MESSAGES", columns, where, orderBy, limit);
+
+	int count = 0;
+	for(bool valid = c && c->moveToFirst(); valid; valid = c->moveToNext())
+	{
+		uint32_t len;
+		c->getData(3, len);	// signSet, so that the rows are really read
+		count++;
+	}
+
+	delete c;
+	return count;
+}
+
+static void runQueries(const std::string &path, const std::vector<BenchMsg> &msgs, bool blobIds, const std::string &layout)
+{
+	RetroDb db(path, RetroDb::OPEN_READWRITE, "");
+
+	// all the metas of each group
+	double start = wallTime();
+	int rows = 0;
+	for(int i = 0; i < GROUPS; i++)
+	{
+		rows += countRows(db, "grpId=" + sqlId(msgs[i * MSGS_PER_GROUP].grpId.toStdString(), blobIds), "", 0);
+	}
+	double groupScan = wallTime() - start;
+	EXPECT_EQ(GROUPS * MSGS_PER_GROUP, rows);
+
+	// first page of thread heads of each group
+	start = wallTime();
+	for(int i = 0; i < GROUPS; i++)
+	{
+		rows = countRows(db, "grpId=" + sqlId(msgs[i * MSGS_PER_GROUP].grpId.toStdString(), blobIds)
+		                     + " AND parentId=" + sqlId(RsGxsMessageId().toStdString(), blobIds), "timeStamp DESC", 50);
+		EXPECT_EQ(50, rows);
+	}
+	double threadPage = wallTime() - start;
+
+	// single messages
+	start = wallTime();
+	for(int i = 0; i < LOOKUPS; i++)
+	{
+		const BenchMsg &msg = msgs[(i * 7919) % msgs.size()];
+		rows = countRows(db, "grpId=" + sqlId(msg.grpId.toStdString(), blobIds) + " AND msgId=" + sqlId(msg.msgId.toStdString(), blobIds), "", 0);
+		EXPECT_EQ(1, rows);
+	}
+	double lookups = wallTime() - start;
+
+	std::cout << "  \"" << layout << "\": { \"size_bytes\": " << fileSize(path);
+	std::cout << ", \"group_scan_s\": " << groupScan;
+	std::cout << ", \"thread_page_s\": " << threadPage;
+	std::cout << ", \"lookup_s\": " << lookups << " }";
+}
+
+TEST(libretroshare_gxs, DISABLED_DataServiceLayoutBenchmark)
+{
+	RsDirUtil::checkCreateDirectory(BENCH_DIR);
+	std::string path = BENCH_DIR + "/" + BENCH_DB_NAME;
+	remove(path.c_str());
+
+	std::vector<BenchMsg> msgs;
+	createRelease2Database(path, msgs);
+
+	std::cout << "{" << std::endl;
+	std::cout << "  \"benchmark\": \"gxs_db_layout\", \"messages\": " << msgs.size() << "," << std::endl;
+	runQueries(path, msgs, false, "release_2");
+	std::cout << "," << std::endl;
+
+	std::atomic<bool> updating(true);
+	uint64_t peakSize = 0;
+	std::thread sampler([&]()
+	{
+		while(updating)
+		{
+			peakSize = std::max(peakSize, fileSize(path) + fileSize(path + "-journal"));
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	});
+
+	// the update runs when the database is opened
+	double start = wallTime();
+	RsDataService *dataService = new RsDataService(BENCH_DIR, BENCH_DB_NAME, RS_SERVICE_GXS_TYPE_FORUMS, NULL, "");
+	delete dataService;
+	double update = wallTime() - start;
+
+	updating = false;
+	sampler.join();
+
+	std::cout << "  \"update_s\": " << update << ", \"update_peak_disk_bytes\": " << peakSize << "," << std::endl;
+
+	runQueries(path, msgs, true, "release_3");
+	std::cout << std::endl << "}" << std::endl;
+
+	remove(path.c_str());
+}
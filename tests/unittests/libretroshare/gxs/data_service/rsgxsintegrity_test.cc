@@ -0,0 +1,251 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxs/data_service/rsgxsintegrity_test.cc             *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+// from libretroshare
+
+#include "gxs/rsgds.h"
+#include "gxs/rsgxsutil.h"
+#include "pqi/pqihash.h"
+#include "rsitems/rsserviceids.h"
+
+/*!
+ * Data service keeping groups and messages in memory, with the hash of each
+ * one, and nothing else.
+ */
+class IntegrityTestDataService : public RsGeneralDataService
+{
+public:
+	struct Item
+	{
+		std::string data;
+		RsFileHash hash;
+	};
+
+	std::map<RsGxsGroupId, Item> mGrps;
+	std::map<RsGxsGroupId, std::map<RsGxsMessageId, Item> > mMsgs;
+	std::map<std::string, std::string> mState;
+	uint32_t mMsgReads = 0;
+
+	static Item makeItem(const std::string& data)
+	{
+		Item item;
+		item.data = data;
+
+		pqihash pHash;
+		pHash.addData(data.data(), data.size());
+		pHash.Complete(item.hash);
+		return item;
+	}
+
+	int retrieveNxsMsgs(const GxsMsgReq& reqIds, GxsMsgResult& msg, bool) override
+	{
+		for(auto& it: reqIds)
+			for(auto& msgId: it.second)
+			{
+				auto mit = mMsgs[it.first].find(msgId);
+				if(mit == mMsgs[it.first].end())
+					continue;
+
+				RsNxsMsg *m = new RsNxsMsg(RS_SERVICE_GXS_TYPE_FORUMS);
+				m->grpId = it.first;
+				m->msgId = msgId;
+				m->msg.setBinData(mit->second.data.data(), mit->second.data.size());
+				m->metaData = new RsGxsMsgMetaData();
+				m->metaData->mHash = mit->second.hash;
+
+				msg[it.first].push_back(m);
+				++mMsgReads;
+			}
+		return 1;
+	}
+
+	int retrieveNxsGrps(std::map<RsGxsGroupId, RsNxsGrp*>& grp, bool) override
+	{
+		for(auto& it: grp)
+		{
+			auto git = mGrps.find(it.first);
+			if(git == mGrps.end())
+				continue;
+
+			RsNxsGrp *g = new RsNxsGrp(RS_SERVICE_GXS_TYPE_FORUMS);
+			g->grpId = it.first;
+			g->grp.setBinData(git->second.data.data(), git->second.data.size());
+			g->metaData = new RsGxsGrpMetaData();
+			g->metaData->mHash = git->second.hash;
+			it.second = g;
+		}
+		return 1;
+	}
+
+	int retrieveGroupIds(std::vector<RsGxsGroupId>& grpIds) override
+	{
+		for(auto& it: mGrps)
+			grpIds.push_back(it.first);
+		return 1;
+	}
+
+	int retrieveMsgIds(const RsGxsGroupId& grpId, RsGxsMessageId::std_set& msgIds) override
+	{
+		for(auto& it: mMsgs[grpId])
+			msgIds.insert(it.first);
+		return 1;
+	}
+
+	bool storeStateValue(const std::string& key, const std::string& value) override
+	{
+		mState[key] = value;
+		return true;
+	}
+
+	bool retrieveStateValue(const std::string& key, std::string& value) override
+	{
+		auto it = mState.find(key);
+		if(it == mState.end())
+			return false;
+
+		value = it->second;
+		return true;
+	}
+
+	int retrieveGxsGrpMetaData(std::map<RsGxsGroupId,std::shared_ptr<RsGxsGrpMetaData> >&) override { return 0; }
+	int retrieveGxsMsgMetaData(const GxsMsgReq&, GxsMsgMetaResult&) override { return 0; }
+	int retrieveGxsMsgMetaData(const RsGxsGroupId&, const RsGxsMsgMetaFilter&, std::vector<std::shared_ptr<RsGxsMsgMetaData> >&) override { return 0; }
+	int removeMsgs(const GxsMsgReq&) override { return 0; }
+	int removeGroups(const std::vector<RsGxsGroupId>&) override { return 0; }
+	uint32_t cacheSize() const override { return 0; }
+	uint16_t serviceType() const override { return RS_SERVICE_GXS_TYPE_FORUMS; }
+	int setCacheSize(uint32_t) override { return 0; }
+	int storeMessage(const std::list<RsNxsMsg*>&) override { return 0; }
+	int storeGroup(const std::list<RsNxsGrp*>&) override { return 0; }
+	int updateGroup(const std::list<RsNxsGrp*>&) override { return 0; }
+	int updateMessageMetaData(const MsgLocMetaData&) override { return 0; }
+	int updateGroupMetaData(const GrpLocMetaData&) override { return 0; }
+	int updateGroupKeys(const RsGxsGroupId&, const RsTlvSecurityKeySet&, uint32_t) override { return 0; }
+	int resetDataStore() override { return 0; }
+	bool validSize(RsNxsMsg*) const override { return true; }
+	bool validSize(RsNxsGrp*) const override { return true; }
+};
+
+// 3 groups of 100 messages. One group and two messages have a wrong hash.
+
+static void fillDataService(IntegrityTestDataService& ds, RsGxsGroupId& badGrp, RsGxsMessageId& badMsg1, RsGxsMessageId& badMsg2)
+{
+	for(int g = 0; g < 3; ++g)
+	{
+		RsGxsGroupId grpId = RsGxsGroupId::random();
+		ds.mGrps[grpId] = IntegrityTestDataService::makeItem("group " + std::to_string(g));
+
+		for(int m = 0; m < 100; ++m)
+			ds.mMsgs[grpId][RsGxsMessageId::random()] = IntegrityTestDataService::makeItem(std::string(100 + m, 'a' + g));
+	}
+
+	auto git = ds.mGrps.begin();
+	badGrp = git->first;
+	git->second.data += "x";
+
+	++git;
+	auto mit = ds.mMsgs[git->first].begin();
+	badMsg1 = mit->first;
+	mit->second.data[0] = 'z';
+
+	std::advance(mit, 70);	// not in the same batch
+	badMsg2 = mit->first;
+	mit->second.hash = RsFileHash::random();
+}
+
+TEST(libretroshare_gxs, RsGxsSinglePassIntegrityCheck)
+{
+	IntegrityTestDataService ds;
+	RsGxsGroupId badGrp;
+	RsGxsMessageId badMsg1, badMsg2;
+	fillDataService(ds, badGrp, badMsg1, badMsg2);
+
+	RsGxsSinglePassIntegrityCheck checker(&ds);
+	checker.setHashThreads(4);
+
+	EXPECT_TRUE(checker.run([]() { return false; }));
+	EXPECT_TRUE(checker.cursor().isNull());
+
+	std::vector<RsGxsGroupId> grpIds;
+	GxsMsgReq msgIds;
+	checker.getDeletedIds(grpIds, msgIds);
+
+	ASSERT_EQ(1u, grpIds.size());
+	EXPECT_EQ(badGrp, grpIds[0]);
+
+	// messages of the wrong group are not read, they go away with it
+	EXPECT_EQ(200u, ds.mMsgReads);
+
+	ASSERT_EQ(1u, msgIds.size());
+	std::set<RsGxsMessageId>& msgs(msgIds.begin()->second);
+	ASSERT_EQ(2u, msgs.size());
+	EXPECT_TRUE(msgs.count(badMsg1));
+	EXPECT_TRUE(msgs.count(badMsg2));
+}
+
+TEST(libretroshare_gxs, RsGxsSinglePassIntegrityCheck_resume)
+{
+	IntegrityTestDataService ds;
+	RsGxsGroupId badGrp;
+	RsGxsMessageId badMsg1, badMsg2;
+	fillDataService(ds, badGrp, badMsg1, badMsg2);
+
+	// Interrupted after each batch, the check resumes from its cursor once
+	// saved and loaded again, as done across restarts.
+
+	std::set<RsGxsMessageId> found;
+	bool done = false;
+	int passes = 0;
+
+	while(!done && passes < 100)
+	{
+		RsGxsIntegrityCursor cursor;
+		std::string str;
+		if(ds.retrieveStateValue("integrity_cursor", str))
+			EXPECT_TRUE(cursor.fromString(str));
+
+		RsGxsSinglePassIntegrityCheck checker(&ds, cursor);
+		checker.setBatchSize(16);
+
+		int calls = 0;
+		done = checker.run([&]() { return ++calls > 2; });
+
+		std::vector<RsGxsGroupId> grpIds;
+		GxsMsgReq msgIds;
+		checker.getDeletedIds(grpIds, msgIds);
+		for(auto& it: msgIds)
+			found.insert(it.second.begin(), it.second.end());
+
+		EXPECT_EQ(done, checker.cursor().isNull());
+		ds.storeStateValue("integrity_cursor", checker.cursor().toString());
+		++passes;
+	}
+
+	EXPECT_TRUE(done);
+	EXPECT_GT(passes, 5);
+	EXPECT_EQ(200u, ds.mMsgReads);	// each message read once
+	EXPECT_EQ(2u, found.size());
+
+	RsGxsIntegrityCursor cursor;
+	EXPECT_FALSE(cursor.fromString("garbage"));
+	EXPECT_TRUE(cursor.isNull());
+}
@@ -20,6 +20,7 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include "gxs/gxssecurity.h"
@@ -92,4 +93,207 @@ TEST(libretroshare_gxs, GxsSecurity)
 	free(out) ;
 }
 
+TEST(libretroshare_gxs, GxsSecurityMultiEncryptionKeyHints)
+{
+	const uint32_t NB_KEYS = 4 ;
+
+	std::vector<RsTlvPublicRSAKey> pub_keys(NB_KEYS) ;
+	std::vector<RsTlvPrivateRSAKey> priv_keys(NB_KEYS) ;
+
+	for(uint32_t i=0;i<NB_KEYS;++i)
+		EXPECT_TRUE(GxsSecurity::generateKeyPair(pub_keys[i],priv_keys[i])) ;
+
+	uint32_t data_len = 1000 + RSRandom::random_u32()%100 ;
+	RsTemporaryMemory data(data_len) ;
+	RSRandom::random_bytes((unsigned char *)data,data_len) ;
+
+	// Encrypt for the first 3 keys only, the last one is used as a non-recipient.
+
+	std::vector<RsTlvPublicRSAKey> recipients(pub_keys.begin(),pub_keys.begin()+NB_KEYS-1) ;
+
+	for(int hints=0;hints<2;++hints)
+	{
+		uint8_t *out = NULL ;
+		uint32_t outlen = 0 ;
+
+		EXPECT_TRUE(GxsSecurity::encrypt(out,outlen,(const uint8_t*)data,data_len,recipients,hints)) ;
+
+		if(hints)
+		{
+			// Hints are salted: they do not show the key ids and differ from one message to the next.
+
+			uint8_t *out3 = NULL ;
+			uint32_t outlen3 = 0 ;
+
+			EXPECT_TRUE(GxsSecurity::encrypt(out3,outlen3,(const uint8_t*)data,data_len,recipients,hints)) ;
+
+			for(uint32_t i=0;i<recipients.size();++i)
+			{
+				const uint8_t *hint = out + 4 + 8 + 8*i ;
+
+				EXPECT_TRUE(memcmp(hint,recipients[i].keyId.toByteArray(),8) != 0) ;
+				EXPECT_TRUE(memcmp(hint,out3 + 4 + 8 + 8*i,8) != 0) ;
+			}
+			free(out3) ;
+		}
+
+		GxsSecurity::MultiEncryptionStats before,after ;
+		GxsSecurity::getMultiEncryptionStats(before) ;
 
+		// The last recipient, given along with the non-recipient key
+
+		std::vector<RsTlvPrivateRSAKey> own_keys ;
+		own_keys.push_back(priv_keys[NB_KEYS-1]) ;
+		own_keys.push_back(priv_keys[NB_KEYS-2]) ;
+
+		uint8_t *out2 = NULL ;
+		uint32_t outlen2 = 0 ;
+
+		EXPECT_TRUE(GxsSecurity::decrypt(out2,outlen2,out,outlen,own_keys)) ;
+		EXPECT_TRUE(data_len == outlen2) ;
+		EXPECT_TRUE(!memcmp(data,out2,outlen2)) ;
+		free(out2) ;
+
+		GxsSecurity::getMultiEncryptionStats(after) ;
+
+		if(hints)
+		{
+			// Only the right encrypted session key is tried.
+			EXPECT_EQ(after.unwrap_attempts - before.unwrap_attempts, 1u) ;
+			EXPECT_EQ(after.unwraps_skipped_by_hints - before.unwraps_skipped_by_hints, uint64_t(2*(NB_KEYS-1)-1)) ;
+		}
+		else
+			EXPECT_EQ(after.unwrap_attempts - before.unwrap_attempts, uint64_t(2*(NB_KEYS-1))) ;
+
+		// A non-recipient cannot decrypt.
+
+		std::vector<RsTlvPrivateRSAKey> other_keys(1,priv_keys[NB_KEYS-1]) ;
+
+		EXPECT_FALSE(GxsSecurity::decrypt(out2,outlen2,out,outlen,other_keys)) ;
+
+		free(out) ;
+	}
+}
+
+TEST(libretroshare_gxs, GxsSecurityPublicKeyCache)
+{
+	RsTlvPublicRSAKey pub_key, other_pub_key ;
+	RsTlvPrivateRSAKey priv_key, other_priv_key ;
+
+	EXPECT_TRUE(GxsSecurity::generateKeyPair(pub_key,priv_key)) ;
+	EXPECT_TRUE(GxsSecurity::generateKeyPair(other_pub_key,other_priv_key)) ;
+
+	uint32_t data_len = 1000 ;
+	RsTemporaryMemory data(data_len) ;
+	RSRandom::random_bytes((unsigned char *)data,data_len) ;
+
+	RsTlvKeySignature sign ;
+	EXPECT_TRUE(GxsSecurity::getSignature((const char *)(unsigned char*)data,data_len,priv_key,sign)) ;
+
+	GxsSecurity::PublicKeyCacheStats before, after ;
+	GxsSecurity::getPublicKeyCacheStats(before) ;
+
+	EXPECT_TRUE(GxsSecurity::validateSignature((const char *)(unsigned char*)data,data_len,pub_key,sign)) ;
+	EXPECT_TRUE(GxsSecurity::validateSignature((const char *)(unsigned char*)data,data_len,pub_key,sign)) ;
+
+	GxsSecurity::getPublicKeyCacheStats(after) ;
+	EXPECT_EQ(after.misses - before.misses, 1u) ;
+	EXPECT_EQ(after.hits - before.hits, 1u) ;
+
+	// A different key claiming the same id must not be confused with the cached one
+
+	other_pub_key.keyId = pub_key.keyId ;
+	EXPECT_FALSE(GxsSecurity::validateSignature((const char *)(unsigned char*)data,data_len,other_pub_key,sign)) ;
+
+	// and the cached key must still work after that
+
+	((unsigned char*)data)[0] ^= 0x01 ;
+	EXPECT_FALSE(GxsSecurity::validateSignature((const char *)(unsigned char*)data,data_len,pub_key,sign)) ;
+	((unsigned char*)data)[0] ^= 0x01 ;
+	EXPECT_TRUE(GxsSecurity::validateSignature((const char *)(unsigned char*)data,data_len,pub_key,sign)) ;
+}
+
+/* Signature check benchmark: 16 keys signing 1kB blocks in turn, like a few
+ * active identities posting. The reference parses the key and allocates the
+ * digest context at each check, as validateSignature() did before the cache
+ * of parsed keys.
+ *
+ * Disabled by default. Run it with:
+ *   unittests --gtest_also_run_disabled_tests --gtest_filter='*GxsSecurityVerifyBenchmark*'
+ */
+
+static double wallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool validateSignatureUncached(const char *data, uint32_t data_len, const RsTlvPublicRSAKey& key, const RsTlvKeySignature& sign)
+{
+	const unsigned char *keyptr = (const unsigned char *) key.keyData.bin_data;
+	RSA *rsakey = d2i_RSAPublicKey(NULL, &keyptr, key.keyData.bin_len);
+
+	if(!rsakey)
+		return false ;
+
+	EVP_PKEY *signKey = EVP_PKEY_new();
+	EVP_PKEY_assign_RSA(signKey, rsakey);
+	EVP_MD_CTX *mdctx = EVP_MD_CTX_create();
+
+	EVP_VerifyInit(mdctx, EVP_sha1());
+	EVP_VerifyUpdate(mdctx, data, data_len);
+	int signOk = EVP_VerifyFinal(mdctx, (unsigned char*)sign.signData.bin_data, sign.signData.bin_len, signKey);
+
+	EVP_PKEY_free(signKey);
+	EVP_MD_CTX_destroy(mdctx);
+
+	return signOk == 1 ;
+}
+
+TEST(libretroshare_gxs, DISABLED_GxsSecurityVerifyBenchmark)
+{
+	const uint32_t KEYS = 16 ;
+	const uint32_t CHECKS = 20000 ;
+	const uint32_t DATA_LEN = 1024 ;
+
+	std::vector<RsTlvPublicRSAKey> pub_keys(KEYS) ;
+	std::vector<RsTlvKeySignature> signs(KEYS) ;
+	std::vector<unsigned char> data(DATA_LEN * KEYS) ;
+
+	RSRandom::random_bytes(data.data(),data.size()) ;
+
+	for(uint32_t i=0;i<KEYS;++i)
+	{
+		RsTlvPrivateRSAKey priv_key ;
+		EXPECT_TRUE(GxsSecurity::generateKeyPair(pub_keys[i],priv_key)) ;
+		EXPECT_TRUE(GxsSecurity::getSignature((const char*)&data[i*DATA_LEN],DATA_LEN,priv_key,signs[i])) ;
+	}
+
+	uint32_t uncached_ok = 0 ;
+	double start = wallTime() ;
+	for(uint32_t n=0;n<CHECKS;++n)
+		if(validateSignatureUncached((const char*)&data[(n%KEYS)*DATA_LEN],DATA_LEN,pub_keys[n%KEYS],signs[n%KEYS]))
+			++uncached_ok ;
+	double uncached = wallTime() - start ;
+
+	GxsSecurity::PublicKeyCacheStats before, after ;
+	GxsSecurity::getPublicKeyCacheStats(before) ;
+
+	uint32_t cached_ok = 0 ;
+	start = wallTime() ;
+	for(uint32_t n=0;n<CHECKS;++n)
+		if(GxsSecurity::validateSignature((const char*)&data[(n%KEYS)*DATA_LEN],DATA_LEN,pub_keys[n%KEYS],signs[n%KEYS]))
+			++cached_ok ;
+	double cached = wallTime() - start ;
+
+	GxsSecurity::getPublicKeyCacheStats(after) ;
+
+	EXPECT_EQ(uncached_ok, CHECKS) ;
+	EXPECT_EQ(cached_ok, CHECKS) ;
+
+	std::cout << "{ \"benchmark\": \"gxs_signature_check\", \"keys\": " << KEYS
+	          << ", \"checks\": " << CHECKS << ", \"data_bytes\": " << DATA_LEN
+	          << ", \"uncached_s\": " << uncached << ", \"uncached_per_s\": " << CHECKS / uncached
+	          << ", \"cached_s\": " << cached << ", \"cached_per_s\": " << CHECKS / cached
+	          << ", \"cache_hits\": " << after.hits - before.hits << ", \"cache_misses\": " << after.misses - before.misses
+	          << " }" << std::endl;
+}
@@ -0,0 +1,291 @@
+/*******************************************************************************
+ * unittests/libretroshare/gxstunnel/p3gxstunnel_test.cc                       *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
+
+#include <vector>
+
+// from libretroshare
+
+#include "crypto/rsaes.h"
+#include "gxstunnel/p3gxstunnel.h"
+#include "util/rsrandom.h"
+
+typedef std::vector<uint8_t> Packet;
+
+// Legacy packets: [8 bytes IV] [HMAC-SHA1 of the encrypted data] [AES-128-CBC encrypted data]
+
+static const uint32_t LEGACY_IV_SIZE = 8;
+static const uint32_t LEGACY_HMAC_SIZE = SHA_DIGEST_LENGTH;
+
+/*!
+ * Opens tunnels between services as the DH exchange does, and moves their
+ * packets around without a turtle router.
+ */
+class GxsTunnelTest
+{
+public:
+	static void openTunnel(p3GxsTunnelService& s, const RsGxsTunnelId& tunnel_id, const RsPeerId& vpid, const Packet& secret)
+	{
+		RsStackMutex stack(s.mGxsTunnelMtx);
+
+		s._gxs_tunnel_virtual_peer_ids[vpid].tunnel_id = tunnel_id;
+
+		p3GxsTunnelService::GxsTunnelPeerInfo& pinfo(s._gxs_tunnel_contacts[tunnel_id]);
+		s.locked_initSessionKeys(pinfo, secret.data(), secret.size());
+		pinfo.status = RsGxsTunnelService::RS_GXS_TUNNEL_STATUS_CAN_TALK;
+		pinfo.virtual_peer_id = vpid;
+
+		s.locked_sendAeadCapabilities(tunnel_id);
+	}
+
+	// Encrypts the items waiting to be sent, as the service does when it ticks.
+
+	static std::vector<Packet> pendingPackets(p3GxsTunnelService& s)
+	{
+		RsStackMutex stack(s.mGxsTunnelMtx);
+
+		std::vector<Packet> packets;
+
+		for(RsGxsTunnelItem *item: s.pendingGxsTunnelItems)
+		{
+			packets.push_back(locked_encrypt(s, item));
+			delete item;
+		}
+		s.pendingGxsTunnelItems.clear();
+
+		return packets;
+	}
+
+	static Packet keepAlive(p3GxsTunnelService& s, const RsGxsTunnelId& tunnel_id)
+	{
+		RsGxsTunnelStatusItem item;
+		item.status = RS_GXS_TUNNEL_FLAG_KEEP_ALIVE;
+		item.PeerId(RsPeerId(tunnel_id));
+
+		RsStackMutex stack(s.mGxsTunnelMtx);
+		return locked_encrypt(s, &item);
+	}
+
+	static bool receive(p3GxsTunnelService& s, const RsPeerId& vpid, const Packet& packet)
+	{
+#ifndef V07_NON_BACKWARD_COMPATIBLE_CHANGE_004
+		return s.handleEncryptedData(packet.data(), packet.size(), RsFileHash(), vpid, true);
+#else
+		return s.handleEncryptedData(packet.data(), packet.size(), RsFileHash(), vpid);
+#endif
+	}
+
+	static bool peerAcceptsAead(p3GxsTunnelService& s, const RsGxsTunnelId& tunnel_id)
+	{
+		RsStackMutex stack(s.mGxsTunnelMtx);
+		return s._gxs_tunnel_contacts[tunnel_id].peer_accepts_aead;
+	}
+
+	static uint32_t totalReceived(p3GxsTunnelService& s, const RsGxsTunnelId& tunnel_id)
+	{
+		RsStackMutex stack(s.mGxsTunnelMtx);
+		return s._gxs_tunnel_contacts[tunnel_id].total_received;
+	}
+
+	static Packet legacyKey(p3GxsTunnelService& s, const RsGxsTunnelId& tunnel_id)
+	{
+		RsStackMutex stack(s.mGxsTunnelMtx);
+		const unsigned char *key = s._gxs_tunnel_contacts[tunnel_id].aes_key;
+		return Packet(key, key + GXS_TUNNEL_AES_KEY_SIZE);
+	}
+
+private:
+	static Packet locked_encrypt(p3GxsTunnelService& s, RsGxsTunnelItem *item)
+	{
+		void *data = NULL;
+		uint32_t size = 0;
+		uint64_t IV = 0;
+
+		if(!s.locked_encryptTunnelData(s._gxs_tunnel_contacts[RsGxsTunnelId(item->PeerId())], item, data, size, IV))
+			return Packet();
+
+		Packet packet((uint8_t*)data, (uint8_t*)data + size);
+		free(data);
+		return packet;
+	}
+};
+
+static bool isAeadPacket(const Packet& packet)
+{
+	return packet.size() > 4 && packet[0] == 0xae && packet[1] == 0xad && packet[3] == 0x01;
+}
+
+// What a peer that only knows the legacy format sends and receives.
+
+static Packet legacyEncrypt(Packet key, uint32_t status, uint64_t IV)
+{
+	RsGxsTunnelStatusItem item;
+	item.status = status;
+
+	RsGxsTunnelSerialiser ser;
+	uint32_t size = ser.size(&item);
+	Packet clear(size);
+	EXPECT_TRUE(ser.serialise(&item, clear.data(), &size));
+
+	uint32_t encrypted_size = RsAES::get_buffer_size(size);
+	Packet encrypted(encrypted_size);
+	EXPECT_TRUE(RsAES::aes_crypt_8_16(clear.data(), size, key.data(), (uint8_t*)&IV, encrypted.data(), encrypted_size));
+
+	Packet packet(LEGACY_IV_SIZE + LEGACY_HMAC_SIZE + encrypted_size);
+	memcpy(packet.data(), &IV, LEGACY_IV_SIZE);
+
+	unsigned int md_len = LEGACY_HMAC_SIZE;
+	HMAC(EVP_sha1(), key.data(), key.size(), encrypted.data(), encrypted_size, &packet[LEGACY_IV_SIZE], &md_len);
+	memcpy(&packet[LEGACY_IV_SIZE + LEGACY_HMAC_SIZE], encrypted.data(), encrypted_size);
+
+	return packet;
+}
+
+static bool legacyDecrypt(Packet key, const Packet& packet, uint32_t& status)
+{
+	if(packet.size() < LEGACY_IV_SIZE + LEGACY_HMAC_SIZE)
+		return false;
+
+	const uint8_t *encrypted = &packet[LEGACY_IV_SIZE + LEGACY_HMAC_SIZE];
+	uint32_t encrypted_size = packet.size() - LEGACY_IV_SIZE - LEGACY_HMAC_SIZE;
+
+	unsigned char *hm = HMAC(EVP_sha1(), key.data(), key.size(), encrypted, encrypted_size, NULL, NULL);
+	if(memcmp(hm, &packet[LEGACY_IV_SIZE], LEGACY_HMAC_SIZE))
+		return false;
+
+	uint32_t size = RsAES::get_buffer_size(encrypted_size);
+	Packet clear(size);
+	if(!RsAES::aes_decrypt_8_16(encrypted, encrypted_size, key.data(), (uint8_t*)packet.data(), clear.data(), size))
+		return false;
+
+	RsGxsTunnelStatusItem *item = dynamic_cast<RsGxsTunnelStatusItem*>(RsGxsTunnelSerialiser().deserialise(clear.data(), &size));
+	if(item == NULL)
+		return false;
+
+	status = item->status;
+	delete item;
+	return true;
+}
+
+static Packet randomSecret()
+{
+	Packet secret(256);
+	RSRandom::random_bytes(secret.data(), secret.size());
+	return secret;
+}
+
+TEST(libretroshare_gxstunnel, AeadNegotiation)
+{
+	p3GxsTunnelService a(NULL), b(NULL);
+	RsGxsTunnelId tunnel_id = RsGxsTunnelId::random();
+	RsPeerId vpid = RsPeerId::random();
+	Packet secret = randomSecret();
+
+	GxsTunnelTest::openTunnel(a, tunnel_id, vpid, secret);
+	GxsTunnelTest::openTunnel(b, tunnel_id, vpid, secret);
+
+	// Until the capability of the other side is known, packets are in the legacy format
+
+	std::vector<Packet> fromA = GxsTunnelTest::pendingPackets(a);
+	ASSERT_EQ(1u, fromA.size());
+	EXPECT_FALSE(isAeadPacket(fromA[0]));
+	EXPECT_FALSE(isAeadPacket(GxsTunnelTest::keepAlive(b, tunnel_id)));
+
+	EXPECT_TRUE(GxsTunnelTest::receive(b, vpid, fromA[0]));
+	EXPECT_TRUE(GxsTunnelTest::peerAcceptsAead(b, tunnel_id));
+
+	// B knows that A accepts AEAD packets, even its own announcement is in that format
+
+	std::vector<Packet> fromB = GxsTunnelTest::pendingPackets(b);
+	ASSERT_EQ(1u, fromB.size());
+	EXPECT_TRUE(isAeadPacket(fromB[0]));
+
+	Packet keepAlive = GxsTunnelTest::keepAlive(b, tunnel_id);
+	EXPECT_TRUE(isAeadPacket(keepAlive));
+
+	// The legacy key cannot read them
+
+	uint32_t status = 0;
+	EXPECT_FALSE(legacyDecrypt(GxsTunnelTest::legacyKey(a, tunnel_id), keepAlive, status));
+
+	uint32_t received = GxsTunnelTest::totalReceived(a, tunnel_id);
+	EXPECT_TRUE(GxsTunnelTest::receive(a, vpid, fromB[0]));
+	EXPECT_TRUE(GxsTunnelTest::receive(a, vpid, keepAlive));
+	EXPECT_GT(GxsTunnelTest::totalReceived(a, tunnel_id), received);
+	EXPECT_TRUE(GxsTunnelTest::peerAcceptsAead(a, tunnel_id));
+
+	Packet back = GxsTunnelTest::keepAlive(a, tunnel_id);
+	EXPECT_TRUE(isAeadPacket(back));
+
+	received = GxsTunnelTest::totalReceived(b, tunnel_id);
+	EXPECT_TRUE(GxsTunnelTest::receive(b, vpid, back));
+	EXPECT_GT(GxsTunnelTest::totalReceived(b, tunnel_id), received);
+}
+
+TEST(libretroshare_gxstunnel, LegacyPeerFallback)
+{
+	p3GxsTunnelService a(NULL);
+	RsGxsTunnelId tunnel_id = RsGxsTunnelId::random();
+	RsPeerId vpid = RsPeerId::random();
+
+	GxsTunnelTest::openTunnel(a, tunnel_id, vpid, randomSecret());
+	Packet key = GxsTunnelTest::legacyKey(a, tunnel_id);
+
+	// The old peer reads the announcement as an unknown status, and never answers it
+
+	std::vector<Packet> fromA = GxsTunnelTest::pendingPackets(a);
+	ASSERT_EQ(1u, fromA.size());
+
+	uint32_t status = 0;
+	EXPECT_TRUE(legacyDecrypt(key, fromA[0], status));
+	EXPECT_EQ(RS_GXS_TUNNEL_FLAG_AEAD_CAPABILITIES, status);
+
+	// Its packets are accepted, and A keeps talking the legacy format
+
+	EXPECT_TRUE(GxsTunnelTest::receive(a, vpid, legacyEncrypt(key, RS_GXS_TUNNEL_FLAG_KEEP_ALIVE, RSRandom::random_u64() | 1)));
+	EXPECT_FALSE(GxsTunnelTest::peerAcceptsAead(a, tunnel_id));
+
+	for(int i = 0; i < 20; ++i)
+	{
+		Packet keepAlive = GxsTunnelTest::keepAlive(a, tunnel_id);
+
+		EXPECT_FALSE(isAeadPacket(keepAlive));
+		EXPECT_TRUE(legacyDecrypt(key, keepAlive, status));
+		EXPECT_EQ(RS_GXS_TUNNEL_FLAG_KEEP_ALIVE, status);
+	}
+
+	// A legacy IV that happens to look like an AEAD header falls back to the legacy check
+
+	uint8_t iv[LEGACY_IV_SIZE] = { 0xae, 0xad, 0x01, 0x01, 0x12, 0x34, 0x56, 0x78 };
+	uint64_t IV;
+	memcpy(&IV, iv, sizeof(IV));
+
+	Packet packet = legacyEncrypt(key, RS_GXS_TUNNEL_FLAG_KEEP_ALIVE, IV);
+	ASSERT_TRUE(isAeadPacket(packet));
+
+	uint32_t received = GxsTunnelTest::totalReceived(a, tunnel_id);
+	EXPECT_TRUE(GxsTunnelTest::receive(a, vpid, packet));
+	EXPECT_GT(GxsTunnelTest::totalReceived(a, tunnel_id), received);
+	EXPECT_FALSE(GxsTunnelTest::peerAcceptsAead(a, tunnel_id));
+}
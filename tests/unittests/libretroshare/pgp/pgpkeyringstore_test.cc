@@ -0,0 +1,261 @@
+/*******************************************************************************
+ * unittests/libretroshare/pgp/pgpkeyringstore_test.cc                         *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <set>
+
+// from libretroshare
+
+#include "crypto/hashstream.h"
+#include "pgp/pgpkeyringstore.h"
+#include "util/rsdir.h"
+
+#define STORE_DIR    std::string("pgpkeyringstore_test.d")
+#define KEYRING_FILE std::string("pgpkeyringstore_test.gpg")
+#define TAIL_FILE    std::string("pgpkeyringstore_test.tail")
+
+static std::vector<unsigned char> keyData(int n, size_t size)
+{
+	std::vector<unsigned char> data(size);
+	for(size_t i = 0; i < size; ++i)
+		data[i] = (unsigned char) (n * 31 + i);
+	return data;
+}
+
+// Transferable public key made of a v4 public key packet, a user id and a
+// signature, in old packet format. Only the packet structure is valid.
+
+static std::vector<unsigned char> pgpKey(int n, RsPgpFingerprint& fpr)
+{
+	std::vector<unsigned char> body = keyData(n, 40 + n % 5);
+	body[0] = 4;
+
+	std::vector<unsigned char> key;
+	key.push_back(0x99);	// public key, 2 bytes length
+	key.push_back(body.size() >> 8);
+	key.push_back(body.size() & 0xff);
+	key.insert(key.end(), body.begin(), body.end());
+
+	key.push_back(0xb4);	// user id, 1 byte length
+	key.push_back(5);
+	key.insert(key.end(), 5, 'a' + n % 26);
+
+	key.push_back(0x88);	// signature, 1 byte length
+	key.push_back(20);
+	key.insert(key.end(), 20, n);
+
+	librs::crypto::HashStream H(librs::crypto::HashStream::SHA1);
+	H << (uint8_t)0x99 << (uint8_t)(body.size() >> 8) << (uint8_t)(body.size() & 0xff);
+	H << std::make_pair(body.data(), (uint32_t)body.size());
+	fpr = RsPgpFingerprint::fromBufferUnsafe(H.hash().toByteArray());
+
+	return key;
+}
+
+static std::vector<unsigned char> readFile(const std::string& path)
+{
+	std::ifstream f(path.c_str(), std::ios::binary);
+	return std::vector<unsigned char>((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+static void appendFile(const std::string& path, const std::vector<unsigned char>& data, size_t size)
+{
+	std::ofstream f(path.c_str(), std::ios::binary | std::ios::app);
+	f.write((const char *) data.data(), size);
+}
+
+static void cleanStore()
+{
+	RsDirUtil::cleanupDirectory(STORE_DIR, std::set<std::string>());
+	RsDirUtil::removeFile(KEYRING_FILE);
+	RsDirUtil::removeFile(TAIL_FILE);
+}
+
+TEST(libretroshare_pgp, KeyringStorePutGetRemove)
+{
+	cleanStore();
+
+	RsPgpFingerprint fpr1 = RsPgpFingerprint::random();
+	RsPgpFingerprint fpr2 = RsPgpFingerprint::random();
+	std::vector<unsigned char> data;
+
+	{
+		PGPKeyringStore store(STORE_DIR);
+		ASSERT_TRUE(store.open());
+		EXPECT_EQ(0u, store.size());
+
+		EXPECT_TRUE(store.putKey(fpr1, keyData(1, 100).data(), 100));
+		EXPECT_TRUE(store.putKey(fpr2, keyData(2, 200).data(), 200));
+		EXPECT_TRUE(store.putKey(fpr1, keyData(3, 150).data(), 150));	// replaced
+		EXPECT_EQ(2u, store.size());
+		EXPECT_TRUE(store.exportPending());
+
+		EXPECT_TRUE(store.getKey(fpr1, data));
+		EXPECT_EQ(keyData(3, 150), data);
+
+		EXPECT_TRUE(store.removeKey(fpr2));
+		EXPECT_FALSE(store.removeKey(fpr2));
+		EXPECT_FALSE(store.hasKey(fpr2));
+		EXPECT_FALSE(store.getKey(fpr2, data));
+	}
+
+	// the index journal is replayed
+	PGPKeyringStore store(STORE_DIR);
+	ASSERT_TRUE(store.open());
+	EXPECT_EQ(1u, store.size());
+	EXPECT_TRUE(store.exportPending());
+	EXPECT_TRUE(store.getKey(fpr1, data));
+	EXPECT_EQ(keyData(3, 150), data);
+
+	cleanStore();
+}
+
+TEST(libretroshare_pgp, KeyringStoreExport)
+{
+	cleanStore();
+
+	std::vector<unsigned char> expected;
+	{
+		PGPKeyringStore store(STORE_DIR);
+		ASSERT_TRUE(store.open());
+
+		// more operations than the compaction threshold
+		for(int i = 0; i < 300; ++i)
+		{
+			RsPgpFingerprint fpr = RsPgpFingerprint::random();
+			ASSERT_TRUE(store.putKey(fpr, keyData(i, 10 + i % 7).data(), 10 + i % 7));
+			if(i % 3 != 0)
+				ASSERT_TRUE(store.removeKey(fpr));
+		}
+		EXPECT_EQ(100u, store.size());
+
+		ASSERT_TRUE(store.exportKeyring(KEYRING_FILE));
+		EXPECT_FALSE(store.exportPending());
+		EXPECT_FALSE(store.keyringChangedSinceExport(KEYRING_FILE));
+
+		// the keyring file is the concatenation of the records
+		std::list<RsPgpFingerprint> fprs;
+		store.getFingerprints(fprs);
+		for(std::list<RsPgpFingerprint>::const_iterator it(fprs.begin()); it != fprs.end(); ++it)
+		{
+			std::vector<unsigned char> data;
+			ASSERT_TRUE(store.getKey(*it, data));
+			expected.insert(expected.end(), data.begin(), data.end());
+		}
+	}
+
+	std::ifstream f(KEYRING_FILE.c_str(), std::ios::binary);
+	std::vector<unsigned char> keyring((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	EXPECT_EQ(expected, keyring);
+
+	PGPKeyringStore store(STORE_DIR);
+	ASSERT_TRUE(store.open());
+	EXPECT_EQ(100u, store.size());
+	EXPECT_FALSE(store.exportPending());
+	EXPECT_FALSE(store.keyringChangedSinceExport(KEYRING_FILE));
+
+	// someone else wrote the keyring file
+	std::ofstream(KEYRING_FILE.c_str(), std::ios::app) << "x";
+	EXPECT_TRUE(store.keyringChangedSinceExport(KEYRING_FILE));
+
+	cleanStore();
+}
+
+TEST(libretroshare_pgp, KeyringStoreAppend)
+{
+	cleanStore();
+
+	RsPgpFingerprint fpr1, fpr2, fpr3, fpr4, fpr5;
+	std::vector<unsigned char> key1 = pgpKey(1, fpr1);
+	std::vector<unsigned char> key2 = pgpKey(2, fpr2);
+	std::vector<unsigned char> key3 = pgpKey(3, fpr3);
+	std::vector<unsigned char> key4 = pgpKey(4, fpr4);
+	std::vector<unsigned char> key5 = pgpKey(5, fpr5);
+	std::vector<unsigned char> expected;
+
+	{
+		PGPKeyringStore store(STORE_DIR);
+		ASSERT_TRUE(store.open());
+
+		ASSERT_TRUE(store.putKey(fpr1, key1.data(), key1.size()));
+		ASSERT_TRUE(store.updateKeyring(KEYRING_FILE));
+		expected = key1;
+		EXPECT_EQ(expected, readFile(KEYRING_FILE));
+
+		// new keys are appended
+		ASSERT_TRUE(store.putKey(fpr2, key2.data(), key2.size()));
+		ASSERT_TRUE(store.updateKeyring(KEYRING_FILE));
+		expected.insert(expected.end(), key2.begin(), key2.end());
+		EXPECT_EQ(expected, readFile(KEYRING_FILE));
+		EXPECT_FALSE(store.exportPending());
+		EXPECT_FALSE(store.keyringAppended(KEYRING_FILE));
+
+		// someone else appended a key
+		appendFile(KEYRING_FILE, key3, key3.size());
+		expected.insert(expected.end(), key3.begin(), key3.end());
+		EXPECT_TRUE(store.keyringAppended(KEYRING_FILE));
+
+		std::list<RsPgpFingerprint> fprs;
+		ASSERT_TRUE(store.readAppendedKeys(KEYRING_FILE, TAIL_FILE, fprs));
+		ASSERT_EQ(1u, fprs.size());
+		EXPECT_EQ(fpr3, fprs.front());
+		EXPECT_EQ(key3, readFile(TAIL_FILE));
+		EXPECT_TRUE(store.hasKey(fpr3));
+		EXPECT_FALSE(store.keyringAppended(KEYRING_FILE));
+		EXPECT_FALSE(store.keyringChangedSinceExport(KEYRING_FILE));
+
+		// it is not written again, nor are unchanged keys
+		EXPECT_FALSE(store.exportPending());
+		ASSERT_TRUE(store.putKey(fpr1, key1.data(), key1.size()));
+		EXPECT_FALSE(store.exportPending());
+		ASSERT_TRUE(store.updateKeyring(KEYRING_FILE));
+		EXPECT_EQ(expected, readFile(KEYRING_FILE));
+
+		// a key of the file is replaced
+		key2.back() ^= 0xff;
+		ASSERT_TRUE(store.putKey(fpr2, key2.data(), key2.size()));
+		EXPECT_TRUE(store.rewritePending());
+	}
+
+	PGPKeyringStore store(STORE_DIR);
+	ASSERT_TRUE(store.open());
+	EXPECT_EQ(3u, store.size());
+	EXPECT_TRUE(store.exportPending());
+	EXPECT_TRUE(store.rewritePending());
+
+	ASSERT_TRUE(store.updateKeyring(KEYRING_FILE));
+	EXPECT_FALSE(store.rewritePending());
+	EXPECT_EQ(expected.size(), readFile(KEYRING_FILE).size());
+
+	// an interrupted append is not taken for keys
+	appendFile(KEYRING_FILE, key4, key4.size());
+	appendFile(KEYRING_FILE, key5, key5.size() - 10);
+
+	std::list<RsPgpFingerprint> fprs;
+	EXPECT_TRUE(store.keyringAppended(KEYRING_FILE));
+	EXPECT_FALSE(store.readAppendedKeys(KEYRING_FILE, std::string(), fprs));
+	EXPECT_FALSE(store.hasKey(fpr4));
+	EXPECT_FALSE(store.hasKey(fpr5));
+
+	cleanStore();
+}
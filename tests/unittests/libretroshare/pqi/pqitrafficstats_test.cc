@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * unittests/libretroshare/pqi/pqitrafficstats_test.cc                         *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+// from libretroshare
+
+#include "pqi/pqitrafficstats.h"
+
+static const RsTrafficCounter *findCounter(const std::vector<RsTrafficCounter>& counters, uint16_t service_id, uint8_t service_sub_id, uint8_t priority)
+{
+	for(const RsTrafficCounter& c : counters)
+		if(c.service_id == service_id && c.service_sub_id == service_sub_id && c.priority == priority)
+			return &c;
+
+	return nullptr;
+}
+
+TEST(libretroshare_pqi, pqiTrafficCounters_histogram)
+{
+	EXPECT_EQ(0u, pqiTrafficCounters::histogramBucket(0));
+	EXPECT_EQ(0u, pqiTrafficCounters::histogramBucket(63));
+	EXPECT_EQ(1u, pqiTrafficCounters::histogramBucket(64));
+	EXPECT_EQ(1u, pqiTrafficCounters::histogramBucket(127));
+	EXPECT_EQ(2u, pqiTrafficCounters::histogramBucket(128));
+	EXPECT_EQ(pqiTrafficCounters::HISTOGRAM_BUCKETS - 1, pqiTrafficCounters::histogramBucket(0xffffffff));
+
+	for(uint32_t i = 0; i + 1 < pqiTrafficCounters::HISTOGRAM_BUCKETS; ++i)
+	{
+		EXPECT_EQ(i, pqiTrafficCounters::histogramBucket(pqiTrafficCounters::histogramBound(i) - 1));
+		EXPECT_EQ(i + 1, pqiTrafficCounters::histogramBucket(pqiTrafficCounters::histogramBound(i)));
+	}
+
+	pqiTrafficCounters counters(true);
+	counters.add(0x0011, 0x01, 3, 10);
+	counters.add(0x0011, 0x01, 3, 100);
+	counters.add(0x0011, 0x01, 3, 100);
+	counters.add(0x0000, 0x00, 0, 1000);
+
+	std::vector<RsTrafficCounter> snapshot;
+	counters.snapshot(snapshot);
+
+	ASSERT_EQ(2u, snapshot.size());
+	EXPECT_EQ(0, snapshot[0].service_id);	// sorted
+
+	const RsTrafficCounter *c = findCounter(snapshot, 0x0011, 0x01, 3);
+	ASSERT_TRUE(c != nullptr);
+	EXPECT_EQ(3u, c->count);
+	EXPECT_EQ(210u, c->bytes);
+	ASSERT_EQ(pqiTrafficCounters::HISTOGRAM_BUCKETS, c->size_histogram.size());
+	EXPECT_EQ(1u, c->size_histogram[0]);
+	EXPECT_EQ(2u, c->size_histogram[1]);
+}
+
+TEST(libretroshare_pqi, pqiTrafficCounters_concurrent_adds)
+{
+	const uint32_t nthreads = 4;
+	const uint32_t nitems = 20000;
+	const uint32_t ntypes = 100;	// more than the table holds
+
+	std::vector<RsTrafficCounter> before;
+	pqiTrafficCounters::getTotals(false, before);
+
+	{
+		pqiTrafficCounters counters(false);
+		std::vector<std::thread> threads;
+
+		for(uint32_t t = 0; t < nthreads; ++t)
+			threads.push_back(std::thread([&counters, nitems, ntypes]()
+			{
+				for(uint32_t i = 0; i < nitems; ++i)
+					counters.add(0x1000 + i % ntypes, 0x02, 5, 50);
+			}));
+
+		for(std::thread& t : threads)
+			t.join();
+
+		std::vector<RsTrafficCounter> snapshot;
+		counters.snapshot(snapshot);
+
+		uint64_t count = 0, bytes = 0;
+		for(const RsTrafficCounter& c : snapshot)
+		{
+			count += c.count;
+			bytes += c.bytes;
+		}
+		EXPECT_EQ(nthreads * nitems, count);
+		EXPECT_EQ(50ull * nthreads * nitems, bytes);
+
+		// Types that fit in the table are not mixed up
+
+		const RsTrafficCounter *c = findCounter(snapshot, 0x1000, 0x02, 5);
+		ASSERT_TRUE(c != nullptr);
+		EXPECT_EQ(nthreads * nitems / ntypes, c->count);
+	}
+
+	// Totals keep what deleted counters have counted
+
+	std::vector<RsTrafficCounter> after;
+	pqiTrafficCounters::getTotals(false, after);
+
+	uint64_t count = 0;
+	for(const RsTrafficCounter& c : after)
+		count += c.count;
+	for(const RsTrafficCounter& c : before)
+		count -= c.count;
+
+	EXPECT_EQ(nthreads * nitems, count);
+}
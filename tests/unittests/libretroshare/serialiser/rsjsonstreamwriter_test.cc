@@ -0,0 +1,315 @@
+/*******************************************************************************
+ * unittests/libretroshare/serialiser/rsjsonstreamwriter_test.cc               *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+// from libretroshare
+
+#include "serialiser/rsjsonstreamwriter.h"
+#include "retroshare/rsgxsforums.h"
+#include "retroshare/rstypes.h"
+
+static std::vector<RsGxsForumMsg> makeForumMsgs(size_t count, size_t msgSize)
+{
+	std::vector<RsGxsForumMsg> msgs(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		RsGxsForumMsg& msg(msgs[i]);
+		msg.mMeta.mGroupId = RsGxsGroupId::random();
+		msg.mMeta.mMsgId = RsGxsMessageId::random();
+		msg.mMeta.mAuthorId = RsGxsId::random();
+		msg.mMeta.mMsgName = "message " + std::to_string(i);
+		msg.mMeta.mPublishTs = 1600000000 + i;
+		msg.mMsg = std::string(msgSize, 'a' + i % 26);
+	}
+	return msgs;
+}
+
+static DirDetails makeDirDetails(size_t children)
+{
+	DirDetails details;
+	details.name = "shared";
+	details.path = "/home/user/shared";
+	for(size_t i = 0; i < children; ++i)
+	{
+		DirStub stub;
+		stub.type = DIR_TYPE_FILE;
+		stub.name = "file_" + std::to_string(i) + ".bin";
+		stub.ref = reinterpret_cast<void*>(i + 1);
+		details.children.push_back(stub);
+	}
+	return details;
+}
+
+/// Print the members like the JSON API did, through the DOM
+template<typename T, typename U>
+static std::string domJson(T& first, U& retval, size_t* domSize = nullptr)
+{
+	RsGenericSerializer::SerializeContext ctx;
+	RsGenericSerializer::SerializeJob j(RsGenericSerializer::TO_JSON);
+	RsTypeSerializer::serial_process(j, ctx, first, "first");
+	RS_SERIAL_PROCESS(retval);
+
+	std::stringstream ss;
+	ss << ctx.mJson;
+	if(domSize) *domSize = ctx.mJson.GetAllocator().Size();
+	return ss.str();
+}
+
+template<typename T, typename U>
+static std::string streamedJson(T& first, U& retval, size_t chunkSize)
+{
+	std::string out;
+	RsJsonStreamWriter w( [&](const char* data, size_t size)
+	{
+		out.append(data, size);
+		return true;
+	}, chunkSize );
+	w.member("first", first);
+	RS_JSON_STREAM_MEMBER(w, retval);
+	EXPECT_TRUE(w.finish());
+	EXPECT_EQ(out.size(), w.bytesWritten());
+	return out;
+}
+
+TEST(libretroshare_serialiser, RsJsonStreamWriterSameAsDom)
+{
+	std::vector<RsGxsForumMsg> msgs = makeForumMsgs(50, 100);
+	bool retval = true;
+	EXPECT_EQ(domJson(msgs, retval), streamedJson(msgs, retval, 256));
+
+	DirDetails details = makeDirDetails(50);
+	EXPECT_EQ(domJson(details, retval), streamedJson(details, retval, 256));
+
+	std::map<std::string, uint32_t> counters;
+	for(uint32_t i = 0; i < 20; ++i) counters["c" + std::to_string(i)] = i;
+	EXPECT_EQ(domJson(counters, retval), streamedJson(counters, retval, 16));
+
+	std::list<RsGxsForumMsg> empty;
+	EXPECT_EQ(domJson(empty, retval), streamedJson(empty, retval, 16));
+}
+
+TEST(libretroshare_serialiser, RsJsonStreamWriterChunks)
+{
+	std::vector<RsGxsForumMsg> msgs = makeForumMsgs(100, 500);
+
+	size_t chunks = 0;
+	size_t biggest = 0;
+	RsJsonStreamWriter w( [&](const char*, size_t size)
+	{
+		++chunks;
+		if(size > biggest) biggest = size;
+		return true;
+	}, 4096 );
+	RS_JSON_STREAM_MEMBER(w, msgs);
+	EXPECT_TRUE(w.finish());
+
+	EXPECT_GT(chunks, w.bytesWritten() / 4096);
+	EXPECT_EQ(biggest, 4096u);
+}
+
+TEST(libretroshare_serialiser, RsJsonStreamWriterSinkFailure)
+{
+	std::vector<RsGxsForumMsg> msgs = makeForumMsgs(100, 500);
+
+	size_t calls = 0;
+	RsJsonStreamWriter w( [&](const char*, size_t)
+	{
+		++calls;
+		return false;
+	}, 4096 );
+	RS_JSON_STREAM_MEMBER(w, msgs);
+	EXPECT_FALSE(w.finish());
+
+	// serialization stops at the first failure
+	EXPECT_EQ(calls, 1u);
+	EXPECT_EQ(w.bytesWritten(), 0u);
+}
+
+/* JSON API answer benchmark: serializes answers like the ones of
+ * rsGxsForums/getForumContent and rsFiles/requestDirDetails through the DOM,
+ * as the JSON API did, and with RsJsonStreamWriter. Memory is the one used for
+ * JSON: DOM allocator plus two copies of the text (stream and answer string)
+ * for the former, biggest element DOM plus chunk plus chunks waiting to be read
+ * for the latter. DirDetails is a single struct so its DOM is still built whole.
+ * Latency is the time to the first byte handed to the HTTP session and the
+ * total time.
+ * The answer is read by a caller slower than the serialization. Chunks waiting
+ * to be read are measured when they are queued as soon as written, and when
+ * each one waits for the previous to be read, as the JSON API does.
+ *
+ * Disabled by default. Run it with:
+ *   unittests --gtest_also_run_disabled_tests --gtest_filter='*RsJsonStreamWriterBenchmark*'
+ */
+
+/** Bytes per second read by the caller */
+static const double BENCHMARK_READ_RATE = 20e6;
+
+/** Caller reading the answer at a fixed rate, chunks wait in a queue meanwhile
+ * like in the write queue of a HTTP session */
+class SlowReader
+{
+public:
+	explicit SlowReader(double bytesPerSecond) :
+	    mRate(bytesPerSecond), mQueued(0), mPeakQueued(0), mDone(false),
+	    mThread(&SlowReader::readLoop, this) {}
+
+	~SlowReader()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mMtx);
+			mDone = true;
+			mCond.notify_all();
+		}
+		mThread.join();
+	}
+
+	/// Queue a chunk, after the previous ones are read if wait is true
+	void write(size_t size, bool wait)
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+		if(wait) mCond.wait(lock, [this]() { return mQueue.empty(); });
+
+		mQueue.push_back(size);
+		mQueued += size;
+		if(mQueued > mPeakQueued) mPeakQueued = mQueued;
+		mCond.notify_all();
+	}
+
+	/// Wait for all chunks to be read
+	void flush()
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+		mCond.wait(lock, [this]() { return mQueue.empty(); });
+	}
+
+	size_t peakQueued() const { return mPeakQueued; }
+
+private:
+	void readLoop()
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+		while(true)
+		{
+			mCond.wait(lock, [this]() { return mDone || !mQueue.empty(); });
+			if(mQueue.empty()) return;
+
+			size_t size = mQueue.front();
+			lock.unlock();
+			std::this_thread::sleep_for(std::chrono::duration<double>(size / mRate));
+			lock.lock();
+
+			mQueue.pop_front();
+			mQueued -= size;
+			mCond.notify_all();
+		}
+	}
+
+	const double mRate;
+	std::mutex mMtx;
+	std::condition_variable mCond;
+	std::deque<size_t> mQueue;
+	size_t mQueued;
+	size_t mPeakQueued;
+	bool mDone;
+	std::thread mThread;	/// last, started once the rest is initialized
+};
+
+static double wallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Stream the answer to a SlowReader, @return peak memory
+template<typename T>
+static size_t streamAnswer(T& answer, bool wait, size_t& bytes, double& firstByte, double& total)
+{
+	bool retval = true;
+	size_t chunkSize = RsJsonStreamWriter::DEFAULT_CHUNK_SIZE;
+	SlowReader reader(BENCHMARK_READ_RATE);
+
+	firstByte = 0;
+	double start = wallTime();
+	RsJsonStreamWriter w( [&](const char*, size_t size)
+	{
+		if(firstByte == 0) firstByte = wallTime() - start;
+		reader.write(size, wait);
+		return true;
+	}, chunkSize );
+	w.member("first", answer);
+	RS_JSON_STREAM_MEMBER(w, retval);
+	EXPECT_TRUE(w.finish());
+	reader.flush();
+	total = wallTime() - start;
+
+	bytes = w.bytesWritten();
+	return w.peakDomSize() + chunkSize + reader.peakQueued();
+}
+
+template<typename T>
+static void benchmarkAnswer(const std::string& call, T& answer)
+{
+	bool retval = true;
+
+	double start = wallTime();
+	size_t domSize = 0;
+	std::string dom = domJson(answer, retval, &domSize);
+	double domTime = wallTime() - start;
+
+	std::cout << "  \"" << call << "\": { \"bytes\": " << dom.size();
+	std::cout << ", \"dom\": { \"peak_memory\": " << domSize + 2 * dom.size()
+	          << ", \"first_byte_s\": " << domTime
+	          << ", \"total_s\": " << domTime + dom.size() / BENCHMARK_READ_RATE << " }";
+
+	for(bool wait : { false, true })
+	{
+		size_t bytes = 0;
+		double firstByte = 0, total = 0;
+		size_t peak = streamAnswer(answer, wait, bytes, firstByte, total);
+
+		EXPECT_EQ(dom.size(), bytes);
+
+		std::cout << ", \"" << (wait ? "stream" : "stream_unbounded_queue")
+		          << "\": { \"peak_memory\": " << peak
+		          << ", \"first_byte_s\": " << firstByte << ", \"total_s\": " << total << " }";
+	}
+	std::cout << " }";
+}
+
+TEST(libretroshare_serialiser, DISABLED_RsJsonStreamWriterBenchmark)
+{
+	std::vector<RsGxsForumMsg> msgs = makeForumMsgs(20000, 2000);
+	DirDetails details = makeDirDetails(200000);
+
+	std::cout << "{" << std::endl;
+	std::cout << "  \"benchmark\": \"jsonapi_answer\"," << std::endl;
+	benchmarkAnswer("rsGxsForums/getForumContent", msgs);
+	std::cout << "," << std::endl;
+	benchmarkAnswer("rsFiles/requestDirDetails", details);
+	std::cout << std::endl << "}" << std::endl;
+}
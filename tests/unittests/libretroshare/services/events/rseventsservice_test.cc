@@ -0,0 +1,163 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/events/rseventsservice_test.cc             *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+// from libretroshare
+
+#include "services/rseventsservice.h"
+
+struct TestEvent : RsEvent
+{
+	TestEvent(uint32_t subject, uint32_t value) :
+	    RsEvent(RsEventType::SYSTEM), mSubject(subject), mValue(value) {}
+
+	void serial_process( RsGenericSerializer::SerializeJob j,
+	                     RsGenericSerializer::SerializeContext& ctx ) override
+	{
+		RsEvent::serial_process(j, ctx);
+		RS_SERIAL_PROCESS(mSubject);
+		RS_SERIAL_PROCESS(mValue);
+	}
+
+	uint32_t mSubject;
+	uint32_t mValue;
+};
+
+template<class P> static bool waitFor(P predicate)
+{
+	for(int i = 0; i < 500 && !predicate(); ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	return predicate();
+}
+
+TEST(libretroshare_services, EventsSlowHandler)
+{
+	RsEventsService events;
+	events.start("events test");
+
+	std::atomic<bool> release(false);
+	std::atomic<uint32_t> slowCount(0), fastCount(0);
+	RsEventsHandlerId_t slowId = 0, fastId = 0;
+	uint32_t sharedJobs = RsScheduler::instance().getStatistics().jobs;
+
+	events.registerEventsHandler([&](std::shared_ptr<const RsEvent>)
+	{
+		while(!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		++slowCount;
+	}, slowId, RsEventType::SYSTEM);
+
+	uint32_t lastValue = 0;
+	bool ordered = true;
+	events.registerEventsHandler([&](std::shared_ptr<const RsEvent> e)
+	{
+		uint32_t value = static_cast<const TestEvent&>(*e).mValue;
+		ordered = ordered && value == lastValue + 1;
+		lastValue = value;
+		++fastCount;
+	}, fastId, RsEventType::SYSTEM);
+
+	for(uint32_t i = 1; i <= 100; ++i)
+		events.postEvent(std::make_shared<TestEvent>(0, i));
+
+	// the blocked handler doesn't delay the other one
+	EXPECT_TRUE(waitFor([&]() { return fastCount == 100; }));
+	EXPECT_TRUE(ordered);
+	EXPECT_EQ(0u, slowCount);
+
+	// handlers don't use the shared scheduler, whose jobs keep running
+	EXPECT_EQ(sharedJobs, RsScheduler::instance().getStatistics().jobs);
+
+	std::atomic<uint32_t> sharedRuns(0);
+	RsScheduler::JobId sharedJob = RsScheduler::instance().addJob(
+	            "events test", [&]() { ++sharedRuns; }, std::chrono::milliseconds(60000) );
+	EXPECT_TRUE(waitFor([&]() { return sharedRuns > 0; }));
+	RsScheduler::instance().removeJob(sharedJob);
+
+	release = true;
+	EXPECT_TRUE(waitFor([&]() { return slowCount == 100; }));
+
+	RsEventsService::HandlerStatistics stats;
+	EXPECT_FALSE(events.getHandlerStatistics(slowId, stats));
+	EXPECT_EQ(100u, stats.delivered);
+	EXPECT_EQ(0u, stats.dropped);
+
+	EXPECT_FALSE(events.unregisterEventsHandler(fastId));
+	EXPECT_TRUE(events.unregisterEventsHandler(fastId));
+
+	events.postEvent(std::make_shared<TestEvent>(0, 101));
+	EXPECT_TRUE(waitFor([&]() { return slowCount == 101; }));
+	EXPECT_EQ(100u, fastCount);
+
+	events.unregisterEventsHandler(slowId);
+	events.fullstop();
+}
+
+TEST(libretroshare_services, EventsCoalescing)
+{
+	RsEventsService events;
+	events.start("events test");
+
+	events.setEventCoalescing(RsEventType::SYSTEM, [](const RsEvent& a, const RsEvent& b)
+	{
+		return static_cast<const TestEvent&>(a).mSubject == static_cast<const TestEvent&>(b).mSubject;
+	});
+
+	std::atomic<bool> release(false);
+	std::atomic<uint32_t> count(0);
+	uint32_t lastValues[2] = { 0, 0 };
+	RsEventsHandlerId_t hId = 0;
+
+	events.registerEventsHandler([&](std::shared_ptr<const RsEvent> e)
+	{
+		while(!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		const TestEvent& te(static_cast<const TestEvent&>(*e));
+		lastValues[te.mSubject] = te.mValue;
+		++count;
+	}, hId, RsEventType::SYSTEM);
+
+	// the first one is taken by the handler, the others wait in the queue
+	events.postEvent(std::make_shared<TestEvent>(0, 0));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	for(uint32_t i = 1; i <= 50; ++i)
+	{
+		events.postEvent(std::make_shared<TestEvent>(0, i));
+		events.postEvent(std::make_shared<TestEvent>(1, i));
+	}
+
+	RsEventsService::HandlerStatistics stats;
+	EXPECT_TRUE(waitFor([&]()
+	{
+		events.getHandlerStatistics(hId, stats);
+		return stats.coalesced == 98;
+	}));
+
+	release = true;
+	EXPECT_TRUE(waitFor([&]() { return count == 3; }));
+	EXPECT_EQ(50u, lastValues[0]);
+	EXPECT_EQ(50u, lastValues[1]);
+
+	events.unregisterEventsHandler(hId);
+	events.fullstop();
+}
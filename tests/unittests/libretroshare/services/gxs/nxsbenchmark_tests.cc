@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * unittests/libretroshare/services/gxs/nxsbenchmark_tests.cc                  *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+// from librssimulator
+#include "testing/SetBenchmark.h"
+
+// from libretroshare
+#include "rsitems/rsnxsitems.h"
+
+// local
+#include "GxsPeerNode.h"
+#include "gxstestservice.h"
+
+/* Whole node GXS sync benchmark: N fully connected nodes, the first one
+ * publishes a group and then a burst of messages, which have to reach every
+ * other node. The JSON report goes to stdout, or to the file named by
+ * RS_BENCHMARK_OUTPUT.
+ *
+ * These are slow, so disabled by default. Run them with:
+ *   unittests --gtest_also_run_disabled_tests --gtest_filter='*Benchmark*'
+ */
+
+class GxsSyncBenchmark: public SetBenchmark
+{
+public:
+	GxsSyncBenchmark(int nodes, double latency, double bandwidth)
+	{
+		addSerialType(new RsNxsSerialiser(RS_SERVICE_GXS_TYPE_GXSID));
+		addSerialType(new RsNxsSerialiser(RS_SERVICE_GXS_TYPE_GXSCIRCLE));
+		addSerialType(new RsNxsSerialiser(RS_SERVICE_GXS_TYPE_TEST));
+
+		setDefaultLink(latency, bandwidth);
+
+		for(int i = 0; i < nodes; i++)
+		{
+			mPeerIds.push_back(RsPeerId::random());
+		}
+
+		for(size_t i = 0; i < mPeerIds.size(); i++)
+		{
+			std::list<RsPeerId> friends = getFriends(mPeerIds[i]);
+			addNode(mPeerIds[i], new GxsPeerNode(mPeerIds[i], friends, 0, false));
+		}
+
+		startup();
+		tick();
+
+		for(size_t i = 0; i < mPeerIds.size(); i++)
+		{
+			bringOnline(mPeerIds[i], getFriends(mPeerIds[i]));
+		}
+	}
+
+	std::list<RsPeerId> getFriends(const RsPeerId &id)
+	{
+		std::list<RsPeerId> friends;
+		for(size_t i = 0; i < mPeerIds.size(); i++)
+		{
+			if (mPeerIds[i] != id)
+			{
+				friends.push_back(mPeerIds[i]);
+			}
+		}
+		return friends;
+	}
+
+	GxsPeerNode *getGxsPeerNode(int idx)
+	{
+		return (GxsPeerNode *) getPeerNode(mPeerIds[idx]);
+	}
+
+	std::vector<RsPeerId> mPeerIds;
+};
+
+static void outputReport(const SetBenchmark &bench, const std::string &name)
+{
+	const char *filename = getenv("RS_BENCHMARK_OUTPUT");
+	if (filename)
+	{
+		std::ofstream out(filename, std::ios::app);
+		bench.writeReport(out, name);
+	}
+	else
+	{
+		bench.writeReport(std::cout, name);
+	}
+}
+
+static void runGxsSyncBenchmark(const std::string &name, int nodes, int msgs, double latency, double bandwidth)
+{
+	GxsSyncBenchmark bench(nodes, latency, bandwidth);
+	GxsPeerNode *publisher = bench.getGxsPeerNode(0);
+
+	RsGxsGroupId groupId;
+	RsGxsCircleId nullCircleId;
+	RsGxsId nullAuthorId;
+	ASSERT_TRUE(publisher->createGroup("benchmark", GXS_CIRCLE_TYPE_PUBLIC, nullCircleId, nullAuthorId, groupId));
+
+	bench.startMeasure();
+	double groupCreated = bench.now();
+
+	// everybody subscribes as soon as the group shows up.
+	std::vector<bool> subscribed(nodes, false);
+	subscribed[0] = true;
+	bool allSubscribed = bench.run(300, [&]()
+	{
+		bool done = true;
+		for(int i = 1; i < nodes; i++)
+		{
+			if (subscribed[i])
+			{
+				continue;
+			}
+
+			std::list<RsGxsGroupId> groups;
+			GxsPeerNode *node = bench.getGxsPeerNode(i);
+			if (node->getGroupList(groups) && groups.end() != std::find(groups.begin(), groups.end(), groupId))
+			{
+				bench.addSample("group_propagation_s", bench.now() - groupCreated);
+				node->subscribeToGroup(groupId, true);
+				subscribed[i] = true;
+			}
+			else
+			{
+				done = false;
+			}
+		}
+		return done;
+	});
+	EXPECT_TRUE(allSubscribed);
+
+	std::map<RsGxsMessageId, double> published;
+	for(int i = 0; i < msgs; i++)
+	{
+		RsGxsMessageId msgId;
+		EXPECT_TRUE(publisher->createMsg("benchmark msg " + std::to_string(i), groupId, nullAuthorId, msgId));
+		published[msgId] = bench.now();
+	}
+
+	std::vector<std::set<RsGxsMessageId> > received(nodes);
+	bool allReceived = bench.run(600, [&]()
+	{
+		bool done = true;
+		for(int i = 1; i < nodes; i++)
+		{
+			if (received[i].size() == published.size())
+			{
+				continue;
+			}
+
+			std::list<RsGxsMessageId> msgIds;
+			bench.getGxsPeerNode(i)->getMsgList(groupId, msgIds);
+			for(std::list<RsGxsMessageId>::iterator it = msgIds.begin(); it != msgIds.end(); ++it)
+			{
+				std::map<RsGxsMessageId, double>::iterator pit = published.find(*it);
+				if (pit != published.end() && received[i].insert(*it).second)
+				{
+					bench.addSample("msg_propagation_s", bench.now() - pit->second);
+				}
+			}
+			done = done && (received[i].size() == published.size());
+		}
+		return done;
+	});
+	EXPECT_TRUE(allReceived);
+
+	EXPECT_TRUE(bench.getPacketCount() > 0);
+	outputReport(bench, name);
+}
+
+TEST(libretroshare_services, DISABLED_GxsSyncBenchmarkLan)
+{
+	// 4 nodes, 1ms, unlimited bandwidth
+	runGxsSyncBenchmark("gxs_sync_lan", 4, 100, 0.001, 0);
+}
+
+TEST(libretroshare_services, DISABLED_GxsSyncBenchmarkWan)
+{
+	// 8 nodes, 100ms, 100kB/s per link
+	runGxsSyncBenchmark("gxs_sync_wan", 8, 100, 0.1, 100000);
+}
+
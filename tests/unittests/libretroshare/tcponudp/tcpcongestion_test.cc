@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * unittests/libretroshare/tcponudp/tcpcongestion_test.cc                      *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+// from libretroshare
+
+#include "tcponudp/tcpcongestion.h"
+
+static const uint32 SEG = 1000;
+static const uint32 MAXWIN = 65500;
+
+/* Round based loss/delay link emulator: every RTT the sender pushes one
+ * congestion window worth of segments, each one dropped with probability
+ * lossRate. A dropped segment ends up in a retransmission timeout, as in
+ * TcpStream which has no fast retransmit. Returns the average throughput in
+ * bytes per second.
+ */
+static double emulateLink(TcpCongestionControl& cc, double rtt, double lossRate, int rounds)
+{
+	uint32 ackno = 1000;
+	uint64_t delivered = 0;
+	uint32_t rnd = 12345;
+	double now = 0;
+
+	cc.reset(ackno);
+
+	for(int r = 0; r < rounds; ++r)
+	{
+		uint32 nsegs = cc.window() / SEG;
+		bool lost = false;
+
+		for(uint32 i = 0; i < nsegs && !lost; ++i)
+		{
+			rnd = rnd * 1103515245 + 12345;	// deterministic LCG
+			if ((rnd >> 8) % 100000 < lossRate * 100000)
+			{
+				lost = true;
+				break;
+			}
+			ackno += SEG;
+			delivered += SEG;
+			cc.onAck(ackno, rtt, now + rtt);
+		}
+		now += rtt;
+
+		if (lost)
+		{
+			now += rtt;	// waiting for the timeout
+			cc.onTimeout(ackno, now);
+		}
+
+		EXPECT_GE(cc.window(), SEG);
+		EXPECT_LE(cc.window(), MAXWIN);
+	}
+	return delivered / now;
+}
+
+TEST(libretroshare_tcponudp, RenoCongestion)
+{
+	TcpRenoCongestion cc(SEG, MAXWIN);
+	uint32 ackno = 0;
+	cc.reset(ackno);
+
+	EXPECT_EQ(cc.window(), SEG);
+
+	// slow start doubles the window once per window of acknowledged data
+	ackno += SEG; cc.onAck(ackno, 0.1, 0.1);
+	EXPECT_EQ(cc.window(), 2*SEG);
+	ackno += SEG; cc.onAck(ackno, 0.1, 0.2);
+	EXPECT_EQ(cc.window(), 2*SEG);
+	ackno += SEG; cc.onAck(ackno, 0.1, 0.2);
+	EXPECT_EQ(cc.window(), 4*SEG);
+
+	// timeout goes back to one segment
+	cc.onTimeout(ackno, 0.3);
+	EXPECT_EQ(cc.window(), SEG);
+}
+
+TEST(libretroshare_tcponudp, CubicCongestion)
+{
+	TcpCubicCongestion cc(SEG, MAXWIN);
+	uint32 ackno = 0;
+	cc.reset(ackno);
+
+	for(int i = 0; i < 40; ++i)
+	{
+		ackno += SEG;
+		cc.onAck(ackno, 0.1, 0.1 * i);
+	}
+	uint32 win = cc.window();
+	EXPECT_GT(win, 10*SEG);
+
+	// a single loss is a multiplicative decrease...
+	cc.onTimeout(ackno, 5.0);
+	EXPECT_LT(cc.window(), win);
+	EXPECT_GT(cc.window(), win / 2);
+
+	// ...but repeated timeouts without progress collapse the window
+	cc.onTimeout(ackno, 6.0);
+	EXPECT_EQ(cc.window(), SEG);
+}
+
+TEST(libretroshare_tcponudp, CongestionOnLossyLink)
+{
+	// 300ms RTT, 1% loss: typical NAT traversed intercontinental link
+
+	TcpRenoCongestion reno(SEG, MAXWIN);
+	TcpCubicCongestion cubic(SEG, MAXWIN);
+
+	double renoRate = emulateLink(reno, 0.3, 0.01, 2000);
+	double cubicRate = emulateLink(cubic, 0.3, 0.01, 2000);
+
+	std::cerr << "Lossy link throughput: reno " << renoRate << " B/s, cubic " << cubicRate << " B/s" << std::endl;
+
+	EXPECT_GT(cubicRate, renoRate);
+
+	// no loss: both reach the maximum window
+	TcpRenoCongestion reno2(SEG, MAXWIN);
+	TcpCubicCongestion cubic2(SEG, MAXWIN);
+
+	emulateLink(reno2, 0.3, 0.0, 200);
+	emulateLink(cubic2, 0.3, 0.0, 200);
+
+	EXPECT_GE(reno2.window(), MAXWIN - SEG);
+	EXPECT_GE(cubic2.window(), MAXWIN - SEG);
+}
@@ -0,0 +1,292 @@
+/*******************************************************************************
+ * unittests/libretroshare/util/rsexpr_test.cc                                 *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+
+// from libretroshare
+
+#include "retroshare/rsexpr.h"
+
+using namespace RsRegularExpression;
+
+class TestFileEntry: public ExpFileEntry
+{
+public:
+	virtual const std::string& file_name()        const { return name; }
+	virtual uint64_t           file_size()        const { return size; }
+	virtual rstime_t           file_modtime()     const { return modtime; }
+	virtual uint32_t           file_popularity()  const { return popularity; }
+	virtual std::string        file_parent_path() const { return path; }
+	virtual const RsFileHash&  file_hash()        const { return hash; }
+
+	std::string name;
+	std::string path;
+	uint64_t size;
+	rstime_t modtime;
+	uint32_t popularity;
+	RsFileHash hash;
+};
+
+static const char *WORDS[] = { "Linux", "linux", "ISO", "iso", "Holiday", "photo", "music",
+                               "The", "best", "of", "2024", "a", "mix", "", "LIVE", "live" };
+static const char *EXTENSIONS[] = { "mp3", "MP3", "iso", "jpg", "mkv", "txt", "" };
+
+static std::string randomWords(std::mt19937& rng, int max_words, const char *sep)
+{
+	std::string str;
+	int n = rng() % max_words + 1;
+	for(int i = 0; i < n; ++i)
+		str += std::string(i ? sep : "") + WORDS[rng() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+	return str;
+}
+
+static std::vector<TestFileEntry> makeFiles(std::mt19937& rng, size_t count)
+{
+	std::vector<TestFileEntry> files(count);
+	for(size_t i = 0; i < count; ++i)
+	{
+		TestFileEntry& f(files[i]);
+		f.name = randomWords(rng, 5, " ");
+		if(rng() % 5) f.name += std::string(".") + EXTENSIONS[rng() % (sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]))];
+		f.path = "/home/user/" + randomWords(rng, 3, "/");
+		f.size = (uint64_t)rng() * (rng() % 2000);
+		f.modtime = 1600000000 + rng() % 100000000;
+		f.popularity = rng() % 100;
+		f.hash = RsFileHash::random();
+	}
+	return files;
+}
+
+static Expression *randomExpression(std::mt19937& rng, const std::vector<TestFileEntry>& files, int depth)
+{
+	if(depth > 0 && rng() % 3 == 0)
+		return new CompoundExpression( static_cast<LogicalOperator>(rng() % 3),
+		                               randomExpression(rng, files, depth - 1),
+		                               randomExpression(rng, files, depth - 1) );
+
+	std::list<std::string> terms;
+	int n = rng() % 4;
+	for(int i = 0; i < n; ++i) terms.push_back(WORDS[rng() % (sizeof(WORDS) / sizeof(WORDS[0]))]);
+
+	StringOperator sop = static_cast<StringOperator>(rng() % 3);
+	bool ic = rng() % 2;
+	int v1 = rng() % 2000, v2 = v1 + rng() % 2000;
+	RelOperator rop = static_cast<RelOperator>(rng() % 6);
+
+	switch(rng() % 8)
+	{
+	case 0: return new NameExpression(sop, terms, ic);
+	case 1:
+	{
+		std::list<std::string> exts;
+		exts.push_back(EXTENSIONS[rng() % (sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]))]);
+		return new ExtExpression(sop, exts, ic);
+	}
+	case 2: return new PathExpression(sop, terms, ic);
+	case 3:
+	{
+		std::list<std::string> hashes;
+		std::string h = files[rng() % files.size()].hash.toStdString();
+		hashes.push_back(rng() % 2 ? h : h.substr(3, 7));
+		return new HashExpression(sop, hashes);
+	}
+	case 4: return new SizeExpression(rop, v1 * 1000000, v2 * 1000000);
+	case 5: return new SizeExpressionMB(rop, v1, v2);
+	case 6: return new DateExpression(rop, 1600000000 + v1 * 50000, 1600000000 + v2 * 50000);
+	default: return new PopExpression(rop, v1 % 100, v2 % 100);
+	}
+}
+
+TEST(libretroshare_util, RsExpressionCompiledSameAsInterpreted)
+{
+	std::mt19937 rng(42);
+	std::vector<TestFileEntry> files = makeFiles(rng, 500);
+
+	for(int i = 0; i < 500; ++i)
+	{
+		std::unique_ptr<Expression> exp(randomExpression(rng, files, 3));
+
+		CompiledExpression compiled;
+		ASSERT_TRUE(compiled.compile(*exp));
+
+		for(size_t j = 0; j < files.size(); ++j)
+			ASSERT_EQ(compiled.eval(files[j]), exp->eval(files[j]))
+			        << exp->toStdString() << " on " << files[j].name << " in " << files[j].path;
+	}
+}
+
+TEST(libretroshare_util, RsExpressionCompiledManyTerms)
+{
+	TestFileEntry f;
+	f.name = "some Long file NAME.txt";
+	f.size = 0;
+	f.modtime = 0;
+	f.popularity = 0;
+
+	// more terms than fit in a single automaton, and longer than its limit
+	std::list<std::string> terms;
+	for(int i = 0; i < 200; ++i) terms.push_back("term" + std::to_string(i));
+	terms.push_back("name");
+
+	CompiledExpression any, all, longTerms;
+	ASSERT_TRUE(any.compile(NameExpression(ContainsAnyStrings, terms, true)));
+	ASSERT_TRUE(all.compile(NameExpression(ContainsAllStrings, terms, true)));
+	EXPECT_TRUE(any.eval(f));
+	EXPECT_FALSE(all.eval(f));
+
+	std::list<std::string> words;
+	words.push_back(std::string(300, 'x'));
+	words.push_back("long FILE");
+	ASSERT_TRUE(longTerms.compile(NameExpression(ContainsAnyStrings, words, true)));
+	EXPECT_TRUE(longTerms.eval(f));
+}
+
+TEST(libretroshare_util, RsExpressionCompiledAutomatonCap)
+{
+	TestFileEntry f;
+	f.name = "the end.txt";
+	f.size = 0;
+	f.modtime = 0;
+	f.popularity = 0;
+
+	// Many string tests, each one small enough for an automaton: past the total cap,
+	// the last ones are searched term by term.
+	Expression *exp = NULL;
+	for(int i = 0; i < 100; ++i)
+	{
+		std::list<std::string> terms;
+		for(int j = 0; j < 20; ++j) terms.push_back("test" + std::to_string(i) + "term" + std::to_string(j));
+		if(i == 99) terms.push_back("END");
+
+		Expression *test = new NameExpression(ContainsAnyStrings, terms, true);
+		exp = exp ? new CompoundExpression(OrOp, exp, test) : test;
+	}
+	std::unique_ptr<Expression> owner(exp);
+
+	CompiledExpression compiled;
+	ASSERT_TRUE(compiled.compile(*exp));
+	EXPECT_LT(compiled.memoryUsage(), 8u*1024*1024);
+	EXPECT_TRUE(compiled.eval(f));
+
+	f.name = "nothing.txt";
+	EXPECT_FALSE(compiled.eval(f));
+}
+
+TEST(libretroshare_util, RsExpressionCompileMalformed)
+{
+	std::list<std::string> terms;
+	terms.push_back("linux");
+	CompoundExpression exp(AndOp, new NameExpression(ContainsAllStrings, terms, true), new SizeExpression(Greater, 1000));
+
+	LinearizedExpression e;
+	exp.linearize(e);
+
+	CompiledExpression compiled;
+	ASSERT_TRUE(compiled.compile(e));
+
+	LinearizedExpression truncated(e);
+	truncated._tokens.pop_back();
+	EXPECT_FALSE(compiled.compile(truncated));
+
+	LinearizedExpression badStrings(e);
+	badStrings._strings.clear();
+	EXPECT_FALSE(compiled.compile(badStrings));
+
+	LinearizedExpression badToken(e);
+	badToken._tokens[0] = 200;
+	EXPECT_FALSE(compiled.compile(badToken));
+
+	TestFileEntry f;
+	f.name = "linux.iso";
+	f.size = 2000;
+	EXPECT_FALSE(compiled.eval(f));
+}
+
+/* Search benchmark: typical searches evaluated over 200k files, with the
+ * Expression tree as received from turtle (LinearizedExpression::toExpr) and
+ * compiled.
+ *
+ * Disabled by default. Run it with:
+ *   unittests --gtest_also_run_disabled_tests --gtest_filter='*RsExpressionBenchmark*'
+ */
+
+static double wallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TEST(libretroshare_util, DISABLED_RsExpressionBenchmark)
+{
+	const size_t FILES = 200000;
+
+	std::mt19937 rng(42);
+	std::vector<TestFileEntry> files = makeFiles(rng, FILES);
+
+	std::list<std::string> keywords;
+	keywords.push_back("linux");
+	keywords.push_back("live");
+	keywords.push_back("2024");
+	std::list<std::string> mp3;
+	mp3.push_back("mp3");
+	std::list<std::string> holiday;
+	holiday.push_back("holiday");
+
+	std::vector<std::pair<std::string, Expression*> > searches;
+	searches.push_back(std::make_pair("name_contains_all", new NameExpression(ContainsAllStrings, keywords, true)));
+	searches.push_back(std::make_pair("name_contains_any", new NameExpression(ContainsAnyStrings, keywords, true)));
+	searches.push_back(std::make_pair("path_and_ext_and_size",
+	        new CompoundExpression(AndOp, new PathExpression(ContainsAnyStrings, holiday, true),
+	            new CompoundExpression(AndOp, new ExtExpression(EqualsString, mp3, true), new SizeExpressionMB(Smaller, 10)))));
+
+	std::cout << "{ \"benchmark\": \"expression_search\", \"files\": " << FILES;
+
+	for(size_t i = 0; i < searches.size(); ++i)
+	{
+		LinearizedExpression e;
+		searches[i].second->linearize(e);
+		delete searches[i].second;
+
+		std::unique_ptr<Expression> exp(LinearizedExpression::toExpr(e));
+		double start = wallTime();
+		size_t interpreted = 0;
+		for(size_t j = 0; j < FILES; ++j)
+			if(exp->eval(files[j])) ++interpreted;
+		double interpretedTime = wallTime() - start;
+
+		start = wallTime();
+		CompiledExpression compiled;
+		compiled.compile(e);
+		size_t matched = 0;
+		for(size_t j = 0; j < FILES; ++j)
+			if(compiled.eval(files[j])) ++matched;
+		double compiledTime = wallTime() - start;
+
+		EXPECT_EQ(matched, interpreted);
+
+		std::cout << ", \"" << searches[i].first << "\": { \"matches\": " << matched
+		          << ", \"interpreted_s\": " << interpretedTime << ", \"compiled_s\": " << compiledTime << " }";
+	}
+	std::cout << " }" << std::endl;
+}
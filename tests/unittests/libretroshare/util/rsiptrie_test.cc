@@ -0,0 +1,232 @@
+/*******************************************************************************
+ * unittests/libretroshare/util/rsiptrie_test.cc                               *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+
+// from libretroshare
+
+#include "util/rsiptrie.h"
+
+static RsIpPrefix prefix(const std::string& str)
+{
+	RsIpPrefix p;
+	EXPECT_TRUE(p.fromString(str)) << str;
+	return p;
+}
+
+static bool lookup(const RsIpPrefixTrie& trie, const std::string& addr, uint32_t& value)
+{
+	return trie.lookup(prefix(addr), value);
+}
+
+TEST(libretroshare_util, RsIpPrefixParse)
+{
+	EXPECT_EQ(prefix("10.1.2.3").toString(), "10.1.2.3/32");
+	EXPECT_EQ(prefix("10.1.2.3/16").toString(), "10.1.0.0/16");
+	EXPECT_EQ(prefix("001.002.003.004").toString(), "1.2.3.4/32");
+	EXPECT_EQ(prefix("2001:db8::1/32").toString(), "2001:db8::/32");
+	EXPECT_TRUE(prefix("::ffff:10.0.0.0/104").isIpv4());
+	EXPECT_FALSE(prefix("2001:db8::/32").isIpv4());
+
+	RsIpPrefix p;
+	EXPECT_FALSE(p.fromString("10.1.2"));
+	EXPECT_FALSE(p.fromString("10.1.2.300"));
+	EXPECT_FALSE(p.fromString("10.1.2.3/33"));
+	EXPECT_FALSE(p.fromString("2001:db8::/129"));
+	EXPECT_FALSE(p.fromString("example.org"));
+}
+
+TEST(libretroshare_util, RsIpPrefixTrieLongestMatch)
+{
+	RsIpPrefixTrie trie;
+	trie.insert(prefix("10.0.0.0/8"), 8);
+	trie.insert(prefix("10.1.0.0/16"), 16);
+	trie.insert(prefix("10.1.2.0/24"), 24);
+	trie.insert(prefix("10.1.2.3"), 32);
+	trie.insert(prefix("10.128.0.0/9"), 9);
+	trie.insert(prefix("2001:db8::/32"), 132);
+	EXPECT_EQ(trie.size(), 6u);
+
+	uint32_t v = 0;
+	EXPECT_TRUE(lookup(trie, "10.1.2.3", v)); EXPECT_EQ(v, 32u);
+	EXPECT_TRUE(lookup(trie, "10.1.2.4", v)); EXPECT_EQ(v, 24u);
+	EXPECT_TRUE(lookup(trie, "10.1.3.4", v)); EXPECT_EQ(v, 16u);
+	EXPECT_TRUE(lookup(trie, "10.2.3.4", v)); EXPECT_EQ(v, 8u);
+	EXPECT_TRUE(lookup(trie, "10.200.3.4", v)); EXPECT_EQ(v, 9u);
+	EXPECT_TRUE(lookup(trie, "2001:db8:1::5", v)); EXPECT_EQ(v, 132u);
+	EXPECT_FALSE(lookup(trie, "11.1.2.3", v));
+	EXPECT_FALSE(lookup(trie, "2001:db9::1", v));
+
+	// replacing a value does not add a prefix
+	trie.insert(prefix("10.1.0.0/16"), 1600);
+	EXPECT_EQ(trie.size(), 6u);
+	EXPECT_TRUE(lookup(trie, "10.1.3.4", v)); EXPECT_EQ(v, 1600u);
+
+	sockaddr_storage addr;
+	sockaddr_storage_clear(addr);
+	addr.ss_family = AF_INET;
+	reinterpret_cast<sockaddr_in&>(addr).sin_addr.s_addr = htonl(0x0a010203);
+	EXPECT_TRUE(trie.lookup(addr, v)); EXPECT_EQ(v, 32u);
+}
+
+TEST(libretroshare_util, RsIpPrefixTrieMatchesLinearScan)
+{
+	std::mt19937 rng(42);
+	std::vector<RsIpPrefix> prefixes;
+	RsIpPrefixTrie trie;
+
+	for(uint32_t i = 0; i < 1000; ++i)
+	{
+		RsIpPrefix p;
+		p.lo = 0x0000ffff00000000ULL | rng();
+		p.length = 96 + 8 + rng() % 25;
+		RsIpPrefix masked;
+		masked.fromString(p.toString());
+		prefixes.push_back(masked);
+		trie.insert(masked, i);
+	}
+
+	for(int i = 0; i < 10000; ++i)
+	{
+		RsIpPrefix addr;
+		addr.lo = 0x0000ffff00000000ULL | (i % 2 ? rng() : prefixes[rng() % prefixes.size()].lo + rng() % 256);
+		addr.length = 128;
+
+		int best = -1;
+		for(size_t j = 0; j < prefixes.size(); ++j)
+			if( prefixes[j].contains(addr) &&
+			        (best < 0 || prefixes[j].length >= prefixes[best].length) )
+				best = j;
+
+		uint32_t v = 0;
+		bool found = trie.lookup(addr, v);
+		ASSERT_EQ(found, best >= 0);
+		if(found) EXPECT_EQ(prefixes[v].length, prefixes[best].length);
+	}
+}
+
+TEST(libretroshare_util, RsIpBlocklistLines)
+{
+	std::vector<RsIpPrefix> p;
+
+	EXPECT_FALSE(rsParseIpBlocklistLine("# comment", p));
+	EXPECT_FALSE(rsParseIpBlocklistLine("   ", p));
+	EXPECT_FALSE(rsParseIpBlocklistLine("garbage", p));
+	EXPECT_TRUE(p.empty());
+
+	EXPECT_TRUE(rsParseIpBlocklistLine("192.168.0.0/16", p));
+	EXPECT_TRUE(rsParseIpBlocklistLine("Some-Org: bad:1.2.3.0-1.2.3.255", p));
+	EXPECT_TRUE(rsParseIpBlocklistLine("005.006.007.000 - 005.006.007.127 , 000 , desc", p));
+	EXPECT_TRUE(rsParseIpBlocklistLine("2001:db8::/48", p));
+	ASSERT_EQ(p.size(), 4u);
+	EXPECT_EQ(p[0].toString(), "192.168.0.0/16");
+	EXPECT_EQ(p[1].toString(), "1.2.3.0/24");
+	EXPECT_EQ(p[2].toString(), "5.6.7.0/25");
+	EXPECT_EQ(p[3].toString(), "2001:db8::/48");
+
+	// unaligned range
+	p.clear();
+	EXPECT_TRUE(rsParseIpBlocklistLine("10.0.0.1-10.0.0.6", p));
+	ASSERT_EQ(p.size(), 4u);
+	EXPECT_EQ(p[0].toString(), "10.0.0.1/32");
+	EXPECT_EQ(p[1].toString(), "10.0.0.2/31");
+	EXPECT_EQ(p[2].toString(), "10.0.0.4/31");
+	EXPECT_EQ(p[3].toString(), "10.0.0.6/32");
+
+	p.clear();
+	EXPECT_TRUE(rsParseIpBlocklistLine("0.0.0.0-255.255.255.255", p));
+	ASSERT_EQ(p.size(), 1u);
+	EXPECT_EQ(p[0].toString(), "0.0.0.0/0");
+}
+
+/* Lookup benchmark: 100k random IPv4 ranges of /16 to /32, like a big
+ * external blocklist, then 1M lookups of random addresses. The /16, /24 and
+ * /32 map lookups p3BanList did before are timed as reference.
+ *
+ * Disabled by default. Run it with:
+ *   unittests --gtest_also_run_disabled_tests --gtest_filter='*RsIpPrefixTrieBenchmark*'
+ */
+
+static double wallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TEST(libretroshare_util, DISABLED_RsIpPrefixTrieBenchmark)
+{
+	const uint32_t RANGES = 100000;
+	const uint32_t LOOKUPS = 1000000;
+
+	std::mt19937 rng(42);
+	std::vector<RsIpPrefix> prefixes;
+	std::map<uint32_t, uint32_t> maps[3];
+
+	for(uint32_t i = 0; i < RANGES; ++i)
+	{
+		RsIpPrefix p;
+		uint32_t ip = rng();
+		p.lo = 0x0000ffff00000000ULL | ip;
+		p.length = 96 + 16 + rng() % 17;
+		prefixes.push_back(p);
+		maps[i % 3][ip & (0xffffffff << (8 * (i % 3)))] = i;
+	}
+
+	std::vector<RsIpPrefix> addrs(LOOKUPS);
+	for(uint32_t i = 0; i < LOOKUPS; ++i)
+	{
+		addrs[i].lo = 0x0000ffff00000000ULL | rng();
+		addrs[i].length = 128;
+	}
+
+	double start = wallTime();
+	RsIpPrefixTrie trie;
+	for(uint32_t i = 0; i < RANGES; ++i) trie.insert(prefixes[i], i);
+	double build = wallTime() - start;
+
+	uint32_t found = 0;
+	start = wallTime();
+	for(uint32_t i = 0; i < LOOKUPS; ++i)
+	{
+		uint32_t v;
+		if(trie.lookup(addrs[i], v)) ++found;
+	}
+	double trieLookups = wallTime() - start;
+
+	uint32_t mapFound = 0;
+	start = wallTime();
+	for(uint32_t i = 0; i < LOOKUPS; ++i)
+	{
+		uint32_t ip = static_cast<uint32_t>(addrs[i].lo);
+		for(int m = 0; m < 3; ++m)
+			if(maps[m].count(ip & (0xffffffff << (8 * m)))) { ++mapFound; break; }
+	}
+	double mapLookups = wallTime() - start;
+
+	std::cout << "{ \"benchmark\": \"ip_prefix_trie\", \"ranges\": " << RANGES
+	          << ", \"lookups\": " << LOOKUPS << ", \"build_s\": " << build
+	          << ", \"trie_lookup_s\": " << trieLookups << ", \"trie_found\": " << found
+	          << ", \"map_lookup_s\": " << mapLookups << ", \"map_found\": " << mapFound
+	          << " }" << std::endl;
+}
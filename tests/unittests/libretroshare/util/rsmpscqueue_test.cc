@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * unittests/libretroshare/util/rsmpscqueue_test.cc                            *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+// from libretroshare
+
+#include "util/rsmpscqueue.h"
+
+TEST(libretroshare_util, MpscQueueFifo)
+{
+	RsMpscQueue<int> queue;
+	int value;
+
+	EXPECT_FALSE(queue.pop(value));
+
+	for(int i = 0; i < 10; ++i)
+		queue.push(i);
+
+	for(int i = 0; i < 10; ++i)
+	{
+		ASSERT_TRUE(queue.pop(value));
+		EXPECT_EQ(i, value);
+	}
+	EXPECT_FALSE(queue.pop(value));
+
+	// left in the queue, freed by the destructor
+	queue.push(42);
+}
+
+TEST(libretroshare_util, MpscQueueProducers)
+{
+	const int PRODUCERS = 4;
+	const int ITEMS = 100000;
+
+	RsMpscQueue<uint64_t> queue;
+	std::vector<std::thread> producers;
+
+	for(int p = 0; p < PRODUCERS; ++p)
+		producers.push_back(std::thread([&queue, p]()
+		{
+			for(uint64_t i = 0; i < ITEMS; ++i)
+				queue.push(((uint64_t) p << 32) | i);
+		}));
+
+	// each producer's items must come out in order
+	std::vector<uint64_t> next(PRODUCERS, 0);
+	int received = 0;
+	uint64_t value;
+
+	while(received < PRODUCERS * ITEMS)
+	{
+		if(!queue.pop(value))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		int p = value >> 32;
+		ASSERT_LT(p, PRODUCERS);
+		ASSERT_EQ(next[p], value & 0xffffffff);
+		++next[p];
+		++received;
+	}
+
+	for(auto& t : producers)
+		t.join();
+
+	EXPECT_EQ(PRODUCERS * ITEMS, received);
+	EXPECT_FALSE(queue.pop(value));
+}
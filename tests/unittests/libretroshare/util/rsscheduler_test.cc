@@ -0,0 +1,205 @@
+/*******************************************************************************
+ * unittests/libretroshare/util/rsscheduler_test.cc                            *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+
+// from libretroshare
+
+#include "util/rsscheduler.h"
+
+TEST(libretroshare_util, TimerWheel)
+{
+	RsTimerWheel wheel(100);
+	std::vector<uint64_t> expired;
+
+	// one timer per level, plus the overflow list, plus one in the past
+	const uint64_t delays[] = { 0, 1, 63, 64, 65, 4095, 4096, 300000, 20000000, 70000000 };
+	for(uint64_t i = 0; i < sizeof(delays)/sizeof(delays[0]); ++i)
+		wheel.add(i, 100 + delays[i]);
+	wheel.add(99, 10);
+
+	EXPECT_EQ(wheel.size(), 11u);
+
+	wheel.advance(100, expired);
+	ASSERT_EQ(expired.size(), 2u);
+	std::sort(expired.begin(), expired.end());
+	EXPECT_EQ(expired[0], 0u);
+	EXPECT_EQ(expired[1], 99u);
+
+	// every timer must expire exactly at its tick, whatever the steps
+	uint64_t now = 100;
+	for(uint64_t i = 1; i < sizeof(delays)/sizeof(delays[0]); ++i)
+	{
+		uint64_t expiry = 100 + delays[i];
+
+		expired.clear();
+		while(now < expiry - 1)
+		{
+			uint64_t next = std::min(wheel.nextExpiry(), expiry - 1);
+			EXPECT_GT(next, now);
+			now = next;
+			wheel.advance(now, expired);
+		}
+		EXPECT_TRUE(expired.empty()) << "timer " << i << " expired early";
+
+		now = expiry;
+		wheel.advance(now, expired);
+		ASSERT_EQ(expired.size(), 1u) << "timer " << i;
+		EXPECT_EQ(expired[0], i);
+	}
+
+	EXPECT_EQ(wheel.size(), 0u);
+	EXPECT_EQ(wheel.nextExpiry(), std::numeric_limits<uint64_t>::max());
+}
+
+TEST(libretroshare_util, SchedulerPeriodicAndWakeup)
+{
+	RsScheduler scheduler;
+	scheduler.start(2);
+
+	std::atomic<int> periodic(0);
+	std::atomic<int> woken(0);
+	std::atomic<int> concurrent(0);
+	std::atomic<bool> overlapped(false);
+
+	RsScheduler::JobId p = scheduler.addJob("periodic", [&]()
+	{
+		if(++concurrent > 1) overlapped = true;
+		++periodic;
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		--concurrent;
+	}, std::chrono::milliseconds(20));
+
+	// very long period: only runs when explicitly woken up
+	RsScheduler::JobId w = scheduler.addJob(
+	            "woken", [&]() { ++woken; }, std::chrono::hours(1) );
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_EQ(woken, 1);	// first run happens right away
+
+	for(int i = 0; i < 10; ++i)
+	{
+		scheduler.wakeup(w);
+		scheduler.wakeup(p);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	EXPECT_EQ(woken, 11);
+	EXPECT_GT(periodic, 10);
+	EXPECT_FALSE(overlapped);
+
+	scheduler.removeJob(p);
+	int count = periodic;
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	EXPECT_EQ(periodic, count);
+
+	RsScheduler::Statistics stats = scheduler.getStatistics();
+	EXPECT_EQ(stats.threads, 3u);
+	EXPECT_EQ(stats.jobs, 1u);
+	EXPECT_EQ(stats.explicitWakeups, 20u);
+	EXPECT_GT(stats.timerWakeups, 0u);
+
+	scheduler.stop();
+}
+
+TEST(libretroshare_util, SchedulerBusyWorkers)
+{
+	RsScheduler scheduler;
+	scheduler.start(1);
+
+	std::atomic<bool> release(false);
+	std::atomic<int> other(0);
+
+	// a blocking job keeps the only worker busy, the other one must wait
+	RsScheduler::JobId b = scheduler.addJob("blocking", [&]()
+	{
+		while(!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}, std::chrono::hours(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	RsScheduler::JobId o = scheduler.addJob(
+	            "other", [&]() { ++other; }, std::chrono::hours(1) );
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	RsScheduler::Statistics stats = scheduler.getStatistics();
+	EXPECT_EQ(stats.busyWorkers, 1u);
+	EXPECT_EQ(stats.queuedJobs, 1u);
+	EXPECT_GE(stats.longestRunMs, 50u);
+	EXPECT_EQ(other, 0);
+
+	release = true;
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	stats = scheduler.getStatistics();
+	EXPECT_EQ(stats.busyWorkers, 0u);
+	EXPECT_EQ(stats.queuedJobs, 0u);
+	EXPECT_EQ(stats.longestRunMs, 0u);
+	EXPECT_EQ(other, 1);
+
+	scheduler.removeJob(b);
+	scheduler.removeJob(o);
+	scheduler.stop();
+}
+
+TEST(libretroshare_util, SchedulerRemoveJobOfOtherScheduler)
+{
+	RsScheduler s1, s2;
+	s1.start(1);
+	s2.start(1);
+
+	std::atomic<bool> running(false);
+	std::atomic<bool> release(false);
+	std::atomic<bool> done(false);
+	std::atomic<bool> doneWhenRemoved(false);
+	std::atomic<bool> removed(false);
+
+	RsScheduler::JobId j2 = s2.addJob("slow", [&]()
+	{
+		running = true;
+		while(!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		done = true;
+	}, std::chrono::hours(1));
+	while(!running) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	// A job with the same id on the other scheduler must still wait for
+	// the running job to be over.
+	RsScheduler::JobId j1 = s1.addJob("remover", [&]()
+	{
+		release = true;
+		s2.removeJob(j2);
+		doneWhenRemoved = done.load();
+		removed = true;
+	}, std::chrono::hours(1));
+	ASSERT_EQ(j1, j2);
+
+	for(int i = 0; i < 500 && !removed; ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+	EXPECT_TRUE(removed);
+	EXPECT_TRUE(doneWhenRemoved);
+
+	s1.removeJob(j1);
+	s1.stop();
+	s2.stop();
+}
@@ -0,0 +1,330 @@
+/*******************************************************************************
+ * unittests/libretroshare/util/smallobject_test.cc                            *
+ *                                                                             *
+ * Copyright (C) 2026, Retroshare team <contact@retroshare.cc>                 *
+ *                                                                             *
+ * This program is free software: you can redistribute it and/or modify        *
+ * it under the terms of the GNU Affero General Public License as              *
+ * published by the Free Software Foundation, either version 3 of the          *
+ * License, or (at your option) any later version.                             *
+ *                                                                             *
+ * This program is distributed in the hope that it will be useful,             *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of              *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the                *
+ * GNU Lesser General Public License for more details.                         *
+ *                                                                             *
+ * You should have received a copy of the GNU Lesser General Public License    *
+ * along with this program. If not, see <https://www.gnu.org/licenses/>.       *
+ *                                                                             *
+ ******************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+// from libretroshare
+
+#include "util/smallobject.h"
+
+using namespace RsMemoryManagement;
+
+typedef ThreadCachingAllocator TCA;
+
+// 112 bytes size class, not used by anything else here. Allocated like
+// SmallObject does, but whatever allocator libretroshare was built with.
+struct TestObject
+{
+	static void* operator new(size_t size) { return TCA::allocate(size); }
+	static void operator delete(void* p, size_t size) { TCA::deallocate(p, size); }
+
+	char data[100];
+};
+
+static SizeClassStatistics classStats(size_t bytes)
+{
+	std::vector<SizeClassStatistics> stats;
+	TCA::getStatistics(stats);
+	EXPECT_EQ(stats.size(), static_cast<size_t>(TCA::NUM_SIZE_CLASSES));
+	return stats[(bytes - 1) / TCA::SIZE_CLASS_GRANULARITY];
+}
+
+TEST(libretroshare_util, ThreadCachingAllocatorReuse)
+{
+	SizeClassStatistics before = classStats(sizeof(TestObject));
+
+	std::thread t([]()
+	{
+		std::vector<TestObject*> objs;
+		for(int round = 0; round < 100; ++round)
+		{
+			for(int i = 0; i < 1000; ++i) objs.push_back(new TestObject);
+			for(size_t i = 0; i < objs.size(); ++i) delete objs[i];
+			objs.clear();
+		}
+	});
+	t.join();
+
+	SizeClassStatistics after = classStats(sizeof(TestObject));
+
+	EXPECT_EQ(after.blockSize, 112u);
+	EXPECT_EQ(after.allocations - before.allocations, 100000u);
+	EXPECT_EQ(after.deallocations - before.deallocations, 100000u);
+
+	// blocks are reused after the first round
+	EXPECT_LE(after.systemAllocations - before.systemAllocations, 1000u + TCA::MAGAZINE_SIZE);
+
+	// the blocks of the exited thread are all in the depot, or freed
+	EXPECT_EQ( (after.systemAllocations - after.systemFrees) - (before.systemAllocations - before.systemFrees),
+	           after.depotBlocks - before.depotBlocks );
+
+	// larger objects are not cached
+	void* p = TCA::allocate(MAX_SMALL_OBJECT_SIZE + 1);
+	ASSERT_TRUE(p != nullptr);
+	TCA::deallocate(p, MAX_SMALL_OBJECT_SIZE + 1);
+}
+
+/// Items allocated by one thread and deleted by another one, like incoming packets
+TEST(libretroshare_util, ThreadCachingAllocatorCrossThreadFree)
+{
+	const int COUNT = 200000;
+	SizeClassStatistics before = classStats(sizeof(TestObject));
+
+	std::mutex mtx;
+	std::condition_variable cond;
+	std::deque<TestObject*> queue;
+	bool done = false;
+
+	std::thread producer([&]()
+	{
+		for(int i = 0; i < COUNT; ++i)
+		{
+			TestObject* obj = new TestObject;
+			obj->data[0] = static_cast<char>(i);
+			std::unique_lock<std::mutex> lock(mtx);
+			queue.push_back(obj);
+			cond.notify_one();
+		}
+		std::unique_lock<std::mutex> lock(mtx);
+		done = true;
+		cond.notify_one();
+	});
+
+	int received = 0;
+	bool inOrder = true;
+	std::thread consumer([&]()
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		for(;;)
+		{
+			while(queue.empty() && !done) cond.wait(lock);
+			if(queue.empty()) break;
+			TestObject* obj = queue.front();
+			queue.pop_front();
+			inOrder = inOrder && obj->data[0] == static_cast<char>(received);
+			++received;
+			delete obj;
+		}
+	});
+
+	producer.join();
+	consumer.join();
+
+	EXPECT_EQ(received, COUNT);
+	EXPECT_TRUE(inOrder);
+
+	SizeClassStatistics after = classStats(sizeof(TestObject));
+
+	EXPECT_EQ(after.allocations - before.allocations, static_cast<uint64_t>(COUNT));
+	EXPECT_EQ(after.deallocations - before.deallocations, static_cast<uint64_t>(COUNT));
+
+	// freed blocks went back to the producer through the depot
+	EXPECT_GT(after.depotGets - before.depotGets, 0u);
+	EXPECT_LT(after.systemAllocations - before.systemAllocations, static_cast<uint64_t>(COUNT));
+
+	EXPECT_EQ( (after.systemAllocations - after.systemFrees) - (before.systemAllocations - before.systemFrees),
+	           after.depotBlocks - before.depotBlocks );
+}
+
+/* Multi-threaded allocation benchmark: each thread allocates and frees batches
+ * of blocks of RsItem sizes, then pairs of producer and consumer threads pass
+ * blocks to each other like incoming packets. The thread caching allocator is
+ * compared with the mutex protected SmallObjectAllocator that SmallObject used
+ * before (and still uses with RS_LOCKED_SMALL_OBJECT_ALLOCATOR), and with
+ * plain malloc().
+ *
+ * Disabled by default. Run it with:
+ *   unittests --gtest_also_run_disabled_tests --gtest_filter='*ThreadCachingAllocatorBenchmark*'
+ */
+
+static double wallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct LockedAllocator
+{
+	LockedAllocator() : mtx("LockedAllocator"), allocator(MAX_SMALL_OBJECT_SIZE) {}
+
+	void* allocate(size_t size) { RsStackMutex m(mtx); return allocator.allocate(size); }
+	void deallocate(void* p, size_t size) { RsStackMutex m(mtx); allocator.deallocate(p, size); }
+
+	RsMutex mtx;
+	SmallObjectAllocator allocator;
+};
+
+struct CachingAllocator
+{
+	void* allocate(size_t size) { return TCA::allocate(size); }
+	void deallocate(void* p, size_t size) { TCA::deallocate(p, size); }
+};
+
+struct MallocAllocator
+{
+	void* allocate(size_t size) { return malloc(size); }
+	void deallocate(void* p, size_t) { free(p); }
+};
+
+static const size_t BENCH_SIZES[] = { 24, 40, 48, 64, 72, 96, 112, 128 };
+static const size_t BENCH_NUM_SIZES = sizeof(BENCH_SIZES) / sizeof(BENCH_SIZES[0]);
+
+template<typename A>
+static double localBatches(A& allocator, int threads, int pairs)
+{
+	double start = wallTime();
+	std::vector<std::thread> workers;
+
+	for(int t = 0; t < threads; ++t)
+		workers.emplace_back([&allocator, pairs, t]()
+		{
+			const int BATCH = 100;
+			void* blocks[BATCH];
+
+			for(int done = 0; done < pairs; done += BATCH)
+			{
+				for(int i = 0; i < BATCH; ++i)
+					blocks[i] = allocator.allocate(BENCH_SIZES[(i + t) % BENCH_NUM_SIZES]);
+				for(int i = 0; i < BATCH; ++i)
+					allocator.deallocate(blocks[i], BENCH_SIZES[(i + t) % BENCH_NUM_SIZES]);
+			}
+		});
+
+	for(size_t t = 0; t < workers.size(); ++t) workers[t].join();
+	return wallTime() - start;
+}
+
+template<typename A>
+static double producerConsumer(A& allocator, int pairsOfThreads, int blocks)
+{
+	const size_t BATCH = 256;
+	double start = wallTime();
+	std::vector<std::thread> workers;
+
+	for(int t = 0; t < pairsOfThreads; ++t)
+	{
+		auto mtx = std::make_shared<std::mutex>();
+		auto cond = std::make_shared<std::condition_variable>();
+		auto queue = std::make_shared<std::deque<std::vector<void*> > >();
+
+		workers.emplace_back([&allocator, blocks, mtx, cond, queue]()
+		{
+			std::vector<void*> batch;
+			for(int i = 0; i <= blocks; ++i)
+			{
+				if(i < blocks) batch.push_back(allocator.allocate(BENCH_SIZES[i % BENCH_NUM_SIZES]));
+				if(batch.size() == BATCH || i == blocks)
+				{
+					std::unique_lock<std::mutex> lock(*mtx);
+					queue->push_back(batch);
+					batch.clear();
+					cond->notify_one();
+				}
+			}
+			std::unique_lock<std::mutex> lock(*mtx);
+			queue->push_back(std::vector<void*>());	// end marker
+			cond->notify_one();
+		});
+		workers.emplace_back([&allocator, mtx, cond, queue]()
+		{
+			size_t received = 0;
+			for(;;)
+			{
+				std::vector<void*> batch;
+				{
+					std::unique_lock<std::mutex> lock(*mtx);
+					while(queue->empty()) cond->wait(lock);
+					batch.swap(queue->front());
+					queue->pop_front();
+				}
+				if(batch.empty()) break;
+				for(size_t i = 0; i < batch.size(); ++i, ++received)
+					allocator.deallocate(batch[i], BENCH_SIZES[received % BENCH_NUM_SIZES]);
+			}
+		});
+	}
+
+	for(size_t t = 0; t < workers.size(); ++t) workers[t].join();
+	return wallTime() - start;
+}
+
+TEST(libretroshare_util, DISABLED_ThreadCachingAllocatorBenchmark)
+{
+	const int PAIRS = 2000000;		// allocation + deallocation per thread
+	const int PASSED = 2000000;		// blocks passed per producer/consumer pair
+
+	LockedAllocator locked;
+	CachingAllocator caching;
+	MallocAllocator plain;
+
+	std::cout << "{" << std::endl;
+	std::cout << "  \"benchmark\": \"small_object_allocator\"," << std::endl;
+	std::cout << "  \"local_batches\": [" << std::endl;
+
+	const int THREADS[] = { 1, 2, 4, 8 };
+	for(int i = 0; i < 4; ++i)
+	{
+		int threads = THREADS[i];
+		double ops = 2.0 * PAIRS * threads;
+		std::cout << "    { \"threads\": " << threads
+		          << ", \"locked_mops\": " << ops / localBatches(locked, threads, PAIRS) / 1e6
+		          << ", \"caching_mops\": " << ops / localBatches(caching, threads, PAIRS) / 1e6
+		          << ", \"malloc_mops\": " << ops / localBatches(plain, threads, PAIRS) / 1e6
+		          << " }" << (i < 3 ? "," : "") << std::endl;
+	}
+
+	std::cout << "  ]," << std::endl;
+	std::cout << "  \"producer_consumer\": [" << std::endl;
+
+	for(int i = 0; i < 3; ++i)
+	{
+		int pairs = THREADS[i];
+		double ops = 2.0 * PASSED * pairs;
+		std::cout << "    { \"thread_pairs\": " << pairs
+		          << ", \"locked_mops\": " << ops / producerConsumer(locked, pairs, PASSED) / 1e6
+		          << ", \"caching_mops\": " << ops / producerConsumer(caching, pairs, PASSED) / 1e6
+		          << ", \"malloc_mops\": " << ops / producerConsumer(plain, pairs, PASSED) / 1e6
+		          << " }" << (i < 2 ? "," : "") << std::endl;
+	}
+
+	std::cout << "  ]," << std::endl;
+	std::cout << "  \"size_classes\": [" << std::endl;
+
+	std::vector<SizeClassStatistics> stats;
+	TCA::getStatistics(stats);
+	for(size_t c = 0; c < stats.size(); ++c)
+		std::cout << "    { \"block_size\": " << stats[c].blockSize
+		          << ", \"allocations\": " << stats[c].allocations
+		          << ", \"deallocations\": " << stats[c].deallocations
+		          << ", \"depot_gets\": " << stats[c].depotGets
+		          << ", \"depot_puts\": " << stats[c].depotPuts
+		          << ", \"depot_blocks\": " << stats[c].depotBlocks
+		          << ", \"system_allocations\": " << stats[c].systemAllocations
+		          << ", \"system_frees\": " << stats[c].systemFrees
+		          << " }" << (c + 1 < stats.size() ? "," : "") << std::endl;
+
+	std::cout << "  ]" << std::endl << "}" << std::endl;
+}
@@ -294,6 +294,39 @@ SOURCES +=  unittests.cc \
 
 SOURCES += libretroshare/crypto/chacha20_test.cc
 
+################################# tcponudp #################################
+
+SOURCES += libretroshare/tcponudp/tcpcongestion_test.cc
+
+################################ GXS tunnel ################################
+
+SOURCES += libretroshare/gxstunnel/p3gxstunnel_test.cc
+
+################################### PGP ####################################
+
+SOURCES += libretroshare/pgp/pgpkeyringstore_test.cc
+
+################################### util ###################################
+
+SOURCES += libretroshare/util/rsscheduler_test.cc
+SOURCES += libretroshare/util/rsmpscqueue_test.cc
+SOURCES += libretroshare/util/rsiptrie_test.cc
+SOURCES += libretroshare/util/rsexpr_test.cc
+SOURCES += libretroshare/util/smallobject_test.cc
+
+#################################### ft ####################################
+
+SOURCES += libretroshare/ft/ftfilemover_test.cc
+SOURCES += libretroshare/ft/ftfilecreator_test.cc
+
+############################### file_sharing ###############################
+
+SOURCES += libretroshare/file_sharing/search_cache_test.cc
+
+################################### pqi ####################################
+
+SOURCES += libretroshare/pqi/pqitrafficstats_test.cc
+
 ################################ Serialiser ################################
 HEADERS +=  libretroshare/serialiser/support.h \
 	libretroshare/serialiser/rstlvutil.h \
@@ -316,6 +349,7 @@ SOURCES +=  libretroshare/serialiser/rsturtleitem_test.cc \
 		libretroshare/serialiser/tlvkey_test.cc \
 		libretroshare/serialiser/support.cc \
 		libretroshare/serialiser/rstlvutil.cc \
+		libretroshare/serialiser/rsjsonstreamwriter_test.cc \
 
 # Still to convert these.
 #		libretroshare/serialiser/rsconfigitem_test.cc \
@@ -371,6 +405,8 @@ HEADERS += libretroshare/gxs/data_service/rsdataservice_test.h \
 
 SOURCES += libretroshare/gxs/data_service/rsdataservice_test.cc \
 	libretroshare/gxs/data_service/rsgxsdata_test.cc \
+	libretroshare/gxs/data_service/rsdataservice_bench.cc \
+	libretroshare/gxs/data_service/rsgxsintegrity_test.cc \
 
 
 ################################ dbase #####################################
@@ -388,6 +424,8 @@ SOURCES += libretroshare/gxs/data_service/rsdataservice_test.cc \
 
 SOURCES += libretroshare/services/status/status_test.cc \
 
+SOURCES += libretroshare/services/events/rseventsservice_test.cc
+
 ############################### gxs ########################################
 
 HEADERS += libretroshare/services/gxs/rsgxstestitems.h \
@@ -407,6 +445,7 @@ SOURCES += libretroshare/services/gxs/rsgxstestitems.cc \
 	libretroshare/services/gxs/FakePgpAuxUtils.cc \
 	libretroshare/services/gxs/nxsbasic_test.cc \
 	libretroshare/services/gxs/nxspair_tests.cc \
+	libretroshare/services/gxs/nxsbenchmark_tests.cc \
 	libretroshare/services/gxs/gxscircle_tests.cc \
 
 #	libretroshare/services/gxs/gxscircle_mintest.cc \